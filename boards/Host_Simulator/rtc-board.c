@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file rtc-board.c
+ * @brief RTC board support for the host simulator, driven by the virtual clock.
+ *
+ * Only the functions used by the LoRaMac-node system time and the FreeRTOS timer port are provided.
+ * Alarms are not needed since timers are implemented with FreeRTOS software timers.
+ */
+
+#include "FreeRTOS.h"
+
+#include "timer.h"
+#include "rtc-board.h"
+#include "sim_clock.h"
+
+/**
+ * @brief Backup registers used by the LoRaMac-node system time to store the time reference.
+ */
+static uint32_t ulBackupRegister0 = 0;
+static uint32_t ulBackupRegister1 = 0;
+
+/*-----------------------------------------------------------*/
+
+void RtcInit( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t RtcMs2Tick( TimerTime_t milliseconds )
+{
+    return milliseconds;
+}
+
+/*-----------------------------------------------------------*/
+
+TimerTime_t RtcTick2Ms( uint32_t tick )
+{
+    return tick;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t RtcGetTimerValue( void )
+{
+    return ( uint32_t ) SimClockNowMs();
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t RtcGetCalendarTime( uint16_t * milliseconds )
+{
+    uint64_t ullNowMs = SimClockRtcMs();
+
+    *milliseconds = ( uint16_t ) ( ullNowMs % 1000U );
+
+    return ( uint32_t ) ( ullNowMs / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+void RtcBkupWrite( uint32_t data0,
+                   uint32_t data1 )
+{
+    ulBackupRegister0 = data0;
+    ulBackupRegister1 = data1;
+}
+
+/*-----------------------------------------------------------*/
+
+void RtcBkupRead( uint32_t * data0,
+                  uint32_t * data1 )
+{
+    *data0 = ulBackupRegister0;
+    *data1 = ulBackupRegister1;
+}
+
+/*-----------------------------------------------------------*/
+
+void RtcProcess( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+TimerTime_t RtcTempCompensation( TimerTime_t period,
+                                 float temperature )
+{
+    ( void ) temperature;
+
+    /* Timers run on the simulated time, only the RTC calendar drifts with the temperature, see SimClockRtcMs(). */
+    return period;
+}
@@ -0,0 +1,868 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim-radio.c
+ * @brief Simulated LoRa transceiver for the host simulator.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "energy_monitor.h"
+#include "radio.h"
+#include "sim_clock.h"
+#include "sim-radio.h"
+#include "sim_fleet.h"
+
+/**
+ * @brief Radio interrupt flags, latched by the simulation events and processed by RadioIrqProcess.
+ */
+#define simradioIRQ_TX_DONE       ( 0x01 )
+#define simradioIRQ_TX_TIMEOUT    ( 0x02 )
+#define simradioIRQ_RX_DONE       ( 0x04 )
+#define simradioIRQ_RX_TIMEOUT    ( 0x08 )
+#define simradioIRQ_CAD_DONE      ( 0x10 )
+
+/**
+ * @brief Maximum payload length supported by the simulated radio.
+ */
+#define simradioMAX_PAYLOAD_LENGTH    ( 255 )
+
+/**
+ * @brief Wake up time of the simulated radio in milliseconds, same as an SX126x without TCXO.
+ */
+#define simradioWAKEUP_TIME_MS        ( 1 )
+
+/**
+ * @brief RSSI reported by the simulated radio on an idle channel.
+ */
+#define simradioNOISE_FLOOR_DBM       ( -120 )
+
+/**
+ * @brief SPI bytes the SX126x driver exchanges for a command, a modem configuration and a buffer access, as estimates
+ * for the energy accounting.
+ */
+#define simradioSPI_COMMAND_BYTES     ( 4U )
+#define simradioSPI_CONFIG_BYTES      ( 32U )
+#define simradioSPI_BUFFER_BYTES      ( 3U )
+
+/**
+ * @brief Modem parameters shared by the transmit and the receive configuration.
+ */
+typedef struct SimRadioModemConfig
+{
+    RadioModems_t modem;
+    uint32_t bandwidth;
+    uint32_t datarate;
+    uint8_t coderate;
+    uint16_t preambleLen;
+    bool fixLen;
+    uint8_t payloadLen;
+    bool crcOn;
+    bool iqInverted;
+} SimRadioModemConfig_t;
+
+static RadioEvents_t * pxRadioEvents = NULL;
+static RadioState_t xRadioState = RF_IDLE;
+static RadioModems_t xModem = MODEM_LORA;
+static uint32_t ulFrequency = 0;
+static SimRadioModemConfig_t xTxConfig = { 0 };
+static SimRadioModemConfig_t xRxConfig = { 0 };
+static int8_t cTxPower = 0;
+static uint16_t usRxSymbolTimeout = 0;
+static bool xRxContinuous = false;
+static bool xPublicNetwork = false;
+static uint8_t ucMaxPayloadLength = simradioMAX_PAYLOAD_LENGTH;
+
+/**
+ * @brief Pending simulation event for the current radio operation.
+ */
+static SimClockEvent_t xPendingEvent = simclockINVALID_EVENT;
+
+/**
+ * @brief Simulated time at which the receiver was turned on.
+ */
+static uint64_t ullRxStartMs = 0;
+
+/**
+ * @brief Interrupt flags pending processing.
+ */
+static volatile uint32_t ulIrqFlags = 0;
+
+/**
+ * @brief Payload of the last received frame.
+ */
+static uint8_t ucRxBuffer[ simradioMAX_PAYLOAD_LENGTH ];
+static uint8_t ucRxSize = 0;
+static int16_t sRxRssi = 0;
+static int8_t cRxSnr = 0;
+
+/**
+ * @brief State of the xorshift random number generator.
+ */
+static uint32_t ulRandomState = 1;
+
+static SimRadioStats_t xStats = { 0 };
+
+/*-----------------------------------------------------------*/
+
+static void RadioInit( RadioEvents_t * events );
+static RadioState_t RadioGetStatus( void );
+static void RadioSetModem( RadioModems_t modem );
+static void RadioSetChannel( uint32_t freq );
+static bool RadioIsChannelFree( uint32_t freq,
+                                uint32_t rxBandwidth,
+                                int16_t rssiThresh,
+                                uint32_t maxCarrierSenseTime );
+static uint32_t RadioRandom( void );
+static void RadioSetRxConfig( RadioModems_t modem,
+                              uint32_t bandwidth,
+                              uint32_t datarate,
+                              uint8_t coderate,
+                              uint32_t bandwidthAfc,
+                              uint16_t preambleLen,
+                              uint16_t symbTimeout,
+                              bool fixLen,
+                              uint8_t payloadLen,
+                              bool crcOn,
+                              bool freqHopOn,
+                              uint8_t hopPeriod,
+                              bool iqInverted,
+                              bool rxContinuous );
+static void RadioSetTxConfig( RadioModems_t modem,
+                              int8_t power,
+                              uint32_t fdev,
+                              uint32_t bandwidth,
+                              uint32_t datarate,
+                              uint8_t coderate,
+                              uint16_t preambleLen,
+                              bool fixLen,
+                              bool crcOn,
+                              bool freqHopOn,
+                              uint8_t hopPeriod,
+                              bool iqInverted,
+                              uint32_t timeout );
+static bool RadioCheckRfFrequency( uint32_t frequency );
+static uint32_t RadioTimeOnAir( RadioModems_t modem,
+                                uint32_t bandwidth,
+                                uint32_t datarate,
+                                uint8_t coderate,
+                                uint16_t preambleLen,
+                                bool fixLen,
+                                uint8_t payloadLen,
+                                bool crcOn );
+static void RadioSend( uint8_t * buffer,
+                       uint8_t size );
+static void RadioSleep( void );
+static void RadioStandby( void );
+static void RadioRx( uint32_t timeout );
+static void RadioStartCad( void );
+static void RadioSetTxContinuousWave( uint32_t freq,
+                                      int8_t power,
+                                      uint16_t time );
+static int16_t RadioRssi( RadioModems_t modem );
+static void RadioWrite( uint32_t addr,
+                        uint8_t data );
+static uint8_t RadioRead( uint32_t addr );
+static void RadioWriteBuffer( uint32_t addr,
+                              uint8_t * buffer,
+                              uint8_t size );
+static void RadioReadBuffer( uint32_t addr,
+                             uint8_t * buffer,
+                             uint8_t size );
+static void RadioSetMaxPayloadLength( RadioModems_t modem,
+                                      uint8_t max );
+static void RadioSetPublicNetwork( bool enable );
+static uint32_t RadioGetWakeupTime( void );
+static void RadioIrqProcess( void );
+static void RadioSetEventNotify( void ( * notify )( void ) );
+static void RadioRxBoosted( uint32_t timeout );
+static void RadioSetRxDutyCycle( uint32_t rxTime,
+                                 uint32_t sleepTime );
+
+/**
+ * @brief Radio driver structure used by the LoRaMAC layer.
+ */
+const struct Radio_s Radio =
+{
+    RadioInit,
+    RadioGetStatus,
+    RadioSetModem,
+    RadioSetChannel,
+    RadioIsChannelFree,
+    RadioRandom,
+    RadioSetRxConfig,
+    RadioSetTxConfig,
+    RadioCheckRfFrequency,
+    RadioTimeOnAir,
+    RadioSend,
+    RadioSleep,
+    RadioStandby,
+    RadioRx,
+    RadioStartCad,
+    RadioSetTxContinuousWave,
+    RadioRssi,
+    RadioWrite,
+    RadioRead,
+    RadioWriteBuffer,
+    RadioReadBuffer,
+    RadioSetMaxPayloadLength,
+    RadioSetPublicNetwork,
+    RadioGetWakeupTime,
+    RadioIrqProcess,
+    RadioSetEventNotify,
+    RadioRxBoosted,
+    RadioSetRxDutyCycle
+};
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBandwidthHz( uint32_t bandwidth )
+{
+    uint32_t ulHz;
+
+    switch( bandwidth )
+    {
+        case 1:
+            ulHz = 250000UL;
+            break;
+
+        case 2:
+            ulHz = 500000UL;
+            break;
+
+        default:
+            ulHz = 125000UL;
+            break;
+    }
+
+    return ulHz;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Symbol time of a LoRa modulation in microseconds.
+ */
+static uint32_t prvSymbolTimeUs( uint32_t bandwidth,
+                                 uint32_t datarate )
+{
+    return ( uint32_t ) ( ( ( uint64_t ) 1000000UL << datarate ) / prvBandwidthHz( bandwidth ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvStopPendingEvent( void )
+{
+    bool xWaiting = ( xPendingEvent == simclockINVALID_EVENT );
+
+    SimClockCancel( xPendingEvent );
+    xPendingEvent = simclockINVALID_EVENT;
+
+    if( xRadioState == RF_RX_RUNNING )
+    {
+        xStats.ullRxOnMs += SimClockNowMs() - ullRxStartMs;
+
+        /* Only a receiver without timeout and without frame on the way is still waiting at the coordinator. */
+        if( xWaiting == true )
+        {
+            SimFleetReportRxStop();
+        }
+    }
+
+    xRadioState = RF_IDLE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRaiseIrq( uint32_t ulFlag )
+{
+    ulIrqFlags |= ulFlag;
+
+    if( ( pxRadioEvents != NULL ) && ( pxRadioEvents->notify != NULL ) )
+    {
+        pxRadioEvents->notify();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnTxDone( void * pvContext )
+{
+    ( void ) pvContext;
+
+    xPendingEvent = simclockINVALID_EVENT;
+    xRadioState = RF_IDLE;
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+    prvRaiseIrq( simradioIRQ_TX_DONE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnTxTimeout( void * pvContext )
+{
+    ( void ) pvContext;
+
+    xPendingEvent = simclockINVALID_EVENT;
+    xRadioState = RF_IDLE;
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+    prvRaiseIrq( simradioIRQ_TX_TIMEOUT );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnRxTimeout( void * pvContext )
+{
+    ( void ) pvContext;
+
+    xPendingEvent = simclockINVALID_EVENT;
+    xStats.ullRxOnMs += SimClockNowMs() - ullRxStartMs;
+    xRadioState = RF_IDLE;
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+    prvRaiseIrq( simradioIRQ_RX_TIMEOUT );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnRxDone( void * pvContext )
+{
+    ( void ) pvContext;
+
+    xPendingEvent = simclockINVALID_EVENT;
+    xStats.ullRxOnMs += SimClockNowMs() - ullRxStartMs;
+    xStats.ulRxCount++;
+    xRadioState = RF_IDLE;
+
+    /* Like the SX126x, the receiver stays on after a frame in continuous mode. */
+    if( xRxContinuous == false )
+    {
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+    }
+
+    prvRaiseIrq( simradioIRQ_RX_DONE );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Receives a frame the coordinator delivers after the receiver was left on without timeout.
+ */
+static void prvOnFleetRx( const SimFleetMessage_t * pxReception )
+{
+    if( ( xRadioState == RF_RX_RUNNING ) && ( xPendingEvent == simclockINVALID_EVENT ) )
+    {
+        memcpy( ucRxBuffer, pxReception->ucFrame, pxReception->ucSize );
+        ucRxSize = pxReception->ucSize;
+        sRxRssi = pxReception->sRssi;
+        cRxSnr = pxReception->cSnr;
+        xPendingEvent = SimClockSchedule( ( uint32_t ) ( pxReception->ullTimeMs - SimClockNowMs() ), prvOnRxDone, NULL );
+        configASSERT( xPendingEvent != simclockINVALID_EVENT );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnCadDone( void * pvContext )
+{
+    ( void ) pvContext;
+
+    xPendingEvent = simclockINVALID_EVENT;
+    xRadioState = RF_IDLE;
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+    prvRaiseIrq( simradioIRQ_CAD_DONE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioInit( RadioEvents_t * events )
+{
+    pxRadioEvents = events;
+    ulIrqFlags = 0;
+    xRadioState = RF_IDLE;
+    xPendingEvent = simclockINVALID_EVENT;
+    SimFleetSetRxCallback( prvOnFleetRx );
+}
+
+/*-----------------------------------------------------------*/
+
+static RadioState_t RadioGetStatus( void )
+{
+    return xRadioState;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetModem( RadioModems_t modem )
+{
+    xModem = modem;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetChannel( uint32_t freq )
+{
+    ulFrequency = freq;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool RadioIsChannelFree( uint32_t freq,
+                                uint32_t rxBandwidth,
+                                int16_t rssiThresh,
+                                uint32_t maxCarrierSenseTime )
+{
+    ( void ) freq;
+    ( void ) rxBandwidth;
+    ( void ) maxCarrierSenseTime;
+
+    return( simradioNOISE_FLOOR_DBM <= rssiThresh );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t RadioRandom( void )
+{
+    /* xorshift32, deterministic for a given seed. */
+    ulRandomState ^= ulRandomState << 13;
+    ulRandomState ^= ulRandomState >> 17;
+    ulRandomState ^= ulRandomState << 5;
+
+    return ulRandomState;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetRxConfig( RadioModems_t modem,
+                              uint32_t bandwidth,
+                              uint32_t datarate,
+                              uint8_t coderate,
+                              uint32_t bandwidthAfc,
+                              uint16_t preambleLen,
+                              uint16_t symbTimeout,
+                              bool fixLen,
+                              uint8_t payloadLen,
+                              bool crcOn,
+                              bool freqHopOn,
+                              uint8_t hopPeriod,
+                              bool iqInverted,
+                              bool rxContinuous )
+{
+    ( void ) bandwidthAfc;
+    ( void ) freqHopOn;
+    ( void ) hopPeriod;
+
+    xModem = modem;
+    xRxConfig.modem = modem;
+    xRxConfig.bandwidth = bandwidth;
+    xRxConfig.datarate = datarate;
+    xRxConfig.coderate = coderate;
+    xRxConfig.preambleLen = preambleLen;
+    xRxConfig.fixLen = fixLen;
+    xRxConfig.payloadLen = payloadLen;
+    xRxConfig.crcOn = crcOn;
+    xRxConfig.iqInverted = iqInverted;
+    usRxSymbolTimeout = symbTimeout;
+    xRxContinuous = rxContinuous;
+    EnergyMonitor_AddSpiBytes( simradioSPI_CONFIG_BYTES );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetTxConfig( RadioModems_t modem,
+                              int8_t power,
+                              uint32_t fdev,
+                              uint32_t bandwidth,
+                              uint32_t datarate,
+                              uint8_t coderate,
+                              uint16_t preambleLen,
+                              bool fixLen,
+                              bool crcOn,
+                              bool freqHopOn,
+                              uint8_t hopPeriod,
+                              bool iqInverted,
+                              uint32_t timeout )
+{
+    ( void ) fdev;
+    ( void ) freqHopOn;
+    ( void ) hopPeriod;
+    ( void ) timeout;
+
+    xModem = modem;
+    xTxConfig.modem = modem;
+    xTxConfig.bandwidth = bandwidth;
+    xTxConfig.datarate = datarate;
+    xTxConfig.coderate = coderate;
+    xTxConfig.preambleLen = preambleLen;
+    xTxConfig.fixLen = fixLen;
+    xTxConfig.crcOn = crcOn;
+    xTxConfig.iqInverted = iqInverted;
+    cTxPower = power;
+    EnergyMonitor_AddSpiBytes( simradioSPI_CONFIG_BYTES );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool RadioCheckRfFrequency( uint32_t frequency )
+{
+    ( void ) frequency;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t RadioTimeOnAir( RadioModems_t modem,
+                                uint32_t bandwidth,
+                                uint32_t datarate,
+                                uint8_t coderate,
+                                uint16_t preambleLen,
+                                bool fixLen,
+                                uint8_t payloadLen,
+                                bool crcOn )
+{
+    double dTimeOnAirMs;
+
+    if( modem == MODEM_LORA )
+    {
+        double dSymbolMs = ( double ) prvSymbolTimeUs( bandwidth, datarate ) / 1000.0;
+        int32_t lLowDatarateOptimize = ( ( ( datarate >= 11 ) && ( bandwidth == 0 ) ) ||
+                                         ( ( datarate == 12 ) && ( bandwidth == 1 ) ) ) ? 1 : 0;
+        int32_t lNumerator = ( 8 * ( int32_t ) payloadLen ) - ( 4 * ( int32_t ) datarate ) + 28 +
+                             ( crcOn ? 16 : 0 ) - ( fixLen ? 20 : 0 );
+        int32_t lDenominator = 4 * ( ( int32_t ) datarate - ( 2 * lLowDatarateOptimize ) );
+        int32_t lPayloadSymbols = 8;
+
+        if( lNumerator > 0 )
+        {
+            lPayloadSymbols += ( ( lNumerator + lDenominator - 1 ) / lDenominator ) * ( coderate + 4 );
+        }
+
+        dTimeOnAirMs = ( ( ( double ) preambleLen + 4.25 ) + ( double ) lPayloadSymbols ) * dSymbolMs;
+    }
+    else
+    {
+        /* Preamble, 3 bytes sync word, length byte, payload and CRC. */
+        uint32_t ulBits = 8UL * ( ( uint32_t ) preambleLen + 3UL + ( fixLen ? 0UL : 1UL ) +
+                                  ( uint32_t ) payloadLen + ( crcOn ? 2UL : 0UL ) );
+
+        dTimeOnAirMs = ( ( double ) ulBits * 1000.0 ) / ( double ) datarate;
+    }
+
+    return ( uint32_t ) ceil( dTimeOnAirMs );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSend( uint8_t * buffer,
+                       uint8_t size )
+{
+    uint32_t ulTimeOnAir;
+    SimFleetRadioParams_t xParams;
+
+    prvStopPendingEvent();
+
+    ulTimeOnAir = RadioTimeOnAir( xTxConfig.modem, xTxConfig.bandwidth, xTxConfig.datarate, xTxConfig.coderate,
+                                  xTxConfig.preambleLen, xTxConfig.fixLen, size, xTxConfig.crcOn );
+
+    xStats.ulTxCount++;
+    xStats.ullTxOnMs += ulTimeOnAir;
+
+    if( SimFleetIsConnected() == true )
+    {
+        xParams.ulFrequency = ulFrequency;
+        xParams.ulDurationMs = ulTimeOnAir;
+        xParams.ucSpreadingFactor = ( uint8_t ) xTxConfig.datarate;
+        xParams.ucBandwidth = ( uint8_t ) xTxConfig.bandwidth;
+        xParams.ucCodingRate = xTxConfig.coderate;
+        xParams.cPower = cTxPower;
+        SimFleetReportTx( &xParams, buffer, size );
+    }
+
+    EnergyMonitor_AddSpiBytes( simradioSPI_BUFFER_BYTES + size + simradioSPI_COMMAND_BYTES );
+    EnergyMonitor_SetTxPower( cTxPower );
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_TX );
+    xRadioState = RF_TX_RUNNING;
+    xPendingEvent = SimClockSchedule( ulTimeOnAir, prvOnTxDone, NULL );
+    configASSERT( xPendingEvent != simclockINVALID_EVENT );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSleep( void )
+{
+    prvStopPendingEvent();
+    EnergyMonitor_AddSpiBytes( simradioSPI_COMMAND_BYTES );
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_SLEEP );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioStandby( void )
+{
+    prvStopPendingEvent();
+    EnergyMonitor_AddSpiBytes( simradioSPI_COMMAND_BYTES );
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioRx( uint32_t timeout )
+{
+    uint32_t ulWindowMs = timeout;
+    SimFleetRadioParams_t xParams = { 0 };
+    SimFleetMessage_t xReception;
+
+    prvStopPendingEvent();
+
+    /* A single receive window times out after the symbol timeout if no preamble is detected, like the
+     * SX126x does, rather than staying open for the whole maximum receive window. */
+    if( ( xRxContinuous == false ) && ( usRxSymbolTimeout > 0 ) && ( xRxConfig.modem == MODEM_LORA ) )
+    {
+        ulWindowMs = ( ( uint32_t ) usRxSymbolTimeout * prvSymbolTimeUs( xRxConfig.bandwidth, xRxConfig.datarate ) +
+                       999UL ) / 1000UL;
+    }
+
+    xStats.ulRxWindowCount++;
+    ullRxStartMs = SimClockNowMs();
+    xRadioState = RF_RX_RUNNING;
+    EnergyMonitor_AddSpiBytes( simradioSPI_COMMAND_BYTES );
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_RX );
+
+    xParams.ulFrequency = ulFrequency;
+    xParams.ulDurationMs = ( ( xRxContinuous == false ) || ( timeout > 0 ) ) ? ulWindowMs : 0;
+    xParams.ucSpreadingFactor = ( uint8_t ) xRxConfig.datarate;
+    xParams.ucBandwidth = ( uint8_t ) xRxConfig.bandwidth;
+    xParams.ucCodingRate = xRxConfig.coderate;
+
+    if( ( xRxConfig.modem == MODEM_LORA ) && ( SimFleetReportRx( &xParams, &xReception ) == true ) )
+    {
+        /* A downlink preamble falls in the window, the frame is received once it is entirely on the air. */
+        memcpy( ucRxBuffer, xReception.ucFrame, xReception.ucSize );
+        ucRxSize = xReception.ucSize;
+        sRxRssi = xReception.sRssi;
+        cRxSnr = xReception.cSnr;
+        xPendingEvent = SimClockSchedule( ( uint32_t ) ( xReception.ullTimeMs - ullRxStartMs ), prvOnRxDone, NULL );
+        configASSERT( xPendingEvent != simclockINVALID_EVENT );
+    }
+    else if( xParams.ulDurationMs > 0 )
+    {
+        xPendingEvent = SimClockSchedule( ulWindowMs, prvOnRxTimeout, NULL );
+        configASSERT( xPendingEvent != simclockINVALID_EVENT );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioStartCad( void )
+{
+    prvStopPendingEvent();
+
+    xRadioState = RF_CAD;
+    EnergyMonitor_AddSpiBytes( simradioSPI_COMMAND_BYTES );
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_RX );
+    xPendingEvent = SimClockSchedule( ( 2UL * prvSymbolTimeUs( xRxConfig.bandwidth, xRxConfig.datarate ) + 999UL ) / 1000UL,
+                                      prvOnCadDone, NULL );
+    configASSERT( xPendingEvent != simclockINVALID_EVENT );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetTxContinuousWave( uint32_t freq,
+                                      int8_t power,
+                                      uint16_t time )
+{
+    prvStopPendingEvent();
+
+    ulFrequency = freq;
+    xRadioState = RF_TX_RUNNING;
+    EnergyMonitor_AddSpiBytes( simradioSPI_COMMAND_BYTES );
+    EnergyMonitor_SetTxPower( power );
+    EnergyMonitor_SetRadioState( ENERGY_RADIO_TX );
+    xStats.ullTxOnMs += ( uint64_t ) time * 1000UL;
+    xPendingEvent = SimClockSchedule( ( uint32_t ) time * 1000UL, prvOnTxTimeout, NULL );
+    configASSERT( xPendingEvent != simclockINVALID_EVENT );
+}
+
+/*-----------------------------------------------------------*/
+
+static int16_t RadioRssi( RadioModems_t modem )
+{
+    ( void ) modem;
+
+    return simradioNOISE_FLOOR_DBM;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioWrite( uint32_t addr,
+                        uint8_t data )
+{
+    ( void ) addr;
+    ( void ) data;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t RadioRead( uint32_t addr )
+{
+    ( void ) addr;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioWriteBuffer( uint32_t addr,
+                              uint8_t * buffer,
+                              uint8_t size )
+{
+    ( void ) addr;
+    ( void ) buffer;
+    ( void ) size;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioReadBuffer( uint32_t addr,
+                             uint8_t * buffer,
+                             uint8_t size )
+{
+    ( void ) addr;
+    ( void ) buffer;
+    ( void ) size;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetMaxPayloadLength( RadioModems_t modem,
+                                      uint8_t max )
+{
+    ( void ) modem;
+
+    ucMaxPayloadLength = max;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetPublicNetwork( bool enable )
+{
+    xPublicNetwork = enable;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t RadioGetWakeupTime( void )
+{
+    return simradioWAKEUP_TIME_MS;
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioIrqProcess( void )
+{
+    uint32_t ulFlags;
+
+    taskENTER_CRITICAL();
+    ulFlags = ulIrqFlags;
+    ulIrqFlags = 0;
+    taskEXIT_CRITICAL();
+
+    if( pxRadioEvents == NULL )
+    {
+        return;
+    }
+
+    if( ( ( ulFlags & simradioIRQ_TX_DONE ) != 0 ) && ( pxRadioEvents->TxDone != NULL ) )
+    {
+        pxRadioEvents->TxDone();
+    }
+
+    if( ( ( ulFlags & simradioIRQ_TX_TIMEOUT ) != 0 ) && ( pxRadioEvents->TxTimeout != NULL ) )
+    {
+        pxRadioEvents->TxTimeout();
+    }
+
+    if( ( ( ulFlags & simradioIRQ_RX_DONE ) != 0 ) && ( pxRadioEvents->RxDone != NULL ) )
+    {
+        EnergyMonitor_AddSpiBytes( simradioSPI_BUFFER_BYTES + ucRxSize );
+        pxRadioEvents->RxDone( ucRxBuffer, ucRxSize, sRxRssi, cRxSnr );
+    }
+
+    if( ( ( ulFlags & simradioIRQ_RX_TIMEOUT ) != 0 ) && ( pxRadioEvents->RxTimeout != NULL ) )
+    {
+        pxRadioEvents->RxTimeout();
+    }
+
+    if( ( ( ulFlags & simradioIRQ_CAD_DONE ) != 0 ) && ( pxRadioEvents->CadDone != NULL ) )
+    {
+        pxRadioEvents->CadDone( false );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetEventNotify( void ( * notify )( void ) )
+{
+    if( pxRadioEvents != NULL )
+    {
+        pxRadioEvents->notify = notify;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioRxBoosted( uint32_t timeout )
+{
+    RadioRx( timeout );
+}
+
+/*-----------------------------------------------------------*/
+
+static void RadioSetRxDutyCycle( uint32_t rxTime,
+                                 uint32_t sleepTime )
+{
+    ( void ) sleepTime;
+
+    RadioRx( rxTime );
+}
+
+/*-----------------------------------------------------------*/
+
+void SimRadioSetSeed( uint32_t ulSeed )
+{
+    /* xorshift state must not be zero. */
+    ulRandomState = ( ulSeed != 0 ) ? ulSeed : 0x2545F491UL;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimRadioGetStats( SimRadioStats_t * pxStats )
+{
+    taskENTER_CRITICAL();
+    *pxStats = xStats;
+    taskEXIT_CRITICAL();
+}
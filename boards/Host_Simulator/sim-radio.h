@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim-radio.h
+ * @brief Simulated LoRa transceiver for the host simulator.
+ *
+ * Implements the LoRaMac-node radio driver interface on top of the virtual clock. Transmissions complete
+ * after their LoRa time on air and receive windows time out after their symbol timeout, so the MAC layer
+ * sees the same sequence of radio events, with the same timing, as on a real transceiver. When the device runs
+ * in a fleet, downlinks from the network server stand-in are received in the windows they fall in.
+ */
+
+#ifndef SIM_RADIO_H
+#define SIM_RADIO_H
+
+#include <stdint.h>
+
+/**
+ * @brief Radio statistics collected over a simulation run.
+ */
+typedef struct SimRadioStats
+{
+    uint32_t ulTxCount;       /**< @brief Number of frames transmitted. */
+    uint64_t ullTxOnMs;       /**< @brief Total time on air of the transmitted frames. */
+    uint32_t ulRxWindowCount; /**< @brief Number of receive windows opened. */
+    uint32_t ulRxCount;       /**< @brief Number of frames received. */
+    uint64_t ullRxOnMs;       /**< @brief Total time the receiver was on. */
+} SimRadioStats_t;
+
+/**
+ * @brief Seeds the random number generator of the simulated radio.
+ * Must be called before the LoRaMAC layer is initialized. Two runs using the same seed are identical.
+ *
+ * @param[in] ulSeed Seed value.
+ */
+void SimRadioSetSeed( uint32_t ulSeed );
+
+/**
+ * @brief Copies the statistics collected by the simulated radio.
+ *
+ * @param[out] pxStats Pointer to the statistics structure to be filled in.
+ */
+void SimRadioGetStats( SimRadioStats_t * pxStats );
+
+#endif /* SIM_RADIO_H */
@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim_clock.c
+ * @brief Discrete-event virtual clock driving the FreeRTOS tick of the host simulator.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sim_clock.h"
+#include "energy_monitor.h"
+
+#if ( configTICK_RATE_HZ != 1000 )
+    #error "Host simulator requires a tick period of 1 millisecond."
+#endif
+
+#if ( configUSE_TICKLESS_IDLE != 2 )
+    #error "Host simulator requires configUSE_TICKLESS_IDLE to be set to 2."
+#endif
+
+/**
+ * @brief Parabolic frequency error of the simulated RTC crystal, in ppm per degree squared from the turnover
+ * temperature, typical of a 32768 Hz tuning fork.
+ */
+#define simclockCRYSTAL_COEFFICIENT    ( -0.035 )
+#define simclockCRYSTAL_TURNOVER_C     ( 25.0 )
+
+/**
+ * @brief Step of the integration of the frequency error of the RTC crystal.
+ */
+#define simclockTEMPERATURE_STEP_MS    ( 60000ULL )
+
+/**
+ * @brief A pending simulation event.
+ */
+typedef struct SimClockEntry
+{
+    uint64_t ullTimeMs;          /**< @brief Simulated time at which the event is due. */
+    uint32_t ulSequence;         /**< @brief Monotonic sequence number, used as handle and to order events due at the same time. */
+    SimClockCallback_t xCallback; /**< @brief Callback for the event. */
+    void * pvContext;            /**< @brief Context passed to the callback. */
+    bool active;                 /**< @brief Flag set while the event is pending. */
+} SimClockEntry_t;
+
+/**
+ * @brief Pool of simulation events.
+ */
+static SimClockEntry_t xEvents[ simclockMAX_EVENTS ];
+
+/**
+ * @brief Sequence number assigned to the next scheduled event.
+ */
+static uint32_t ulNextSequence = 0;
+
+/**
+ * @brief Simulated time in milliseconds. Kept in 64 bits so that long runs do not wrap the tick count.
+ */
+static uint64_t ullNowMs = 0;
+
+/**
+ * @brief Simulated time at which the simulation ends, 0 if it runs forever.
+ */
+static uint64_t ullEndMs = 0;
+
+/**
+ * @brief Callback invoked once the simulated duration elapsed.
+ */
+static SimClockEndCallback_t xEndCallback = NULL;
+
+/**
+ * @brief Hook synchronizing the clock with other simulated devices.
+ */
+static SimClockSyncHook_t xSyncHook = NULL;
+
+/**
+ * @brief Frequency error of the simulated RTC crystal, in ppm.
+ */
+static double dRtcDriftPpm = 0.0;
+
+/**
+ * @brief Synthetic temperature of the RTC crystal: a daily sine around the mean, coldest at midnight.
+ */
+static double dTemperatureMeanC = simclockCRYSTAL_TURNOVER_C;
+static double dTemperatureSwingC = 0.0;
+
+/**
+ * @brief Time and frequency error integrated by the RTC so far, advanced in simclockTEMPERATURE_STEP_MS steps.
+ */
+static uint64_t ullRtcIntegratedMs = 0;
+static double dRtcErrorMs = 0.0;
+
+/**
+ * @brief Flag set while an event callback is executing.
+ */
+static BaseType_t xInsideInterrupt = pdFALSE;
+
+/**
+ * @brief Counters used to detect idle loop iterations which did not suppress ticks.
+ */
+static uint32_t ulSuppressCount = 0;
+static uint32_t ulLastSuppressCount = UINT32_MAX;
+
+/**
+ * @brief Idle statistics.
+ */
+static SimClockStats_t xStats = { 0 };
+
+/*-----------------------------------------------------------*/
+
+static SimClockEntry_t * prvGetNextEvent( void )
+{
+    SimClockEntry_t * pxNext = NULL;
+    size_t x;
+
+    for( x = 0; x < simclockMAX_EVENTS; x++ )
+    {
+        if( xEvents[ x ].active == true )
+        {
+            if( ( pxNext == NULL ) ||
+                ( xEvents[ x ].ullTimeMs < pxNext->ullTimeMs ) ||
+                ( ( xEvents[ x ].ullTimeMs == pxNext->ullTimeMs ) &&
+                  ( xEvents[ x ].ulSequence < pxNext->ulSequence ) ) )
+            {
+                pxNext = &xEvents[ x ];
+            }
+        }
+    }
+
+    return pxNext;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Advances the tick count. Must be called with the scheduler suspended.
+ * All but the last tick are stepped, the last one is processed as a regular tick interrupt so that tasks
+ * whose timeout expires on that tick are moved to the ready list once the scheduler is resumed.
+ */
+static void prvAdvance( TickType_t xTicks )
+{
+    if( xTicks > 0 )
+    {
+        if( xTicks > 1 )
+        {
+            vTaskStepTick( xTicks - 1 );
+        }
+
+        xInsideInterrupt = pdTRUE;
+        ( void ) xTaskIncrementTick();
+        xInsideInterrupt = pdFALSE;
+
+        ullNowMs += xTicks;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Advances the clock up to the target time, or to an earlier time granted by the synchronization hook.
+ * Must be called with the scheduler suspended.
+ */
+static void prvAdvanceTo( uint64_t ullTargetMs )
+{
+    if( xSyncHook != NULL )
+    {
+        ullTargetMs = xSyncHook( ullTargetMs );
+    }
+
+    if( ullTargetMs > ullNowMs )
+    {
+        prvAdvance( ( TickType_t ) ( ullTargetMs - ullNowMs ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDispatchDueEvents( void )
+{
+    SimClockEntry_t * pxEvent;
+    SimClockCallback_t xCallback;
+    void * pvContext;
+
+    for( ; ; )
+    {
+        taskENTER_CRITICAL();
+        pxEvent = prvGetNextEvent();
+
+        if( ( pxEvent != NULL ) && ( pxEvent->ullTimeMs <= ullNowMs ) )
+        {
+            pxEvent->active = false;
+            xCallback = pxEvent->xCallback;
+            pvContext = pxEvent->pvContext;
+        }
+        else
+        {
+            pxEvent = NULL;
+        }
+
+        taskEXIT_CRITICAL();
+
+        if( pxEvent == NULL )
+        {
+            break;
+        }
+
+        xInsideInterrupt = pdTRUE;
+        xCallback( pvContext );
+        xInsideInterrupt = pdFALSE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCheckEnd( void )
+{
+    if( ( ullEndMs > 0 ) && ( ullNowMs >= ullEndMs ) && ( xEndCallback != NULL ) )
+    {
+        SimClockEndCallback_t xCallback = xEndCallback;
+
+        xEndCallback = NULL;
+        xCallback();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockInit( uint64_t ullDurationMs,
+                   SimClockEndCallback_t xOnEnd )
+{
+    size_t x;
+
+    for( x = 0; x < simclockMAX_EVENTS; x++ )
+    {
+        xEvents[ x ].active = false;
+    }
+
+    ulNextSequence = 0;
+    ullNowMs = 0;
+    ullEndMs = ullDurationMs;
+    xEndCallback = xOnEnd;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockStart( void )
+{
+    struct itimerval xTimer = { 0 };
+
+    /* The POSIX port generates the tick from the ITIMER_REAL signal. Disarm it so that the tick count only
+     * advances through this module, and runs are not perturbed by the wall clock. */
+    if( setitimer( ITIMER_REAL, &xTimer, NULL ) != 0 )
+    {
+        configPRINTF( ( "Failed to stop the port tick timer, simulation will not be deterministic.\r\n" ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockSetSyncHook( SimClockSyncHook_t xHook )
+{
+    xSyncHook = xHook;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockEnd( void )
+{
+    SimClockEndCallback_t xCallback = xEndCallback;
+
+    xEndCallback = NULL;
+
+    if( xCallback != NULL )
+    {
+        xCallback();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t SimClockNowMs( void )
+{
+    return ullNowMs;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockSetRtcDrift( double dDriftPpm )
+{
+    dRtcDriftPpm = dDriftPpm;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockSetTemperature( double dMeanC,
+                             double dSwingC )
+{
+    dTemperatureMeanC = dMeanC;
+    dTemperatureSwingC = dSwingC;
+}
+
+/*-----------------------------------------------------------*/
+
+static double prvTemperatureAt( uint64_t ullTimeMs )
+{
+    return dTemperatureMeanC - ( dTemperatureSwingC * cos( 2.0 * M_PI * ( double ) ( ullTimeMs % 86400000ULL ) / 86400000.0 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+double SimClockTemperature( void )
+{
+    return prvTemperatureAt( ullNowMs );
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t SimClockRtcMs( void )
+{
+    uint64_t ullStepMs;
+    double dDeltaC;
+
+    /* The temperature changes slowly, so the frequency error is integrated at the middle of each step. */
+    while( ullRtcIntegratedMs < ullNowMs )
+    {
+        ullStepMs = ullNowMs - ullRtcIntegratedMs;
+        ullStepMs = ( ullStepMs < simclockTEMPERATURE_STEP_MS ) ? ullStepMs : simclockTEMPERATURE_STEP_MS;
+        dDeltaC = prvTemperatureAt( ullRtcIntegratedMs + ( ullStepMs / 2U ) ) - simclockCRYSTAL_TURNOVER_C;
+        dRtcErrorMs += ( double ) ullStepMs * ( dRtcDriftPpm + ( simclockCRYSTAL_COEFFICIENT * dDeltaC * dDeltaC ) ) / 1000000.0;
+        ullRtcIntegratedMs += ullStepMs;
+    }
+
+    return ( uint64_t ) ( ( int64_t ) ullNowMs + ( int64_t ) dRtcErrorMs );
+}
+
+/*-----------------------------------------------------------*/
+
+SimClockEvent_t SimClockSchedule( uint32_t ulDelayMs,
+                                  SimClockCallback_t xCallback,
+                                  void * pvContext )
+{
+    SimClockEvent_t xHandle = simclockINVALID_EVENT;
+    size_t x;
+
+    configASSERT( xCallback != NULL );
+
+    taskENTER_CRITICAL();
+
+    for( x = 0; x < simclockMAX_EVENTS; x++ )
+    {
+        if( xEvents[ x ].active == false )
+        {
+            xEvents[ x ].ullTimeMs = ullNowMs + ulDelayMs;
+            xEvents[ x ].ulSequence = ulNextSequence;
+            xEvents[ x ].xCallback = xCallback;
+            xEvents[ x ].pvContext = pvContext;
+            xEvents[ x ].active = true;
+
+            xHandle = ( SimClockEvent_t ) ( ulNextSequence & 0x7FFFFFFFUL );
+            ulNextSequence++;
+            break;
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    return xHandle;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockCancel( SimClockEvent_t xEvent )
+{
+    size_t x;
+
+    if( xEvent != simclockINVALID_EVENT )
+    {
+        taskENTER_CRITICAL();
+
+        for( x = 0; x < simclockMAX_EVENTS; x++ )
+        {
+            if( ( xEvents[ x ].active == true ) &&
+                ( ( xEvents[ x ].ulSequence & 0x7FFFFFFFUL ) == ( uint32_t ) xEvent ) )
+            {
+                xEvents[ x ].active = false;
+                break;
+            }
+        }
+
+        taskEXIT_CRITICAL();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void SimClockGetStats( SimClockStats_t * pxStats )
+{
+    taskENTER_CRITICAL();
+    *pxStats = xStats;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t SimClockIsInsideInterrupt( void )
+{
+    return xInsideInterrupt;
+}
+
+/*-----------------------------------------------------------*/
+
+void vSimClockSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+    SimClockEntry_t * pxNext;
+    uint64_t ullTarget = ullNowMs + xExpectedIdleTime;
+    uint64_t ullStartMs;
+
+    ulSuppressCount++;
+
+    /* Scheduler is suspended, check if a task was readied in between. */
+    if( eTaskConfirmSleepModeStatus() != eAbortSleep )
+    {
+        pxNext = prvGetNextEvent();
+
+        if( ( pxNext != NULL ) && ( pxNext->ullTimeMs < ullTarget ) )
+        {
+            ullTarget = pxNext->ullTimeMs;
+        }
+
+        if( ( ullEndMs > 0 ) && ( ullEndMs < ullTarget ) )
+        {
+            ullTarget = ullEndMs;
+        }
+
+        if( ullTarget > ullNowMs )
+        {
+            ullStartMs = ullNowMs;
+            prvAdvanceTo( ullTarget );
+            xStats.ulWakeups++;
+            xStats.ullSleepMs += ullNowMs - ullStartMs;
+
+            /* Code takes no simulated time, so each wakeup is charged a fixed active time. */
+            EnergyMonitor_AddMcuSleep( ( uint32_t ) ( ullNowMs - ullStartMs ) * 1000U );
+            EnergyMonitor_AddMcuActive( lorawanConfigENERGY_WAKEUP_US );
+        }
+
+        prvDispatchDueEvents();
+        prvCheckEnd();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void vSimClockIdleHook( void )
+{
+    /* If the previous idle loop iteration did not suppress ticks, the next task unblocks within less than
+     * configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks. Without a tick interrupt nothing else would move time
+     * forward, so advance by a single tick here. */
+    if( ulSuppressCount == ulLastSuppressCount )
+    {
+        vTaskSuspendAll();
+        {
+            xStats.ulWakeups++;
+            EnergyMonitor_AddMcuSleep( 1000U );
+            EnergyMonitor_AddMcuActive( lorawanConfigENERGY_WAKEUP_US );
+            prvDispatchDueEvents();
+            prvAdvanceTo( ullNowMs + 1 );
+            prvDispatchDueEvents();
+            prvCheckEnd();
+        }
+        ( void ) xTaskResumeAll();
+    }
+
+    ulLastSuppressCount = ulSuppressCount;
+}
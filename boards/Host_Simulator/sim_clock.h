@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim_clock.h
+ * @brief Discrete-event virtual clock for the host simulator.
+ *
+ * The host build does not run on a real time base. The FreeRTOS tick only advances when every task is
+ * blocked: the idle task asks the clock to jump straight to the earliest of the next task unblock time
+ * (which covers vTaskDelay, DelayMs and the timer daemon serving freertos_osal/timer.c) and the next pending
+ * simulation event (radio airtime, receive windows). Events scheduled for the same instant are dispatched
+ * in the order they were scheduled, so a run is fully reproducible for a given seed.
+ */
+
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+
+/**
+ * @brief Maximum number of simulation events which can be pending at any time.
+ */
+#define simclockMAX_EVENTS    ( 32 )
+
+/**
+ * @brief Idle statistics collected over a simulation run, as a proxy for the idle current on a board.
+ */
+typedef struct SimClockStats
+{
+    uint32_t ulWakeups;  /**< @brief Number of times the MCU would have woken up from tickless idle or a tick. */
+    uint64_t ullSleepMs; /**< @brief Total time spent with the tick suppressed. */
+} SimClockStats_t;
+
+/**
+ * @brief Handle to a scheduled simulation event. Negative value denotes an invalid handle.
+ */
+typedef int32_t SimClockEvent_t;
+
+/**
+ * @brief Invalid simulation event handle.
+ */
+#define simclockINVALID_EVENT    ( ( SimClockEvent_t ) -1 )
+
+/**
+ * @brief Callback invoked when a simulation event is due.
+ * Callbacks run in interrupt context from the point of view of the FreeRTOS application, so they should only
+ * use the FromISR variants of the FreeRTOS API.
+ */
+typedef void ( * SimClockCallback_t )( void * pvContext );
+
+/**
+ * @brief Callback invoked once the simulated duration has elapsed.
+ */
+typedef void ( * SimClockEndCallback_t )( void );
+
+/**
+ * @brief Hook invoked before the virtual clock advances, used to synchronize with other simulated devices.
+ * Returns the time to advance to, which can be earlier than the requested time if an external event (e.g. a
+ * frame arriving on the air) must be processed first. The hook schedules such events itself.
+ */
+typedef uint64_t ( * SimClockSyncHook_t )( uint64_t ullTargetMs );
+
+/**
+ * @brief Initializes the virtual clock.
+ *
+ * @param[in] ullDurationMs Simulated duration after which the simulation stops. Set to 0 to run forever.
+ * @param[in] xOnEnd Callback invoked from the idle task when the simulated duration has elapsed.
+ */
+void SimClockInit( uint64_t ullDurationMs,
+                   SimClockEndCallback_t xOnEnd );
+
+/**
+ * @brief Stops the real time tick of the port so that time only advances on simulation events.
+ * Must be called once the scheduler is running, for example from the daemon task startup hook.
+ */
+void SimClockStart( void );
+
+/**
+ * @brief Installs a synchronization hook, see SimClockSyncHook_t.
+ *
+ * @param[in] xHook Hook, or NULL to advance freely.
+ */
+void SimClockSetSyncHook( SimClockSyncHook_t xHook );
+
+/**
+ * @brief Ends the simulation immediately, invoking the end callback passed to SimClockInit().
+ */
+void SimClockEnd( void );
+
+/**
+ * @brief Returns the simulated time in milliseconds elapsed since SimClockInit().
+ */
+uint64_t SimClockNowMs( void );
+
+/**
+ * @brief Sets the frequency error of the simulated RTC crystal.
+ * Only the RTC calendar time drifts, so that the network synchronized time can be evaluated. Task delays, timers
+ * and radio events keep running on the simulated time.
+ *
+ * @param[in] dDriftPpm Frequency error in ppm, positive if the RTC runs fast.
+ */
+void SimClockSetRtcDrift( double dDriftPpm );
+
+/**
+ * @brief Sets the synthetic temperature trace of the simulated RTC crystal, a daily sine coldest at midnight.
+ * The crystal follows a parabolic curve with a turnover at 25 C, so the RTC calendar runs slow away from it, on top
+ * of the frequency error set by SimClockSetRtcDrift().
+ *
+ * @param[in] dMeanC Mean temperature in degrees Celsius. Default 25.
+ * @param[in] dSwingC Amplitude of the daily variation in degrees Celsius. Default 0.
+ */
+void SimClockSetTemperature( double dMeanC,
+                             double dSwingC );
+
+/**
+ * @brief Returns the temperature of the simulated RTC crystal at the current simulated time, in degrees Celsius.
+ */
+double SimClockTemperature( void );
+
+/**
+ * @brief Returns the time elapsed since SimClockInit() as measured by the simulated RTC, in milliseconds.
+ */
+uint64_t SimClockRtcMs( void );
+
+/**
+ * @brief Copies the idle statistics.
+ * A wakeup is counted for each tickless sleep which ends, whatever woke it up, and for each tick processed because
+ * the next task unblocked too soon to suppress ticks.
+ *
+ * @param[out] pxStats Pointer to the statistics structure to be filled in.
+ */
+void SimClockGetStats( SimClockStats_t * pxStats );
+
+/**
+ * @brief Schedules a simulation event.
+ *
+ * @param[in] ulDelayMs Delay in milliseconds from the current simulated time.
+ * @param[in] xCallback Callback to be invoked when the event is due.
+ * @param[in] pvContext Context passed to the callback.
+ * @return Handle to the event or simclockINVALID_EVENT if there is no free event slot.
+ */
+SimClockEvent_t SimClockSchedule( uint32_t ulDelayMs,
+                                  SimClockCallback_t xCallback,
+                                  void * pvContext );
+
+/**
+ * @brief Cancels a pending simulation event. Cancelling an event which already fired has no effect.
+ *
+ * @param[in] xEvent Handle returned by SimClockSchedule().
+ */
+void SimClockCancel( SimClockEvent_t xEvent );
+
+/**
+ * @brief Returns pdTRUE while a simulation event callback is executing.
+ * Used to implement xPortIsInsideInterrupt() for the host port.
+ */
+BaseType_t SimClockIsInsideInterrupt( void );
+
+/**
+ * @brief Implementation of portSUPPRESS_TICKS_AND_SLEEP() for the host simulator.
+ * Jumps the tick count to the next task unblock time or the next simulation event, whichever is earlier,
+ * and dispatches all the events which are due.
+ *
+ * @param[in] xExpectedIdleTime Number of ticks until the next task unblocks.
+ */
+void vSimClockSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+
+/**
+ * @brief Advances time when the idle task could not suppress ticks because the next task unblocks in
+ * less than configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks. Called from the idle hook.
+ */
+void vSimClockIdleHook( void );
+
+#endif /* SIM_CLOCK_H */
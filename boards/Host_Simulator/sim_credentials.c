@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim_credentials.c
+ * @brief LoRaWAN credentials of the simulated end devices.
+ */
+
+#include <string.h>
+
+#include "sim_credentials.h"
+
+/**
+ * @brief Prefix of the DevEUIs of the simulated devices, the device index makes the last four bytes.
+ */
+static const uint8_t ucDevEuiPrefix[ 4 ] = { 0xFE, 0xFF, 0x51, 0x4D };
+
+/**
+ * @brief JoinEUI shared by the simulated devices.
+ */
+static const uint8_t ucJoinEui[ simcredentialsEUI_SIZE ] = { 0xFE, 0xFF, 0x51, 0x4D, 0x00, 0x00, 0x00, 0x01 };
+
+/**
+ * @brief Root of the AppKeys, the device index is mixed into the last four bytes.
+ */
+static const uint8_t ucAppKeyRoot[ simcredentialsKEY_SIZE ] =
+{
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+static uint32_t ulSelectedDevice = 0;
+
+/*-----------------------------------------------------------*/
+
+void SimCredentialsDerive( uint32_t ulDevice,
+                           SimCredentials_t * pxCredentials )
+{
+    size_t x;
+
+    memcpy( pxCredentials->ucDevEui, ucDevEuiPrefix, sizeof( ucDevEuiPrefix ) );
+    memcpy( pxCredentials->ucJoinEui, ucJoinEui, sizeof( ucJoinEui ) );
+    memcpy( pxCredentials->ucAppKey, ucAppKeyRoot, sizeof( ucAppKeyRoot ) );
+
+    for( x = 0; x < 4; x++ )
+    {
+        uint8_t ucByte = ( uint8_t ) ( ulDevice >> ( 24 - ( 8 * x ) ) );
+
+        pxCredentials->ucDevEui[ 4 + x ] = ucByte;
+        pxCredentials->ucAppKey[ simcredentialsKEY_SIZE - 4 + x ] ^= ucByte;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void SimCredentialsSelect( uint32_t ulDevice )
+{
+    ulSelectedDevice = ulDevice;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimCredentialsGet( SimCredentials_t * pxCredentials )
+{
+    SimCredentialsDerive( ulSelectedDevice, pxCredentials );
+}
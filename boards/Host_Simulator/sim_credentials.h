@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim_credentials.h
+ * @brief LoRaWAN credentials of the simulated end devices.
+ *
+ * Every simulated device derives its DevEUI and AppKey from its index in the fleet, so the network server
+ * stand-in of the fleet simulator can be provisioned with the credentials of the whole fleet without any
+ * configuration file. The credentials are for simulation only.
+ */
+
+#ifndef SIM_CREDENTIALS_H
+#define SIM_CREDENTIALS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Sizes of the credentials.
+ */
+#define simcredentialsEUI_SIZE    ( 8 )
+#define simcredentialsKEY_SIZE    ( 16 )
+
+/**
+ * @brief OTAA credentials of a device, EUIs in big endian form.
+ */
+typedef struct SimCredentials
+{
+    uint8_t ucDevEui[ simcredentialsEUI_SIZE ];
+    uint8_t ucJoinEui[ simcredentialsEUI_SIZE ];
+    uint8_t ucAppKey[ simcredentialsKEY_SIZE ];
+} SimCredentials_t;
+
+/**
+ * @brief Derives the credentials of a device.
+ *
+ * @param[in] ulDevice Index of the device in the fleet.
+ * @param[out] pxCredentials Credentials of the device.
+ */
+void SimCredentialsDerive( uint32_t ulDevice,
+                           SimCredentials_t * pxCredentials );
+
+/**
+ * @brief Selects the device this simulator process runs as. Device 0 is used by default.
+ *
+ * @param[in] ulDevice Index of the device in the fleet.
+ */
+void SimCredentialsSelect( uint32_t ulDevice );
+
+/**
+ * @brief Returns the credentials of the selected device.
+ *
+ * @param[out] pxCredentials Credentials of the device.
+ */
+void SimCredentialsGet( SimCredentials_t * pxCredentials );
+
+#endif /* SIM_CREDENTIALS_H */
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim_fleet.c
+ * @brief Device side of the fleet simulator connection.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "FreeRTOS.h"
+
+#include "sim_clock.h"
+#include "sim_fleet.h"
+
+/**
+ * @brief Socket connected to the coordinator, -1 when running standalone.
+ */
+static int iFleetSocket = -1;
+
+/**
+ * @brief Callback of the frames delivered in place of a grant.
+ */
+static SimFleetRxCallback_t xRxCallback = NULL;
+
+/*-----------------------------------------------------------*/
+
+static void prvSend( const SimFleetMessage_t * pxMessage )
+{
+    if( send( iFleetSocket, pxMessage, sizeof( SimFleetMessage_t ), 0 ) != ( ssize_t ) sizeof( SimFleetMessage_t ) )
+    {
+        /* Coordinator is gone, nothing can be simulated any more. */
+        exit( EXIT_FAILURE );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReceive( SimFleetMessage_t * pxMessage )
+{
+    if( recv( iFleetSocket, pxMessage, sizeof( SimFleetMessage_t ), 0 ) != ( ssize_t ) sizeof( SimFleetMessage_t ) )
+    {
+        exit( EXIT_FAILURE );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Virtual clock synchronization hook. Blocks until the coordinator grants the time to advance to.
+ */
+static uint64_t prvSynchronize( uint64_t ullTargetMs )
+{
+    SimFleetMessage_t xMessage = { 0 };
+    uint64_t ullGrantedMs = ullTargetMs;
+    bool xGranted = false;
+
+    xMessage.ulType = SIMFLEET_MSG_ADVANCE;
+    xMessage.ullTimeMs = ullTargetMs;
+    prvSend( &xMessage );
+
+    while( xGranted == false )
+    {
+        prvReceive( &xMessage );
+
+        switch( xMessage.ulType )
+        {
+            case SIMFLEET_MSG_GRANT:
+                ullGrantedMs = xMessage.ullTimeMs;
+                xGranted = true;
+                break;
+
+            case SIMFLEET_MSG_RX_DONE:
+
+                /* A frame for the receiver left on, the clock advances up to the end of its reception. */
+                if( xRxCallback != NULL )
+                {
+                    xRxCallback( &xMessage );
+                }
+
+                ullGrantedMs = xMessage.ullTimeMs;
+                xGranted = true;
+                break;
+
+            case SIMFLEET_MSG_END:
+                SimClockEnd();
+
+                /* End callback is not expected to return. */
+                exit( EXIT_SUCCESS );
+                break;
+
+            default:
+                configPRINTF( ( "Unexpected fleet message type %lu.\r\n", ( unsigned long ) xMessage.ulType ) );
+                break;
+        }
+    }
+
+    return ullGrantedMs;
+}
+
+/*-----------------------------------------------------------*/
+
+void SimFleetConnect( int iSocket )
+{
+    iFleetSocket = iSocket;
+    SimClockSetSyncHook( prvSynchronize );
+}
+
+/*-----------------------------------------------------------*/
+
+bool SimFleetIsConnected( void )
+{
+    return( iFleetSocket >= 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+void SimFleetReportTx( const SimFleetRadioParams_t * pxRadio,
+                       const uint8_t * pucFrame,
+                       uint8_t ucSize )
+{
+    SimFleetMessage_t xMessage = { 0 };
+
+    if( iFleetSocket >= 0 )
+    {
+        xMessage.ulType = SIMFLEET_MSG_TX;
+        xMessage.ullTimeMs = SimClockNowMs();
+        xMessage.xRadio = *pxRadio;
+        xMessage.ucSize = ucSize;
+        memcpy( xMessage.ucFrame, pucFrame, ucSize );
+        prvSend( &xMessage );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool SimFleetReportRx( const SimFleetRadioParams_t * pxRadio,
+                       SimFleetMessage_t * pxReception )
+{
+    SimFleetMessage_t xMessage = { 0 };
+
+    if( iFleetSocket < 0 )
+    {
+        return false;
+    }
+
+    xMessage.ulType = SIMFLEET_MSG_RX;
+    xMessage.ullTimeMs = SimClockNowMs();
+    xMessage.xRadio = *pxRadio;
+    prvSend( &xMessage );
+
+    /* The coordinator answers straight away, the device time does not advance in between. */
+    prvReceive( pxReception );
+    configASSERT( pxReception->ulType == SIMFLEET_MSG_RX_DONE );
+
+    return( pxReception->ucSize > 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+void SimFleetReportRxStop( void )
+{
+    SimFleetMessage_t xMessage = { 0 };
+
+    if( iFleetSocket >= 0 )
+    {
+        xMessage.ulType = SIMFLEET_MSG_RX_STOP;
+        xMessage.ullTimeMs = SimClockNowMs();
+        prvSend( &xMessage );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void SimFleetSetRxCallback( SimFleetRxCallback_t xCallback )
+{
+    xRxCallback = xCallback;
+}
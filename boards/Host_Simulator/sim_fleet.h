@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim_fleet.h
+ * @brief Device side of the fleet simulator connection.
+ *
+ * When the host simulator is started by the fleet coordinator, the virtual clock only advances when the
+ * coordinator grants it, the simulated radio reports its transmissions to the shared channel model and receives
+ * the downlinks of the network server stand-in.
+ * See sim_fleet_protocol.h.
+ */
+
+#ifndef SIM_FLEET_H
+#define SIM_FLEET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sim_fleet_protocol.h"
+
+/**
+ * @brief Callback receiving a frame delivered by the coordinator while the receiver is left on without timeout.
+ * Called from the virtual clock synchronization, before the clock advances to the end of the reception.
+ *
+ * @param[in] pxReception Received frame, its size, RSSI and SNR, and in ullTimeMs the time its reception ends.
+ */
+typedef void ( * SimFleetRxCallback_t )( const SimFleetMessage_t * pxReception );
+
+/**
+ * @brief Connects the device to the fleet coordinator.
+ * Must be called before the scheduler is started.
+ *
+ * @param[in] iSocket Socket inherited from the coordinator.
+ */
+void SimFleetConnect( int iSocket );
+
+/**
+ * @brief Returns true if the device runs as part of a fleet.
+ */
+bool SimFleetIsConnected( void );
+
+/**
+ * @brief Reports the start of a transmission to the coordinator.
+ *
+ * @param[in] pxRadio Radio parameters of the transmission.
+ * @param[in] pucFrame Frame transmitted.
+ * @param[in] ucSize Size of the frame.
+ */
+void SimFleetReportTx( const SimFleetRadioParams_t * pxRadio,
+                       const uint8_t * pucFrame,
+                       uint8_t ucSize );
+
+/**
+ * @brief Reports that the receiver was turned on, and returns the frame it will receive, if any.
+ *
+ * @param[in] pxRadio Receive parameters, with ulDurationMs set to the duration of the receive window.
+ * @param[out] pxReception Received frame, its size, RSSI and SNR, and in ullTimeMs the time its reception ends.
+ * @return true if a frame is received in the window, false otherwise or if the device runs standalone.
+ */
+bool SimFleetReportRx( const SimFleetRadioParams_t * pxRadio,
+                       SimFleetMessage_t * pxReception );
+
+/**
+ * @brief Reports that a receiver left on without timeout was turned off.
+ */
+void SimFleetReportRxStop( void );
+
+/**
+ * @brief Sets the callback of the frames received after the receiver was left on without timeout.
+ *
+ * @param[in] xCallback Callback, NULL to drop such frames.
+ */
+void SimFleetSetRxCallback( SimFleetRxCallback_t xCallback );
+
+#endif /* SIM_FLEET_H */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file sim_fleet_protocol.h
+ * @brief Messages exchanged between a simulated end device and the fleet coordinator.
+ *
+ * Each end device runs as a separate host simulator process, connected to the coordinator through a
+ * SOCK_SEQPACKET socket. Time is advanced conservatively: a device whose tasks are all blocked sends
+ * the simulated time it wants to advance to and waits. The coordinator only grants the smallest requested time
+ * across the fleet, one device at a time, so a device never runs ahead of a radio event which could affect it.
+ * When a device turns its receiver on, it waits for the coordinator to tell which frame, if any, it will receive.
+ * A receiver left on without timeout can also receive a frame scheduled later: the coordinator then sends the
+ * frame in place of the next grant, at the time its reception ends.
+ * All times are in milliseconds, relative to the boot of the device which sends or receives the message.
+ */
+
+#ifndef SIM_FLEET_PROTOCOL_H
+#define SIM_FLEET_PROTOCOL_H
+
+#include <stdint.h>
+
+/**
+ * @brief Message types.
+ */
+typedef enum SimFleetMessageType
+{
+    SIMFLEET_MSG_ADVANCE = 1, /**< @brief Device to coordinator: all tasks blocked, request to advance to ullTimeMs. */
+    SIMFLEET_MSG_GRANT,       /**< @brief Coordinator to device: advance to ullTimeMs. */
+    SIMFLEET_MSG_END,         /**< @brief Coordinator to device: simulation is over. */
+    SIMFLEET_MSG_TX,          /**< @brief Device to coordinator: frame transmission started at ullTimeMs. */
+    SIMFLEET_MSG_RX,          /**< @brief Device to coordinator: receiver turned on at ullTimeMs, reply is SIMFLEET_MSG_RX_DONE. */
+    SIMFLEET_MSG_RX_DONE,     /**< @brief Coordinator to device: frame received at ullTimeMs, no frame if ucSize is 0. */
+    SIMFLEET_MSG_RX_STOP      /**< @brief Device to coordinator: receiver left on without timeout turned off at ullTimeMs. */
+} SimFleetMessageType_t;
+
+/**
+ * @brief Radio parameters of a transmission or of a receive window.
+ */
+typedef struct SimFleetRadioParams
+{
+    uint32_t ulFrequency;   /**< @brief Frequency in Hz. */
+    uint32_t ulDurationMs;  /**< @brief Time on air, or duration of the receive window, 0 if it stays open. */
+    uint8_t ucSpreadingFactor;
+    uint8_t ucBandwidth;    /**< @brief 0: 125 kHz, 1: 250 kHz, 2: 500 kHz. */
+    uint8_t ucCodingRate;   /**< @brief 1: 4/5 to 4: 4/8. */
+    int8_t cPower;          /**< @brief Transmit power in dBm. */
+} SimFleetRadioParams_t;
+
+/**
+ * @brief Maximum size of a frame carried by a message.
+ */
+#define simfleetMAX_FRAME_SIZE    ( 255 )
+
+/**
+ * @brief Message exchanged over the fleet socket.
+ */
+typedef struct SimFleetMessage
+{
+    uint32_t ulType;                /**< @brief One of SimFleetMessageType_t. */
+    uint64_t ullTimeMs;             /**< @brief Device time the message refers to. */
+    SimFleetRadioParams_t xRadio;   /**< @brief Radio parameters, SIMFLEET_MSG_TX and SIMFLEET_MSG_RX only. */
+    int16_t sRssi;                  /**< @brief Received power in dBm, SIMFLEET_MSG_RX_DONE only. */
+    int8_t cSnr;                    /**< @brief Signal to noise ratio in dB, SIMFLEET_MSG_RX_DONE only. */
+    uint8_t ucSize;                 /**< @brief Size of the frame, SIMFLEET_MSG_TX and SIMFLEET_MSG_RX_DONE only. */
+    uint8_t ucFrame[ simfleetMAX_FRAME_SIZE ];
+} SimFleetMessage_t;
+
+#endif /* SIM_FLEET_PROTOCOL_H */
@@ -27,6 +27,7 @@
 #include "delay.h"
 #include "radio.h"
 #include "sx126x-board.h"
+#include "energy_monitor.h"
 
 /*!
  * Antenna switch GPIO pins objects
@@ -42,6 +43,65 @@ Gpio_t DbgPinTx;
 Gpio_t DbgPinRx;
 #endif
 
+/*!
+ * Set while the receiver is on without timeout, it stays on after a reception
+ */
+static bool RxContinuous = false;
+
+/*!
+ * \brief Reports the radio state a command enters to the energy accounting
+ *
+ * \details The radio returns to standby by itself at the end of a transmission or of a single reception, which the
+ *          driver acknowledges by clearing the interrupt
+ *
+ * \param [IN] command Command sent to the radio
+ * \param [IN] buffer  Parameters of the command
+ * \param [IN] size    Size of the parameters
+ */
+static void SX126xAccountCommand( RadioCommands_t command, uint8_t *buffer, uint16_t size )
+{
+    uint16_t irq;
+
+    switch( command )
+    {
+    case RADIO_SET_SLEEP:
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_SLEEP );
+        break;
+    case RADIO_SET_STANDBY:
+    case RADIO_SET_FS:
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+        break;
+    case RADIO_SET_TX:
+    case RADIO_SET_TXCONTINUOUSWAVE:
+    case RADIO_SET_TXCONTINUOUSPREAMBLE:
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_TX );
+        break;
+    case RADIO_SET_RX:
+        RxContinuous = ( size >= 3 ) && ( buffer[0] == 0xFF ) && ( buffer[1] == 0xFF ) && ( buffer[2] == 0xFF );
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_RX );
+        break;
+    case RADIO_SET_RXDUTYCYCLE:
+    case RADIO_SET_CAD:
+        RxContinuous = false;
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_RX );
+        break;
+    case RADIO_CLR_IRQSTATUS:
+        irq = ( size >= 2 ) ? ( ( ( uint16_t )buffer[0] << 8 ) | buffer[1] ) : 0;
+
+        if( ( irq & ( IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT | IRQ_CAD_DONE ) ) != 0 )
+        {
+            EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+        }
+        else if( ( ( irq & ( IRQ_RX_DONE | IRQ_HEADER_ERROR ) ) != 0 ) && ( RxContinuous == false ) )
+        {
+            EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
+        }
+        break;
+    default:
+        break;
+    }
+}
+
 void SX126xIoInit( void )
 {
     GpioInit( &SX126x.Spi.Nss, RADIO_NSS, PIN_OUTPUT, PIN_PUSH_PULL, PIN_NO_PULL, 1 );
@@ -133,6 +193,8 @@ void SX126xWriteCommand( RadioCommands_t command, uint8_t *buffer, uint16_t size
 
     GpioWrite( &SX126x.Spi.Nss, 1 );
 
+    SX126xAccountCommand( command, buffer, size );
+
     if( command != RADIO_SET_SLEEP )
     {
         SX126xWaitOnBusy( );
@@ -261,6 +323,7 @@ void SX126xReadBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
 void SX126xSetRfTxPower( int8_t power )
 {
     SX126xSetTxParams( power, RADIO_RAMP_40_US );
+    EnergyMonitor_SetTxPower( power );
 }
 
 uint8_t SX126xGetDeviceId( void )
@@ -35,6 +35,7 @@
 #include "systime.h"
 #include "gpio.h"
 #include "rtc-board.h"
+#include "temp_comp.h"
 
 
 
@@ -701,4 +702,13 @@ TimerTime_t RtcTempCompensation( TimerTime_t period, float temperature )
     return ( TimerTime_t ) interim;
 }
 
-#endif
\ No newline at end of file
+#endif
+
+/*
+ * Uses the crystal curve the LoRaWAN layer corrects its time base with, rather than the worst case one above, so that
+ * the timers of LoRaMAC and the local time agree.
+ */
+TimerTime_t RtcTempCompensation( TimerTime_t period, float temperature )
+{
+    return ( TimerTime_t ) TempComp_CompensatePeriod( period, TempComp_GetPpm( temperature ) );
+}
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include "delay.h"
 #include "radio.h"
 #include "sx1276-board.h"
+#include "energy_monitor.h"
 
 /*!
  * \brief Gets the board PA selection configuration
@@ -241,6 +242,9 @@ void SX1276SetRfTxPower( int8_t power )
     }
     SX1276Write( REG_PACONFIG, paConfig );
     SX1276Write( REG_PADAC, paDac );
+
+    // Power actually set, after the limits of the PA
+    EnergyMonitor_SetTxPower( power );
 }
 
 static uint8_t SX1276GetPaSelect( uint32_t channel )
@@ -257,6 +261,12 @@ static uint8_t SX1276GetPaSelect( uint32_t channel )
 
 void SX1276SetAntSwLowPower( bool status )
 {
+    // Called with true when the radio enters sleep mode, SX1276SetAntSw( ) is called for the other modes
+    if( status == true )
+    {
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_SLEEP );
+    }
+
     if( RadioIsActive != status )
     {
         RadioIsActive = status;
@@ -288,12 +298,19 @@ void SX1276SetAntSw( uint8_t opMode )
     {
     case RFLR_OPMODE_TRANSMITTER:
         GpioWrite( &AntSwitch, 1 );
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_TX );
         break;
     case RFLR_OPMODE_RECEIVER:
     case RFLR_OPMODE_RECEIVER_SINGLE:
     case RFLR_OPMODE_CAD:
+        GpioWrite( &AntSwitch, 0 );
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_RX );
+        break;
     default:
+        // Standby and frequency synthesis. The radio also returns to standby by itself at the end of a transmission
+        // or of a single reception, which is accounted when LoRaMAC puts it to sleep right after.
         GpioWrite( &AntSwitch, 0 );
+        EnergyMonitor_SetRadioState( ENERGY_RADIO_STANDBY );
         break;
     }
 }
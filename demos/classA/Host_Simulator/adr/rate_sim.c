@@ -0,0 +1,478 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file rate_sim.c
+ * @brief Rate adaptation simulator for moving devices.
+ *
+ * Moves devices within the cell of a gateway, each from one random waypoint to the next, and sends an uplink from each
+ * device at a fixed interval. The uplinks are received if their power, after a log-normal shadowing drawn for each
+ * frame, is above the sensitivity of their spreading factor, and the same holds for the acknowledgements and the link
+ * check answers sent back in RX1. The link check answers carry the demodulation margin computed as the network server
+ * of the fleet simulator does. The same trace of positions and shadowing is replayed with the rate adaptation of the
+ * demo and with each fixed US915 data rate at full power, to compare the delivery ratio, the airtime and the energy
+ * spent on the air.
+ *
+ * Usage: rate_sim [-n <devices>] [-d <seconds>] [-i <uplink interval seconds>] [-r <radius m>] [-M <speed m/s>]
+ *                 [-f <shadowing dB>] [-x <path loss exponent>] [-l <payload bytes>] [-u] [-s <seed>] [-v]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "rate_adapt.h"
+
+/**
+ * @brief Default simulation parameters.
+ */
+#define ratesimDEFAULT_DEVICES            ( 100U )
+#define ratesimDEFAULT_DURATION_SECONDS   ( 86400U )
+#define ratesimDEFAULT_INTERVAL_SECONDS   ( 60U )
+#define ratesimDEFAULT_RADIUS_M           ( 5000.0 )
+#define ratesimDEFAULT_SPEED_MPS          ( 10.0 )
+#define ratesimDEFAULT_SHADOWING_DB       ( 6.0 )
+#define ratesimDEFAULT_PATH_LOSS_EXPONENT ( 2.7 )
+#define ratesimDEFAULT_PAYLOAD_BYTES      ( 11U )
+#define ratesimDEFAULT_SEED               ( 1U )
+
+/**
+ * @brief Radio of the US915 region: data rates 0 to 3 are SF10 to SF7 at 125 kHz, and RX1 answers on the same spreading
+ * factor at 500 kHz. The device transmits at most 20 dBm, 2 dB less per power index, and the gateway at 27 dBm.
+ */
+#define ratesimDATARATES                  ( 4U )
+#define ratesimMAX_POWER_DBM              ( 20 )
+#define ratesimGATEWAY_POWER_DBM          ( 27 )
+#define ratesimFRAME_OVERHEAD_BYTES       ( 13U )
+#define ratesimPATH_LOSS_REF_DB           ( 31.7 )
+
+/**
+ * @brief Strategies compared: the rate adaptation, then each fixed data rate.
+ */
+#define ratesimSTRATEGIES                 ( 1U + ratesimDATARATES )
+
+/**
+ * @brief Propagation of one uplink of the trace.
+ */
+typedef struct RateSimSlot
+{
+    double dDistanceM;
+    double dUplinkShadowingDb;
+    double dDownlinkShadowingDb;
+} RateSimSlot_t;
+
+/**
+ * @brief Results of a strategy.
+ */
+typedef struct RateSimResult
+{
+    uint64_t ullUplinks;
+    uint64_t ullDelivered;
+    uint64_t ullAirtimeMs;
+    double dEnergyMj;                              /**< @brief Energy radiated, in mJ. */
+    uint64_t ullDataRateUplinks[ ratesimDATARATES ];
+    uint64_t ullLinkChecks;
+    uint64_t ullChanges;
+    uint64_t ullFallbacks;
+} RateSimResult_t;
+
+/**
+ * @brief Simulation parameters.
+ */
+static uint32_t ulDevices = ratesimDEFAULT_DEVICES;
+static uint32_t ulDurationSeconds = ratesimDEFAULT_DURATION_SECONDS;
+static uint32_t ulIntervalSeconds = ratesimDEFAULT_INTERVAL_SECONDS;
+static double dRadiusM = ratesimDEFAULT_RADIUS_M;
+static double dSpeedMps = ratesimDEFAULT_SPEED_MPS;
+static double dShadowingDb = ratesimDEFAULT_SHADOWING_DB;
+static double dPathLossExponent = ratesimDEFAULT_PATH_LOSS_EXPONENT;
+static uint32_t ulPayloadBytes = ratesimDEFAULT_PAYLOAD_BYTES;
+static bool xConfirmed = true;
+static uint64_t ullSeed = ratesimDEFAULT_SEED;
+static bool xVerbose = false;
+
+/**
+ * @brief Demodulation SNR required from SF7 to SF12, as in the network server of the fleet simulator.
+ */
+static const double dRequiredSnr[] = { -7.5, -10.0, -12.5, -15.0, -17.5, -20.0 };
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvRandom( void )
+{
+    /* xorshift64*. */
+    ullSeed ^= ullSeed >> 12;
+    ullSeed ^= ullSeed << 25;
+    ullSeed ^= ullSeed >> 27;
+
+    return ullSeed * 2685821657736338717ULL;
+}
+/*-----------------------------------------------------------*/
+
+static double prvUniform( void )
+{
+    return ( double ) ( prvRandom() >> 11 ) / ( double ) ( 1ULL << 53 );
+}
+/*-----------------------------------------------------------*/
+
+static double prvShadowing( void )
+{
+    /* Box-Muller transform, the first draw must not be 0 for the logarithm. */
+    double dU1 = 1.0 - prvUniform();
+
+    return dShadowingDb * sqrt( -2.0 * log( dU1 ) ) * cos( 2.0 * M_PI * prvUniform() );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRandomPosition( double * pdX,
+                               double * pdY )
+{
+    double dDistanceM = dRadiusM * sqrt( prvUniform() );
+    double dAngle = 2.0 * M_PI * prvUniform();
+
+    *pdX = dDistanceM * cos( dAngle );
+    *pdY = dDistanceM * sin( dAngle );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Draws the trace of a device: its distance to the gateway at each uplink, following the random waypoint model, and
+ * the shadowing of the uplink and of the downlink which may answer it.
+ */
+static void prvMakeTrace( RateSimSlot_t * pxSlots,
+                          uint32_t ulSlots )
+{
+    double dX, dY, dWaypointX, dWaypointY, dStepM, dLegM;
+    uint32_t i;
+
+    prvRandomPosition( &dX, &dY );
+    prvRandomPosition( &dWaypointX, &dWaypointY );
+
+    for( i = 0; i < ulSlots; i++ )
+    {
+        pxSlots[ i ].dDistanceM = hypot( dX, dY );
+        pxSlots[ i ].dUplinkShadowingDb = prvShadowing();
+        pxSlots[ i ].dDownlinkShadowingDb = prvShadowing();
+
+        for( dStepM = dSpeedMps * ( double ) ulIntervalSeconds; dStepM > 0.0; )
+        {
+            dLegM = hypot( dWaypointX - dX, dWaypointY - dY );
+
+            if( dStepM < dLegM )
+            {
+                dX += ( dWaypointX - dX ) * dStepM / dLegM;
+                dY += ( dWaypointY - dY ) * dStepM / dLegM;
+                break;
+            }
+
+            dStepM -= dLegM;
+            dX = dWaypointX;
+            dY = dWaypointY;
+            prvRandomPosition( &dWaypointX, &dWaypointY );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Sends the uplink of a slot, and tells whether the gateway received it and whether the device received the answer.
+ * pdMarginDb is set to the demodulation margin reported in a LinkCheckAns.
+ */
+static bool prvTransmit( const RateSimSlot_t * pxSlot,
+                         uint8_t ucDataRate,
+                         uint8_t ucTxPower,
+                         bool * pxAnswered,
+                         double * pdMarginDb )
+{
+    uint8_t ucSpreadingFactor = ( uint8_t ) ( 10U - ucDataRate );
+    int8_t cPowerDbm = ( int8_t ) ( ratesimMAX_POWER_DBM - ( 2 * ( int ) ucTxPower ) );
+    double dRssiDbm = ChannelRssi( cPowerDbm, pxSlot->dDistanceM ) - pxSlot->dUplinkShadowingDb;
+    double dDownlinkRssiDbm = ChannelRssi( ratesimGATEWAY_POWER_DBM, pxSlot->dDistanceM ) - pxSlot->dDownlinkShadowingDb;
+
+    *pxAnswered = false;
+    *pdMarginDb = floor( ChannelSnr( dRssiDbm, 0 ) - dRequiredSnr[ ucSpreadingFactor - 7U ] );
+
+    if( dRssiDbm < ChannelSensitivity( ucSpreadingFactor, 0 ) )
+    {
+        return false;
+    }
+
+    *pxAnswered = ( dDownlinkRssiDbm >= ChannelSensitivity( ucSpreadingFactor, 2 ) );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Replays the trace of a device with a strategy: the rate adaptation, or the fixed data rate ulStrategy - 1 at full
+ * power.
+ */
+static void prvRunDevice( const RateSimSlot_t * pxSlots,
+                          uint32_t ulSlots,
+                          uint32_t ulStrategy,
+                          RateSimResult_t * pxResult )
+{
+    RateAdapt_t xRate;
+    bool xAdaptive = ( ulStrategy == 0U );
+    bool xLinkCheck, xDelivered, xAnswered;
+    uint8_t ucDataRate = xAdaptive ? 0U : ( uint8_t ) ( ulStrategy - 1U );
+    uint8_t ucTxPower = 0U;
+    uint8_t ucSize;
+    uint32_t ulAirtimeMs;
+    double dMarginDb;
+    uint32_t i;
+
+    /* The device starts as after a join, at the lowest data rate and full power. */
+    RateAdapt_Init( &xRate, 0U, 0U );
+
+    for( i = 0; i < ulSlots; i++ )
+    {
+        xLinkCheck = false;
+        ucSize = ( uint8_t ) ( ratesimFRAME_OVERHEAD_BYTES + ulPayloadBytes );
+
+        if( xAdaptive == true )
+        {
+            xLinkCheck = RateAdapt_OnUplink( &xRate );
+            ucDataRate = xRate.dataRate;
+            ucTxPower = xRate.txPower;
+            ucSize = ( uint8_t ) ( ucSize + ( xLinkCheck ? 1U : 0U ) );
+        }
+
+        xDelivered = prvTransmit( &pxSlots[ i ], ucDataRate, ucTxPower, &xAnswered, &dMarginDb );
+        ulAirtimeMs = ChannelTimeOnAir( ( uint8_t ) ( 10U - ucDataRate ), 0, 1, ucSize, true );
+
+        pxResult->ullUplinks++;
+        pxResult->ullDelivered += xDelivered ? 1U : 0U;
+        pxResult->ullAirtimeMs += ulAirtimeMs;
+        pxResult->dEnergyMj += pow( 10.0, ( double ) ( ratesimMAX_POWER_DBM - ( 2 * ( int ) ucTxPower ) ) / 10.0 ) *
+                               ( double ) ulAirtimeMs / 1000.0;
+        pxResult->ullDataRateUplinks[ ucDataRate ]++;
+
+        if( xAdaptive == false )
+        {
+            continue;
+        }
+
+        if( xLinkCheck == true )
+        {
+            pxResult->ullLinkChecks++;
+
+            if( xDelivered && xAnswered )
+            {
+                RateAdapt_OnLinkCheck( &xRate, ( uint8_t ) ( ( dMarginDb < 0.0 ) ? 0.0 : dMarginDb ), 1U );
+            }
+            else
+            {
+                RateAdapt_OnLinkCheckLost( &xRate );
+            }
+        }
+
+        if( xConfirmed == true )
+        {
+            RateAdapt_OnConfirmed( &xRate, 1U, xDelivered && xAnswered );
+        }
+    }
+
+    pxResult->ullChanges += xRate.changes;
+    pxResult->ullFallbacks += xRate.fallbacks;
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    fprintf( stderr,
+             "Usage: %s [-n <devices>] [-d <seconds>] [-i <uplink interval seconds>] [-r <radius m>] [-M <speed m/s>]\n"
+             "          [-f <shadowing dB>] [-x <path loss exponent>] [-l <payload bytes>] [-u] [-s <seed>] [-v]\n",
+             pcProgram );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvParseOptions( int argc,
+                             char ** argv )
+{
+    int iOption;
+
+    while( ( iOption = getopt( argc, argv, "n:d:i:r:M:f:x:l:us:v" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'n':
+                ulDevices = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'd':
+                ulDurationSeconds = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'i':
+                ulIntervalSeconds = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'r':
+                dRadiusM = strtod( optarg, NULL );
+                break;
+
+            case 'M':
+                dSpeedMps = strtod( optarg, NULL );
+                break;
+
+            case 'f':
+                dShadowingDb = strtod( optarg, NULL );
+                break;
+
+            case 'x':
+                dPathLossExponent = strtod( optarg, NULL );
+                break;
+
+            case 'l':
+                ulPayloadBytes = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'u':
+                xConfirmed = false;
+                break;
+
+            case 's':
+                ullSeed = strtoull( optarg, NULL, 0 );
+                break;
+
+            case 'v':
+                xVerbose = true;
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                break;
+        }
+    }
+
+    if( ( ulDevices == 0U ) || ( ulIntervalSeconds == 0U ) || ( ulDurationSeconds < ulIntervalSeconds ) ||
+        ( ulPayloadBytes > 200U ) || ( ullSeed == 0U ) )
+    {
+        prvUsage( argv[ 0 ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    ChannelParams_t xChannelParams;
+    RateSimResult_t xResults[ ratesimSTRATEGIES ] = { 0 };
+    RateSimSlot_t * pxSlots;
+    uint32_t ulSlots;
+    uint32_t i, j, ulStrategy;
+
+    prvParseOptions( argc, argv );
+
+    xChannelParams.ulDemodulators = 8;
+    xChannelParams.dPathLossRefDb = ratesimPATH_LOSS_REF_DB;
+    xChannelParams.dRefDistanceM = 1.0;
+    xChannelParams.dPathLossExponent = dPathLossExponent;
+    ChannelInit( &xChannelParams );
+
+    ulSlots = ulDurationSeconds / ulIntervalSeconds;
+    pxSlots = malloc( ( size_t ) ulSlots * sizeof( RateSimSlot_t ) );
+
+    if( pxSlots == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( i = 0; i < ulDevices; i++ )
+    {
+        prvMakeTrace( pxSlots, ulSlots );
+
+        for( ulStrategy = 0; ulStrategy < ratesimSTRATEGIES; ulStrategy++ )
+        {
+            RateSimResult_t xDevice = { 0 };
+
+            prvRunDevice( pxSlots, ulSlots, ulStrategy, &xDevice );
+
+            xResults[ ulStrategy ].ullUplinks += xDevice.ullUplinks;
+            xResults[ ulStrategy ].ullDelivered += xDevice.ullDelivered;
+            xResults[ ulStrategy ].ullAirtimeMs += xDevice.ullAirtimeMs;
+            xResults[ ulStrategy ].dEnergyMj += xDevice.dEnergyMj;
+            xResults[ ulStrategy ].ullLinkChecks += xDevice.ullLinkChecks;
+            xResults[ ulStrategy ].ullChanges += xDevice.ullChanges;
+            xResults[ ulStrategy ].ullFallbacks += xDevice.ullFallbacks;
+
+            for( j = 0; j < ratesimDATARATES; j++ )
+            {
+                xResults[ ulStrategy ].ullDataRateUplinks[ j ] += xDevice.ullDataRateUplinks[ j ];
+            }
+
+            if( ( xVerbose == true ) && ( ulStrategy == 0U ) )
+            {
+                printf( "Device %u: PDR %.2f %%, %llu ms on the air, %llu changes, %llu fall-backs.\n", ( unsigned ) i,
+                        100.0 * ( double ) xDevice.ullDelivered / ( double ) xDevice.ullUplinks,
+                        ( unsigned long long ) xDevice.ullAirtimeMs, ( unsigned long long ) xDevice.ullChanges,
+                        ( unsigned long long ) xDevice.ullFallbacks );
+            }
+        }
+    }
+
+    printf( "%u devices at %.1f m/s in a %.0f m cell, shadowing %.1f dB, an uplink of %u bytes every %u s for %u s.\n",
+            ( unsigned ) ulDevices, dSpeedMps, dRadiusM, dShadowingDb, ( unsigned ) ulPayloadBytes,
+            ( unsigned ) ulIntervalSeconds, ( unsigned ) ulDurationSeconds );
+    printf( "%-12s %8s %14s %14s %23s\n", "strategy", "PDR %", "airtime ms/up", "energy mJ/up", "uplinks DR0/DR1/DR2/DR3" );
+
+    for( ulStrategy = 0; ulStrategy < ratesimSTRATEGIES; ulStrategy++ )
+    {
+        const RateSimResult_t * pxResult = &xResults[ ulStrategy ];
+        char cName[ 16 ];
+
+        if( ulStrategy == 0U )
+        {
+            snprintf( cName, sizeof( cName ), "adaptive" );
+        }
+        else
+        {
+            snprintf( cName, sizeof( cName ), "fixed DR%u", ( unsigned ) ( ulStrategy - 1U ) );
+        }
+
+        printf( "%-12s %8.2f %14.1f %14.2f %5.1f/%5.1f/%5.1f/%5.1f %%\n", cName,
+                100.0 * ( double ) pxResult->ullDelivered / ( double ) pxResult->ullUplinks,
+                ( double ) pxResult->ullAirtimeMs / ( double ) pxResult->ullUplinks,
+                pxResult->dEnergyMj / ( double ) pxResult->ullUplinks,
+                100.0 * ( double ) pxResult->ullDataRateUplinks[ 0 ] / ( double ) pxResult->ullUplinks,
+                100.0 * ( double ) pxResult->ullDataRateUplinks[ 1 ] / ( double ) pxResult->ullUplinks,
+                100.0 * ( double ) pxResult->ullDataRateUplinks[ 2 ] / ( double ) pxResult->ullUplinks,
+                100.0 * ( double ) pxResult->ullDataRateUplinks[ 3 ] / ( double ) pxResult->ullUplinks );
+    }
+
+    printf( "Rate adaptation: %.1f link checks, %.1f changes and %.1f fall-backs per device.\n",
+            ( double ) xResults[ 0 ].ullLinkChecks / ( double ) ulDevices,
+            ( double ) xResults[ 0 ].ullChanges / ( double ) ulDevices,
+            ( double ) xResults[ 0 ].ullFallbacks / ( double ) ulDevices );
+
+    free( pxSlots );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Includes for Logging task intiialization. */
+#include "iot_logging_task.h"
+
+/* Includes for the simulated board. */
+#include "sim_clock.h"
+#include "sim-radio.h"
+#include "sim_fleet.h"
+#include "sim_credentials.h"
+#include "energy_monitor.h"
+#include "task_monitor.h"
+
+#include "board_init.h"
+
+/* Logging task runs at the highest priority so that log messages are flushed
+ * before the simulated time advances. */
+#define mainLOGGING_TASK_PRIORITY           ( configMAX_PRIORITIES - 1 )
+#define mainLOGGING_TASK_STACK_SIZE         ( configMINIMAL_STACK_SIZE * 5 )
+#define mainLOGGING_MESSAGE_QUEUE_LENGTH    ( 15 )
+
+/**
+ * @brief Default simulation parameters.
+ */
+#define mainDEFAULT_DURATION_SECONDS        ( 86400UL )
+#define mainDEFAULT_SEED                    ( 1UL )
+
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void );
+
+/**
+ * @brief Prints the simulation summary and exits, invoked when the simulated duration has elapsed.
+ */
+static void prvOnSimulationEnd( void );
+
+/*-----------------------------------------------------------*/
+
+void board_init( int argc,
+                 char ** argv )
+{
+    uint64_t ullDurationSeconds = mainDEFAULT_DURATION_SECONDS;
+    uint32_t ulSeed = mainDEFAULT_SEED;
+    int i;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( ( strcmp( argv[ i ], "-d" ) == 0 ) && ( ( i + 1 ) < argc ) )
+        {
+            ullDurationSeconds = strtoull( argv[ ++i ], NULL, 0 );
+        }
+        else if( ( strcmp( argv[ i ], "-s" ) == 0 ) && ( ( i + 1 ) < argc ) )
+        {
+            ulSeed = ( uint32_t ) strtoul( argv[ ++i ], NULL, 0 );
+        }
+        else if( ( strcmp( argv[ i ], "-f" ) == 0 ) && ( ( i + 1 ) < argc ) )
+        {
+            /* Started by the fleet coordinator, which passes the connected socket. */
+            SimFleetConnect( ( int ) strtol( argv[ ++i ], NULL, 0 ) );
+        }
+        else if( ( strcmp( argv[ i ], "-i" ) == 0 ) && ( ( i + 1 ) < argc ) )
+        {
+            SimCredentialsSelect( ( uint32_t ) strtoul( argv[ ++i ], NULL, 0 ) );
+        }
+        else if( ( strcmp( argv[ i ], "-c" ) == 0 ) && ( ( i + 1 ) < argc ) )
+        {
+            SimClockSetRtcDrift( strtod( argv[ ++i ], NULL ) );
+        }
+        else if( ( strcmp( argv[ i ], "-t" ) == 0 ) && ( ( i + 1 ) < argc ) )
+        {
+            char * pcEnd;
+            double dMeanC = strtod( argv[ ++i ], &pcEnd );
+
+            SimClockSetTemperature( dMeanC, ( *pcEnd == ',' ) ? strtod( pcEnd + 1, NULL ) : 0.0 );
+        }
+        else
+        {
+            fprintf( stderr, "Usage: %s [-d <seconds>] [-s <seed>] [-i <device index>] [-c <RTC drift ppm>] [-t <mean C>[,<swing C>]] [-f <fleet socket>]\n", argv[ 0 ] );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    SimClockInit( ullDurationSeconds * 1000ULL, prvOnSimulationEnd );
+    SimRadioSetSeed( ulSeed );
+
+    xLoggingTaskInitialize( mainLOGGING_TASK_STACK_SIZE,
+                            mainLOGGING_TASK_PRIORITY,
+                            mainLOGGING_MESSAGE_QUEUE_LENGTH );
+}
+/*-----------------------------------------------------------*/
+
+static void prvOnSimulationEnd( void )
+{
+    SimRadioStats_t xStats;
+    SimClockStats_t xClockStats;
+    EnergyReport_t xReport;
+    TaskMonitorReport_t xMonitorReport;
+    uint32_t i;
+
+    SimRadioGetStats( &xStats );
+    SimClockGetStats( &xClockStats );
+    EnergyMonitor_GetReport( &xReport );
+    TaskMonitor_GetReport( &xMonitorReport );
+
+    printf( "\r\n==== Simulation summary ====\r\n" );
+    printf( "Simulated time:      %llu ms\r\n", ( unsigned long long ) SimClockNowMs() );
+    printf( "Frames transmitted:  %lu\r\n", ( unsigned long ) xStats.ulTxCount );
+    printf( "Time on air:         %llu ms\r\n", ( unsigned long long ) xStats.ullTxOnMs );
+    printf( "Receive windows:     %lu\r\n", ( unsigned long ) xStats.ulRxWindowCount );
+    printf( "Frames received:     %lu\r\n", ( unsigned long ) xStats.ulRxCount );
+    printf( "Receiver on time:    %llu ms\r\n", ( unsigned long long ) xStats.ullRxOnMs );
+    printf( "Wakeups:             %lu, %.1f per uplink\r\n", ( unsigned long ) xClockStats.ulWakeups,
+            ( double ) xClockStats.ulWakeups / ( double ) ( ( xStats.ulTxCount > 0U ) ? xStats.ulTxCount : 1U ) );
+    printf( "Tick suppressed:     %llu ms\r\n", ( unsigned long long ) xClockStats.ullSleepMs );
+    printf( "Minimum free heap:   %lu bytes\r\n", ( unsigned long ) xPortGetMinimumEverFreeHeapSize() );
+
+    for( i = 0; i < ( uint32_t ) ENERGY_CATEGORIES; i++ )
+    {
+        printf( "Energy %-13s %.3f uAh\r\n", Energy_GetCategoryName( ( EnergyCategory_t ) i ),
+                ( double ) xReport.chargeUah[ i ] );
+    }
+
+    printf( "Energy per uplink:   %.3f uAh over %lu cycles\r\n",
+            ( double ) xReport.totalUah / ( double ) ( ( xReport.cycles > 0U ) ? xReport.cycles : 1U ),
+            ( unsigned long ) xReport.cycles );
+    printf( "Average current:     %.2f uA\r\n", ( double ) xReport.averageUa );
+    printf( "Battery life:        %.0f days on %u mAh\r\n", ( double ) xReport.batteryDays,
+            ( unsigned ) lorawanConfigENERGY_BATTERY_MAH );
+
+    for( i = 0; i < xMonitorReport.taskCount; i++ )
+    {
+        printf( "Task %-15s %5.1f %% CPU, peak %5.1f %%, %lu bytes of stack free\r\n", xMonitorReport.tasks[ i ].name,
+                ( double ) xMonitorReport.tasks[ i ].averageCpuPermille / 10.0,
+                ( double ) xMonitorReport.tasks[ i ].peakCpuPermille / 10.0,
+                ( unsigned long ) xMonitorReport.tasks[ i ].stackFreeBytes );
+    }
+
+    for( i = 0; i < xMonitorReport.queueCount; i++ )
+    {
+        printf( "Queue %-14s %u of %u messages at most\r\n", xMonitorReport.queues[ i ].pName,
+                ( unsigned ) xMonitorReport.queues[ i ].highWater, ( unsigned ) xMonitorReport.queues[ i ].length );
+    }
+    fflush( stdout );
+
+    exit( EXIT_SUCCESS );
+}
+/*-----------------------------------------------------------*/
+
+bool getTemperature( float * temperature )
+{
+    /* Quantized as the on-die sensors of the boards, 0.25 C. */
+    *temperature = ( float ) ( round( SimClockTemperature() * 4.0 ) / 4.0 );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+void vBoardPrintString( const char * pcString )
+{
+    uint32_t ulLength = ( uint32_t ) strlen( pcString );
+
+    ( void ) fputs( pcString, stdout );
+
+    /* Simulated time does not pass while printing, so the UART time is charged as active time of the MCU. */
+    EnergyMonitor_AddLogBytes( ulLength );
+    EnergyMonitor_AddMcuActive( ( uint32_t ) ( ( float ) ulLength * lorawanConfigENERGY_LOG_US_PER_BYTE ) );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulBoardGetRunTimeCounter( void )
+{
+    struct timespec xNow;
+
+    /* Code takes no simulated time, so the tasks are timed on the host clock, in us. */
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint32_t ) ( ( ( uint64_t ) xNow.tv_sec * 1000000ULL ) + ( ( uint64_t ) xNow.tv_nsec / 1000ULL ) );
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void )
+{
+    SimClockStart();
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIdleHook( void )
+{
+    vSimClockIdleHook();
+}
+/*-----------------------------------------------------------*/
+
+/* configUSE_STATIC_ALLOCATION is set to 1, so the application must provide an
+ * implementation of vApplicationGetIdleTaskMemory() to provide the memory that is
+ * used by the Idle task. */
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    uint32_t * pulIdleTaskStackSize )
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+/*-----------------------------------------------------------*/
+
+/* configUSE_STATIC_ALLOCATION is set to 1, so the application must provide an
+ * implementation of vApplicationGetTimerTaskMemory() to provide the memory that is
+ * used by the RTOS daemon/time task. */
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     uint32_t * pulTimerTaskStackSize )
+{
+    static StaticTask_t xTimerTaskTCB;
+    static StackType_t uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
+
+    *ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = uxTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationMallocFailedHook( void )
+{
+    fprintf( stderr, "Malloc failed at %llu ms.\n", ( unsigned long long ) SimClockNowMs() );
+    abort();
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * pcFile,
+                    unsigned long ulLine )
+{
+    fprintf( stderr, "Assert failed at %s:%lu, simulated time %llu ms.\n",
+             pcFile, ulLine, ( unsigned long long ) SimClockNowMs() );
+    abort();
+}
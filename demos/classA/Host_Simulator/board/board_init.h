@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef BOARD_INIT_H
+#define BOARD_INIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Initializes the host simulator.
+ *
+ * Parses the simulation options from the command line, sets up the virtual clock and the simulated radio, and
+ * creates the logging task. Supported options:
+ *  -d <seconds>  Simulated duration, after which a summary is printed and the process exits. Default 86400.
+ *  -s <seed>     Seed of the simulated radio random number generator. Default 1.
+ *  -i <index>    Index of the device in the fleet, from which its credentials are derived. Default 0.
+ *  -c <ppm>      Frequency error of the simulated RTC crystal. Default 0.
+ *  -t <C>[,<C>]  Mean temperature of the simulated RTC crystal and amplitude of its daily variation. Default 25,0.
+ *  -f <socket>   Socket connected to the fleet coordinator, passed by the coordinator when it starts the device.
+ */
+void board_init( int argc,
+                 char ** argv );
+
+/**
+ * @brief Reads the temperature of the simulated RTC crystal, see lorawanConfigGET_TEMPERATURE.
+ */
+bool getTemperature( float * temperature );
+
+/**
+ * @brief Writes a log message to the standard output, see configPRINT_STRING. The time the boards would spend sending
+ * it over their UART is accounted in the energy drawn.
+ */
+void vBoardPrintString( const char * pcString );
+
+/**
+ * @brief Reads the counter of the run time statistics of the tasks, see portGET_RUN_TIME_COUNTER_VALUE.
+ */
+uint32_t ulBoardGetRunTimeCounter( void );
+
+#endif /* BOARD_INIT_H */
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * Credentials of the host simulator, used instead of demos/classA/common/credentials.c. They are derived from
+ * the index of the device in the fleet, see sim_credentials.h, and match the ones the network server stand-in
+ * of the fleet simulator is provisioned with. Only OTAA is supported by the network server stand-in.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "sim_credentials.h"
+
+/**
+ * @brief End device address, only used for ABP activation.
+ */
+#define END_DEVICE_ADDR    ( ( uint32_t ) ( 0x0 ) )
+
+void getDeviceEUI( uint8_t * param )
+{
+    SimCredentials_t xCredentials;
+
+    SimCredentialsGet( &xCredentials );
+    memcpy( param, xCredentials.ucDevEui, sizeof( xCredentials.ucDevEui ) );
+}
+
+void getJoinEUI( uint8_t * param )
+{
+    SimCredentials_t xCredentials;
+
+    SimCredentialsGet( &xCredentials );
+    memcpy( param, xCredentials.ucJoinEui, sizeof( xCredentials.ucJoinEui ) );
+}
+
+void getAppKey( uint8_t * param )
+{
+    SimCredentials_t xCredentials;
+
+    SimCredentialsGet( &xCredentials );
+    memcpy( param, xCredentials.ucAppKey, sizeof( xCredentials.ucAppKey ) );
+}
+
+uint32_t getDeviceAddress( void )
+{
+    return END_DEVICE_ADDR;
+}
+
+void getGetAppSessionKey( uint8_t * param )
+{
+    getAppKey( param );
+}
+
+
+void getGetNwkSessionKey( uint8_t * param )
+{
+    getAppKey( param );
+}
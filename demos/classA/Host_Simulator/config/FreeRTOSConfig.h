@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/*-----------------------------------------------------------
+* Application specific definitions for the host simulator, built with the
+* FreeRTOS POSIX/Linux port.
+*
+* See http://www.freertos.org/a00110.html.
+*----------------------------------------------------------*/
+
+#include <stdio.h>
+
+#define configSUPPORT_STATIC_ALLOCATION              1
+#define configSUPPORT_DYNAMIC_ALLOCATION             1
+
+#define configUSE_PREEMPTION                         1
+#define configUSE_IDLE_HOOK                          1
+#define configUSE_TICK_HOOK                          0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK           1
+#define configTICK_RATE_HZ                           1000
+#define configMAX_PRIORITIES                         ( 7 )
+#define configMINIMAL_STACK_SIZE                     ( ( unsigned short ) 4096 )
+#define configTOTAL_HEAP_SIZE                        ( ( size_t ) ( 256 * 1024 ) )
+#define configMAX_TASK_NAME_LEN                      ( 16 )
+#define configUSE_TRACE_FACILITY                     1
+#define configUSE_16_BIT_TICKS                       0
+#define configIDLE_SHOULD_YIELD                      1
+#define configUSE_MUTEXES                            1
+#define configQUEUE_REGISTRY_SIZE                    8
+#define configCHECK_FOR_STACK_OVERFLOW               0
+#define configUSE_RECURSIVE_MUTEXES                  1
+#define configUSE_MALLOC_FAILED_HOOK                 1
+#define configUSE_APPLICATION_TASK_TAG               1
+#define configUSE_COUNTING_SEMAPHORES                1
+#define configGENERATE_RUN_TIME_STATS                1
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES                        0
+#define configMAX_CO_ROUTINE_PRIORITIES              ( 2 )
+
+/* Software timer definitions. */
+#define configUSE_TIMERS                             1
+#define configTIMER_TASK_PRIORITY                    ( configMAX_PRIORITIES - 2 )
+#define configTIMER_QUEUE_LENGTH                     10
+#define configTIMER_TASK_STACK_DEPTH                 ( configMINIMAL_STACK_SIZE * 6 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+ * to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet                     1
+#define INCLUDE_uxTaskPriorityGet                    1
+#define INCLUDE_vTaskDelete                          1
+#define INCLUDE_vTaskCleanUpResources                0
+#define INCLUDE_vTaskSuspend                         1
+#define INCLUDE_vTaskDelayUntil                      1
+#define INCLUDE_vTaskDelay                           1
+#define INCLUDE_uxTaskGetStackHighWaterMark          1
+#define INCLUDE_xTaskGetSchedulerState               1
+#define INCLUDE_xTaskGetCurrentTaskHandle            1
+#define INCLUDE_xTaskGetIdleTaskHandle               1
+
+/* Time is simulated. The tick only advances when all tasks are blocked: the idle
+ * task jumps the tick count to the next task unblock time or to the next simulation
+ * event, whichever is earlier. See boards/Host_Simulator/sim_clock.h. */
+#define configUSE_TICKLESS_IDLE                      2
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP        2
+
+extern void vSimClockSuppressTicksAndSleep( unsigned long xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )    vSimClockSuppressTicksAndSleep( xExpectedIdleTime )
+
+/* Simulation events run in interrupt context from the point of view of the
+ * application, the POSIX port does not provide this function. */
+extern long SimClockIsInsideInterrupt( void );
+#define xPortIsInsideInterrupt()    SimClockIsInsideInterrupt()
+
+/* Run time statistics of the tasks for the task monitor, counted on the host
+ * clock in us as code takes no simulated time. */
+extern uint32_t ulBoardGetRunTimeCounter( void );
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()    ulBoardGetRunTimeCounter()
+
+/* Normal assert() semantics without relying on the provision of an assert.h
+ * header file. */
+extern void vAssertCalled( const char * pcFile,
+                           unsigned long ulLine );
+#define configASSERT( x )    if( ( x ) == 0 ) vAssertCalled( __FILE__, __LINE__ )
+
+/* Logging task definitions. */
+void vLoggingPrintf( const char * pcFormat,
+                     ... );
+
+/* Map the FreeRTOS printf() to the logging task printf. */
+#define configPRINTF( x )          vLoggingPrintf x
+
+/* Map the logging task's printf to the standard output, through the board so that the console is accounted like the
+ * UART of the boards. */
+void vBoardPrintString( const char * pcString );
+#define configPRINT_STRING( x )    vBoardPrintString( x )
+
+/* Sets the length of the buffers into which logging messages are written - so
+ * also defines the maximum length of each log message. */
+#define configLOGGING_MAX_MESSAGE_LENGTH            160
+
+/* Set to 1 to prepend each log message with a message number, the task name,
+ * and a time stamp. */
+#define configLOGGING_INCLUDE_TIME_AND_TASK_NAME    1
+
+/* Set to a number of messages to format the log messages into as many static
+ * buffers, with the queues and the task of the logging also allocated statically,
+ * instead of taking a buffer from the heap for each message. With
+ * lorawanConfigSTATIC_ALLOCATION, the heap is then no longer used after the
+ * initialization. Set to 0 to use the heap. */
+#define configLOGGING_STATIC_BUFFERS                0
+
+/* The platform FreeRTOS is running on. */
+#define configPLATFORM_NAME    "HostSimulator"
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef LORAWAN_CONFIG_H
+#define LORAWAN_CONFIG_H
+
+/**
+ * @brief Device EUI is a globaly Unique identifier used to identify the devices across LoRaWAN networks.
+ * Device EUI is a 64 bit value and returned as an array of 8 hex byte values in big endian form.
+ * Example: { 0x11, 0x22, 0x33, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE }
+ *
+ * Note: If the device EUI is pre-provisioned using a secure element, remove this config parameter to use the pre-provisioned value.
+ */
+extern void getDeviceEUI( uint8_t * deviceEUI );
+#define lorawanConfigGET_DEV_EUI    getDeviceEUI
+
+/**
+ * @brief IN EUI or APP EUI is a globaly Unique identifier used to identify the application this device is associated with..
+ * Join EUI is a 64 bit value and returned as an array of 8 hex values in big endian form.
+ * Example: { 0x11, 0x22, 0x33, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE }
+ *
+ * Note: If the join EUI is pre-provisioned using a secure element, remove this config parameter to use the pre-provisioned value.
+ */
+extern void getJoinEUI( uint8_t * joinEUI );
+#define lorawanConfigGET_JOIN_EUI    getJoinEUI
+
+
+/**
+ * @brief App key is used to derive session keys used for OTAA join session.
+ * App key is a 128 bit value and returned as an array of 16 hex values in big endian form.
+ *
+ * Note: If the App key is pre-provisioned using a secure element, remove this config parameter to use the pre-provisioned value.
+ */
+extern void getAppKey( uint8_t * appKey );
+#define lorawanConfigGET_APP_KEY    getAppKey
+
+/**
+ * @brief End-device address which is only used for ABP join .
+ *
+ */
+extern uint32_t getDeviceAddress( void );
+#define lorawanConfigGET_DEV_ADDR    getDeviceAddress
+
+/**
+ * @brief Application Session key to be configured beforehand, only required for ABP join.
+ * Application session key is a 128 bit value and returned as an array of 16 hex values in big endian form.
+ *
+ *  Note: If the application session key is pre-provisioned using a secure element, remove this config parameter to use the pre-provisioned value.
+ */
+extern void getGetAppSessionKey( uint8_t * appSessionKey );
+#define lorawanConfigGET_APP_SESSION_KEY    getGetAppSessionKey
+
+/**
+ * @brief Network session key to be configured beforehand, only required for ABP join.
+ * Network session key is a 128 bit value and returned as an array of 16 hex values in big endian form.
+ *
+ *  Note: If the network session key is pre-provisioned using a secure element, remove this config parameter to use the pre-provisioned value.
+ */
+extern void getGetNwkSessionKey( uint8_t * nwkSessionKey );
+#define lorawanConfigGET_NETWORK_SESSION_KEY    getGetNwkSessionKey
+
+/*
+ * @brief The version of LoRaWAN stack on Network Server, to be configured beforehand, only required for ABP activation.
+ * Version is set by default to 1.0.3.0.
+ */
+#define lorawanConfigABP_LORAWAN_VERSION        0x01000300
+
+/*
+ * @brief LoRaWAN network ID, only required for ABP activation.
+ */
+#define lorawanConfigNETWORK_ID                 ( ( uint32_t ) ( 0 ) )
+
+/**
+ * @brief Flag to indicate if application is using a public network such
+ * as The Things Network.
+ */
+#define lorawanConfigPUBLIC_NETWORK             ( 1 )
+
+
+/**
+ * @brief Maximum join attempts before giving up.
+ *
+ * Retry attempts tries to send join requests in different channels thereby finding a suitable gateway which
+ * is tuned to that channel.
+ */
+#define lorawanConfigMAX_JOIN_ATTEMPTS    ( 1000 )
+
+
+/**
+ * @brief Interval between retry attempts for OTAA join.
+ * It waits for a retry interval +- random jitter ( to avoid dos ) before attempting to
+ * join again with LoRaWAN network.
+ */
+#define lorawanConfigJOIN_RETRY_INTERVAL_MS    ( 2000 )
+
+
+/**
+ * @brief Defines a random jitter bound in milliseconds for application data transmission duty cycle.
+ *
+ * This allows devices to space their transmissions slighltly between each other in cases like all devices reboots and tries to
+ * join server at same time.
+ */
+#define lorawanConfigMAX_JITTER_MS    ( 500 )
+
+
+
+/**
+ * @brief Default config to enable or disable adaptive data rate.
+ *
+ * Enabling adaptive data rate allows the network to set optimized data rates for end devices
+ * thereby optimizing on air time and power consumption. Its recommended to enable adaptive
+ * data rate for static devices and devices with stable RF conditions.
+ * Adaptive data rate can be toggled runtime using API.
+ *
+ */
+#define lorawanConfigADR_ON    ( 1 )
+
+
+/**
+ * @brief Default config to set the number of retries of a failed send attempt.
+ *
+ */
+#define lorawanConfigMAX_SEND_RETRIES    ( 8 )
+
+
+/**
+ * @brief Overall timing error threshold for the system.
+ */
+#define lorawanConfigRX_MAX_TIMING_ERROR    ( 50 )
+
+
+/**
+ * @brief Maximum payload length defined by LoRaWAN spec
+ *
+ * This can be used to cap the maximum packet size that can be transferred anytime by the application.
+ * LoRaWAN payload can vary upto 222 bytes. However applications should take care of duty cycle restrictions and
+ * fair access policies for each region while determining the size of a message to be transmitted.
+ * Larger messages leads to longer air-time and increased power consumption for the
+ * radio as well as using up all of the duty cycle for a channel.
+ */
+#define lorawanConfigMAX_MESSAGE_SIZE    ( 222 )
+
+
+/**
+ * @brief Size of the queue of the commands sent to the LoRaMAC task.
+ * The calls to the API which use LoRaMAC are run by the LoRaMAC task, so that LoRaMAC is never entered from two tasks,
+ * and each caller waits for its command and for the confirm of its own request. The queue holds a command of each
+ * task which may call the API at the same time.
+ */
+#define lorawanConfigCOMMAND_QUEUE_SIZE     ( 2 )
+
+/**
+ * @breif Queue size for downlink data.
+ *
+ * Class A application sends an uplink and then polls for downlink messages, the next two receive windows. Only one message is sent
+ * by downlink server for each uplink. Hence setting the queue size to 1.
+ */
+#define lorawanConfigDOWNLINK_QUEUE_SIZE    ( 1 )
+
+/**
+ * @brief Ports which can have a subscription of their own, see LoRaWAN_SubscribePort().
+ */
+#define lorawanConfigMAX_PORT_SUBSCRIPTIONS    ( 4 )
+
+/**
+ * @breif Queue size for downlink events.
+ *
+ * For class A application at most 4 events can be received downlink per uplink at any time (SRV_MAC_LINK_CHECK_ANS, SRV_MAC_DEVICE_TIME_ANS, FRAME LOSS, DOWNLINK DATA)
+ * Queue size can be adjusted based on application needs.
+ */
+#define lorawanConfigEVENT_QUEUE_SIZE       ( 4 )
+
+
+
+/**
+ * @brief Stack size for LoRaMAC task.
+ * Set to a reasonable size as required for LoRaMAC layer functions.
+ */
+#define lorawanConfigLORAMAC_TASK_STACK_SIZE    ( 2048 )
+
+/**
+ * @brief Priority for LoRaMAC task.
+ * LoRaMAC task is set to wake up on interrupts from radio layer and needs to process
+ * radio interrupts as soon as possible. Hence setting to the max possible priority.
+ */
+#define lorawanConfigLORAMAC_TASK_PRIORITY      ( configMAX_PRIORITIES - 1 )
+
+/**
+ * @brief Set to 1 to allocate the task and the queues of the LoRaWAN layer and the LoRaMAC timers from static storage,
+ * so that they take no heap. Requires configSUPPORT_STATIC_ALLOCATION. See also configLOGGING_STATIC_BUFFERS.
+ */
+#define lorawanConfigSTATIC_ALLOCATION          ( 0 )
+
+/**
+ * @brief Timers in the pool of the timer events: 4 for LoRaMAC, 3 for class B, up to 3 for the radio driver and 5 for the
+ * LoRaWAN layer, with some spare. The timers beyond are taken from the heap, or are an error with
+ * lorawanConfigSTATIC_ALLOCATION.
+ */
+#define lorawanConfigMAX_TIMERS                 ( 16 )
+
+/**
+ * @brief Period in seconds at which the task monitor samples the CPU share and the stack headroom of the tasks, the
+ * free heap and the fill of the queues of the LoRaWAN layer. Set to 0 to disable the monitor. The CPU shares require
+ * configGENERATE_RUN_TIME_STATS.
+ */
+#define lorawanConfigMONITOR_PERIOD_SEC         ( 60 )
+
+/**
+ * @brief Tasks and queues followed by the task monitor. A sample is skipped while there are more tasks.
+ */
+#define lorawanConfigMONITOR_MAX_TASKS          ( 8 )
+#define lorawanConfigMONITOR_MAX_QUEUES         ( 4 )
+
+
+/**
+ * @brief Maximum error of a device time synchronization in milliseconds.
+ *
+ * Covers the 1/256 second resolution of DeviceTimeAns and the timing error of the end of the uplink it refers to.
+ */
+#define lorawanConfigGPS_TIME_SYNC_ERROR_MS          ( 10 )
+
+/**
+ * @brief Frequency tolerance of the RTC crystal in ppm, used as the drift uncertainty until the drift is measured.
+ */
+#define lorawanConfigGPS_TIME_CLOCK_TOLERANCE_PPM    ( 50 )
+
+/**
+ * @brief Error bound in milliseconds at which the GPS time is resynchronized.
+ *
+ * When the error bound of LoRaWAN_GetGpsTime() reaches this value, LoRaWAN_Send() piggybacks a DeviceTimeReq on the
+ * next uplink, so resynchronizations get rarer as the drift estimate improves and cost no extra uplink.
+ * Set to 0 to only synchronize on LoRaWAN_RequestDeviceTimeSync().
+ */
+#define lorawanConfigGPS_TIME_TARGET_ERROR_MS        ( 100 )
+
+/**
+ * @brief Bounds of the interval between two automatic resynchronizations, in seconds.
+ */
+#define lorawanConfigGPS_TIME_MIN_RESYNC_SEC         ( 600 )
+#define lorawanConfigGPS_TIME_MAX_RESYNC_SEC         ( 604800 )
+
+/**
+ * @brief Rate in ppm at which the offset found by a synchronization is slewed into the GPS time.
+ */
+#define lorawanConfigGPS_TIME_SLEW_PPM               ( 500 )
+
+/**
+ * @brief Length in milliseconds of an uplink slot, see LoRaWAN_GetUplinkSlotDelay().
+ *
+ * A slot must fit the time on air of an uplink plus twice the error bound of the GPS time, so that devices in adjacent
+ * slots never overlap. 1000 ms fits an 11 byte uplink at DR_0 in US915, about 370 ms on air, with an error bound of up
+ * to 300 ms.
+ */
+#define lorawanConfigUPLINK_SLOT_MS    ( 1000 )
+
+/**
+ * @brief Ping slot periodicity requested by LoRaWAN_SetDeviceClass() for class B, from 0 to 7.
+ *
+ * The device opens a ping slot every 2^periodicity seconds, which bounds the downlink latency in class B. Each ping slot
+ * without a downlink costs a receive window of a few symbols, so the receiver energy doubles with each step down.
+ */
+#define lorawanConfigCLASS_B_PING_SLOT_PERIODICITY    ( 1 )
+
+/**
+ * @brief Application port of the remote multicast setup package (LoRaWAN TS005), 0 to leave the port to the application.
+ *
+ * Frames received on this port are handled by the LoRaWAN stack to set up multicast groups and schedule their class B or
+ * class C sessions, and are not queued for LoRaWAN_Receive().
+ */
+#define lorawanConfigREMOTE_MULTICAST_SETUP_PORT    ( 200 )
+
+/**
+ * @brief Application port of the fragmented data block transport package (LoRaWAN TS004), 0 to leave the port to the
+ * application.
+ *
+ * The fragments received on this port are decoded into the storage set with LoRaWAN_SetDataBlockStorage(), and are not
+ * queued for LoRaWAN_Receive().
+ */
+#define lorawanConfigFRAGMENTATION_PORT    ( 201 )
+
+/**
+ * @brief Largest data block accepted by the fragmentation package, in fragments of at most lorawanConfigFRAG_MAX_SIZE bytes.
+ */
+#define lorawanConfigFRAG_MAX_NB           ( 2048 )
+#define lorawanConfigFRAG_MAX_SIZE         ( 232 )
+
+/**
+ * @brief Largest number of fragments of a block which can be lost and recovered by forward error correction.
+ *
+ * The decoder keeps a square bit matrix of this size in RAM, the fragments themselves are decoded in the storage.
+ */
+#define lorawanConfigFRAG_MAX_REDUNDANCY    ( 128 )
+
+/**
+ * @brief Size of the page buffer used to apply a delta patch, the new image is written in chunks of this size.
+ *
+ * A multiple of the flash page size avoids rewriting a page twice.
+ */
+#define lorawanConfigDELTA_PAGE_SIZE    ( 2048 )
+
+/**
+ * @brief Rejoin-Request attempts of LoRaWAN_Rejoin() before giving up.
+ */
+#define lorawanConfigMAX_REJOIN_ATTEMPTS    ( 3 )
+
+/**
+ * @brief Periodic Rejoin-Requests of type 0, with the encoding of RejoinParamSetupReq: one every 2^( MaxTimeN + 10 )
+ * seconds or every 2^( MaxCountN + 4 ) uplinks, whichever comes first. 7 and 6 give 36 hours and 1024 uplinks.
+ *
+ * Networks before LoRaWAN 1.1 do not answer Rejoin-Requests, keep them disabled with such networks.
+ */
+#define lorawanConfigREJOIN_PERIODIC       ( 0 )
+#define lorawanConfigREJOIN_MAX_TIME_N     ( 7 )
+#define lorawanConfigREJOIN_MAX_COUNT_N    ( 6 )
+
+/**
+ * @brief Period of the Rejoin-Requests of type 1 in seconds, 0 to disable them.
+ *
+ * A type 1 rejoin goes through the join server, it restores the session of a device the network lost the context of.
+ */
+#define lorawanConfigREJOIN_TYPE_1_PERIOD_SEC    ( 0 )
+
+/**
+ * @brief Set to 1 to let the LoRaWAN layer send the uplinks the network waits for, MAC command answers or a pending
+ * downlink, rather than reporting LORAWAN_EVENT_DOWNLINK_PENDING to the application.
+ *
+ * The MAC answers ride on the next application uplink if one is expected within lorawanConfigPIGGYBACK_WINDOW_MS,
+ * otherwise an empty unconfirmed frame is sent as soon as the duty cycle allows, see LoRaWAN_GetPiggybackStats().
+ */
+#define lorawanConfigUPLINK_PIGGYBACK    ( 1 )
+
+/**
+ * @brief Longest time in milliseconds the MAC answers wait for an application uplink, from the downlink which asked
+ * for them. A longer window saves more frames and delays more the downlinks the network holds back.
+ */
+#define lorawanConfigPIGGYBACK_WINDOW_MS    ( 120000 )
+
+/**
+ * @brief Number of frames in the rolling window of the link quality estimator, see LoRaWAN_GetLinkStats().
+ */
+#define lorawanConfigLINK_QUALITY_WINDOW    ( 32 )
+
+/**
+ * @brief Weight of a new sample in the averages of the link quality, between 0 and 1. 0.25 follows a change of the link
+ * within about 8 frames.
+ */
+#define lorawanConfigLINK_QUALITY_EWMA_WEIGHT    ( 0.25f )
+
+/**
+ * @brief Device side rate adaptation, see LoRaWAN_SetRateAdaptation() and rate_adapt.h.
+ *
+ * Uplinks between two LinkCheckReq, margin in dB kept above the demodulation floor, lowered when several gateways
+ * receive the device, margin beyond which the data rate is raised or the power lowered, and frames lost in a row which
+ * trigger the fall back to full power and a lower data rate.
+ */
+#define lorawanConfigRATE_LINK_CHECK_PERIOD       ( 4 )
+#define lorawanConfigRATE_MARGIN_DB               ( 10 )
+#define lorawanConfigRATE_GATEWAY_DIVERSITY_DB    ( 2 )
+#define lorawanConfigRATE_HYSTERESIS_DB           ( 3 )
+#define lorawanConfigRATE_FALLBACK_LOSSES         ( 2 )
+
+/**
+ * @brief Data rates and transmit power indexes used by the device side rate adaptation. In US915 DR_0 to DR_3 are the
+ * 125 kHz data rates, SF10 to SF7, and each power index is 2 dB below the previous one.
+ */
+#define lorawanConfigRATE_MIN_DATARATE            ( 0 )
+#define lorawanConfigRATE_MAX_DATARATE            ( 3 )
+#define lorawanConfigRATE_MAX_TX_POWER            ( 5 )
+
+/**
+ * @brief Adaptive retransmissions. When set, the trials of a confirmed uplink and the repetitions (NbTrans) of an
+ * unconfirmed one are chosen for each message from the packet error rate measured on the recent confirmed uplinks, so that
+ * the message gets through with the probability given by its reliability. 0 sends the confirmed uplinks with
+ * lorawanConfigMAX_SEND_RETRIES trials and the unconfirmed ones with the NbTrans set by the network.
+ */
+#define lorawanConfigADAPTIVE_RETRANSMISSION    ( 1 )
+
+/**
+ * @brief Reliability, in percent, of the messages sent with a reliability of 0.
+ */
+#define lorawanConfigDEFAULT_RELIABILITY        ( 90 )
+
+/**
+ * @brief Most transmissions of an unconfirmed uplink, LoRaWAN allows up to 15.
+ */
+#define lorawanConfigMAX_NB_TRANS               ( 3 )
+
+/**
+ * @brief Transmissions of confirmed uplinks needed in the link quality window before the packet error rate is used. Until
+ * then the confirmed uplinks get lorawanConfigMAX_SEND_RETRIES trials and the unconfirmed ones no extra repetition.
+ */
+#define lorawanConfigRETRANSMIT_MIN_SAMPLES     ( 8 )
+
+/**
+ * @brief Calibration of the receive windows. When set, the timing error and the preamble symbols given to LoRaMAC are
+ * derived from the offsets measured on the received downlinks, instead of the worst case lorawanConfigRX_MAX_TIMING_ERROR,
+ * which stays the upper bound and the fallback.
+ */
+#define lorawanConfigRX_TIMING_CALIBRATION        ( 1 )
+
+/**
+ * @brief Downlinks the timing statistics are computed over, and the number needed before the error is lowered.
+ */
+#define lorawanConfigRX_CALIBRATION_WINDOW        ( 16 )
+#define lorawanConfigRX_CALIBRATION_MIN_SAMPLES   ( 4 )
+
+/**
+ * @brief Lowest timing error in ms, and margin in ms added to the measured one.
+ */
+#define lorawanConfigRX_MIN_TIMING_ERROR          ( 3 )
+#define lorawanConfigRX_CALIBRATION_GUARD_MS      ( 2 )
+
+/**
+ * @brief Windows missed in a row, such as unacknowledged confirmed uplinks, after which the measured offsets are dropped.
+ */
+#define lorawanConfigRX_CALIBRATION_MAX_MISSED    ( 3 )
+
+/**
+ * @brief Preamble symbols a receive window covers, one more for each window missed in a row.
+ */
+#define lorawanConfigRX_MIN_SYMBOLS               ( 6 )
+
+/**
+ * @brief Largest crystal drift against the network in ppm the measurements are trusted with.
+ */
+#define lorawanConfigRX_MAX_DRIFT_PPM             ( 100 )
+
+/**
+ * @brief Temperature compensation of the 32 kHz crystal. When set, the temperature given by
+ * lorawanConfigGET_TEMPERATURE is sampled every lorawanConfigTEMP_SAMPLE_PERIOD_SEC seconds, the local time base is
+ * corrected for the frequency error of the crystal at that temperature, and the timers of the LoRaWAN layer and of
+ * LoRaMAC are compensated through TimerTempCompensation().
+ */
+#define lorawanConfigTEMP_COMPENSATION            ( 1 )
+#define lorawanConfigTEMP_SAMPLE_PERIOD_SEC       ( 60 )
+
+/**
+ * @brief Reads the on-die temperature sensor, in degrees Celsius. Returns false if the sensor cannot be read.
+ */
+extern bool getTemperature( float * temperature );
+#define lorawanConfigGET_TEMPERATURE              getTemperature
+
+/**
+ * @brief Parabolic model of the crystal: the frequency error in ppm is lorawanConfigTEMP_COMP_OFFSET_PPM plus
+ * lorawanConfigTEMP_COMP_COEFFICIENT times the square of the distance to lorawanConfigTEMP_COMP_TURNOVER in degrees
+ * Celsius. The defaults are the nominal values of a tuning fork crystal, as RTC_TEMP_COEFFICIENT and RTC_TEMP_TURNOVER
+ * of rtc-board.h. The offset is the error of the unit at the turnover, measured in production.
+ */
+#define lorawanConfigTEMP_COMP_COEFFICIENT        ( -0.035f )
+#define lorawanConfigTEMP_COMP_TURNOVER           ( 25.0f )
+#define lorawanConfigTEMP_COMP_OFFSET_PPM         ( 0.0f )
+
+/**
+ * @brief Energy accounting. The currents in uA drawn by the MCU running and in its low power mode, by the radio in each
+ * state, and by the SPI and the console while they transfer, are charged over the time measured in each state, see
+ * energy.h. The simulated device mirrors the Nordic board: nRF52840 at 64 MHz and SX1262, both with the DC/DC
+ * converter.
+ */
+#define lorawanConfigENERGY_MCU_RUN_UA            ( 6300.0f )
+#define lorawanConfigENERGY_MCU_SLEEP_UA          ( 3.2f )
+#define lorawanConfigENERGY_RADIO_SLEEP_UA        ( 1.2f )
+#define lorawanConfigENERGY_RADIO_STANDBY_UA      ( 800.0f )
+#define lorawanConfigENERGY_RADIO_RX_UA           ( 4600.0f )
+
+/**
+ * @brief Current drawn in transmission, as { power in dBm, current in uA } points in increasing power, interpolated.
+ */
+#define lorawanConfigENERGY_TX_POWER_POINTS       { { 14, 45000.0f }, { 17, 58000.0f }, { 20, 84000.0f }, { 22, 118000.0f } }
+
+/**
+ * @brief Time the MCU spends sending a byte over the SPI, with the driver exchanging one byte per call, and over the
+ * console at 115200 baud, with the extra current drawn by the peripheral meanwhile.
+ */
+#define lorawanConfigENERGY_SPI_US_PER_BYTE       ( 10.0f )
+#define lorawanConfigENERGY_SPI_UA                ( 50.0f )
+#define lorawanConfigENERGY_LOG_US_PER_BYTE       ( 86.8f )
+#define lorawanConfigENERGY_LOG_UA                ( 300.0f )
+
+/**
+ * @brief Time the MCU runs at each wakeup, used where the running time cannot be measured, as on the host simulator.
+ */
+#define lorawanConfigENERGY_WAKEUP_US             ( 500U )
+
+/**
+ * @brief Capacity of the battery the life is projected for, in mAh.
+ */
+#define lorawanConfigENERGY_BATTERY_MAH           ( 2400.0f )
+
+
+#endif /* LORAWAN_CONFIG_H */
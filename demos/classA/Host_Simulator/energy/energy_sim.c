@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file energy_sim.c
+ * @brief Energy projection of a class A device.
+ *
+ * Replays the uplink cycles of the demo in US915 through the energy accounting of the boards, energy.c with the
+ * currents of the configuration: the radio configured in standby, the transmission of each repetition, the two receive
+ * windows with no downlink, the SPI transfers and the logs, and the MCU asleep in between with a fixed active time per
+ * wakeup. Prints the charge of a cycle per category, the average current and the projected battery life, or with -a
+ * compares them across the data rates and the number of transmissions.
+ *
+ * Usage: energy_sim [-r <data rate>] [-n <transmissions>] [-i <interval s>] [-p <payload bytes>] [-P <power dBm>]
+ *                   [-e <receive window error ms>] [-l <log bytes per uplink>] [-w <wakeups per uplink>] [-d <days>] [-a]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "energy.h"
+
+/**
+ * @brief Default simulation parameters, those of the demo.
+ */
+#define esimDEFAULT_DATARATE        ( 0U )
+#define esimDEFAULT_NB_TRANS        ( 1U )
+#define esimDEFAULT_INTERVAL_SEC    ( 700U )
+#define esimDEFAULT_PAYLOAD         ( 1U )
+#define esimDEFAULT_POWER_DBM       ( 20 )
+#define esimDEFAULT_LOG_BYTES       ( 1500U )
+#define esimDEFAULT_WAKEUPS         ( 40U )
+#define esimDEFAULT_DAYS            ( 30U )
+
+/**
+ * @brief Highest uplink data rate on the 125 kHz channels, and data rate of the second receive window, in US915.
+ */
+#define esimMAX_DATARATE            ( 4U )
+#define esimRX2_DATARATE            ( 8U )
+
+/**
+ * @brief Bytes the MAC adds to the application payload: header, address, control, counter, port and MIC.
+ */
+#define esimMAC_OVERHEAD            ( 13U )
+
+/**
+ * @brief Delays of the receive windows after the end of the transmission, and between two transmissions.
+ */
+#define esimRX1_DELAY_MS            ( 1000U )
+#define esimRX2_DELAY_MS            ( 2000U )
+#define esimREPEAT_DELAY_MS         ( 1000U )
+
+/**
+ * @brief Time the radio is in standby to be configured before a transmission or a reception, with its wakeup.
+ */
+#define esimSETUP_MS                ( 2U )
+
+/**
+ * @brief SPI bytes of a modem configuration, a command and a buffer access header, as in the simulated radio.
+ */
+#define esimSPI_CONFIG_BYTES        ( 32U )
+#define esimSPI_COMMAND_BYTES       ( 4U )
+#define esimSPI_BUFFER_BYTES        ( 3U )
+
+/**
+ * @brief Spreading factor and bandwidth in kHz of the US915 data rates.
+ */
+static const uint8_t ucSpreadingFactors[] = { 10, 9, 8, 7, 8, 0, 0, 0, 12, 11, 10, 9, 8, 7 };
+static const uint16_t usBandwidths[] = { 125, 125, 125, 125, 500, 0, 0, 0, 500, 500, 500, 500, 500, 500 };
+
+/**
+ * @brief Simulation parameters.
+ */
+static uint32_t ulDatarate = esimDEFAULT_DATARATE;
+static uint32_t ulNbTrans = esimDEFAULT_NB_TRANS;
+static uint32_t ulIntervalSec = esimDEFAULT_INTERVAL_SEC;
+static uint32_t ulPayload = esimDEFAULT_PAYLOAD;
+static int8_t cPowerDbm = esimDEFAULT_POWER_DBM;
+static double dRxErrorMs = lorawanConfigRX_MAX_TIMING_ERROR;
+static uint32_t ulLogBytes = esimDEFAULT_LOG_BYTES;
+static uint32_t ulWakeups = esimDEFAULT_WAKEUPS;
+static uint32_t ulDays = esimDEFAULT_DAYS;
+static bool xCompare = false;
+
+/*-----------------------------------------------------------*/
+
+static double prvSymbolMs( uint32_t ulDr )
+{
+    return ( double ) ( 1UL << ucSpreadingFactors[ ulDr ] ) / ( double ) usBandwidths[ ulDr ];
+}
+/*-----------------------------------------------------------*/
+
+/* LoRa time on air with an explicit header, the CRC, coding rate 4/5 and 8 preamble symbols. */
+static uint32_t prvTimeOnAirMs( uint32_t ulDr,
+                                uint32_t ulSize )
+{
+    double dSymbolMs = prvSymbolMs( ulDr );
+    int32_t lSf = ucSpreadingFactors[ ulDr ];
+    int32_t lLowRate = ( dSymbolMs >= 16.0 ) ? 1 : 0;
+    double dSymbols = ceil( ( double ) ( ( 8 * ( int32_t ) ulSize ) - ( 4 * lSf ) + 28 + 16 ) /
+                            ( double ) ( 4 * ( lSf - ( 2 * lLowRate ) ) ) );
+
+    dSymbols = 8.0 + ( ( dSymbols > 0.0 ) ? ( dSymbols * 5.0 ) : 0.0 );
+
+    return ( uint32_t ) ceil( ( 8.0 + 4.25 + dSymbols ) * dSymbolMs );
+}
+/*-----------------------------------------------------------*/
+
+/* Opens a receive window which gets no downlink, and returns its duration. */
+static uint32_t prvReceive( Energy_t * pxEnergy,
+                            uint32_t ulDr,
+                            uint32_t ulNowMs )
+{
+    uint32_t ulWindowMs = ( uint32_t ) ceil( ( lorawanConfigRX_MIN_SYMBOLS * prvSymbolMs( ulDr ) ) + ( 2.0 * dRxErrorMs ) );
+
+    Energy_SetRadioState( pxEnergy, ENERGY_RADIO_STANDBY, ulNowMs );
+    Energy_AddSpiBytes( pxEnergy, esimSPI_CONFIG_BYTES + ( 2U * esimSPI_COMMAND_BYTES ) );
+    Energy_SetRadioState( pxEnergy, ENERGY_RADIO_RX, ulNowMs + esimSETUP_MS );
+    Energy_SetRadioState( pxEnergy, ENERGY_RADIO_SLEEP, ulNowMs + esimSETUP_MS + ulWindowMs );
+
+    return esimSETUP_MS + ulWindowMs;
+}
+/*-----------------------------------------------------------*/
+
+/* Runs the uplink cycles for the simulated days and returns the report. */
+static void prvRun( uint32_t ulDr,
+                    uint32_t ulTransmissions,
+                    EnergyReport_t * pxReport )
+{
+    Energy_t xEnergy;
+    uint32_t ulNowMs = 0;
+    uint32_t ulCycleStartMs;
+    uint32_t ulEndMs = ulDays * 86400000UL;
+    uint32_t ulTimeOnAirMs = prvTimeOnAirMs( ulDr, ulPayload + esimMAC_OVERHEAD );
+    uint32_t ulRx1Dr = ( ulDr < esimMAX_DATARATE ) ? ( ulDr + 10U ) : 13U;
+    uint32_t i;
+
+    Energy_Init( &xEnergy, 0 );
+    Energy_SetTxPower( &xEnergy, cPowerDbm, 0 );
+
+    while( ulNowMs < ulEndMs )
+    {
+        ulCycleStartMs = ulNowMs;
+        Energy_StartCycle( &xEnergy, ulNowMs );
+
+        for( i = 0; i < ulTransmissions; i++ )
+        {
+            Energy_SetRadioState( &xEnergy, ENERGY_RADIO_STANDBY, ulNowMs );
+            Energy_AddSpiBytes( &xEnergy, esimSPI_CONFIG_BYTES + esimSPI_BUFFER_BYTES + ulPayload + esimMAC_OVERHEAD +
+                                ( 2U * esimSPI_COMMAND_BYTES ) );
+            Energy_SetRadioState( &xEnergy, ENERGY_RADIO_TX, ulNowMs + esimSETUP_MS );
+            ulNowMs += esimSETUP_MS + ulTimeOnAirMs;
+            Energy_SetRadioState( &xEnergy, ENERGY_RADIO_SLEEP, ulNowMs );
+
+            /* The windows open early by the timing error, the setup is part of it. */
+            ( void ) prvReceive( &xEnergy, ulRx1Dr, ulNowMs + esimRX1_DELAY_MS - ( uint32_t ) dRxErrorMs );
+            ulNowMs += esimRX2_DELAY_MS - ( uint32_t ) dRxErrorMs;
+            ulNowMs += prvReceive( &xEnergy, esimRX2_DATARATE, ulNowMs );
+
+            if( ( i + 1U ) < ulTransmissions )
+            {
+                ulNowMs += esimREPEAT_DELAY_MS;
+            }
+        }
+
+        /* Code takes no simulated time, so the MCU sleeps the whole cycle and each wakeup is charged a fixed time. */
+        ulNowMs = ulCycleStartMs + ( ulIntervalSec * 1000UL );
+        Energy_AddMcuSleep( &xEnergy, ( ulNowMs - ulCycleStartMs ) * 1000U );
+        Energy_AddMcuActive( &xEnergy, ( ulWakeups * lorawanConfigENERGY_WAKEUP_US ) +
+                             ( uint32_t ) ( ( float ) ulLogBytes * lorawanConfigENERGY_LOG_US_PER_BYTE ) );
+        Energy_AddLogBytes( &xEnergy, ulLogBytes );
+    }
+
+    Energy_GetReport( &xEnergy, ulNowMs, pxReport );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    fprintf( stderr,
+             "Usage: %s [-r <data rate>] [-n <transmissions>] [-i <interval s>] [-p <payload bytes>] [-P <power dBm>]\n"
+             "          [-e <receive window error ms>] [-l <log bytes per uplink>] [-w <wakeups per uplink>] [-d <days>] [-a]\n",
+             pcProgram );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvParseOptions( int argc,
+                             char ** argv )
+{
+    int iOption;
+
+    while( ( iOption = getopt( argc, argv, "r:n:i:p:P:e:l:w:d:a" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'r':
+                ulDatarate = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'n':
+                ulNbTrans = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'i':
+                ulIntervalSec = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'p':
+                ulPayload = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'P':
+                cPowerDbm = ( int8_t ) strtol( optarg, NULL, 0 );
+                break;
+
+            case 'e':
+                dRxErrorMs = strtod( optarg, NULL );
+                break;
+
+            case 'l':
+                ulLogBytes = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'w':
+                ulWakeups = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'd':
+                ulDays = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'a':
+                xCompare = true;
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                break;
+        }
+    }
+
+    /* The time of the accounting is 32 bit in ms. */
+    if( ( ulDatarate > esimMAX_DATARATE ) || ( ulNbTrans == 0U ) || ( ulNbTrans > 15U ) || ( ulPayload > 242U ) ||
+        ( ulDays == 0U ) || ( ulDays > 49U ) || ( dRxErrorMs < 0.0 ) || ( dRxErrorMs >= esimRX1_DELAY_MS ) ||
+        ( ( ulIntervalSec * 1000UL ) < ( ulNbTrans * ( esimRX2_DELAY_MS + esimREPEAT_DELAY_MS + 3000UL ) ) ) )
+    {
+        prvUsage( argv[ 0 ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    EnergyReport_t xReport;
+    uint32_t ulDr, ulTransmissions, i;
+
+    prvParseOptions( argc, argv );
+
+    printf( "Uplink of %u bytes every %u s at %d dBm, receive windows off by %.0f ms, %u log bytes and %u wakeups per\n"
+            "uplink, over %u days on %.0f mAh.\n",
+            ( unsigned ) ulPayload, ( unsigned ) ulIntervalSec, cPowerDbm, dRxErrorMs, ( unsigned ) ulLogBytes,
+            ( unsigned ) ulWakeups, ( unsigned ) ulDays, ( double ) lorawanConfigENERGY_BATTERY_MAH );
+
+    if( xCompare == true )
+    {
+        printf( "%-4s %6s %10s %14s %12s %12s\n", "DR", "nbTrans", "air ms", "uAh/uplink", "average uA", "days" );
+
+        for( ulDr = 0; ulDr <= esimMAX_DATARATE; ulDr++ )
+        {
+            for( ulTransmissions = 1; ulTransmissions <= lorawanConfigMAX_NB_TRANS; ulTransmissions++ )
+            {
+                prvRun( ulDr, ulTransmissions, &xReport );
+                printf( "%-4u %6u %10u %14.2f %12.2f %12.0f\n", ( unsigned ) ulDr, ( unsigned ) ulTransmissions,
+                        ( unsigned ) ( ulTransmissions * prvTimeOnAirMs( ulDr, ulPayload + esimMAC_OVERHEAD ) ),
+                        ( double ) xReport.cycleTotalUah, ( double ) xReport.averageUa, ( double ) xReport.batteryDays );
+            }
+        }
+    }
+    else
+    {
+        prvRun( ulDatarate, ulNbTrans, &xReport );
+        printf( "DR%u with %u transmissions of %u ms:\n", ( unsigned ) ulDatarate, ( unsigned ) ulNbTrans,
+                ( unsigned ) prvTimeOnAirMs( ulDatarate, ulPayload + esimMAC_OVERHEAD ) );
+        printf( "%-14s %12s %8s\n", "category", "uAh/uplink", "share" );
+
+        for( i = 0; i < ( uint32_t ) ENERGY_CATEGORIES; i++ )
+        {
+            printf( "%-14s %12.3f %7.1f%%\n", Energy_GetCategoryName( ( EnergyCategory_t ) i ),
+                    ( double ) xReport.cycleUah[ i ],
+                    ( double ) ( 100.0f * xReport.cycleUah[ i ] / xReport.cycleTotalUah ) );
+        }
+
+        printf( "%-14s %12.3f\n", "total", ( double ) xReport.cycleTotalUah );
+        printf( "Average current %.2f uA, battery life %.0f days.\n", ( double ) xReport.averageUa,
+                ( double ) xReport.batteryDays );
+    }
+
+    return EXIT_SUCCESS;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file channel.c
+ * @brief Shared radio channel model of the fleet simulator.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channel.h"
+
+/**
+ * @brief Gateway sensitivity in dBm at 125 kHz, indexed by spreading factor 7 to 12 (SX1301 datasheet).
+ * Each doubling of the bandwidth costs 3 dB.
+ */
+static const double dSensitivity125kHz[] = { -126.5, -129.0, -131.5, -134.0, -136.5, -139.5 };
+
+static const char * const pcOutcomeNames[ CHANNEL_OUTCOME_MAX ] =
+{
+    "delivered",
+    "below sensitivity",
+    "no demodulator",
+    "collision",
+    "gateway busy"
+};
+
+/**
+ * @brief Thermal noise density in dBm/Hz and noise figure of the receivers.
+ */
+#define channelNOISE_DENSITY_DBM_HZ    ( -174.0 )
+#define channelNOISE_FIGURE_DB         ( 6.0 )
+
+/**
+ * @brief Number of preamble symbols of a LoRaWAN frame.
+ */
+#define channelPREAMBLE_SYMBOLS        ( 8 )
+
+/**
+ * @brief Uplink slot. Slots stay in use after the uplink ended as long as they can interfere with an uplink
+ * still on the air.
+ */
+typedef struct ChannelSlot
+{
+    ChannelUplink_t xUplink;
+    bool xInUse;
+    bool xEnded;
+} ChannelSlot_t;
+
+/**
+ * @brief Transmission of the gateway.
+ */
+typedef struct ChannelGatewayTx
+{
+    uint64_t ullStartMs;
+    uint64_t ullEndMs;
+} ChannelGatewayTx_t;
+
+static ChannelParams_t xChannelParams;
+static ChannelSlot_t * pxSlots = NULL;
+static size_t xSlotCount = 0;
+static ChannelGatewayTx_t * pxGatewayTx = NULL;
+static size_t xGatewayTxCount = 0;
+static size_t xGatewayTxCapacity = 0;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBandwidthHz( uint8_t ucBandwidth )
+{
+    return 125000UL << ( ( ucBandwidth <= 2 ) ? ucBandwidth : 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+double ChannelSensitivity( uint8_t ucSpreadingFactor,
+                           uint8_t ucBandwidth )
+{
+    size_t xIndex = ( ucSpreadingFactor < 7 ) ? 0 : ( size_t ) ( ucSpreadingFactor - 7 );
+
+    if( xIndex > 5 )
+    {
+        xIndex = 5;
+    }
+
+    return dSensitivity125kHz[ xIndex ] + ( 3.0 * ( double ) ucBandwidth );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvOverlaps( const ChannelUplink_t * pxA,
+                         const ChannelUplink_t * pxB )
+{
+    return( ( pxA->ulFrequency == pxB->ulFrequency ) &&
+            ( pxA->ucSpreadingFactor == pxB->ucSpreadingFactor ) &&
+            ( pxA->ucBandwidth == pxB->ucBandwidth ) &&
+            ( pxA->ullStartMs < pxB->ullEndMs ) &&
+            ( pxB->ullStartMs < pxA->ullEndMs ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Releases the slots of ended uplinks which cannot overlap any uplink still on the air.
+ */
+static void prvReleaseSlots( uint64_t ullNowMs )
+{
+    uint64_t ullOldestStartMs = ullNowMs;
+    size_t x;
+
+    for( x = 0; x < xSlotCount; x++ )
+    {
+        if( ( pxSlots[ x ].xInUse == true ) && ( pxSlots[ x ].xEnded == false ) &&
+            ( pxSlots[ x ].xUplink.ullStartMs < ullOldestStartMs ) )
+        {
+            ullOldestStartMs = pxSlots[ x ].xUplink.ullStartMs;
+        }
+    }
+
+    for( x = 0; x < xSlotCount; x++ )
+    {
+        if( ( pxSlots[ x ].xInUse == true ) && ( pxSlots[ x ].xEnded == true ) &&
+            ( pxSlots[ x ].xUplink.ullEndMs <= ullOldestStartMs ) )
+        {
+            pxSlots[ x ].xInUse = false;
+        }
+    }
+
+    /* Gateway transmissions are kept in the order of their start times. */
+    for( x = 0; ( x < xGatewayTxCount ) && ( pxGatewayTx[ x ].ullEndMs <= ullOldestStartMs ); x++ )
+    {
+    }
+
+    if( x > 0 )
+    {
+        memmove( pxGatewayTx, &pxGatewayTx[ x ], ( xGatewayTxCount - x ) * sizeof( ChannelGatewayTx_t ) );
+        xGatewayTxCount -= x;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void ChannelInit( const ChannelParams_t * pxParams )
+{
+    xChannelParams = *pxParams;
+    free( pxSlots );
+    pxSlots = NULL;
+    xSlotCount = 0;
+    free( pxGatewayTx );
+    pxGatewayTx = NULL;
+    xGatewayTxCount = 0;
+    xGatewayTxCapacity = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+double ChannelRssi( int8_t cPowerDbm,
+                    double dDistanceM )
+{
+    double dDistance = ( dDistanceM > xChannelParams.dRefDistanceM ) ? dDistanceM : xChannelParams.dRefDistanceM;
+
+    return ( double ) cPowerDbm - xChannelParams.dPathLossRefDb -
+           ( 10.0 * xChannelParams.dPathLossExponent * log10( dDistance / xChannelParams.dRefDistanceM ) );
+}
+
+/*-----------------------------------------------------------*/
+
+double ChannelSnr( double dRssiDbm,
+                   uint8_t ucBandwidth )
+{
+    double dNoiseDbm = channelNOISE_DENSITY_DBM_HZ + channelNOISE_FIGURE_DB +
+                       ( 10.0 * log10( ( double ) prvBandwidthHz( ucBandwidth ) ) );
+
+    return dRssiDbm - dNoiseDbm;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ChannelTimeOnAir( uint8_t ucSpreadingFactor,
+                           uint8_t ucBandwidth,
+                           uint8_t ucCodingRate,
+                           uint8_t ucSize,
+                           bool xCrcOn )
+{
+    double dSymbolMs = ( double ) ( 1UL << ucSpreadingFactor ) * 1000.0 / ( double ) prvBandwidthHz( ucBandwidth );
+    int32_t lLowDatarateOptimize = ( ( ( ucSpreadingFactor >= 11 ) && ( ucBandwidth == 0 ) ) ||
+                                     ( ( ucSpreadingFactor == 12 ) && ( ucBandwidth == 1 ) ) ) ? 1 : 0;
+    int32_t lNumerator = ( 8 * ( int32_t ) ucSize ) - ( 4 * ( int32_t ) ucSpreadingFactor ) + 28 + ( xCrcOn ? 16 : 0 );
+    int32_t lDenominator = 4 * ( ( int32_t ) ucSpreadingFactor - ( 2 * lLowDatarateOptimize ) );
+    int32_t lPayloadSymbols = 8;
+
+    if( lNumerator > 0 )
+    {
+        lPayloadSymbols += ( ( lNumerator + lDenominator - 1 ) / lDenominator ) * ( ucCodingRate + 4 );
+    }
+
+    return ( uint32_t ) ceil( ( ( double ) channelPREAMBLE_SYMBOLS + 4.25 + ( double ) lPayloadSymbols ) * dSymbolMs );
+}
+
+/*-----------------------------------------------------------*/
+
+bool ChannelGatewayTransmit( uint64_t ullStartMs,
+                             uint64_t ullEndMs )
+{
+    ChannelGatewayTx_t * pxResized;
+    size_t x, xInsert = xGatewayTxCount;
+
+    for( x = 0; x < xGatewayTxCount; x++ )
+    {
+        if( ( ullStartMs < pxGatewayTx[ x ].ullEndMs ) && ( pxGatewayTx[ x ].ullStartMs < ullEndMs ) )
+        {
+            return false;
+        }
+
+        if( ( xInsert == xGatewayTxCount ) && ( ullStartMs < pxGatewayTx[ x ].ullStartMs ) )
+        {
+            xInsert = x;
+        }
+    }
+
+    if( xGatewayTxCount == xGatewayTxCapacity )
+    {
+        xGatewayTxCapacity = ( xGatewayTxCapacity == 0 ) ? 16 : ( xGatewayTxCapacity * 2 );
+        pxResized = realloc( pxGatewayTx, xGatewayTxCapacity * sizeof( ChannelGatewayTx_t ) );
+
+        if( pxResized == NULL )
+        {
+            return false;
+        }
+
+        pxGatewayTx = pxResized;
+    }
+
+    memmove( &pxGatewayTx[ xInsert + 1 ], &pxGatewayTx[ xInsert ], ( xGatewayTxCount - xInsert ) * sizeof( ChannelGatewayTx_t ) );
+    pxGatewayTx[ xInsert ].ullStartMs = ullStartMs;
+    pxGatewayTx[ xInsert ].ullEndMs = ullEndMs;
+    xGatewayTxCount++;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t ChannelStartUplink( const ChannelUplink_t * pxUplink )
+{
+    ChannelSlot_t * pxSlot = NULL;
+    ChannelSlot_t * pxResized;
+    uint32_t ulBusyDemodulators = 0;
+    size_t x;
+
+    prvReleaseSlots( pxUplink->ullStartMs );
+
+    for( x = 0; x < xSlotCount; x++ )
+    {
+        if( pxSlots[ x ].xInUse == false )
+        {
+            if( pxSlot == NULL )
+            {
+                pxSlot = &pxSlots[ x ];
+            }
+        }
+        else if( ( pxSlots[ x ].xEnded == false ) && ( pxSlots[ x ].xUplink.xDetected == true ) )
+        {
+            ulBusyDemodulators++;
+        }
+    }
+
+    if( pxSlot == NULL )
+    {
+        pxResized = realloc( pxSlots, ( xSlotCount + 16 ) * sizeof( ChannelSlot_t ) );
+
+        if( pxResized == NULL )
+        {
+            return -1;
+        }
+
+        memset( &pxResized[ xSlotCount ], 0, 16 * sizeof( ChannelSlot_t ) );
+        pxSlots = pxResized;
+        pxSlot = &pxSlots[ xSlotCount ];
+        xSlotCount += 16;
+    }
+
+    pxSlot->xUplink = *pxUplink;
+    pxSlot->xInUse = true;
+    pxSlot->xEnded = false;
+
+    if( pxUplink->dRssiDbm < ChannelSensitivity( pxUplink->ucSpreadingFactor, pxUplink->ucBandwidth ) )
+    {
+        pxSlot->xUplink.xDetected = false;
+        pxSlot->xUplink.xOutcome = CHANNEL_LOST_SENSITIVITY;
+    }
+    else if( ulBusyDemodulators >= xChannelParams.ulDemodulators )
+    {
+        pxSlot->xUplink.xDetected = false;
+        pxSlot->xUplink.xOutcome = CHANNEL_LOST_DEMODULATOR;
+    }
+    else
+    {
+        pxSlot->xUplink.xDetected = true;
+        pxSlot->xUplink.xOutcome = CHANNEL_DELIVERED;
+    }
+
+    return ( int32_t ) ( pxSlot - pxSlots );
+}
+
+/*-----------------------------------------------------------*/
+
+void ChannelEndUplink( int32_t lHandle,
+                       ChannelUplink_t * pxUplink )
+{
+    ChannelSlot_t * pxSlot = &pxSlots[ lHandle ];
+    size_t x;
+
+    pxSlot->xEnded = true;
+
+    for( x = 0; ( x < xGatewayTxCount ) && ( pxSlot->xUplink.xOutcome == CHANNEL_DELIVERED ); x++ )
+    {
+        if( ( pxSlot->xUplink.ullStartMs < pxGatewayTx[ x ].ullEndMs ) &&
+            ( pxGatewayTx[ x ].ullStartMs < pxSlot->xUplink.ullEndMs ) )
+        {
+            pxSlot->xUplink.xOutcome = CHANNEL_LOST_GATEWAY_TX;
+        }
+    }
+
+    if( pxSlot->xUplink.xOutcome == CHANNEL_DELIVERED )
+    {
+        for( x = 0; x < xSlotCount; x++ )
+        {
+            if( ( &pxSlots[ x ] != pxSlot ) && ( pxSlots[ x ].xInUse == true ) &&
+                prvOverlaps( &pxSlot->xUplink, &pxSlots[ x ].xUplink ) &&
+                ( ( pxSlot->xUplink.dRssiDbm - pxSlots[ x ].xUplink.dRssiDbm ) < channelCAPTURE_THRESHOLD_DB ) )
+            {
+                pxSlot->xUplink.xOutcome = CHANNEL_LOST_COLLISION;
+                break;
+            }
+        }
+    }
+
+    *pxUplink = pxSlot->xUplink;
+}
+
+/*-----------------------------------------------------------*/
+
+const char * ChannelOutcomeName( ChannelOutcome_t xOutcome )
+{
+    return ( xOutcome < CHANNEL_OUTCOME_MAX ) ? pcOutcomeNames[ xOutcome ] : "unknown";
+}
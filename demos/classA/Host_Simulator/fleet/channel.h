@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file channel.h
+ * @brief Shared radio channel model of the fleet simulator.
+ *
+ * Models a single gateway receiving the uplinks of the whole fleet:
+ *  - Received power follows a log-distance path loss model, from the transmit power and the device distance.
+ *  - A frame below the sensitivity of its spreading factor and bandwidth is not detected.
+ *  - A detected frame needs one of the gateway demodulators for its whole duration. Frames arriving while all
+ *    demodulators are busy are lost.
+ *  - Frames overlapping in time on the same frequency, spreading factor and bandwidth collide. A frame survives
+ *    a collision only if it is received at least channelCAPTURE_THRESHOLD_DB stronger than every interferer
+ *    (capture effect). Different spreading factors are considered orthogonal.
+ *  - The gateway is half-duplex: uplinks overlapping one of its transmissions are lost, and it transmits one
+ *    downlink at a time.
+ */
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Power difference needed for the strongest of two colliding frames to be demodulated.
+ */
+#define channelCAPTURE_THRESHOLD_DB    ( 6.0 )
+
+/**
+ * @brief Outcome of an uplink.
+ */
+typedef enum ChannelOutcome
+{
+    CHANNEL_DELIVERED = 0,     /**< @brief Frame received by the gateway. */
+    CHANNEL_LOST_SENSITIVITY,  /**< @brief Frame too weak to be detected. */
+    CHANNEL_LOST_DEMODULATOR,  /**< @brief All gateway demodulators were busy. */
+    CHANNEL_LOST_COLLISION,    /**< @brief Frame destroyed by an overlapping frame. */
+    CHANNEL_LOST_GATEWAY_TX,   /**< @brief Gateway was transmitting a downlink. */
+    CHANNEL_OUTCOME_MAX
+} ChannelOutcome_t;
+
+/**
+ * @brief Gateway and propagation parameters.
+ */
+typedef struct ChannelParams
+{
+    uint32_t ulDemodulators;    /**< @brief Number of demodulation paths of the gateway. */
+    double dPathLossRefDb;      /**< @brief Path loss at the reference distance. */
+    double dRefDistanceM;       /**< @brief Reference distance of the path loss model. */
+    double dPathLossExponent;   /**< @brief Path loss exponent. */
+} ChannelParams_t;
+
+/**
+ * @brief An uplink on the air.
+ */
+typedef struct ChannelUplink
+{
+    uint32_t ulDevice;          /**< @brief Index of the transmitting device. */
+    uint64_t ullStartMs;        /**< @brief Global time at which the transmission started. */
+    uint64_t ullEndMs;          /**< @brief Global time at which the transmission ended. */
+    uint32_t ulFrequency;
+    uint8_t ucSpreadingFactor;
+    uint8_t ucBandwidth;
+    double dRssiDbm;            /**< @brief Power received by the gateway. */
+    bool xDetected;             /**< @brief Set if the gateway locked on the frame with a free demodulator. */
+    ChannelOutcome_t xOutcome;  /**< @brief Outcome, valid once the transmission ended. */
+} ChannelUplink_t;
+
+/**
+ * @brief Initializes the channel model.
+ *
+ * @param[in] pxParams Gateway and propagation parameters.
+ */
+void ChannelInit( const ChannelParams_t * pxParams );
+
+/**
+ * @brief Returns the power received by the gateway from a transmitter at the given distance.
+ *
+ * @param[in] cPowerDbm Transmit power.
+ * @param[in] dDistanceM Distance to the gateway.
+ */
+double ChannelRssi( int8_t cPowerDbm,
+                    double dDistanceM );
+
+/**
+ * @brief Returns the sensitivity of a LoRa receiver in dBm.
+ *
+ * @param[in] ucSpreadingFactor Spreading factor, 7 to 12.
+ * @param[in] ucBandwidth 0: 125 kHz, 1: 250 kHz, 2: 500 kHz.
+ */
+double ChannelSensitivity( uint8_t ucSpreadingFactor,
+                           uint8_t ucBandwidth );
+
+/**
+ * @brief Returns the signal to noise ratio of a frame received with the given power.
+ *
+ * @param[in] dRssiDbm Received power.
+ * @param[in] ucBandwidth 0: 125 kHz, 1: 250 kHz, 2: 500 kHz.
+ */
+double ChannelSnr( double dRssiDbm,
+                   uint8_t ucBandwidth );
+
+/**
+ * @brief Returns the time on air of a LoRa frame with an explicit header and 8 preamble symbols, in ms.
+ *
+ * @param[in] ucSpreadingFactor Spreading factor, 7 to 12.
+ * @param[in] ucBandwidth 0: 125 kHz, 1: 250 kHz, 2: 500 kHz.
+ * @param[in] ucCodingRate 1: 4/5 to 4: 4/8.
+ * @param[in] ucSize Size of the frame.
+ * @param[in] xCrcOn Set if the frame carries a payload CRC, as uplinks do.
+ */
+uint32_t ChannelTimeOnAir( uint8_t ucSpreadingFactor,
+                           uint8_t ucBandwidth,
+                           uint8_t ucCodingRate,
+                           uint8_t ucSize,
+                           bool xCrcOn );
+
+/**
+ * @brief Reserves the gateway transmitter for a downlink.
+ *
+ * @param[in] ullStartMs Global time at which the transmission starts.
+ * @param[in] ullEndMs Global time at which the transmission ends.
+ * @return true if the gateway was free, false if it already transmits during that time.
+ */
+bool ChannelGatewayTransmit( uint64_t ullStartMs,
+                             uint64_t ullEndMs );
+
+/**
+ * @brief Puts an uplink on the air.
+ * The uplink is copied by the channel model, which assigns it a demodulator if it can be detected.
+ *
+ * @param[in] pxUplink Uplink, with all the fields but xDetected and xOutcome filled in.
+ * @return Handle to the uplink, to be passed to ChannelEndUplink(), or -1 if out of memory.
+ */
+int32_t ChannelStartUplink( const ChannelUplink_t * pxUplink );
+
+/**
+ * @brief Ends an uplink and evaluates its outcome. Must be called in the order of the uplink end times.
+ *
+ * @param[in] lHandle Handle returned by ChannelStartUplink().
+ * @param[out] pxUplink Copy of the uplink, with its outcome.
+ */
+void ChannelEndUplink( int32_t lHandle,
+                       ChannelUplink_t * pxUplink );
+
+/**
+ * @brief Returns a human readable name for an outcome.
+ */
+const char * ChannelOutcomeName( ChannelOutcome_t xOutcome );
+
+#endif /* CHANNEL_H */
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file crypto.c
+ * @brief AES-128 and AES-CMAC for the network server stand-in of the fleet simulator.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "crypto.h"
+
+/**
+ * @brief Number of rounds and size of the expanded key of AES-128.
+ */
+#define cryptoROUNDS               ( 10 )
+#define cryptoEXPANDED_KEY_SIZE    ( cryptoBLOCK_SIZE * ( cryptoROUNDS + 1 ) )
+
+/**
+ * @brief Constant of the CMAC subkey generation.
+ */
+#define cryptoCMAC_RB              ( 0x87 )
+
+static uint8_t ucSbox[ 256 ];
+static uint8_t ucInvSbox[ 256 ];
+static bool xTablesReady = false;
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvRotateLeft( uint8_t ucValue,
+                              uint32_t ulShift )
+{
+    return ( uint8_t ) ( ( ucValue << ulShift ) | ( ucValue >> ( 8 - ulShift ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Multiplication by x in GF(2^8).
+ */
+static uint8_t prvTimes2( uint8_t ucValue )
+{
+    return ( uint8_t ) ( ( ucValue << 1 ) ^ ( ( ( ucValue & 0x80 ) != 0 ) ? 0x1B : 0x00 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvMultiply( uint8_t ucA,
+                            uint8_t ucB )
+{
+    uint8_t ucResult = 0;
+
+    while( ucB != 0 )
+    {
+        if( ( ucB & 1 ) != 0 )
+        {
+            ucResult ^= ucA;
+        }
+
+        ucA = prvTimes2( ucA );
+        ucB >>= 1;
+    }
+
+    return ucResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Computes the S-boxes, walking GF(2^8) with the generator 3 and its inverse.
+ */
+static void prvInitTables( void )
+{
+    uint8_t ucP = 1, ucQ = 1, ucValue;
+
+    do
+    {
+        ucP = ( uint8_t ) ( ucP ^ prvTimes2( ucP ) );
+
+        ucQ ^= ( uint8_t ) ( ucQ << 1 );
+        ucQ ^= ( uint8_t ) ( ucQ << 2 );
+        ucQ ^= ( uint8_t ) ( ucQ << 4 );
+
+        if( ( ucQ & 0x80 ) != 0 )
+        {
+            ucQ ^= 0x09;
+        }
+
+        ucValue = ( uint8_t ) ( ucQ ^ prvRotateLeft( ucQ, 1 ) ^ prvRotateLeft( ucQ, 2 ) ^
+                                prvRotateLeft( ucQ, 3 ) ^ prvRotateLeft( ucQ, 4 ) ^ 0x63 );
+        ucSbox[ ucP ] = ucValue;
+        ucInvSbox[ ucValue ] = ucP;
+    } while( ucP != 1 );
+
+    ucSbox[ 0 ] = 0x63;
+    ucInvSbox[ 0x63 ] = 0;
+    xTablesReady = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvExpandKey( const uint8_t * pucKey,
+                          uint8_t * pucExpanded )
+{
+    uint8_t ucRcon = 1;
+    uint8_t ucTemp[ 4 ];
+    size_t x;
+
+    if( xTablesReady == false )
+    {
+        prvInitTables();
+    }
+
+    memcpy( pucExpanded, pucKey, cryptoBLOCK_SIZE );
+
+    for( x = cryptoBLOCK_SIZE; x < cryptoEXPANDED_KEY_SIZE; x += 4 )
+    {
+        memcpy( ucTemp, &pucExpanded[ x - 4 ], 4 );
+
+        if( ( x % cryptoBLOCK_SIZE ) == 0 )
+        {
+            uint8_t ucFirst = ucTemp[ 0 ];
+
+            ucTemp[ 0 ] = ( uint8_t ) ( ucSbox[ ucTemp[ 1 ] ] ^ ucRcon );
+            ucTemp[ 1 ] = ucSbox[ ucTemp[ 2 ] ];
+            ucTemp[ 2 ] = ucSbox[ ucTemp[ 3 ] ];
+            ucTemp[ 3 ] = ucSbox[ ucFirst ];
+            ucRcon = prvTimes2( ucRcon );
+        }
+
+        pucExpanded[ x ] = pucExpanded[ x - cryptoBLOCK_SIZE ] ^ ucTemp[ 0 ];
+        pucExpanded[ x + 1 ] = pucExpanded[ x + 1 - cryptoBLOCK_SIZE ] ^ ucTemp[ 1 ];
+        pucExpanded[ x + 2 ] = pucExpanded[ x + 2 - cryptoBLOCK_SIZE ] ^ ucTemp[ 2 ];
+        pucExpanded[ x + 3 ] = pucExpanded[ x + 3 - cryptoBLOCK_SIZE ] ^ ucTemp[ 3 ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAddRoundKey( uint8_t * pucState,
+                            const uint8_t * pucRoundKey )
+{
+    size_t x;
+
+    for( x = 0; x < cryptoBLOCK_SIZE; x++ )
+    {
+        pucState[ x ] ^= pucRoundKey[ x ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief SubBytes and ShiftRows, or their inverses. The state is stored column by column.
+ */
+static void prvSubShift( uint8_t * pucState,
+                         bool xInverse )
+{
+    uint8_t ucCopy[ cryptoBLOCK_SIZE ];
+    size_t xRow, xColumn, xSource;
+
+    memcpy( ucCopy, pucState, cryptoBLOCK_SIZE );
+
+    for( xColumn = 0; xColumn < 4; xColumn++ )
+    {
+        for( xRow = 0; xRow < 4; xRow++ )
+        {
+            if( xInverse == false )
+            {
+                xSource = ( ( ( xColumn + xRow ) % 4 ) * 4 ) + xRow;
+                pucState[ ( xColumn * 4 ) + xRow ] = ucSbox[ ucCopy[ xSource ] ];
+            }
+            else
+            {
+                xSource = ( ( ( xColumn + 4 - xRow ) % 4 ) * 4 ) + xRow;
+                pucState[ ( xColumn * 4 ) + xRow ] = ucInvSbox[ ucCopy[ xSource ] ];
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvMixColumns( uint8_t * pucState,
+                           bool xInverse )
+{
+    static const uint8_t ucForward[ 4 ] = { 2, 3, 1, 1 };
+    static const uint8_t ucBackward[ 4 ] = { 14, 11, 13, 9 };
+    const uint8_t * pucCoefficients = ( xInverse == false ) ? ucForward : ucBackward;
+    uint8_t ucColumn[ 4 ];
+    size_t xColumn, xRow, x;
+
+    for( xColumn = 0; xColumn < 4; xColumn++ )
+    {
+        memcpy( ucColumn, &pucState[ xColumn * 4 ], 4 );
+
+        for( xRow = 0; xRow < 4; xRow++ )
+        {
+            uint8_t ucValue = 0;
+
+            for( x = 0; x < 4; x++ )
+            {
+                ucValue ^= prvMultiply( ucColumn[ x ], pucCoefficients[ ( x + 4 - xRow ) % 4 ] );
+            }
+
+            pucState[ ( xColumn * 4 ) + xRow ] = ucValue;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void CryptoAesEncrypt( const uint8_t * pucKey,
+                       const uint8_t * pucIn,
+                       uint8_t * pucOut )
+{
+    uint8_t ucExpanded[ cryptoEXPANDED_KEY_SIZE ];
+    uint8_t ucState[ cryptoBLOCK_SIZE ];
+    size_t xRound;
+
+    prvExpandKey( pucKey, ucExpanded );
+    memcpy( ucState, pucIn, cryptoBLOCK_SIZE );
+    prvAddRoundKey( ucState, ucExpanded );
+
+    for( xRound = 1; xRound <= cryptoROUNDS; xRound++ )
+    {
+        prvSubShift( ucState, false );
+
+        if( xRound < cryptoROUNDS )
+        {
+            prvMixColumns( ucState, false );
+        }
+
+        prvAddRoundKey( ucState, &ucExpanded[ xRound * cryptoBLOCK_SIZE ] );
+    }
+
+    memcpy( pucOut, ucState, cryptoBLOCK_SIZE );
+}
+
+/*-----------------------------------------------------------*/
+
+void CryptoAesDecrypt( const uint8_t * pucKey,
+                       const uint8_t * pucIn,
+                       uint8_t * pucOut )
+{
+    uint8_t ucExpanded[ cryptoEXPANDED_KEY_SIZE ];
+    uint8_t ucState[ cryptoBLOCK_SIZE ];
+    size_t xRound;
+
+    prvExpandKey( pucKey, ucExpanded );
+    memcpy( ucState, pucIn, cryptoBLOCK_SIZE );
+    prvAddRoundKey( ucState, &ucExpanded[ cryptoROUNDS * cryptoBLOCK_SIZE ] );
+
+    for( xRound = cryptoROUNDS; xRound > 0; xRound-- )
+    {
+        prvSubShift( ucState, true );
+        prvAddRoundKey( ucState, &ucExpanded[ ( xRound - 1 ) * cryptoBLOCK_SIZE ] );
+
+        if( xRound > 1 )
+        {
+            prvMixColumns( ucState, true );
+        }
+    }
+
+    memcpy( pucOut, ucState, cryptoBLOCK_SIZE );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Left shift of a block by one bit, XORed with Rb if the bit shifted out is set.
+ */
+static void prvCmacSubkey( const uint8_t * pucIn,
+                           uint8_t * pucOut )
+{
+    uint8_t ucCarry = ( uint8_t ) ( pucIn[ 0 ] >> 7 );
+    size_t x;
+
+    for( x = 0; x < ( cryptoBLOCK_SIZE - 1 ); x++ )
+    {
+        pucOut[ x ] = ( uint8_t ) ( ( pucIn[ x ] << 1 ) | ( pucIn[ x + 1 ] >> 7 ) );
+    }
+
+    pucOut[ cryptoBLOCK_SIZE - 1 ] = ( uint8_t ) ( pucIn[ cryptoBLOCK_SIZE - 1 ] << 1 );
+
+    if( ucCarry != 0 )
+    {
+        pucOut[ cryptoBLOCK_SIZE - 1 ] ^= cryptoCMAC_RB;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void CryptoCmac( const uint8_t * pucKey,
+                 const uint8_t * pucData,
+                 size_t xLength,
+                 uint8_t * pucMac )
+{
+    uint8_t ucSubkey[ cryptoBLOCK_SIZE ] = { 0 };
+    uint8_t ucBlock[ cryptoBLOCK_SIZE ];
+    uint8_t ucState[ cryptoBLOCK_SIZE ] = { 0 };
+    size_t xBlocks = ( xLength + cryptoBLOCK_SIZE - 1 ) / cryptoBLOCK_SIZE;
+    size_t xLast, x, y;
+    bool xComplete;
+
+    /* K1 = L << 1, K2 = K1 << 1, with L the encryption of the zero block. */
+    CryptoAesEncrypt( pucKey, ucSubkey, ucBlock );
+    prvCmacSubkey( ucBlock, ucSubkey );
+
+    if( xBlocks == 0 )
+    {
+        xBlocks = 1;
+        xComplete = false;
+    }
+    else
+    {
+        xComplete = ( ( xLength % cryptoBLOCK_SIZE ) == 0 );
+    }
+
+    if( xComplete == false )
+    {
+        memcpy( ucBlock, ucSubkey, cryptoBLOCK_SIZE );
+        prvCmacSubkey( ucBlock, ucSubkey );
+    }
+
+    for( x = 0; x < ( xBlocks - 1 ); x++ )
+    {
+        for( y = 0; y < cryptoBLOCK_SIZE; y++ )
+        {
+            ucState[ y ] ^= pucData[ ( x * cryptoBLOCK_SIZE ) + y ];
+        }
+
+        CryptoAesEncrypt( pucKey, ucState, ucState );
+    }
+
+    /* Last block, padded with 10...0 if incomplete, then XORed with the subkey. */
+    xLast = xLength - ( ( xBlocks - 1 ) * cryptoBLOCK_SIZE );
+    memset( ucBlock, 0, cryptoBLOCK_SIZE );
+    memcpy( ucBlock, &pucData[ ( xBlocks - 1 ) * cryptoBLOCK_SIZE ], xLast );
+
+    if( xComplete == false )
+    {
+        ucBlock[ xLast ] = 0x80;
+    }
+
+    for( y = 0; y < cryptoBLOCK_SIZE; y++ )
+    {
+        ucState[ y ] ^= ( uint8_t ) ( ucBlock[ y ] ^ ucSubkey[ y ] );
+    }
+
+    CryptoAesEncrypt( pucKey, ucState, pucMac );
+}
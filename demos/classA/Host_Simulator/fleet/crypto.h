@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file crypto.h
+ * @brief AES-128 and AES-CMAC for the network server stand-in of the fleet simulator.
+ *
+ * The LoRaMac-node soft secure element only implements the AES encryption, which is all an end device needs.
+ * A network server also needs the AES decryption to encrypt a join accept, so the fleet simulator carries its
+ * own small implementation. It is not hardened against side channels and must not be used outside the simulator.
+ */
+
+#ifndef CRYPTO_H
+#define CRYPTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Size of an AES block and of an AES-128 key.
+ */
+#define cryptoBLOCK_SIZE    ( 16 )
+
+/**
+ * @brief Encrypts one block with AES-128.
+ *
+ * @param[in] pucKey 128 bits key.
+ * @param[in] pucIn Plain text block.
+ * @param[out] pucOut Cipher text block, can be the same as pucIn.
+ */
+void CryptoAesEncrypt( const uint8_t * pucKey,
+                       const uint8_t * pucIn,
+                       uint8_t * pucOut );
+
+/**
+ * @brief Decrypts one block with AES-128.
+ *
+ * @param[in] pucKey 128 bits key.
+ * @param[in] pucIn Cipher text block.
+ * @param[out] pucOut Plain text block, can be the same as pucIn.
+ */
+void CryptoAesDecrypt( const uint8_t * pucKey,
+                       const uint8_t * pucIn,
+                       uint8_t * pucOut );
+
+/**
+ * @brief Computes the AES-CMAC of a message (RFC 4493).
+ *
+ * @param[in] pucKey 128 bits key.
+ * @param[in] pucData Message.
+ * @param[in] xLength Length of the message.
+ * @param[out] pucMac 16 bytes MAC.
+ */
+void CryptoCmac( const uint8_t * pucKey,
+                 const uint8_t * pucData,
+                 size_t xLength,
+                 uint8_t * pucMac );
+
+#endif /* CRYPTO_H */
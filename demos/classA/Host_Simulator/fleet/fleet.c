@@ -0,0 +1,1587 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file fleet.c
+ * @brief Fleet simulator coordinator.
+ *
+ * Runs N host simulator processes of the class A demo against a shared channel model and a network server
+ * stand-in, and reports the packet delivery ratio, join completion time, downlink round trip latency, throughput
+ * and airtime per device. Each device process is connected through a socket and advances its virtual clock only
+ * when granted by the coordinator, see sim_fleet_protocol.h. Devices are granted one at a time, in the order of
+ * the requested times and then of the device index, so a fleet run is reproducible for a given seed.
+ *
+ * With -B the gateway sends the class B beacons, and the report includes the beacons received and the receiver on
+ * time of the devices, to weigh the downlink latency of class B against its energy cost. With -C the network server
+ * sends the application payloads right away, to devices which keep their receiver on in class C: a downlink is
+ * delivered to every device listening on its channel when it ends, in place of the next grant of the device.
+ *
+ * With -M the devices move within the cell at the given speed, each from one random waypoint to the next, and -f adds
+ * a log-normal shadowing drawn for each frame, to evaluate the data rate adaptation of mobile devices.
+ *
+ * Usage: fleet -e <device executable> [-n <devices>] [-d <seconds>] [-s <seed>] [-r <radius m>]
+ *              [-x <path loss exponent>] [-g <demodulators>] [-b <boot spread seconds>] [-t <gateway dBm>]
+ *              [-w <1|2>] [-a <downlink interval seconds>] [-k <payloads per downlink burst>]
+ *              [-m <ADR margin dB>] [-o] [-c <RTC tolerance ppm>] [-M <speed m/s>] [-f <shadowing dB>]
+ *              [-B] [-C] [-p] [-v]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sim_fleet_protocol.h"
+#include "sim_credentials.h"
+#include "channel.h"
+#include "netserver.h"
+
+/**
+ * @brief Default simulation parameters.
+ */
+#define fleetDEFAULT_DEVICES            ( 10 )
+#define fleetDEFAULT_DURATION_SECONDS   ( 86400ULL )
+#define fleetDEFAULT_SEED               ( 1 )
+#define fleetDEFAULT_RADIUS_M           ( 5000.0 )
+#define fleetDEFAULT_DEMODULATORS       ( 8 )
+#define fleetDEFAULT_GATEWAY_POWER_DBM  ( 27 )
+#define fleetDEFAULT_ADR_MARGIN_DB      ( 10.0 )
+#define fleetDEFAULT_PAYLOADS_PER_BURST ( 1 )
+
+/**
+ * @brief GPS time at the start of the simulation, 2026-01-01 00:00:00 UTC.
+ */
+#define fleetDEFAULT_GPS_TIME_MS        ( 1451260818000ULL )
+
+/**
+ * @brief Default propagation model: free space loss at 1 m for 915 MHz, suburban path loss exponent.
+ */
+#define fleetDEFAULT_PATH_LOSS_REF_DB   ( 31.7 )
+#define fleetDEFAULT_REF_DISTANCE_M     ( 1.0 )
+#define fleetDEFAULT_PATH_LOSS_EXPONENT ( 2.7 )
+
+/**
+ * @brief LoRaWAN message types, from the MHDR of a frame.
+ */
+#define fleetMTYPE_JOIN_REQUEST         ( 0 )
+
+/**
+ * @brief Application downlinks queued by the fleet on the network server.
+ */
+#define fleetAPPLICATION_PORT           ( 2 )
+#define fleetAPPLICATION_PAYLOAD_SIZE   ( 8 )
+
+/**
+ * @brief A receiver locks on a downlink if it is listening before the last fleetMIN_PREAMBLE_SYMBOLS symbols of
+ * the fleetPREAMBLE_SYMBOLS symbols preamble.
+ */
+#define fleetPREAMBLE_SYMBOLS           ( 8 )
+#define fleetMIN_PREAMBLE_SYMBOLS       ( 4 )
+
+/**
+ * @brief Time before the start of a beacon period at which the beacon is handed over to the gateway, so that it is
+ * known before any device opens its beacon window.
+ */
+#define fleetBEACON_LEAD_MS             ( 10000ULL )
+
+/**
+ * @brief Kinds of coordinator events. For events due at the same time, the kind sets the processing order.
+ */
+typedef enum FleetEventKind
+{
+    FLEET_EVENT_UPLINK_END = 0, /**< @brief An uplink ends, evaluate its outcome. */
+    FLEET_EVENT_APPLICATION,    /**< @brief Queue application downlinks for a device. */
+    FLEET_EVENT_BEACON,         /**< @brief Send the beacon of the next beacon period. */
+    FLEET_EVENT_RECEIVE,        /**< @brief A downlink ends, deliver it to a device listening without timeout. */
+    FLEET_EVENT_BOOT,           /**< @brief Start a device process. */
+    FLEET_EVENT_GRANT           /**< @brief Let a device advance its clock. */
+} FleetEventKind_t;
+
+/**
+ * @brief Coordinator event.
+ */
+typedef struct FleetEvent
+{
+    uint64_t ullTimeMs;       /**< @brief Global time of the event. */
+    FleetEventKind_t xKind;
+    uint32_t ulDevice;        /**< @brief Device the event refers to. */
+    uint32_t ulGeneration;    /**< @brief Device generation when the event was queued, stale grants are dropped.
+                               * Receiver session for FLEET_EVENT_RECEIVE. */
+    int32_t lUplink;          /**< @brief Channel handle, FLEET_EVENT_UPLINK_END only. */
+    bool xJoinRequest;        /**< @brief Set if the uplink is a join request, FLEET_EVENT_UPLINK_END only. */
+    uint64_t ullDownlink;     /**< @brief Downlink identifier, FLEET_EVENT_RECEIVE only. */
+    uint64_t ullSequence;     /**< @brief Tie breaker. */
+} FleetEvent_t;
+
+/**
+ * @brief Simulated end device.
+ */
+typedef struct FleetDevice
+{
+    pid_t xPid;
+    int iSocket;
+    bool xAlive;
+    uint64_t ullBootMs;        /**< @brief Global time at which the device boots. */
+    uint32_t ulGeneration;
+    double dDistanceM;         /**< @brief Distance to the gateway. */
+    double dX;                 /**< @brief Position relative to the gateway, for the moving devices. */
+    double dY;
+    double dWaypointX;         /**< @brief Position the device moves to. */
+    double dWaypointY;
+    uint64_t ullPositionMs;    /**< @brief Global time of the position. */
+    double dRtcDriftPpm;       /**< @brief Frequency error of the RTC crystal. */
+
+    uint32_t ulUplinks;        /**< @brief Frames sent, join requests excluded. */
+    uint32_t ulDelivered;      /**< @brief Frames received by the gateway, join requests excluded. */
+    uint32_t ulJoinRequests;
+    uint32_t ulJoinDelivered;
+    uint32_t ulLost[ CHANNEL_OUTCOME_MAX ];
+    uint64_t ullAirtimeMs;
+    bool xJoined;
+    uint64_t ullJoinTimeMs;    /**< @brief Time from boot to the reception of the first join accept. */
+    uint8_t ucSpreadingFactor; /**< @brief Spreading factor of the last uplink. */
+
+    uint32_t ulDownlinks;      /**< @brief Downlinks, join accepts included, sent by the gateway. */
+    uint32_t ulDownlinksReceived;
+    uint32_t ulDownlinksMissed;
+    uint32_t ulApplicationSequence;
+    uint32_t ulBeaconsReceived;
+    uint64_t ullRxOnMs;        /**< @brief Time the receiver was on. */
+    bool xRxOpen;              /**< @brief Set while the receiver is on without timeout. */
+    uint64_t ullRxOpenMs;      /**< @brief Global time the receiver was turned on without timeout. */
+    uint32_t ulRxSession;      /**< @brief Incremented each time the receiver is turned on without timeout. */
+    SimFleetRadioParams_t xRxRadio; /**< @brief Parameters of the receiver on without timeout. */
+
+    uint8_t ucUplinkSize;      /**< @brief Frame on the air, the radio of a device sends one at a time. */
+    uint8_t ucUplinkFrame[ simfleetMAX_FRAME_SIZE ];
+} FleetDevice_t;
+
+/**
+ * @brief Downlink transmitted by the gateway.
+ */
+typedef struct FleetDownlink
+{
+    NetServerDownlink_t xDownlink;
+    uint64_t ullEndMs;         /**< @brief Global time at which the transmission ends. */
+    uint64_t ullId;
+    bool xReceived;            /**< @brief Set once received by the device it is addressed to, unused for beacons. */
+} FleetDownlink_t;
+
+/**
+ * @brief Growable array of latency samples, in ms.
+ */
+typedef struct FleetSamples
+{
+    uint64_t * pullSamples;
+    size_t xCount;
+    size_t xCapacity;
+} FleetSamples_t;
+
+/**
+ * @brief Simulation options.
+ */
+typedef struct FleetOptions
+{
+    const char * pcExecutable;
+    uint32_t ulDevices;
+    uint64_t ullDurationMs;
+    uint32_t ulSeed;
+    double dRadiusM;
+    double dPathLossExponent;
+    uint32_t ulDemodulators;
+    uint64_t ullBootSpreadMs;
+    int8_t cGatewayPower;
+    uint8_t ucPreferredWindow;
+    uint64_t ullApplicationIntervalMs;
+    uint32_t ulPayloadsPerBurst;
+    double dAdrMarginDb;
+    bool xAdr;
+    double dRtcTolerancePpm;
+    double dSpeedMps;
+    double dShadowingDb;
+    bool xBeacons;
+    bool xClassC;
+    bool xPerDevice;
+    bool xVerbose;
+} FleetOptions_t;
+
+static FleetOptions_t xOptions;
+static FleetDevice_t * pxDevices = NULL;
+
+/**
+ * @brief Event queue, a binary min-heap.
+ */
+static FleetEvent_t * pxEvents = NULL;
+static size_t xEventCount = 0;
+static size_t xEventCapacity = 0;
+static uint64_t ullNextSequence = 0;
+
+/**
+ * @brief Downlinks on the air or scheduled, in the order they were handed over to the gateway.
+ */
+static FleetDownlink_t * pxDownlinks = NULL;
+static size_t xDownlinkCount = 0;
+static size_t xDownlinkCapacity = 0;
+static uint64_t ullNextDownlinkId = 0;
+
+static FleetSamples_t xRoundTripLatency;
+static FleetSamples_t xApplicationLatency;
+static uint64_t ullApplicationBytesReceived = 0;
+static uint32_t ulBeaconsSent = 0;
+
+/**
+ * @brief State of the xorshift64 random number generator.
+ */
+static uint64_t ullRandomState = 1;
+
+/*-----------------------------------------------------------*/
+
+static double prvRandom( void )
+{
+    ullRandomState ^= ullRandomState << 13;
+    ullRandomState ^= ullRandomState >> 7;
+    ullRandomState ^= ullRandomState << 17;
+
+    return ( double ) ( ullRandomState >> 11 ) / ( double ) ( 1ULL << 53 );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns a shadowing loss drawn from a normal distribution of standard deviation -f, in dB.
+ */
+static double prvShadowing( void )
+{
+    double dU1;
+
+    if( xOptions.dShadowingDb <= 0.0 )
+    {
+        return 0.0;
+    }
+
+    /* Box-Muller transform, the draw must not be 0 for the logarithm. */
+    dU1 = 1.0 - prvRandom();
+
+    return xOptions.dShadowingDb * sqrt( -2.0 * log( dU1 ) ) * cos( 2.0 * M_PI * prvRandom() );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Picks a position uniformly over the cell.
+ */
+static void prvRandomPosition( double * pdX,
+                               double * pdY )
+{
+    double dRadiusM = xOptions.dRadiusM * sqrt( prvRandom() );
+    double dAngle = 2.0 * M_PI * prvRandom();
+
+    *pdX = dRadiusM * cos( dAngle );
+    *pdY = dRadiusM * sin( dAngle );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Moves a device to its position at a global time, following the random waypoint model.
+ */
+static void prvMoveDevice( FleetDevice_t * pxDevice,
+                           uint64_t ullNowMs )
+{
+    double dStepM, dLegM;
+
+    if( ( xOptions.dSpeedMps <= 0.0 ) || ( ullNowMs <= pxDevice->ullPositionMs ) )
+    {
+        return;
+    }
+
+    dStepM = xOptions.dSpeedMps * ( double ) ( ullNowMs - pxDevice->ullPositionMs ) / 1000.0;
+    pxDevice->ullPositionMs = ullNowMs;
+
+    for( ; ; )
+    {
+        dLegM = hypot( pxDevice->dWaypointX - pxDevice->dX, pxDevice->dWaypointY - pxDevice->dY );
+
+        if( dStepM < dLegM )
+        {
+            pxDevice->dX += ( pxDevice->dWaypointX - pxDevice->dX ) * dStepM / dLegM;
+            pxDevice->dY += ( pxDevice->dWaypointY - pxDevice->dY ) * dStepM / dLegM;
+            break;
+        }
+
+        dStepM -= dLegM;
+        pxDevice->dX = pxDevice->dWaypointX;
+        pxDevice->dY = pxDevice->dWaypointY;
+        prvRandomPosition( &pxDevice->dWaypointX, &pxDevice->dWaypointY );
+    }
+
+    pxDevice->dDistanceM = hypot( pxDevice->dX, pxDevice->dY );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvEventBefore( const FleetEvent_t * pxA,
+                            const FleetEvent_t * pxB )
+{
+    if( pxA->ullTimeMs != pxB->ullTimeMs )
+    {
+        return pxA->ullTimeMs < pxB->ullTimeMs;
+    }
+
+    if( pxA->xKind != pxB->xKind )
+    {
+        return pxA->xKind < pxB->xKind;
+    }
+
+    if( pxA->ulDevice != pxB->ulDevice )
+    {
+        return pxA->ulDevice < pxB->ulDevice;
+    }
+
+    return pxA->ullSequence < pxB->ullSequence;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPushEvent( FleetEvent_t xEvent )
+{
+    FleetEvent_t xSwap;
+    size_t xIndex;
+
+    if( xEventCount == xEventCapacity )
+    {
+        xEventCapacity = ( xEventCapacity == 0 ) ? 64 : ( xEventCapacity * 2 );
+        pxEvents = realloc( pxEvents, xEventCapacity * sizeof( FleetEvent_t ) );
+
+        if( pxEvents == NULL )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    xEvent.ullSequence = ullNextSequence++;
+    xIndex = xEventCount++;
+    pxEvents[ xIndex ] = xEvent;
+
+    while( ( xIndex > 0 ) && prvEventBefore( &pxEvents[ xIndex ], &pxEvents[ ( xIndex - 1 ) / 2 ] ) )
+    {
+        xSwap = pxEvents[ xIndex ];
+        pxEvents[ xIndex ] = pxEvents[ ( xIndex - 1 ) / 2 ];
+        pxEvents[ ( xIndex - 1 ) / 2 ] = xSwap;
+        xIndex = ( xIndex - 1 ) / 2;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static FleetEvent_t prvPopEvent( void )
+{
+    FleetEvent_t xTop = pxEvents[ 0 ];
+    FleetEvent_t xSwap;
+    size_t xIndex = 0;
+    size_t xChild;
+
+    pxEvents[ 0 ] = pxEvents[ --xEventCount ];
+
+    for( ; ; )
+    {
+        xChild = ( 2 * xIndex ) + 1;
+
+        if( xChild >= xEventCount )
+        {
+            break;
+        }
+
+        if( ( ( xChild + 1 ) < xEventCount ) && prvEventBefore( &pxEvents[ xChild + 1 ], &pxEvents[ xChild ] ) )
+        {
+            xChild++;
+        }
+
+        if( prvEventBefore( &pxEvents[ xChild ], &pxEvents[ xIndex ] ) == false )
+        {
+            break;
+        }
+
+        xSwap = pxEvents[ xIndex ];
+        pxEvents[ xIndex ] = pxEvents[ xChild ];
+        pxEvents[ xChild ] = xSwap;
+        xIndex = xChild;
+    }
+
+    return xTop;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAddSample( FleetSamples_t * pxSamples,
+                          uint64_t ullSampleMs )
+{
+    if( pxSamples->xCount == pxSamples->xCapacity )
+    {
+        pxSamples->xCapacity = ( pxSamples->xCapacity == 0 ) ? 64 : ( pxSamples->xCapacity * 2 );
+        pxSamples->pullSamples = realloc( pxSamples->pullSamples, pxSamples->xCapacity * sizeof( uint64_t ) );
+
+        if( pxSamples->pullSamples == NULL )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    pxSamples->pullSamples[ pxSamples->xCount++ ] = ullSampleMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSendMessage( FleetDevice_t * pxDevice,
+                            SimFleetMessageType_t xType,
+                            uint64_t ullGlobalMs )
+{
+    SimFleetMessage_t xMessage = { 0 };
+
+    xMessage.ulType = xType;
+    xMessage.ullTimeMs = ullGlobalMs - pxDevice->ullBootMs;
+
+    if( send( pxDevice->iSocket, &xMessage, sizeof( xMessage ), MSG_NOSIGNAL ) != ( ssize_t ) sizeof( xMessage ) )
+    {
+        pxDevice->xAlive = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Accounts for the receiver of a device left on without timeout, which the next transmission or reception
+ * turns off.
+ */
+static void prvStopReceiver( FleetDevice_t * pxDevice,
+                             uint64_t ullNowMs )
+{
+    if( pxDevice->xRxOpen == true )
+    {
+        pxDevice->ullRxOnMs += ullNowMs - pxDevice->ullRxOpenMs;
+        pxDevice->xRxOpen = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnTransmit( uint32_t ulDevice,
+                           const SimFleetMessage_t * pxMessage )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+    ChannelUplink_t xUplink = { 0 };
+    FleetEvent_t xEvent = { 0 };
+    bool xJoinRequest = ( pxMessage->ucSize > 0 ) && ( ( pxMessage->ucFrame[ 0 ] >> 5 ) == fleetMTYPE_JOIN_REQUEST );
+
+    xUplink.ulDevice = ulDevice;
+    xUplink.ullStartMs = pxDevice->ullBootMs + pxMessage->ullTimeMs;
+    xUplink.ullEndMs = xUplink.ullStartMs + pxMessage->xRadio.ulDurationMs;
+    xUplink.ulFrequency = pxMessage->xRadio.ulFrequency;
+    xUplink.ucSpreadingFactor = pxMessage->xRadio.ucSpreadingFactor;
+    xUplink.ucBandwidth = pxMessage->xRadio.ucBandwidth;
+
+    prvMoveDevice( pxDevice, xUplink.ullStartMs );
+    xUplink.dRssiDbm = ChannelRssi( pxMessage->xRadio.cPower, pxDevice->dDistanceM ) - prvShadowing();
+
+    prvStopReceiver( pxDevice, xUplink.ullStartMs );
+
+    pxDevice->ucSpreadingFactor = pxMessage->xRadio.ucSpreadingFactor;
+    pxDevice->ucUplinkSize = pxMessage->ucSize;
+    memcpy( pxDevice->ucUplinkFrame, pxMessage->ucFrame, pxMessage->ucSize );
+
+    if( xJoinRequest == true )
+    {
+        pxDevice->ulJoinRequests++;
+    }
+    else
+    {
+        pxDevice->ulUplinks++;
+    }
+
+    pxDevice->ullAirtimeMs += pxMessage->xRadio.ulDurationMs;
+
+    xEvent.ullTimeMs = xUplink.ullEndMs;
+    xEvent.xKind = FLEET_EVENT_UPLINK_END;
+    xEvent.ulDevice = ulDevice;
+    xEvent.xJoinRequest = xJoinRequest;
+    xEvent.lUplink = ChannelStartUplink( &xUplink );
+
+    if( xEvent.lUplink < 0 )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    prvPushEvent( xEvent );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnUplinkEnd( const FleetEvent_t * pxEvent )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ pxEvent->ulDevice ];
+    ChannelUplink_t xUplink;
+    NetServerUplink_t xServerUplink = { 0 };
+    bool xJoinRequest = pxEvent->xJoinRequest;
+
+    ChannelEndUplink( pxEvent->lUplink, &xUplink );
+
+    pxDevice->ulLost[ xUplink.xOutcome ]++;
+
+    if( xOptions.xVerbose == true )
+    {
+        printf( "[fleet %llu ms] device %lu %s SF%u %lu Hz %.1f dBm: %s\n",
+                ( unsigned long long ) xUplink.ullEndMs, ( unsigned long ) pxEvent->ulDevice,
+                xJoinRequest ? "join request" : "uplink", xUplink.ucSpreadingFactor,
+                ( unsigned long ) xUplink.ulFrequency, xUplink.dRssiDbm, ChannelOutcomeName( xUplink.xOutcome ) );
+    }
+
+    if( xUplink.xOutcome == CHANNEL_DELIVERED )
+    {
+        if( xJoinRequest == true )
+        {
+            pxDevice->ulJoinDelivered++;
+        }
+        else
+        {
+            pxDevice->ulDelivered++;
+        }
+
+        /* The network server may answer, scheduling downlinks through prvOnGatewayTransmit(). */
+        xServerUplink.ullStartMs = xUplink.ullStartMs;
+        xServerUplink.ullEndMs = xUplink.ullEndMs;
+        xServerUplink.ulFrequency = xUplink.ulFrequency;
+        xServerUplink.ucSpreadingFactor = xUplink.ucSpreadingFactor;
+        xServerUplink.ucBandwidth = xUplink.ucBandwidth;
+        xServerUplink.dRssiDbm = xUplink.dRssiDbm;
+        xServerUplink.dSnrDb = ChannelSnr( xUplink.dRssiDbm, xUplink.ucBandwidth );
+        xServerUplink.pucFrame = pxDevice->ucUplinkFrame;
+        xServerUplink.ucSize = pxDevice->ucUplinkSize;
+        NetServerOnUplink( &xServerUplink );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static const char * prvWindowName( uint8_t ucWindow )
+{
+    switch( ucWindow )
+    {
+        case 1:
+            return "RX1";
+
+        case 2:
+            return "RX2";
+
+        case netserverWINDOW_CLASS_C:
+            return "class C";
+
+        default:
+            return "ping slot";
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Transmits a downlink of the network server, if the gateway is free at that time, and queues its delivery
+ * to the devices listening on its channel without timeout.
+ */
+static bool prvOnGatewayTransmit( const NetServerDownlink_t * pxDownlink )
+{
+    FleetDownlink_t * pxEntry;
+    FleetEvent_t xEvent = { 0 };
+    uint32_t ulDevice;
+    uint64_t ullEndMs = pxDownlink->ullStartMs +
+                        ChannelTimeOnAir( pxDownlink->ucSpreadingFactor, pxDownlink->ucBandwidth, 1,
+                                          pxDownlink->ucSize, false );
+
+    if( ChannelGatewayTransmit( pxDownlink->ullStartMs, ullEndMs ) == false )
+    {
+        return false;
+    }
+
+    if( xDownlinkCount == xDownlinkCapacity )
+    {
+        xDownlinkCapacity = ( xDownlinkCapacity == 0 ) ? 16 : ( xDownlinkCapacity * 2 );
+        pxDownlinks = realloc( pxDownlinks, xDownlinkCapacity * sizeof( FleetDownlink_t ) );
+
+        if( pxDownlinks == NULL )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    pxEntry = &pxDownlinks[ xDownlinkCount++ ];
+    pxEntry->xDownlink = *pxDownlink;
+    pxEntry->ullEndMs = ullEndMs;
+    pxEntry->ullId = ullNextDownlinkId++;
+    pxEntry->xReceived = false;
+
+    xEvent.ullTimeMs = ullEndMs;
+    xEvent.xKind = FLEET_EVENT_RECEIVE;
+    xEvent.ullDownlink = pxEntry->ullId;
+
+    for( ulDevice = 0; ulDevice < xOptions.ulDevices; ulDevice++ )
+    {
+        const FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+
+        if( ( pxDevice->xAlive == true ) && ( pxDevice->xRxOpen == true ) &&
+            ( pxDevice->xRxRadio.ulFrequency == pxDownlink->ulFrequency ) &&
+            ( pxDevice->xRxRadio.ucSpreadingFactor == pxDownlink->ucSpreadingFactor ) &&
+            ( pxDevice->xRxRadio.ucBandwidth == pxDownlink->ucBandwidth ) )
+        {
+            xEvent.ulDevice = ulDevice;
+            xEvent.ulGeneration = pxDevice->ulRxSession;
+            prvPushEvent( xEvent );
+        }
+    }
+
+    if( pxDownlink->xBeacon == true )
+    {
+        ulBeaconsSent++;
+    }
+    else
+    {
+        pxDevices[ pxDownlink->ulDevice ].ulDownlinks++;
+    }
+
+    if( ( xOptions.xVerbose == true ) && ( pxDownlink->xBeacon == true ) )
+    {
+        printf( "[fleet %llu ms] beacon SF%u %lu Hz\n", ( unsigned long long ) pxDownlink->ullStartMs,
+                pxDownlink->ucSpreadingFactor, ( unsigned long ) pxDownlink->ulFrequency );
+    }
+    else if( xOptions.xVerbose == true )
+    {
+        printf( "[fleet %llu ms] device %lu %s %s SF%u %lu Hz, %u bytes\n",
+                ( unsigned long long ) pxDownlink->ullStartMs, ( unsigned long ) pxDownlink->ulDevice,
+                pxDownlink->xJoinAccept ? "join accept" : "downlink", prvWindowName( pxDownlink->ucWindow ),
+                pxDownlink->ucSpreadingFactor, ( unsigned long ) pxDownlink->ulFrequency, pxDownlink->ucSize );
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Forgets the downlinks which ended before the given time, counting those never received as missed.
+ */
+static void prvPruneDownlinks( uint64_t ullNowMs )
+{
+    size_t xIndex, xKept = 0;
+
+    for( xIndex = 0; xIndex < xDownlinkCount; xIndex++ )
+    {
+        if( pxDownlinks[ xIndex ].ullEndMs >= ullNowMs )
+        {
+            pxDownlinks[ xKept++ ] = pxDownlinks[ xIndex ];
+        }
+        else if( ( pxDownlinks[ xIndex ].xReceived == false ) && ( pxDownlinks[ xIndex ].xDownlink.xBeacon == false ) )
+        {
+            pxDevices[ pxDownlinks[ xIndex ].xDownlink.ulDevice ].ulDownlinksMissed++;
+        }
+    }
+
+    xDownlinkCount = xKept;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Delivers a downlink to a device if it is strong enough, filling in the reply to the device.
+ *
+ * @return true if the device receives the downlink.
+ */
+static bool prvDeliver( uint32_t ulDevice,
+                        FleetDownlink_t * pxReceived,
+                        SimFleetMessage_t * pxReply )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+    double dRssiDbm;
+    double dSnrDb;
+
+    prvMoveDevice( pxDevice, pxReceived->ullEndMs );
+    dRssiDbm = ChannelRssi( xOptions.cGatewayPower, pxDevice->dDistanceM ) - prvShadowing();
+    dSnrDb = ChannelSnr( dRssiDbm, pxReceived->xDownlink.ucBandwidth );
+
+    if( dRssiDbm < ChannelSensitivity( pxReceived->xDownlink.ucSpreadingFactor, pxReceived->xDownlink.ucBandwidth ) )
+    {
+        return false;
+    }
+
+    pxReply->ullTimeMs = pxReceived->ullEndMs - pxDevice->ullBootMs;
+    pxReply->sRssi = ( int16_t ) lround( dRssiDbm );
+    pxReply->cSnr = ( int8_t ) lround( ( dSnrDb > 127.0 ) ? 127.0 : dSnrDb );
+    pxReply->ucSize = pxReceived->xDownlink.ucSize;
+    memcpy( pxReply->ucFrame, pxReceived->xDownlink.ucFrame, pxReply->ucSize );
+
+    if( pxReceived->xDownlink.xBeacon == true )
+    {
+        pxDevice->ulBeaconsReceived++;
+
+        if( xOptions.xVerbose == true )
+        {
+            printf( "[fleet %llu ms] device %lu received beacon, %.1f dBm\n",
+                    ( unsigned long long ) pxReceived->ullEndMs, ( unsigned long ) ulDevice, dRssiDbm );
+        }
+    }
+    else if( ( pxReceived->xDownlink.ulDevice == ulDevice ) && ( pxReceived->xReceived == false ) )
+    {
+        pxReceived->xReceived = true;
+        pxDevice->ulDownlinksReceived++;
+
+        if( pxReceived->xDownlink.xJoinAccept == true )
+        {
+            if( pxDevice->xJoined == false )
+            {
+                pxDevice->xJoined = true;
+                pxDevice->ullJoinTimeMs = pxReceived->ullEndMs - pxDevice->ullBootMs;
+            }
+        }
+        else
+        {
+            /* Ping slot and class C downlinks do not answer an uplink. */
+            if( ( pxReceived->xDownlink.ucWindow == 1 ) || ( pxReceived->xDownlink.ucWindow == 2 ) )
+            {
+                prvAddSample( &xRoundTripLatency, pxReceived->ullEndMs - pxReceived->xDownlink.ullUplinkStartMs );
+            }
+
+            if( pxReceived->xDownlink.ucPayloadSize > 0 )
+            {
+                prvAddSample( &xApplicationLatency, pxReceived->ullEndMs - pxReceived->xDownlink.ullQueuedMs );
+                ullApplicationBytesReceived += pxReceived->xDownlink.ucPayloadSize;
+            }
+        }
+
+        if( xOptions.xVerbose == true )
+        {
+            printf( "[fleet %llu ms] device %lu received %s %s, %.1f dBm\n",
+                    ( unsigned long long ) pxReceived->ullEndMs, ( unsigned long ) ulDevice,
+                    prvWindowName( pxReceived->xDownlink.ucWindow ),
+                    pxReceived->xDownlink.xJoinAccept ? "join accept" : "downlink", dRssiDbm );
+        }
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Finds the downlink a device receives with its receiver turned on, and replies with it.
+ * Downlinks are broadcast: a device also receives those addressed to other devices, and discards them itself.
+ * A receiver turned on without timeout which does not find a downlink already scheduled is left open, and receives
+ * the next one on its channel through prvOnAsyncReceive().
+ */
+static void prvOnReceive( uint32_t ulDevice,
+                          const SimFleetMessage_t * pxMessage )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+    FleetDownlink_t * pxReceived = NULL;
+    SimFleetMessage_t xReply = { 0 };
+    uint64_t ullOpenMs = pxDevice->ullBootMs + pxMessage->ullTimeMs;
+    double dSymbolMs;
+    size_t xIndex;
+
+    prvStopReceiver( pxDevice, ullOpenMs );
+
+    for( xIndex = 0; xIndex < xDownlinkCount; xIndex++ )
+    {
+        FleetDownlink_t * pxEntry = &pxDownlinks[ xIndex ];
+        const NetServerDownlink_t * pxDownlink = &pxEntry->xDownlink;
+
+        if( ( pxDownlink->ulFrequency != pxMessage->xRadio.ulFrequency ) ||
+            ( pxDownlink->ucSpreadingFactor != pxMessage->xRadio.ucSpreadingFactor ) ||
+            ( pxDownlink->ucBandwidth != pxMessage->xRadio.ucBandwidth ) )
+        {
+            continue;
+        }
+
+        /* The receiver must be on before the end of the preamble, and the preamble must start before the receive
+         * window times out. */
+        dSymbolMs = ( double ) ( 1UL << pxDownlink->ucSpreadingFactor ) / ( 125.0 * ( double ) ( 1U << pxDownlink->ucBandwidth ) );
+
+        if( ( ( double ) ullOpenMs > ( ( double ) pxDownlink->ullStartMs +
+                                       ( ( fleetPREAMBLE_SYMBOLS - fleetMIN_PREAMBLE_SYMBOLS ) * dSymbolMs ) ) ) ||
+            ( ( pxMessage->xRadio.ulDurationMs > 0 ) &&
+              ( pxDownlink->ullStartMs > ( ullOpenMs + pxMessage->xRadio.ulDurationMs ) ) ) )
+        {
+            continue;
+        }
+
+        if( ( pxReceived == NULL ) || ( pxDownlink->ullStartMs < pxReceived->xDownlink.ullStartMs ) )
+        {
+            pxReceived = pxEntry;
+        }
+    }
+
+    xReply.ulType = SIMFLEET_MSG_RX_DONE;
+    xReply.ullTimeMs = pxMessage->ullTimeMs;
+
+    if( ( pxReceived != NULL ) && ( prvDeliver( ulDevice, pxReceived, &xReply ) == true ) )
+    {
+        pxDevice->ullRxOnMs += pxReceived->ullEndMs - ullOpenMs;
+    }
+    else if( pxMessage->xRadio.ulDurationMs > 0 )
+    {
+        pxDevice->ullRxOnMs += pxMessage->xRadio.ulDurationMs;
+    }
+    else
+    {
+        pxDevice->xRxOpen = true;
+        pxDevice->ullRxOpenMs = ullOpenMs;
+        pxDevice->ulRxSession++;
+        pxDevice->xRxRadio = pxMessage->xRadio;
+    }
+
+    if( send( pxDevice->iSocket, &xReply, sizeof( xReply ), MSG_NOSIGNAL ) != ( ssize_t ) sizeof( xReply ) )
+    {
+        pxDevice->xAlive = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRunDevice( uint32_t ulDevice );
+
+/**
+ * @brief Delivers a downlink which just ended to a device whose receiver was left on without timeout since before
+ * it started. The device receives it in place of its next grant, then runs until it is blocked again.
+ */
+static void prvOnAsyncReceive( const FleetEvent_t * pxEvent )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ pxEvent->ulDevice ];
+    SimFleetMessage_t xReply = { 0 };
+    size_t xIndex;
+
+    if( ( pxDevice->xAlive == false ) || ( pxDevice->xRxOpen == false ) ||
+        ( pxDevice->ulRxSession != pxEvent->ulGeneration ) )
+    {
+        return;
+    }
+
+    for( xIndex = 0; xIndex < xDownlinkCount; xIndex++ )
+    {
+        if( pxDownlinks[ xIndex ].ullId == pxEvent->ullDownlink )
+        {
+            break;
+        }
+    }
+
+    xReply.ulType = SIMFLEET_MSG_RX_DONE;
+
+    if( ( xIndex == xDownlinkCount ) || ( prvDeliver( pxEvent->ulDevice, &pxDownlinks[ xIndex ], &xReply ) == false ) )
+    {
+        return;
+    }
+
+    prvStopReceiver( pxDevice, pxEvent->ullTimeMs );
+
+    if( send( pxDevice->iSocket, &xReply, sizeof( xReply ), MSG_NOSIGNAL ) != ( ssize_t ) sizeof( xReply ) )
+    {
+        pxDevice->xAlive = false;
+    }
+
+    prvRunDevice( pxEvent->ulDevice );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queues a burst of application downlinks for a device on the network server.
+ */
+static void prvOnApplication( const FleetEvent_t * pxEvent )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ pxEvent->ulDevice ];
+    uint8_t ucPayload[ fleetAPPLICATION_PAYLOAD_SIZE ] = { 0 };
+    FleetEvent_t xEvent = *pxEvent;
+    uint32_t x;
+
+    for( x = 0; x < xOptions.ulPayloadsPerBurst; x++ )
+    {
+        memcpy( ucPayload, &pxDevice->ulApplicationSequence, sizeof( pxDevice->ulApplicationSequence ) );
+        pxDevice->ulApplicationSequence++;
+        ( void ) NetServerQueueDownlink( pxEvent->ulDevice, fleetAPPLICATION_PORT, ucPayload, sizeof( ucPayload ),
+                                         pxEvent->ullTimeMs );
+    }
+
+    xEvent.ullTimeMs += xOptions.ullApplicationIntervalMs;
+    prvPushEvent( xEvent );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sends the beacon of the next beacon period, and queues the following one.
+ */
+static void prvOnBeacon( const FleetEvent_t * pxEvent )
+{
+    FleetEvent_t xEvent = *pxEvent;
+
+    NetServerSendBeacon( pxEvent->ullTimeMs + fleetBEACON_LEAD_MS );
+
+    xEvent.ullTimeMs += netserverBEACON_PERIOD_MS;
+    prvPushEvent( xEvent );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Lets a device run at the current time, until all its tasks are blocked again.
+ */
+static void prvRunDevice( uint32_t ulDevice )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+    SimFleetMessage_t xMessage;
+    FleetEvent_t xEvent = { 0 };
+    ssize_t xReceived;
+
+    while( pxDevice->xAlive == true )
+    {
+        xReceived = recv( pxDevice->iSocket, &xMessage, sizeof( xMessage ), 0 );
+
+        if( xReceived != ( ssize_t ) sizeof( xMessage ) )
+        {
+            if( ( xReceived < 0 ) && ( errno == EINTR ) )
+            {
+                continue;
+            }
+
+            fprintf( stderr, "Device %lu exited unexpectedly.\n", ( unsigned long ) ulDevice );
+            pxDevice->xAlive = false;
+            break;
+        }
+
+        if( xMessage.ulType == SIMFLEET_MSG_TX )
+        {
+            prvOnTransmit( ulDevice, &xMessage );
+        }
+        else if( xMessage.ulType == SIMFLEET_MSG_RX )
+        {
+            prvOnReceive( ulDevice, &xMessage );
+        }
+        else if( xMessage.ulType == SIMFLEET_MSG_RX_STOP )
+        {
+            prvStopReceiver( pxDevice, pxDevice->ullBootMs + xMessage.ullTimeMs );
+        }
+        else if( xMessage.ulType == SIMFLEET_MSG_ADVANCE )
+        {
+            xEvent.ullTimeMs = pxDevice->ullBootMs + xMessage.ullTimeMs;
+            xEvent.xKind = FLEET_EVENT_GRANT;
+            xEvent.ulDevice = ulDevice;
+            xEvent.ulGeneration = ++pxDevice->ulGeneration;
+            prvPushEvent( xEvent );
+            break;
+        }
+        else
+        {
+            fprintf( stderr, "Unexpected message type %lu from device %lu.\n",
+                     ( unsigned long ) xMessage.ulType, ( unsigned long ) ulDevice );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvBootDevice( uint32_t ulDevice )
+{
+    FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+    int iSockets[ 2 ];
+    char cSocket[ 16 ];
+    char cSeed[ 16 ];
+    char cIndex[ 16 ];
+    char cDrift[ 32 ];
+    int iNull;
+
+    if( socketpair( AF_UNIX, SOCK_SEQPACKET, 0, iSockets ) != 0 )
+    {
+        perror( "socketpair" );
+        exit( EXIT_FAILURE );
+    }
+
+    /* Coordinator end must not leak into the other device processes. */
+    ( void ) fcntl( iSockets[ 0 ], F_SETFD, FD_CLOEXEC );
+
+    fflush( stdout );
+    pxDevice->xPid = fork();
+
+    if( pxDevice->xPid < 0 )
+    {
+        perror( "fork" );
+        exit( EXIT_FAILURE );
+    }
+
+    if( pxDevice->xPid == 0 )
+    {
+        if( xOptions.xVerbose == false )
+        {
+            iNull = open( "/dev/null", O_WRONLY );
+
+            if( iNull >= 0 )
+            {
+                ( void ) dup2( iNull, STDOUT_FILENO );
+                ( void ) close( iNull );
+            }
+        }
+
+        ( void ) snprintf( cSocket, sizeof( cSocket ), "%d", iSockets[ 1 ] );
+        ( void ) snprintf( cSeed, sizeof( cSeed ), "%lu", ( unsigned long ) ( xOptions.ulSeed + ulDevice + 1 ) );
+        ( void ) snprintf( cIndex, sizeof( cIndex ), "%lu", ( unsigned long ) ulDevice );
+        ( void ) snprintf( cDrift, sizeof( cDrift ), "%.3f", pxDevice->dRtcDriftPpm );
+
+        /* Device runs until the coordinator ends the simulation, with the credentials provisioned on the
+         * network server. */
+        execl( xOptions.pcExecutable, xOptions.pcExecutable, "-d", "0", "-s", cSeed, "-f", cSocket, "-i", cIndex,
+               "-c", cDrift, ( char * ) NULL );
+        perror( "execl" );
+        _exit( EXIT_FAILURE );
+    }
+
+    ( void ) close( iSockets[ 1 ] );
+    pxDevice->iSocket = iSockets[ 0 ];
+    pxDevice->xAlive = true;
+
+    prvRunDevice( ulDevice );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvEndDevices( void )
+{
+    SimFleetMessage_t xMessage;
+    uint32_t ulDevice;
+
+    for( ulDevice = 0; ulDevice < xOptions.ulDevices; ulDevice++ )
+    {
+        FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+
+        prvStopReceiver( pxDevice, xOptions.ullDurationMs );
+
+        if( pxDevice->xPid > 0 )
+        {
+            if( pxDevice->xAlive == true )
+            {
+                prvSendMessage( pxDevice, SIMFLEET_MSG_END, pxDevice->ullBootMs );
+
+                /* Drain until the device closes its socket. */
+                while( recv( pxDevice->iSocket, &xMessage, sizeof( xMessage ), 0 ) > 0 )
+                {
+                }
+            }
+
+            ( void ) close( pxDevice->iSocket );
+            ( void ) waitpid( pxDevice->xPid, NULL, 0 );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvCompareTimes( const void * pvA,
+                            const void * pvB )
+{
+    uint64_t ullA = *( const uint64_t * ) pvA;
+    uint64_t ullB = *( const uint64_t * ) pvB;
+
+    return ( ullA > ullB ) - ( ullA < ullB );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintLatency( const char * pcName,
+                             FleetSamples_t * pxSamples )
+{
+    double dSum = 0.0;
+    size_t x;
+
+    if( pxSamples->xCount == 0 )
+    {
+        return;
+    }
+
+    qsort( pxSamples->pullSamples, pxSamples->xCount, sizeof( uint64_t ), prvCompareTimes );
+
+    for( x = 0; x < pxSamples->xCount; x++ )
+    {
+        dSum += ( double ) pxSamples->pullSamples[ x ];
+    }
+
+    printf( "%-20s mean %.1f ms, median %llu ms, p95 %llu ms, max %llu ms\n", pcName,
+            dSum / ( double ) pxSamples->xCount,
+            ( unsigned long long ) pxSamples->pullSamples[ pxSamples->xCount / 2 ],
+            ( unsigned long long ) pxSamples->pullSamples[ ( pxSamples->xCount * 95 ) / 100 ],
+            ( unsigned long long ) pxSamples->pullSamples[ pxSamples->xCount - 1 ] );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintReport( void )
+{
+    NetServerStats_t xServer;
+    uint64_t ullDownlinks = 0, ullDownlinksReceived = 0, ullDownlinksMissed = 0;
+    double dHours = ( double ) xOptions.ullDurationMs / 3600000.0;
+    uint64_t * pullJoinTimes = calloc( xOptions.ulDevices, sizeof( uint64_t ) );
+    uint32_t ulJoined = 0;
+    uint64_t ullUplinks = 0, ullDelivered = 0, ullJoinRequests = 0, ullJoinDelivered = 0;
+    uint64_t ullLost[ CHANNEL_OUTCOME_MAX ] = { 0 };
+    uint64_t ullAirtimeMs = 0, ullMaxAirtimeMs = 0;
+    uint64_t ullRxOnMs = 0, ullBeaconsReceived = 0;
+    double dJoinSum = 0.0;
+    uint32_t ulDevice, x;
+
+    for( ulDevice = 0; ulDevice < xOptions.ulDevices; ulDevice++ )
+    {
+        const FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+
+        ullUplinks += pxDevice->ulUplinks;
+        ullDelivered += pxDevice->ulDelivered;
+        ullJoinRequests += pxDevice->ulJoinRequests;
+        ullJoinDelivered += pxDevice->ulJoinDelivered;
+        ullAirtimeMs += pxDevice->ullAirtimeMs;
+        ullDownlinks += pxDevice->ulDownlinks;
+        ullDownlinksReceived += pxDevice->ulDownlinksReceived;
+        ullDownlinksMissed += pxDevice->ulDownlinksMissed;
+        ullRxOnMs += pxDevice->ullRxOnMs;
+        ullBeaconsReceived += pxDevice->ulBeaconsReceived;
+
+        if( pxDevice->ullAirtimeMs > ullMaxAirtimeMs )
+        {
+            ullMaxAirtimeMs = pxDevice->ullAirtimeMs;
+        }
+
+        for( x = 0; x < CHANNEL_OUTCOME_MAX; x++ )
+        {
+            ullLost[ x ] += pxDevice->ulLost[ x ];
+        }
+
+        if( ( pxDevice->xJoined == true ) && ( pullJoinTimes != NULL ) )
+        {
+            pullJoinTimes[ ulJoined++ ] = pxDevice->ullJoinTimeMs;
+            dJoinSum += ( double ) pxDevice->ullJoinTimeMs;
+        }
+    }
+
+    printf( "\n==== Fleet summary ====\n" );
+    printf( "Devices:             %lu, %llu s simulated, seed %lu\n", ( unsigned long ) xOptions.ulDevices,
+            ( unsigned long long ) ( xOptions.ullDurationMs / 1000ULL ), ( unsigned long ) xOptions.ulSeed );
+    printf( "Gateway:             %lu demodulators, cell radius %.0f m\n",
+            ( unsigned long ) xOptions.ulDemodulators, xOptions.dRadiusM );
+
+    if( ( xOptions.dSpeedMps > 0.0 ) || ( xOptions.dShadowingDb > 0.0 ) )
+    {
+        printf( "Mobility:            %.1f m/s, shadowing %.1f dB\n", xOptions.dSpeedMps, xOptions.dShadowingDb );
+    }
+
+    printf( "Uplinks:             %llu sent, %llu delivered, PDR %.2f %%\n", ( unsigned long long ) ullUplinks,
+            ( unsigned long long ) ullDelivered, ( ullUplinks > 0 ) ? ( 100.0 * ( double ) ullDelivered / ( double ) ullUplinks ) : 0.0 );
+    printf( "Join requests:       %llu sent, %llu delivered\n", ( unsigned long long ) ullJoinRequests,
+            ( unsigned long long ) ullJoinDelivered );
+
+    for( x = CHANNEL_LOST_SENSITIVITY; x < CHANNEL_OUTCOME_MAX; x++ )
+    {
+        printf( "Lost, %-17s %llu\n", ChannelOutcomeName( ( ChannelOutcome_t ) x ), ( unsigned long long ) ullLost[ x ] );
+    }
+
+    printf( "Joined devices:      %lu / %lu\n", ( unsigned long ) ulJoined, ( unsigned long ) xOptions.ulDevices );
+
+    if( ulJoined > 0 )
+    {
+        qsort( pullJoinTimes, ulJoined, sizeof( uint64_t ), prvCompareTimes );
+        printf( "Join time:           mean %.1f s, median %.1f s, p95 %.1f s, max %.1f s\n",
+                dJoinSum / ( double ) ulJoined / 1000.0,
+                ( double ) pullJoinTimes[ ulJoined / 2 ] / 1000.0,
+                ( double ) pullJoinTimes[ ( ulJoined * 95 ) / 100 ] / 1000.0,
+                ( double ) pullJoinTimes[ ulJoined - 1 ] / 1000.0 );
+    }
+
+    printf( "Airtime per device:  mean %.1f ms, max %llu ms, mean duty cycle %.4f %%\n",
+            ( double ) ullAirtimeMs / ( double ) xOptions.ulDevices, ( unsigned long long ) ullMaxAirtimeMs,
+            100.0 * ( double ) ullAirtimeMs / ( double ) xOptions.ulDevices / ( double ) xOptions.ullDurationMs );
+    printf( "Receiver on:         mean %.1f ms per device, %.4f %% of the time\n",
+            ( double ) ullRxOnMs / ( double ) xOptions.ulDevices,
+            100.0 * ( double ) ullRxOnMs / ( double ) xOptions.ulDevices / ( double ) xOptions.ullDurationMs );
+
+    NetServerGetStats( &xServer );
+
+    printf( "\n==== Network server ====\n" );
+    printf( "Gateway:             %d dBm, RX%u preferred, ADR %s\n", xOptions.cGatewayPower,
+            xOptions.ucPreferredWindow, ( xOptions.xAdr == true ) ? "on" : "off" );
+    printf( "Join accepts:        %lu for %lu join requests\n", ( unsigned long ) xServer.ulJoinAccepts,
+            ( unsigned long ) xServer.ulJoinRequests );
+    printf( "Data uplinks:        %lu, %lu retransmissions, %lu MIC failures, %lu unknown\n",
+            ( unsigned long ) xServer.ulDataUplinks, ( unsigned long ) xServer.ulRetransmissions,
+            ( unsigned long ) xServer.ulMicFailures, ( unsigned long ) xServer.ulUnknownDevices );
+    printf( "Downlinks:           %llu sent (RX1 %lu, RX2 %lu), %llu received, %llu missed, %lu gateway busy\n",
+            ( unsigned long long ) ullDownlinks, ( unsigned long ) xServer.ulDownlinksRx1,
+            ( unsigned long ) xServer.ulDownlinksRx2, ( unsigned long long ) ullDownlinksReceived,
+            ( unsigned long long ) ullDownlinksMissed, ( unsigned long ) xServer.ulDownlinksBusy );
+    printf( "MAC:                 %lu acks, %lu FPending, %lu LinkCheckAns, %lu DeviceTimeAns\n",
+            ( unsigned long ) xServer.ulAcks, ( unsigned long ) xServer.ulFramePending,
+            ( unsigned long ) xServer.ulLinkCheckAns, ( unsigned long ) xServer.ulDeviceTimeAns );
+    if( xOptions.xBeacons == true )
+    {
+        printf( "Class B:             %lu beacons sent, %.1f received per device, %lu PingSlotInfoAns, %lu ping slot downlinks\n",
+                ( unsigned long ) ulBeaconsSent, ( double ) ullBeaconsReceived / ( double ) xOptions.ulDevices,
+                ( unsigned long ) xServer.ulPingSlotInfoAns, ( unsigned long ) xServer.ulDownlinksPingSlot );
+    }
+
+    if( xOptions.xClassC == true )
+    {
+        printf( "Class C:             %lu downlinks outside the receive windows\n",
+                ( unsigned long ) xServer.ulDownlinksClassC );
+    }
+
+    printf( "LinkADRReq:          %lu sent, %lu accepted, %lu rejected\n", ( unsigned long ) xServer.ulLinkAdrReqs,
+            ( unsigned long ) xServer.ulLinkAdrAccepted, ( unsigned long ) xServer.ulLinkAdrRejected );
+    printf( "Application queue:   %lu queued, %lu sent, %lu dropped\n", ( unsigned long ) xServer.ulPayloadsQueued,
+            ( unsigned long ) xServer.ulPayloadsSent, ( unsigned long ) xServer.ulPayloadsDropped );
+    printf( "Throughput:          %.1f bytes/h up, %.1f bytes/h down\n",
+            ( double ) xServer.ullUplinkPayloadBytes / dHours, ( double ) ullApplicationBytesReceived / dHours );
+    prvPrintLatency( "Round trip:", &xRoundTripLatency );
+    prvPrintLatency( "Downlink latency:", &xApplicationLatency );
+
+    if( xOptions.xPerDevice == true )
+    {
+        printf( "\n%6s %10s %8s %8s %8s %8s %12s %12s %4s %8s %8s %12s %8s\n", "device", "distance", "uplinks", "deliv",
+                "PDR %", "joinreq", "airtime ms", "join s", "SF", "dl sent", "dl recv", "rx on ms", "beacons" );
+
+        for( ulDevice = 0; ulDevice < xOptions.ulDevices; ulDevice++ )
+        {
+            const FleetDevice_t * pxDevice = &pxDevices[ ulDevice ];
+
+            printf( "%6lu %10.0f %8lu %8lu %8.2f %8lu %12llu %12.1f %4u %8lu %8lu %12llu %8lu\n", ( unsigned long ) ulDevice,
+                    pxDevice->dDistanceM, ( unsigned long ) pxDevice->ulUplinks, ( unsigned long ) pxDevice->ulDelivered,
+                    ( pxDevice->ulUplinks > 0 ) ? ( 100.0 * ( double ) pxDevice->ulDelivered / ( double ) pxDevice->ulUplinks ) : 0.0,
+                    ( unsigned long ) pxDevice->ulJoinRequests, ( unsigned long long ) pxDevice->ullAirtimeMs,
+                    ( pxDevice->xJoined == true ) ? ( ( double ) pxDevice->ullJoinTimeMs / 1000.0 ) : -1.0,
+                    pxDevice->ucSpreadingFactor, ( unsigned long ) pxDevice->ulDownlinks,
+                    ( unsigned long ) pxDevice->ulDownlinksReceived, ( unsigned long long ) pxDevice->ullRxOnMs,
+                    ( unsigned long ) pxDevice->ulBeaconsReceived );
+        }
+    }
+
+    free( pullJoinTimes );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    fprintf( stderr,
+             "Usage: %s -e <device executable> [-n <devices>] [-d <seconds>] [-s <seed>] [-r <radius m>]\n"
+             "          [-x <path loss exponent>] [-g <demodulators>] [-b <boot spread seconds>] [-t <gateway dBm>]\n"
+             "          [-w <1|2>] [-a <downlink interval seconds>] [-k <payloads per downlink burst>]\n"
+             "          [-m <ADR margin dB>] [-o] [-c <RTC tolerance ppm>] [-M <speed m/s>] [-f <shadowing dB>]\n"
+             "          [-B] [-C] [-p] [-v]\n",
+             pcProgram );
+    exit( EXIT_FAILURE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvParseOptions( int argc,
+                             char ** argv )
+{
+    int iOption;
+
+    xOptions.pcExecutable = NULL;
+    xOptions.ulDevices = fleetDEFAULT_DEVICES;
+    xOptions.ullDurationMs = fleetDEFAULT_DURATION_SECONDS * 1000ULL;
+    xOptions.ulSeed = fleetDEFAULT_SEED;
+    xOptions.dRadiusM = fleetDEFAULT_RADIUS_M;
+    xOptions.dPathLossExponent = fleetDEFAULT_PATH_LOSS_EXPONENT;
+    xOptions.ulDemodulators = fleetDEFAULT_DEMODULATORS;
+    xOptions.ullBootSpreadMs = 0;
+    xOptions.cGatewayPower = fleetDEFAULT_GATEWAY_POWER_DBM;
+    xOptions.ucPreferredWindow = 1;
+    xOptions.ullApplicationIntervalMs = 0;
+    xOptions.ulPayloadsPerBurst = fleetDEFAULT_PAYLOADS_PER_BURST;
+    xOptions.dAdrMarginDb = fleetDEFAULT_ADR_MARGIN_DB;
+    xOptions.xAdr = true;
+    xOptions.dRtcTolerancePpm = 0.0;
+    xOptions.dSpeedMps = 0.0;
+    xOptions.dShadowingDb = 0.0;
+    xOptions.xBeacons = false;
+    xOptions.xClassC = false;
+    xOptions.xPerDevice = false;
+    xOptions.xVerbose = false;
+
+    while( ( iOption = getopt( argc, argv, "e:n:d:s:r:x:g:b:t:w:a:k:m:oc:M:f:BCpv" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'e':
+                xOptions.pcExecutable = optarg;
+                break;
+
+            case 'n':
+                xOptions.ulDevices = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'd':
+                xOptions.ullDurationMs = strtoull( optarg, NULL, 0 ) * 1000ULL;
+                break;
+
+            case 's':
+                xOptions.ulSeed = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'r':
+                xOptions.dRadiusM = strtod( optarg, NULL );
+                break;
+
+            case 'x':
+                xOptions.dPathLossExponent = strtod( optarg, NULL );
+                break;
+
+            case 'g':
+                xOptions.ulDemodulators = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'b':
+                xOptions.ullBootSpreadMs = strtoull( optarg, NULL, 0 ) * 1000ULL;
+                break;
+
+            case 't':
+                xOptions.cGatewayPower = ( int8_t ) strtol( optarg, NULL, 0 );
+                break;
+
+            case 'w':
+                xOptions.ucPreferredWindow = ( uint8_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'a':
+                xOptions.ullApplicationIntervalMs = strtoull( optarg, NULL, 0 ) * 1000ULL;
+                break;
+
+            case 'k':
+                xOptions.ulPayloadsPerBurst = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'm':
+                xOptions.dAdrMarginDb = strtod( optarg, NULL );
+                break;
+
+            case 'o':
+                xOptions.xAdr = false;
+                break;
+
+            case 'c':
+                xOptions.dRtcTolerancePpm = strtod( optarg, NULL );
+                break;
+
+            case 'M':
+                xOptions.dSpeedMps = strtod( optarg, NULL );
+                break;
+
+            case 'f':
+                xOptions.dShadowingDb = strtod( optarg, NULL );
+                break;
+
+            case 'B':
+                xOptions.xBeacons = true;
+                break;
+
+            case 'C':
+                xOptions.xClassC = true;
+                break;
+
+            case 'p':
+                xOptions.xPerDevice = true;
+                break;
+
+            case 'v':
+                xOptions.xVerbose = true;
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                break;
+        }
+    }
+
+    if( ( xOptions.pcExecutable == NULL ) || ( xOptions.ulDevices == 0 ) || ( xOptions.ullDurationMs == 0 ) ||
+        ( ( xOptions.ucPreferredWindow != 1 ) && ( xOptions.ucPreferredWindow != 2 ) ) )
+    {
+        prvUsage( argv[ 0 ] );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    ChannelParams_t xChannelParams;
+    NetServerParams_t xServerParams;
+    SimCredentials_t xCredentials;
+    FleetEvent_t xEvent = { 0 };
+    uint32_t ulDevice;
+
+    prvParseOptions( argc, argv );
+
+    ullRandomState = ( ( uint64_t ) xOptions.ulSeed << 32 ) ^ 0x9E3779B97F4A7C15ULL;
+
+    xChannelParams.ulDemodulators = xOptions.ulDemodulators;
+    xChannelParams.dPathLossRefDb = fleetDEFAULT_PATH_LOSS_REF_DB;
+    xChannelParams.dRefDistanceM = fleetDEFAULT_REF_DISTANCE_M;
+    xChannelParams.dPathLossExponent = xOptions.dPathLossExponent;
+    ChannelInit( &xChannelParams );
+
+    xServerParams.ucPreferredWindow = xOptions.ucPreferredWindow;
+    xServerParams.xAdr = xOptions.xAdr;
+    xServerParams.dAdrMarginDb = xOptions.dAdrMarginDb;
+    xServerParams.ullGpsTimeMs = fleetDEFAULT_GPS_TIME_MS;
+    NetServerInit( &xServerParams, prvOnGatewayTransmit );
+
+    pxDevices = calloc( xOptions.ulDevices, sizeof( FleetDevice_t ) );
+
+    if( pxDevices == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( ulDevice = 0; ulDevice < xOptions.ulDevices; ulDevice++ )
+    {
+        /* Devices are spread uniformly over a disk centered on the gateway. */
+        pxDevices[ ulDevice ].dDistanceM = xOptions.dRadiusM * sqrt( prvRandom() );
+        pxDevices[ ulDevice ].ullBootMs = ( uint64_t ) ( prvRandom() * ( double ) xOptions.ullBootSpreadMs );
+        pxDevices[ ulDevice ].dRtcDriftPpm = ( ( 2.0 * prvRandom() ) - 1.0 ) * xOptions.dRtcTolerancePpm;
+        pxDevices[ ulDevice ].iSocket = -1;
+
+        if( xOptions.dSpeedMps > 0.0 )
+        {
+            /* Moving devices start at the same distance, in a random direction, towards a random waypoint. */
+            double dAngle = 2.0 * M_PI * prvRandom();
+
+            pxDevices[ ulDevice ].dX = pxDevices[ ulDevice ].dDistanceM * cos( dAngle );
+            pxDevices[ ulDevice ].dY = pxDevices[ ulDevice ].dDistanceM * sin( dAngle );
+            pxDevices[ ulDevice ].ullPositionMs = pxDevices[ ulDevice ].ullBootMs;
+            prvRandomPosition( &pxDevices[ ulDevice ].dWaypointX, &pxDevices[ ulDevice ].dWaypointY );
+        }
+
+        SimCredentialsDerive( ulDevice, &xCredentials );
+
+        if( NetServerAddDevice( xCredentials.ucDevEui, xCredentials.ucJoinEui, xCredentials.ucAppKey ) < 0 )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            return EXIT_FAILURE;
+        }
+
+        NetServerSetClassC( ulDevice, xOptions.xClassC, 0 );
+
+        xEvent.ullTimeMs = pxDevices[ ulDevice ].ullBootMs;
+        xEvent.xKind = FLEET_EVENT_BOOT;
+        xEvent.ulDevice = ulDevice;
+        prvPushEvent( xEvent );
+
+        if( xOptions.ullApplicationIntervalMs > 0 )
+        {
+            /* First burst at a random phase of the interval, so that the bursts of the fleet are spread. */
+            xEvent.ullTimeMs += ( uint64_t ) ( prvRandom() * ( double ) xOptions.ullApplicationIntervalMs );
+            xEvent.xKind = FLEET_EVENT_APPLICATION;
+            prvPushEvent( xEvent );
+        }
+    }
+
+    if( xOptions.xBeacons == true )
+    {
+        /* First beacon period starting at least fleetBEACON_LEAD_MS after the start of the simulation. */
+        xEvent.ullTimeMs = netserverBEACON_PERIOD_MS - ( fleetDEFAULT_GPS_TIME_MS % netserverBEACON_PERIOD_MS );
+
+        if( xEvent.ullTimeMs < fleetBEACON_LEAD_MS )
+        {
+            xEvent.ullTimeMs += netserverBEACON_PERIOD_MS;
+        }
+
+        xEvent.ullTimeMs -= fleetBEACON_LEAD_MS;
+        xEvent.xKind = FLEET_EVENT_BEACON;
+        xEvent.ulDevice = 0;
+        prvPushEvent( xEvent );
+    }
+
+    while( ( xEventCount > 0 ) && ( pxEvents[ 0 ].ullTimeMs < xOptions.ullDurationMs ) )
+    {
+        xEvent = prvPopEvent();
+        prvPruneDownlinks( xEvent.ullTimeMs );
+
+        switch( xEvent.xKind )
+        {
+            case FLEET_EVENT_UPLINK_END:
+                prvOnUplinkEnd( &xEvent );
+                break;
+
+            case FLEET_EVENT_APPLICATION:
+                prvOnApplication( &xEvent );
+                break;
+
+            case FLEET_EVENT_BEACON:
+                prvOnBeacon( &xEvent );
+                break;
+
+            case FLEET_EVENT_RECEIVE:
+                prvOnAsyncReceive( &xEvent );
+                break;
+
+            case FLEET_EVENT_BOOT:
+                prvBootDevice( xEvent.ulDevice );
+                break;
+
+            case FLEET_EVENT_GRANT:
+
+                if( ( pxDevices[ xEvent.ulDevice ].xAlive == true ) &&
+                    ( xEvent.ulGeneration == pxDevices[ xEvent.ulDevice ].ulGeneration ) )
+                {
+                    prvSendMessage( &pxDevices[ xEvent.ulDevice ], SIMFLEET_MSG_GRANT, xEvent.ullTimeMs );
+                    prvRunDevice( xEvent.ulDevice );
+                }
+
+                break;
+        }
+    }
+
+    prvEndDevices();
+    prvPrintReport();
+
+    NetServerDeinit();
+    free( xRoundTripLatency.pullSamples );
+    free( xApplicationLatency.pullSamples );
+    free( pxDownlinks );
+    free( pxEvents );
+    free( pxDevices );
+
+    return EXIT_SUCCESS;
+}
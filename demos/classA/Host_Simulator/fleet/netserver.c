@@ -0,0 +1,1322 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file netserver.c
+ * @brief LoRaWAN network server and join server stand-in of the fleet simulator.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crypto.h"
+#include "netserver.h"
+
+/**
+ * @brief LoRaWAN message types, from the MHDR of a frame.
+ */
+#define netserverMTYPE_JOIN_REQUEST          ( 0 )
+#define netserverMTYPE_JOIN_ACCEPT           ( 1 )
+#define netserverMTYPE_UNCONFIRMED_UP        ( 2 )
+#define netserverMTYPE_UNCONFIRMED_DOWN      ( 3 )
+#define netserverMTYPE_CONFIRMED_UP          ( 4 )
+
+/**
+ * @brief Frame control bits.
+ */
+#define netserverFCTRL_ADR                   ( 0x80 )
+#define netserverFCTRL_ADR_ACK_REQ           ( 0x40 )
+#define netserverFCTRL_ACK                   ( 0x20 )
+#define netserverFCTRL_FPENDING              ( 0x10 )
+#define netserverFCTRL_CLASS_B               ( 0x10 ) /* Same bit as FPending, in uplinks. */
+#define netserverFCTRL_FOPTS_LEN             ( 0x0F )
+
+/**
+ * @brief Frame sizes.
+ */
+#define netserverJOIN_REQUEST_SIZE           ( 23 )
+#define netserverJOIN_ACCEPT_SIZE            ( 17 )
+#define netserverFHDR_SIZE                   ( 7 )
+#define netserverMIC_SIZE                    ( 4 )
+#define netserverMAX_FOPTS_SIZE              ( 15 )
+
+/**
+ * @brief MAC commands handled by the network server.
+ */
+#define netserverCID_LINK_CHECK              ( 0x02 )
+#define netserverCID_LINK_ADR                ( 0x03 )
+#define netserverCID_DEVICE_TIME             ( 0x0D )
+#define netserverCID_PING_SLOT_INFO          ( 0x10 )
+
+/**
+ * @brief LinkADRAns status bits: power, data rate and channel mask acknowledged.
+ */
+#define netserverLINK_ADR_ACCEPTED           ( 0x07 )
+
+/**
+ * @brief Join accept parameters: NetID, RX1 data rate offset 0, RX2 data rate and RX1 delay of 1 second.
+ */
+#define netserverNET_ID                      ( 0x000000UL )
+#define netserverFIRST_DEV_ADDR              ( 0x00010000UL )
+#define netserverDL_SETTINGS                 ( netserverUS915_RX2_DATARATE )
+#define netserverRX_DELAY                    ( 1 )
+
+/**
+ * @brief Class A receive window delays.
+ */
+#define netserverRECEIVE_DELAY1_MS           ( 1000 )
+#define netserverJOIN_ACCEPT_DELAY1_MS       ( 5000 )
+#define netserverRX2_DELAY_OFFSET_MS         ( 1000 )
+
+/**
+ * @brief Class B timing: the beacon is followed by the beacon reserved time, then by 4096 slots of 30 ms, of
+ * which each device opens 2^( 7 - periodicity ) ping slots, evenly spaced.
+ */
+#define netserverBEACON_RESERVED_MS          ( 2120 )
+#define netserverPING_SLOT_MS                ( 30 )
+#define netserverBEACON_WINDOW_SLOTS         ( 4096 )
+
+/**
+ * @brief Number of ping slots tried for a downlink before giving up until the next beacon.
+ */
+#define netserverPING_SLOT_ATTEMPTS          ( 8 )
+
+/**
+ * @brief Class C downlinks: delay from the time a payload is queued, and start times tried, spaced by the retry
+ * delay, while the gateway is busy.
+ */
+#define netserverCLASS_C_DELAY_MS            ( 100 )
+#define netserverCLASS_C_RETRY_MS            ( 500 )
+#define netserverCLASS_C_ATTEMPTS            ( 8 )
+
+/**
+ * @brief US915 beacon: RFU, time, CRC, gateway specific part, RFU and CRC.
+ */
+#define netserverUS915_BEACON_SIZE           ( 23 )
+#define netserverUS915_BEACON_TIME_OFFSET    ( 5 )
+#define netserverUS915_BEACON_GW_OFFSET      ( 11 )
+
+/**
+ * @brief US915 channel plan.
+ */
+#define netserverUS915_UPLINK_125_BASE_HZ    ( 902300000UL )
+#define netserverUS915_UPLINK_125_STEP_HZ    ( 200000UL )
+#define netserverUS915_UPLINK_500_BASE_HZ    ( 903000000UL )
+#define netserverUS915_UPLINK_500_STEP_HZ    ( 1600000UL )
+#define netserverUS915_UPLINK_125_CHANNELS   ( 64 )
+#define netserverUS915_DOWNLINK_BASE_HZ      ( 923300000UL )
+#define netserverUS915_DOWNLINK_STEP_HZ      ( 600000UL )
+#define netserverUS915_DOWNLINK_CHANNELS     ( 8 )
+#define netserverUS915_RX2_FREQUENCY_HZ      ( 923300000UL )
+#define netserverUS915_RX2_DATARATE          ( 8 )
+#define netserverUS915_BEACON_DATARATE       ( 8 )
+#define netserverUS915_PING_SLOT_DATARATE    ( 8 )
+
+/**
+ * @brief US915 LinkADRReq channel mask: ChMaskCntl 6 turns all 125 kHz channels on, ChMask all 500 kHz ones.
+ */
+#define netserverUS915_CH_MASK_CNTL          ( 6 )
+#define netserverUS915_CH_MASK               ( 0x00FF )
+
+/**
+ * @brief Highest 125 kHz data rate and lowest transmit power (index 10, 10 dBm) the ADR algorithm assigns.
+ */
+#define netserverUS915_MAX_ADR_DATARATE      ( 3 )
+#define netserverUS915_MAX_ADR_POWER_INDEX   ( 10 )
+
+/**
+ * @brief Maximum application payload size, indexed by US915 data rate.
+ */
+static const uint8_t ucMaxPayloadUS915[] = { 11, 53, 125, 242, 242, 0, 0, 0, 53, 129, 242, 242, 242, 242 };
+
+/**
+ * @brief SNR needed to demodulate a frame, indexed by spreading factor 7 to 12.
+ */
+static const double dRequiredSnr[] = { -7.5, -10.0, -12.5, -15.0, -17.5, -20.0 };
+
+/**
+ * @brief Size of the uplink MAC commands, CID included, indexed by CID. 0 for an unknown command.
+ */
+static const uint8_t ucUplinkCommandSize[] =
+{
+    0, 2, 1, 2, 1, 2, 3, 2, 1, 1, 2, 2, 1, 1, 0, 2, 2, 2, 1, 2
+};
+
+/**
+ * @brief Application payload waiting for a downlink opportunity.
+ */
+typedef struct NetServerPayload
+{
+    uint8_t ucPort;
+    uint8_t ucSize;
+    uint64_t ullQueuedMs;
+    uint8_t ucData[ netserverMAX_PAYLOAD_SIZE ];
+} NetServerPayload_t;
+
+/**
+ * @brief Device provisioned on the network server.
+ */
+typedef struct NetServerDevice
+{
+    uint8_t ucDevEui[ 8 ];
+    uint8_t ucJoinEui[ 8 ];
+    uint8_t ucAppKey[ cryptoBLOCK_SIZE ];
+    uint32_t ulJoinNonce;
+
+    /* Session. */
+    bool xJoined;
+    uint32_t ulDevAddr;
+    uint8_t ucNwkSKey[ cryptoBLOCK_SIZE ];
+    uint8_t ucAppSKey[ cryptoBLOCK_SIZE ];
+    bool xUplinkSeen;
+    uint32_t ulFCntUp;
+    uint32_t ulFCntDown;
+
+    /* ADR. */
+    double dSnrHistory[ netserverADR_HISTORY ];
+    uint32_t ulFCntHistory[ netserverADR_HISTORY ];
+    uint32_t ulHistoryCount;
+    uint8_t ucTxPowerIndex;
+    uint8_t ucNbTrans;
+    bool xLinkAdrPending;
+    uint8_t ucLinkAdrDatarate;
+    uint8_t ucLinkAdrPowerIndex;
+    uint8_t ucLinkAdrNbTrans;
+
+    /* Class B and C. */
+    bool xClassB;                  /* From the last uplink. */
+    bool xClassC;                  /* Set by the application server. */
+    bool xPingSlotInfo;            /* Set once the ping slot periodicity is known. */
+    uint8_t ucPingPeriodicity;
+    uint64_t ullDownlinkFreeMs;    /* Ping slot and class C downlinks are scheduled from this time. */
+
+    /* Application payloads, a ring buffer. */
+    NetServerPayload_t xQueue[ netserverDOWNLINK_QUEUE_SIZE ];
+    uint32_t ulQueueHead;
+    uint32_t ulQueueCount;
+} NetServerDevice_t;
+
+/**
+ * @brief Receive window in which a downlink can be sent.
+ */
+typedef struct NetServerWindow
+{
+    uint8_t ucWindow;
+    uint64_t ullStartMs;
+    uint32_t ulFrequency;
+    uint8_t ucDatarate;
+} NetServerWindow_t;
+
+static NetServerParams_t xParams;
+static NetServerTransmit_t xGatewayTransmit = NULL;
+static NetServerDevice_t * pxDevices = NULL;
+static uint32_t ulDeviceCount = 0;
+static uint32_t ulNextDevAddr = netserverFIRST_DEV_ADDR;
+static NetServerStats_t xStats;
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvRead16( const uint8_t * pucBuffer )
+{
+    return ( uint16_t ) ( pucBuffer[ 0 ] | ( pucBuffer[ 1 ] << 8 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRead32( const uint8_t * pucBuffer )
+{
+    return ( uint32_t ) pucBuffer[ 0 ] | ( ( uint32_t ) pucBuffer[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucBuffer[ 2 ] << 16 ) | ( ( uint32_t ) pucBuffer[ 3 ] << 24 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvWrite32( uint8_t * pucBuffer,
+                        uint32_t ulValue,
+                        size_t xSize )
+{
+    size_t x;
+
+    for( x = 0; x < xSize; x++ )
+    {
+        pucBuffer[ x ] = ( uint8_t ) ( ulValue >> ( 8 * x ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns the US915 data rate of a spreading factor and bandwidth, -1 if there is none.
+ */
+static int32_t prvDatarate( uint8_t ucSpreadingFactor,
+                            uint8_t ucBandwidth,
+                            bool xUplink )
+{
+    int32_t lDatarate = -1;
+
+    if( ( ucSpreadingFactor < 7 ) || ( ucSpreadingFactor > 12 ) )
+    {
+        lDatarate = -1;
+    }
+    else if( xUplink == true )
+    {
+        if( ( ucBandwidth == 0 ) && ( ucSpreadingFactor <= 10 ) )
+        {
+            lDatarate = 10 - ( int32_t ) ucSpreadingFactor;
+        }
+        else if( ( ucBandwidth == 2 ) && ( ucSpreadingFactor == 8 ) )
+        {
+            lDatarate = 4;
+        }
+    }
+    else if( ucBandwidth == 2 )
+    {
+        lDatarate = 20 - ( int32_t ) ucSpreadingFactor;
+    }
+
+    return lDatarate;
+}
+
+/*-----------------------------------------------------------*/
+
+static double prvRequiredSnr( uint8_t ucSpreadingFactor )
+{
+    size_t xIndex = ( ucSpreadingFactor < 7 ) ? 0 : ( size_t ) ( ucSpreadingFactor - 7 );
+
+    return dRequiredSnr[ ( xIndex > 5 ) ? 5 : xIndex ];
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvComputeMic( const uint8_t * pucKey,
+                           uint8_t ucDirection,
+                           uint32_t ulDevAddr,
+                           uint32_t ulFCnt,
+                           const uint8_t * pucFrame,
+                           uint8_t ucSize,
+                           uint8_t * pucMic )
+{
+    uint8_t ucBuffer[ cryptoBLOCK_SIZE + netserverMAX_FRAME_SIZE ] = { 0 };
+    uint8_t ucCmac[ cryptoBLOCK_SIZE ];
+
+    /* Block B0 followed by the frame. */
+    ucBuffer[ 0 ] = 0x49;
+    ucBuffer[ 5 ] = ucDirection;
+    prvWrite32( &ucBuffer[ 6 ], ulDevAddr, 4 );
+    prvWrite32( &ucBuffer[ 10 ], ulFCnt, 4 );
+    ucBuffer[ 15 ] = ucSize;
+    memcpy( &ucBuffer[ cryptoBLOCK_SIZE ], pucFrame, ucSize );
+
+    CryptoCmac( pucKey, ucBuffer, cryptoBLOCK_SIZE + ( size_t ) ucSize, ucCmac );
+    memcpy( pucMic, ucCmac, netserverMIC_SIZE );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Encrypts or decrypts a FRMPayload, which are the same operation.
+ */
+static void prvCryptPayload( const uint8_t * pucKey,
+                             uint8_t ucDirection,
+                             uint32_t ulDevAddr,
+                             uint32_t ulFCnt,
+                             uint8_t * pucPayload,
+                             uint8_t ucSize )
+{
+    uint8_t ucBlock[ cryptoBLOCK_SIZE ] = { 0 };
+    uint8_t ucStream[ cryptoBLOCK_SIZE ];
+    size_t x;
+
+    /* Blocks A1 to An, encrypted and XORed with the payload. */
+    ucBlock[ 0 ] = 0x01;
+    ucBlock[ 5 ] = ucDirection;
+    prvWrite32( &ucBlock[ 6 ], ulDevAddr, 4 );
+    prvWrite32( &ucBlock[ 10 ], ulFCnt, 4 );
+
+    for( x = 0; x < ucSize; x++ )
+    {
+        if( ( x % cryptoBLOCK_SIZE ) == 0 )
+        {
+            ucBlock[ 15 ] = ( uint8_t ) ( ( x / cryptoBLOCK_SIZE ) + 1 );
+            CryptoAesEncrypt( pucKey, ucBlock, ucStream );
+        }
+
+        pucPayload[ x ] ^= ucStream[ x % cryptoBLOCK_SIZE ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Finds the receive windows following an uplink, in the order they should be tried.
+ */
+static void prvGetWindows( const NetServerUplink_t * pxUplink,
+                           uint32_t ulDelay1Ms,
+                           NetServerWindow_t * pxWindows )
+{
+    int32_t lDatarate = prvDatarate( pxUplink->ucSpreadingFactor, pxUplink->ucBandwidth, true );
+    uint32_t ulChannel;
+    NetServerWindow_t xRx1, xRx2;
+
+    if( pxUplink->ucBandwidth == 0 )
+    {
+        ulChannel = ( pxUplink->ulFrequency - netserverUS915_UPLINK_125_BASE_HZ ) / netserverUS915_UPLINK_125_STEP_HZ;
+    }
+    else
+    {
+        ulChannel = netserverUS915_UPLINK_125_CHANNELS +
+                    ( ( pxUplink->ulFrequency - netserverUS915_UPLINK_500_BASE_HZ ) / netserverUS915_UPLINK_500_STEP_HZ );
+    }
+
+    xRx1.ucWindow = 1;
+    xRx1.ullStartMs = pxUplink->ullEndMs + ulDelay1Ms;
+    xRx1.ulFrequency = netserverUS915_DOWNLINK_BASE_HZ +
+                       ( ( ulChannel % netserverUS915_DOWNLINK_CHANNELS ) * netserverUS915_DOWNLINK_STEP_HZ );
+    xRx1.ucDatarate = ( uint8_t ) ( ( lDatarate >= 4 ) ? 13 : ( 10 + lDatarate ) );
+
+    xRx2.ucWindow = 2;
+    xRx2.ullStartMs = xRx1.ullStartMs + netserverRX2_DELAY_OFFSET_MS;
+    xRx2.ulFrequency = netserverUS915_RX2_FREQUENCY_HZ;
+    xRx2.ucDatarate = netserverUS915_RX2_DATARATE;
+
+    pxWindows[ 0 ] = ( xParams.ucPreferredWindow == 2 ) ? xRx2 : xRx1;
+    pxWindows[ 1 ] = ( xParams.ucPreferredWindow == 2 ) ? xRx1 : xRx2;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSetWindow( NetServerDownlink_t * pxDownlink,
+                          const NetServerWindow_t * pxWindow )
+{
+    pxDownlink->ucWindow = pxWindow->ucWindow;
+    pxDownlink->ullStartMs = pxWindow->ullStartMs;
+    pxDownlink->ulFrequency = pxWindow->ulFrequency;
+    pxDownlink->ucSpreadingFactor = ( uint8_t ) ( 20 - pxWindow->ucDatarate );
+    pxDownlink->ucBandwidth = 2;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCountWindow( const NetServerDownlink_t * pxDownlink )
+{
+    if( pxDownlink->ucWindow == 1 )
+    {
+        xStats.ulDownlinksRx1++;
+    }
+    else
+    {
+        xStats.ulDownlinksRx2++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvResetSession( NetServerDevice_t * pxDevice )
+{
+    pxDevice->xUplinkSeen = false;
+    pxDevice->ulFCntUp = 0;
+    pxDevice->ulFCntDown = 0;
+    pxDevice->ulHistoryCount = 0;
+    pxDevice->ucTxPowerIndex = 0;
+    pxDevice->ucNbTrans = 1;
+    pxDevice->xLinkAdrPending = false;
+    pxDevice->xClassB = false;
+    pxDevice->xPingSlotInfo = false;
+    pxDevice->ullDownlinkFreeMs = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDeriveSessionKey( const NetServerDevice_t * pxDevice,
+                                 uint8_t ucType,
+                                 uint16_t usDevNonce,
+                                 uint8_t * pucKey )
+{
+    uint8_t ucBlock[ cryptoBLOCK_SIZE ] = { 0 };
+
+    ucBlock[ 0 ] = ucType;
+    prvWrite32( &ucBlock[ 1 ], pxDevice->ulJoinNonce, 3 );
+    prvWrite32( &ucBlock[ 4 ], netserverNET_ID, 3 );
+    prvWrite32( &ucBlock[ 7 ], usDevNonce, 2 );
+    CryptoAesEncrypt( pxDevice->ucAppKey, ucBlock, pucKey );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnJoinRequest( const NetServerUplink_t * pxUplink )
+{
+    const uint8_t * pucFrame = pxUplink->pucFrame;
+    NetServerDevice_t * pxDevice = NULL;
+    NetServerDownlink_t xDownlink = { 0 };
+    NetServerWindow_t xWindows[ 2 ];
+    uint8_t ucDevEui[ 8 ];
+    uint8_t ucCmac[ cryptoBLOCK_SIZE ];
+    uint16_t usDevNonce;
+    uint32_t x;
+
+    if( pxUplink->ucSize != netserverJOIN_REQUEST_SIZE )
+    {
+        return;
+    }
+
+    /* EUIs are sent little endian. */
+    for( x = 0; x < 8; x++ )
+    {
+        ucDevEui[ x ] = pucFrame[ 16 - x ];
+    }
+
+    for( x = 0; ( x < ulDeviceCount ) && ( pxDevice == NULL ); x++ )
+    {
+        if( memcmp( pxDevices[ x ].ucDevEui, ucDevEui, sizeof( ucDevEui ) ) == 0 )
+        {
+            pxDevice = &pxDevices[ x ];
+        }
+    }
+
+    if( pxDevice == NULL )
+    {
+        xStats.ulUnknownDevices++;
+        return;
+    }
+
+    CryptoCmac( pxDevice->ucAppKey, pucFrame, netserverJOIN_REQUEST_SIZE - netserverMIC_SIZE, ucCmac );
+
+    if( memcmp( ucCmac, &pucFrame[ netserverJOIN_REQUEST_SIZE - netserverMIC_SIZE ], netserverMIC_SIZE ) != 0 )
+    {
+        xStats.ulMicFailures++;
+        return;
+    }
+
+    xStats.ulJoinRequests++;
+    usDevNonce = prvRead16( &pucFrame[ 17 ] );
+
+    /* New session. */
+    pxDevice->ulJoinNonce++;
+    pxDevice->ulDevAddr = ulNextDevAddr++;
+    pxDevice->xJoined = true;
+    prvDeriveSessionKey( pxDevice, 0x01, usDevNonce, pxDevice->ucNwkSKey );
+    prvDeriveSessionKey( pxDevice, 0x02, usDevNonce, pxDevice->ucAppSKey );
+    prvResetSession( pxDevice );
+
+    /* Join accept, encrypted with an AES decryption so that the device only needs the AES encryption. */
+    xDownlink.ucFrame[ 0 ] = netserverMTYPE_JOIN_ACCEPT << 5;
+    prvWrite32( &xDownlink.ucFrame[ 1 ], pxDevice->ulJoinNonce, 3 );
+    prvWrite32( &xDownlink.ucFrame[ 4 ], netserverNET_ID, 3 );
+    prvWrite32( &xDownlink.ucFrame[ 7 ], pxDevice->ulDevAddr, 4 );
+    xDownlink.ucFrame[ 11 ] = netserverDL_SETTINGS;
+    xDownlink.ucFrame[ 12 ] = netserverRX_DELAY;
+    CryptoCmac( pxDevice->ucAppKey, xDownlink.ucFrame, netserverJOIN_ACCEPT_SIZE - netserverMIC_SIZE, ucCmac );
+    memcpy( &xDownlink.ucFrame[ netserverJOIN_ACCEPT_SIZE - netserverMIC_SIZE ], ucCmac, netserverMIC_SIZE );
+    CryptoAesDecrypt( pxDevice->ucAppKey, &xDownlink.ucFrame[ 1 ], &xDownlink.ucFrame[ 1 ] );
+
+    xDownlink.ulDevice = ( uint32_t ) ( pxDevice - pxDevices );
+    xDownlink.xJoinAccept = true;
+    xDownlink.ullUplinkStartMs = pxUplink->ullStartMs;
+    xDownlink.ucSize = netserverJOIN_ACCEPT_SIZE;
+
+    prvGetWindows( pxUplink, netserverJOIN_ACCEPT_DELAY1_MS, xWindows );
+
+    for( x = 0; x < 2; x++ )
+    {
+        prvSetWindow( &xDownlink, &xWindows[ x ] );
+
+        if( xGatewayTransmit( &xDownlink ) == true )
+        {
+            xStats.ulJoinAccepts++;
+            prvCountWindow( &xDownlink );
+            return;
+        }
+    }
+
+    xStats.ulDownlinksBusy++;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Runs the ADR algorithm once enough uplinks were received, and prepares a LinkADRReq if the data rate,
+ * transmit power or number of transmissions of the device should change.
+ */
+static void prvUpdateAdr( NetServerDevice_t * pxDevice,
+                          const NetServerUplink_t * pxUplink )
+{
+    int32_t lDatarate = prvDatarate( pxUplink->ucSpreadingFactor, pxUplink->ucBandwidth, true );
+    uint32_t ulSlot = pxDevice->ulHistoryCount % netserverADR_HISTORY;
+    uint32_t ulOldest, ulSpan, x;
+    double dMaxSnr, dLoss;
+    int32_t lSteps;
+    uint8_t ucPowerIndex = pxDevice->ucTxPowerIndex;
+    uint8_t ucNbTrans;
+
+    pxDevice->dSnrHistory[ ulSlot ] = pxUplink->dSnrDb;
+    pxDevice->ulFCntHistory[ ulSlot ] = pxDevice->ulFCntUp;
+    pxDevice->ulHistoryCount++;
+
+    /* 500 kHz uplinks are not managed by the ADR algorithm. */
+    if( ( pxDevice->ulHistoryCount < netserverADR_HISTORY ) || ( pxDevice->xLinkAdrPending == true ) ||
+        ( lDatarate < 0 ) || ( lDatarate > netserverUS915_MAX_ADR_DATARATE ) )
+    {
+        return;
+    }
+
+    dMaxSnr = pxDevice->dSnrHistory[ 0 ];
+
+    for( x = 1; x < netserverADR_HISTORY; x++ )
+    {
+        if( pxDevice->dSnrHistory[ x ] > dMaxSnr )
+        {
+            dMaxSnr = pxDevice->dSnrHistory[ x ];
+        }
+    }
+
+    /* Each 3 dB of margin allows one data rate step, then one transmit power step. */
+    lSteps = ( int32_t ) floor( ( dMaxSnr - prvRequiredSnr( pxUplink->ucSpreadingFactor ) - xParams.dAdrMarginDb ) / 3.0 );
+
+    for( ; ( lSteps > 0 ) && ( lDatarate < netserverUS915_MAX_ADR_DATARATE ); lSteps-- )
+    {
+        lDatarate++;
+    }
+
+    for( ; ( lSteps > 0 ) && ( ucPowerIndex < netserverUS915_MAX_ADR_POWER_INDEX ); lSteps-- )
+    {
+        ucPowerIndex++;
+    }
+
+    for( ; ( lSteps < 0 ) && ( ucPowerIndex > 0 ); lSteps++ )
+    {
+        ucPowerIndex--;
+    }
+
+    /* Frame loss over the history, from the gaps in the frame counter. */
+    ulOldest = pxDevice->ulFCntHistory[ pxDevice->ulHistoryCount % netserverADR_HISTORY ];
+    ulSpan = pxDevice->ulFCntUp - ulOldest + 1;
+    dLoss = 1.0 - ( ( double ) netserverADR_HISTORY / ( double ) ulSpan );
+    ucNbTrans = ( dLoss < 0.05 ) ? 1 : ( ( dLoss < 0.10 ) ? 2 : 3 );
+
+    if( ( lDatarate != prvDatarate( pxUplink->ucSpreadingFactor, pxUplink->ucBandwidth, true ) ) ||
+        ( ucPowerIndex != pxDevice->ucTxPowerIndex ) || ( ucNbTrans != pxDevice->ucNbTrans ) )
+    {
+        pxDevice->xLinkAdrPending = true;
+        pxDevice->ucLinkAdrDatarate = ( uint8_t ) lDatarate;
+        pxDevice->ucLinkAdrPowerIndex = ucPowerIndex;
+        pxDevice->ucLinkAdrNbTrans = ucNbTrans;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Processes the MAC commands of an uplink, and appends the answers to be sent in the downlink.
+ */
+static void prvProcessCommands( NetServerDevice_t * pxDevice,
+                                const NetServerUplink_t * pxUplink,
+                                const uint8_t * pucCommands,
+                                uint8_t ucSize,
+                                uint8_t * pucAnswers,
+                                uint8_t * pucAnswersSize )
+{
+    uint8_t ucIndex = 0;
+    uint8_t ucCid, ucCommandSize;
+    uint64_t ullGpsMs;
+    double dMargin;
+
+    while( ucIndex < ucSize )
+    {
+        ucCid = pucCommands[ ucIndex ];
+        ucCommandSize = ( ucCid < sizeof( ucUplinkCommandSize ) ) ? ucUplinkCommandSize[ ucCid ] : 0;
+
+        /* The size of an unknown command is unknown, the rest cannot be parsed. */
+        if( ( ucCommandSize == 0 ) || ( ( ucIndex + ucCommandSize ) > ucSize ) )
+        {
+            break;
+        }
+
+        switch( ucCid )
+        {
+            case netserverCID_LINK_CHECK:
+                dMargin = floor( pxUplink->dSnrDb - prvRequiredSnr( pxUplink->ucSpreadingFactor ) );
+                pucAnswers[ ( *pucAnswersSize )++ ] = netserverCID_LINK_CHECK;
+                pucAnswers[ ( *pucAnswersSize )++ ] = ( uint8_t ) ( ( dMargin < 0.0 ) ? 0.0 : ( ( dMargin > 254.0 ) ? 254.0 : dMargin ) );
+                pucAnswers[ ( *pucAnswersSize )++ ] = 1;
+                xStats.ulLinkCheckAns++;
+                break;
+
+            case netserverCID_DEVICE_TIME:
+                /* Time at the end of the uplink, in seconds and 1/256 s since the GPS epoch. */
+                ullGpsMs = xParams.ullGpsTimeMs + pxUplink->ullEndMs;
+                pucAnswers[ ( *pucAnswersSize )++ ] = netserverCID_DEVICE_TIME;
+                prvWrite32( &pucAnswers[ *pucAnswersSize ], ( uint32_t ) ( ullGpsMs / 1000ULL ), 4 );
+                *pucAnswersSize += 4;
+                pucAnswers[ ( *pucAnswersSize )++ ] = ( uint8_t ) ( ( ( ullGpsMs % 1000ULL ) * 256ULL ) / 1000ULL );
+                xStats.ulDeviceTimeAns++;
+                break;
+
+            case netserverCID_PING_SLOT_INFO:
+                pxDevice->ucPingPeriodicity = pucCommands[ ucIndex + 1 ] & 0x07;
+                pxDevice->xPingSlotInfo = true;
+                pucAnswers[ ( *pucAnswersSize )++ ] = netserverCID_PING_SLOT_INFO;
+                xStats.ulPingSlotInfoAns++;
+                break;
+
+            case netserverCID_LINK_ADR:
+
+                if( pxDevice->xLinkAdrPending == true )
+                {
+                    if( ( pucCommands[ ucIndex + 1 ] & netserverLINK_ADR_ACCEPTED ) == netserverLINK_ADR_ACCEPTED )
+                    {
+                        pxDevice->ucTxPowerIndex = pxDevice->ucLinkAdrPowerIndex;
+                        pxDevice->ucNbTrans = pxDevice->ucLinkAdrNbTrans;
+                        xStats.ulLinkAdrAccepted++;
+                    }
+                    else
+                    {
+                        xStats.ulLinkAdrRejected++;
+                    }
+
+                    /* Start over with a history at the new settings. */
+                    pxDevice->xLinkAdrPending = false;
+                    pxDevice->ulHistoryCount = 0;
+                }
+
+                break;
+
+            default:
+                break;
+        }
+
+        ucIndex += ucCommandSize;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Builds a data downlink for the given receive window.
+ *
+ * @return true if the queued application payload, if any, fits in the downlink.
+ */
+static bool prvBuildDownlink( NetServerDevice_t * pxDevice,
+                              const NetServerWindow_t * pxWindow,
+                              bool xAck,
+                              const uint8_t * pucCommands,
+                              uint8_t ucCommandsSize,
+                              NetServerDownlink_t * pxDownlink )
+{
+    const NetServerPayload_t * pxPayload = NULL;
+    bool xPending = ( pxDevice->ulQueueCount > 1 );
+    bool xFits = true;
+    uint8_t ucIndex = 0;
+
+    if( pxDevice->ulQueueCount > 0 )
+    {
+        pxPayload = &pxDevice->xQueue[ pxDevice->ulQueueHead ];
+
+        if( ( ( uint32_t ) pxPayload->ucSize + ucCommandsSize ) > ucMaxPayloadUS915[ pxWindow->ucDatarate ] )
+        {
+            pxPayload = NULL;
+            xPending = true;
+            xFits = false;
+        }
+    }
+
+    pxDownlink->ucFrame[ ucIndex++ ] = netserverMTYPE_UNCONFIRMED_DOWN << 5;
+    prvWrite32( &pxDownlink->ucFrame[ ucIndex ], pxDevice->ulDevAddr, 4 );
+    ucIndex += 4;
+    pxDownlink->ucFrame[ ucIndex++ ] = ( uint8_t ) ( ( xParams.xAdr ? netserverFCTRL_ADR : 0 ) |
+                                                     ( xAck ? netserverFCTRL_ACK : 0 ) |
+                                                     ( xPending ? netserverFCTRL_FPENDING : 0 ) |
+                                                     ucCommandsSize );
+    prvWrite32( &pxDownlink->ucFrame[ ucIndex ], pxDevice->ulFCntDown, 2 );
+    ucIndex += 2;
+    memcpy( &pxDownlink->ucFrame[ ucIndex ], pucCommands, ucCommandsSize );
+    ucIndex += ucCommandsSize;
+
+    pxDownlink->ucPayloadSize = 0;
+    pxDownlink->ullQueuedMs = 0;
+
+    if( pxPayload != NULL )
+    {
+        pxDownlink->ucFrame[ ucIndex++ ] = pxPayload->ucPort;
+        memcpy( &pxDownlink->ucFrame[ ucIndex ], pxPayload->ucData, pxPayload->ucSize );
+        prvCryptPayload( pxDevice->ucAppSKey, 1, pxDevice->ulDevAddr, pxDevice->ulFCntDown,
+                         &pxDownlink->ucFrame[ ucIndex ], pxPayload->ucSize );
+        ucIndex += pxPayload->ucSize;
+        pxDownlink->ucPayloadSize = pxPayload->ucSize;
+        pxDownlink->ullQueuedMs = pxPayload->ullQueuedMs;
+    }
+
+    prvComputeMic( pxDevice->ucNwkSKey, 1, pxDevice->ulDevAddr, pxDevice->ulFCntDown,
+                   pxDownlink->ucFrame, ucIndex, &pxDownlink->ucFrame[ ucIndex ] );
+    pxDownlink->ucSize = ( uint8_t ) ( ucIndex + netserverMIC_SIZE );
+    prvSetWindow( pxDownlink, pxWindow );
+
+    return xFits;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns the global time of the start of the ping slot of a device, in the beacon period starting at the
+ * given global time.
+ */
+static uint64_t prvPingSlotStart( const NetServerDevice_t * pxDevice,
+                                  uint64_t ullBeaconMs,
+                                  uint32_t ulSlot )
+{
+    uint8_t ucBlock[ cryptoBLOCK_SIZE ] = { 0 };
+    uint8_t ucKey[ cryptoBLOCK_SIZE ] = { 0 };
+    uint8_t ucRandom[ cryptoBLOCK_SIZE ];
+    uint32_t ulPingPeriod = netserverBEACON_WINDOW_SLOTS >> ( 7 - pxDevice->ucPingPeriodicity );
+    uint32_t ulPingOffset;
+
+    /* The offset is randomized for each beacon period, so that devices do not keep colliding. */
+    prvWrite32( &ucBlock[ 0 ], ( uint32_t ) ( ( xParams.ullGpsTimeMs + ullBeaconMs ) / 1000ULL ), 4 );
+    prvWrite32( &ucBlock[ 4 ], pxDevice->ulDevAddr, 4 );
+    CryptoAesEncrypt( ucKey, ucBlock, ucRandom );
+    ulPingOffset = ( ucRandom[ 0 ] + ( ( uint32_t ) ucRandom[ 1 ] << 8 ) ) % ulPingPeriod;
+
+    return ullBeaconMs + netserverBEACON_RESERVED_MS + ( ( uint64_t ) ( ulPingOffset + ( ulSlot * ulPingPeriod ) ) * netserverPING_SLOT_MS );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sends the next application payload queued for a device in a window which is not opened by an uplink.
+ *
+ * @return true if the gateway transmits it.
+ */
+static bool prvSendQueued( NetServerDevice_t * pxDevice,
+                           const NetServerWindow_t * pxWindow )
+{
+    NetServerDownlink_t xDownlink = { 0 };
+
+    xDownlink.ulDevice = ( uint32_t ) ( pxDevice - pxDevices );
+    xDownlink.ullUplinkStartMs = pxWindow->ullStartMs;
+
+    if( ( prvBuildDownlink( pxDevice, pxWindow, false, NULL, 0, &xDownlink ) == false ) ||
+        ( xGatewayTransmit( &xDownlink ) == false ) )
+    {
+        return false;
+    }
+
+    xStats.ulPayloadsSent++;
+    xStats.ullDownlinkPayloadBytes += xDownlink.ucPayloadSize;
+    pxDevice->ulFCntDown++;
+    pxDevice->ulQueueHead = ( pxDevice->ulQueueHead + 1 ) % netserverDOWNLINK_QUEUE_SIZE;
+    pxDevice->ulQueueCount--;
+    pxDevice->ullDownlinkFreeMs = pxWindow->ullStartMs + 1;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sends the application payloads queued for a class B device in its free ping slots from the given time.
+ */
+static void prvScheduleClassB( NetServerDevice_t * pxDevice,
+                               uint64_t ullFromMs )
+{
+    NetServerWindow_t xWindow;
+    uint64_t ullGpsMs, ullBeaconMs;
+    uint32_t ulPingNb, ulSlot, ulAttempts = 0;
+
+    if( ullFromMs < pxDevice->ullDownlinkFreeMs )
+    {
+        ullFromMs = pxDevice->ullDownlinkFreeMs;
+    }
+
+    ulPingNb = 1UL << ( 7 - pxDevice->ucPingPeriodicity );
+    ullGpsMs = xParams.ullGpsTimeMs + ullFromMs;
+    ulSlot = 0;
+
+    if( ( ullGpsMs % netserverBEACON_PERIOD_MS ) > ullFromMs )
+    {
+        /* No beacon was sent before the start of the simulation. */
+        ullBeaconMs = ullFromMs + netserverBEACON_PERIOD_MS - ( ullGpsMs % netserverBEACON_PERIOD_MS );
+    }
+    else
+    {
+        ullBeaconMs = ullFromMs - ( ullGpsMs % netserverBEACON_PERIOD_MS );
+    }
+
+    while( ( pxDevice->ulQueueCount > 0 ) && ( ulAttempts < netserverPING_SLOT_ATTEMPTS ) )
+    {
+        if( ulSlot == ulPingNb )
+        {
+            ullBeaconMs += netserverBEACON_PERIOD_MS;
+            ulSlot = 0;
+        }
+
+        xWindow.ucWindow = netserverWINDOW_PING_SLOT;
+        xWindow.ullStartMs = prvPingSlotStart( pxDevice, ullBeaconMs, ulSlot++ );
+        xWindow.ucDatarate = netserverUS915_PING_SLOT_DATARATE;
+        xWindow.ulFrequency = netserverUS915_DOWNLINK_BASE_HZ +
+                              ( ( ( pxDevice->ulDevAddr + ( uint32_t ) ( ( xParams.ullGpsTimeMs + ullBeaconMs ) / netserverBEACON_PERIOD_MS ) ) %
+                                  netserverUS915_DOWNLINK_CHANNELS ) * netserverUS915_DOWNLINK_STEP_HZ );
+
+        if( xWindow.ullStartMs < ullFromMs )
+        {
+            continue;
+        }
+
+        ulAttempts++;
+
+        if( prvSendQueued( pxDevice, &xWindow ) == true )
+        {
+            xStats.ulDownlinksPingSlot++;
+            ullFromMs = pxDevice->ullDownlinkFreeMs;
+            ulAttempts = 0;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sends the application payloads queued for a class C device on the RX2 channel, as soon as the gateway is
+ * free from the given time.
+ */
+static void prvScheduleClassC( NetServerDevice_t * pxDevice,
+                               uint64_t ullFromMs )
+{
+    NetServerWindow_t xWindow;
+    uint32_t ulAttempts = 0;
+
+    xWindow.ucWindow = netserverWINDOW_CLASS_C;
+    xWindow.ullStartMs = ( ullFromMs < pxDevice->ullDownlinkFreeMs ) ? pxDevice->ullDownlinkFreeMs : ullFromMs;
+    xWindow.ulFrequency = netserverUS915_RX2_FREQUENCY_HZ;
+    xWindow.ucDatarate = netserverUS915_RX2_DATARATE;
+
+    while( ( pxDevice->ulQueueCount > 0 ) && ( ulAttempts < netserverCLASS_C_ATTEMPTS ) )
+    {
+        if( prvSendQueued( pxDevice, &xWindow ) == true )
+        {
+            xStats.ulDownlinksClassC++;
+            ulAttempts = 0;
+        }
+        else
+        {
+            ulAttempts++;
+        }
+
+        xWindow.ullStartMs += netserverCLASS_C_RETRY_MS;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sends the application payloads queued for a class B or C device without waiting for its next uplink.
+ */
+static void prvScheduleQueued( NetServerDevice_t * pxDevice,
+                               uint64_t ullFromMs )
+{
+    if( pxDevice->xUplinkSeen == false )
+    {
+        /* The session of the device is not confirmed yet. */
+    }
+    else if( pxDevice->xClassC == true )
+    {
+        prvScheduleClassC( pxDevice, ullFromMs + netserverCLASS_C_DELAY_MS );
+    }
+    else if( ( pxDevice->xClassB == true ) && ( pxDevice->xPingSlotInfo == true ) )
+    {
+        prvScheduleClassB( pxDevice, ullFromMs );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvOnDataUplink( const NetServerUplink_t * pxUplink )
+{
+    const uint8_t * pucFrame = pxUplink->pucFrame;
+    uint8_t ucMType = ( uint8_t ) ( pucFrame[ 0 ] >> 5 );
+    uint8_t ucFCtrl = pucFrame[ 5 ];
+    uint8_t ucFOptsLen = ucFCtrl & netserverFCTRL_FOPTS_LEN;
+    uint8_t ucMacSize = ( uint8_t ) ( pxUplink->ucSize - netserverMIC_SIZE );
+    uint8_t ucPayloadIndex = ( uint8_t ) ( 1 + netserverFHDR_SIZE + ucFOptsLen );
+    uint32_t ulDevAddr = prvRead32( &pucFrame[ 1 ] );
+    NetServerDevice_t * pxDevice = NULL;
+    NetServerDownlink_t xDownlink = { 0 };
+    NetServerWindow_t xWindows[ 2 ];
+    uint8_t ucAnswers[ netserverMAX_FRAME_SIZE ];
+    uint8_t ucAnswersSize = 0;
+    uint8_t ucCommands[ netserverMAX_FRAME_SIZE ];
+    uint8_t ucMic[ netserverMIC_SIZE ];
+    bool xConfirmed = ( ucMType == netserverMTYPE_CONFIRMED_UP );
+    bool xFits;
+    uint32_t ulFCnt, x;
+
+    if( ucPayloadIndex > ucMacSize )
+    {
+        return;
+    }
+
+    for( x = 0; ( x < ulDeviceCount ) && ( pxDevice == NULL ); x++ )
+    {
+        if( ( pxDevices[ x ].xJoined == true ) && ( pxDevices[ x ].ulDevAddr == ulDevAddr ) )
+        {
+            pxDevice = &pxDevices[ x ];
+        }
+    }
+
+    if( pxDevice == NULL )
+    {
+        xStats.ulUnknownDevices++;
+        return;
+    }
+
+    /* Rebuild the 32 bits frame counter from its 16 least significant bits. */
+    ulFCnt = prvRead16( &pucFrame[ 6 ] );
+
+    if( pxDevice->xUplinkSeen == true )
+    {
+        ulFCnt |= pxDevice->ulFCntUp & 0xFFFF0000UL;
+
+        if( ulFCnt < pxDevice->ulFCntUp )
+        {
+            ulFCnt += 0x10000UL;
+        }
+    }
+
+    prvComputeMic( pxDevice->ucNwkSKey, 0, ulDevAddr, ulFCnt, pucFrame, ucMacSize, ucMic );
+
+    if( memcmp( ucMic, &pucFrame[ ucMacSize ], netserverMIC_SIZE ) != 0 )
+    {
+        xStats.ulMicFailures++;
+        return;
+    }
+
+    pxDevice->xClassB = ( ( ucFCtrl & netserverFCTRL_CLASS_B ) != 0 );
+
+    if( ( pxDevice->xUplinkSeen == true ) && ( ulFCnt == pxDevice->ulFCntUp ) )
+    {
+        /* Repetition of the previous uplink: acknowledge it again, but do not process it twice. */
+        xStats.ulRetransmissions++;
+    }
+    else
+    {
+        xStats.ulDataUplinks++;
+        pxDevice->xUplinkSeen = true;
+        pxDevice->ulFCntUp = ulFCnt;
+
+        prvProcessCommands( pxDevice, pxUplink, &pucFrame[ 1 + netserverFHDR_SIZE ], ucFOptsLen,
+                            ucAnswers, &ucAnswersSize );
+
+        if( ucPayloadIndex < ucMacSize )
+        {
+            uint8_t ucPort = pucFrame[ ucPayloadIndex ];
+            uint8_t ucSize = ( uint8_t ) ( ucMacSize - ucPayloadIndex - 1 );
+
+            if( ucPort == 0 )
+            {
+                /* MAC commands in the payload, encrypted with the network session key. */
+                memcpy( ucCommands, &pucFrame[ ucPayloadIndex + 1 ], ucSize );
+                prvCryptPayload( pxDevice->ucNwkSKey, 0, ulDevAddr, ulFCnt, ucCommands, ucSize );
+                prvProcessCommands( pxDevice, pxUplink, ucCommands, ucSize, ucAnswers, &ucAnswersSize );
+            }
+            else
+            {
+                xStats.ullUplinkPayloadBytes += ucSize;
+            }
+        }
+
+        if( ( xParams.xAdr == true ) && ( ( ucFCtrl & netserverFCTRL_ADR ) != 0 ) )
+        {
+            prvUpdateAdr( pxDevice, pxUplink );
+        }
+    }
+
+    if( pxDevice->xLinkAdrPending == true )
+    {
+        ucAnswers[ ucAnswersSize++ ] = netserverCID_LINK_ADR;
+        ucAnswers[ ucAnswersSize++ ] = ( uint8_t ) ( ( pxDevice->ucLinkAdrDatarate << 4 ) | pxDevice->ucLinkAdrPowerIndex );
+        ucAnswers[ ucAnswersSize++ ] = ( uint8_t ) ( netserverUS915_CH_MASK & 0xFF );
+        ucAnswers[ ucAnswersSize++ ] = ( uint8_t ) ( netserverUS915_CH_MASK >> 8 );
+        ucAnswers[ ucAnswersSize++ ] = ( uint8_t ) ( ( netserverUS915_CH_MASK_CNTL << 4 ) | pxDevice->ucLinkAdrNbTrans );
+    }
+
+    /* Answers which do not fit in FOpts are dropped, the device will ask again. */
+    if( ucAnswersSize > netserverMAX_FOPTS_SIZE )
+    {
+        ucAnswersSize = netserverMAX_FOPTS_SIZE;
+    }
+
+    /* A downlink is needed to acknowledge, to carry MAC commands or data, or to answer an ADRACKReq. */
+    if( ( xConfirmed == false ) && ( ucAnswersSize == 0 ) && ( pxDevice->ulQueueCount == 0 ) &&
+        ( ( ucFCtrl & netserverFCTRL_ADR_ACK_REQ ) == 0 ) )
+    {
+        return;
+    }
+
+    /* Payloads of a class B or C device are sent after the receive windows, so that its downlinks are received in
+     * the order of their frame counter. */
+    prvScheduleQueued( pxDevice, pxUplink->ullEndMs + netserverRECEIVE_DELAY1_MS + ( 2 * netserverRX2_DELAY_OFFSET_MS ) );
+
+    xDownlink.ulDevice = ( uint32_t ) ( pxDevice - pxDevices );
+    xDownlink.ullUplinkStartMs = pxUplink->ullStartMs;
+    prvGetWindows( pxUplink, netserverRECEIVE_DELAY1_MS, xWindows );
+
+    for( x = 0; x < 2; x++ )
+    {
+        xFits = prvBuildDownlink( pxDevice, &xWindows[ x ], xConfirmed, ucAnswers, ucAnswersSize, &xDownlink );
+
+        if( xGatewayTransmit( &xDownlink ) == true )
+        {
+            break;
+        }
+    }
+
+    if( x == 2 )
+    {
+        xStats.ulDownlinksBusy++;
+        return;
+    }
+
+    prvCountWindow( &xDownlink );
+    pxDevice->ulFCntDown++;
+
+    if( xConfirmed == true )
+    {
+        xStats.ulAcks++;
+    }
+
+    if( ( xDownlink.ucFrame[ 5 ] & netserverFCTRL_FPENDING ) != 0 )
+    {
+        xStats.ulFramePending++;
+    }
+
+    if( pxDevice->xLinkAdrPending == true )
+    {
+        xStats.ulLinkAdrReqs++;
+    }
+
+    if( ( xFits == true ) && ( pxDevice->ulQueueCount > 0 ) )
+    {
+        xStats.ulPayloadsSent++;
+        xStats.ullDownlinkPayloadBytes += xDownlink.ucPayloadSize;
+        pxDevice->ulQueueHead = ( pxDevice->ulQueueHead + 1 ) % netserverDOWNLINK_QUEUE_SIZE;
+        pxDevice->ulQueueCount--;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void NetServerInit( const NetServerParams_t * pxParams,
+                    NetServerTransmit_t xTransmit )
+{
+    NetServerDeinit();
+
+    xParams = *pxParams;
+    xGatewayTransmit = xTransmit;
+    ulNextDevAddr = netserverFIRST_DEV_ADDR;
+    memset( &xStats, 0, sizeof( xStats ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void NetServerDeinit( void )
+{
+    free( pxDevices );
+    pxDevices = NULL;
+    ulDeviceCount = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t NetServerAddDevice( const uint8_t * pucDevEui,
+                            const uint8_t * pucJoinEui,
+                            const uint8_t * pucAppKey )
+{
+    NetServerDevice_t * pxResized = realloc( pxDevices, ( ulDeviceCount + 1 ) * sizeof( NetServerDevice_t ) );
+    NetServerDevice_t * pxDevice;
+
+    if( pxResized == NULL )
+    {
+        return -1;
+    }
+
+    pxDevices = pxResized;
+    pxDevice = &pxDevices[ ulDeviceCount ];
+    memset( pxDevice, 0, sizeof( NetServerDevice_t ) );
+    memcpy( pxDevice->ucDevEui, pucDevEui, sizeof( pxDevice->ucDevEui ) );
+    memcpy( pxDevice->ucJoinEui, pucJoinEui, sizeof( pxDevice->ucJoinEui ) );
+    memcpy( pxDevice->ucAppKey, pucAppKey, sizeof( pxDevice->ucAppKey ) );
+    prvResetSession( pxDevice );
+
+    return ( int32_t ) ulDeviceCount++;
+}
+
+/*-----------------------------------------------------------*/
+
+void NetServerOnUplink( const NetServerUplink_t * pxUplink )
+{
+    uint8_t ucMType;
+
+    if( ( pxUplink->ucSize == 0 ) || ( xGatewayTransmit == NULL ) )
+    {
+        return;
+    }
+
+    ucMType = ( uint8_t ) ( pxUplink->pucFrame[ 0 ] >> 5 );
+
+    if( ucMType == netserverMTYPE_JOIN_REQUEST )
+    {
+        prvOnJoinRequest( pxUplink );
+    }
+    else if( ( ( ucMType == netserverMTYPE_UNCONFIRMED_UP ) || ( ucMType == netserverMTYPE_CONFIRMED_UP ) ) &&
+             ( pxUplink->ucSize >= ( 1 + netserverFHDR_SIZE + netserverMIC_SIZE ) ) )
+    {
+        prvOnDataUplink( pxUplink );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief CRC of the beacon fields, CRC-16/XMODEM.
+ */
+static uint16_t prvBeaconCrc( const uint8_t * pucBuffer,
+                              size_t xSize )
+{
+    uint16_t usCrc = 0;
+    size_t x;
+    uint8_t ucBit;
+
+    for( x = 0; x < xSize; x++ )
+    {
+        usCrc ^= ( uint16_t ) ( pucBuffer[ x ] << 8 );
+
+        for( ucBit = 0; ucBit < 8; ucBit++ )
+        {
+            usCrc = ( uint16_t ) ( ( ( usCrc & 0x8000 ) != 0 ) ? ( ( usCrc << 1 ) ^ 0x1021 ) : ( usCrc << 1 ) );
+        }
+    }
+
+    return usCrc;
+}
+
+/*-----------------------------------------------------------*/
+
+void NetServerSendBeacon( uint64_t ullBeaconMs )
+{
+    NetServerDownlink_t xBeacon = { 0 };
+    uint32_t ulBeaconTime = ( uint32_t ) ( ( xParams.ullGpsTimeMs + ullBeaconMs ) / 1000ULL );
+    uint16_t usCrc;
+    uint32_t x;
+
+    if( xGatewayTransmit == NULL )
+    {
+        return;
+    }
+
+    /* The gateway specific part, a GPS coordinate of the gateway, is left at 0. */
+    prvWrite32( &xBeacon.ucFrame[ netserverUS915_BEACON_TIME_OFFSET ], ulBeaconTime, 4 );
+    usCrc = prvBeaconCrc( xBeacon.ucFrame, netserverUS915_BEACON_TIME_OFFSET + 4 );
+    prvWrite32( &xBeacon.ucFrame[ netserverUS915_BEACON_TIME_OFFSET + 4 ], usCrc, 2 );
+    usCrc = prvBeaconCrc( &xBeacon.ucFrame[ netserverUS915_BEACON_GW_OFFSET ], 10 );
+    prvWrite32( &xBeacon.ucFrame[ netserverUS915_BEACON_GW_OFFSET + 10 ], usCrc, 2 );
+
+    xBeacon.xBeacon = true;
+    xBeacon.ullStartMs = ullBeaconMs;
+    xBeacon.ullUplinkStartMs = ullBeaconMs;
+    xBeacon.ulFrequency = netserverUS915_DOWNLINK_BASE_HZ +
+                          ( ( ( ulBeaconTime / ( netserverBEACON_PERIOD_MS / 1000ULL ) ) % netserverUS915_DOWNLINK_CHANNELS ) *
+                            netserverUS915_DOWNLINK_STEP_HZ );
+    xBeacon.ucSpreadingFactor = ( uint8_t ) ( 20 - netserverUS915_BEACON_DATARATE );
+    xBeacon.ucBandwidth = 2;
+    xBeacon.ucSize = netserverUS915_BEACON_SIZE;
+
+    if( xGatewayTransmit( &xBeacon ) == true )
+    {
+        xStats.ulBeacons++;
+    }
+
+    /* Payloads which did not find a free ping slot in the previous period. */
+    for( x = 0; x < ulDeviceCount; x++ )
+    {
+        if( pxDevices[ x ].ulQueueCount > 0 )
+        {
+            prvScheduleQueued( &pxDevices[ x ], ullBeaconMs );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool NetServerQueueDownlink( uint32_t ulDevice,
+                             uint8_t ucPort,
+                             const uint8_t * pucPayload,
+                             uint8_t ucSize,
+                             uint64_t ullNowMs )
+{
+    NetServerDevice_t * pxDevice;
+    NetServerPayload_t * pxPayload;
+
+    if( ( ulDevice >= ulDeviceCount ) || ( ucSize > netserverMAX_PAYLOAD_SIZE ) )
+    {
+        return false;
+    }
+
+    pxDevice = &pxDevices[ ulDevice ];
+
+    if( pxDevice->ulQueueCount == netserverDOWNLINK_QUEUE_SIZE )
+    {
+        xStats.ulPayloadsDropped++;
+        return false;
+    }
+
+    pxPayload = &pxDevice->xQueue[ ( pxDevice->ulQueueHead + pxDevice->ulQueueCount ) % netserverDOWNLINK_QUEUE_SIZE ];
+    pxPayload->ucPort = ucPort;
+    pxPayload->ucSize = ucSize;
+    pxPayload->ullQueuedMs = ullNowMs;
+    memcpy( pxPayload->ucData, pucPayload, ucSize );
+    pxDevice->ulQueueCount++;
+    xStats.ulPayloadsQueued++;
+
+    prvScheduleQueued( pxDevice, ullNowMs );
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+void NetServerSetClassC( uint32_t ulDevice,
+                         bool xEnable,
+                         uint64_t ullNowMs )
+{
+    if( ulDevice < ulDeviceCount )
+    {
+        pxDevices[ ulDevice ].xClassC = xEnable;
+        prvScheduleQueued( &pxDevices[ ulDevice ], ullNowMs );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void NetServerGetStats( NetServerStats_t * pxStats )
+{
+    *pxStats = xStats;
+}
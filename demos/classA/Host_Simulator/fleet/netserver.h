@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file netserver.h
+ * @brief LoRaWAN network server and join server stand-in of the fleet simulator.
+ *
+ * Implements the server side of LoRaWAN 1.0.3 for the US915 region, as far as the class A demo exercises it:
+ *  - OTAA join: join request MIC check, JoinNonce, DevAddr allocation, session keys and encrypted join accept.
+ *  - Data frames: MIC check and frame counter tracking of uplinks, acknowledgement of confirmed uplinks,
+ *    encryption and MIC of downlinks, FPending when more downlink data or MAC commands are queued.
+ *  - MAC commands: LinkCheckAns, DeviceTimeAns, and LinkADRReq from an ADR algorithm based on the SNR history
+ *    of the device and its frame loss.
+ *  - Downlink scheduling in RX1 or RX2, preferring the configured window and falling back to the other one if
+ *    the gateway is already busy.
+ *  - Class B: beacons on request of the gateway, PingSlotInfoAns, and application payloads of the class B devices
+ *    sent in their next free ping slot rather than after their next uplink.
+ *  - Class C: application payloads of the devices the application server puts in class C sent on the RX2 channel
+ *    as soon as they are queued.
+ *
+ * The network server is independent of the simulated devices: it only sees the uplinks delivered by the
+ * gateway and hands the downlinks to be transmitted to the gateway, through a callback.
+ */
+
+#ifndef NETSERVER_H
+#define NETSERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Maximum size of a LoRaWAN frame.
+ */
+#define netserverMAX_FRAME_SIZE            ( 255 )
+
+/**
+ * @brief Maximum size of an application payload queued for a device.
+ */
+#define netserverMAX_PAYLOAD_SIZE          ( 242 )
+
+/**
+ * @brief Number of application payloads which can be queued for a device.
+ */
+#define netserverDOWNLINK_QUEUE_SIZE       ( 8 )
+
+/**
+ * @brief Number of uplinks the ADR algorithm looks at.
+ */
+#define netserverADR_HISTORY               ( 20 )
+
+/**
+ * @brief Class B beacon period. Beacons are sent when the GPS time is a multiple of the period.
+ */
+#define netserverBEACON_PERIOD_MS          ( 128000ULL )
+
+/**
+ * @brief Receive windows of NetServerDownlink_t.ucWindow besides RX1 and RX2.
+ */
+#define netserverWINDOW_PING_SLOT          ( 0 )
+#define netserverWINDOW_CLASS_C            ( 3 )
+
+/**
+ * @brief Network server configuration.
+ */
+typedef struct NetServerParams
+{
+    uint8_t ucPreferredWindow;     /**< @brief Receive window tried first for downlinks, 1 or 2. */
+    bool xAdr;                     /**< @brief Set to let the network server adapt the data rate of the devices. */
+    double dAdrMarginDb;           /**< @brief SNR margin kept by the ADR algorithm. */
+    uint64_t ullGpsTimeMs;         /**< @brief GPS time at the start of the simulation, for DeviceTimeAns. */
+} NetServerParams_t;
+
+/**
+ * @brief Uplink delivered by the gateway.
+ */
+typedef struct NetServerUplink
+{
+    uint64_t ullStartMs;           /**< @brief Global time at which the transmission started. */
+    uint64_t ullEndMs;             /**< @brief Global time at which the transmission ended. */
+    uint32_t ulFrequency;
+    uint8_t ucSpreadingFactor;
+    uint8_t ucBandwidth;           /**< @brief 0: 125 kHz, 1: 250 kHz, 2: 500 kHz. */
+    double dRssiDbm;
+    double dSnrDb;
+    const uint8_t * pucFrame;
+    uint8_t ucSize;
+} NetServerUplink_t;
+
+/**
+ * @brief Downlink to be transmitted by the gateway.
+ */
+typedef struct NetServerDownlink
+{
+    uint32_t ulDevice;             /**< @brief Handle of the device the downlink is addressed to. */
+    uint64_t ullStartMs;           /**< @brief Global time at which the transmission must start. */
+    uint32_t ulFrequency;
+    uint8_t ucSpreadingFactor;
+    uint8_t ucBandwidth;           /**< @brief 0: 125 kHz, 1: 250 kHz, 2: 500 kHz. */
+    uint8_t ucWindow;              /**< @brief Receive window of the device: 1, 2, netserverWINDOW_PING_SLOT for a ping
+                                    * slot or a beacon, or netserverWINDOW_CLASS_C. */
+    bool xJoinAccept;              /**< @brief Set for a join accept, cleared for a data frame. */
+    bool xBeacon;                  /**< @brief Set for a beacon, which is for every device: ulDevice is not used. */
+    uint64_t ullUplinkStartMs;     /**< @brief Start of the uplink which opened the receive window. */
+    uint8_t ucPayloadSize;         /**< @brief Size of the application payload, 0 if none. */
+    uint64_t ullQueuedMs;          /**< @brief Time the application payload was queued, if any. */
+    uint8_t ucSize;
+    uint8_t ucFrame[ netserverMAX_FRAME_SIZE ];
+} NetServerDownlink_t;
+
+/**
+ * @brief Hands a downlink over to the gateway.
+ *
+ * @param[in] pxDownlink Downlink to be transmitted.
+ * @return true if the gateway will transmit it, false if it is busy at that time.
+ */
+typedef bool ( * NetServerTransmit_t )( const NetServerDownlink_t * pxDownlink );
+
+/**
+ * @brief Network server statistics.
+ */
+typedef struct NetServerStats
+{
+    uint32_t ulJoinRequests;       /**< @brief Valid join requests received. */
+    uint32_t ulJoinAccepts;        /**< @brief Join accepts handed over to the gateway. */
+    uint32_t ulDataUplinks;        /**< @brief Valid data uplinks, retransmissions excluded. */
+    uint32_t ulRetransmissions;    /**< @brief Uplinks repeating the frame counter of the previous one. */
+    uint32_t ulMicFailures;
+    uint32_t ulUnknownDevices;     /**< @brief Frames from an unknown DevEUI or DevAddr. */
+    uint32_t ulAcks;               /**< @brief Confirmed uplinks acknowledged. */
+    uint32_t ulDownlinksRx1;       /**< @brief Downlinks, join accepts included, scheduled in RX1. */
+    uint32_t ulDownlinksRx2;       /**< @brief Downlinks, join accepts included, scheduled in RX2. */
+    uint32_t ulDownlinksBusy;      /**< @brief Downlinks dropped because the gateway was busy in both windows. */
+    uint32_t ulDownlinksPingSlot;  /**< @brief Downlinks scheduled in a ping slot. */
+    uint32_t ulDownlinksClassC;    /**< @brief Downlinks scheduled outside the receive windows of a class C device. */
+    uint32_t ulFramePending;       /**< @brief Downlinks sent with FPending set. */
+    uint32_t ulLinkAdrReqs;
+    uint32_t ulLinkAdrAccepted;    /**< @brief LinkADRAns acknowledging every field. */
+    uint32_t ulLinkAdrRejected;
+    uint32_t ulLinkCheckAns;
+    uint32_t ulDeviceTimeAns;
+    uint32_t ulPingSlotInfoAns;
+    uint32_t ulBeacons;            /**< @brief Beacons handed over to the gateway. */
+    uint32_t ulPayloadsQueued;     /**< @brief Application payloads queued. */
+    uint32_t ulPayloadsDropped;    /**< @brief Application payloads refused because the queue was full. */
+    uint32_t ulPayloadsSent;       /**< @brief Application payloads handed over to the gateway. */
+    uint64_t ullUplinkPayloadBytes;
+    uint64_t ullDownlinkPayloadBytes;
+} NetServerStats_t;
+
+/**
+ * @brief Initializes the network server.
+ *
+ * @param[in] pxParams Network server configuration.
+ * @param[in] xTransmit Gateway transmit callback.
+ */
+void NetServerInit( const NetServerParams_t * pxParams,
+                    NetServerTransmit_t xTransmit );
+
+/**
+ * @brief Releases the memory used by the network server.
+ */
+void NetServerDeinit( void );
+
+/**
+ * @brief Provisions a device on the join server.
+ *
+ * @param[in] pucDevEui DevEUI, big endian.
+ * @param[in] pucJoinEui JoinEUI, big endian.
+ * @param[in] pucAppKey AppKey.
+ * @return Handle of the device, or -1 if out of memory.
+ */
+int32_t NetServerAddDevice( const uint8_t * pucDevEui,
+                            const uint8_t * pucJoinEui,
+                            const uint8_t * pucAppKey );
+
+/**
+ * @brief Processes an uplink received by the gateway, and schedules the downlink answering it, if any.
+ *
+ * @param[in] pxUplink Uplink received.
+ */
+void NetServerOnUplink( const NetServerUplink_t * pxUplink );
+
+/**
+ * @brief Sends the beacon of a beacon period, then schedules the payloads waiting for class B devices in the ping
+ * slots of the period.
+ *
+ * @param[in] ullBeaconMs Global time of the start of the beacon period, a multiple of netserverBEACON_PERIOD_MS in
+ * GPS time.
+ */
+void NetServerSendBeacon( uint64_t ullBeaconMs );
+
+/**
+ * @brief Tells the network server whether a device keeps its receiver open in class C, as agreed between the
+ * application server and the device, e.g. for the duration of a firmware update session.
+ *
+ * @param[in] ulDevice Handle of the device.
+ * @param[in] xEnable Set if the device is in class C, cleared if it is back in class A or B.
+ * @param[in] ullNowMs Global time. The payloads already queued are sent from that time.
+ */
+void NetServerSetClassC( uint32_t ulDevice,
+                         bool xEnable,
+                         uint64_t ullNowMs );
+
+/**
+ * @brief Queues an application payload for a device. It is sent after the next uplinks of the device, in its
+ * next free ping slot if it is in class B, or right away on the RX2 channel if it is in class C.
+ *
+ * @param[in] ulDevice Handle of the device.
+ * @param[in] ucPort Application port, 1 to 223.
+ * @param[in] pucPayload Payload.
+ * @param[in] ucSize Size of the payload.
+ * @param[in] ullNowMs Global time, to measure the downlink latency.
+ * @return true if queued, false if the queue of the device is full.
+ */
+bool NetServerQueueDownlink( uint32_t ulDevice,
+                             uint8_t ucPort,
+                             const uint8_t * pucPayload,
+                             uint8_t ucSize,
+                             uint64_t ullNowMs );
+
+/**
+ * @brief Copies the network server statistics.
+ *
+ * @param[out] pxStats Statistics.
+ */
+void NetServerGetStats( NetServerStats_t * pxStats );
+
+#endif /* NETSERVER_H */
@@ -0,0 +1,684 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file delta_gen.c
+ * @brief Delta patch generator.
+ *
+ * Writes the patch rebuilding a new firmware image from the old one, in the format applied on the device by
+ * delta_patch.c. As bsdiff does, the new image is covered with regions of the old one which match approximately:
+ * each region is found by an exact match of at least deltagenMIN_MATCH bytes and extended while more bytes match than
+ * differ, so that code which only moved, and whose addresses changed, costs the bytes which changed. The rest is
+ * inserted. The operations are then compressed with LZSS in a window small enough for the device, and the patch is
+ * applied with the device code in small chunks to verify it.
+ *
+ * Usage: delta_gen [-v] <old image> <new image> <patch>
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "delta_patch.h"
+
+/**
+ * @brief Matching parameters.
+ */
+#define deltagenKEY_BYTES       ( 8U )     /* Bytes hashed to find the candidate matches. */
+#define deltagenHASH_BITS       ( 20U )
+#define deltagenMAX_CANDIDATES  ( 128U )   /* Candidates tried per position. */
+#define deltagenMIN_MATCH       ( 16U )    /* Exact match starting a region at a new old offset. */
+#define deltagenMAX_GAP         ( 64U )    /* Bytes an extension goes on without improving. */
+#define deltagenLZ_CANDIDATES   ( 256U )   /* Candidates tried per position by the compression. */
+
+/**
+ * @brief Chunk size the patch is fed to the device code in, odd to exercise the streaming.
+ */
+#define deltagenVERIFY_CHUNK    ( 37U )
+
+/**
+ * @brief Images, operations and patch.
+ */
+static uint8_t * pucOld;
+static uint32_t ulOldSize;
+static uint8_t * pucNew;
+static uint32_t ulNewSize;
+static uint8_t * pucOps;
+static uint32_t ulOpsSize;
+static uint8_t * pucPatch;
+static uint32_t ulPatchSize;
+static bool xVerbose = false;
+
+/**
+ * @brief Hash chains of the old image: heads per hash, then the previous position with the same hash.
+ */
+static int32_t * plHead;
+static int32_t * plChain;
+
+/**
+ * @brief Statistics of the patch.
+ */
+static uint32_t ulAddOps;
+static uint32_t ulAddBytes;
+static uint32_t ulAddLiterals;
+static uint32_t ulInsertOps;
+static uint32_t ulInsertBytes;
+
+/**
+ * @brief Image rebuilt by the device code.
+ */
+static uint8_t * pucRebuilt;
+static uint32_t ulExpectedOffset;
+static bool xOutOfOrder = false;
+
+/*-----------------------------------------------------------*/
+
+static uint8_t * prvLoad( const char * pcPath,
+                          uint32_t * pulSize )
+{
+    FILE * pxFile = fopen( pcPath, "rb" );
+    uint8_t * pucData;
+    long lSize;
+
+    if( pxFile == NULL )
+    {
+        fprintf( stderr, "Cannot open %s.\n", pcPath );
+        exit( EXIT_FAILURE );
+    }
+
+    fseek( pxFile, 0, SEEK_END );
+    lSize = ftell( pxFile );
+    fseek( pxFile, 0, SEEK_SET );
+    pucData = malloc( ( size_t ) lSize + 1U );
+
+    if( ( pucData == NULL ) || ( fread( pucData, 1, ( size_t ) lSize, pxFile ) != ( size_t ) lSize ) )
+    {
+        fprintf( stderr, "Cannot read %s.\n", pcPath );
+        exit( EXIT_FAILURE );
+    }
+
+    fclose( pxFile );
+    *pulSize = ( uint32_t ) lSize;
+
+    return pucData;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPutByte( uint8_t ucByte )
+{
+    pucOps[ ulOpsSize++ ] = ucByte;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPutLittleEndian( uint32_t ulValue )
+{
+    pucPatch[ ulPatchSize++ ] = ( uint8_t ) ulValue;
+    pucPatch[ ulPatchSize++ ] = ( uint8_t ) ( ulValue >> 8 );
+    pucPatch[ ulPatchSize++ ] = ( uint8_t ) ( ulValue >> 16 );
+    pucPatch[ ulPatchSize++ ] = ( uint8_t ) ( ulValue >> 24 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPutVarint( uint32_t ulValue )
+{
+    while( ulValue >= 0x80U )
+    {
+        prvPutByte( ( uint8_t ) ( ulValue | 0x80U ) );
+        ulValue >>= 7;
+    }
+
+    prvPutByte( ( uint8_t ) ulValue );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHash( const uint8_t * pucData )
+{
+    uint64_t ullKey;
+
+    memcpy( &ullKey, pucData, sizeof( ullKey ) );
+
+    return ( uint32_t ) ( ( ullKey * 0x9E3779B97F4A7C15ULL ) >> ( 64U - deltagenHASH_BITS ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvIndexOld( void )
+{
+    uint32_t i;
+    uint32_t ulHash;
+
+    plHead = malloc( sizeof( int32_t ) << deltagenHASH_BITS );
+    plChain = malloc( sizeof( int32_t ) * ( ulOldSize + 1U ) );
+
+    if( ( plHead == NULL ) || ( plChain == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    memset( plHead, 0xFF, sizeof( int32_t ) << deltagenHASH_BITS );
+
+    for( i = 0; ( i + deltagenKEY_BYTES ) <= ulOldSize; i++ )
+    {
+        ulHash = prvHash( &pucOld[ i ] );
+        plChain[ i ] = plHead[ ulHash ];
+        plHead[ ulHash ] = ( int32_t ) i;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMatchLength( uint32_t ulOld,
+                                uint32_t ulNew )
+{
+    uint32_t ulLength = 0;
+
+    while( ( ( ulOld + ulLength ) < ulOldSize ) && ( ( ulNew + ulLength ) < ulNewSize ) &&
+           ( pucOld[ ulOld + ulLength ] == pucNew[ ulNew + ulLength ] ) )
+    {
+        ulLength++;
+    }
+
+    return ulLength;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Finds the longest exact match of the new image at ulNew in the old one. The old offset following the previous
+ * region is preferred, its offset delta costing a single byte.
+ */
+static uint32_t prvFindMatch( uint32_t ulNew,
+                              uint32_t ulPredicted,
+                              uint32_t * pulOld )
+{
+    uint32_t ulBest = 0;
+    uint32_t ulLength;
+    uint32_t ulCandidates = 0;
+    int32_t lCandidate;
+
+    if( ulPredicted < ulOldSize )
+    {
+        ulBest = prvMatchLength( ulPredicted, ulNew );
+        *pulOld = ulPredicted;
+
+        if( ulBest >= deltagenKEY_BYTES )
+        {
+            /* Shorter than deltagenMIN_MATCH is fine when the region just goes on. */
+            ulBest += deltagenMIN_MATCH;
+        }
+        else
+        {
+            ulBest = 0;
+        }
+    }
+
+    if( ( ulNew + deltagenKEY_BYTES ) > ulNewSize )
+    {
+        return ulBest;
+    }
+
+    for( lCandidate = plHead[ prvHash( &pucNew[ ulNew ] ) ];
+         ( lCandidate >= 0 ) && ( ulCandidates < deltagenMAX_CANDIDATES );
+         lCandidate = plChain[ lCandidate ], ulCandidates++ )
+    {
+        ulLength = prvMatchLength( ( uint32_t ) lCandidate, ulNew );
+
+        if( ( ulLength >= deltagenMIN_MATCH ) && ( ulLength > ulBest ) )
+        {
+            ulBest = ulLength;
+            *pulOld = ( uint32_t ) lCandidate;
+        }
+    }
+
+    return ulBest;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Extends an approximate match forwards, or backwards with a negative step, up to ulLimit bytes. The length kept
+ * maximises twice the matching bytes minus the length, as bsdiff does.
+ */
+static uint32_t prvExtend( uint32_t ulOld,
+                           uint32_t ulNew,
+                           int32_t lStep,
+                           uint32_t ulLimit )
+{
+    uint32_t k;
+    int32_t lScore = 0;
+    int32_t lBestScore = 0;
+    uint32_t ulBest = 0;
+
+    for( k = 1; k <= ulLimit; k++ )
+    {
+        uint32_t ulOldPosition = ( lStep > 0 ) ? ( ulOld + k - 1U ) : ( ulOld - k );
+        uint32_t ulNewPosition = ( lStep > 0 ) ? ( ulNew + k - 1U ) : ( ulNew - k );
+
+        if( ( ulOldPosition >= ulOldSize ) || ( ulNewPosition >= ulNewSize ) )
+        {
+            break;
+        }
+
+        lScore += ( pucOld[ ulOldPosition ] == pucNew[ ulNewPosition ] ) ? 1 : -1;
+
+        if( lScore > lBestScore )
+        {
+            lBestScore = lScore;
+            ulBest = k;
+        }
+        else if( ( k - ulBest ) > deltagenMAX_GAP )
+        {
+            break;
+        }
+    }
+
+    return ulBest;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPutInsert( uint32_t ulNew,
+                          uint32_t ulLength )
+{
+    if( ulLength > 0U )
+    {
+        prvPutByte( DELTA_PATCH_OP_INSERT );
+        prvPutVarint( ulLength );
+        memcpy( &pucOps[ ulOpsSize ], &pucNew[ ulNew ], ulLength );
+        ulOpsSize += ulLength;
+        ulInsertOps++;
+        ulInsertBytes += ulLength;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Writes an ADD of the region: runs of unchanged bytes and runs of differences. Gaps of up to two unchanged bytes are
+ * cheaper as differences than as two more run lengths.
+ */
+static void prvPutAdd( uint32_t ulOld,
+                       uint32_t ulNew,
+                       uint32_t ulLength,
+                       uint32_t ulPreviousOldEnd )
+{
+    int32_t lDelta = ( int32_t ) ( ulOld - ulPreviousOldEnd );
+    uint32_t i = 0;
+    uint32_t ulZeros;
+    uint32_t ulLiterals;
+    uint32_t ulGap;
+
+    prvPutByte( DELTA_PATCH_OP_ADD );
+    prvPutVarint( ulLength );
+    prvPutVarint( ( ( uint32_t ) lDelta << 1 ) ^ ( uint32_t ) ( lDelta >> 31 ) );
+    ulAddOps++;
+    ulAddBytes += ulLength;
+
+    while( i < ulLength )
+    {
+        ulZeros = 0;
+
+        while( ( ( i + ulZeros ) < ulLength ) && ( pucOld[ ulOld + i + ulZeros ] == pucNew[ ulNew + i + ulZeros ] ) )
+        {
+            ulZeros++;
+        }
+
+        prvPutVarint( ulZeros );
+        i += ulZeros;
+
+        if( i == ulLength )
+        {
+            break;
+        }
+
+        for( ulLiterals = 0; ( i + ulLiterals ) < ulLength; )
+        {
+            if( pucOld[ ulOld + i + ulLiterals ] != pucNew[ ulNew + i + ulLiterals ] )
+            {
+                ulLiterals++;
+                continue;
+            }
+
+            ulGap = 0;
+
+            while( ( ( i + ulLiterals + ulGap ) < ulLength ) &&
+                   ( pucOld[ ulOld + i + ulLiterals + ulGap ] == pucNew[ ulNew + i + ulLiterals + ulGap ] ) )
+            {
+                ulGap++;
+            }
+
+            if( ( ulGap > 2U ) || ( ( i + ulLiterals + ulGap ) == ulLength ) )
+            {
+                break;
+            }
+
+            ulLiterals += ulGap;
+        }
+
+        prvPutVarint( ulLiterals );
+
+        for( ; ulLiterals > 0U; ulLiterals--, i++ )
+        {
+            prvPutByte( ( uint8_t ) ( pucNew[ ulNew + i ] - pucOld[ ulOld + i ] ) );
+            ulAddLiterals++;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvGenerate( void )
+{
+    uint32_t ulNew = 0;
+    uint32_t ulInsertStart = 0;
+    uint32_t ulOldEnd = 0;
+    uint32_t ulOld = 0;
+    uint32_t ulMatch;
+    uint32_t ulBack;
+    uint32_t ulForward;
+
+    /* An insert costs its bytes, the worst case is the new image and a few op headers, and 9 bits per byte once
+     * compressed. */
+    pucOps = malloc( ( ( size_t ) ulNewSize * 2U ) + 64U );
+    pucPatch = malloc( DELTA_PATCH_HEADER_SIZE + ( ( size_t ) ulNewSize * 3U ) + 64U );
+
+    if( ( pucOps == NULL ) || ( pucPatch == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    memcpy( pucPatch, DELTA_PATCH_MAGIC, 4 );
+    ulPatchSize = 4;
+    prvPutLittleEndian( ulOldSize );
+    prvPutLittleEndian( FragDecoder_Crc32( 0, pucOld, ulOldSize ) );
+    prvPutLittleEndian( ulNewSize );
+    prvPutLittleEndian( FragDecoder_Crc32( 0, pucNew, ulNewSize ) );
+
+    while( ulNew < ulNewSize )
+    {
+        ulMatch = prvFindMatch( ulNew, ulOldEnd + ( ulNew - ulInsertStart ), &ulOld );
+
+        if( ulMatch == 0U )
+        {
+            ulNew++;
+            continue;
+        }
+
+        /* The bytes before the exact match may still be cheaper as differences than as an insert. */
+        ulBack = prvExtend( ulOld, ulNew, -1, ( ulNew - ulInsertStart < ulOld ) ? ( ulNew - ulInsertStart ) : ulOld );
+        ulForward = prvExtend( ulOld, ulNew, 1, ulNewSize - ulNew );
+
+        prvPutInsert( ulInsertStart, ulNew - ulBack - ulInsertStart );
+        prvPutAdd( ulOld - ulBack, ulNew - ulBack, ulBack + ulForward, ulOldEnd );
+
+        ulNew += ulForward;
+        ulOldEnd = ulOld + ulForward;
+        ulInsertStart = ulNew;
+    }
+
+    prvPutInsert( ulInsertStart, ulNewSize - ulInsertStart );
+    prvPutByte( DELTA_PATCH_OP_END );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPutBits( uint32_t ulValue,
+                        uint32_t ulCount,
+                        uint32_t * pulBits,
+                        uint32_t * pulBitCount )
+{
+    *pulBits = ( *pulBits << ulCount ) | ulValue;
+    *pulBitCount += ulCount;
+
+    while( *pulBitCount >= 8U )
+    {
+        *pulBitCount -= 8U;
+        pucPatch[ ulPatchSize++ ] = ( uint8_t ) ( *pulBits >> *pulBitCount );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Compresses the operations after the header, greedily, with hash chains of DELTA_PATCH_MIN_MATCH bytes. */
+static void prvCompress( void )
+{
+    const uint32_t ulWindow = 1U << DELTA_PATCH_WINDOW_BITS;
+    const uint32_t ulMaxMatch = ( 1U << DELTA_PATCH_LENGTH_BITS ) - 1U + DELTA_PATCH_MIN_MATCH;
+    int32_t * plLzHead = malloc( sizeof( int32_t ) << 16 );
+    int32_t * plLzChain = malloc( sizeof( int32_t ) * ( ulOpsSize + 1U ) );
+    uint32_t ulBits = 0;
+    uint32_t ulBitCount = 0;
+    uint32_t i = 0;
+    uint32_t j;
+    uint32_t ulHash;
+    uint32_t ulBest;
+    uint32_t ulBestDistance = 0;
+    uint32_t ulLength;
+    uint32_t ulCandidates;
+    int32_t lCandidate;
+
+    if( ( plLzHead == NULL ) || ( plLzChain == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    memset( plLzHead, 0xFF, sizeof( int32_t ) << 16 );
+
+    while( i < ulOpsSize )
+    {
+        ulBest = 0;
+
+        if( ( i + DELTA_PATCH_MIN_MATCH ) <= ulOpsSize )
+        {
+            ulHash = ( ( uint32_t ) pucOps[ i ] << 8 ) ^ ( ( uint32_t ) pucOps[ i + 1U ] << 4 ) ^ pucOps[ i + 2U ];
+
+            for( lCandidate = plLzHead[ ulHash & 0xFFFFU ], ulCandidates = 0;
+                 ( lCandidate >= 0 ) && ( ( i - ( uint32_t ) lCandidate ) <= ulWindow ) && ( ulCandidates < deltagenLZ_CANDIDATES );
+                 lCandidate = plLzChain[ lCandidate ], ulCandidates++ )
+            {
+                ulLength = 0;
+
+                while( ( ulLength < ulMaxMatch ) && ( ( i + ulLength ) < ulOpsSize ) &&
+                       ( pucOps[ ( uint32_t ) lCandidate + ulLength ] == pucOps[ i + ulLength ] ) )
+                {
+                    ulLength++;
+                }
+
+                if( ulLength > ulBest )
+                {
+                    ulBest = ulLength;
+                    ulBestDistance = i - ( uint32_t ) lCandidate;
+                }
+            }
+        }
+
+        if( ulBest >= DELTA_PATCH_MIN_MATCH )
+        {
+            prvPutBits( 0, 1, &ulBits, &ulBitCount );
+            prvPutBits( ( ( ulBestDistance - 1U ) << DELTA_PATCH_LENGTH_BITS ) | ( ulBest - DELTA_PATCH_MIN_MATCH ),
+                        DELTA_PATCH_WINDOW_BITS + DELTA_PATCH_LENGTH_BITS, &ulBits, &ulBitCount );
+        }
+        else
+        {
+            ulBest = 1;
+            prvPutBits( 0x100U | pucOps[ i ], 9, &ulBits, &ulBitCount );
+        }
+
+        for( j = i + ulBest; i < j; i++ )
+        {
+            if( ( i + DELTA_PATCH_MIN_MATCH ) <= ulOpsSize )
+            {
+                ulHash = ( ( ( uint32_t ) pucOps[ i ] << 8 ) ^ ( ( uint32_t ) pucOps[ i + 1U ] << 4 ) ^ pucOps[ i + 2U ] ) & 0xFFFFU;
+                plLzChain[ i ] = plLzHead[ ulHash ];
+                plLzHead[ ulHash ] = ( int32_t ) i;
+            }
+        }
+    }
+
+    /* The decoder stops at the END operation, the padding bits are never decoded. */
+    if( ulBitCount > 0U )
+    {
+        prvPutBits( 0, 8U - ulBitCount, &ulBits, &ulBitCount );
+    }
+
+    free( plLzHead );
+    free( plLzChain );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvReadOld( uint32_t ulOffset,
+                        uint8_t * pucData,
+                        uint32_t ulLength )
+{
+    if( ( ulOffset + ulLength ) > ulOldSize )
+    {
+        return false;
+    }
+
+    memcpy( pucData, &pucOld[ ulOffset ], ulLength );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/* Checks that the device code writes the new image in order, one page at a time. */
+static bool prvWriteNew( uint32_t ulOffset,
+                         const uint8_t * pucData,
+                         uint32_t ulLength )
+{
+    if( ( ulOffset != ulExpectedOffset ) || ( ulLength > lorawanConfigDELTA_PAGE_SIZE ) ||
+        ( ( ulOffset + ulLength ) > ulNewSize ) )
+    {
+        xOutOfOrder = true;
+        return false;
+    }
+
+    memcpy( &pucRebuilt[ ulOffset ], pucData, ulLength );
+    ulExpectedOffset += ulLength;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static DeltaPatchStatus_t prvVerify( void )
+{
+    static DeltaPatch_t xPatch;
+    FragDecoderStorage_t xOld = { 0 };
+    FragDecoderStorage_t xNew = { 0 };
+    DeltaPatchStatus_t xStatus = DELTA_PATCH_ONGOING;
+    uint32_t ulOffset;
+    uint32_t ulLength;
+
+    pucRebuilt = malloc( ( size_t ) ulNewSize + 1U );
+
+    if( pucRebuilt == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    xOld.size = ulOldSize;
+    xOld.read = prvReadOld;
+    xNew.size = ulNewSize;
+    xNew.write = prvWriteNew;
+    DeltaPatch_Init( &xPatch, &xOld, &xNew );
+
+    for( ulOffset = 0; ( ulOffset < ulPatchSize ) && ( xStatus == DELTA_PATCH_ONGOING ); ulOffset += ulLength )
+    {
+        ulLength = ( ( ulPatchSize - ulOffset ) > deltagenVERIFY_CHUNK ) ? deltagenVERIFY_CHUNK : ( ulPatchSize - ulOffset );
+        xStatus = DeltaPatch_Process( &xPatch, &pucPatch[ ulOffset ], ulLength );
+    }
+
+    if( ( xStatus == DELTA_PATCH_DONE ) && ( xOutOfOrder || ( memcmp( pucRebuilt, pucNew, ulNewSize ) != 0 ) ) )
+    {
+        xStatus = DELTA_PATCH_CORRUPTED;
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    FILE * pxFile;
+    DeltaPatchStatus_t xStatus;
+    int iOption;
+
+    while( ( iOption = getopt( argc, argv, "v" ) ) != -1 )
+    {
+        if( iOption == 'v' )
+        {
+            xVerbose = true;
+        }
+        else
+        {
+            optind = argc;
+            break;
+        }
+    }
+
+    if( ( argc - optind ) != 3 )
+    {
+        fprintf( stderr, "Usage: %s [-v] <old image> <new image> <patch>\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    pucOld = prvLoad( argv[ optind ], &ulOldSize );
+    pucNew = prvLoad( argv[ optind + 1 ], &ulNewSize );
+
+    prvIndexOld();
+    prvGenerate();
+    prvCompress();
+    xStatus = prvVerify();
+
+    if( xStatus != DELTA_PATCH_DONE )
+    {
+        fprintf( stderr, "The patch does not rebuild the new image, status %d.\n", xStatus );
+        return EXIT_FAILURE;
+    }
+
+    pxFile = fopen( argv[ optind + 2 ], "wb" );
+
+    if( ( pxFile == NULL ) || ( fwrite( pucPatch, 1, ulPatchSize, pxFile ) != ulPatchSize ) )
+    {
+        fprintf( stderr, "Cannot write %s.\n", argv[ optind + 2 ] );
+        return EXIT_FAILURE;
+    }
+
+    fclose( pxFile );
+
+    printf( "Old image %lu bytes, new image %lu bytes, patch %lu bytes (%.1f %% of the new image).\n",
+            ( unsigned long ) ulOldSize, ( unsigned long ) ulNewSize, ( unsigned long ) ulPatchSize,
+            100.0 * ulPatchSize / ( ulNewSize > 0U ? ulNewSize : 1U ) );
+
+    if( xVerbose )
+    {
+        printf( "%lu adds of %lu bytes, %lu of them changed, %lu inserts of %lu bytes, %lu bytes of operations.\n",
+                ( unsigned long ) ulAddOps, ( unsigned long ) ulAddBytes, ( unsigned long ) ulAddLiterals,
+                ( unsigned long ) ulInsertOps, ( unsigned long ) ulInsertBytes, ( unsigned long ) ulOpsSize );
+    }
+
+    printf( "Verified by the device code: %lu bytes of RAM, new image written in %u byte pages.\n",
+            ( unsigned long ) sizeof( DeltaPatch_t ), ( unsigned ) lorawanConfigDELTA_PAGE_SIZE );
+
+    return EXIT_SUCCESS;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,624 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file frag_sim.c
+ * @brief Fragmented data block transport simulator.
+ *
+ * Sends a data block to a multicast group of devices as the fragmentation package (LoRaWAN TS004) does: the uncoded
+ * fragments, then coded fragments until every device recovered the block. Each device loses fragments independently,
+ * runs the decoder of the demo over a storage in RAM and verifies the CRC-32 which ends the block. The downlinks
+ * needed are compared with a multicast transport without coding, in which the devices report their missing fragments
+ * after each round and the union of the missing fragments is sent again. The status answers of these rounds are counted
+ * as lost when they overlap on a channel, sent at once or spread by the BlockAckDelay of TS004 as the device does.
+ *
+ * Usage: frag_sim [-i <file>] [-b <block bytes>] [-z <fragment bytes>] [-n <devices>] [-l <loss ratio>]
+ *                 [-g <mean loss burst>] [-k <BlockAckDelay>] [-s <seed>] [-v]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "frag_decoder.h"
+
+/**
+ * @brief Default simulation parameters.
+ */
+#define fragsimDEFAULT_BLOCK_BYTES     ( 32768U )
+#define fragsimDEFAULT_FRAG_BYTES      ( 48U )
+#define fragsimDEFAULT_DEVICES         ( 20U )
+#define fragsimDEFAULT_LOSS_RATIO      ( 0.1 )
+#define fragsimDEFAULT_SEED            ( 1U )
+#define fragsimDEFAULT_BLOCK_ACK_DELAY ( 0U )
+
+/**
+ * @brief Status answers: time on air of a FragSessionStatusAns at DR0 of US915, SF10 on 125 kHz, channels of a sub-band,
+ * and spread of the answers sent at once by the devices which received the same multicast request.
+ */
+#define fragsimSTATUS_AIRTIME_MS       ( 330U )
+#define fragsimSTATUS_CHANNELS         ( 8U )
+#define fragsimSTATUS_AT_ONCE_MS       ( 100U )
+
+/**
+ * @brief Simulated device: decoder, storage and loss state.
+ */
+typedef struct FragSimDevice
+{
+    FragDecoder_t xDecoder;
+    FragDecoderStorage_t xStorage;
+    uint8_t * pucStorage;
+    bool xBurst;                   /**< @brief Set while the device is in a loss burst. */
+    bool xDone;
+    uint32_t ulLost;               /**< @brief Fragments lost by the device. */
+    uint32_t ulDoneAfter;          /**< @brief Fragments sent when the device recovered the block. */
+} FragSimDevice_t;
+
+/**
+ * @brief Simulation parameters.
+ */
+static const char * pcImage = NULL;
+static uint32_t ulBlockBytes = fragsimDEFAULT_BLOCK_BYTES;
+static uint32_t ulFragBytes = fragsimDEFAULT_FRAG_BYTES;
+static uint32_t ulDevices = fragsimDEFAULT_DEVICES;
+static double dLossRatio = fragsimDEFAULT_LOSS_RATIO;
+static double dMeanBurst = 1.0;
+static uint32_t ulBlockAckDelay = fragsimDEFAULT_BLOCK_ACK_DELAY;
+static uint64_t ullSeed = fragsimDEFAULT_SEED;
+static bool xVerbose = false;
+
+/**
+ * @brief State of the draws of the status answers, apart so that they do not change the fragment losses.
+ */
+static uint64_t ullStatusSeed;
+
+static FragSimDevice_t * pxDevices;
+
+/**
+ * @brief Storage accessed by the decoder, the storage callbacks have no context.
+ */
+static FragSimDevice_t * pxCurrent;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvRandomFrom( uint64_t * pullState )
+{
+    /* xorshift64*. */
+    *pullState ^= *pullState >> 12;
+    *pullState ^= *pullState << 25;
+    *pullState ^= *pullState >> 27;
+
+    return *pullState * 2685821657736338717ULL;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvRandom( void )
+{
+    return prvRandomFrom( &ullSeed );
+}
+/*-----------------------------------------------------------*/
+
+static double prvUniform( void )
+{
+    return ( double ) ( prvRandom() >> 11 ) / ( double ) ( 1ULL << 53 );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Draws the loss of a fragment with a two state model: the mean burst length gives the probability to stay in a loss
+ * burst, and the probability to enter one keeps the loss ratio. A mean burst of 1 gives independent losses.
+ */
+static bool prvLost( FragSimDevice_t * pxDevice )
+{
+    double dStay = 1.0 - ( 1.0 / dMeanBurst );
+    double dEnter = ( dLossRatio * ( 1.0 - dStay ) ) / ( 1.0 - dLossRatio );
+
+    pxDevice->xBurst = ( prvUniform() < ( pxDevice->xBurst ? dStay : dEnter ) );
+
+    return pxDevice->xBurst;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvWrite( uint32_t ulOffset,
+                      const uint8_t * pucData,
+                      uint32_t ulLength )
+{
+    if( ( ulOffset + ulLength ) > pxCurrent->xStorage.size )
+    {
+        return false;
+    }
+
+    memcpy( &pxCurrent->pucStorage[ ulOffset ], pucData, ulLength );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvRead( uint32_t ulOffset,
+                     uint8_t * pucData,
+                     uint32_t ulLength )
+{
+    if( ( ulOffset + ulLength ) > pxCurrent->xStorage.size )
+    {
+        return false;
+    }
+
+    memcpy( pucData, &pxCurrent->pucStorage[ ulOffset ], ulLength );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/* Loads the image, or makes a random one, and appends its CRC-32. */
+static uint8_t * prvLoadBlock( uint32_t ulPaddedBytes )
+{
+    uint8_t * pucBlock = calloc( ulPaddedBytes, 1 );
+    uint32_t ulCrc;
+    uint32_t i;
+    FILE * pxFile;
+
+    if( pucBlock == NULL )
+    {
+        return NULL;
+    }
+
+    if( pcImage != NULL )
+    {
+        pxFile = fopen( pcImage, "rb" );
+
+        if( ( pxFile == NULL ) || ( fread( pucBlock, 1, ulBlockBytes - 4U, pxFile ) != ( ulBlockBytes - 4U ) ) )
+        {
+            fprintf( stderr, "Cannot read %s.\n", pcImage );
+            exit( EXIT_FAILURE );
+        }
+
+        fclose( pxFile );
+    }
+    else
+    {
+        for( i = 0; i < ( ulBlockBytes - 4U ); i++ )
+        {
+            pucBlock[ i ] = ( uint8_t ) prvRandom();
+        }
+    }
+
+    ulCrc = FragDecoder_Crc32( 0, pucBlock, ulBlockBytes - 4U );
+
+    for( i = 0; i < 4U; i++ )
+    {
+        pucBlock[ ulBlockBytes - 4U + i ] = ( uint8_t ) ( ulCrc >> ( 8U * i ) );
+    }
+
+    return pucBlock;
+}
+/*-----------------------------------------------------------*/
+
+/* Builds fragment ulCounter of the block as the fragmentation package sends it. */
+static void prvEncode( const uint8_t * pucBlock,
+                       uint16_t usNbFrag,
+                       uint32_t ulCounter,
+                       uint8_t * pucFragment )
+{
+    static uint8_t ucRow[ ( lorawanConfigFRAG_MAX_NB + 7 ) / 8 ];
+    uint32_t i, j;
+
+    if( ulCounter <= usNbFrag )
+    {
+        memcpy( pucFragment, &pucBlock[ ( ulCounter - 1U ) * ulFragBytes ], ulFragBytes );
+        return;
+    }
+
+    FragDecoder_GetParityRow( ulCounter - usNbFrag, usNbFrag, ucRow );
+    memset( pucFragment, 0, ulFragBytes );
+
+    for( i = 0; i < usNbFrag; i++ )
+    {
+        if( ( ( ucRow[ i >> 3 ] >> ( i & 7U ) ) & 1U ) != 0U )
+        {
+            for( j = 0; j < ulFragBytes; j++ )
+            {
+                pucFragment[ j ] ^= pucBlock[ ( i * ulFragBytes ) + j ];
+            }
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Sends coded fragments until every device recovered the block, returns the fragments sent. */
+static uint32_t prvRunCoded( const uint8_t * pucBlock,
+                             uint16_t usNbFrag,
+                             uint32_t * pulFailed )
+{
+    uint8_t ucFragment[ lorawanConfigFRAG_MAX_SIZE ];
+    uint32_t ulCounter = 0;
+    uint32_t ulRemaining = ulDevices;
+    uint32_t ulLimit = ( uint32_t ) usNbFrag + lorawanConfigFRAG_MAX_NB;
+    FragDecoderStatus_t xStatus;
+    uint32_t ulCrc, ulExpected;
+    uint32_t i;
+
+    *pulFailed = 0;
+
+    while( ( ulRemaining > 0U ) && ( ulCounter < ulLimit ) )
+    {
+        ulCounter++;
+        prvEncode( pucBlock, usNbFrag, ulCounter, ucFragment );
+
+        for( i = 0; i < ulDevices; i++ )
+        {
+            pxCurrent = &pxDevices[ i ];
+
+            if( pxCurrent->xDone == true )
+            {
+                continue;
+            }
+
+            if( prvLost( pxCurrent ) == true )
+            {
+                pxCurrent->ulLost++;
+                continue;
+            }
+
+            xStatus = FragDecoder_Process( &pxCurrent->xDecoder, ( uint16_t ) ulCounter, ucFragment );
+
+            if( xStatus == FRAG_DECODER_ONGOING )
+            {
+                continue;
+            }
+
+            pxCurrent->xDone = true;
+            pxCurrent->ulDoneAfter = ulCounter;
+            ulRemaining--;
+
+            ulCrc = FragDecoder_Crc32( 0, pxCurrent->pucStorage, ulBlockBytes - 4U );
+            ulExpected = ( uint32_t ) pxCurrent->pucStorage[ ulBlockBytes - 4U ] |
+                         ( ( uint32_t ) pxCurrent->pucStorage[ ulBlockBytes - 3U ] << 8 ) |
+                         ( ( uint32_t ) pxCurrent->pucStorage[ ulBlockBytes - 2U ] << 16 ) |
+                         ( ( uint32_t ) pxCurrent->pucStorage[ ulBlockBytes - 1U ] << 24 );
+
+            if( ( xStatus != FRAG_DECODER_DONE ) || ( ulCrc != ulExpected ) ||
+                ( memcmp( pxCurrent->pucStorage, pucBlock, ulBlockBytes ) != 0 ) )
+            {
+                ( *pulFailed )++;
+            }
+
+            if( xVerbose == true )
+            {
+                printf( "Device %u: %s after %u fragments, %u lost.\n", ( unsigned ) i,
+                        ( xStatus == FRAG_DECODER_DONE ) ? "recovered the block" : "gave up",
+                        ( unsigned ) ulCounter, ( unsigned ) pxCurrent->ulLost );
+            }
+        }
+    }
+
+    *pulFailed += ulRemaining;
+
+    return ulCounter;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Draws the start time and the channel of ulAnswers status answers, each delayed by the draw of pxDelay, and returns the
+ * answers which overlap another one on their channel.
+ */
+static uint32_t prvCountCollisions( uint32_t ulAnswers,
+                                    uint32_t ( * pxDelay )( void ) )
+{
+    uint32_t * pulStartMs = malloc( ( ( size_t ) ulAnswers + 1U ) * sizeof( uint32_t ) );
+    uint32_t * pulChannel = malloc( ( ( size_t ) ulAnswers + 1U ) * sizeof( uint32_t ) );
+    uint32_t ulCollided = 0;
+    uint32_t i, j;
+
+    if( ( pulStartMs == NULL ) || ( pulChannel == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    for( i = 0; i < ulAnswers; i++ )
+    {
+        pulStartMs[ i ] = pxDelay();
+        pulChannel[ i ] = ( uint32_t ) ( prvRandomFrom( &ullStatusSeed ) % fragsimSTATUS_CHANNELS );
+    }
+
+    for( i = 0; i < ulAnswers; i++ )
+    {
+        for( j = 0; j < ulAnswers; j++ )
+        {
+            if( ( i != j ) && ( pulChannel[ i ] == pulChannel[ j ] ) &&
+                ( ( ( pulStartMs[ i ] > pulStartMs[ j ] ) ? ( pulStartMs[ i ] - pulStartMs[ j ] ) :
+                    ( pulStartMs[ j ] - pulStartMs[ i ] ) ) < fragsimSTATUS_AIRTIME_MS ) )
+            {
+                ulCollided++;
+                break;
+            }
+        }
+    }
+
+    free( pulStartMs );
+    free( pulChannel );
+
+    return ulCollided;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvDelayAtOnce( void )
+{
+    return ( uint32_t ) ( prvRandomFrom( &ullStatusSeed ) % fragsimSTATUS_AT_ONCE_MS );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvDelayBlockAck( void )
+{
+    return FragDecoder_GetAnswerDelayMs( ( uint8_t ) ulBlockAckDelay, ( uint32_t ) prvRandomFrom( &ullStatusSeed ) );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Sends the fragments without coding, then again the fragments missed by any device, round after round. Returns the
+ * fragments sent, and the rounds in pulRounds: every device which is still missing fragments sends a status uplink
+ * after each round. pulCollided counts the status uplinks lost to collisions, sent at once and with the BlockAckDelay.
+ */
+static uint32_t prvRunRetransmissions( uint16_t usNbFrag,
+                                       uint32_t * pulRounds,
+                                       uint32_t * pulStatusUplinks,
+                                       uint32_t * pulCollided )
+{
+    uint8_t * pucMissing = malloc( ( size_t ) ulDevices * usNbFrag );
+    uint8_t * pucSend = malloc( usNbFrag );
+    uint32_t ulSent = 0;
+    uint32_t ulToSend = usNbFrag;
+    uint32_t i, j, ulLeft, ulAnswers;
+
+    if( ( pucMissing == NULL ) || ( pucSend == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    memset( pucMissing, 1, ( size_t ) ulDevices * usNbFrag );
+    memset( pucSend, 1, usNbFrag );
+    *pulRounds = 0;
+    *pulStatusUplinks = 0;
+    pulCollided[ 0 ] = 0;
+    pulCollided[ 1 ] = 0;
+
+    for( i = 0; i < ulDevices; i++ )
+    {
+        pxDevices[ i ].xBurst = false;
+    }
+
+    while( ulToSend > 0U )
+    {
+        ( *pulRounds )++;
+
+        for( j = 0; j < usNbFrag; j++ )
+        {
+            if( pucSend[ j ] == 0U )
+            {
+                continue;
+            }
+
+            ulSent++;
+
+            for( i = 0; i < ulDevices; i++ )
+            {
+                if( prvLost( &pxDevices[ i ] ) == false )
+                {
+                    pucMissing[ ( i * usNbFrag ) + j ] = 0;
+                }
+            }
+        }
+
+        memset( pucSend, 0, usNbFrag );
+        ulToSend = 0;
+        ulAnswers = 0;
+
+        for( i = 0; i < ulDevices; i++ )
+        {
+            ulLeft = 0;
+
+            for( j = 0; j < usNbFrag; j++ )
+            {
+                if( pucMissing[ ( i * usNbFrag ) + j ] != 0U )
+                {
+                    ulLeft++;
+                    ulToSend += ( pucSend[ j ] == 0U ) ? 1U : 0U;
+                    pucSend[ j ] = 1;
+                }
+            }
+
+            ulAnswers += ( ulLeft > 0U ) ? 1U : 0U;
+        }
+
+        *pulStatusUplinks += ulAnswers;
+        pulCollided[ 0 ] += prvCountCollisions( ulAnswers, prvDelayAtOnce );
+        pulCollided[ 1 ] += prvCountCollisions( ulAnswers, prvDelayBlockAck );
+    }
+
+    free( pucMissing );
+    free( pucSend );
+
+    return ulSent;
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    fprintf( stderr,
+             "Usage: %s [-i <file>] [-b <block bytes>] [-z <fragment bytes>] [-n <devices>] [-l <loss ratio>]\n"
+             "          [-g <mean loss burst>] [-k <BlockAckDelay>] [-s <seed>] [-v]\n",
+             pcProgram );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvParseOptions( int argc,
+                             char ** argv )
+{
+    int iOption;
+    FILE * pxFile;
+
+    while( ( iOption = getopt( argc, argv, "i:b:z:n:l:g:k:s:v" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'i':
+                pcImage = optarg;
+                break;
+
+            case 'b':
+                ulBlockBytes = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'z':
+                ulFragBytes = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'n':
+                ulDevices = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'l':
+                dLossRatio = strtod( optarg, NULL );
+                break;
+
+            case 'g':
+                dMeanBurst = strtod( optarg, NULL );
+                break;
+
+            case 'k':
+                ulBlockAckDelay = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 's':
+                ullSeed = strtoull( optarg, NULL, 0 );
+                break;
+
+            case 'v':
+                xVerbose = true;
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                break;
+        }
+    }
+
+    if( pcImage != NULL )
+    {
+        pxFile = fopen( pcImage, "rb" );
+
+        if( pxFile == NULL )
+        {
+            fprintf( stderr, "Cannot open %s.\n", pcImage );
+            exit( EXIT_FAILURE );
+        }
+
+        fseek( pxFile, 0, SEEK_END );
+        ulBlockBytes = ( uint32_t ) ftell( pxFile ) + 4U;
+        fclose( pxFile );
+    }
+
+    if( ( ulFragBytes == 0U ) || ( ulFragBytes > lorawanConfigFRAG_MAX_SIZE ) || ( ulBlockBytes <= 4U ) ||
+        ( ( ( ulBlockBytes + ulFragBytes - 1U ) / ulFragBytes ) > lorawanConfigFRAG_MAX_NB ) || ( ulDevices == 0U ) ||
+        ( dLossRatio < 0.0 ) || ( dLossRatio >= 1.0 ) || ( dMeanBurst < 1.0 ) || ( ulBlockAckDelay > 7U ) )
+    {
+        prvUsage( argv[ 0 ] );
+    }
+
+    if( ullSeed == 0U )
+    {
+        ullSeed = fragsimDEFAULT_SEED;
+    }
+
+    ullStatusSeed = ullSeed ^ 0x9E3779B97F4A7C15ULL;
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint16_t usNbFrag;
+    uint8_t * pucBlock;
+    uint32_t ulCoded, ulFailed, ulRetransmitted, ulRounds, ulStatusUplinks;
+    uint32_t ulCollided[ 2 ];
+    uint32_t ulLost = 0;
+    uint32_t i;
+
+    prvParseOptions( argc, argv );
+
+    usNbFrag = ( uint16_t ) ( ( ulBlockBytes + ulFragBytes - 1U ) / ulFragBytes );
+    pucBlock = prvLoadBlock( ( uint32_t ) usNbFrag * ulFragBytes );
+    pxDevices = calloc( ulDevices, sizeof( FragSimDevice_t ) );
+
+    if( ( pucBlock == NULL ) || ( pxDevices == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( i = 0; i < ulDevices; i++ )
+    {
+        pxDevices[ i ].xStorage.size = ( uint32_t ) usNbFrag * ulFragBytes;
+        pxDevices[ i ].xStorage.write = prvWrite;
+        pxDevices[ i ].xStorage.read = prvRead;
+        pxDevices[ i ].pucStorage = calloc( pxDevices[ i ].xStorage.size, 1 );
+
+        if( ( pxDevices[ i ].pucStorage == NULL ) ||
+            ( FragDecoder_Init( &pxDevices[ i ].xDecoder, usNbFrag, ( uint8_t ) ulFragBytes, &pxDevices[ i ].xStorage ) == false ) )
+        {
+            fprintf( stderr, "Cannot start the decoder of device %u.\n", ( unsigned ) i );
+            return EXIT_FAILURE;
+        }
+    }
+
+    ulCoded = prvRunCoded( pucBlock, usNbFrag, &ulFailed );
+
+    for( i = 0; i < ulDevices; i++ )
+    {
+        ulLost += pxDevices[ i ].ulLost;
+    }
+
+    ulRetransmitted = prvRunRetransmissions( usNbFrag, &ulRounds, &ulStatusUplinks, ulCollided );
+
+    printf( "Block: %u bytes in %u fragments of %u bytes, %u devices, loss ratio %.3f, mean loss burst %.1f.\n",
+            ( unsigned ) ulBlockBytes, ( unsigned ) usNbFrag, ( unsigned ) ulFragBytes, ( unsigned ) ulDevices,
+            dLossRatio, dMeanBurst );
+    printf( "Forward error correction: %u downlinks (%.1f %% over the block), %u fragments lost in total, "
+            "%u devices failed or gave up.\n",
+            ( unsigned ) ulCoded, 100.0 * ( double ) ( ulCoded - usNbFrag ) / ( double ) usNbFrag,
+            ( unsigned ) ulLost, ( unsigned ) ulFailed );
+    printf( "Retransmission rounds: %u downlinks (%.1f %% over the block) in %u rounds, %u status uplinks.\n",
+            ( unsigned ) ulRetransmitted, 100.0 * ( double ) ( ulRetransmitted - usNbFrag ) / ( double ) usNbFrag,
+            ( unsigned ) ulRounds, ( unsigned ) ulStatusUplinks );
+    printf( "Status uplinks lost to collisions: %u sent at once, %u with BlockAckDelay %u (%u to %u s).\n",
+            ( unsigned ) ulCollided[ 0 ], ( unsigned ) ulCollided[ 1 ], ( unsigned ) ulBlockAckDelay,
+            ( unsigned ) ( 16U << ulBlockAckDelay ), ( unsigned ) ( 32U << ulBlockAckDelay ) );
+    printf( "Decoder RAM per device: %u bytes.\n", ( unsigned ) sizeof( FragDecoder_t ) );
+
+    return ( ulFailed == 0U ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
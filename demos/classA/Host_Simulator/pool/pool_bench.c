@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file pool_bench.c
+ * @brief Latency of the block pools against the FreeRTOS heap.
+ *
+ * Allocates and frees blocks with block_pool.c and with pvPortMalloc() and vPortFree() of heap_4.c, the heap of the
+ * boards, in three patterns: a block freed right after it is allocated, a random block of a set of live blocks replaced
+ * by a new one, as the log records waiting for the console, and the same with random sizes up to the block size, as the
+ * heap sees the messages of vLoggingPrint(). Both allocators replay the same sequence. Prints the mean time of an
+ * allocation and a free, timed over the whole sequence, and the 99.9th percentile of a single allocation or free, timed
+ * one by one in a second run, less the time of a clock reading.
+ *
+ * The benchmark runs without the scheduler, so the vTaskSuspendAll() and xTaskResumeAll() around each heap operation
+ * are empty here, while on the boards they are a critical section each. The pool never needs them.
+ *
+ * Usage: pool_bench [-s <block size>] [-n <blocks>] [-k <live blocks>] [-i <iterations>] [-S <seed>]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "block_pool.h"
+
+/**
+ * @brief Default benchmark parameters: the log records of the demo.
+ */
+#define pbenchDEFAULT_BLOCK_SIZE    ( configLOGGING_MAX_MESSAGE_LENGTH )
+#define pbenchDEFAULT_BLOCKS        ( 16U )
+#define pbenchDEFAULT_ITERATIONS    ( 1000000U )
+#define pbenchDEFAULT_SEED          ( 0x9E3779B97F4A7C15ULL )
+
+/**
+ * @brief Smallest block of the random sizes.
+ */
+#define pbenchMIN_SIZE              ( 16U )
+
+/**
+ * @brief Buckets of 1 ns of the latency histogram, the last one counting the longer operations.
+ */
+#define pbenchHISTOGRAM_NS          ( 10000U )
+
+/**
+ * @brief Patterns of allocations.
+ */
+typedef enum PBenchPattern
+{
+    pbenchPAIRS = 0,
+    pbenchCHURN,
+    pbenchCHURN_RANDOM_SIZES,
+    pbenchPATTERNS
+} PBenchPattern_t;
+
+/**
+ * @brief Allocator measured.
+ */
+typedef struct PBenchAllocator
+{
+    const char * pcName;
+    void * ( *pvAlloc )( size_t xSize );
+    void ( * vFree )( void * pv );
+} PBenchAllocator_t;
+
+/**
+ * @brief Times of a pattern in ns.
+ */
+typedef struct PBenchResult
+{
+    double dMeanNs;         /* Allocation and free. */
+    double dP999Ns;         /* Single allocation or free. */
+    uint32_t ulFailures;
+} PBenchResult_t;
+
+/**
+ * @brief Benchmark parameters.
+ */
+static uint32_t ulBlockSize = pbenchDEFAULT_BLOCK_SIZE;
+static uint32_t ulBlocks = pbenchDEFAULT_BLOCKS;
+static uint32_t ulLive = 0;
+static uint32_t ulIterations = pbenchDEFAULT_ITERATIONS;
+static uint64_t ullSeed = pbenchDEFAULT_SEED;
+
+static const char * const pcPatternNames[ pbenchPATTERNS ] = { "pairs", "churn", "churn, random sizes" };
+
+static BlockPool_t xPool;
+static void ** ppvLive;
+static uint32_t * pulSlots;
+static size_t * pxSizes;
+static uint32_t ulHistogram[ pbenchHISTOGRAM_NS + 1U ];
+static double dClockReadNs;
+
+/*-----------------------------------------------------------*/
+
+/* The heap runs without the scheduler. */
+void vTaskSuspendAll( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskResumeAll( void )
+{
+    return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationMallocFailedHook( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * pcFile,
+                    unsigned long ulLine )
+{
+    fprintf( stderr, "Assertion failed in %s at line %lu.\n", pcFile, ulLine );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvRandom( void )
+{
+    /* xorshift64*. */
+    ullSeed ^= ullSeed >> 12;
+    ullSeed ^= ullSeed << 25;
+    ullSeed ^= ullSeed >> 27;
+
+    return ullSeed * 2685821657736338717ULL;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void prvMeasureClock( void )
+{
+    uint64_t ullStart = prvNowNs();
+    uint32_t i;
+
+    for( i = 0; i < ulIterations; i++ )
+    {
+        ( void ) prvNowNs();
+    }
+
+    dClockReadNs = ( double ) ( prvNowNs() - ullStart ) / ( double ) ulIterations;
+}
+/*-----------------------------------------------------------*/
+
+static void * prvPoolAlloc( size_t xSize )
+{
+    ( void ) xSize;
+
+    return BlockPool_Alloc( &xPool );
+}
+/*-----------------------------------------------------------*/
+
+static void prvPoolFree( void * pv )
+{
+    ( void ) BlockPool_Free( &xPool, pv );
+}
+/*-----------------------------------------------------------*/
+
+static const PBenchAllocator_t xAllocators[] =
+{
+    { "block pool", prvPoolAlloc, prvPoolFree },
+    { "heap_4",     pvPortMalloc, vPortFree   }
+};
+
+/*-----------------------------------------------------------*/
+
+/* Draws the sequence of a pattern: the live block replaced and the size of its replacement, per iteration. */
+static void prvDrawSequence( PBenchPattern_t xPattern )
+{
+    uint32_t i;
+
+    for( i = 0; i < ulIterations; i++ )
+    {
+        pulSlots[ i ] = ( xPattern == pbenchPAIRS ) ? 0U : ( uint32_t ) ( prvRandom() % ulLive );
+        pxSizes[ i ] = ( xPattern == pbenchCHURN_RANDOM_SIZES ) ?
+                       ( pbenchMIN_SIZE + ( size_t ) ( prvRandom() % ( ulBlockSize - pbenchMIN_SIZE + 1U ) ) ) :
+                       ulBlockSize;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvStart( bool xTimeEach )
+{
+    return xTimeEach ? prvNowNs() : 0U;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecord( bool xTimeEach,
+                       uint64_t ullStart )
+{
+    uint64_t ullNs;
+
+    if( xTimeEach )
+    {
+        ullNs = prvNowNs() - ullStart;
+        ulHistogram[ ( ullNs < pbenchHISTOGRAM_NS ) ? ullNs : pbenchHISTOGRAM_NS ]++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Replays the sequence, the pairs freeing the block at once, the churn freeing the block of the slot first. */
+static uint64_t prvReplay( const PBenchAllocator_t * pxAllocator,
+                           PBenchPattern_t xPattern,
+                           bool xTimeEach,
+                           uint32_t * pulFailures )
+{
+    uint64_t ullStart;
+    uint64_t ullTotal;
+    uint32_t i;
+    void ** ppv;
+
+    for( i = 0; i < ulLive; i++ )
+    {
+        ppvLive[ i ] = ( xPattern == pbenchPAIRS ) ? NULL : pxAllocator->pvAlloc( ulBlockSize );
+    }
+
+    ullTotal = prvNowNs();
+
+    for( i = 0; i < ulIterations; i++ )
+    {
+        ppv = &ppvLive[ pulSlots[ i ] ];
+
+        if( xPattern != pbenchPAIRS )
+        {
+            ullStart = prvStart( xTimeEach );
+            pxAllocator->vFree( *ppv );
+            prvRecord( xTimeEach, ullStart );
+        }
+
+        ullStart = prvStart( xTimeEach );
+        *ppv = pxAllocator->pvAlloc( pxSizes[ i ] );
+        prvRecord( xTimeEach, ullStart );
+
+        if( *ppv == NULL )
+        {
+            ( *pulFailures )++;
+        }
+        else if( xPattern == pbenchPAIRS )
+        {
+            ullStart = prvStart( xTimeEach );
+            pxAllocator->vFree( *ppv );
+            prvRecord( xTimeEach, ullStart );
+            *ppv = NULL;
+        }
+    }
+
+    ullTotal = prvNowNs() - ullTotal;
+
+    for( i = 0; i < ulLive; i++ )
+    {
+        if( ppvLive[ i ] != NULL )
+        {
+            pxAllocator->vFree( ppvLive[ i ] );
+        }
+    }
+
+    return ullTotal;
+}
+/*-----------------------------------------------------------*/
+
+static double prvPercentile( double dFraction )
+{
+    uint64_t ullCount = 0;
+    uint64_t ullTarget;
+    uint32_t i;
+
+    for( i = 0; i <= pbenchHISTOGRAM_NS; i++ )
+    {
+        ullCount += ulHistogram[ i ];
+    }
+
+    ullTarget = ( uint64_t ) ( ( double ) ullCount * dFraction );
+    ullCount = 0;
+
+    for( i = 0; i < pbenchHISTOGRAM_NS; i++ )
+    {
+        ullCount += ulHistogram[ i ];
+
+        if( ullCount > ullTarget )
+        {
+            break;
+        }
+    }
+
+    return ( ( double ) i > dClockReadNs ) ? ( ( double ) i - dClockReadNs ) : 0.0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRun( const PBenchAllocator_t * pxAllocator,
+                    PBenchPattern_t xPattern,
+                    PBenchResult_t * pxResult )
+{
+    uint32_t ulUnused = 0;
+    uint32_t i;
+
+    pxResult->ulFailures = 0;
+    pxResult->dMeanNs = ( double ) prvReplay( pxAllocator, xPattern, false, &ulUnused ) / ( double ) ulIterations;
+
+    for( i = 0; i <= pbenchHISTOGRAM_NS; i++ )
+    {
+        ulHistogram[ i ] = 0;
+    }
+
+    ( void ) prvReplay( pxAllocator, xPattern, true, &pxResult->ulFailures );
+    pxResult->dP999Ns = prvPercentile( 0.999 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    fprintf( stderr,
+             "Usage: %s [-s <block size>] [-n <blocks>] [-k <live blocks>] [-i <iterations>] [-S <seed>]\n",
+             pcProgram );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvParseOptions( int argc,
+                             char ** argv )
+{
+    int iOption;
+
+    while( ( iOption = getopt( argc, argv, "s:n:k:i:S:" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 's':
+                ulBlockSize = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'n':
+                ulBlocks = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'k':
+                ulLive = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'i':
+                ulIterations = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'S':
+                ullSeed = ( uint64_t ) strtoull( optarg, NULL, 0 );
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                break;
+        }
+    }
+
+    if( ulLive == 0U )
+    {
+        ulLive = ( ulBlocks + 1U ) / 2U;
+    }
+
+    /* The churn needs a free block to replace a live one. */
+    if( ( ulBlockSize < pbenchMIN_SIZE ) || ( ulBlocks == 0U ) || ( ulBlocks > BLOCK_POOL_MAX_BLOCKS ) ||
+        ( ulLive >= ulBlocks ) || ( ulIterations == 0U ) || ( ullSeed == 0U ) ||
+        ( ( ( size_t ) ulBlocks * ulBlockSize ) > ( configTOTAL_HEAP_SIZE / 2U ) ) )
+    {
+        prvUsage( argv[ 0 ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    PBenchResult_t xResults[ sizeof( xAllocators ) / sizeof( xAllocators[ 0 ] ) ];
+    size_t xBlockSize;
+    size_t i;
+    uint32_t ulPattern;
+    uint8_t * pucStorage;
+    uint16_t * pusLinks;
+
+    prvParseOptions( argc, argv );
+
+    xBlockSize = BLOCK_POOL_BLOCK_SIZE( ( size_t ) ulBlockSize );
+    pucStorage = malloc( xBlockSize * ulBlocks );
+    pusLinks = malloc( sizeof( uint16_t ) * ulBlocks );
+    ppvLive = malloc( sizeof( void * ) * ulLive );
+    pulSlots = malloc( sizeof( uint32_t ) * ulIterations );
+    pxSizes = malloc( sizeof( size_t ) * ulIterations );
+
+    if( ( pucStorage == NULL ) || ( pusLinks == NULL ) || ( ppvLive == NULL ) || ( pulSlots == NULL ) ||
+        ( pxSizes == NULL ) || !BlockPool_Init( &xPool, "bench", pucStorage, xBlockSize, ( uint16_t ) ulBlocks, pusLinks ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return EXIT_FAILURE;
+    }
+
+    prvMeasureClock();
+
+    printf( "%u blocks of %u bytes, %u live in the churn, %u iterations, %.1f ns per clock reading.\n\n", ulBlocks,
+            ulBlockSize, ulLive, ulIterations, dClockReadNs );
+    printf( "%-20s %-12s %14s %18s %9s\n", "pattern", "allocator", "mean ns/pair", "p99.9 ns/operation", "failures" );
+
+    for( ulPattern = 0; ulPattern < pbenchPATTERNS; ulPattern++ )
+    {
+        prvDrawSequence( ( PBenchPattern_t ) ulPattern );
+
+        for( i = 0; i < ( sizeof( xAllocators ) / sizeof( xAllocators[ 0 ] ) ); i++ )
+        {
+            prvRun( &xAllocators[ i ], ( PBenchPattern_t ) ulPattern, &xResults[ i ] );
+            printf( "%-20s %-12s %14.1f %18.1f %9u\n", pcPatternNames[ ulPattern ], xAllocators[ i ].pcName,
+                    xResults[ i ].dMeanNs, xResults[ i ].dP999Ns, xResults[ i ].ulFailures );
+        }
+    }
+
+    printf( "\nPool high water %u of %u blocks, heap minimum free %u bytes.\n", xPool.highWater, ulBlocks,
+            ( unsigned ) xPortGetMinimumEverFreeHeapSize() );
+
+    return EXIT_SUCCESS;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+
+/**
+ * @file rx_timing_sim.c
+ * @brief Receive window timing simulator.
+ *
+ * Sends confirmed uplinks from devices whose clock is off the network by a bias, a crystal drift and a jitter drawn for
+ * each frame, with now and then a long latency spike, and answers each uplink in RX1 unless the frame is lost. The receive
+ * windows are placed and sized as LoRaMAC 4.4 does from the timing error and the preamble symbols it is given, and an
+ * answer is only received if the window covers enough of its preamble. The same frames are replayed with the fixed
+ * lorawanConfigRX_MAX_TIMING_ERROR and with the calibration of the demo, which measures each answer with a latency of
+ * the LoRaMAC task, to compare the time the radio spends receiving for each uplink and the answers missed.
+ *
+ * Usage: rx_timing_sim [-n <devices>] [-u <uplinks>] [-D <uplink data rate>] [-b <bias ms>] [-p <drift ppm>]
+ *                      [-j <jitter ms>] [-L <measurement latency ms>] [-e <loss %>] [-k <spikes per 1000>]
+ *                      [-K <spike ms>] [-s <seed>] [-v]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "rx_timing.h"
+
+/**
+ * @brief Default simulation parameters.
+ */
+#define rxsimDEFAULT_DEVICES         ( 100U )
+#define rxsimDEFAULT_UPLINKS         ( 1000U )
+#define rxsimDEFAULT_DATARATE        ( 0U )
+#define rxsimDEFAULT_BIAS_MS         ( 5.0 )
+#define rxsimDEFAULT_DRIFT_PPM       ( 20.0 )
+#define rxsimDEFAULT_JITTER_MS       ( 0.5 )
+#define rxsimDEFAULT_LATENCY_MS      ( 2.0 )
+#define rxsimDEFAULT_LOSS_PERCENT    ( 10.0 )
+#define rxsimDEFAULT_SPIKES          ( 5.0 )
+#define rxsimDEFAULT_SPIKE_MS        ( 20.0 )
+#define rxsimDEFAULT_SEED            ( 1U )
+
+/**
+ * @brief US915 receive windows: RX1 one second after the uplink on its spreading factor at 500 kHz, RX2 one second later
+ * at DR8, SF12 at 500 kHz. The answer is an empty frame with the ACK bit.
+ */
+#define rxsimRECEIVE_DELAY1_MS       ( 1000U )
+#define rxsimRECEIVE_DELAY2_MS       ( 2000U )
+#define rxsimRX2_SPREADING_FACTOR    ( 12U )
+#define rxsimBANDWIDTH_INDEX         ( 2U )
+#define rxsimBANDWIDTH_HZ            ( 500000.0 )
+#define rxsimANSWER_BYTES            ( 12U )
+#define rxsimPREAMBLE_SYMBOLS        ( 8U )
+
+/**
+ * @brief Preamble symbols the radio needs to detect a frame.
+ */
+#define rxsimDETECT_SYMBOLS          ( 5U )
+
+/**
+ * @brief Strategies compared: the fixed timing error, then the calibration.
+ */
+#define rxsimSTRATEGIES              ( 2U )
+
+/**
+ * @brief Timing of one answer of the trace.
+ */
+typedef struct RxSimFrame
+{
+    bool xLost;             /**< @brief The answer is not received whatever the window. */
+    double dOffsetMs;       /**< @brief Start of the preamble minus its expected time, positive when late. */
+    double dLatencyMs;      /**< @brief Latency of the LoRaMAC task when the answer is measured. */
+} RxSimFrame_t;
+
+/**
+ * @brief Results of a strategy.
+ */
+typedef struct RxSimResult
+{
+    uint64_t ullUplinks;
+    uint64_t ullAnswers;            /**< @brief Answers not lost, which a wide enough window receives. */
+    uint64_t ullReceived;
+    uint64_t ullRx1OnMs;
+    uint64_t ullRx2OnMs;
+    uint64_t ullErrorMs;            /**< @brief Sum of the timing errors the windows were placed with. */
+    uint64_t ullFallbacks;
+} RxSimResult_t;
+
+/**
+ * @brief Simulation parameters.
+ */
+static uint32_t ulDevices = rxsimDEFAULT_DEVICES;
+static uint32_t ulUplinks = rxsimDEFAULT_UPLINKS;
+static uint32_t ulDataRate = rxsimDEFAULT_DATARATE;
+static double dBiasMs = rxsimDEFAULT_BIAS_MS;
+static double dDriftPpm = rxsimDEFAULT_DRIFT_PPM;
+static double dJitterMs = rxsimDEFAULT_JITTER_MS;
+static double dLatencyMs = rxsimDEFAULT_LATENCY_MS;
+static double dLossPercent = rxsimDEFAULT_LOSS_PERCENT;
+static double dSpikes = rxsimDEFAULT_SPIKES;
+static double dSpikeMs = rxsimDEFAULT_SPIKE_MS;
+static uint64_t ullSeed = rxsimDEFAULT_SEED;
+static bool xVerbose = false;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvRandom( void )
+{
+    /* xorshift64*. */
+    ullSeed ^= ullSeed >> 12;
+    ullSeed ^= ullSeed << 25;
+    ullSeed ^= ullSeed >> 27;
+
+    return ullSeed * 2685821657736338717ULL;
+}
+/*-----------------------------------------------------------*/
+
+static double prvUniform( void )
+{
+    return ( double ) ( prvRandom() >> 11 ) / ( double ) ( 1ULL << 53 );
+}
+/*-----------------------------------------------------------*/
+
+static double prvGaussian( double dSigma )
+{
+    /* Box-Muller transform, the first draw must not be 0 for the logarithm. */
+    double dU1 = 1.0 - prvUniform();
+
+    return dSigma * sqrt( -2.0 * log( dU1 ) ) * cos( 2.0 * M_PI * prvUniform() );
+}
+/*-----------------------------------------------------------*/
+
+/* Draws the clock of a device and the timing of the answers to its uplinks. */
+static void prvMakeTrace( RxSimFrame_t * pxFrames,
+                          uint32_t ulFrames )
+{
+    double dDeviceBiasMs = dBiasMs * ( ( 2.0 * prvUniform() ) - 1.0 );
+    double dDevicePpm = dDriftPpm * ( ( 2.0 * prvUniform() ) - 1.0 );
+    uint32_t i;
+
+    for( i = 0; i < ulFrames; i++ )
+    {
+        pxFrames[ i ].xLost = ( prvUniform() * 100.0 ) < dLossPercent;
+        pxFrames[ i ].dOffsetMs = dDeviceBiasMs + ( dDevicePpm * 1e-6 * ( double ) rxsimRECEIVE_DELAY1_MS ) +
+                                  prvGaussian( dJitterMs );
+
+        if( ( prvUniform() * 1000.0 ) < dSpikes )
+        {
+            pxFrames[ i ].dOffsetMs += dSpikeMs * prvUniform();
+        }
+
+        pxFrames[ i ].dLatencyMs = dLatencyMs * prvUniform();
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Opens a receive window as LoRaMAC 4.4 does, centered on the middle of the expected preamble and long enough for
+ * minRxSymbols symbols plus the timing error on each side. Returns the time the radio was on, and sets *pxReceived if a
+ * frame whose preamble starts dOffsetMs late was detected.
+ */
+static double prvOpenWindow( uint8_t ucSpreadingFactor,
+                             uint32_t ulMaxRxErrorMs,
+                             uint8_t ucMinRxSymbols,
+                             bool xFrameSent,
+                             double dOffsetMs,
+                             bool * pxReceived )
+{
+    double dSymbolMs = ( double ) ( 1UL << ucSpreadingFactor ) * 1000.0 / rxsimBANDWIDTH_HZ;
+    double dTimeoutSymbols = ceil( ( ( ( ( 2.0 * ucMinRxSymbols ) - 8.0 ) * dSymbolMs ) + ( 2.0 * ulMaxRxErrorMs ) ) / dSymbolMs );
+    double dOpenMs, dCloseMs;
+
+    dTimeoutSymbols = ( dTimeoutSymbols < ucMinRxSymbols ) ? ucMinRxSymbols : dTimeoutSymbols;
+    dOpenMs = ceil( ( 4.0 * dSymbolMs ) - ( dTimeoutSymbols * dSymbolMs / 2.0 ) );
+    dCloseMs = dOpenMs + ( dTimeoutSymbols * dSymbolMs );
+
+    /* The radio must listen to rxsimDETECT_SYMBOLS of the preamble before it ends, and before the window times out. */
+    *pxReceived = xFrameSent &&
+                  ( dOpenMs <= ( dOffsetMs + ( ( rxsimPREAMBLE_SYMBOLS - rxsimDETECT_SYMBOLS ) * dSymbolMs ) ) ) &&
+                  ( dCloseMs >= ( dOffsetMs + ( rxsimDETECT_SYMBOLS * dSymbolMs ) ) );
+
+    if( *pxReceived == true )
+    {
+        return dOffsetMs + ChannelTimeOnAir( ucSpreadingFactor, rxsimBANDWIDTH_INDEX, 1, rxsimANSWER_BYTES, false ) - dOpenMs;
+    }
+
+    return dCloseMs - dOpenMs;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunDevice( const RxSimFrame_t * pxFrames,
+                          uint32_t ulFrames,
+                          bool xCalibrated,
+                          RxSimResult_t * pxResult )
+{
+    RxTiming_t xTiming;
+    uint8_t ucSpreadingFactor = ( uint8_t ) ( 10U - ulDataRate );
+    double dRx1OnMs = 0.0;
+    double dRx2OnMs = 0.0;
+    bool xReceived, xUnused;
+    uint32_t i;
+
+    RxTiming_Init( &xTiming );
+
+    for( i = 0; i < ulFrames; i++ )
+    {
+        pxResult->ullUplinks++;
+        pxResult->ullAnswers += pxFrames[ i ].xLost ? 0U : 1U;
+        pxResult->ullErrorMs += xTiming.maxRxErrorMs;
+
+        dRx1OnMs += prvOpenWindow( ucSpreadingFactor, xTiming.maxRxErrorMs, xTiming.minRxSymbols,
+                                   !pxFrames[ i ].xLost, pxFrames[ i ].dOffsetMs, &xReceived );
+
+        if( xReceived == true )
+        {
+            pxResult->ullReceived++;
+
+            if( xCalibrated == true )
+            {
+                ( void ) RxTiming_AddDownlink( &xTiming,
+                                               ( float ) ( pxFrames[ i ].dOffsetMs + pxFrames[ i ].dLatencyMs ),
+                                               rxsimRECEIVE_DELAY1_MS );
+            }
+        }
+        else
+        {
+            /* Nothing is sent in RX2, the network answered in RX1. */
+            dRx2OnMs += prvOpenWindow( rxsimRX2_SPREADING_FACTOR, xTiming.maxRxErrorMs, xTiming.minRxSymbols,
+                                       false, 0.0, &xUnused );
+
+            if( xCalibrated == true )
+            {
+                ( void ) RxTiming_OnMissed( &xTiming );
+            }
+        }
+    }
+
+    pxResult->ullRx1OnMs += ( uint64_t ) dRx1OnMs;
+    pxResult->ullRx2OnMs += ( uint64_t ) dRx2OnMs;
+    pxResult->ullFallbacks += xTiming.fallbacks;
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    fprintf( stderr,
+             "Usage: %s [-n <devices>] [-u <uplinks>] [-D <uplink data rate>] [-b <bias ms>] [-p <drift ppm>]\n"
+             "          [-j <jitter ms>] [-L <measurement latency ms>] [-e <loss %%>] [-k <spikes per 1000>]\n"
+             "          [-K <spike ms>] [-s <seed>] [-v]\n",
+             pcProgram );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvParseOptions( int argc,
+                             char ** argv )
+{
+    int iOption;
+
+    while( ( iOption = getopt( argc, argv, "n:u:D:b:p:j:L:e:k:K:s:v" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'n':
+                ulDevices = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'u':
+                ulUplinks = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'D':
+                ulDataRate = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'b':
+                dBiasMs = strtod( optarg, NULL );
+                break;
+
+            case 'p':
+                dDriftPpm = strtod( optarg, NULL );
+                break;
+
+            case 'j':
+                dJitterMs = strtod( optarg, NULL );
+                break;
+
+            case 'L':
+                dLatencyMs = strtod( optarg, NULL );
+                break;
+
+            case 'e':
+                dLossPercent = strtod( optarg, NULL );
+                break;
+
+            case 'k':
+                dSpikes = strtod( optarg, NULL );
+                break;
+
+            case 'K':
+                dSpikeMs = strtod( optarg, NULL );
+                break;
+
+            case 's':
+                ullSeed = strtoull( optarg, NULL, 0 );
+                break;
+
+            case 'v':
+                xVerbose = true;
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                break;
+        }
+    }
+
+    if( ( ulDevices == 0U ) || ( ulUplinks == 0U ) || ( ulDataRate > 3U ) || ( ullSeed == 0U ) )
+    {
+        prvUsage( argv[ 0 ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    RxSimResult_t xResults[ rxsimSTRATEGIES ] = { 0 };
+    RxSimFrame_t * pxFrames;
+    uint32_t i, ulStrategy;
+
+    prvParseOptions( argc, argv );
+
+    pxFrames = malloc( ( size_t ) ulUplinks * sizeof( RxSimFrame_t ) );
+
+    if( pxFrames == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( i = 0; i < ulDevices; i++ )
+    {
+        prvMakeTrace( pxFrames, ulUplinks );
+
+        for( ulStrategy = 0; ulStrategy < rxsimSTRATEGIES; ulStrategy++ )
+        {
+            RxSimResult_t xDevice = { 0 };
+
+            prvRunDevice( pxFrames, ulUplinks, ( ulStrategy == 1U ), &xDevice );
+
+            xResults[ ulStrategy ].ullUplinks += xDevice.ullUplinks;
+            xResults[ ulStrategy ].ullAnswers += xDevice.ullAnswers;
+            xResults[ ulStrategy ].ullReceived += xDevice.ullReceived;
+            xResults[ ulStrategy ].ullRx1OnMs += xDevice.ullRx1OnMs;
+            xResults[ ulStrategy ].ullRx2OnMs += xDevice.ullRx2OnMs;
+            xResults[ ulStrategy ].ullErrorMs += xDevice.ullErrorMs;
+            xResults[ ulStrategy ].ullFallbacks += xDevice.ullFallbacks;
+
+            if( ( xVerbose == true ) && ( ulStrategy == 1U ) )
+            {
+                printf( "Device %u: %.1f ms of RX per uplink, %llu answers missed, %llu fall-backs.\n", ( unsigned ) i,
+                        ( double ) ( xDevice.ullRx1OnMs + xDevice.ullRx2OnMs ) / ( double ) xDevice.ullUplinks,
+                        ( unsigned long long ) ( xDevice.ullAnswers - xDevice.ullReceived ),
+                        ( unsigned long long ) xDevice.ullFallbacks );
+            }
+        }
+    }
+
+    printf( "%u devices, %u confirmed uplinks each at DR%u, bias up to %.1f ms, drift up to %.0f ppm, jitter %.1f ms,\n"
+            "%.1f latency spikes of up to %.0f ms per 1000 answers, %.0f %% of the answers lost.\n",
+            ( unsigned ) ulDevices, ( unsigned ) ulUplinks, ( unsigned ) ulDataRate, dBiasMs, dDriftPpm, dJitterMs,
+            dSpikes, dSpikeMs, dLossPercent );
+    printf( "%-12s %10s %10s %10s %12s %14s %10s\n", "timing", "RX ms/up", "RX1 ms/up", "RX2 ms/up", "error ms",
+            "answers missed", "fall-backs" );
+
+    for( ulStrategy = 0; ulStrategy < rxsimSTRATEGIES; ulStrategy++ )
+    {
+        const RxSimResult_t * pxResult = &xResults[ ulStrategy ];
+
+        printf( "%-12s %10.1f %10.1f %10.1f %12.1f %7llu %5.2f%% %10llu\n",
+                ( ulStrategy == 0U ) ? "fixed" : "calibrated",
+                ( double ) ( pxResult->ullRx1OnMs + pxResult->ullRx2OnMs ) / ( double ) pxResult->ullUplinks,
+                ( double ) pxResult->ullRx1OnMs / ( double ) pxResult->ullUplinks,
+                ( double ) pxResult->ullRx2OnMs / ( double ) pxResult->ullUplinks,
+                ( double ) pxResult->ullErrorMs / ( double ) pxResult->ullUplinks,
+                ( unsigned long long ) ( pxResult->ullAnswers - pxResult->ullReceived ),
+                100.0 * ( double ) ( pxResult->ullAnswers - pxResult->ullReceived ) / ( double ) pxResult->ullAnswers,
+                ( unsigned long long ) pxResult->ullFallbacks );
+    }
+
+    free( pxFrames );
+
+    return EXIT_SUCCESS;
+}
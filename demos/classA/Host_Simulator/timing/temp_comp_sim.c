@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file temp_comp_sim.c
+ * @brief Temperature compensation simulator.
+ *
+ * Runs devices whose 32768 Hz crystal follows a parabolic curve off the one of the demo by a coefficient and turnover
+ * mismatch, through synthetic temperature traces: a mean per device, a daily swing coldest before dawn and a slow
+ * weather random walk. The on-die sensor reads the temperature with a bias, noise and steps of 0.25 degree every
+ * lorawanConfigTEMP_SAMPLE_PERIOD_SEC seconds. The local time of each device is kept with the raw crystal and with the
+ * compensation of the demo, and compared with the true time after each network synchronization, and against a budget
+ * for the number of synchronizations it takes to stay within it.
+ *
+ * Usage: temp_comp_sim [-n <devices>] [-d <days>] [-P <sample period s>] [-m <mean C>] [-M <mean spread C>]
+ *                      [-w <daily swing C>] [-W <weather C>] [-b <sensor bias C>] [-N <sensor noise C>]
+ *                      [-c <coefficient mismatch %>] [-T <turnover mismatch C>] [-o <offset ppm>]
+ *                      [-r <sync period h>] [-E <budget ms>] [-s <seed>] [-v]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "temp_comp.h"
+
+/**
+ * @brief Default simulation parameters.
+ */
+#define tcsimDEFAULT_DEVICES        ( 100U )
+#define tcsimDEFAULT_DAYS           ( 30U )
+#define tcsimDEFAULT_MEAN_C         ( 15.0 )
+#define tcsimDEFAULT_SPREAD_C       ( 10.0 )
+#define tcsimDEFAULT_SWING_C        ( 8.0 )
+#define tcsimDEFAULT_WEATHER_C      ( 4.0 )
+#define tcsimDEFAULT_BIAS_C         ( 2.0 )
+#define tcsimDEFAULT_NOISE_C        ( 0.5 )
+#define tcsimDEFAULT_MISMATCH       ( 10.0 )
+#define tcsimDEFAULT_TURNOVER_C     ( 5.0 )
+#define tcsimDEFAULT_OFFSET_PPM     ( 0.0 )
+#define tcsimDEFAULT_SYNC_HOURS     ( 24.0 )
+#define tcsimDEFAULT_BUDGET_MS      ( 10.0 )
+#define tcsimDEFAULT_SEED           ( 1U )
+
+/**
+ * @brief Step of the simulation, the crystal frequency error is integrated at its middle.
+ */
+#define tcsimSTEP_MS                ( 10000U )
+
+/**
+ * @brief Correlation time of the weather random walk.
+ */
+#define tcsimWEATHER_HOURS          ( 72.0 )
+
+/**
+ * @brief Hour of the coldest temperature of the day.
+ */
+#define tcsimCOLDEST_HOUR           ( 5.0 )
+
+/**
+ * @brief Strategies compared: the raw crystal, then the compensation.
+ */
+#define tcsimSTRATEGIES             ( 2U )
+
+/**
+ * @brief Results of a strategy.
+ */
+typedef struct TcSimResult
+{
+    double * pdSyncErrorMs;         /**< @brief Error of the local time just before each synchronization. */
+    uint32_t ulSyncs;
+    double dMaxErrorMs;             /**< @brief Largest error between two synchronizations. */
+    uint64_t ullBudgetSyncs;        /**< @brief Synchronizations needed to stay within the budget. */
+} TcSimResult_t;
+
+/**
+ * @brief Simulation parameters.
+ */
+static uint32_t ulDevices = tcsimDEFAULT_DEVICES;
+static uint32_t ulDays = tcsimDEFAULT_DAYS;
+static uint32_t ulSamplePeriodSec = lorawanConfigTEMP_SAMPLE_PERIOD_SEC;
+static double dMeanC = tcsimDEFAULT_MEAN_C;
+static double dSpreadC = tcsimDEFAULT_SPREAD_C;
+static double dSwingC = tcsimDEFAULT_SWING_C;
+static double dWeatherC = tcsimDEFAULT_WEATHER_C;
+static double dBiasC = tcsimDEFAULT_BIAS_C;
+static double dNoiseC = tcsimDEFAULT_NOISE_C;
+static double dMismatchPercent = tcsimDEFAULT_MISMATCH;
+static double dTurnoverC = tcsimDEFAULT_TURNOVER_C;
+static double dOffsetPpm = tcsimDEFAULT_OFFSET_PPM;
+static double dSyncHours = tcsimDEFAULT_SYNC_HOURS;
+static double dBudgetMs = tcsimDEFAULT_BUDGET_MS;
+static uint64_t ullSeed = tcsimDEFAULT_SEED;
+static bool xVerbose = false;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvRandom( void )
+{
+    /* xorshift64*. */
+    ullSeed ^= ullSeed >> 12;
+    ullSeed ^= ullSeed << 25;
+    ullSeed ^= ullSeed >> 27;
+
+    return ullSeed * 2685821657736338717ULL;
+}
+/*-----------------------------------------------------------*/
+
+static double prvUniform( void )
+{
+    return ( double ) ( prvRandom() >> 11 ) / ( double ) ( 1ULL << 53 );
+}
+/*-----------------------------------------------------------*/
+
+static double prvSymmetric( double dRange )
+{
+    return dRange * ( ( 2.0 * prvUniform() ) - 1.0 );
+}
+/*-----------------------------------------------------------*/
+
+static double prvGaussian( double dSigma )
+{
+    /* Box-Muller transform, the first draw must not be 0 for the logarithm. */
+    double dU1 = 1.0 - prvUniform();
+
+    return dSigma * sqrt( -2.0 * log( dU1 ) ) * cos( 2.0 * M_PI * prvUniform() );
+}
+/*-----------------------------------------------------------*/
+
+static int prvCompare( const void * pvA,
+                       const void * pvB )
+{
+    double dA = *( const double * ) pvA;
+    double dB = *( const double * ) pvB;
+
+    return ( dA > dB ) - ( dA < dB );
+}
+/*-----------------------------------------------------------*/
+
+/* Records the error of a local time against the true time, since the last synchronization. */
+static void prvCheck( TcSimResult_t * pxResult,
+                      double dErrorMs,
+                      double * pdBudgetRefMs,
+                      bool xSync )
+{
+    double dSinceSyncMs = fabs( dErrorMs );
+
+    pxResult->dMaxErrorMs = ( dSinceSyncMs > pxResult->dMaxErrorMs ) ? dSinceSyncMs : pxResult->dMaxErrorMs;
+
+    if( xSync == true )
+    {
+        pxResult->pdSyncErrorMs[ pxResult->ulSyncs++ ] = dSinceSyncMs;
+    }
+
+    if( fabs( dErrorMs - *pdBudgetRefMs ) > dBudgetMs )
+    {
+        pxResult->ullBudgetSyncs++;
+        *pdBudgetRefMs = dErrorMs;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunDevice( TcSimResult_t * pxResults )
+{
+    TempComp_t xComp;
+    double dDeviceMeanC = dMeanC + prvSymmetric( dSpreadC );
+    double dSensorBiasC = prvSymmetric( dBiasC );
+    double dCoefficient = lorawanConfigTEMP_COMP_COEFFICIENT * ( 1.0 + prvSymmetric( dMismatchPercent / 100.0 ) );
+    double dTurnover = lorawanConfigTEMP_COMP_TURNOVER + prvSymmetric( dTurnoverC );
+    double dDeviceOffsetPpm = prvSymmetric( dOffsetPpm );
+    double dWeather = prvGaussian( dWeatherC );
+    double dDecay = exp( -( double ) tcsimSTEP_MS / ( tcsimWEATHER_HOURS * 3600000.0 ) );
+    double dCrystalMs = 0.0;
+    double dTrueMs = 0.0;
+    double dTemperature, dDelta, dSample;
+    double dSyncMs = dSyncHours * 3600000.0;
+    double dNextSyncMs = dSyncMs;
+    double dNextSampleMs = 0.0;
+    double dRawRefMs = 0.0, dCompRefMs = 0.0;   /* Local minus true time at the last synchronization. */
+    double dRawBudgetMs = 0.0, dCompBudgetMs = 0.0;
+    double dRawErrorMs, dCompErrorMs;
+    uint64_t ullSteps = ( uint64_t ) ulDays * 86400000ULL / tcsimSTEP_MS;
+    uint64_t i;
+    bool xSync;
+
+    TempComp_Init( &xComp, 0 );
+
+    for( i = 0; i < ullSteps; i++ )
+    {
+        /* The weather is an Ornstein-Uhlenbeck process of standard deviation dWeatherC. */
+        dWeather = ( dWeather * dDecay ) + prvGaussian( dWeatherC * sqrt( 1.0 - ( dDecay * dDecay ) ) );
+        dTemperature = dDeviceMeanC + dWeather -
+                       ( dSwingC * cos( 2.0 * M_PI * ( ( dTrueMs + ( tcsimSTEP_MS / 2.0 ) ) / 3600000.0 - tcsimCOLDEST_HOUR ) / 24.0 ) );
+
+        /* The on-die sensor reads the temperature the crystal had over the last step. */
+        if( dCrystalMs >= dNextSampleMs )
+        {
+            dSample = round( ( dTemperature + dSensorBiasC + prvGaussian( dNoiseC ) ) * 4.0 ) / 4.0;
+            TempComp_AddSample( &xComp, ( float ) dSample, ( uint64_t ) dCrystalMs );
+            dNextSampleMs = dCrystalMs + ( ulSamplePeriodSec * 1000.0 );
+        }
+
+        dDelta = dTemperature - dTurnover;
+        dCrystalMs += tcsimSTEP_MS * ( 1.0 + ( ( dDeviceOffsetPpm + ( dCoefficient * dDelta * dDelta ) ) * 1e-6 ) );
+        dTrueMs += tcsimSTEP_MS;
+
+        dRawErrorMs = ( dCrystalMs - dTrueMs ) - dRawRefMs;
+        dCompErrorMs = ( ( double ) ( int64_t ) TempComp_GetTimeMs( &xComp, ( uint64_t ) dCrystalMs ) +
+                         ( dCrystalMs - floor( dCrystalMs ) ) - dTrueMs ) - dCompRefMs;
+
+        xSync = ( dTrueMs >= dNextSyncMs );
+        prvCheck( &pxResults[ 0 ], dRawErrorMs, &dRawBudgetMs, xSync );
+        prvCheck( &pxResults[ 1 ], dCompErrorMs, &dCompBudgetMs, xSync );
+
+        /* The network time, for instance from a DeviceTimeReq, cancels the error of both. */
+        if( xSync == true )
+        {
+            dRawRefMs += dRawErrorMs;
+            dCompRefMs += dCompErrorMs;
+            dRawBudgetMs -= dRawErrorMs;
+            dCompBudgetMs -= dCompErrorMs;
+            dNextSyncMs += dSyncMs;
+        }
+    }
+
+    if( xVerbose == true )
+    {
+        printf( "Device at %.1f C, sensor off by %.2f C, %.4f ppm/C2 from %.1f C: %.1f ms raw and %.1f ms compensated.\n",
+                dDeviceMeanC, dSensorBiasC, dCoefficient, dTurnover, pxResults[ 0 ].dMaxErrorMs, pxResults[ 1 ].dMaxErrorMs );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    fprintf( stderr,
+             "Usage: %s [-n <devices>] [-d <days>] [-P <sample period s>] [-m <mean C>] [-M <mean spread C>]\n"
+             "          [-w <daily swing C>] [-W <weather C>] [-b <sensor bias C>] [-N <sensor noise C>]\n"
+             "          [-c <coefficient mismatch %%>] [-T <turnover mismatch C>] [-o <offset ppm>]\n"
+             "          [-r <sync period h>] [-E <budget ms>] [-s <seed>] [-v]\n",
+             pcProgram );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvParseOptions( int argc,
+                             char ** argv )
+{
+    int iOption;
+
+    while( ( iOption = getopt( argc, argv, "n:d:P:m:M:w:W:b:N:c:T:o:r:E:s:v" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'n':
+                ulDevices = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'd':
+                ulDays = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'P':
+                ulSamplePeriodSec = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'm':
+                dMeanC = strtod( optarg, NULL );
+                break;
+
+            case 'M':
+                dSpreadC = strtod( optarg, NULL );
+                break;
+
+            case 'w':
+                dSwingC = strtod( optarg, NULL );
+                break;
+
+            case 'W':
+                dWeatherC = strtod( optarg, NULL );
+                break;
+
+            case 'b':
+                dBiasC = strtod( optarg, NULL );
+                break;
+
+            case 'N':
+                dNoiseC = strtod( optarg, NULL );
+                break;
+
+            case 'c':
+                dMismatchPercent = strtod( optarg, NULL );
+                break;
+
+            case 'T':
+                dTurnoverC = strtod( optarg, NULL );
+                break;
+
+            case 'o':
+                dOffsetPpm = strtod( optarg, NULL );
+                break;
+
+            case 'r':
+                dSyncHours = strtod( optarg, NULL );
+                break;
+
+            case 'E':
+                dBudgetMs = strtod( optarg, NULL );
+                break;
+
+            case 's':
+                ullSeed = strtoull( optarg, NULL, 0 );
+                break;
+
+            case 'v':
+                xVerbose = true;
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                break;
+        }
+    }
+
+    if( ( ulDevices == 0U ) || ( ulDays == 0U ) || ( dSyncHours <= 0.0 ) || ( dBudgetMs <= 0.0 ) || ( ullSeed == 0U ) )
+    {
+        prvUsage( argv[ 0 ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    TcSimResult_t xResults[ tcsimSTRATEGIES ] = { 0 };
+    uint32_t ulMaxSyncs, i, ulStrategy;
+    double dSum;
+
+    prvParseOptions( argc, argv );
+
+    ulMaxSyncs = ulDevices * ( uint32_t ) ( ( ( double ) ulDays * 24.0 / dSyncHours ) + 1.0 );
+
+    for( ulStrategy = 0; ulStrategy < tcsimSTRATEGIES; ulStrategy++ )
+    {
+        xResults[ ulStrategy ].pdSyncErrorMs = malloc( ( size_t ) ulMaxSyncs * sizeof( double ) );
+
+        if( xResults[ ulStrategy ].pdSyncErrorMs == NULL )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            return EXIT_FAILURE;
+        }
+    }
+
+    for( i = 0; i < ulDevices; i++ )
+    {
+        TcSimResult_t xDevice[ tcsimSTRATEGIES ];
+
+        for( ulStrategy = 0; ulStrategy < tcsimSTRATEGIES; ulStrategy++ )
+        {
+            xDevice[ ulStrategy ] = xResults[ ulStrategy ];
+            xDevice[ ulStrategy ].dMaxErrorMs = 0.0;
+        }
+
+        prvRunDevice( xDevice );
+
+        for( ulStrategy = 0; ulStrategy < tcsimSTRATEGIES; ulStrategy++ )
+        {
+            xResults[ ulStrategy ].ulSyncs = xDevice[ ulStrategy ].ulSyncs;
+            xResults[ ulStrategy ].ullBudgetSyncs = xDevice[ ulStrategy ].ullBudgetSyncs;
+            xResults[ ulStrategy ].dMaxErrorMs = ( xDevice[ ulStrategy ].dMaxErrorMs > xResults[ ulStrategy ].dMaxErrorMs ) ?
+                                                 xDevice[ ulStrategy ].dMaxErrorMs : xResults[ ulStrategy ].dMaxErrorMs;
+        }
+    }
+
+    printf( "%u devices for %u days at %.1f C +- %.1f C, daily swing %.1f C, weather %.1f C, sensor bias up to %.1f C\n"
+            "and noise %.2f C sampled every %u s, crystal curve off by %.0f %% and %.1f C, offset up to %.1f ppm.\n",
+            ( unsigned ) ulDevices, ( unsigned ) ulDays, dMeanC, dSpreadC, dSwingC, dWeatherC, dBiasC, dNoiseC,
+            ( unsigned ) ulSamplePeriodSec, dMismatchPercent, dTurnoverC, dOffsetPpm );
+    printf( "%-12s %14s %14s %14s %18s\n", "time base", "mean ms/sync", "p95 ms/sync", "max ms/sync",
+            "syncs/day for E" );
+
+    for( ulStrategy = 0; ulStrategy < tcsimSTRATEGIES; ulStrategy++ )
+    {
+        TcSimResult_t * pxResult = &xResults[ ulStrategy ];
+
+        qsort( pxResult->pdSyncErrorMs, pxResult->ulSyncs, sizeof( double ), prvCompare );
+
+        for( i = 0, dSum = 0.0; i < pxResult->ulSyncs; i++ )
+        {
+            dSum += pxResult->pdSyncErrorMs[ i ];
+        }
+
+        printf( "%-12s %14.2f %14.2f %14.2f %18.2f\n",
+                ( ulStrategy == 0U ) ? "raw" : "compensated",
+                ( pxResult->ulSyncs > 0U ) ? dSum / pxResult->ulSyncs : 0.0,
+                ( pxResult->ulSyncs > 0U ) ? pxResult->pdSyncErrorMs[ ( pxResult->ulSyncs * 95U ) / 100U ] : 0.0,
+                ( pxResult->ulSyncs > 0U ) ? pxResult->pdSyncErrorMs[ pxResult->ulSyncs - 1U ] : 0.0,
+                ( double ) pxResult->ullBudgetSyncs / ( ( double ) ulDevices * ulDays ) );
+
+        free( pxResult->pdSyncErrorMs );
+    }
+
+    printf( "E is %.1f ms, the synchronizations are every %.1f h.\n", dBudgetMs, dSyncHours );
+
+    return EXIT_SUCCESS;
+}
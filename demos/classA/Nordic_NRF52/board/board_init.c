@@ -29,6 +29,9 @@
 #include "app_uart.h"
 #include "queue.h"
 #include "nrf_drv_gpiote.h"
+#include "nrf_temp.h"
+
+#include "energy_monitor.h"
 
 #include "SEGGER_RTT.h"
 
@@ -152,9 +155,10 @@ static void prvUartInit( void )
 void vUartWrite( uint8_t * pucData )
 {
     uint32_t xErrCode;
+    uint32_t i;
 
     SEGGER_RTT_WriteString(0, pucData);
-    for( uint32_t i = 0; i < configLOGGING_MAX_MESSAGE_LENGTH; i++ )
+    for( i = 0; i < configLOGGING_MAX_MESSAGE_LENGTH; i++ )
     {
         if(pucData[ i ] == 0)
         {
@@ -172,6 +176,8 @@ void vUartWrite( uint8_t * pucData )
         xSemaphoreTake(xUARTTxComplete, portMAX_DELAY );
 
     }
+
+    EnergyMonitor_AddLogBytes( i );
 }
 
 /**@brief Function for initializing the clock.
@@ -197,6 +203,96 @@ static void prvTimersInit( void )
     APP_ERROR_CHECK( xErrCode );
 }
 
+/*-----------------------------------------------------------*/
+
+/**@brief Reads the on-die temperature sensor, next to the 32768 Hz crystal.
+ *
+ * @details The SoftDevice is not enabled by the demo, so the TEMP peripheral is used directly. A conversion takes
+ * about 36 us, in steps of 0.25 C.
+ */
+bool getTemperature( float * temperature )
+{
+    NRF_TEMP->EVENTS_DATARDY = 0;
+    NRF_TEMP->TASKS_START = 1;
+
+    while( NRF_TEMP->EVENTS_DATARDY == 0 )
+    {
+    }
+
+    NRF_TEMP->EVENTS_DATARDY = 0;
+    *temperature = ( float ) nrf_temp_read() / 4.0f;
+    NRF_TEMP->TASKS_STOP = 1;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**@brief RTC1 count, the tick of the port, when the MCU went to sleep. */
+static uint32_t ulSleepStartCount = 0;
+
+/**@brief Called by the tickless idle before sleeping, with interrupts disabled.
+ *
+ * @details The FPU raises its interrupt on any inexact float operation. It is not enabled, but stays pending and would
+ * end each sleep at once, so the flags are cleared.
+ */
+void vBoardPreSleepProcessing( void )
+{
+    #if ( __FPU_USED == 1 )
+        __set_FPSCR( __get_FPSCR() & ~( 0x0000009FUL ) );
+        ( void ) __get_FPSCR();
+        NVIC_ClearPendingIRQ( FPU_IRQn );
+    #endif
+
+    ulSleepStartCount = NRF_RTC1->COUNTER;
+}
+/*-----------------------------------------------------------*/
+
+/**@brief Called by the tickless idle after sleeping, with interrupts disabled. Accounts the time slept.
+ */
+void vBoardPostSleepProcessing( void )
+{
+    /* The 24 bit counter runs at 32768 Hz divided by PRESCALER + 1. */
+    uint32_t ulCounts = ( NRF_RTC1->COUNTER - ulSleepStartCount ) & 0x00FFFFFFUL;
+
+    EnergyMonitor_AddMcuSleep( ( uint32_t ) ( ( ( uint64_t ) ulCounts * ( NRF_RTC1->PRESCALER + 1UL ) * 1000000ULL ) / 32768ULL ) );
+}
+/*-----------------------------------------------------------*/
+
+/**@brief RTC1 count at the last read of the run time counter, and the wraps of the 24 bit counter seen. */
+static uint32_t ulLastRunTimeCount = 0;
+static uint32_t ulRunTimeWraps = 0;
+
+/**@brief Counter of the run time statistics of the tasks, RTC1 extended to 32 bits.
+ *
+ * @details RTC1 keeps counting while the MCU sleeps, unlike the cycle counter of the DWT, so the time asleep is charged
+ * to the idle task. It is read at each context switch and the task monitor reads it periodically, well within the
+ * wrap of the 24 bit counter, more than 4 hours.
+ */
+uint32_t ulBoardGetRunTimeCounter( void )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    uint32_t ulCount;
+    uint32_t ulValue;
+
+    /* Called from the context switch and from tasks. */
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        ulCount = NRF_RTC1->COUNTER & 0x00FFFFFFUL;
+
+        if( ulCount < ulLastRunTimeCount )
+        {
+            ulRunTimeWraps++;
+        }
+
+        ulLastRunTimeCount = ulCount;
+        ulValue = ( ulRunTimeWraps << 24 ) | ulCount;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return ulValue;
+}
+
 
 void board_init( void )
 {
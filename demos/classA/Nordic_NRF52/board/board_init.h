@@ -1,6 +1,17 @@
 #ifndef _BOARD_INIT_H_
 #define _BOARD_INIT_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 void vBoardInit( void );
 
+bool getTemperature( float * temperature );
+
+void vBoardPreSleepProcessing( void );
+
+void vBoardPostSleepProcessing( void );
+
+uint32_t ulBoardGetRunTimeCounter( void );
+
 #endif
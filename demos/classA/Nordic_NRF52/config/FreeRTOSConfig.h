@@ -59,7 +59,7 @@
 
 #define configUSE_PREEMPTION                                                      1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION                                   0
-#define configUSE_TICKLESS_IDLE                                                   0
+#define configUSE_TICKLESS_IDLE                                                   1
 #define configUSE_TICKLESS_IDLE_SIMPLE_DEBUG                                      1 /* See into vPortSuppressTicksAndSleep source code for explanation */
 #define configCPU_CLOCK_HZ                                                        ( SystemCoreClock )
 #define configTICK_RATE_HZ                                                        1000
@@ -89,9 +89,16 @@
 #define configCHECK_FOR_STACK_OVERFLOW                                            2
 #define configUSE_MALLOC_FAILED_HOOK                                              1
 
-/* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS                                             0
-#define configUSE_TRACE_FACILITY                                                  0
+/* Run time and task stats gathering related definitions. The run time is
+ * counted on RTC1, which keeps counting while the MCU sleeps, see the task
+ * monitor. */
+#define configGENERATE_RUN_TIME_STATS                                             1
+#define configUSE_TRACE_FACILITY                                                  1
+#if !( defined( __ASSEMBLY__ ) || defined( __ASSEMBLER__ ) )
+    uint32_t ulBoardGetRunTimeCounter( void );
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()                                          ulBoardGetRunTimeCounter()
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                                                     0
@@ -106,7 +113,16 @@
 /* Tickless Idle configuration. */
 #define configEXPECTED_IDLE_TIME_BEFORE_SLEEP                                     2
 
-/* Tickless idle/low power functionality. */
+/* Tickless idle/low power functionality. The tick comes from RTC1, which keeps
+ * counting in System ON sleep, and the port of the SDK sleeps until the next task
+ * unblocks. The LoRaMAC timers are FreeRTOS software timers, so the expected idle
+ * time ends at the next of them. */
+#if !( defined( __ASSEMBLY__ ) || defined( __ASSEMBLER__ ) )
+    void vBoardPreSleepProcessing( void );
+    void vBoardPostSleepProcessing( void );
+#endif
+#define configPRE_SLEEP_PROCESSING( xExpectedIdleTime )                           vBoardPreSleepProcessing()
+#define configPOST_SLEEP_PROCESSING( xExpectedIdleTime )                          vBoardPostSleepProcessing()
 
 
 /* Define to trap errors during development. */
@@ -193,6 +209,13 @@ extern void vUartWrite( uint8_t * pucData );
  * and a time stamp. */
 #define configLOGGING_INCLUDE_TIME_AND_TASK_NAME    1
 
+/* Set to a number of messages to format the log messages into as many static
+ * buffers, with the queues and the task of the logging also allocated statically,
+ * instead of taking a buffer from the heap for each message. With
+ * lorawanConfigSTATIC_ALLOCATION, the heap is then no longer used after the
+ * initialization. Set to 0 to use the heap. */
+#define configLOGGING_STATIC_BUFFERS                0
+
 
 /* Application specific definitions follow. **********************************/
 
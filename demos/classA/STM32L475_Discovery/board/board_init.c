@@ -50,6 +50,8 @@
 #include "spi.h"
 #include "board-config.h"
 
+#include "energy_monitor.h"
+
 
 /* Include specific to the LoRa Shield used. */
 #if defined( SX1261MBXBAS ) || defined( SX1262MBXCAS ) || defined( SX1262MBXDAS )
@@ -359,12 +361,13 @@ static void SystemClock_Config( void )
 
     xPeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_RTC
                                           | RCC_PERIPHCLK_USART1 | RCC_PERIPHCLK_USART3 | RCC_PERIPHCLK_I2C2
-                                          | RCC_PERIPHCLK_RNG;
+                                          | RCC_PERIPHCLK_RNG | RCC_PERIPHCLK_ADC;
     xPeriphClkInit.Usart1ClockSelection = RCC_USART1CLKSOURCE_PCLK2;
     xPeriphClkInit.Usart3ClockSelection = RCC_USART3CLKSOURCE_PCLK1;
     xPeriphClkInit.I2c2ClockSelection = RCC_I2C2CLKSOURCE_PCLK1;
     xPeriphClkInit.RTCClockSelection = RCC_RTCCLKSOURCE_LSE;
     xPeriphClkInit.RngClockSelection = RCC_RNGCLKSOURCE_MSI;
+    xPeriphClkInit.AdcClockSelection = RCC_ADCCLKSOURCE_SYSCLK;
 
     if( HAL_RCCEx_PeriphCLKConfig( &xPeriphClkInit ) != HAL_OK )
     {
@@ -449,6 +452,95 @@ static void RTC_Init( void )
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Reads the internal temperature sensor through ADC1, using the factory calibration.
+ * The ADC is powered only for the conversion, which takes about 10 us with the sensor start up.
+ */
+bool getTemperature( float * temperature )
+{
+    ADC_HandleTypeDef xHadc = { 0 };
+    ADC_ChannelConfTypeDef xChannel = { 0 };
+    uint32_t ulRaw;
+    bool xResult = false;
+
+    __HAL_RCC_ADC_CLK_ENABLE();
+
+    xHadc.Instance = ADC1;
+    xHadc.Init.ClockPrescaler = ADC_CLOCK_ASYNC_DIV4;
+    xHadc.Init.Resolution = ADC_RESOLUTION_12B;
+    xHadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    xHadc.Init.ScanConvMode = ADC_SCAN_DISABLE;
+    xHadc.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+    xHadc.Init.ContinuousConvMode = DISABLE;
+    xHadc.Init.NbrOfConversion = 1;
+    xHadc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    xHadc.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+
+    /* The sensor needs at least 5 us of sampling, 640.5 cycles of the divided clock are well above. */
+    xChannel.Channel = ADC_CHANNEL_TEMPSENSOR;
+    xChannel.Rank = ADC_REGULAR_RANK_1;
+    xChannel.SamplingTime = ADC_SAMPLETIME_640CYCLES_5;
+    xChannel.SingleDiff = ADC_SINGLE_ENDED;
+    xChannel.OffsetNumber = ADC_OFFSET_NONE;
+
+    if( ( HAL_ADC_Init( &xHadc ) == HAL_OK ) &&
+        ( HAL_ADC_ConfigChannel( &xHadc, &xChannel ) == HAL_OK ) &&
+        ( HAL_ADCEx_Calibration_Start( &xHadc, ADC_SINGLE_ENDED ) == HAL_OK ) &&
+        ( HAL_ADC_Start( &xHadc ) == HAL_OK ) )
+    {
+        if( HAL_ADC_PollForConversion( &xHadc, 10 ) == HAL_OK )
+        {
+            /* Same as __HAL_ADC_CALC_TEMPERATURE() with a 3.3 V reference, without rounding to a degree. */
+            ulRaw = HAL_ADC_GetValue( &xHadc ) * 3300UL / TEMPSENSOR_CAL_VREFANALOG;
+            *temperature = ( float ) TEMPSENSOR_CAL1_TEMP +
+                           ( ( float ) ( TEMPSENSOR_CAL2_TEMP - TEMPSENSOR_CAL1_TEMP ) *
+                             ( ( float ) ulRaw - ( float ) *TEMPSENSOR_CAL1_ADDR ) /
+                             ( ( float ) *TEMPSENSOR_CAL2_ADDR - ( float ) *TEMPSENSOR_CAL1_ADDR ) );
+            xResult = true;
+        }
+
+        ( void ) HAL_ADC_Stop( &xHadc );
+    }
+
+    ( void ) HAL_ADC_DeInit( &xHadc );
+    __HAL_RCC_ADC_CLK_DISABLE();
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Stops the HAL time base before Stop 2, called with interrupts disabled.
+ */
+void vMainPreStopProcessing( void )
+{
+    HAL_SuspendTick();
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Restores the system clock after Stop 2, called with interrupts disabled.
+ * The MCU wakes up on the MSI with the PLL off, the rest of the configuration of SystemClock_Config() is kept.
+ */
+void vMainPostStopProcessing( void )
+{
+    __HAL_RCC_MSI_RANGE_CONFIG( RCC_MSIRANGE_11 );
+    __HAL_RCC_PLL_ENABLE();
+
+    while( __HAL_RCC_GET_FLAG( RCC_FLAG_PLLRDY ) == 0U )
+    {
+    }
+
+    __HAL_RCC_SYSCLK_CONFIG( RCC_SYSCLKSOURCE_PLLCLK );
+
+    while( __HAL_RCC_GET_SYSCLK_SOURCE() != RCC_SYSCLKSOURCE_STATUS_PLLCLK )
+    {
+    }
+
+    HAL_ResumeTick();
+}
+/*-----------------------------------------------------------*/
+
 /**
  * @brief  This function is executed in case of error occurrence.
  */
@@ -531,10 +623,14 @@ void vMainUARTPrintString( char * pcString )
 {
     const uint32_t ulTimeout = 3000UL;
 
+    size_t xLength = strlen( pcString );
+
     HAL_UART_Transmit( &xConsoleUart,
                        ( uint8_t * ) pcString,
-                       strlen( pcString ),
+                       xLength,
                        ulTimeout );
+
+    EnergyMonitor_AddLogBytes( ( uint32_t ) xLength );
 }
 /*-----------------------------------------------------------*/
 
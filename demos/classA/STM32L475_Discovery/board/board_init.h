@@ -86,6 +86,8 @@ extern RTC_HandleTypeDef xHrtc;
 extern RNG_HandleTypeDef xHrng;
 
 void board_init( void );
+bool getTemperature( float * temperature );
+uint32_t ulBoardGetRunTimeCounter( void );
 
 #ifdef __cplusplus
     }
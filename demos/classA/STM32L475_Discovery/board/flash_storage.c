@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#include "board_init.h"
+#include "delta_patch.h"
+#include "flash.h"
+#include "flash_storage.h"
+
+/**
+ * @brief Base address of the alternate bank, resolved once.
+ */
+static uint32_t ulAlternateBankAddr = 0;
+
+static FragDecoderStorage_t xAlternateBankStorage = { 0 };
+
+/**
+ * @brief Running image, the base of the delta patches.
+ */
+static FragDecoderStorage_t xCurrentBankStorage = { 0 };
+
+/*-----------------------------------------------------------*/
+
+static bool prvWrite( uint32_t ulOffset,
+                      const uint8_t * pucData,
+                      uint32_t ulLength )
+{
+    if( ( ulOffset + ulLength ) > xAlternateBankStorage.size )
+    {
+        return false;
+    }
+
+    /* FLASH_update() erases and programs the pages touched, keeping the rest of their content. */
+    return ( FLASH_update( ulAlternateBankAddr + ulOffset, pucData, ulLength ) == ( int ) ulLength );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvRead( uint32_t ulOffset,
+                     uint8_t * pucData,
+                     uint32_t ulLength )
+{
+    if( ( ulOffset + ulLength ) > xAlternateBankStorage.size )
+    {
+        return false;
+    }
+
+    memcpy( pucData, ( const void * ) ( ulAlternateBankAddr + ulOffset ), ulLength );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvReadCurrent( uint32_t ulOffset,
+                            uint8_t * pucData,
+                            uint32_t ulLength )
+{
+    if( ( ulOffset + ulLength ) > xCurrentBankStorage.size )
+    {
+        return false;
+    }
+
+    memcpy( pucData, ( const void * ) ( FLASH_get_current_bank_addr() + ulOffset ), ulLength );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Moves the patch received at the start of the bank to its end, page aligned, so that the new image can be written from
+ * the start. The copy runs backwards, so each chunk is read before the pages it overlaps are rewritten.
+ */
+static bool prvRelocatePatch( uint32_t ulPatchSize,
+                              uint32_t * pulPatchOffset )
+{
+    uint8_t ucHeader[ DELTA_PATCH_HEADER_SIZE ];
+    uint8_t * pucChunk;
+    uint32_t ulNewSize;
+    uint32_t ulOffset;
+    uint32_t ulLength;
+    uint32_t ulRemaining = ulPatchSize;
+    bool xResult = true;
+
+    if( ( ulPatchSize < DELTA_PATCH_HEADER_SIZE ) || ( ulPatchSize > xAlternateBankStorage.size ) )
+    {
+        return false;
+    }
+
+    ( void ) prvRead( 0, ucHeader, DELTA_PATCH_HEADER_SIZE );
+    ulNewSize = ( uint32_t ) ucHeader[ 12 ] | ( ( uint32_t ) ucHeader[ 13 ] << 8 ) |
+                ( ( uint32_t ) ucHeader[ 14 ] << 16 ) | ( ( uint32_t ) ucHeader[ 15 ] << 24 );
+    ulOffset = ( xAlternateBankStorage.size - ulPatchSize ) & ~( FLASH_PAGE_SIZE - 1U );
+
+    if( ulNewSize > ulOffset )
+    {
+        configPRINTF( ( "Patch of %lu bytes and image of %lu bytes do not fit in the bank.\r\n",
+                        ( unsigned long ) ulPatchSize, ( unsigned long ) ulNewSize ) );
+        return false;
+    }
+
+    pucChunk = pvPortMalloc( FLASH_PAGE_SIZE );
+
+    if( pucChunk == NULL )
+    {
+        return false;
+    }
+
+    while( ( ulRemaining > 0U ) && ( xResult == true ) )
+    {
+        ulLength = ( ulRemaining > FLASH_PAGE_SIZE ) ? FLASH_PAGE_SIZE : ulRemaining;
+        ulRemaining -= ulLength;
+
+        xResult = prvRead( ulRemaining, pucChunk, ulLength ) &&
+                  prvWrite( ulOffset + ulRemaining, pucChunk, ulLength );
+    }
+
+    vPortFree( pucChunk );
+    *pulPatchOffset = ulOffset;
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/* Rebuilds the new image in the alternate bank from the running image and the patch received there. */
+static bool prvApplyPatch( uint32_t ulPatchSize )
+{
+    DeltaPatch_t * pxPatch;
+    DeltaPatchStatus_t xStatus = DELTA_PATCH_STORAGE_ERROR;
+    uint32_t ulPatchOffset = 0;
+
+    xCurrentBankStorage.size = FLASH_get_bank_size();
+    xCurrentBankStorage.read = prvReadCurrent;
+
+    if( prvRelocatePatch( ulPatchSize, &ulPatchOffset ) == false )
+    {
+        return false;
+    }
+
+    /* The page buffer makes the state too large for the stack of the application task. */
+    pxPatch = pvPortMalloc( sizeof( DeltaPatch_t ) );
+
+    if( pxPatch != NULL )
+    {
+        DeltaPatch_Init( pxPatch, &xCurrentBankStorage, &xAlternateBankStorage );
+        xStatus = DeltaPatch_Apply( pxPatch, &xAlternateBankStorage, ulPatchOffset, ulPatchSize );
+        vPortFree( pxPatch );
+    }
+
+    configPRINTF( ( "Delta patch of %lu bytes applied with status %d.\r\n", ( unsigned long ) ulPatchSize, xStatus ) );
+
+    return ( xStatus == DELTA_PATCH_DONE );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvActivate( uint32_t ulBlockSize )
+{
+    uint8_t ucMagic[ 4 ];
+
+    /* A block starting with the patch magic is a delta to the running image, anything else a full image. */
+    if( ( ulBlockSize >= sizeof( ucMagic ) ) && prvRead( 0, ucMagic, sizeof( ucMagic ) ) &&
+        DeltaPatch_IsPatch( ucMagic, sizeof( ucMagic ) ) )
+    {
+        if( prvApplyPatch( ulBlockSize ) == false )
+        {
+            return false;
+        }
+    }
+
+    if( FLASH_set_boot_bank( FLASH_BANK_BOTH ) != 0 )
+    {
+        return false;
+    }
+
+    /* Reloading the option bytes resets the MCU, which boots from the other bank. */
+    return ( HAL_FLASH_OB_Launch() == HAL_OK );
+}
+/*-----------------------------------------------------------*/
+
+const FragDecoderStorage_t * pxFlashStorageGetAlternateBank( void )
+{
+    if( ulAlternateBankAddr == 0 )
+    {
+        ulAlternateBankAddr = FLASH_get_alternate_bank_addr();
+
+        if( ulAlternateBankAddr == 0 )
+        {
+            return NULL;
+        }
+
+        xAlternateBankStorage.size = FLASH_get_bank_size();
+        xAlternateBankStorage.write = prvWrite;
+        xAlternateBankStorage.read = prvRead;
+        xAlternateBankStorage.activate = prvActivate;
+    }
+
+    return &xAlternateBankStorage;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+#include "frag_decoder.h"
+
+/**
+ * @brief Returns the storage of the data blocks in the flash bank the firmware is not running from.
+ *
+ * The fragments are written in place with FLASH_update(), and the block is read back from the memory mapped bank.
+ * Activating a block swaps the boot bank and reloads the option bytes, which resets the MCU into the new firmware.
+ * A block which is a delta patch (see delta_patch.h) is first applied to the running image, the new image being rebuilt
+ * page by page in the alternate bank.
+ *
+ * @return Storage for LoRaWAN_SetDataBlockStorage(), NULL if the running bank cannot be determined.
+ */
+const FragDecoderStorage_t * pxFlashStorageGetAlternateBank( void );
+
+#endif /* FLASH_STORAGE_H */
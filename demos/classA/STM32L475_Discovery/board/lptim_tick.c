@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/**
+ * @file lptim_tick.c
+ * @brief FreeRTOS tick from LPTIM1 on the LSE, with tickless idle in Stop 2.
+ *
+ * SysTick stops in Stop 2, so the tick is generated by LPTIM1, which keeps counting the 32768 Hz LSE in Stop 2 and
+ * wakes the MCU up through EXTI. The counter runs freely over 16 bits and each tick is a compare match: tick n of a
+ * cycle of lptimTICKS_PER_CYCLE ticks starts at count n * lptimCOUNTS_PER_CYCLE / lptimTICKS_PER_CYCLE, so the tick
+ * rate is exact although a tick is not a whole number of counts. When idle, the compare is moved to the tick the next
+ * task unblocks at and the MCU enters Stop 2. The LoRaMAC timers are FreeRTOS software timers (freertos_osal/timer.c),
+ * so the next of them bounds the expected idle time through the timer task, and the receive windows are opened on
+ * time. Stop 2 is left in a few us, and the clocks are restored well within the tick.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "board_init.h"
+#include "energy_monitor.h"
+
+/**
+ * @brief LPTIM1 counts the LSE divided by 8, so that the 16 bit counter wraps every 16 s.
+ */
+#define lptimPRESCALER           ( 3UL << LPTIM_CFGR_PRESC_Pos )
+#define lptimCLOCK_HZ            ( 32768UL / 8UL )
+
+/**
+ * @brief lptimCOUNTS_PER_CYCLE counts make lptimTICKS_PER_CYCLE ticks, 4096 Hz for 1000 Hz.
+ */
+#define lptimTICKS_PER_CYCLE     ( 125UL )
+#define lptimCOUNTS_PER_CYCLE    ( 512UL )
+
+/**
+ * @brief A compare takes effect a few LSE cycles after it is written, so it must be at least that far ahead.
+ */
+#define lptimMIN_LEAD_COUNTS     ( 2 )
+
+/**
+ * @brief Longest sleep, below the wrap of the counter.
+ */
+#define lptimMAX_IDLE_TICKS      ( 15000UL )
+
+/**
+ * @brief Count at which the cycle of the last tick processed started, and the ticks processed in that cycle.
+ */
+static uint16_t usCycleStartCount = 0;
+static uint32_t ulTickInCycle = 0;
+
+/**
+ * @brief Cycles processed since the start, the high part of the run time counter.
+ */
+static uint32_t ulCycles = 0;
+
+/**
+ * @brief Set while the last compare written was not taken yet.
+ */
+static BaseType_t xCompareWritePending = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvReadCount( void )
+{
+    uint32_t ulCount;
+
+    /* The counter runs on the LSE, asynchronously to the bus: a value is valid once read twice in a row. */
+    do
+    {
+        ulCount = LPTIM1->CNT;
+    } while( ulCount != LPTIM1->CNT );
+
+    return ( uint16_t ) ulCount;
+}
+/*-----------------------------------------------------------*/
+
+/* Count at which the tick ulTicks after the last one processed starts. */
+static uint16_t prvCountOfTick( uint32_t ulTicks )
+{
+    return ( uint16_t ) ( usCycleStartCount +
+                          ( ( ( ulTickInCycle + ulTicks ) * lptimCOUNTS_PER_CYCLE ) / lptimTICKS_PER_CYCLE ) );
+}
+/*-----------------------------------------------------------*/
+
+/* Ticks started since the last one processed, at count usNow. */
+static uint32_t prvElapsedTicks( uint16_t usNow )
+{
+    uint32_t ulCounts = ( uint16_t ) ( usNow - usCycleStartCount );
+
+    return ( ( ( ( ulCounts + 1UL ) * lptimTICKS_PER_CYCLE ) - 1UL ) / lptimCOUNTS_PER_CYCLE ) - ulTickInCycle;
+}
+/*-----------------------------------------------------------*/
+
+static void prvStepTicks( uint32_t ulTicks )
+{
+    ulTickInCycle += ulTicks;
+
+    while( ulTickInCycle >= lptimTICKS_PER_CYCLE )
+    {
+        ulTickInCycle -= lptimTICKS_PER_CYCLE;
+        usCycleStartCount += ( uint16_t ) lptimCOUNTS_PER_CYCLE;
+        ulCycles++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetCompare( uint16_t usCount )
+{
+    /* A compare must not be written before the previous one was taken. */
+    if( xCompareWritePending == pdTRUE )
+    {
+        while( ( LPTIM1->ISR & LPTIM_ISR_CMPOK ) == 0U )
+        {
+        }
+    }
+
+    LPTIM1->ICR = LPTIM_ICR_CMPOKCF;
+    LPTIM1->CMP = usCount;
+    xCompareWritePending = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+/* Sets the compare for the next tick still far enough ahead, a tick too close is counted with the following one. */
+static void prvSetNextTick( uint16_t usNow )
+{
+    uint32_t ulTicks = 1;
+
+    while( ( int16_t ) ( prvCountOfTick( ulTicks ) - usNow ) < lptimMIN_LEAD_COUNTS )
+    {
+        ulTicks++;
+    }
+
+    prvSetCompare( prvCountOfTick( ulTicks ) );
+}
+/*-----------------------------------------------------------*/
+
+void vPortSetupTimerInterrupt( void )
+{
+    configASSERT( ( lptimCOUNTS_PER_CYCLE * configTICK_RATE_HZ ) == ( lptimCLOCK_HZ * lptimTICKS_PER_CYCLE ) );
+
+    __HAL_RCC_LPTIM1_CONFIG( RCC_LPTIM1CLKSOURCE_LSE );
+    __HAL_RCC_LPTIM1_CLK_ENABLE();
+    __HAL_RCC_LPTIM1_FORCE_RESET();
+    __HAL_RCC_LPTIM1_RELEASE_RESET();
+
+    /* The configuration and the interrupts can only be changed while the timer is disabled. */
+    LPTIM1->CFGR = lptimPRESCALER;
+    LPTIM1->IER = LPTIM_IER_CMPMIE;
+    LPTIM1->CR = LPTIM_CR_ENABLE;
+    LPTIM1->ARR = 0xFFFFUL;
+
+    while( ( LPTIM1->ISR & LPTIM_ISR_ARROK ) == 0U )
+    {
+    }
+
+    LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+    prvSetCompare( prvCountOfTick( 1U ) );
+    LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+
+    /* LPTIM1 wakes the MCU up from Stop 2 through EXTI line 32. */
+    EXTI->IMR2 |= EXTI_IMR2_IM32;
+    NVIC_SetPriority( LPTIM1_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( LPTIM1_IRQn );
+}
+/*-----------------------------------------------------------*/
+
+void LPTIM1_IRQHandler( void )
+{
+    BaseType_t xSwitchRequired = pdFALSE;
+    UBaseType_t uxSavedInterruptStatus;
+    uint32_t ulTicks;
+    uint16_t usNow;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        LPTIM1->ICR = LPTIM_ICR_CMPMCF;
+
+        /* The interrupt can be late by more than a tick, all the ticks started are counted. */
+        usNow = prvReadCount();
+        ulTicks = prvElapsedTicks( usNow );
+        prvStepTicks( ulTicks );
+
+        while( ulTicks > 0U )
+        {
+            xSwitchRequired |= xTaskIncrementTick();
+            ulTicks--;
+        }
+
+        prvSetNextTick( usNow );
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    portYIELD_FROM_ISR( xSwitchRequired );
+}
+/*-----------------------------------------------------------*/
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+    uint32_t ulTicks;
+    uint16_t usNow;
+    uint16_t usWakeCount;
+    uint16_t usSleepCount;
+
+    if( xExpectedIdleTime > lptimMAX_IDLE_TICKS )
+    {
+        xExpectedIdleTime = lptimMAX_IDLE_TICKS;
+    }
+
+    /* Interrupts stay pending while disabled, and still wake the MCU up. */
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    usNow = prvReadCount();
+    usWakeCount = prvCountOfTick( xExpectedIdleTime );
+
+    /* A task was readied in between, or the tick to wake up at is too close to be set in time. */
+    if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) ||
+        ( ( int16_t ) ( usWakeCount - usNow ) < lptimMIN_LEAD_COUNTS ) )
+    {
+        __enable_irq();
+
+        return;
+    }
+
+    prvSetCompare( usWakeCount );
+    usSleepCount = usNow;
+
+    configPRE_STOP_PROCESSING();
+    HAL_PWREx_EnterSTOP2Mode( PWR_STOPENTRY_WFI );
+    configPOST_STOP_PROCESSING();
+
+    /* The complete ticks slept are stepped, the last one is left to the tick interrupt so that the tasks it unblocks
+     * are readied. The MCU may have been woken up early by another interrupt. */
+    usNow = prvReadCount();
+    EnergyMonitor_AddMcuSleep( ( uint32_t ) ( ( ( uint32_t ) ( uint16_t ) ( usNow - usSleepCount ) * 1000000ULL ) / lptimCLOCK_HZ ) );
+    ulTicks = prvElapsedTicks( usNow );
+
+    if( ulTicks > 1U )
+    {
+        ulTicks = ( ulTicks <= xExpectedIdleTime ) ? ( ulTicks - 1U ) : ( xExpectedIdleTime - 1U );
+        prvStepTicks( ulTicks );
+        vTaskStepTick( ulTicks );
+        NVIC_SetPendingIRQ( LPTIM1_IRQn );
+    }
+    else if( ulTicks == 1U )
+    {
+        NVIC_SetPendingIRQ( LPTIM1_IRQn );
+    }
+    else
+    {
+        prvSetNextTick( usNow );
+    }
+
+    __enable_irq();
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Counter of the run time statistics of the tasks, at 4096 Hz. LPTIM1 keeps counting in STOP 2, unlike the cycle counter
+ * of the DWT, so the time asleep is charged to the idle task. Wraps after 12 days.
+ */
+uint32_t ulBoardGetRunTimeCounter( void )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    uint32_t ulValue;
+
+    /* Called from the context switch and from tasks, the tick interrupt must not step the cycle in between. */
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        ulValue = ( ulCycles * lptimCOUNTS_PER_CYCLE ) + ( uint16_t ) ( prvReadCount() - usCycleStartCount );
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return ulValue;
+}
+/*-----------------------------------------------------------*/
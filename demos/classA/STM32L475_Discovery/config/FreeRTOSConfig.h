@@ -43,6 +43,7 @@
 #if defined( __ICCARM__ ) || defined( __CC_ARM ) || defined( __GNUC__ )
     #include <stdint.h>
     extern uint32_t SystemCoreClock;
+    extern uint32_t ulBoardGetRunTimeCounter( void );
 #endif
 
 #define configSUPPORT_STATIC_ALLOCATION              1
@@ -50,7 +51,7 @@
 #define configUSE_PREEMPTION                         1
 #define configUSE_IDLE_HOOK                          1
 #define configUSE_TICK_HOOK                          0
-#define configUSE_TICKLESS_IDLE                      0
+#define configUSE_TICKLESS_IDLE                      2
 #define configUSE_DAEMON_TASK_STARTUP_HOOK           1
 #define configCPU_CLOCK_HZ                           ( SystemCoreClock )
 #define configTICK_RATE_HZ                           ( ( TickType_t ) 1000 )
@@ -68,10 +69,15 @@
 #define configUSE_MALLOC_FAILED_HOOK                 1
 #define configUSE_APPLICATION_TASK_TAG               1
 #define configUSE_COUNTING_SEMAPHORES                1
-#define configGENERATE_RUN_TIME_STATS                0
+#define configGENERATE_RUN_TIME_STATS                1
 #define configOVERRIDE_DEFAULT_TICK_CONFIGURATION    1
 #define configRECORD_STACK_HIGH_ADDRESS              1
 
+/* The run time of the tasks is counted on LPTIM1, the tick, which keeps
+ * counting in low power mode. */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()             ulBoardGetRunTimeCounter()
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                        0
 #define configMAX_CO_ROUTINE_PRIORITIES              ( 2 )
@@ -93,6 +99,7 @@
 #define INCLUDE_vTaskDelay                           1
 #define INCLUDE_uxTaskGetStackHighWaterMark          1
 #define INCLUDE_xTaskGetSchedulerState               1
+#define INCLUDE_xTaskGetCurrentTaskHandle            1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -147,6 +154,13 @@ void vLoggingPrintf( const char * pcFormat,
  * and a time stamp. */
 #define configLOGGING_INCLUDE_TIME_AND_TASK_NAME    1
 
+/* Set to a number of messages to format the log messages into as many static
+ * buffers, with the queues and the task of the logging also allocated statically,
+ * instead of taking a buffer from the heap for each message. With
+ * lorawanConfigSTATIC_ALLOCATION, the heap is then no longer used after the
+ * initialization. Set to 0 to use the heap. */
+#define configLOGGING_STATIC_BUFFERS                0
+
 /* Pseudo random number generator, just used by demos so does not have to be
  * secure.  Do not use the standard C library rand() function as it can cause
  * unexpected behaviour, such as calls to malloc(). */
@@ -168,6 +182,10 @@ extern int iMainRand32( void );
 #define configPRE_STOP_PROCESSING     vMainPreStopProcessing
 #define configPOST_STOP_PROCESSING    vMainPostStopProcessing
 
+/* The tick is generated by LPTIM1 on the LSE, and board/lptim_tick.c implements
+ * the tickless idle in Stop 2 (configUSE_TICKLESS_IDLE 2). The LoRaMAC timers are
+ * FreeRTOS software timers, so the expected idle time ends at the next of them. */
+
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
  * standard names. */
 #define vPortSVCHandler               SVC_Handler
@@ -162,12 +162,12 @@ extern void getGetNwkSessionKey( uint8_t * nwkSessionKey );
 
 
 /**
- * @brief Size of response queue used to receive responses to requests.
- * Queue is used to separate out events from responses so application can do a synchronous call to
- * join to a network or send a confirmed message. Since there is atmost 1 LoRaWAN operation at a time, queue size
- * is set to 1.
+ * @brief Size of the queue of the commands sent to the LoRaMAC task.
+ * The calls to the API which use LoRaMAC are run by the LoRaMAC task, so that LoRaMAC is never entered from two tasks,
+ * and each caller waits for its command and for the confirm of its own request. The queue holds a command of each
+ * task which may call the API at the same time.
  */
-#define lorawanConfigRESPONSE_QUEUE_SIZE    ( 1 )
+#define lorawanConfigCOMMAND_QUEUE_SIZE     ( 2 )
 
 /**
  * @breif Queue size for downlink data.
@@ -177,6 +177,11 @@ extern void getGetNwkSessionKey( uint8_t * nwkSessionKey );
  */
 #define lorawanConfigDOWNLINK_QUEUE_SIZE    ( 1 )
 
+/**
+ * @brief Ports which can have a subscription of their own, see LoRaWAN_SubscribePort().
+ */
+#define lorawanConfigMAX_PORT_SUBSCRIPTIONS    ( 4 )
+
 /**
  * @breif Queue size for downlink events.
  *
@@ -200,6 +205,307 @@ extern void getGetNwkSessionKey( uint8_t * nwkSessionKey );
  */
 #define lorawanConfigLORAMAC_TASK_PRIORITY      ( configMAX_PRIORITIES - 1 )
 
+/**
+ * @brief Set to 1 to allocate the task and the queues of the LoRaWAN layer and the LoRaMAC timers from static storage,
+ * so that they take no heap. Requires configSUPPORT_STATIC_ALLOCATION. See also configLOGGING_STATIC_BUFFERS.
+ */
+#define lorawanConfigSTATIC_ALLOCATION          ( 0 )
+
+/**
+ * @brief Timers in the pool of the timer events: 4 for LoRaMAC, 3 for class B, up to 3 for the radio driver and 5 for the
+ * LoRaWAN layer, with some spare. The timers beyond are taken from the heap, or are an error with
+ * lorawanConfigSTATIC_ALLOCATION.
+ */
+#define lorawanConfigMAX_TIMERS                 ( 16 )
+
+/**
+ * @brief Period in seconds at which the task monitor samples the CPU share and the stack headroom of the tasks, the
+ * free heap and the fill of the queues of the LoRaWAN layer. Set to 0 to disable the monitor. The CPU shares require
+ * configGENERATE_RUN_TIME_STATS.
+ */
+#define lorawanConfigMONITOR_PERIOD_SEC         ( 60 )
+
+/**
+ * @brief Tasks and queues followed by the task monitor. A sample is skipped while there are more tasks.
+ */
+#define lorawanConfigMONITOR_MAX_TASKS          ( 8 )
+#define lorawanConfigMONITOR_MAX_QUEUES         ( 4 )
+
+
+/**
+ * @brief Maximum error of a device time synchronization in milliseconds.
+ *
+ * Covers the 1/256 second resolution of DeviceTimeAns and the timing error of the end of the uplink it refers to.
+ */
+#define lorawanConfigGPS_TIME_SYNC_ERROR_MS          ( 10 )
+
+/**
+ * @brief Frequency tolerance of the RTC crystal in ppm, used as the drift uncertainty until the drift is measured.
+ */
+#define lorawanConfigGPS_TIME_CLOCK_TOLERANCE_PPM    ( 50 )
+
+/**
+ * @brief Error bound in milliseconds at which the GPS time is resynchronized.
+ *
+ * When the error bound of LoRaWAN_GetGpsTime() reaches this value, LoRaWAN_Send() piggybacks a DeviceTimeReq on the
+ * next uplink, so resynchronizations get rarer as the drift estimate improves and cost no extra uplink.
+ * Set to 0 to only synchronize on LoRaWAN_RequestDeviceTimeSync().
+ */
+#define lorawanConfigGPS_TIME_TARGET_ERROR_MS        ( 100 )
+
+/**
+ * @brief Bounds of the interval between two automatic resynchronizations, in seconds.
+ */
+#define lorawanConfigGPS_TIME_MIN_RESYNC_SEC         ( 600 )
+#define lorawanConfigGPS_TIME_MAX_RESYNC_SEC         ( 604800 )
+
+/**
+ * @brief Rate in ppm at which the offset found by a synchronization is slewed into the GPS time.
+ */
+#define lorawanConfigGPS_TIME_SLEW_PPM               ( 500 )
+
+/**
+ * @brief Length in milliseconds of an uplink slot, see LoRaWAN_GetUplinkSlotDelay().
+ *
+ * A slot must fit the time on air of an uplink plus twice the error bound of the GPS time, so that devices in adjacent
+ * slots never overlap. 1000 ms fits an 11 byte uplink at DR_0 in US915, about 370 ms on air, with an error bound of up
+ * to 300 ms.
+ */
+#define lorawanConfigUPLINK_SLOT_MS    ( 1000 )
+
+/**
+ * @brief Ping slot periodicity requested by LoRaWAN_SetDeviceClass() for class B, from 0 to 7.
+ *
+ * The device opens a ping slot every 2^periodicity seconds, which bounds the downlink latency in class B. Each ping slot
+ * without a downlink costs a receive window of a few symbols, so the receiver energy doubles with each step down.
+ */
+#define lorawanConfigCLASS_B_PING_SLOT_PERIODICITY    ( 1 )
+
+/**
+ * @brief Application port of the remote multicast setup package (LoRaWAN TS005), 0 to leave the port to the application.
+ *
+ * Frames received on this port are handled by the LoRaWAN stack to set up multicast groups and schedule their class B or
+ * class C sessions, and are not queued for LoRaWAN_Receive().
+ */
+#define lorawanConfigREMOTE_MULTICAST_SETUP_PORT    ( 200 )
+
+/**
+ * @brief Application port of the fragmented data block transport package (LoRaWAN TS004), 0 to leave the port to the
+ * application.
+ *
+ * The fragments received on this port are decoded into the storage set with LoRaWAN_SetDataBlockStorage(), and are not
+ * queued for LoRaWAN_Receive().
+ */
+#define lorawanConfigFRAGMENTATION_PORT    ( 201 )
+
+/**
+ * @brief Largest data block accepted by the fragmentation package, in fragments of at most lorawanConfigFRAG_MAX_SIZE bytes.
+ */
+#define lorawanConfigFRAG_MAX_NB           ( 2048 )
+#define lorawanConfigFRAG_MAX_SIZE         ( 232 )
+
+/**
+ * @brief Largest number of fragments of a block which can be lost and recovered by forward error correction.
+ *
+ * The decoder keeps a square bit matrix of this size in RAM, the fragments themselves are decoded in the storage.
+ */
+#define lorawanConfigFRAG_MAX_REDUNDANCY    ( 128 )
+
+/**
+ * @brief Size of the page buffer used to apply a delta patch, the new image is written in chunks of this size.
+ *
+ * A multiple of the flash page size avoids rewriting a page twice.
+ */
+#define lorawanConfigDELTA_PAGE_SIZE    ( 2048 )
+
+/**
+ * @brief Rejoin-Request attempts of LoRaWAN_Rejoin() before giving up.
+ */
+#define lorawanConfigMAX_REJOIN_ATTEMPTS    ( 3 )
+
+/**
+ * @brief Periodic Rejoin-Requests of type 0, with the encoding of RejoinParamSetupReq: one every 2^( MaxTimeN + 10 )
+ * seconds or every 2^( MaxCountN + 4 ) uplinks, whichever comes first. 7 and 6 give 36 hours and 1024 uplinks.
+ *
+ * Networks before LoRaWAN 1.1 do not answer Rejoin-Requests, keep them disabled with such networks.
+ */
+#define lorawanConfigREJOIN_PERIODIC       ( 0 )
+#define lorawanConfigREJOIN_MAX_TIME_N     ( 7 )
+#define lorawanConfigREJOIN_MAX_COUNT_N    ( 6 )
+
+/**
+ * @brief Period of the Rejoin-Requests of type 1 in seconds, 0 to disable them.
+ *
+ * A type 1 rejoin goes through the join server, it restores the session of a device the network lost the context of.
+ */
+#define lorawanConfigREJOIN_TYPE_1_PERIOD_SEC    ( 0 )
+
+/**
+ * @brief Set to 1 to let the LoRaWAN layer send the uplinks the network waits for, MAC command answers or a pending
+ * downlink, rather than reporting LORAWAN_EVENT_DOWNLINK_PENDING to the application.
+ *
+ * The MAC answers ride on the next application uplink if one is expected within lorawanConfigPIGGYBACK_WINDOW_MS,
+ * otherwise an empty unconfirmed frame is sent as soon as the duty cycle allows, see LoRaWAN_GetPiggybackStats().
+ */
+#define lorawanConfigUPLINK_PIGGYBACK    ( 1 )
+
+/**
+ * @brief Longest time in milliseconds the MAC answers wait for an application uplink, from the downlink which asked
+ * for them. A longer window saves more frames and delays more the downlinks the network holds back.
+ */
+#define lorawanConfigPIGGYBACK_WINDOW_MS    ( 120000 )
+
+/**
+ * @brief Number of frames in the rolling window of the link quality estimator, see LoRaWAN_GetLinkStats().
+ */
+#define lorawanConfigLINK_QUALITY_WINDOW    ( 32 )
+
+/**
+ * @brief Weight of a new sample in the averages of the link quality, between 0 and 1. 0.25 follows a change of the link
+ * within about 8 frames.
+ */
+#define lorawanConfigLINK_QUALITY_EWMA_WEIGHT    ( 0.25f )
+
+/**
+ * @brief Device side rate adaptation, see LoRaWAN_SetRateAdaptation() and rate_adapt.h.
+ *
+ * Uplinks between two LinkCheckReq, margin in dB kept above the demodulation floor, lowered when several gateways
+ * receive the device, margin beyond which the data rate is raised or the power lowered, and frames lost in a row which
+ * trigger the fall back to full power and a lower data rate.
+ */
+#define lorawanConfigRATE_LINK_CHECK_PERIOD       ( 4 )
+#define lorawanConfigRATE_MARGIN_DB               ( 10 )
+#define lorawanConfigRATE_GATEWAY_DIVERSITY_DB    ( 2 )
+#define lorawanConfigRATE_HYSTERESIS_DB           ( 3 )
+#define lorawanConfigRATE_FALLBACK_LOSSES         ( 2 )
+
+/**
+ * @brief Data rates and transmit power indexes used by the device side rate adaptation. In US915 DR_0 to DR_3 are the
+ * 125 kHz data rates, SF10 to SF7, and each power index is 2 dB below the previous one.
+ */
+#define lorawanConfigRATE_MIN_DATARATE            ( 0 )
+#define lorawanConfigRATE_MAX_DATARATE            ( 3 )
+#define lorawanConfigRATE_MAX_TX_POWER            ( 5 )
+
+/**
+ * @brief Adaptive retransmissions. When set, the trials of a confirmed uplink and the repetitions (NbTrans) of an
+ * unconfirmed one are chosen for each message from the packet error rate measured on the recent confirmed uplinks, so that
+ * the message gets through with the probability given by its reliability. 0 sends the confirmed uplinks with
+ * lorawanConfigMAX_SEND_RETRIES trials and the unconfirmed ones with the NbTrans set by the network.
+ */
+#define lorawanConfigADAPTIVE_RETRANSMISSION    ( 1 )
+
+/**
+ * @brief Reliability, in percent, of the messages sent with a reliability of 0.
+ */
+#define lorawanConfigDEFAULT_RELIABILITY        ( 90 )
+
+/**
+ * @brief Most transmissions of an unconfirmed uplink, LoRaWAN allows up to 15.
+ */
+#define lorawanConfigMAX_NB_TRANS               ( 3 )
+
+/**
+ * @brief Transmissions of confirmed uplinks needed in the link quality window before the packet error rate is used. Until
+ * then the confirmed uplinks get lorawanConfigMAX_SEND_RETRIES trials and the unconfirmed ones no extra repetition.
+ */
+#define lorawanConfigRETRANSMIT_MIN_SAMPLES     ( 8 )
+
+/**
+ * @brief Calibration of the receive windows. When set, the timing error and the preamble symbols given to LoRaMAC are
+ * derived from the offsets measured on the received downlinks, instead of the worst case lorawanConfigRX_MAX_TIMING_ERROR,
+ * which stays the upper bound and the fallback.
+ */
+#define lorawanConfigRX_TIMING_CALIBRATION        ( 1 )
+
+/**
+ * @brief Downlinks the timing statistics are computed over, and the number needed before the error is lowered.
+ */
+#define lorawanConfigRX_CALIBRATION_WINDOW        ( 16 )
+#define lorawanConfigRX_CALIBRATION_MIN_SAMPLES   ( 4 )
+
+/**
+ * @brief Lowest timing error in ms, and margin in ms added to the measured one.
+ */
+#define lorawanConfigRX_MIN_TIMING_ERROR          ( 3 )
+#define lorawanConfigRX_CALIBRATION_GUARD_MS      ( 2 )
+
+/**
+ * @brief Windows missed in a row, such as unacknowledged confirmed uplinks, after which the measured offsets are dropped.
+ */
+#define lorawanConfigRX_CALIBRATION_MAX_MISSED    ( 3 )
+
+/**
+ * @brief Preamble symbols a receive window covers, one more for each window missed in a row.
+ */
+#define lorawanConfigRX_MIN_SYMBOLS               ( 6 )
+
+/**
+ * @brief Largest crystal drift against the network in ppm the measurements are trusted with.
+ */
+#define lorawanConfigRX_MAX_DRIFT_PPM             ( 100 )
+
+/**
+ * @brief Temperature compensation of the 32 kHz crystal. When set, the temperature given by
+ * lorawanConfigGET_TEMPERATURE is sampled every lorawanConfigTEMP_SAMPLE_PERIOD_SEC seconds, the local time base is
+ * corrected for the frequency error of the crystal at that temperature, and the timers of the LoRaWAN layer and of
+ * LoRaMAC are compensated through TimerTempCompensation().
+ */
+#define lorawanConfigTEMP_COMPENSATION            ( 1 )
+#define lorawanConfigTEMP_SAMPLE_PERIOD_SEC       ( 60 )
+
+/**
+ * @brief Reads the on-die temperature sensor, in degrees Celsius. Returns false if the sensor cannot be read.
+ */
+extern bool getTemperature( float * temperature );
+#define lorawanConfigGET_TEMPERATURE              getTemperature
+
+/**
+ * @brief Parabolic model of the crystal: the frequency error in ppm is lorawanConfigTEMP_COMP_OFFSET_PPM plus
+ * lorawanConfigTEMP_COMP_COEFFICIENT times the square of the distance to lorawanConfigTEMP_COMP_TURNOVER in degrees
+ * Celsius. The defaults are the nominal values of a tuning fork crystal, as RTC_TEMP_COEFFICIENT and RTC_TEMP_TURNOVER
+ * of rtc-board.h. The offset is the error of the unit at the turnover, measured in production.
+ */
+#define lorawanConfigTEMP_COMP_COEFFICIENT        ( -0.035f )
+#define lorawanConfigTEMP_COMP_TURNOVER           ( 25.0f )
+#define lorawanConfigTEMP_COMP_OFFSET_PPM         ( 0.0f )
+
+/**
+ * @brief Energy accounting. The currents in uA drawn by the MCU running and in its low power mode, by the radio in each
+ * state, and by the SPI and the console while they transfer, are charged over the time measured in each state, see
+ * energy.h. The defaults are the datasheet figures of the STM32L475 at 80 MHz from flash, and in Stop 2 with the RTC,
+ * and of the SX1276.
+ */
+#define lorawanConfigENERGY_MCU_RUN_UA            ( 10000.0f )
+#define lorawanConfigENERGY_MCU_SLEEP_UA          ( 1.6f )
+#define lorawanConfigENERGY_RADIO_SLEEP_UA        ( 0.2f )
+#define lorawanConfigENERGY_RADIO_STANDBY_UA      ( 1600.0f )
+#define lorawanConfigENERGY_RADIO_RX_UA           ( 11500.0f )
+
+/**
+ * @brief Current drawn in transmission, as { power in dBm, current in uA } points in increasing power, interpolated.
+ * The shield transmits on PA_BOOST, the points below 17 dBm are the RFO figures of the datasheet.
+ */
+#define lorawanConfigENERGY_TX_POWER_POINTS       { { 7, 20000.0f }, { 13, 29000.0f }, { 17, 87000.0f }, { 20, 120000.0f } }
+
+/**
+ * @brief Time the MCU spends sending a byte over the SPI, with the driver exchanging one byte per call, and over the
+ * console at 115200 baud, with the extra current drawn by the peripheral meanwhile.
+ */
+#define lorawanConfigENERGY_SPI_US_PER_BYTE       ( 5.0f )
+#define lorawanConfigENERGY_SPI_UA                ( 100.0f )
+#define lorawanConfigENERGY_LOG_US_PER_BYTE       ( 86.8f )
+#define lorawanConfigENERGY_LOG_UA                ( 300.0f )
+
+/**
+ * @brief Time the MCU runs at each wakeup, used where the running time cannot be measured, as on the host simulator.
+ */
+#define lorawanConfigENERGY_WAKEUP_US             ( 500U )
+
+/**
+ * @brief Capacity of the battery the life is projected for, in mAh.
+ */
+#define lorawanConfigENERGY_BATTERY_MAH           ( 2400.0f )
 
 
 #endif /* LORAWAN_CONFIG_H */
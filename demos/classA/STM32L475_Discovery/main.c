@@ -27,6 +27,8 @@
 #include "queue.h"
 
 #include "board_init.h"
+#include "flash_storage.h"
+#include "LoRaWAN.h"
 
 /**
  * @brief Stack size for LoRaWAN Class A task.
@@ -53,6 +55,9 @@ int main( int argc,
     /* Perform any hardware initialization that can or must be done before RTOS is running */
     board_init();
 
+    /* Firmware updates received with the fragmentation package are decoded into the other flash bank. */
+    LoRaWAN_SetDataBlockStorage( pxFlashStorageGetAlternateBank() );
+
     /* Add user tasks */
     xTaskCreate( vLorawanClassATask, "LoRaWanClassA", LORAWAN_CLASSA_TASK_STACK_SIZE, NULL, LORAWAN_CLASSA_TASK_PRIORITY, NULL );
 
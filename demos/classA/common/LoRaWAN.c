@@ -21,11 +21,20 @@
  * 1 tab == 4 spaces!
  */
 #include <string.h>
+#include <math.h>
 #include "LoRaWAN.h"
 #include "task.h"
 #include "queue.h"
+#include "semphr.h"
+#include "event_groups.h"
 #include "utilities.h"
+#include "systime.h"
 #include "board-config.h"
+#include "timer.h"
+#include "rate_adapt.h"
+#include "energy_monitor.h"
+#include "task_monitor.h"
+#include "radio.h"
 
 /**
  * @brief An event to indicate there are pending events to be processed from radio layer.
@@ -37,6 +46,11 @@
  */
 #define LORAWAN_EVENT_MAC_PENDING      ( 0x2U )
 
+/**
+ * @brief An event to indicate there are commands of the application tasks to be run, see prvCommandRun().
+ */
+#define LORAWAN_EVENT_COMMAND_PENDING  ( 0x4U )
+
 /**
  * @brief Max value for unsined long integer.
  */
@@ -57,6 +71,307 @@
  */
 #define LORAWAN_NUM_PARAMS             ( 3 )
 
+/**
+ * @brief Floor of the drift uncertainty, as the crystal keeps drifting with temperature and age between synchronizations.
+ */
+#define LORAWAN_GPS_TIME_MIN_DRIFT_UNCERTAINTY_PPM    ( 0.5f )
+
+/**
+ * @brief Remote multicast setup package (LoRaWAN TS005): identifier, version and commands.
+ */
+#define LORAWAN_MC_PACKAGE_ID                         ( 2 )
+#define LORAWAN_MC_PACKAGE_VERSION                    ( 1 )
+#define LORAWAN_MC_PACKAGE_VERSION_REQ                ( 0x00 )
+#define LORAWAN_MC_GROUP_STATUS_REQ                   ( 0x01 )
+#define LORAWAN_MC_GROUP_SETUP_REQ                    ( 0x02 )
+#define LORAWAN_MC_GROUP_DELETE_REQ                   ( 0x03 )
+#define LORAWAN_MC_CLASS_C_SESSION_REQ                ( 0x04 )
+#define LORAWAN_MC_CLASS_B_SESSION_REQ                ( 0x05 )
+
+/**
+ * @brief Status bits of the remote multicast setup answers, next to the group identifier in bits 0 and 1.
+ */
+#define LORAWAN_MC_GROUP_ID_MASK                      ( 0x03U )
+#define LORAWAN_MC_ID_ERROR                           ( 0x04U )
+#define LORAWAN_MC_GROUP_UNDEFINED                    ( 0x10U )
+
+/**
+ * @brief Fragmented data block transport package (LoRaWAN TS004): identifier, version and commands.
+ */
+#define LORAWAN_FRAG_PACKAGE_ID                       ( 3 )
+#define LORAWAN_FRAG_PACKAGE_VERSION                  ( 1 )
+#define LORAWAN_FRAG_PACKAGE_VERSION_REQ              ( 0x00 )
+#define LORAWAN_FRAG_SESSION_STATUS_REQ               ( 0x01 )
+#define LORAWAN_FRAG_SESSION_SETUP_REQ                ( 0x02 )
+#define LORAWAN_FRAG_SESSION_DELETE_REQ               ( 0x03 )
+#define LORAWAN_FRAG_DATA_FRAGMENT                    ( 0x08 )
+
+/**
+ * @brief Status bits of the fragmentation session answers.
+ */
+#define LORAWAN_FRAG_ENCODING_UNSUPPORTED             ( 0x01U )
+#define LORAWAN_FRAG_NOT_ENOUGH_MEMORY                ( 0x02U )
+#define LORAWAN_FRAG_INDEX_UNSUPPORTED                ( 0x04U )
+#define LORAWAN_FRAG_SESSION_UNDEFINED                ( 0x04U )
+
+/**
+ * @brief Application layer packages handled by the stack, indexes of xPackages.
+ */
+#define LORAWAN_PACKAGE_MULTICAST                     ( 0 )
+#define LORAWAN_PACKAGE_FRAGMENTATION                 ( 1 )
+#define LORAWAN_PACKAGE_COUNT                         ( 2 )
+
+/**
+ * @brief Room for the answers of a package to the commands of one downlink.
+ */
+#define LORAWAN_PACKAGE_ANSWER_SIZE                   ( 48 )
+
+/**
+ * @brief Longest delay the multicast session timer is armed for, the sessions are checked again after it.
+ */
+#define LORAWAN_MC_MAX_TIMER_MS                       ( 86400000UL )
+
+/**
+ * @brief Largest MaxTimeN and MaxCountN of RejoinParamSetupReq.
+ */
+#define LORAWAN_REJOIN_MAX_N                          ( 15U )
+
+/**
+ * @brief Time after the predicted application uplink the MAC answers still wait for it, to cover the random jitter
+ * and the duty cycle wait of the application.
+ */
+#define LORAWAN_PIGGYBACK_GRACE_MS                    ( 5000U )
+
+/**
+ * @brief Period at which an uplink of the application retries while the MAC is busy with a frame of the layer.
+ */
+#define LORAWAN_PIGGYBACK_BUSY_RETRY_MS               ( 100U )
+
+/**
+ * @brief Number of data rates the air time of an empty frame is measured for.
+ */
+#define LORAWAN_DATARATE_COUNT                        ( 16U )
+
+/**
+ * @brief Size of a downlink without FOpts on top of its payload: MHDR, FHDR and MIC.
+ */
+#define LORAWAN_DOWNLINK_OVERHEAD                     ( 12U )
+
+/**
+ * @brief State of the network synchronized clock.
+ * The GPS time is extrapolated from the last synchronization using the local RTC, corrected for the estimated drift,
+ * minus the part of the last synchronization offset which has not been slewed yet.
+ */
+typedef struct LoRaWANTimeSync
+{
+    bool synchronized;         /**< @brief Set once a DeviceTimeAns was received. */
+    bool requestPending;       /**< @brief Set while a DeviceTimeReq waits for its answer. */
+    uint32_t syncCount;        /**< @brief Number of DeviceTimeAns received. */
+    uint64_t localRefMs;       /**< @brief Local time of the last synchronization. */
+    uint64_t gpsRefMs;         /**< @brief GPS time received at the last synchronization. */
+    int32_t slewOffsetMs;      /**< @brief Offset between the received and the extrapolated time, slewed from localRefMs. */
+    uint32_t slewDurationMs;   /**< @brief Time needed to slew slewOffsetMs. */
+    float driftPpm;            /**< @brief Estimated drift of the local clock, positive if it runs fast. */
+    float driftUncertaintyPpm; /**< @brief Uncertainty of driftPpm. */
+    uint64_t nextSyncMs;       /**< @brief Local time at which the error bound reaches lorawanConfigGPS_TIME_TARGET_ERROR_MS. */
+} LoRaWANTimeSync_t;
+
+/**
+ * @brief Steps of a switch to class B. The LoRaMAC requests of each step are issued from the LoRaMAC task, once the
+ * previous step was confirmed.
+ */
+typedef enum LoRaWANClassBState
+{
+    LORAWAN_CLASS_B_OFF = 0,        /**< @brief Class A. */
+    LORAWAN_CLASS_B_TIME_SYNC,      /**< @brief Waiting for a DeviceTimeAns, the beacon is searched at a known time. */
+    LORAWAN_CLASS_B_ACQUISITION,    /**< @brief Searching the beacon. */
+    LORAWAN_CLASS_B_PING_SLOT_INFO, /**< @brief Waiting for the PingSlotInfoAns. */
+    LORAWAN_CLASS_B_ACTIVE          /**< @brief Class B, ping slots are open. */
+} LoRaWANClassBState_t;
+
+/**
+ * @brief State of the class B switch.
+ */
+typedef struct LoRaWANClassB
+{
+    DeviceClass_t requestedClass;  /**< @brief Class set by the application, restored after each join. */
+    bool joining;                  /**< @brief Set during a join, which is done in class A. */
+    LoRaWANClassBState_t state;
+    bool requestIssued;            /**< @brief Set once the LoRaMAC request of the current state was issued. */
+    bool beaconLocked;             /**< @brief Set from the first beacon received until the beacon is lost. */
+    uint32_t missedBeacons;
+} LoRaWANClassB_t;
+
+/**
+ * @brief Multicast group, and its class B or class C session if one is scheduled.
+ */
+typedef struct LoRaWANMulticast
+{
+    bool defined;
+    bool remotelySetup;                        /**< @brief Set if the key was received encrypted with McKEKey from the application server. */
+    uint32_t address;
+    uint8_t keys[ 2 ][ LORAWAN_KEY_SIZE ];     /**< @brief McKey_encrypted if remotely set up, McAppSKey and McNwkSKey otherwise. */
+    uint32_t minFCnt;
+    uint32_t maxFCnt;
+    DeviceClass_t groupClass;                  /**< @brief Class in which the MAC receives the downlinks of the group. */
+    McRxParams_t rxParams;
+    DeviceClass_t sessionClass;                /**< @brief Class of the session of the group, CLASS_A if none is scheduled. */
+    bool sessionActive;
+    uint64_t sessionStartMs;                   /**< @brief Local time of the start of the session. */
+    uint64_t sessionEndMs;                     /**< @brief Local time of the end of the session. */
+} LoRaWANMulticast_t;
+
+/**
+ * @brief Commands of an application layer package received from the LoRaMAC callbacks, and its answers waiting for an uplink.
+ */
+typedef struct LoRaWANPackage
+{
+    uint8_t port;                              /**< @brief Application port of the package, 0 if disabled. */
+    uint8_t request[ lorawanConfigMAX_MESSAGE_SIZE ];
+    size_t requestLength;                      /**< @brief 0 once the commands were processed by the LoRaMAC task. */
+    uint8_t requestGroup;                      /**< @brief Multicast group the commands were received from, or LORAWAN_UNICAST. */
+    uint8_t answer[ LORAWAN_PACKAGE_ANSWER_SIZE ];
+    size_t answerLength;                       /**< @brief 0 once the answers were sent. */
+} LoRaWANPackage_t;
+
+/**
+ * @brief Subscription of a port to its downlinks, see LoRaWAN_SubscribePort().
+ */
+typedef struct LoRaWANSubscription
+{
+    bool used;
+    uint8_t port;
+    QueueHandle_t queue;                       /**< @brief Queue receiving the downlinks, NULL if the callback does. */
+    LoRaWANDownlinkCallback_t callback;
+    void * pContext;
+    LoRaWANPortStats_t stats;
+} LoRaWANSubscription_t;
+
+/**
+ * @brief Arguments of LoRaWAN_SetEventCallback() for the LoRaMAC task.
+ */
+typedef struct LoRaWANEventCallbackArgs
+{
+    uint32_t eventMask;
+    LoRaWANEventCallback_t callback;
+    void * pContext;
+} LoRaWANEventCallbackArgs_t;
+
+/**
+ * @brief Arguments of LoRaWAN_SetRejoinParams() for the LoRaMAC task.
+ */
+typedef struct LoRaWANRejoinArgs
+{
+    bool enable;
+    uint8_t maxTimeN;
+    uint8_t maxCountN;
+} LoRaWANRejoinArgs_t;
+
+/**
+ * @brief Rejoin-Requests. The periodic ones are issued from the LoRaMAC task, the one of LoRaWAN_Rejoin() from the
+ * application task, which owns the MAC until it returns.
+ */
+typedef struct LoRaWANRejoin
+{
+    bool periodic;                             /**< @brief Set if the periodic Rejoin-Requests of type 0 are enabled. */
+    uint8_t maxTimeN;
+    uint8_t maxCountN;
+    bool sessionStarted;                       /**< @brief Set once joined, the periods start from the last join or rejoin. */
+    uint32_t uplinks;                          /**< @brief Uplinks since the last join or rejoin. */
+    uint64_t nextType0Ms;                      /**< @brief Local time of the next periodic Rejoin-Request of type 0. */
+    uint64_t nextType1Ms;                      /**< @brief Local time of the next periodic Rejoin-Request of type 1. */
+    bool pending;                              /**< @brief Set while a Rejoin-Request waits for its Join-Accept. */
+    bool blocking;                             /**< @brief Set during LoRaWAN_Rejoin(), whose command gets the answers. */
+    LoRaWANRejoinType_t pendingType;
+} LoRaWANRejoin_t;
+
+/**
+ * @brief Uplinks the network waits for. The MAC answers are added by LoRaMAC to any uplink, so they only cost a frame
+ * when no uplink of the application is expected soon enough, the LoRaMAC task then sends an empty one.
+ */
+typedef struct LoRaWANPiggyback
+{
+    bool pending;                                       /**< @brief Set while MAC answers or a downlink wait for an uplink. */
+    uint64_t pendingSinceMs;                            /**< @brief Local time the wait started, 0 until the LoRaMAC task saw it. */
+    uint64_t lastUplinkMs;                              /**< @brief Local time of the last call to LoRaWAN_Send(). */
+    uint32_t periodMs;                                  /**< @brief Interval between the last two calls to LoRaWAN_Send(), 0 if unknown. */
+    uint64_t nextUplinkMs;                              /**< @brief Local time of the next uplink given by the application, 0 if not given. */
+    bool frameInFlight;                                 /**< @brief Set while a frame of the LoRaMAC task waits for its confirm. */
+    bool frameEmpty;
+    uint32_t lastAirtimeMs;                             /**< @brief Air time of the last uplink. */
+    uint8_t lastDatarate;
+    uint16_t emptyAirtimeMs[ LORAWAN_DATARATE_COUNT ];  /**< @brief Air time of the last empty frame at each data rate, 0 if none. */
+    LoRaWANPiggybackStats_t stats;
+} LoRaWANPiggyback_t;
+
+/**
+ * @brief Transmissions of the uplinks of the application.
+ */
+typedef struct LoRaWANRetransmit
+{
+    uint8_t nbTrans;                    /**< @brief Repetitions of the unconfirmed uplink in flight. */
+    uint8_t lastTransmissions;          /**< @brief Transmissions of the last uplink, set by its confirm. */
+    LoRaWANRetransmitStats_t stats;
+} LoRaWANRetransmit_t;
+
+/**
+ * @brief Receive windows of the last uplink, measured to calibrate the timing error given to LoRaMAC.
+ */
+typedef struct LoRaWANRxWindows
+{
+    uint64_t txStartMs;                 /**< @brief Local time the last uplink was requested, 0 once its downlink was measured. */
+    uint32_t airtimeMs;                 /**< @brief Air time of the last uplink. */
+    bool measurable;                    /**< @brief Set if the last uplink was sent once, so its windows follow the request. */
+    bool missed;                        /**< @brief Set once a downlink expected after the last uplink was found missing. */
+    uint32_t appliedErrorMs;            /**< @brief SystemMaxRxError set in LoRaMAC. */
+    uint8_t appliedSymbols;             /**< @brief MinRxSymbols set in LoRaMAC. */
+    RxTiming_t timing;
+} LoRaWANRxWindows_t;
+
+struct LoRaWANCommand;
+
+/**
+ * @brief A step of a command, run by the LoRaMAC task.
+ */
+typedef LoRaMacStatus_t ( * LoRaWANCommandStep_t )( struct LoRaWANCommand * pCommand );
+
+/**
+ * @brief A call to the API from an application task. Its steps are run by the LoRaMAC task, the only one calling
+ * LoRaMAC, one at a time, and the caller waits on the token of the command, a semaphore of its own, for each step and
+ * for the confirm of the request a step made.
+ */
+typedef struct LoRaWANCommand
+{
+    LoRaWANCommandStep_t step;
+    void * pArgs;
+    LoRaMacStatus_t status;                     /**< @brief Returned by the last step. */
+    uint32_t dutyCycleWaitMs;                   /**< @brief Wait given by LoRaMAC for a request refused by the duty cycle. */
+    LoRaMacEventInfoStatus_t confirmStatus;
+    SemaphoreHandle_t token;
+    StaticSemaphore_t tokenBuffer;
+} LoRaWANCommand_t;
+
+/**
+ * @brief An uplink of the application, requested by prvExecRequestSend().
+ */
+typedef struct LoRaWANSend
+{
+    LoRaWANMessage_t * pMessage;
+    bool confirmed;
+    bool answers;                       /**< @brief Set to send the answers of the packages, taken in the LoRaMAC task. */
+    bool answersLeft;                   /**< @brief Set if another package had answers too, the uplink is then unconfirmed. */
+    McpsReq_t mcpsReq;
+    uint8_t nbTrans;                    /**< @brief Repetitions of the uplink, set in LoRaMAC if unconfirmed. */
+    uint8_t networkNbTrans;             /**< @brief Repetitions set by the network, restored once the uplink is sent. */
+    float loss;                         /**< @brief Probability that all the repetitions are lost. */
+    bool attempted;                     /**< @brief Set once the rate adaptation counted the uplink. */
+    bool linkCheck;                     /**< @brief Set if the uplink carries a LinkCheckReq of the rate adaptation. */
+    int8_t dataRate;
+    uint8_t txPower;
+    bool piggybacked;                   /**< @brief Set if LoRaMAC added the MAC answers waiting for an uplink. */
+    bool frameInFlight;                 /**< @brief Set if a frame of the LoRaMAC task was in flight, the uplink was not requested. */
+} LoRaWANSend_t;
+
 /**
  * @brief Handle for LoRaMAC task.
  */
@@ -68,15 +383,49 @@ static TaskHandle_t xLoRaMacTask;
 static QueueHandle_t xEventQueue;
 
 /**
- * @brief Queue to receive responses for requests sent to LoRa Network Server.
+ * @brief Callback of the events of xEventMask and event group bound by the application. Only used by the LoRaMAC task.
+ */
+static LoRaWANEventCallback_t xEventCallback = NULL;
+static void * pvEventCallbackContext = NULL;
+static uint32_t ulEventMask = 0;
+static EventGroupHandle_t xEventGroup = NULL;
+
+/**
+ * @brief Queue of the commands of the application tasks, see prvCommandRun().
+ */
+static QueueHandle_t xCommandQueue;
+
+/**
+ * @brief Commands waiting for the confirm of their uplink, and of their join or Rejoin-Request.
  */
-static QueueHandle_t xResponseQueue;
+static LoRaWANCommand_t * pxMcpsWaiter = NULL;
+static LoRaWANCommand_t * pxMlmeWaiter = NULL;
 
 /**
  * @brief Queue to receive downlink Data LoRa Network Server.
  */
 static QueueHandle_t xDownlinkQueue;
 
+#if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+
+    /**
+     * @brief Storage of the LoRaMAC task and of the queues, see lorawanConfigSTATIC_ALLOCATION.
+     */
+    static StaticTask_t xLoRaMacTaskBuffer;
+    static StackType_t xLoRaMacTaskStack[ lorawanConfigLORAMAC_TASK_STACK_SIZE ];
+    static StaticQueue_t xEventQueueBuffer;
+    static uint8_t ucEventQueueStorage[ lorawanConfigEVENT_QUEUE_SIZE * sizeof( LoRaWANEventInfo_t ) ];
+    static StaticQueue_t xCommandQueueBuffer;
+    static uint8_t ucCommandQueueStorage[ lorawanConfigCOMMAND_QUEUE_SIZE * sizeof( LoRaWANCommand_t * ) ];
+    static StaticQueue_t xDownlinkQueueBuffer;
+    static uint8_t ucDownlinkQueueStorage[ lorawanConfigDOWNLINK_QUEUE_SIZE * sizeof( LoRaWANMessage_t ) ];
+#endif
+
+/**
+ * @brief Heap taken by the last LoRaWAN_Init().
+ */
+static size_t xInitHeapBytes = 0;
+
 /**
  * @brief  Static primitives registered with LoRaMAC stack.
  */
@@ -87,6 +436,121 @@ static LoRaMacPrimitives_t xLoRaMacPrimitives = { 0 };
  */
 static LoRaMacCallback_t xLoRaMacCallbacks = { 0 };
 
+/**
+ * @brief Network synchronized clock, updated from the LoRaMAC task and read from the application tasks.
+ */
+static LoRaWANTimeSync_t xTimeSync = { 0 };
+
+/**
+ * @brief Class switch, updated from the LoRaMAC task.
+ */
+static LoRaWANClassB_t xClassB = { .requestedClass = CLASS_A };
+
+/**
+ * @brief Uplink slot assigned by the application, LORAWAN_UPLINK_SLOT_FROM_DEV_ADDR if none.
+ */
+static uint32_t ulUplinkSlot = LORAWAN_UPLINK_SLOT_FROM_DEV_ADDR;
+
+/**
+ * @brief Fragmentation session. A single session is supported at a time, whatever its index.
+ */
+typedef struct LoRaWANFragSession
+{
+    bool defined;
+    uint8_t index;                             /**< @brief FragIndex given by the application server. */
+    uint8_t groupMask;                         /**< @brief Multicast groups the fragments are accepted from, besides unicast. */
+    uint8_t padding;                           /**< @brief Bytes added to fill the last fragment. */
+    uint32_t descriptor;
+    bool reported;                             /**< @brief Set once the end of the decoding was reported to the application. */
+    bool verified;                             /**< @brief Set if the block matched its CRC-32. */
+    uint8_t blockAckDelay;                     /**< @brief BlockAckDelay of the setup, spreads the answers to the multicast status requests. */
+    uint8_t statusRequest;                     /**< @brief Parameter of the multicast FragSessionStatusReq answered late. */
+    uint64_t statusAnswerMs;                   /**< @brief Local time its answer is due, 0 if none. */
+} LoRaWANFragSession_t;
+
+/**
+ * @brief Multicast groups, indexed by group identifier.
+ */
+static LoRaWANMulticast_t xMulticast[ LORAWAN_MAX_MULTICAST_GROUPS ] = { 0 };
+
+/**
+ * @brief Application layer packages: remote multicast setup and fragmented data block transport.
+ */
+static LoRaWANPackage_t xPackages[ LORAWAN_PACKAGE_COUNT ] = { 0 };
+
+/**
+ * @brief Subscriptions of the ports, and the one of the other ports, the queue of LoRaWAN_Receive() by default. Only
+ * used by the LoRaMAC task.
+ */
+static LoRaWANSubscription_t xSubscriptions[ lorawanConfigMAX_PORT_SUBSCRIPTIONS ] = { 0 };
+static LoRaWANSubscription_t xAnyPortSubscription = { 0 };
+
+/**
+ * @brief Fragmentation session, its decoder and the storage of its data block.
+ */
+static LoRaWANFragSession_t xFragSession = { 0 };
+static FragDecoder_t xFragDecoder;
+static const FragDecoderStorage_t * pxDataBlockStorage = NULL;
+
+/**
+ * @brief Timer of the start and the end of the multicast sessions, and the deadline it is armed for.
+ */
+static TimerEvent_t xMulticastTimer;
+static uint64_t ullMulticastDeadlineMs = UINT64_MAX;
+
+/**
+ * @brief Timer of the delayed answer to a multicast FragSessionStatusReq, and the deadline it is armed for.
+ */
+static TimerEvent_t xFragStatusTimer;
+static uint64_t ullFragStatusDeadlineMs = UINT64_MAX;
+
+/**
+ * @brief Rejoin-Requests and the timer of the periodic ones.
+ */
+static LoRaWANRejoin_t xRejoin =
+{
+    .periodic  = ( lorawanConfigREJOIN_PERIODIC != 0 ),
+    .maxTimeN  = lorawanConfigREJOIN_MAX_TIME_N,
+    .maxCountN = lorawanConfigREJOIN_MAX_COUNT_N
+};
+static TimerEvent_t xRejoinTimer;
+static uint64_t ullRejoinDeadlineMs = UINT64_MAX;
+
+/**
+ * @brief Uplinks the network waits for and the timer of the empty frames.
+ */
+static LoRaWANPiggyback_t xPiggyback = { 0 };
+static TimerEvent_t xPiggybackTimer;
+static uint64_t ullPiggybackDeadlineMs = UINT64_MAX;
+
+/**
+ * @brief Link quality measured on the frames, updated by the LoRaMAC task.
+ */
+static LinkQuality_t xLinkQuality;
+
+/**
+ * @brief Device side rate adaptation, fed by the LoRaMAC task and applied by prvSend().
+ */
+static RateAdapt_t xRateAdapt;
+static bool xRateAdaptEnabled = false;
+
+/**
+ * @brief Transmissions and delivery of the uplinks of the application.
+ */
+static LoRaWANRetransmit_t xRetransmit = { 0 };
+
+/**
+ * @brief Timing of the receive windows, measured by the LoRaMAC task.
+ */
+static LoRaWANRxWindows_t xRxWindows;
+
+/**
+ * @brief Temperature compensation of the crystal, sampled by the LoRaMAC task.
+ */
+static TempComp_t xTempComp;
+static TimerEvent_t xTemperatureTimer;
+static uint64_t ullNextTemperatureMs = 0;
+
 /**
  * @brief Static array to hold all param types.
  */
@@ -122,708 +586,3789 @@ static const char * EventInfoStatusStrings[] =
 };
 
 
-
-static void prvMcpsConfirm( McpsConfirm_t * mcpsConfirm )
+/* Sends to one of the queues of the layer, recording its fill for the task monitor. */
+static BaseType_t prvQueueSend( QueueHandle_t queue,
+                                const void * pItem )
 {
-    LoRaMacEventInfoStatus_t status = mcpsConfirm->Status;
+    BaseType_t result = xQueueSend( queue, pItem, 1 );
 
-    configPRINTF( ( "MCPS CONFIRM status: %s\n", EventInfoStatusStrings[ status ] ) );
+    if( result == pdTRUE )
+    {
+        TaskMonitor_OnQueueSend( queue );
+    }
 
-    if( ( mcpsConfirm->McpsRequest == MCPS_CONFIRMED ) && ( mcpsConfirm->AckReceived == false ) )
+    return result;
+}
+
+/*
+ * Hands an event to the callback or to the event queue, then sets its bit in the event group, so that a task woken by the
+ * bit finds the event queued.
+ */
+static BaseType_t prvSendEvent( const LoRaWANEventInfo_t * pEvent )
+{
+    BaseType_t result = pdTRUE;
+
+    if( ( xEventCallback != NULL ) && ( ( ulEventMask & LORAWAN_EVENT_BIT( pEvent->type ) ) != 0U ) )
     {
-        status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+        xEventCallback( pEvent, pvEventCallbackContext );
+    }
+    else
+    {
+        result = prvQueueSend( xEventQueue, pEvent );
     }
 
-    if( xQueueSend( xResponseQueue, &status, 1 ) != pdTRUE )
+    if( xEventGroup != NULL )
     {
-        configPRINTF( ( "Failed to send MCPS response to the queue.\r\n" ) );
+        ( void ) xEventGroupSetBits( xEventGroup, ( EventBits_t ) LORAWAN_EVENT_BIT( pEvent->type ) );
     }
+
+    return result;
 }
 
-static void prvMcpsIndication( McpsIndication_t * mcpsIndication )
+/* Starts a command of the calling task. */
+static void prvCommandInit( LoRaWANCommand_t * pCommand )
 {
-    LoRaWANEventInfo_t event = { 0 };
-    LoRaWANMessage_t downlink = { 0 };
+    memset( pCommand, 0, sizeof( LoRaWANCommand_t ) );
 
-    configPRINTF( ( "MCPS INDICATION status: %s\n", EventInfoStatusStrings[ mcpsIndication->Status ] ) );
+    /* Given when a step ran and when the confirm of its request came, which may happen before the caller woke up. */
+    pCommand->token = xSemaphoreCreateCountingStatic( 2, 0, &pCommand->tokenBuffer );
+}
 
-    if( ( mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_OK ) &&
-        ( mcpsIndication->RxData == true ) )
-    {
-        configASSERT( mcpsIndication->BufferSize <= lorawanConfigMAX_MESSAGE_SIZE );
-        downlink.port = mcpsIndication->Port;
-        downlink.length = mcpsIndication->BufferSize;
-        downlink.dataRate = mcpsIndication->RxDatarate;
-        memcpy( downlink.data, mcpsIndication->Buffer, mcpsIndication->BufferSize );
+static void prvCommandDeinit( LoRaWANCommand_t * pCommand )
+{
+    vSemaphoreDelete( pCommand->token );
+}
 
-        if( xQueueSend( xDownlinkQueue, &downlink, 1 ) != pdTRUE )
-        {
-            configPRINTF( ( "Failed to send downlink data event to the queue.\r\n" ) );
-        }
-    }
+/* Runs a step of a command in the LoRaMAC task and waits for it. Before the LoRaMAC task is created, and from the
+ * LoRaMAC task itself, the step runs right away. */
+static LoRaMacStatus_t prvCommandRun( LoRaWANCommand_t * pCommand,
+                                      LoRaWANCommandStep_t step,
+                                      void * pArgs )
+{
+    pCommand->step = step;
+    pCommand->pArgs = pArgs;
 
-    /* Check Multicast */
-    /* Check Port */
-    /* Check Datarate */
-    if( mcpsIndication->FramePending == true )
+    if( ( xLoRaMacTask == NULL ) || ( xTaskGetCurrentTaskHandle() == xLoRaMacTask ) )
     {
-        /**
-         * There are some pending commands to be sent uplink. Set an uplink event for the control task to
-         * schedule an uplink whenever possible.
-         */
-        event.type = LORAWAN_EVENT_DOWNLINK_PENDING;
-        event.status = LORAMAC_EVENT_INFO_STATUS_OK;
-
-        if( xQueueSend( xEventQueue, &event, 1 ) != pdTRUE )
-        {
-            configPRINTF( ( "Failed to send pending downlink event to the queue.\r\n" ) );
-        }
+        pCommand->status = step( pCommand );
     }
-
-    if( mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_DOWNLINK_TOO_MANY_FRAMES_LOSS )
+    else
     {
-        event.type = LORAWAN_EVENT_TOO_MANY_FRAME_LOSS;
-        event.status = LORAMAC_EVENT_INFO_STATUS_OK;
-
-        if( xQueueSend( xEventQueue, &event, 1 ) != pdTRUE )
-        {
-            configPRINTF( ( "Failed to send to too many frame loss event to the queue.\r\n" ) );
-        }
+        ( void ) xQueueSend( xCommandQueue, &pCommand, portMAX_DELAY );
+        TaskMonitor_OnQueueSend( xCommandQueue );
+        xTaskNotify( xLoRaMacTask, LORAWAN_EVENT_COMMAND_PENDING, eSetBits );
+        ( void ) xSemaphoreTake( pCommand->token, portMAX_DELAY );
     }
+
+    return pCommand->status;
 }
 
-static void prvMlmeIndication( MlmeIndication_t * MlmeIndication )
+/* Waits for the confirm of the request made by the last step of a command. */
+static LoRaMacEventInfoStatus_t prvCommandWaitConfirm( LoRaWANCommand_t * pCommand )
 {
-    LoRaWANEventInfo_t event = { 0 };
+    /* The confirms are delivered by the LoRaMAC task, which therefore cannot wait for them. */
+    configASSERT( xTaskGetCurrentTaskHandle() != xLoRaMacTask );
 
-    configPRINTF( ( "MLME Indication status: %s\n", EventInfoStatusStrings[ MlmeIndication->Status ] ) );
+    ( void ) xSemaphoreTake( pCommand->token, portMAX_DELAY );
 
-    event.status = MlmeIndication->Status;
+    return pCommand->confirmStatus;
+}
 
-    if( event.status == LORAMAC_EVENT_INFO_STATUS_OK )
+/* Runs a command of a single step. */
+static LoRaMacStatus_t prvCall( LoRaWANCommandStep_t step,
+                                void * pArgs )
+{
+    LoRaWANCommand_t command;
+    LoRaMacStatus_t status;
+
+    prvCommandInit( &command );
+    status = prvCommandRun( &command, step, pArgs );
+    prvCommandDeinit( &command );
+
+    return status;
+}
+
+/* Hands a confirm to the command which made the request, so that callers in several tasks never get each other's. */
+static void prvCompleteConfirm( LoRaWANCommand_t ** ppWaiter,
+                                LoRaMacEventInfoStatus_t status )
+{
+    if( *ppWaiter != NULL )
     {
-        if( MlmeIndication->MlmeIndication == MLME_SCHEDULE_UPLINK )
-        {
-            event.type = LORAWAN_EVENT_DOWNLINK_PENDING;
+        ( *ppWaiter )->confirmStatus = status;
+        ( void ) xSemaphoreGive( ( *ppWaiter )->token );
+        *ppWaiter = NULL;
+    }
+    else
+    {
+        configPRINTF( ( "No command waits for the confirm, status %d.\r\n", status ) );
+    }
+}
 
-            if( xQueueSend( xEventQueue, &event, 1 ) != pdTRUE )
-            {
-                configPRINTF( ( "Failed to send pending downlink event to the queue.\r\n" ) );
-            }
-        }
+/* Gives the network back the repetitions it set, if an uplink raised them. */
+static void prvRestoreNbTrans( const LoRaWANSend_t * pSend )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+
+    if( pSend->nbTrans != pSend->networkNbTrans )
+    {
+        mibReq.Type = MIB_CHANNELS_NB_TRANS;
+        mibReq.Param.ChannelsNbTrans = pSend->networkNbTrans;
+        ( void ) LoRaMacMibSetRequestConfirm( &mibReq );
     }
 }
 
-static void prvMlmeConfirm( MlmeConfirm_t * mlmeConfirm )
+/* Returns the MAC to class A and stops the class B switch, the requested class is kept. */
+static void prvSwitchToClassA( void )
 {
-    LoRaWANEventInfo_t event = { 0 };
+    MibRequestConfirm_t mibReq = { 0 };
 
-    configPRINTF( ( "MLME CONFIRM  status: %s\n", EventInfoStatusStrings[ mlmeConfirm->Status ] ) );
+    mibReq.Type = MIB_DEVICE_CLASS;
+    mibReq.Param.Class = CLASS_A;
 
-    switch( mlmeConfirm->MlmeRequest )
+    if( LoRaMacMibSetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK )
     {
-        case MLME_JOIN:
+        configPRINTF( ( "Failed to switch back to class A.\r\n" ) );
+    }
 
-            if( xQueueSend( xResponseQueue, &mlmeConfirm->Status, 1 ) != pdTRUE )
-            {
-                configPRINTF( ( "Failed to send JOIN response to the queue.\r\n" ) );
-            }
+    xClassB.state = LORAWAN_CLASS_B_OFF;
+    xClassB.requestIssued = false;
+    xClassB.beaconLocked = false;
+}
 
-            break;
+/* Time counted by the crystal, off by its frequency error. */
+static uint64_t prvGetCrystalTimeMs( void )
+{
+    SysTime_t mcuTime = SysTimeGetMcuTime();
 
-        case MLME_DEVICE_TIME:
-            event.type = LORAWAN_EVENT_DEVICE_TIME_UPDATED;
-            event.status = mlmeConfirm->Status;
+    return ( ( uint64_t ) mcuTime.Seconds * 1000ULL ) + ( uint64_t ) mcuTime.SubSeconds;
+}
 
-            if( xQueueSend( xEventQueue, &event, 1 ) != pdTRUE )
-            {
-                configPRINTF( ( "Failed to send device time updated event to the queue.\r\n" ) );
-            }
+static uint64_t prvGetLocalTimeMs( void )
+{
+    uint64_t localMs = prvGetCrystalTimeMs();
 
-            break;
+    if( lorawanConfigTEMP_COMPENSATION == 1 )
+    {
+        taskENTER_CRITICAL();
+        localMs = TempComp_GetTimeMs( &xTempComp, localMs );
+        taskEXIT_CRITICAL();
+    }
 
-        case MLME_LINK_CHECK:
-            event.type = LORAWAN_EVENT_LINK_CHECK_REPLY;
-            event.status = mlmeConfirm->Status;
-            event.info.linkCheck.DemodMargin = mlmeConfirm->DemodMargin;
-            event.info.linkCheck.NbGateways = mlmeConfirm->NbGateways;
+    return localMs;
+}
 
-            if( xQueueSend( xEventQueue, &event, 1 ) != pdTRUE )
-            {
-                configPRINTF( ( "Failed to send link check reply event to the queue.\r\n" ) );
-            }
+/* Temperature of the crystal, the turnover temperature, which needs no compensation, until it was sampled. */
+static float prvGetTemperature( void )
+{
+    float temperature = lorawanConfigTEMP_COMP_TURNOVER;
 
-            break;
+    if( lorawanConfigTEMP_COMPENSATION == 1 )
+    {
+        taskENTER_CRITICAL();
 
-        default:
-            break;
+        if( xTempComp.started == true )
+        {
+            temperature = xTempComp.temperature;
+        }
+
+        taskEXIT_CRITICAL();
     }
+
+    return temperature;
 }
 
-static LoRaMacStatus_t prvConfigure( void )
+/* Arms a timer for a delay of local time, counted by the crystal at its current temperature. */
+static void prvStartTimer( TimerEvent_t * timer,
+                           uint64_t delayMs )
 {
-    MibRequestConfirm_t mibReq;
-    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    uint32_t valueMs = ( uint32_t ) ( ( delayMs < LORAWAN_MC_MAX_TIMER_MS ) ? delayMs : LORAWAN_MC_MAX_TIMER_MS );
 
-    if( status == LORAMAC_STATUS_OK )
+    TimerSetValue( timer, TimerTempCompensation( valueMs, prvGetTemperature() ) );
+    TimerStart( timer );
+}
+
+/*
+ * Arms a timer for a deadline of local time, or stops it for UINT64_MAX. A timer still running for the same deadline is
+ * left alone, so that the wakeups of the LoRaMAC task for other reasons do not restart it.
+ */
+static void prvArmTimer( TimerEvent_t * timer,
+                         uint64_t * pArmedMs,
+                         uint64_t deadlineMs,
+                         uint64_t nowMs )
+{
+    if( ( deadlineMs == *pArmedMs ) && ( ( deadlineMs == UINT64_MAX ) || ( TimerIsStarted( timer ) == true ) ) )
     {
-        mibReq.Type = MIB_PUBLIC_NETWORK;
-        mibReq.Param.EnablePublicNetwork = lorawanConfigPUBLIC_NETWORK;
-        LoRaMacMibSetRequestConfirm( &mibReq );
+        return;
     }
 
-    if( status == LORAMAC_STATUS_OK )
+    TimerStop( timer );
+    *pArmedMs = deadlineMs;
+
+    if( deadlineMs != UINT64_MAX )
     {
-        mibReq.Type = MIB_ADR;
-        mibReq.Param.AdrEnable = lorawanConfigADR_ON;
-        status = LoRaMacMibSetRequestConfirm( &mibReq );
+        prvStartTimer( timer, ( deadlineMs > nowMs ) ? ( deadlineMs - nowMs ) : 1U );
     }
+}
 
-    #if defined( REGION_EU868 ) || defined( REGION_RU864 ) || defined( REGION_CN779 ) || defined( REGION_EU433 )
-        if( status == LORAMAC_STATUS_OK )
+/* Records an expected downlink which did not come, once per uplink. */
+static void prvOnDownlinkMissed( void )
+{
+    if( xRxWindows.missed == false )
+    {
+        xRxWindows.missed = true;
+        taskENTER_CRITICAL();
+        ( void ) RxTiming_OnMissed( &xRxWindows.timing );
+        taskEXIT_CRITICAL();
+    }
+}
+
+static void prvOnUplinkDone( const McpsConfirm_t * mcpsConfirm )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    uint8_t transmissions = 1;
+
+    if( mcpsConfirm->McpsRequest == MCPS_CONFIRMED )
+    {
+        transmissions = ( mcpsConfirm->NbRetries > 0 ) ? mcpsConfirm->NbRetries : 1U;
+    }
+    else
+    {
+        /* prvSend() restores the repetitions it raised only after this confirm. */
+        mibReq.Type = MIB_CHANNELS_NB_TRANS;
+
+        if( LoRaMacMibGetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
         {
-            status = LoRaMacTestSetDutyCycleOn( LORAWAN_DUTYCYCLE_ON );
+            transmissions = mibReq.Param.ChannelsNbTrans;
         }
-    #endif
+    }
 
-    if( status == LORAMAC_STATUS_OK )
+    xRxWindows.airtimeMs = ( uint32_t ) mcpsConfirm->TxTimeOnAir;
+    xRxWindows.measurable = ( transmissions <= 1U ) && ( mcpsConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK );
+
+    if( ( mcpsConfirm->McpsRequest == MCPS_CONFIRMED ) && ( mcpsConfirm->AckReceived == false ) )
     {
-        mibReq.Type = MIB_SYSTEM_MAX_RX_ERROR;
-        mibReq.Param.SystemMaxRxError = lorawanConfigRX_MAX_TIMING_ERROR;
-        status = LoRaMacMibSetRequestConfirm( &mibReq );
+        prvOnDownlinkMissed();
     }
-
-    return status;
 }
 
-
-static LoRaMacStatus_t prvSetOTAACredentials( void )
+static void prvMcpsConfirm( McpsConfirm_t * mcpsConfirm )
 {
-    MibRequestConfirm_t mibReq;
-    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
-    uint8_t devEUI[ LORAWAN_EUI_SIZE ];
-    uint8_t joinEUI[ LORAWAN_EUI_SIZE ];
-    uint8_t appKey[ LORAWAN_KEY_SIZE ];
+    LoRaMacEventInfoStatus_t status = mcpsConfirm->Status;
 
+    configPRINTF( ( "MCPS CONFIRM status: %s\n", EventInfoStatusStrings[ status ] ) );
 
-    #ifdef lorawanConfigGET_DEV_EUI
-        if( status == LORAMAC_STATUS_OK )
-        {
-            lorawanConfigGET_DEV_EUI( devEUI );
-            mibReq.Type = MIB_DEV_EUI;
-            mibReq.Param.DevEui = devEUI;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
-        }
-    #endif
+    if( ( mcpsConfirm->McpsRequest == MCPS_CONFIRMED ) && ( mcpsConfirm->AckReceived == false ) )
+    {
+        status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+    }
 
-    #ifdef lorawanConfigGET_JOIN_EUI
-        if( status == LORAMAC_STATUS_OK )
+    if( mcpsConfirm->McpsRequest == MCPS_CONFIRMED )
+    {
+        taskENTER_CRITICAL();
+        LinkQuality_AddUplink( &xLinkQuality, ( mcpsConfirm->NbRetries > 0 ) ? mcpsConfirm->NbRetries : 1U,
+                               mcpsConfirm->AckReceived );
+
+        if( xRateAdaptEnabled == true )
         {
-            lorawanConfigGET_JOIN_EUI( joinEUI );
-            mibReq.Type = MIB_JOIN_EUI;
-            mibReq.Param.JoinEui = joinEUI;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
+            RateAdapt_OnConfirmed( &xRateAdapt, ( mcpsConfirm->NbRetries > 0 ) ? mcpsConfirm->NbRetries : 1U,
+                                   mcpsConfirm->AckReceived );
         }
-    #endif
 
+        taskEXIT_CRITICAL();
+    }
+
+    xPiggyback.lastAirtimeMs = ( uint32_t ) mcpsConfirm->TxTimeOnAir;
+    xPiggyback.lastDatarate = mcpsConfirm->Datarate;
 
-    #ifdef lorawanConfigGET_APP_KEY
-        if( status == LORAMAC_STATUS_OK )
-        {
-            lorawanConfigGET_APP_KEY( appKey );
-            mibReq.Type = MIB_APP_KEY;
-            mibReq.Param.AppKey = appKey;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
-        }
+    if( lorawanConfigRX_TIMING_CALIBRATION == 1 )
+    {
+        prvOnUplinkDone( mcpsConfirm );
+    }
 
-        if( status == LORAMAC_STATUS_OK )
+    /* The frames of the LoRaMAC task have no one waiting for them. */
+    if( xPiggyback.frameInFlight == true )
+    {
+        if( ( xPiggyback.frameEmpty == true ) && ( mcpsConfirm->Datarate < LORAWAN_DATARATE_COUNT ) )
         {
-            mibReq.Type = MIB_NWK_KEY;
-            mibReq.Param.AppKey = appKey;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
+            xPiggyback.emptyAirtimeMs[ mcpsConfirm->Datarate ] = ( uint16_t ) mcpsConfirm->TxTimeOnAir;
         }
-    #endif /* ifdef lorawanConfigGET_APP_KEY */
 
-    return status;
+        xPiggyback.frameInFlight = false;
+        return;
+    }
+
+    xRetransmit.lastTransmissions = ( mcpsConfirm->McpsRequest == MCPS_CONFIRMED ) ?
+                                    ( ( mcpsConfirm->NbRetries > 0 ) ? mcpsConfirm->NbRetries : 1U ) : xRetransmit.nbTrans;
+
+    /* Restored while the uplink is still the waiter's, before another task can request one. */
+    if( pxMcpsWaiter != NULL )
+    {
+        prvRestoreNbTrans( ( const LoRaWANSend_t * ) pxMcpsWaiter->pArgs );
+    }
+
+    prvCompleteConfirm( &pxMcpsWaiter, status );
 }
 
-static LoRaMacStatus_t prvSetABPCredentials( void )
+/* Leaves the uplink the network waits for to the LoRaMAC task, or to the application if it asked to handle it. */
+static void prvOnUplinkPending( bool macAnswers )
 {
-    MibRequestConfirm_t mibReq;
-    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
-    uint8_t devEUI[ LORAWAN_EUI_SIZE ];
-    uint8_t joinEUI[ LORAWAN_EUI_SIZE ];
-    uint8_t appsKey[ LORAWAN_KEY_SIZE ];
-    uint8_t nwsKey[ LORAWAN_KEY_SIZE ];
+    LoRaWANEventInfo_t event = { 0 };
 
-    #ifdef lorawanConfigGET_DEV_EUI
-        if( status == LORAMAC_STATUS_OK )
-        {
-            lorawanConfigGET_DEV_EUI( devEUI );
-            mibReq.Type = MIB_DEV_EUI;
-            mibReq.Param.DevEui = devEUI;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
-        }
-    #endif
+    if( lorawanConfigUPLINK_PIGGYBACK == 0 )
+    {
+        event.type = LORAWAN_EVENT_DOWNLINK_PENDING;
+        event.status = LORAMAC_EVENT_INFO_STATUS_OK;
 
-    #ifdef lorawanConfigGET_JOIN_EUI
-        if( status == LORAMAC_STATUS_OK )
+        if( prvSendEvent( &event ) != pdTRUE )
         {
-            lorawanConfigGET_JOIN_EUI( joinEUI );
-            mibReq.Type = MIB_JOIN_EUI;
-            mibReq.Param.JoinEui = joinEUI;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
+            configPRINTF( ( "Failed to send pending downlink event to the queue.\r\n" ) );
         }
+    }
+    else if( macAnswers == true )
+    {
+        xPiggyback.pending = true;
+    }
+}
+
+/* Air time of a downlink at a LoRa data rate of the region, 0 for the other data rates. */
+static uint32_t prvGetDownlinkAirtimeMs( uint8_t dataRate,
+                                         uint8_t size )
+{
+    #if defined( REGION_US915 ) || defined( REGION_AU915 )
+        const uint32_t bandwidth = 2;   /* 500 kHz, from DR8 at SF12. */
+        const int32_t lowestDatarate = 8;
+    #else
+        const uint32_t bandwidth = 0;   /* 125 kHz, from DR0 at SF12. */
+        const int32_t lowestDatarate = 0;
     #endif
+    int32_t spreadingFactor = 12 - ( ( int32_t ) dataRate - lowestDatarate );
 
-    /* Tell the MAC layer which network server version are we connecting too. */
-    if( status == LORAMAC_STATUS_OK )
+    if( ( spreadingFactor < 7 ) || ( spreadingFactor > 12 ) )
     {
-        mibReq.Type = MIB_ABP_LORAWAN_VERSION;
-        mibReq.Param.AbpLrWanVersion.Value = lorawanConfigABP_LORAWAN_VERSION;
-        status = LoRaMacMibSetRequestConfirm( &mibReq );
+        return 0;
     }
 
-    if( status == LORAMAC_STATUS_OK )
+    /* Downlinks have no payload CRC. */
+    return Radio.TimeOnAir( MODEM_LORA, bandwidth, ( uint32_t ) spreadingFactor, 1, 8, false, size, false );
+}
+
+/*
+ * Measures the end of a downlink received in RX1 or RX2 against the time LoRaMAC expected it. The time is taken when the
+ * LoRaMAC task processes the indication, and the FOpts are not counted in the air time, so the offset errs on the late side
+ * and the calibrated error on the large side.
+ */
+static void prvMeasureRxTiming( const McpsIndication_t * mcpsIndication )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    uint64_t nowMs = prvGetLocalTimeMs();
+    uint32_t delayMs;
+    uint32_t downlinkMs;
+    float offsetMs;
+
+    if( ( xRxWindows.txStartMs == 0 ) || ( xRxWindows.measurable == false ) )
     {
-        mibReq.Type = MIB_NET_ID;
-        mibReq.Param.NetID = lorawanConfigNETWORK_ID;
-        status = LoRaMacMibSetRequestConfirm( &mibReq );
+        return;
     }
 
-    #ifdef lorawanConfigGET_DEV_ADDR
-        if( status == LORAMAC_STATUS_OK )
+    mibReq.Type = ( mcpsIndication->RxSlot == RX_SLOT_WIN_1 ) ? MIB_RECEIVE_DELAY_1 : MIB_RECEIVE_DELAY_2;
+
+    if( LoRaMacMibGetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK )
+    {
+        return;
+    }
+
+    delayMs = ( mcpsIndication->RxSlot == RX_SLOT_WIN_1 ) ? mibReq.Param.ReceiveDelay1 : mibReq.Param.ReceiveDelay2;
+    downlinkMs = prvGetDownlinkAirtimeMs( mcpsIndication->RxDatarate,
+                                          ( uint8_t ) ( LORAWAN_DOWNLINK_OVERHEAD + mcpsIndication->BufferSize +
+                                                        ( ( mcpsIndication->Port != 0 ) ? 1U : 0U ) ) );
+    offsetMs = ( float ) ( ( int64_t ) nowMs -
+                           ( int64_t ) ( xRxWindows.txStartMs + xRxWindows.airtimeMs + delayMs + downlinkMs ) );
+    xRxWindows.txStartMs = 0;
+
+    /* The window was not open that far from the expected time, the rest is the latency of the task. */
+    if( ( downlinkMs != 0 ) && ( fabsf( offsetMs ) <= lorawanConfigRX_MAX_TIMING_ERROR ) )
+    {
+        taskENTER_CRITICAL();
+        ( void ) RxTiming_AddDownlink( &xRxWindows.timing, offsetMs, delayMs );
+        taskEXIT_CRITICAL();
+    }
+}
+
+/* Gives LoRaMAC the calibrated timing, or the worst case while the beacons and ping slots of class B use it too. */
+static void prvProcessRxTiming( void )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    uint32_t errorMs = lorawanConfigRX_MAX_TIMING_ERROR;
+    uint8_t symbols = lorawanConfigRX_MIN_SYMBOLS;
+
+    if( lorawanConfigRX_TIMING_CALIBRATION == 0 )
+    {
+        return;
+    }
+
+    if( xClassB.state == LORAWAN_CLASS_B_OFF )
+    {
+        taskENTER_CRITICAL();
+        errorMs = xRxWindows.timing.maxRxErrorMs;
+        symbols = xRxWindows.timing.minRxSymbols;
+        taskEXIT_CRITICAL();
+    }
+
+    if( errorMs != xRxWindows.appliedErrorMs )
+    {
+        mibReq.Type = MIB_SYSTEM_MAX_RX_ERROR;
+        mibReq.Param.SystemMaxRxError = errorMs;
+
+        if( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
         {
-            mibReq.Type = MIB_DEV_ADDR;
-            mibReq.Param.DevAddr = lorawanConfigGET_DEV_ADDR();
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
+            xRxWindows.appliedErrorMs = errorMs;
         }
-    #endif
+    }
 
-    #ifdef lorawanConfigGET_APP_SESSION_KEY
-        if( status == LORAMAC_STATUS_OK )
+    if( symbols != xRxWindows.appliedSymbols )
+    {
+        mibReq.Type = MIB_MIN_RX_SYMBOLS;
+        mibReq.Param.MinRxSymbols = symbols;
+
+        if( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
         {
-            lorawanConfigGET_APP_SESSION_KEY( appsKey );
-            mibReq.Type = MIB_APP_S_KEY;
-            mibReq.Param.AppSKey = appsKey;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
+            xRxWindows.appliedSymbols = symbols;
         }
-    #endif
+    }
+}
+
+/* Subscription of a port, NULL if none. */
+static LoRaWANSubscription_t * prvFindSubscription( uint8_t port )
+{
+    size_t i;
+
+    if( port == LORAWAN_PORT_ANY )
+    {
+        return &xAnyPortSubscription;
+    }
+
+    for( i = 0; i < lorawanConfigMAX_PORT_SUBSCRIPTIONS; i++ )
+    {
+        if( ( xSubscriptions[ i ].used == true ) && ( xSubscriptions[ i ].port == port ) )
+        {
+            return &xSubscriptions[ i ];
+        }
+    }
+
+    return NULL;
+}
+
+/* Hands a downlink to the subscription of its port, or to the one of the other ports, without waiting. */
+static void prvDispatchDownlink( const LoRaWANMessage_t * pDownlink )
+{
+    LoRaWANSubscription_t * pSubscription = prvFindSubscription( ( uint8_t ) pDownlink->port );
+
+    if( ( pSubscription == NULL ) || ( pDownlink->port == LORAWAN_PORT_ANY ) )
+    {
+        pSubscription = &xAnyPortSubscription;
+    }
+
+    if( pSubscription->queue == NULL )
+    {
+        pSubscription->callback( pDownlink, pSubscription->pContext );
+        pSubscription->stats.delivered++;
+    }
+    else if( xQueueSend( pSubscription->queue, pDownlink, 0 ) == pdTRUE )
+    {
+        TaskMonitor_OnQueueSend( pSubscription->queue );
+        pSubscription->stats.delivered++;
+    }
+    else
+    {
+        pSubscription->stats.dropped++;
+        configPRINTF( ( "Downlink on port %d dropped, its queue is full.\r\n", pDownlink->port ) );
+    }
+}
+
+static void prvMcpsIndication( McpsIndication_t * mcpsIndication )
+{
+    LoRaWANEventInfo_t event = { 0 };
+    LoRaWANMessage_t downlink = { 0 };
+    LoRaWANPackage_t * pPackage = NULL;
+    size_t i;
+
+    configPRINTF( ( "MCPS INDICATION status: %s\n", EventInfoStatusStrings[ mcpsIndication->Status ] ) );
+
+    if( mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        taskENTER_CRITICAL();
+        LinkQuality_AddDownlink( &xLinkQuality, mcpsIndication->Rssi, mcpsIndication->Snr );
+        taskEXIT_CRITICAL();
+    }
+
+    if( ( lorawanConfigRX_TIMING_CALIBRATION == 1 ) && ( mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_OK ) &&
+        ( mcpsIndication->Multicast == 0 ) &&
+        ( ( mcpsIndication->RxSlot == RX_SLOT_WIN_1 ) || ( mcpsIndication->RxSlot == RX_SLOT_WIN_2 ) ) )
+    {
+        prvMeasureRxTiming( mcpsIndication );
+    }
+
+    if( ( mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_OK ) &&
+        ( mcpsIndication->RxData == true ) )
+    {
+        configASSERT( mcpsIndication->BufferSize <= lorawanConfigMAX_MESSAGE_SIZE );
+
+        downlink.multicastGroup = ( mcpsIndication->Multicast == 1 ) ?
+                                  LoRaMacMcChannelGetGroupId( mcpsIndication->DevAddress ) : LORAWAN_UNICAST;
+
+        for( i = 0; i < LORAWAN_PACKAGE_COUNT; i++ )
+        {
+            if( ( xPackages[ i ].port != 0 ) && ( mcpsIndication->Port == xPackages[ i ].port ) )
+            {
+                pPackage = &xPackages[ i ];
+            }
+        }
+
+        if( pPackage != NULL )
+        {
+            /* Package commands are processed by the LoRaMAC task once this indication returns. */
+            if( pPackage->requestLength == 0 )
+            {
+                memcpy( pPackage->request, mcpsIndication->Buffer, mcpsIndication->BufferSize );
+                pPackage->requestLength = mcpsIndication->BufferSize;
+                pPackage->requestGroup = downlink.multicastGroup;
+            }
+        }
+        else
+        {
+            downlink.port = mcpsIndication->Port;
+            downlink.length = mcpsIndication->BufferSize;
+            downlink.dataRate = mcpsIndication->RxDatarate;
+            downlink.rssi = mcpsIndication->Rssi;
+            downlink.snr = mcpsIndication->Snr;
+            memcpy( downlink.data, mcpsIndication->Buffer, mcpsIndication->BufferSize );
+            prvDispatchDownlink( &downlink );
+        }
+    }
+
+    /* Check Port */
+    /* Check Datarate */
+    if( mcpsIndication->FramePending == true )
+    {
+        /**
+         * There are some pending commands to be sent uplink. Schedule an uplink whenever possible.
+         */
+        prvOnUplinkPending( true );
+    }
+
+    if( mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_DOWNLINK_TOO_MANY_FRAMES_LOSS )
+    {
+        event.type = LORAWAN_EVENT_TOO_MANY_FRAME_LOSS;
+        event.status = LORAMAC_EVENT_INFO_STATUS_OK;
+
+        if( prvSendEvent( &event ) != pdTRUE )
+        {
+            configPRINTF( ( "Failed to send to too many frame loss event to the queue.\r\n" ) );
+        }
+    }
+}
+
+static void prvMlmeIndication( MlmeIndication_t * MlmeIndication )
+{
+    LoRaWANEventInfo_t event = { 0 };
+
+    configPRINTF( ( "MLME Indication status: %s\n", EventInfoStatusStrings[ MlmeIndication->Status ] ) );
+
+    event.status = MlmeIndication->Status;
+
+    if( event.status == LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        if( MlmeIndication->MlmeIndication == MLME_SCHEDULE_UPLINK )
+        {
+            prvOnUplinkPending( true );
+        }
+    }
+
+    if( MlmeIndication->MlmeIndication == MLME_BEACON )
+    {
+        if( event.status == LORAMAC_EVENT_INFO_STATUS_BEACON_LOCKED )
+        {
+            /* Only the first beacon after an acquisition is reported, not every 128 seconds. */
+            if( xClassB.beaconLocked == false )
+            {
+                xClassB.beaconLocked = true;
+                event.type = LORAWAN_EVENT_BEACON_LOCKED;
+                event.info.beacon.rssi = MlmeIndication->BeaconInfo.Rssi;
+                event.info.beacon.snr = MlmeIndication->BeaconInfo.Snr;
+                event.info.beacon.missedBeacons = xClassB.missedBeacons;
+
+                if( prvSendEvent( &event ) != pdTRUE )
+                {
+                    configPRINTF( ( "Failed to send beacon locked event to the queue.\r\n" ) );
+                }
+            }
+        }
+        else
+        {
+            /* A missed beacon, the MAC keeps the ping slots open with wider windows until the beacon-less period expires. */
+            xClassB.missedBeacons++;
+        }
+    }
+    else if( MlmeIndication->MlmeIndication == MLME_BEACON_LOST )
+    {
+        prvSwitchToClassA();
+        xClassB.state = LORAWAN_CLASS_B_ACQUISITION;
+
+        event.type = LORAWAN_EVENT_BEACON_LOST;
+
+        if( prvSendEvent( &event ) != pdTRUE )
+        {
+            configPRINTF( ( "Failed to send beacon lost event to the queue.\r\n" ) );
+        }
+
+        event.type = LORAWAN_EVENT_CLASS_CHANGED;
+        event.status = LORAMAC_EVENT_INFO_STATUS_OK;
+        event.info.deviceClass = CLASS_A;
+
+        if( prvSendEvent( &event ) != pdTRUE )
+        {
+            configPRINTF( ( "Failed to send class changed event to the queue.\r\n" ) );
+        }
+    }
+}
+
+/* Must be called within a critical section. */
+static int64_t prvGetSlewRemainingMs( uint64_t localMs )
+{
+    uint64_t elapsedMs = localMs - xTimeSync.localRefMs;
+    int64_t remainingMs = 0;
+
+    if( elapsedMs < xTimeSync.slewDurationMs )
+    {
+        remainingMs = ( ( int64_t ) xTimeSync.slewOffsetMs * ( int64_t ) ( xTimeSync.slewDurationMs - elapsedMs ) ) /
+                      ( int64_t ) xTimeSync.slewDurationMs;
+    }
+
+    return remainingMs;
+}
+
+/* Must be called within a critical section. */
+static uint64_t prvGetGpsTimeMs( uint64_t localMs )
+{
+    int64_t elapsedMs = ( int64_t ) ( localMs - xTimeSync.localRefMs );
+    int64_t correctionMs = ( int64_t ) ( ( float ) elapsedMs * xTimeSync.driftPpm * 1e-6f );
+
+    return ( uint64_t ) ( ( int64_t ) xTimeSync.gpsRefMs + elapsedMs - correctionMs - prvGetSlewRemainingMs( localMs ) );
+}
+
+/* Must be called within a critical section. */
+static uint32_t prvGetErrorBoundMs( uint64_t localMs )
+{
+    float elapsedMs = ( float ) ( localMs - xTimeSync.localRefMs );
+    int64_t slewMs = prvGetSlewRemainingMs( localMs );
+
+    return ( uint32_t ) lorawanConfigGPS_TIME_SYNC_ERROR_MS + ( uint32_t ) ( ( slewMs < 0 ) ? -slewMs : slewMs ) +
+           ( uint32_t ) ( elapsedMs * xTimeSync.driftUncertaintyPpm * 1e-6f );
+}
+
+/**
+ * @brief Updates the network synchronized clock once LoRaMAC applied a DeviceTimeAns to the system time.
+ * The drift measured since the previous synchronization is merged with the current estimate, weighted by their
+ * uncertainties, unless they disagree, in which case the drift changed and the new measurement is used alone.
+ */
+static void prvOnDeviceTimeAns( void )
+{
+    SysTime_t sysTime = SysTimeGet();
+    uint64_t localMs = prvGetLocalTimeMs();
+    uint64_t gpsMs = ( ( uint64_t ) ( sysTime.Seconds - UNIX_GPS_EPOCH_OFFSET ) * 1000ULL ) + ( uint64_t ) sysTime.SubSeconds;
+    float intervalMs, measuredPpm, measuredUncertaintyPpm, variance, measuredVariance;
+    int64_t offsetMs;
+    uint64_t resyncMs;
+
+    taskENTER_CRITICAL();
+
+    if( xTimeSync.synchronized == true )
+    {
+        intervalMs = ( float ) ( gpsMs - xTimeSync.gpsRefMs );
+        measuredPpm = ( ( float ) ( ( int64_t ) ( localMs - xTimeSync.localRefMs ) - ( int64_t ) ( gpsMs - xTimeSync.gpsRefMs ) ) /
+                        intervalMs ) * 1e6f;
+        measuredUncertaintyPpm = ( ( 2.0f * ( float ) lorawanConfigGPS_TIME_SYNC_ERROR_MS ) / intervalMs ) * 1e6f;
+
+        if( ( xTimeSync.syncCount == 1 ) ||
+            ( fabsf( measuredPpm - xTimeSync.driftPpm ) > ( 3.0f * ( xTimeSync.driftUncertaintyPpm + measuredUncertaintyPpm ) ) ) )
+        {
+            xTimeSync.driftPpm = measuredPpm;
+            xTimeSync.driftUncertaintyPpm = measuredUncertaintyPpm;
+        }
+        else
+        {
+            variance = xTimeSync.driftUncertaintyPpm * xTimeSync.driftUncertaintyPpm;
+            measuredVariance = measuredUncertaintyPpm * measuredUncertaintyPpm;
+            xTimeSync.driftPpm += ( measuredPpm - xTimeSync.driftPpm ) * ( variance / ( variance + measuredVariance ) );
+            xTimeSync.driftUncertaintyPpm = sqrtf( ( variance * measuredVariance ) / ( variance + measuredVariance ) );
+        }
+
+        if( xTimeSync.driftUncertaintyPpm < LORAWAN_GPS_TIME_MIN_DRIFT_UNCERTAINTY_PPM )
+        {
+            xTimeSync.driftUncertaintyPpm = LORAWAN_GPS_TIME_MIN_DRIFT_UNCERTAINTY_PPM;
+        }
+
+        /* Slew from the time reported so far, or step if the offset cannot be absorbed before the next resync. */
+        offsetMs = ( int64_t ) gpsMs - ( int64_t ) prvGetGpsTimeMs( localMs );
+        xTimeSync.slewOffsetMs = ( int32_t ) offsetMs;
+        xTimeSync.slewDurationMs = ( uint32_t ) ( ( ( offsetMs < 0 ) ? -offsetMs : offsetMs ) * 1000000LL / lorawanConfigGPS_TIME_SLEW_PPM );
+
+        if( xTimeSync.slewDurationMs > ( lorawanConfigGPS_TIME_MIN_RESYNC_SEC * 1000UL ) )
+        {
+            xTimeSync.slewOffsetMs = 0;
+            xTimeSync.slewDurationMs = 0;
+        }
+    }
+    else
+    {
+        xTimeSync.driftPpm = 0.0f;
+        xTimeSync.driftUncertaintyPpm = ( float ) lorawanConfigGPS_TIME_CLOCK_TOLERANCE_PPM;
+        xTimeSync.slewOffsetMs = 0;
+        xTimeSync.slewDurationMs = 0;
+    }
+
+    xTimeSync.localRefMs = localMs;
+    xTimeSync.gpsRefMs = gpsMs;
+    xTimeSync.synchronized = true;
+    xTimeSync.syncCount++;
+
+    /* Next resync once the drift uncertainty alone makes the error bound reach the target. */
+    resyncMs = ( uint64_t ) ( ( float ) ( lorawanConfigGPS_TIME_TARGET_ERROR_MS - lorawanConfigGPS_TIME_SYNC_ERROR_MS ) /
+                              ( xTimeSync.driftUncertaintyPpm * 1e-6f ) );
+
+    if( resyncMs < ( lorawanConfigGPS_TIME_MIN_RESYNC_SEC * 1000ULL ) )
+    {
+        resyncMs = lorawanConfigGPS_TIME_MIN_RESYNC_SEC * 1000ULL;
+    }
+    else if( resyncMs > ( lorawanConfigGPS_TIME_MAX_RESYNC_SEC * 1000ULL ) )
+    {
+        resyncMs = lorawanConfigGPS_TIME_MAX_RESYNC_SEC * 1000ULL;
+    }
+
+    xTimeSync.nextSyncMs = localMs + resyncMs;
+
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Piggybacks a DeviceTimeReq on the next uplink if the GPS time was never synchronized or is due for a resync.
+ */
+static void prvScheduleTimeSync( void )
+{
+    #if ( lorawanConfigGPS_TIME_TARGET_ERROR_MS > 0 )
+        if( ( xTimeSync.requestPending == false ) &&
+            ( ( xTimeSync.synchronized == false ) || ( prvGetLocalTimeMs() >= xTimeSync.nextSyncMs ) ) )
+        {
+            if( LoRaWAN_RequestDeviceTimeSync() != LORAMAC_STATUS_OK )
+            {
+                configPRINTF( ( "Failed to request a device time resynchronization.\r\n" ) );
+            }
+        }
+    #endif
+}
+
+/* Starts the periods of the Rejoin-Requests, from a join or a rejoin. */
+static void prvStartRejoinPeriods( void )
+{
+    uint64_t nowMs = prvGetLocalTimeMs();
+
+    taskENTER_CRITICAL();
+    xRejoin.sessionStarted = true;
+    xRejoin.uplinks = 0;
+    xRejoin.nextType0Ms = nowMs + ( ( 1ULL << ( xRejoin.maxTimeN + 10U ) ) * 1000ULL );
+    xRejoin.nextType1Ms = ( lorawanConfigREJOIN_TYPE_1_PERIOD_SEC > 0 ) ?
+                          ( nowMs + ( ( uint64_t ) lorawanConfigREJOIN_TYPE_1_PERIOD_SEC * 1000ULL ) ) : UINT64_MAX;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Hands the answer of a Rejoin-Request to LoRaWAN_Rejoin(), or reports the periodic ones to the application.
+ * The periods start again from the answer, or from the failure, so a network which does not answer is not retried
+ * before the next period.
+ */
+static void prvOnRejoinConfirm( LoRaMacEventInfoStatus_t status )
+{
+    LoRaWANEventInfo_t event = { 0 };
+
+    if( status == LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        /* As after a join, the MAC commands waiting for an uplink were discarded and the device address may have changed. */
+        xTimeSync.requestPending = false;
+        xPiggyback.pending = false;
+        ulUplinkSlot = LORAWAN_UPLINK_SLOT_FROM_DEV_ADDR;
+    }
+
+    prvStartRejoinPeriods();
+    xRejoin.pending = false;
+
+    if( xRejoin.blocking == true )
+    {
+        prvCompleteConfirm( &pxMlmeWaiter, status );
+    }
+    else
+    {
+        event.type = LORAWAN_EVENT_REJOINED;
+        event.status = status;
+        event.info.rejoinType = xRejoin.pendingType;
+
+        if( prvSendEvent( &event ) != pdTRUE )
+        {
+            configPRINTF( ( "Failed to send rejoined event to the queue.\r\n" ) );
+        }
+    }
+}
+
+static void prvMlmeConfirm( MlmeConfirm_t * mlmeConfirm )
+{
+    LoRaWANEventInfo_t event = { 0 };
+    MibRequestConfirm_t mibReq = { 0 };
+
+    configPRINTF( ( "MLME CONFIRM  status: %s\n", EventInfoStatusStrings[ mlmeConfirm->Status ] ) );
+
+    switch( mlmeConfirm->MlmeRequest )
+    {
+        case MLME_JOIN:
+            prvCompleteConfirm( &pxMlmeWaiter, mlmeConfirm->Status );
+            break;
+
+        case MLME_REJOIN_0:
+        case MLME_REJOIN_1:
+        case MLME_REJOIN_2:
+            prvOnRejoinConfirm( mlmeConfirm->Status );
+            break;
+
+        case MLME_DEVICE_TIME:
+            xTimeSync.requestPending = false;
+
+            if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+            {
+                prvOnDeviceTimeAns();
+            }
+
+            if( xClassB.state == LORAWAN_CLASS_B_TIME_SYNC )
+            {
+                xClassB.state = ( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK ) ?
+                                LORAWAN_CLASS_B_ACQUISITION : LORAWAN_CLASS_B_TIME_SYNC;
+                xClassB.requestIssued = false;
+            }
+
+            event.type = LORAWAN_EVENT_DEVICE_TIME_UPDATED;
+            event.status = mlmeConfirm->Status;
+
+            if( prvSendEvent( &event ) != pdTRUE )
+            {
+                configPRINTF( ( "Failed to send device time updated event to the queue.\r\n" ) );
+            }
+
+            break;
+
+        case MLME_LINK_CHECK:
+            event.type = LORAWAN_EVENT_LINK_CHECK_REPLY;
+            event.status = mlmeConfirm->Status;
+            event.info.linkCheck.DemodMargin = mlmeConfirm->DemodMargin;
+            event.info.linkCheck.NbGateways = mlmeConfirm->NbGateways;
+
+            taskENTER_CRITICAL();
+
+            if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+            {
+                LinkQuality_AddLinkCheck( &xLinkQuality, mlmeConfirm->DemodMargin, mlmeConfirm->NbGateways );
+            }
+
+            if( xRateAdaptEnabled == true )
+            {
+                if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+                {
+                    RateAdapt_OnLinkCheck( &xRateAdapt, mlmeConfirm->DemodMargin, mlmeConfirm->NbGateways );
+                }
+                else
+                {
+                    RateAdapt_OnLinkCheckLost( &xRateAdapt );
+                }
+            }
+
+            taskEXIT_CRITICAL();
+
+            if( ( lorawanConfigRX_TIMING_CALIBRATION == 1 ) && ( mlmeConfirm->Status != LORAMAC_EVENT_INFO_STATUS_OK ) )
+            {
+                prvOnDownlinkMissed();
+            }
+
+            if( prvSendEvent( &event ) != pdTRUE )
+            {
+                configPRINTF( ( "Failed to send link check reply event to the queue.\r\n" ) );
+            }
+
+            break;
+
+        case MLME_BEACON_ACQUISITION:
+
+            if( xClassB.state == LORAWAN_CLASS_B_ACQUISITION )
+            {
+                /* If the beacon is not found, the time is synchronized again before the next search. */
+                xClassB.state = ( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK ) ?
+                                LORAWAN_CLASS_B_PING_SLOT_INFO : LORAWAN_CLASS_B_TIME_SYNC;
+                xClassB.requestIssued = false;
+            }
+
+            break;
+
+        case MLME_PING_SLOT_INFO:
+
+            if( xClassB.state == LORAWAN_CLASS_B_PING_SLOT_INFO )
+            {
+                xClassB.requestIssued = false;
+
+                if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+                {
+                    mibReq.Type = MIB_DEVICE_CLASS;
+                    mibReq.Param.Class = CLASS_B;
+
+                    if( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
+                    {
+                        xClassB.state = LORAWAN_CLASS_B_ACTIVE;
+
+                        event.type = LORAWAN_EVENT_CLASS_CHANGED;
+                        event.status = LORAMAC_EVENT_INFO_STATUS_OK;
+                        event.info.deviceClass = CLASS_B;
+
+                        if( prvSendEvent( &event ) != pdTRUE )
+                        {
+                            configPRINTF( ( "Failed to send class changed event to the queue.\r\n" ) );
+                        }
+                    }
+                    else
+                    {
+                        configPRINTF( ( "Failed to switch to class B.\r\n" ) );
+                    }
+                }
+            }
+
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Queues the answers of a package for the next uplink, after those not sent yet if there is room. Otherwise the
+ * older answers are dropped and counted, the application server asks again for the answers it misses.
+ */
+static void prvSetPackageAnswer( LoRaWANPackage_t * pPackage,
+                                 const uint8_t * answer,
+                                 size_t answerLength )
+{
+    size_t droppedLength = 0;
+
+    if( answerLength == 0 )
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+
+    if( ( pPackage->answerLength + answerLength ) > sizeof( pPackage->answer ) )
+    {
+        droppedLength = pPackage->answerLength;
+        pPackage->answerLength = 0;
+        xPiggyback.stats.answersDropped++;
+    }
+
+    memcpy( &pPackage->answer[ pPackage->answerLength ], answer, answerLength );
+    pPackage->answerLength += answerLength;
+    taskEXIT_CRITICAL();
+
+    if( droppedLength > 0 )
+    {
+        configPRINTF( ( "Dropped %u bytes of answers on port %d not sent yet.\r\n", ( unsigned ) droppedLength, pPackage->port ) );
+    }
+
+    /* The answers are sent by the next uplink, they need a frame of their own on the port of the package. */
+    prvOnUplinkPending( false );
+}
+
+static uint32_t prvReadLittleEndian( const uint8_t * buffer,
+                                     size_t size )
+{
+    uint32_t value = 0;
+
+    while( size > 0 )
+    {
+        size--;
+        value = ( value << 8 ) | buffer[ size ];
+    }
+
+    return value;
+}
+
+static void prvWriteLittleEndian( uint8_t * buffer,
+                                  uint32_t value,
+                                  size_t size )
+{
+    size_t i;
+
+    for( i = 0; i < size; i++ )
+    {
+        buffer[ i ] = ( uint8_t ) ( value >> ( 8 * i ) );
+    }
+}
+
+/* Sets up the LoRaMAC multicast channel of a group from its stored parameters, replacing the previous setup if any. */
+static LoRaMacStatus_t prvSetupMulticastChannel( uint8_t groupId )
+{
+    LoRaWANMulticast_t * pGroup = &xMulticast[ groupId ];
+    McChannelParams_t channel = { 0 };
+
+    channel.IsRemotelySetup = pGroup->remotelySetup;
+    channel.Class = pGroup->groupClass;
+    channel.IsEnabled = true;
+    channel.GroupID = ( AddressIdentifier_t ) ( MULTICAST_0_ADDR + groupId );
+    channel.Address = pGroup->address;
+    channel.FCountMin = pGroup->minFCnt;
+    channel.FCountMax = pGroup->maxFCnt;
+    channel.RxParams = pGroup->rxParams;
+
+    if( pGroup->remotelySetup == true )
+    {
+        channel.McKeys.McKeyE = pGroup->keys[ 0 ];
+    }
+    else
+    {
+        channel.McKeys.Session.McAppSKey = pGroup->keys[ 0 ];
+        channel.McKeys.Session.McNwkSKey = pGroup->keys[ 1 ];
+    }
+
+    ( void ) LoRaMacMcChannelDelete( channel.GroupID );
+
+    return LoRaMacMcChannelSetup( &channel );
+}
+
+/* Returns the class the running multicast sessions need, CLASS_A if none is running. */
+static DeviceClass_t prvGetMulticastSessionClass( void )
+{
+    DeviceClass_t sessionClass = CLASS_A;
+    size_t i;
+
+    for( i = 0; i < LORAWAN_MAX_MULTICAST_GROUPS; i++ )
+    {
+        if( ( xMulticast[ i ].sessionActive == true ) && ( xMulticast[ i ].sessionClass != CLASS_A ) &&
+            ( sessionClass != CLASS_C ) )
+        {
+            sessionClass = xMulticast[ i ].sessionClass;
+        }
+    }
+
+    return sessionClass;
+}
+
+/**
+ * @brief Starts and ends the multicast sessions which are due, then arms the timer for the next start or end.
+ * The class switch itself is done by prvProcessDeviceClass().
+ */
+static void prvProcessMulticastSessions( void )
+{
+    uint64_t nowMs = prvGetLocalTimeMs();
+    uint64_t nextMs = UINT64_MAX;
+    LoRaWANMulticast_t * pGroup;
+    size_t i;
+
+    for( i = 0; i < LORAWAN_MAX_MULTICAST_GROUPS; i++ )
+    {
+        pGroup = &xMulticast[ i ];
+
+        if( pGroup->sessionClass == CLASS_A )
+        {
+            continue;
+        }
+
+        if( nowMs >= pGroup->sessionEndMs )
+        {
+            configPRINTF( ( "Multicast session of group %u ended.\r\n", ( unsigned ) i ) );
+            pGroup->sessionClass = CLASS_A;
+            pGroup->sessionActive = false;
+            continue;
+        }
+
+        if( ( pGroup->sessionActive == false ) && ( nowMs >= pGroup->sessionStartMs ) )
+        {
+            configPRINTF( ( "Multicast session of group %u started.\r\n", ( unsigned ) i ) );
+            pGroup->sessionActive = true;
+        }
+
+        if( pGroup->sessionActive == true )
+        {
+            nextMs = ( pGroup->sessionEndMs < nextMs ) ? pGroup->sessionEndMs : nextMs;
+        }
+        else
+        {
+            nextMs = ( pGroup->sessionStartMs < nextMs ) ? pGroup->sessionStartMs : nextMs;
+        }
+    }
+
+    prvArmTimer( &xMulticastTimer, &ullMulticastDeadlineMs, nextMs, nowMs );
+}
+
+/**
+ * @brief Handles McClassCSessionReq and McClassBSessionReq: the group is set up again in the class of the session, and the
+ * session is scheduled at the GPS time given by the application server. The device starts right away if its time was never
+ * synchronized, and requests a synchronization.
+ *
+ * @return Size of the answer.
+ */
+static size_t prvScheduleMulticastSession( DeviceClass_t sessionClass,
+                                           const uint8_t * request,
+                                           uint8_t * answer )
+{
+    uint8_t groupId = request[ 0 ] & LORAWAN_MC_GROUP_ID_MASK;
+    LoRaWANMulticast_t * pGroup = &xMulticast[ groupId ];
+    uint32_t sessionTime = prvReadLittleEndian( &request[ 1 ], 4 );
+    uint32_t timeOut = request[ 5 ] & 0x0FU;
+    McRxParams_t rxParams = { 0 };
+    uint64_t localMs = prvGetLocalTimeMs();
+    uint64_t gpsMs = 0;
+    uint32_t timeToStart = 0;
+    bool synchronized;
+    uint8_t status = groupId | LORAWAN_MC_GROUP_UNDEFINED;
+
+    if( sessionClass == CLASS_C )
+    {
+        rxParams.ClassC.Frequency = prvReadLittleEndian( &request[ 6 ], 3 ) * 100U;
+        rxParams.ClassC.Datarate = ( int8_t ) request[ 9 ];
+    }
+    else
+    {
+        rxParams.ClassB.Periodicity = ( request[ 5 ] >> 4 ) & 0x07U;
+        rxParams.ClassB.Frequency = prvReadLittleEndian( &request[ 6 ], 3 ) * 100U;
+        rxParams.ClassB.Datarate = ( int8_t ) request[ 9 ];
+    }
+
+    if( pGroup->defined == true )
+    {
+        pGroup->groupClass = sessionClass;
+
+        /* LoRaMAC checks the frequency and the data rate, and clears their error bits in status. */
+        if( prvSetupMulticastChannel( groupId ) == LORAMAC_STATUS_OK )
+        {
+            ( void ) LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t ) ( MULTICAST_0_ADDR + groupId ), &rxParams, &status );
+        }
+    }
+
+    answer[ 0 ] = status;
+
+    if( status != groupId )
+    {
+        return 1;
+    }
+
+    taskENTER_CRITICAL();
+    synchronized = xTimeSync.synchronized;
+
+    if( synchronized == true )
+    {
+        gpsMs = prvGetGpsTimeMs( localMs );
+    }
+
+    taskEXIT_CRITICAL();
+
+    if( synchronized == false )
+    {
+        ( void ) LoRaWAN_RequestDeviceTimeSync();
+    }
+    else if( ( ( uint64_t ) sessionTime * 1000ULL ) > gpsMs )
+    {
+        timeToStart = ( uint32_t ) ( ( ( ( uint64_t ) sessionTime * 1000ULL ) - gpsMs ) / 1000ULL );
+    }
+
+    pGroup->rxParams = rxParams;
+    pGroup->sessionClass = sessionClass;
+    pGroup->sessionActive = false;
+    pGroup->sessionStartMs = localMs + ( ( uint64_t ) timeToStart * 1000ULL );
+
+    /* The time out is given in seconds for class C, in beacon periods for class B. */
+    pGroup->sessionEndMs = pGroup->sessionStartMs + ( ( 1ULL << timeOut ) * ( ( sessionClass == CLASS_C ) ? 1000ULL : 128000ULL ) );
+
+    prvWriteLittleEndian( &answer[ 1 ], timeToStart, 3 );
+
+    return 4;
+}
+
+/**
+ * @brief Processes the remote multicast setup commands received on lorawanConfigREMOTE_MULTICAST_SETUP_PORT, and queues their
+ * answers for the next uplink. Called from the LoRaMAC task, as the multicast channels cannot be set up from the MAC callbacks.
+ */
+static void prvProcessRemoteMulticastSetup( void )
+{
+    LoRaWANPackage_t * pPackage = &xPackages[ LORAWAN_PACKAGE_MULTICAST ];
+    const uint8_t * request = pPackage->request;
+    size_t length = pPackage->requestLength;
+    uint8_t answer[ LORAWAN_PACKAGE_ANSWER_SIZE ];
+    size_t answerLength = 0;
+    size_t commandLength;
+    LoRaWANMulticast_t * pGroup;
+    uint8_t groupId, mask, i;
+
+    /* Remote setup commands are only accepted in unicast. */
+    if( pPackage->requestGroup != LORAWAN_UNICAST )
+    {
+        length = 0;
+    }
+
+    if( length == 0 )
+    {
+        pPackage->requestLength = 0;
+        return;
+    }
+
+    /* Each answer is at most 22 bytes, the status of all the groups. */
+    while( ( length > 0 ) && ( ( answerLength + 22U ) <= sizeof( answer ) ) )
+    {
+        switch( request[ 0 ] )
+        {
+            case LORAWAN_MC_PACKAGE_VERSION_REQ:
+                commandLength = 1;
+                answer[ answerLength++ ] = LORAWAN_MC_PACKAGE_VERSION_REQ;
+                answer[ answerLength++ ] = LORAWAN_MC_PACKAGE_ID;
+                answer[ answerLength++ ] = LORAWAN_MC_PACKAGE_VERSION;
+                break;
+
+            case LORAWAN_MC_GROUP_STATUS_REQ:
+                commandLength = 2;
+
+                if( length < commandLength )
+                {
+                    break;
+                }
+
+                answer[ answerLength++ ] = LORAWAN_MC_GROUP_STATUS_REQ;
+                mask = 0;
+                groupId = 0;
+
+                for( i = 0; i < LORAWAN_MAX_MULTICAST_GROUPS; i++ )
+                {
+                    if( xMulticast[ i ].defined == true )
+                    {
+                        groupId++;
+
+                        if( ( request[ 1 ] & ( 1U << i ) ) != 0 )
+                        {
+                            mask |= ( uint8_t ) ( 1U << i );
+                        }
+                    }
+                }
+
+                /* Status: total number of groups in bits 4 to 6, groups answered for in bits 0 to 3. */
+                answer[ answerLength++ ] = ( uint8_t ) ( ( groupId << 4 ) | mask );
+
+                for( i = 0; i < LORAWAN_MAX_MULTICAST_GROUPS; i++ )
+                {
+                    if( ( mask & ( 1U << i ) ) != 0 )
+                    {
+                        answer[ answerLength++ ] = i;
+                        prvWriteLittleEndian( &answer[ answerLength ], xMulticast[ i ].address, 4 );
+                        answerLength += 4;
+                    }
+                }
+
+                break;
+
+            case LORAWAN_MC_GROUP_SETUP_REQ:
+                commandLength = 30;
+
+                if( length < commandLength )
+                {
+                    break;
+                }
+
+                groupId = request[ 1 ] & LORAWAN_MC_GROUP_ID_MASK;
+                pGroup = &xMulticast[ groupId ];
+                memset( pGroup, 0, sizeof( LoRaWANMulticast_t ) );
+                pGroup->remotelySetup = true;
+                pGroup->address = prvReadLittleEndian( &request[ 2 ], 4 );
+                memcpy( pGroup->keys[ 0 ], &request[ 6 ], LORAWAN_KEY_SIZE );
+                pGroup->minFCnt = prvReadLittleEndian( &request[ 22 ], 4 );
+                pGroup->maxFCnt = prvReadLittleEndian( &request[ 26 ], 4 );
+                pGroup->groupClass = CLASS_C;
+                pGroup->sessionClass = CLASS_A;
+                pGroup->defined = ( prvSetupMulticastChannel( groupId ) == LORAMAC_STATUS_OK );
+
+                answer[ answerLength++ ] = LORAWAN_MC_GROUP_SETUP_REQ;
+                answer[ answerLength++ ] = groupId | ( ( pGroup->defined == true ) ? 0U : LORAWAN_MC_ID_ERROR );
+                break;
+
+            case LORAWAN_MC_GROUP_DELETE_REQ:
+                commandLength = 2;
+
+                if( length < commandLength )
+                {
+                    break;
+                }
+
+                groupId = request[ 1 ] & LORAWAN_MC_GROUP_ID_MASK;
+                answer[ answerLength++ ] = LORAWAN_MC_GROUP_DELETE_REQ;
+                answer[ answerLength++ ] = groupId | ( ( xMulticast[ groupId ].defined == true ) ? 0U : LORAWAN_MC_ID_ERROR );
+                ( void ) LoRaWAN_RemoveMulticastGroup( groupId );
+                break;
+
+            case LORAWAN_MC_CLASS_C_SESSION_REQ:
+            case LORAWAN_MC_CLASS_B_SESSION_REQ:
+                commandLength = 11;
+
+                if( length < commandLength )
+                {
+                    break;
+                }
+
+                answer[ answerLength++ ] = request[ 0 ];
+                answerLength += prvScheduleMulticastSession( ( request[ 0 ] == LORAWAN_MC_CLASS_C_SESSION_REQ ) ? CLASS_C : CLASS_B,
+                                                             &request[ 1 ], &answer[ answerLength ] );
+                break;
+
+            default:
+                configPRINTF( ( "Unknown remote multicast setup command 0x%02x.\r\n", request[ 0 ] ) );
+                commandLength = length;
+                break;
+        }
+
+        if( length < commandLength )
+        {
+            configPRINTF( ( "Truncated remote multicast setup command 0x%02x.\r\n", request[ 0 ] ) );
+            break;
+        }
+
+        request += commandLength;
+        length -= commandLength;
+    }
+
+    pPackage->requestLength = 0;
+    prvSetPackageAnswer( pPackage, answer, answerLength );
+    prvProcessMulticastSessions();
+}
+
+/* Verifies the CRC-32 which ends the data block decoded in the storage. */
+static bool prvVerifyDataBlock( uint32_t blockSize )
+{
+    uint8_t buffer[ 64 ];
+    uint32_t offset = 0;
+    uint32_t crc = 0;
+    uint32_t length;
+
+    if( blockSize <= 4 )
+    {
+        return false;
+    }
+
+    while( offset < ( blockSize - 4 ) )
+    {
+        length = ( ( blockSize - 4 - offset ) < sizeof( buffer ) ) ? ( blockSize - 4 - offset ) : sizeof( buffer );
+
+        if( pxDataBlockStorage->read( offset, buffer, length ) == false )
+        {
+            return false;
+        }
+
+        crc = FragDecoder_Crc32( crc, buffer, length );
+        offset += length;
+    }
+
+    if( pxDataBlockStorage->read( offset, buffer, 4 ) == false )
+    {
+        return false;
+    }
+
+    return ( crc == prvReadLittleEndian( buffer, 4 ) );
+}
+
+/* Reports the end of the decoding of the data block to the application, once. */
+static void prvReportDataBlock( FragDecoderStatus_t status )
+{
+    LoRaWANEventInfo_t event = { 0 };
+    uint32_t blockSize = ( ( uint32_t ) xFragDecoder.nbFrag * xFragDecoder.fragSize ) - xFragSession.padding;
+
+    if( ( status == FRAG_DECODER_ONGOING ) || ( xFragSession.reported == true ) )
+    {
+        return;
+    }
+
+    xFragSession.reported = true;
+    xFragSession.verified = ( status == FRAG_DECODER_DONE ) && prvVerifyDataBlock( blockSize );
+
+    configPRINTF( ( "Data block of %lu fragments %s, %u fragments received.\r\n", ( unsigned long ) xFragDecoder.nbFrag,
+                    ( xFragSession.verified == true ) ? "received" : ( status == FRAG_DECODER_DONE ) ? "corrupted" : "lost",
+                    xFragDecoder.nbReceived ) );
+
+    event.type = LORAWAN_EVENT_DATA_BLOCK_RECEIVED;
+    event.status = ( xFragSession.verified == true ) ? LORAMAC_EVENT_INFO_STATUS_OK : LORAMAC_EVENT_INFO_STATUS_ERROR;
+    event.info.dataBlock.size = ( blockSize > 4 ) ? ( blockSize - 4 ) : 0;
+    event.info.dataBlock.descriptor = xFragSession.descriptor;
+    event.info.dataBlock.nbFrag = xFragDecoder.nbFrag;
+    event.info.dataBlock.nbReceived = xFragDecoder.nbReceived;
+
+    if( prvSendEvent( &event ) != pdTRUE )
+    {
+        configPRINTF( ( "Failed to send data block event to the queue.\r\n" ) );
+    }
+}
+
+/* Writes the FragSessionStatusAns to a FragSessionStatusReq, returns its length, 0 if the device does not answer. */
+static size_t prvWriteFragSessionStatus( uint8_t statusRequest,
+                                         uint8_t * answer )
+{
+    uint8_t index = ( statusRequest >> 1 ) & 0x03U;
+    uint16_t missing = FragDecoder_GetMissing( &xFragDecoder );
+
+    /* Without the participants bit, only the devices still missing fragments answer. */
+    if( ( xFragSession.defined == false ) || ( xFragSession.index != index ) ||
+        ( ( ( statusRequest & 0x01U ) == 0 ) && ( missing == 0 ) ) )
+    {
+        return 0;
+    }
+
+    answer[ 0 ] = LORAWAN_FRAG_SESSION_STATUS_REQ;
+    prvWriteLittleEndian( &answer[ 1 ], ( ( uint32_t ) index << 14 ) | ( xFragDecoder.nbReceived & 0x3FFFU ), 2 );
+    answer[ 3 ] = ( missing > 0xFFU ) ? 0xFFU : ( uint8_t ) missing;
+    answer[ 4 ] = ( xFragDecoder.status == FRAG_DECODER_TOO_MANY_LOST ) ? 0x01U : 0x00U;
+
+    return 5;
+}
+
+/* Queues the answer to a multicast FragSessionStatusReq once its random delay is over, with the status at that time. */
+static void prvProcessFragSessionStatus( void )
+{
+    uint8_t answer[ 5 ];
+    uint64_t nowMs = prvGetLocalTimeMs();
+
+    if( ( xFragSession.statusAnswerMs != 0 ) && ( nowMs >= xFragSession.statusAnswerMs ) )
+    {
+        xFragSession.statusAnswerMs = 0;
+        prvSetPackageAnswer( &xPackages[ LORAWAN_PACKAGE_FRAGMENTATION ], answer,
+                             prvWriteFragSessionStatus( xFragSession.statusRequest, answer ) );
+    }
+
+    prvArmTimer( &xFragStatusTimer, &ullFragStatusDeadlineMs,
+                 ( xFragSession.statusAnswerMs != 0 ) ? xFragSession.statusAnswerMs : UINT64_MAX, nowMs );
+}
+
+/**
+ * @brief Processes the fragmented data block transport commands received on lorawanConfigFRAGMENTATION_PORT, and queues their
+ * answers for the next uplink. Called from the LoRaMAC task, the fragments are decoded into the storage as they arrive.
+ */
+static void prvProcessFragmentation( void )
+{
+    LoRaWANPackage_t * pPackage = &xPackages[ LORAWAN_PACKAGE_FRAGMENTATION ];
+    const uint8_t * request = pPackage->request;
+    size_t length = pPackage->requestLength;
+    uint8_t answer[ LORAWAN_PACKAGE_ANSWER_SIZE ];
+    size_t answerLength = 0;
+    size_t commandLength;
+    uint32_t delayMs;
+    uint8_t index, status;
+
+    /* Each answer is at most 5 bytes. */
+    while( ( length > 0 ) && ( ( answerLength + 5U ) <= sizeof( answer ) ) )
+    {
+        switch( request[ 0 ] )
+        {
+            case LORAWAN_FRAG_PACKAGE_VERSION_REQ:
+                commandLength = 1;
+                answer[ answerLength++ ] = LORAWAN_FRAG_PACKAGE_VERSION_REQ;
+                answer[ answerLength++ ] = LORAWAN_FRAG_PACKAGE_ID;
+                answer[ answerLength++ ] = LORAWAN_FRAG_PACKAGE_VERSION;
+                break;
+
+            case LORAWAN_FRAG_SESSION_STATUS_REQ:
+                commandLength = 2;
+
+                if( length < commandLength )
+                {
+                    break;
+                }
+
+                index = ( request[ 1 ] >> 1 ) & 0x03U;
+
+                if( pPackage->requestGroup == LORAWAN_UNICAST )
+                {
+                    answerLength += prvWriteFragSessionStatus( request[ 1 ], &answer[ answerLength ] );
+                }
+                else if( ( xFragSession.defined == true ) && ( xFragSession.index == index ) )
+                {
+                    /* The whole group received the request, the answers are spread over the BlockAckDelay window. */
+                    delayMs = FragDecoder_GetAnswerDelayMs( xFragSession.blockAckDelay, ( uint32_t ) randr( 0, 0x7FFFFFFE ) );
+                    xFragSession.statusRequest = request[ 1 ];
+                    xFragSession.statusAnswerMs = prvGetLocalTimeMs() + delayMs;
+                    configPRINTF( ( "Fragmentation session status answered in %lu ms.\r\n", ( unsigned long ) delayMs ) );
+                }
+
+                break;
+
+            case LORAWAN_FRAG_SESSION_SETUP_REQ:
+                commandLength = 11;
+
+                if( length < commandLength )
+                {
+                    break;
+                }
+
+                index = ( request[ 1 ] >> 4 ) & 0x03U;
+                status = 0;
+
+                if( ( ( request[ 5 ] >> 3 ) & 0x07U ) != 0 )
+                {
+                    status |= LORAWAN_FRAG_ENCODING_UNSUPPORTED;
+                }
+
+                if( ( xFragSession.defined == true ) && ( xFragSession.index != index ) &&
+                    ( xFragDecoder.status == FRAG_DECODER_ONGOING ) )
+                {
+                    status |= LORAWAN_FRAG_INDEX_UNSUPPORTED;
+                }
+
+                if( ( status == 0 ) &&
+                    ( FragDecoder_Init( &xFragDecoder, ( uint16_t ) prvReadLittleEndian( &request[ 2 ], 2 ), request[ 4 ],
+                                        pxDataBlockStorage ) == false ) )
+                {
+                    /* The decoder of the previous session was reset. */
+                    xFragSession.defined = false;
+                    status |= LORAWAN_FRAG_NOT_ENOUGH_MEMORY;
+                }
+
+                if( status == 0 )
+                {
+                    memset( &xFragSession, 0, sizeof( LoRaWANFragSession_t ) );
+                    xFragSession.defined = true;
+                    xFragSession.index = index;
+                    xFragSession.groupMask = request[ 1 ] & 0x0FU;
+                    xFragSession.padding = request[ 6 ];
+                    xFragSession.descriptor = prvReadLittleEndian( &request[ 7 ], 4 );
+                    xFragSession.blockAckDelay = request[ 5 ] & 0x07U;
+                    configPRINTF( ( "Fragmentation session %u set up, %u fragments of %u bytes.\r\n", index,
+                                    xFragDecoder.nbFrag, xFragDecoder.fragSize ) );
+                }
+
+                answer[ answerLength++ ] = LORAWAN_FRAG_SESSION_SETUP_REQ;
+                answer[ answerLength++ ] = ( uint8_t ) ( ( index << 6 ) | status );
+                break;
+
+            case LORAWAN_FRAG_SESSION_DELETE_REQ:
+                commandLength = 2;
+
+                if( length < commandLength )
+                {
+                    break;
+                }
+
+                index = request[ 1 ] & 0x03U;
+                status = index;
+
+                if( ( xFragSession.defined == true ) && ( xFragSession.index == index ) )
+                {
+                    xFragSession.defined = false;
+                    xFragSession.statusAnswerMs = 0;
+                }
+                else
+                {
+                    status |= LORAWAN_FRAG_SESSION_UNDEFINED;
+                }
+
+                answer[ answerLength++ ] = LORAWAN_FRAG_SESSION_DELETE_REQ;
+                answer[ answerLength++ ] = status;
+                break;
+
+            case LORAWAN_FRAG_DATA_FRAGMENT:
+
+                /* A data fragment fills the rest of the frame. */
+                commandLength = length;
+                index = request[ 2 ] >> 6;
+
+                if( ( length >= ( 3U + xFragDecoder.fragSize ) ) && ( xFragSession.defined == true ) &&
+                    ( xFragSession.index == index ) &&
+                    ( ( pPackage->requestGroup == LORAWAN_UNICAST ) ||
+                      ( ( xFragSession.groupMask & ( 1U << pPackage->requestGroup ) ) != 0 ) ) )
+                {
+                    prvReportDataBlock( FragDecoder_Process( &xFragDecoder,
+                                                             ( uint16_t ) ( prvReadLittleEndian( &request[ 1 ], 2 ) & 0x3FFFU ),
+                                                             &request[ 3 ] ) );
+                }
+
+                break;
+
+            default:
+                configPRINTF( ( "Unknown fragmentation command 0x%02x.\r\n", request[ 0 ] ) );
+                commandLength = length;
+                break;
+        }
+
+        if( length < commandLength )
+        {
+            configPRINTF( ( "Truncated fragmentation command 0x%02x.\r\n", request[ 0 ] ) );
+            break;
+        }
+
+        request += commandLength;
+        length -= commandLength;
+    }
+
+    pPackage->requestLength = 0;
+    prvSetPackageAnswer( pPackage, answer, answerLength );
+    prvProcessFragSessionStatus();
+}
+
+/* Starts the switch to class B, from the time synchronization unless the GPS time is known already. */
+static void prvStartClassB( void )
+{
+    xClassB.state = ( xTimeSync.synchronized == true ) ? LORAWAN_CLASS_B_ACQUISITION : LORAWAN_CLASS_B_TIME_SYNC;
+    xClassB.requestIssued = false;
+    xClassB.beaconLocked = false;
+    xClassB.missedBeacons = 0;
+}
+
+static void prvSendClassChanged( DeviceClass_t deviceClass )
+{
+    LoRaWANEventInfo_t event = { 0 };
+
+    event.type = LORAWAN_EVENT_CLASS_CHANGED;
+    event.status = LORAMAC_EVENT_INFO_STATUS_OK;
+    event.info.deviceClass = deviceClass;
+
+    if( prvSendEvent( &event ) != pdTRUE )
+    {
+        configPRINTF( ( "Failed to send class changed event to the queue.\r\n" ) );
+    }
+}
+
+/* Switches the MAC between class A and class C, where the receiver stays on the RX2 channel between the uplinks. */
+static void prvSwitchClassC( DeviceClass_t requestedClass )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    DeviceClass_t macClass;
+
+    mibReq.Type = MIB_DEVICE_CLASS;
+
+    if( LoRaMacMibGetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK )
+    {
+        return;
+    }
+
+    macClass = mibReq.Param.Class;
+
+    if( ( requestedClass == CLASS_C ) && ( macClass == CLASS_A ) )
+    {
+        mibReq.Type = MIB_NETWORK_ACTIVATION;
+
+        if( ( LoRaMacMibGetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK ) ||
+            ( mibReq.Param.NetworkActivation == ACTIVATION_TYPE_NONE ) )
+        {
+            return;
+        }
+    }
+    else if( ( requestedClass == CLASS_C ) || ( macClass != CLASS_C ) )
+    {
+        return;
+    }
+
+    mibReq.Type = MIB_DEVICE_CLASS;
+    mibReq.Param.Class = ( requestedClass == CLASS_C ) ? CLASS_C : CLASS_A;
+
+    if( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
+    {
+        prvSendClassChanged( mibReq.Param.Class );
+    }
+    else
+    {
+        configPRINTF( ( "Failed to switch to class %c.\r\n", ( mibReq.Param.Class == CLASS_C ) ? 'C' : 'A' ) );
+    }
+}
+
+/**
+ * @brief Moves the device towards the class requested by the application, and issues the LoRaMAC request of the current
+ * step of a switch to class B if not done yet. Class B and class C are always left through class A, and a join is done in
+ * class A. A running multicast session raises the requested class to the class of the session.
+ * Called from the LoRaMAC task after each processing, as requests cannot be issued from the MAC callbacks. A request
+ * refused because the MAC is busy is issued again after the next processing.
+ */
+static void prvProcessDeviceClass( void )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    MlmeReq_t mlmeReq = { 0 };
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    DeviceClass_t requestedClass = xClassB.requestedClass;
+    DeviceClass_t sessionClass = prvGetMulticastSessionClass();
+
+    if( ( sessionClass == CLASS_C ) || ( ( sessionClass == CLASS_B ) && ( requestedClass == CLASS_A ) ) )
+    {
+        requestedClass = sessionClass;
+    }
+
+    if( xClassB.joining == true )
+    {
+        requestedClass = CLASS_A;
+    }
+
+    if( ( requestedClass != CLASS_B ) && ( xClassB.state != LORAWAN_CLASS_B_OFF ) )
+    {
+        if( xClassB.state == LORAWAN_CLASS_B_ACTIVE )
+        {
+            prvSendClassChanged( CLASS_A );
+        }
+
+        prvSwitchToClassA();
+    }
+    else if( ( requestedClass == CLASS_B ) && ( xClassB.state == LORAWAN_CLASS_B_OFF ) )
+    {
+        mibReq.Type = MIB_NETWORK_ACTIVATION;
+
+        if( ( LoRaMacMibGetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK ) &&
+            ( mibReq.Param.NetworkActivation != ACTIVATION_TYPE_NONE ) )
+        {
+            prvStartClassB();
+        }
+    }
+
+    prvSwitchClassC( requestedClass );
+
+    if( xClassB.requestIssued == true )
+    {
+        return;
+    }
+
+    switch( xClassB.state )
+    {
+        case LORAWAN_CLASS_B_TIME_SYNC:
+
+            /* The DeviceTimeReq is sent on the next uplink. */
+            if( xTimeSync.requestPending == false )
+            {
+                status = LoRaWAN_RequestDeviceTimeSync();
+            }
+
+            break;
+
+        case LORAWAN_CLASS_B_ACQUISITION:
+            mlmeReq.Type = MLME_BEACON_ACQUISITION;
+            status = LoRaMacMlmeRequest( &mlmeReq );
+            break;
+
+        case LORAWAN_CLASS_B_PING_SLOT_INFO:
+
+            /* The PingSlotInfoReq is sent on the next uplink. */
+            mlmeReq.Type = MLME_PING_SLOT_INFO;
+            mlmeReq.Req.PingSlotInfo.PingSlot.Fields.Periodicity = lorawanConfigCLASS_B_PING_SLOT_PERIODICITY;
+            status = LoRaMacMlmeRequest( &mlmeReq );
+            break;
+
+        default:
+            return;
+    }
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        xClassB.requestIssued = true;
+    }
+    else if( status != LORAMAC_STATUS_BUSY )
+    {
+        configPRINTF( ( "Class B request failed in state %d, status = %d.\r\n", xClassB.state, status ) );
+    }
+}
+
+static LoRaMacStatus_t prvRequestRejoin( LoRaWANRejoinType_t type,
+                                         uint32_t * pDutyCycleWaitMs )
+{
+    static const Mlme_t rejoinRequests[] = { MLME_REJOIN_0, MLME_REJOIN_1, MLME_REJOIN_2 };
+    MlmeReq_t mlmeReq = { 0 };
+    LoRaMacStatus_t status;
+
+    /* The Rejoin-Request goes on the current data rate, not through the data rate sweep of a join. */
+    mlmeReq.Type = rejoinRequests[ type ];
+    status = LoRaMacMlmeRequest( &mlmeReq );
+    *pDutyCycleWaitMs = mlmeReq.ReqReturn.DutyCycleWaitTime;
+
+    return status;
+}
+
+/**
+ * @brief Sends the periodic Rejoin-Requests which are due, then arms the timer for the next one. A request refused
+ * because of the duty cycle is retried once it allows, one refused because the MAC is busy on the next LoRaMAC event.
+ */
+static void prvProcessRejoin( void )
+{
+    uint64_t nowMs = prvGetLocalTimeMs();
+    uint64_t nextMs = UINT64_MAX;
+    uint32_t dutyCycleWaitMs = 0;
+    LoRaMacStatus_t status;
+    bool due = false;
+
+    taskENTER_CRITICAL();
+
+    if( ( xRejoin.sessionStarted == true ) && ( xRejoin.pending == false ) && ( xRejoin.blocking == false ) )
+    {
+        if( ( xRejoin.periodic == true ) &&
+            ( ( nowMs >= xRejoin.nextType0Ms ) || ( xRejoin.uplinks >= ( 1UL << ( xRejoin.maxCountN + 4U ) ) ) ) )
+        {
+            xRejoin.pendingType = LORAWAN_REJOIN_TYPE_0;
+            due = true;
+        }
+        else if( nowMs >= xRejoin.nextType1Ms )
+        {
+            xRejoin.pendingType = LORAWAN_REJOIN_TYPE_1;
+            due = true;
+        }
+
+        xRejoin.pending = due;
+    }
+
+    taskEXIT_CRITICAL();
+
+    if( due == true )
+    {
+        status = prvRequestRejoin( xRejoin.pendingType, &dutyCycleWaitMs );
+
+        if( status == LORAMAC_STATUS_OK )
+        {
+            configPRINTF( ( "Periodic Rejoin-Request of type %d sent.\r\n", xRejoin.pendingType ) );
+        }
+        else
+        {
+            xRejoin.pending = false;
+
+            if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+            {
+                nextMs = nowMs + dutyCycleWaitMs;
+            }
+            else if( status != LORAMAC_STATUS_BUSY )
+            {
+                configPRINTF( ( "Periodic Rejoin-Request of type %d failed, status = %d.\r\n", xRejoin.pendingType, status ) );
+                prvStartRejoinPeriods();
+            }
+        }
+    }
+
+    if( ( xRejoin.sessionStarted == true ) && ( xRejoin.pending == false ) )
+    {
+        if( xRejoin.periodic == true )
+        {
+            nextMs = ( xRejoin.nextType0Ms < nextMs ) ? xRejoin.nextType0Ms : nextMs;
+        }
+
+        nextMs = ( xRejoin.nextType1Ms < nextMs ) ? xRejoin.nextType1Ms : nextMs;
+    }
+
+    prvArmTimer( &xRejoinTimer, &ullRejoinDeadlineMs, nextMs, nowMs );
+}
+
+/* Takes the answers of a package waiting for an uplink, returns false if there are none. */
+static bool prvTakePackageAnswer( LoRaWANPackage_t * pPackage,
+                                  LoRaWANMessage_t * pAnswer )
+{
+    taskENTER_CRITICAL();
+    pAnswer->port = pPackage->port;
+    pAnswer->length = pPackage->answerLength;
+    memcpy( pAnswer->data, pPackage->answer, pPackage->answerLength );
+    pPackage->answerLength = 0;
+    taskEXIT_CRITICAL();
+
+    return ( pAnswer->length > 0 );
+}
+
+/* Takes the answers of the first package which has some, returns NULL if none has. */
+static LoRaWANPackage_t * prvTakeAnyPackageAnswer( LoRaWANMessage_t * pAnswer,
+                                                   bool * pAnswersLeft )
+{
+    LoRaWANPackage_t * pPackage = NULL;
+    size_t i;
+
+    *pAnswersLeft = false;
+
+    for( i = 0; i < LORAWAN_PACKAGE_COUNT; i++ )
+    {
+        if( pPackage == NULL )
+        {
+            pPackage = ( prvTakePackageAnswer( &xPackages[ i ], pAnswer ) == true ) ? &xPackages[ i ] : NULL;
+        }
+        else if( xPackages[ i ].answerLength > 0 )
+        {
+            *pAnswersLeft = true;
+        }
+    }
+
+    return pPackage;
+}
+
+/**
+ * @brief Marks the start of an uplink, called right before it is requested: its receive windows are timed from now.
+ */
+static void prvStartRxWindows( void )
+{
+    taskENTER_CRITICAL();
+    xRxWindows.txStartMs = prvGetLocalTimeMs();
+    xRxWindows.measurable = false;
+    xRxWindows.missed = false;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Sends the uplink the network waits for when the application will not send one soon enough: the MAC answers
+ * wait for the predicted application uplink if it comes within lorawanConfigPIGGYBACK_WINDOW_MS, the package answers
+ * need a frame of their own and are sent right away. The frames are unconfirmed, the network asks again if one is lost.
+ */
+static void prvProcessPiggyback( void )
+{
+    LoRaWANMessage_t answer = { 0 };
+    MibRequestConfirm_t mibReq = { 0 };
+    McpsReq_t mcpsReq = { 0 };
+    LoRaMacStatus_t status;
+    uint64_t nowMs = prvGetLocalTimeMs();
+    uint64_t expectedMs = 0;
+    uint64_t nextMs = 0;
+    size_t i;
+
+    if( xPiggyback.frameInFlight == true )
+    {
+        return;
+    }
+
+    for( i = 0; ( i < LORAWAN_PACKAGE_COUNT ) && ( answer.length == 0 ); i++ )
+    {
+        ( void ) prvTakePackageAnswer( &xPackages[ i ], &answer );
+    }
+
+    if( ( answer.length == 0 ) && ( xPiggyback.pending == true ) )
+    {
+        if( xPiggyback.pendingSinceMs == 0 )
+        {
+            xPiggyback.pendingSinceMs = nowMs;
+        }
+
+        if( xPiggyback.nextUplinkMs != 0 )
+        {
+            expectedMs = xPiggyback.nextUplinkMs;
+        }
+        else if( xPiggyback.periodMs != 0 )
+        {
+            expectedMs = xPiggyback.lastUplinkMs + xPiggyback.periodMs;
+        }
+
+        if( ( expectedMs != 0 ) && ( expectedMs <= ( xPiggyback.pendingSinceMs + lorawanConfigPIGGYBACK_WINDOW_MS ) ) &&
+            ( nowMs < ( expectedMs + LORAWAN_PIGGYBACK_GRACE_MS ) ) )
+        {
+            nextMs = expectedMs + LORAWAN_PIGGYBACK_GRACE_MS;
+        }
+    }
+
+    if( ( nextMs == 0 ) && ( ( answer.length > 0 ) || ( xPiggyback.pending == true ) ) )
+    {
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = answer.port;
+        mcpsReq.Req.Unconfirmed.fBuffer = ( answer.length > 0 ) ? answer.data : NULL;
+        mcpsReq.Req.Unconfirmed.fBufferSize = answer.length;
+        mcpsReq.Req.Unconfirmed.Datarate = mibReq.Param.ChannelsDatarate;
+        prvStartRxWindows();
+        status = LoRaMacMcpsRequest( &mcpsReq );
+
+        if( status == LORAMAC_STATUS_OK )
+        {
+            xPiggyback.frameInFlight = true;
+            xPiggyback.frameEmpty = ( answer.length == 0 );
+            xPiggyback.pending = false;
+            xPiggyback.pendingSinceMs = 0;
+            xPiggyback.stats.fetchFrames++;
+            xRejoin.uplinks++;
+        }
+        else
+        {
+            /* Put back, a busy MAC is retried on its next event, a duty cycle restriction once it allows. */
+            if( answer.length > 0 )
+            {
+                prvSetPackageAnswer( &xPackages[ i - 1 ], answer.data, answer.length );
+            }
+
+            if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+            {
+                nextMs = nowMs + mcpsReq.ReqReturn.DutyCycleWaitTime;
+            }
+        }
+    }
+
+    prvArmTimer( &xPiggybackTimer, &ullPiggybackDeadlineMs, ( nextMs != 0 ) ? nextMs : UINT64_MAX, nowMs );
+}
+
+static LoRaMacStatus_t prvConfigure( void )
+{
+    MibRequestConfirm_t mibReq;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        mibReq.Type = MIB_PUBLIC_NETWORK;
+        mibReq.Param.EnablePublicNetwork = lorawanConfigPUBLIC_NETWORK;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        mibReq.Type = MIB_ADR;
+        mibReq.Param.AdrEnable = lorawanConfigADR_ON;
+        status = LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    #if defined( REGION_EU868 ) || defined( REGION_RU864 ) || defined( REGION_CN779 ) || defined( REGION_EU433 )
+        if( status == LORAMAC_STATUS_OK )
+        {
+            status = LoRaMacTestSetDutyCycleOn( LORAWAN_DUTYCYCLE_ON );
+        }
+    #endif
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        mibReq.Type = MIB_SYSTEM_MAX_RX_ERROR;
+        mibReq.Param.SystemMaxRxError = lorawanConfigRX_MAX_TIMING_ERROR;
+        status = LoRaMacMibSetRequestConfirm( &mibReq );
+        xRxWindows.appliedErrorMs = lorawanConfigRX_MAX_TIMING_ERROR;
+    }
+
+    /* Lowered by prvProcessRxTiming() once the downlinks were measured. */
+    if( ( status == LORAMAC_STATUS_OK ) && ( lorawanConfigRX_TIMING_CALIBRATION == 1 ) )
+    {
+        mibReq.Type = MIB_MIN_RX_SYMBOLS;
+        mibReq.Param.MinRxSymbols = lorawanConfigRX_MIN_SYMBOLS;
+        status = LoRaMacMibSetRequestConfirm( &mibReq );
+        xRxWindows.appliedSymbols = lorawanConfigRX_MIN_SYMBOLS;
+    }
+
+    return status;
+}
+
+
+static LoRaMacStatus_t prvSetOTAACredentials( void )
+{
+    MibRequestConfirm_t mibReq;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    uint8_t devEUI[ LORAWAN_EUI_SIZE ];
+    uint8_t joinEUI[ LORAWAN_EUI_SIZE ];
+    uint8_t appKey[ LORAWAN_KEY_SIZE ];
+
+
+    #ifdef lorawanConfigGET_DEV_EUI
+        if( status == LORAMAC_STATUS_OK )
+        {
+            lorawanConfigGET_DEV_EUI( devEUI );
+            mibReq.Type = MIB_DEV_EUI;
+            mibReq.Param.DevEui = devEUI;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif
+
+    #ifdef lorawanConfigGET_JOIN_EUI
+        if( status == LORAMAC_STATUS_OK )
+        {
+            lorawanConfigGET_JOIN_EUI( joinEUI );
+            mibReq.Type = MIB_JOIN_EUI;
+            mibReq.Param.JoinEui = joinEUI;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif
+
+
+    #ifdef lorawanConfigGET_APP_KEY
+        if( status == LORAMAC_STATUS_OK )
+        {
+            lorawanConfigGET_APP_KEY( appKey );
+            mibReq.Type = MIB_APP_KEY;
+            mibReq.Param.AppKey = appKey;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+
+        if( status == LORAMAC_STATUS_OK )
+        {
+            mibReq.Type = MIB_NWK_KEY;
+            mibReq.Param.AppKey = appKey;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif /* ifdef lorawanConfigGET_APP_KEY */
+
+    return status;
+}
+
+static LoRaMacStatus_t prvSetABPCredentials( void )
+{
+    MibRequestConfirm_t mibReq;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    uint8_t devEUI[ LORAWAN_EUI_SIZE ];
+    uint8_t joinEUI[ LORAWAN_EUI_SIZE ];
+    uint8_t appsKey[ LORAWAN_KEY_SIZE ];
+    uint8_t nwsKey[ LORAWAN_KEY_SIZE ];
+
+    #ifdef lorawanConfigGET_DEV_EUI
+        if( status == LORAMAC_STATUS_OK )
+        {
+            lorawanConfigGET_DEV_EUI( devEUI );
+            mibReq.Type = MIB_DEV_EUI;
+            mibReq.Param.DevEui = devEUI;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif
+
+    #ifdef lorawanConfigGET_JOIN_EUI
+        if( status == LORAMAC_STATUS_OK )
+        {
+            lorawanConfigGET_JOIN_EUI( joinEUI );
+            mibReq.Type = MIB_JOIN_EUI;
+            mibReq.Param.JoinEui = joinEUI;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif
+
+    /* Tell the MAC layer which network server version are we connecting too. */
+    if( status == LORAMAC_STATUS_OK )
+    {
+        mibReq.Type = MIB_ABP_LORAWAN_VERSION;
+        mibReq.Param.AbpLrWanVersion.Value = lorawanConfigABP_LORAWAN_VERSION;
+        status = LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        mibReq.Type = MIB_NET_ID;
+        mibReq.Param.NetID = lorawanConfigNETWORK_ID;
+        status = LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    #ifdef lorawanConfigGET_DEV_ADDR
+        if( status == LORAMAC_STATUS_OK )
+        {
+            mibReq.Type = MIB_DEV_ADDR;
+            mibReq.Param.DevAddr = lorawanConfigGET_DEV_ADDR();
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif
+
+    #ifdef lorawanConfigGET_APP_SESSION_KEY
+        if( status == LORAMAC_STATUS_OK )
+        {
+            lorawanConfigGET_APP_SESSION_KEY( appsKey );
+            mibReq.Type = MIB_APP_S_KEY;
+            mibReq.Param.AppSKey = appsKey;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif
+
+    #ifdef lorawanConfigGET_NETWORK_SESSION_KEY
+        if( status == LORAMAC_STATUS_OK )
+        {
+            lorawanConfigGET_NETWORK_SESSION_KEY( nwsKey );
+            mibReq.Type = MIB_NWK_S_ENC_KEY;
+            mibReq.Param.NwkSEncKey = nwsKey;
+            status = LoRaMacMibSetRequestConfirm( &mibReq );
+        }
+    #endif
+
+    return status;
+}
+
+
+static uint8_t prvGetBatteryLevel( void )
+{
+    return 0;
+}
+
+/* Used by LoRaMAC to compensate the beacon and ping slot periods of class B through TimerTempCompensation(). */
+static float prvGetTemperatureLevel( void )
+{
+    return prvGetTemperature();
+}
+
+/* Samples the temperature once per period, the correction of the time base up to now uses the previous sample. */
+static void prvProcessTemperature( void )
+{
+    #ifdef lorawanConfigGET_TEMPERATURE
+        float temperature;
+        uint64_t crystalMs = prvGetCrystalTimeMs();
+
+        if( ( lorawanConfigTEMP_COMPENSATION == 0 ) || ( crystalMs < ullNextTemperatureMs ) )
+        {
+            return;
+        }
+
+        if( lorawanConfigGET_TEMPERATURE( &temperature ) == true )
+        {
+            taskENTER_CRITICAL();
+            TempComp_AddSample( &xTempComp, temperature, crystalMs );
+            taskEXIT_CRITICAL();
+        }
+
+        ullNextTemperatureMs = crystalMs + ( lorawanConfigTEMP_SAMPLE_PERIOD_SEC * 1000ULL );
+        TimerStop( &xTemperatureTimer );
+        TimerSetValue( &xTemperatureTimer, lorawanConfigTEMP_SAMPLE_PERIOD_SEC * 1000UL );
+        TimerStart( &xTemperatureTimer );
+    #endif /* ifdef lorawanConfigGET_TEMPERATURE */
+}
+
+static void prvOnMacNotify( void )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    if( xPortIsInsideInterrupt() )
+    {
+        xTaskNotifyAndQueryFromISR( xLoRaMacTask, LORAWAN_EVENT_MAC_PENDING, eSetBits, NULL, &xHigherPriorityTaskWoken );
+        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+    }
+    else
+    {
+        xTaskNotifyAndQuery( xLoRaMacTask, LORAWAN_EVENT_MAC_PENDING, eSetBits, NULL );
+    }
+}
+
+static void prvOnMulticastTimer( void * context )
+{
+    ( void ) context;
+
+    prvOnMacNotify();
+}
+
+static void prvOnFragStatusTimer( void * context )
+{
+    ( void ) context;
+
+    prvOnMacNotify();
+}
+
+static void prvOnRejoinTimer( void * context )
+{
+    ( void ) context;
+
+    prvOnMacNotify();
+}
+
+static void prvOnTemperatureTimer( void * context )
+{
+    ( void ) context;
+
+    prvOnMacNotify();
+}
+
+static void prvOnPiggybackTimer( void * context )
+{
+    ( void ) context;
+
+    prvOnMacNotify();
+}
+
+static void prvOnRadioNotify()
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    xTaskNotifyAndQueryFromISR( xLoRaMacTask, LORAWAN_EVENT_RADIO_PENDING, eSetBits, NULL, &xHigherPriorityTaskWoken );
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+/* Runs the steps of the commands of the application tasks, in the order they were sent. */
+static void prvProcessCommands( void )
+{
+    LoRaWANCommand_t * pCommand;
+
+    while( xQueueReceive( xCommandQueue, &pCommand, 0 ) == pdTRUE )
+    {
+        pCommand->status = pCommand->step( pCommand );
+        ( void ) xSemaphoreGive( pCommand->token );
+    }
+}
+
+static void prvLoRaMACTask( void * pvParameters )
+{
+    uint32_t ulNotifiedValue;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        xTaskNotifyWait( 0x00, ULONG_MAX, &ulNotifiedValue, portMAX_DELAY );
+
+        if( ulNotifiedValue & LORAWAN_EVENT_RADIO_PENDING )
+        {
+            /* Process Radio IRQ. */
+            if( Radio.IrqProcess != NULL )
+            {
+                Radio.IrqProcess();
+            }
+
+            /*Process Lora mac events based on Radio events. */
+            LoRaMacProcess();
+        }
+        else if( ulNotifiedValue & LORAWAN_EVENT_MAC_PENDING )
+        {
+            /*Process events generated from LoRaMAC. */
+            LoRaMacProcess();
+        }
+
+        if( ulNotifiedValue & LORAWAN_EVENT_COMMAND_PENDING )
+        {
+            prvProcessCommands();
+        }
+
+        prvProcessRemoteMulticastSetup();
+        prvProcessFragmentation();
+        prvProcessMulticastSessions();
+        prvProcessDeviceClass();
+        prvProcessRejoin();
+        prvProcessPiggyback();
+        prvProcessRxTiming();
+        prvProcessTemperature();
+    }
+
+    vTaskDelete( NULL );
+}
+
+LoRaMacStatus_t LoRaWAN_Init( LoRaMacRegion_t region )
+{
+    LoRaMacStatus_t status;
+    size_t xFreeHeapBytes = xPortGetFreeHeapSize();
+
+    memset( &xLoRaMacPrimitives, 0x00, sizeof( LoRaMacPrimitives_t ) );
+    memset( &xLoRaMacCallbacks, 0x00, sizeof( LoRaMacCallback_t ) );
+
+    xLoRaMacPrimitives.MacMcpsConfirm = prvMcpsConfirm;
+    xLoRaMacPrimitives.MacMcpsIndication = prvMcpsIndication;
+    xLoRaMacPrimitives.MacMlmeConfirm = prvMlmeConfirm;
+    xLoRaMacPrimitives.MacMlmeIndication = prvMlmeIndication;
+
+
+    xLoRaMacCallbacks.GetBatteryLevel = prvGetBatteryLevel;
+    xLoRaMacCallbacks.GetTemperatureLevel = prvGetTemperatureLevel;
+    xLoRaMacCallbacks.MacProcessNotify = prvOnMacNotify;
+
+    TimerInit( &xMulticastTimer, prvOnMulticastTimer );
+    TimerInit( &xFragStatusTimer, prvOnFragStatusTimer );
+    TimerInit( &xRejoinTimer, prvOnRejoinTimer );
+    TimerInit( &xPiggybackTimer, prvOnPiggybackTimer );
+    TimerInit( &xTemperatureTimer, prvOnTemperatureTimer );
+
+    xPackages[ LORAWAN_PACKAGE_MULTICAST ].port = lorawanConfigREMOTE_MULTICAST_SETUP_PORT;
+    xPackages[ LORAWAN_PACKAGE_FRAGMENTATION ].port = lorawanConfigFRAGMENTATION_PORT;
+    LinkQuality_Init( &xLinkQuality );
+    memset( &xRetransmit, 0, sizeof( xRetransmit ) );
+    memset( &xRxWindows, 0, sizeof( xRxWindows ) );
+    RxTiming_Init( &xRxWindows.timing );
+    TempComp_Init( &xTempComp, prvGetCrystalTimeMs() );
+    ullNextTemperatureMs = 0;
+    prvProcessTemperature();
+
+    status = LoRaMacInitialization( &xLoRaMacPrimitives, &xLoRaMacCallbacks, region );
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        status = prvConfigure();
+
+        if( status != LORAMAC_STATUS_OK )
+        {
+            configPRINTF( ( "LoRa MAC default configuration failed, status = %d.\n", status ) );
+        }
+    }
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        #if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+            xEventQueue = xQueueCreateStatic( lorawanConfigEVENT_QUEUE_SIZE, sizeof( LoRaWANEventInfo_t ),
+                                              ucEventQueueStorage, &xEventQueueBuffer );
+            xCommandQueue = xQueueCreateStatic( lorawanConfigCOMMAND_QUEUE_SIZE, sizeof( LoRaWANCommand_t * ),
+                                                ucCommandQueueStorage, &xCommandQueueBuffer );
+            xDownlinkQueue = xQueueCreateStatic( lorawanConfigDOWNLINK_QUEUE_SIZE, sizeof( LoRaWANMessage_t ),
+                                                 ucDownlinkQueueStorage, &xDownlinkQueueBuffer );
+        #else
+            xEventQueue = xQueueCreate( lorawanConfigEVENT_QUEUE_SIZE, sizeof( LoRaWANEventInfo_t ) );
+            xCommandQueue = xQueueCreate( lorawanConfigCOMMAND_QUEUE_SIZE, sizeof( LoRaWANCommand_t * ) );
+            xDownlinkQueue = xQueueCreate( lorawanConfigDOWNLINK_QUEUE_SIZE, sizeof( LoRaWANMessage_t ) );
+        #endif
+
+        if( ( xEventQueue == NULL ) || ( xCommandQueue == NULL ) || ( xDownlinkQueue == NULL ) )
+        {
+            status = LORAMAC_STATUS_ERROR;
+        }
+        else
+        {
+            TaskMonitor_AddQueue( xEventQueue, "events" );
+            TaskMonitor_AddQueue( xCommandQueue, "commands" );
+            TaskMonitor_AddQueue( xDownlinkQueue, "downlinks" );
+
+            memset( xSubscriptions, 0, sizeof( xSubscriptions ) );
+            memset( &xAnyPortSubscription, 0, sizeof( xAnyPortSubscription ) );
+            xAnyPortSubscription.used = true;
+            xAnyPortSubscription.queue = xDownlinkQueue;
+
+            xEventCallback = NULL;
+            pvEventCallbackContext = NULL;
+            ulEventMask = 0;
+            xEventGroup = NULL;
+        }
+    }
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        #if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+            xLoRaMacTask = xTaskCreateStatic( prvLoRaMACTask, "LoRaMac", lorawanConfigLORAMAC_TASK_STACK_SIZE, NULL,
+                                              lorawanConfigLORAMAC_TASK_PRIORITY, xLoRaMacTaskStack, &xLoRaMacTaskBuffer );
+        #else
+            if( xTaskCreate( prvLoRaMACTask, "LoRaMac", lorawanConfigLORAMAC_TASK_STACK_SIZE, NULL, lorawanConfigLORAMAC_TASK_PRIORITY, &xLoRaMacTask ) != pdTRUE )
+            {
+                xLoRaMacTask = NULL;
+            }
+        #endif
+
+        if( xLoRaMacTask != NULL )
+        {
+            if( Radio.SetEventNotify != NULL )
+            {
+                Radio.SetEventNotify( &prvOnRadioNotify );
+            }
+        }
+        else
+        {
+            configPRINTF( ( "LoRaMAC loop task creation failed.\r\n" ) );
+            status = LORAMAC_STATUS_ERROR;
+        }
+    }
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        status = LoRaMacStart();
+
+        if( status != LORAMAC_STATUS_OK )
+        {
+            configPRINTF( ( "LoRa MAC start failed, status = %d.\n", status ) );
+        }
+    }
+
+    if( ( status == LORAMAC_STATUS_OK ) && ( TaskMonitor_Init() == false ) )
+    {
+        configPRINTF( ( "Task monitor timer creation failed.\r\n" ) );
+    }
+
+    /* Other tasks may allocate meanwhile, this is an upper bound. */
+    xInitHeapBytes = ( xFreeHeapBytes > xPortGetFreeHeapSize() ) ? ( xFreeHeapBytes - xPortGetFreeHeapSize() ) : 0U;
+
+    return status;
+}
+
+
+static LoRaMacStatus_t prvExecActivateByPersonalization( LoRaWANCommand_t * pCommand )
+{
+    MibRequestConfirm_t mibReq;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+
+    ( void ) pCommand;
+
+    status = prvSetABPCredentials();
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        mibReq.Type = MIB_NETWORK_ACTIVATION;
+        mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+        status = LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    return status;
+}
+
+LoRaMacStatus_t LoRaWAN_ActivateByPersonalization( void )
+{
+    return prvCall( prvExecActivateByPersonalization, NULL );
+}
+
+/* Prepares the join request in pArgs, with the credentials configured before each join. */
+static LoRaMacStatus_t prvExecStartJoin( LoRaWANCommand_t * pCommand )
+{
+    MlmeReq_t * pMlmeReq = ( MlmeReq_t * ) pCommand->pArgs;
+    MibRequestConfirm_t mibReq = { 0 };
+    LoRaMacStatus_t status;
+
+    /* A join discards the MAC commands waiting for an uplink, a DeviceTimeReq included. */
+    xTimeSync.requestPending = false;
+    xPiggyback.pending = false;
+
+    /* A slot assigned for the previous session no longer applies, derive it from the new device address. */
+    ulUplinkSlot = LORAWAN_UPLINK_SLOT_FROM_DEV_ADDR;
+
+    /* Joins are done in class A, the requested class is restored once joined. The LoRaMAC task switches right after
+     * this step, before the join is requested. */
+    xClassB.joining = true;
+
+    status = prvSetOTAACredentials();
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        /* Query default data rate for join. */
+        mibReq.Type = MIB_CHANNELS_DEFAULT_DATARATE;
+        status = LoRaMacMibGetRequestConfirm( &mibReq );
+    }
+
+    pMlmeReq->Type = MLME_JOIN;
+    pMlmeReq->Req.Join.Datarate = mibReq.Param.ChannelsDefaultDatarate;
+
+    return status;
+}
+
+/* Requests a join or a Rejoin-Request, whose confirm goes to the command. */
+static LoRaMacStatus_t prvExecJoinRequest( LoRaWANCommand_t * pCommand )
+{
+    MlmeReq_t * pMlmeReq = ( MlmeReq_t * ) pCommand->pArgs;
+    LoRaMacStatus_t status;
+
+    status = LoRaMacMlmeRequest( pMlmeReq );
+    pCommand->dutyCycleWaitMs = pMlmeReq->ReqReturn.DutyCycleWaitTime;
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        pxMlmeWaiter = pCommand;
+    }
+
+    return status;
+}
+
+static LoRaMacStatus_t prvExecJoined( LoRaWANCommand_t * pCommand )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+
+    ( void ) pCommand;
+
+    mibReq.Type = MIB_DEV_ADDR;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    configPRINTF( ( "Device address : %08lX\n", mibReq.Param.DevAddr ) );
+
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    configPRINTF( ( "Data rate : DR_%d\n", mibReq.Param.ChannelsDatarate ) );
+
+    prvStartRejoinPeriods();
+
+    return LORAMAC_STATUS_OK;
+}
+
+static LoRaMacStatus_t prvExecEndJoin( LoRaWANCommand_t * pCommand )
+{
+    ( void ) pCommand;
+
+    /* The LoRaMAC task restores the requested class right after this step. */
+    xClassB.joining = false;
+
+    return LORAMAC_STATUS_OK;
+}
+
+/**
+ * @brief Join to a LORAWAN network using OTAA join mechanism..
+ * Blocks until the configured number of tries are reached or join is successful.
+ */
+
+LoRaMacStatus_t LoRaWAN_Join( void )
+{
+    LoRaWANCommand_t command;
+    LoRaMacStatus_t status;
+    MlmeReq_t mlmeReq = { 0 };
+    uint32_t ulDutyCycleTimeMS = 0U;
+    LoRaMacEventInfoStatus_t responseStatus;
+    size_t xNumTries;
+
+    prvCommandInit( &command );
+    status = prvCommandRun( &command, prvExecStartJoin, &mlmeReq );
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        for( xNumTries = 0; xNumTries < lorawanConfigMAX_JOIN_ATTEMPTS; xNumTries++ )
+        {
+            /**
+             * Initiates the join procedure. If the stack returns a duty cycle restricted error,
+             * then retry after the duty cycle period. Duty cycle errors are not counted
+             * as a failed try.
+             */
+            do
+            {
+                status = prvCommandRun( &command, prvExecJoinRequest, &mlmeReq );
+
+                if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+                {
+                    ulDutyCycleTimeMS = command.dutyCycleWaitMs;
+                    configPRINTF( ( "Duty cycle restriction. Next Join in : ~%lu second(s)\n", ( ulDutyCycleTimeMS / 1000 ) ) );
+                    vTaskDelay( pdMS_TO_TICKS( ulDutyCycleTimeMS ) );
+                }
+            } while( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED );
+
+            if( status == LORAMAC_STATUS_OK )
+            {
+                responseStatus = prvCommandWaitConfirm( &command );
+
+                if( responseStatus == LORAMAC_EVENT_INFO_STATUS_OK )
+                {
+                    configPRINTF( ( "Successfully joined a LoRaWAN network.\n" ) );
+                    ( void ) prvCommandRun( &command, prvExecJoined, NULL );
+                    break;
+                }
+                else
+                {
+                    configPRINTF( ( "Failed to join loRaWAN network with status %d.\n", responseStatus ) );
+                    status = LORAMAC_STATUS_ERROR;
+                }
+            }
+            else
+            {
+                configPRINTF( ( "Failed to initiate a LoRaWAN JOIN request with status %d.\n", status ) );
+                break;
+            }
+
+            if( xNumTries < ( lorawanConfigMAX_JOIN_ATTEMPTS - 1 ) )
+            {
+                ulDutyCycleTimeMS = ( lorawanConfigJOIN_RETRY_INTERVAL_MS ) +
+                                    randr( -lorawanConfigMAX_JITTER_MS, lorawanConfigMAX_JITTER_MS );
+                configPRINTF( ( "Retrying join attempt after %lu seconds.\n", ( ulDutyCycleTimeMS / 1000 ) ) );
+                vTaskDelay( pdMS_TO_TICKS( ulDutyCycleTimeMS ) );
+            }
+        }
+    }
+
+    ( void ) prvCommandRun( &command, prvExecEndJoin, NULL );
+    prvCommandDeinit( &command );
+
+    return status;
+}
+
+/* Sends the Rejoin-Request of LoRaWAN_Rejoin(), whose answer goes to the command. */
+static LoRaMacStatus_t prvExecRejoinRequest( LoRaWANCommand_t * pCommand )
+{
+    LoRaMacStatus_t status;
+
+    xRejoin.pending = true;
+    status = prvRequestRejoin( *( LoRaWANRejoinType_t * ) pCommand->pArgs, &pCommand->dutyCycleWaitMs );
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        pxMlmeWaiter = pCommand;
+    }
+    else
+    {
+        xRejoin.pending = false;
+    }
+
+    return status;
+}
+
+static LoRaMacStatus_t prvExecGetDevAddr( LoRaWANCommand_t * pCommand )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    LoRaMacStatus_t status;
+
+    mibReq.Type = MIB_DEV_ADDR;
+    status = LoRaMacMibGetRequestConfirm( &mibReq );
+    *( uint32_t * ) pCommand->pArgs = mibReq.Param.DevAddr;
+
+    return status;
+}
+
+static LoRaMacStatus_t prvExecEndRejoin( LoRaWANCommand_t * pCommand )
+{
+    ( void ) pCommand;
+
+    /* The periodic Rejoin-Requests resume, prvProcessRejoin() runs right after this step. */
+    xRejoin.blocking = false;
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaWAN_Rejoin( LoRaWANRejoinType_t type )
+{
+    LoRaWANCommand_t command;
+    LoRaMacStatus_t status = LORAMAC_STATUS_ERROR;
+    uint32_t ulDutyCycleTimeMS = 0U;
+    uint32_t devAddr = 0;
+    LoRaMacEventInfoStatus_t responseStatus;
+    size_t xNumTries;
+    bool busy;
+
+    if( type > LORAWAN_REJOIN_TYPE_2 )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    /* The periodic Rejoin-Requests are held off until this one is answered. */
+    taskENTER_CRITICAL();
+    busy = ( xRejoin.pending == true ) || ( xRejoin.blocking == true );
+
+    if( busy == false )
+    {
+        xRejoin.blocking = true;
+        xRejoin.pendingType = type;
+    }
+
+    taskEXIT_CRITICAL();
+
+    if( busy == true )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    prvCommandInit( &command );
+
+    for( xNumTries = 0; xNumTries < lorawanConfigMAX_REJOIN_ATTEMPTS; xNumTries++ )
+    {
+        do
+        {
+            status = prvCommandRun( &command, prvExecRejoinRequest, &type );
+
+            if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+            {
+                ulDutyCycleTimeMS = command.dutyCycleWaitMs;
+                configPRINTF( ( "Duty cycle restriction. Next Rejoin-Request in : ~%lu second(s)\n", ( ulDutyCycleTimeMS / 1000 ) ) );
+                vTaskDelay( pdMS_TO_TICKS( ulDutyCycleTimeMS ) );
+            }
+        } while( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED );
+
+        if( status == LORAMAC_STATUS_OK )
+        {
+            responseStatus = prvCommandWaitConfirm( &command );
+
+            if( responseStatus == LORAMAC_EVENT_INFO_STATUS_OK )
+            {
+                ( void ) prvCommandRun( &command, prvExecGetDevAddr, &devAddr );
+                configPRINTF( ( "Rejoined with a Rejoin-Request of type %d, device address : %08lX\n", type, devAddr ) );
+                break;
+            }
+
+            configPRINTF( ( "Rejoin-Request of type %d not answered, status %d.\n", type, responseStatus ) );
+            status = LORAMAC_STATUS_ERROR;
+        }
+        else
+        {
+            configPRINTF( ( "Failed to initiate a Rejoin-Request with status %d.\n", status ) );
+            break;
+        }
+
+        if( xNumTries < ( lorawanConfigMAX_REJOIN_ATTEMPTS - 1 ) )
+        {
+            ulDutyCycleTimeMS = ( lorawanConfigJOIN_RETRY_INTERVAL_MS ) +
+                                randr( -lorawanConfigMAX_JITTER_MS, lorawanConfigMAX_JITTER_MS );
+            vTaskDelay( pdMS_TO_TICKS( ulDutyCycleTimeMS ) );
+        }
+    }
+
+    ( void ) prvCommandRun( &command, prvExecEndRejoin, NULL );
+    prvCommandDeinit( &command );
+
+    return status;
+}
+
+static LoRaMacStatus_t prvExecSetRejoinParams( LoRaWANCommand_t * pCommand )
+{
+    const LoRaWANRejoinArgs_t * pArgs = ( const LoRaWANRejoinArgs_t * ) pCommand->pArgs;
+
+    taskENTER_CRITICAL();
+    xRejoin.periodic = pArgs->enable;
+    xRejoin.maxTimeN = pArgs->maxTimeN;
+    xRejoin.maxCountN = pArgs->maxCountN;
+    taskEXIT_CRITICAL();
+
+    /* The timer is armed again by prvProcessRejoin(), after the commands. */
+    if( xRejoin.sessionStarted == true )
+    {
+        prvStartRejoinPeriods();
+    }
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaWAN_SetRejoinParams( bool enable,
+                                         uint8_t maxTimeN,
+                                         uint8_t maxCountN )
+{
+    LoRaWANRejoinArgs_t args;
+
+    if( ( maxTimeN > LORAWAN_REJOIN_MAX_N ) || ( maxCountN > LORAWAN_REJOIN_MAX_N ) )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    args.enable = enable;
+    args.maxTimeN = maxTimeN;
+    args.maxCountN = maxCountN;
+
+    return prvCall( prvExecSetRejoinParams, &args );
+}
+
+static LoRaMacStatus_t prvExecGetNetworkParams( LoRaWANCommand_t * pCommand )
+{
+    LoRaWANNetworkParams_t * pNetworkParams = ( LoRaWANNetworkParams_t * ) pCommand->pArgs;
+    MibRequestConfirm_t mibReq = { 0 };
+    LoRaMacStatus_t status;
+    size_t x;
+
+    for( x = 0; x < LORAWAN_NUM_PARAMS; x++ )
+    {
+        memset( &mibReq, 0x00, sizeof( MibRequestConfirm_t ) );
+        mibReq.Type = paramTypes[ x ];
+        status = LoRaMacMibGetRequestConfirm( &mibReq );
+
+        if( status == LORAMAC_STATUS_OK )
+        {
+            switch( paramTypes[ x ] )
+            {
+                case MIB_CHANNELS_DEFAULT_TX_POWER:
+                    pNetworkParams->txPower = mibReq.Param.ChannelsTxPower;
+                    break;
+
+                case MIB_CHANNELS_DEFAULT_DATARATE:
+                    pNetworkParams->dataRate = mibReq.Param.ChannelsDatarate;
+                    break;
+
+                case MIB_RX2_DEFAULT_CHANNEL:
+                    pNetworkParams->rx2Channel = mibReq.Param.Rx2Channel;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return status;
+}
+
+LoRaMacStatus_t LoRaWAN_GetNetworkParams( LoRaWANNetworkParams_t * pNetworkParams )
+{
+    configASSERT( pNetworkParams != NULL );
+
+    return prvCall( prvExecGetNetworkParams, pNetworkParams );
+}
+
+static LoRaMacStatus_t prvExecSetNetworkParams( LoRaWANCommand_t * pCommand )
+{
+    LoRaWANNetworkParams_t * pNetworkParams = ( LoRaWANNetworkParams_t * ) pCommand->pArgs;
+    MibRequestConfirm_t mibReq = { 0 };
+    LoRaMacStatus_t status;
+    size_t x;
+
+    for( x = 0; x < LORAWAN_NUM_PARAMS; x++ )
+    {
+        memset( &mibReq, 0x00, sizeof( MibRequestConfirm_t ) );
+        mibReq.Type = paramTypes[ x ];
+
+        switch( paramTypes[ x ] )
+        {
+            case MIB_CHANNELS_DEFAULT_TX_POWER:
+                mibReq.Param.ChannelsTxPower = pNetworkParams->txPower;
+                break;
+
+            case MIB_CHANNELS_DEFAULT_DATARATE:
+                mibReq.Param.ChannelsDatarate = pNetworkParams->dataRate;
+                break;
+
+            case MIB_RX2_DEFAULT_CHANNEL:
+                mibReq.Param.Rx2Channel = pNetworkParams->rx2Channel;
+                break;
+
+            default:
+                break;
+        }
+
+        status = LoRaMacMibSetRequestConfirm( &mibReq );
+
+        if( status != LORAMAC_STATUS_OK )
+        {
+            break;
+        }
+    }
+
+    return status;
+}
+
+LoRaMacStatus_t LoRaWAN_SetNetworkParams( LoRaWANNetworkParams_t * pNetworkParams )
+{
+    configASSERT( pNetworkParams != NULL );
+
+    return prvCall( prvExecSetNetworkParams, pNetworkParams );
+}
+
+
+static LoRaMacStatus_t prvExecSetAdaptiveDataRate( LoRaWANCommand_t * pCommand )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    bool enable = *( bool * ) pCommand->pArgs;
+
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = enable;
+
+    /* The network ADR and the device side rate adaptation would fight over the data rate. */
+    if( enable == true )
+    {
+        xRateAdaptEnabled = false;
+    }
+
+    return LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+LoRaMacStatus_t LoRaWAN_SetAdaptiveDataRate( bool enable )
+{
+    return prvCall( prvExecSetAdaptiveDataRate, &enable );
+}
+
+static LoRaMacStatus_t prvExecSetRateAdaptation( LoRaWANCommand_t * pCommand )
+{
+    MibRequestConfirm_t mibReq = { 0 };
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    uint8_t dataRate;
+    bool enable = *( bool * ) pCommand->pArgs;
+
+    if( enable == true )
+    {
+        status = LoRaWAN_SetAdaptiveDataRate( false );
 
-    #ifdef lorawanConfigGET_NETWORK_SESSION_KEY
         if( status == LORAMAC_STATUS_OK )
         {
-            lorawanConfigGET_NETWORK_SESSION_KEY( nwsKey );
-            mibReq.Type = MIB_NWK_S_ENC_KEY;
-            mibReq.Param.NwkSEncKey = nwsKey;
-            status = LoRaMacMibSetRequestConfirm( &mibReq );
+            /* Starts from the current settings, the first uplink measures the margin. */
+            mibReq.Type = MIB_CHANNELS_DATARATE;
+            LoRaMacMibGetRequestConfirm( &mibReq );
+            dataRate = ( uint8_t ) mibReq.Param.ChannelsDatarate;
+            mibReq.Type = MIB_CHANNELS_TX_POWER;
+            LoRaMacMibGetRequestConfirm( &mibReq );
+
+            taskENTER_CRITICAL();
+            RateAdapt_Init( &xRateAdapt, dataRate, ( uint8_t ) mibReq.Param.ChannelsTxPower );
+            taskEXIT_CRITICAL();
         }
-    #endif
+    }
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        xRateAdaptEnabled = enable;
+    }
 
     return status;
 }
 
+LoRaMacStatus_t LoRaWAN_SetRateAdaptation( bool enable )
+{
+    return prvCall( prvExecSetRateAdaptation, &enable );
+}
 
-static uint8_t prvGetBatteryLevel( void )
+
+static LoRaMacStatus_t prvExecSetDeviceClass( LoRaWANCommand_t * pCommand )
 {
-    return 0;
+    /* The switch is done by the LoRaMAC task after the commands, see prvProcessDeviceClass(). */
+    xClassB.requestedClass = *( DeviceClass_t * ) pCommand->pArgs;
+
+    return LORAMAC_STATUS_OK;
 }
 
-static void prvOnMacNotify( void )
+LoRaMacStatus_t LoRaWAN_SetDeviceClass( DeviceClass_t deviceClass )
 {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    if( xPortIsInsideInterrupt() )
+    if( ( deviceClass != CLASS_A ) && ( deviceClass != CLASS_B ) && ( deviceClass != CLASS_C ) )
     {
-        xTaskNotifyAndQueryFromISR( xLoRaMacTask, LORAWAN_EVENT_MAC_PENDING, eSetBits, NULL, &xHigherPriorityTaskWoken );
-        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        return LORAMAC_STATUS_PARAMETER_INVALID;
     }
-    else
+
+    return prvCall( prvExecSetDeviceClass, &deviceClass );
+}
+
+static LoRaMacStatus_t prvExecRequestDeviceTimeSync( LoRaWANCommand_t * pCommand )
+{
+    MlmeReq_t mlmeReq = { 0 };
+    LoRaMacStatus_t status;
+
+    ( void ) pCommand;
+
+    mlmeReq.Type = MLME_DEVICE_TIME;
+    status = LoRaMacMlmeRequest( &mlmeReq );
+
+    if( status == LORAMAC_STATUS_OK )
     {
-        xTaskNotifyAndQuery( xLoRaMacTask, LORAWAN_EVENT_MAC_PENDING, eSetBits, NULL );
+        xTimeSync.requestPending = true;
     }
+
+    return status;
 }
 
-static void prvOnRadioNotify()
+LoRaMacStatus_t LoRaWAN_RequestDeviceTimeSync( void )
 {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    xTaskNotifyAndQueryFromISR( xLoRaMacTask, LORAWAN_EVENT_RADIO_PENDING, eSetBits, NULL, &xHigherPriorityTaskWoken );
-    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+    return prvCall( prvExecRequestDeviceTimeSync, NULL );
 }
 
-static void prvLoRaMACTask( void * pvParameters )
+LoRaMacStatus_t LoRaWAN_GetGpsTime( LoRaWANGpsTime_t * pGpsTime )
 {
-    uint32_t ulNotifiedValue;
-
-    ( void ) pvParameters;
+    LoRaMacStatus_t status = LORAMAC_STATUS_ERROR;
+    uint64_t localMs = prvGetLocalTimeMs();
 
-    for( ; ; )
-    {
-        xTaskNotifyWait( 0x00, ULONG_MAX, &ulNotifiedValue, portMAX_DELAY );
+    configASSERT( pGpsTime != NULL );
 
-        if( ulNotifiedValue & LORAWAN_EVENT_RADIO_PENDING )
-        {
-            /* Process Radio IRQ. */
-            if( Radio.IrqProcess != NULL )
-            {
-                Radio.IrqProcess();
-            }
+    taskENTER_CRITICAL();
 
-            /*Process Lora mac events based on Radio events. */
-            LoRaMacProcess();
-        }
-        else if( ulNotifiedValue & LORAWAN_EVENT_MAC_PENDING )
-        {
-            /*Process events generated from LoRaMAC. */
-            LoRaMacProcess();
-        }
+    if( xTimeSync.synchronized == true )
+    {
+        pGpsTime->gpsTimeMs = prvGetGpsTimeMs( localMs );
+        pGpsTime->errorBoundMs = prvGetErrorBoundMs( localMs );
+        pGpsTime->driftPpm = xTimeSync.driftPpm;
+        pGpsTime->syncCount = xTimeSync.syncCount;
+        status = LORAMAC_STATUS_OK;
     }
 
-    vTaskDelete( NULL );
+    taskEXIT_CRITICAL();
+
+    return status;
 }
 
-LoRaMacStatus_t LoRaWAN_Init( LoRaMacRegion_t region )
+
+static LoRaMacStatus_t prvExecSetUplinkSlot( LoRaWANCommand_t * pCommand )
 {
-    LoRaMacStatus_t status;
+    ulUplinkSlot = *( uint32_t * ) pCommand->pArgs;
 
-    memset( &xLoRaMacPrimitives, 0x00, sizeof( LoRaMacPrimitives_t ) );
-    memset( &xLoRaMacCallbacks, 0x00, sizeof( LoRaMacCallback_t ) );
+    return LORAMAC_STATUS_OK;
+}
 
-    xLoRaMacPrimitives.MacMcpsConfirm = prvMcpsConfirm;
-    xLoRaMacPrimitives.MacMcpsIndication = prvMcpsIndication;
-    xLoRaMacPrimitives.MacMlmeConfirm = prvMlmeConfirm;
-    xLoRaMacPrimitives.MacMlmeIndication = prvMlmeIndication;
+void LoRaWAN_SetUplinkSlot( uint32_t slot )
+{
+    ( void ) prvCall( prvExecSetUplinkSlot, &slot );
+}
 
+LoRaMacStatus_t LoRaWAN_GetUplinkSlotDelay( uint32_t periodMs,
+                                            uint32_t * pDelayMs )
+{
+    LoRaMacStatus_t status = LORAMAC_STATUS_ERROR;
+    uint64_t localMs = prvGetLocalTimeMs();
+    uint64_t gpsMs = 0;
+    uint32_t errorBoundMs = 0;
+    uint32_t slot = ulUplinkSlot;
+    uint32_t slotCount;
+    uint32_t txOffsetMs;
 
-    xLoRaMacCallbacks.GetBatteryLevel = prvGetBatteryLevel;
-    xLoRaMacCallbacks.MacProcessNotify = prvOnMacNotify;
+    configASSERT( pDelayMs != NULL );
+    configASSERT( periodMs > 0 );
 
-    status = LoRaMacInitialization( &xLoRaMacPrimitives, &xLoRaMacCallbacks, region );
+    taskENTER_CRITICAL();
 
-    if( status == LORAMAC_STATUS_OK )
+    if( xTimeSync.synchronized == true )
     {
-        status = prvConfigure();
+        gpsMs = prvGetGpsTimeMs( localMs );
+        errorBoundMs = prvGetErrorBoundMs( localMs );
+        status = LORAMAC_STATUS_OK;
+    }
 
-        if( status != LORAMAC_STATUS_OK )
-        {
-            configPRINTF( ( "LoRa MAC default configuration failed, status = %d.\n", status ) );
-        }
+    taskEXIT_CRITICAL();
+
+    if( ( status == LORAMAC_STATUS_OK ) && ( slot == LORAWAN_UPLINK_SLOT_FROM_DEV_ADDR ) )
+    {
+        status = prvCall( prvExecGetDevAddr, &slot );
     }
 
     if( status == LORAMAC_STATUS_OK )
     {
-        xEventQueue = xQueueCreate( lorawanConfigEVENT_QUEUE_SIZE, sizeof( LoRaWANEventInfo_t ) );
-        xResponseQueue = xQueueCreate( lorawanConfigRESPONSE_QUEUE_SIZE, sizeof( LoRaMacEventInfoStatus_t ) );
-        xDownlinkQueue = xQueueCreate( lorawanConfigDOWNLINK_QUEUE_SIZE, sizeof( LoRaWANMessage_t ) );
+        slotCount = periodMs / lorawanConfigUPLINK_SLOT_MS;
 
-        if( ( xEventQueue == NULL ) || ( xResponseQueue == NULL ) || ( xDownlinkQueue == NULL ) )
+        if( slotCount == 0 )
         {
-            status = LORAMAC_STATUS_ERROR;
+            slotCount = 1;
         }
-    }
 
-    if( status == LORAMAC_STATUS_OK )
-    {
-        if( xTaskCreate( prvLoRaMACTask, "LoRaMac", lorawanConfigLORAMAC_TASK_STACK_SIZE, NULL, lorawanConfigLORAMAC_TASK_PRIORITY, &xLoRaMacTask ) == pdTRUE )
+        /* Start late by the error bound so the uplink stays within the slot, as long as it is smaller than half the slot. */
+        if( errorBoundMs > ( lorawanConfigUPLINK_SLOT_MS / 2 ) )
         {
-            if( Radio.SetEventNotify != NULL )
-            {
-                Radio.SetEventNotify( &prvOnRadioNotify );
-            }
+            errorBoundMs = lorawanConfigUPLINK_SLOT_MS / 2;
         }
-        else
+
+        txOffsetMs = ( ( slot % slotCount ) * lorawanConfigUPLINK_SLOT_MS ) + errorBoundMs;
+        *pDelayMs = ( uint32_t ) ( ( ( uint64_t ) txOffsetMs + periodMs - ( gpsMs % periodMs ) ) % periodMs );
+
+        if( *pDelayMs == 0 )
         {
-            configPRINTF( ( "LoRaMAC loop task creation failed.\r\n" ) );
-            status = LORAMAC_STATUS_ERROR;
+            *pDelayMs = periodMs;
         }
     }
 
+    return status;
+}
+
+
+static LoRaMacStatus_t prvExecRequestLinkCheck( LoRaWANCommand_t * pCommand )
+{
+    MlmeReq_t mlmeReq = { 0 };
+
+    ( void ) pCommand;
+
+    mlmeReq.Type = MLME_LINK_CHECK;
+    return LoRaMacMlmeRequest( &mlmeReq );
+}
+
+LoRaMacStatus_t LoRaWAN_RequestLinkCheck( void )
+{
+    return prvCall( prvExecRequestLinkCheck, NULL );
+}
+
+void LoRaWAN_GetLinkStats( LinkQualityStats_t * pStats )
+{
+    taskENTER_CRITICAL();
+    LinkQuality_GetStats( &xLinkQuality, pStats );
+    taskEXIT_CRITICAL();
+}
+
+static LoRaMacStatus_t prvExecAddMulticastGroup( LoRaWANCommand_t * pCommand )
+{
+    const LoRaWANMulticastGroup_t * pGroup = ( const LoRaWANMulticastGroup_t * ) pCommand->pArgs;
+    LoRaWANMulticast_t * pMulticast;
+    LoRaMacStatus_t status;
+    uint8_t rxStatus;
+
+    if( ( pGroup == NULL ) || ( pGroup->groupId >= LORAWAN_MAX_MULTICAST_GROUPS ) ||
+        ( ( pGroup->deviceClass != CLASS_B ) && ( pGroup->deviceClass != CLASS_C ) ) )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    pMulticast = &xMulticast[ pGroup->groupId ];
+    memset( pMulticast, 0, sizeof( LoRaWANMulticast_t ) );
+    pMulticast->address = pGroup->address;
+    memcpy( pMulticast->keys[ 0 ], pGroup->appSessionKey, LORAWAN_KEY_SIZE );
+    memcpy( pMulticast->keys[ 1 ], pGroup->nwkSessionKey, LORAWAN_KEY_SIZE );
+    pMulticast->minFCnt = pGroup->minFCnt;
+    pMulticast->maxFCnt = pGroup->maxFCnt;
+    pMulticast->groupClass = pGroup->deviceClass;
+    pMulticast->sessionClass = CLASS_A;
+
+    if( pGroup->deviceClass == CLASS_B )
+    {
+        pMulticast->rxParams.ClassB.Periodicity = pGroup->periodicity;
+        pMulticast->rxParams.ClassB.Frequency = pGroup->frequency;
+        pMulticast->rxParams.ClassB.Datarate = pGroup->dataRate;
+    }
+    else
+    {
+        pMulticast->rxParams.ClassC.Frequency = pGroup->frequency;
+        pMulticast->rxParams.ClassC.Datarate = pGroup->dataRate;
+    }
+
+    status = prvSetupMulticastChannel( pGroup->groupId );
+
     if( status == LORAMAC_STATUS_OK )
     {
-        status = LoRaMacStart();
+        rxStatus = pGroup->groupId;
+        ( void ) LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t ) ( MULTICAST_0_ADDR + pGroup->groupId ), &pMulticast->rxParams, &rxStatus );
+
+        /* Error bits of McClassXSessionAns. */
+        switch( rxStatus & 0x0CU )
+        {
+            case 0x00U:
+                break;
+
+            case 0x04U:
+                status = LORAMAC_STATUS_DATARATE_INVALID;
+                break;
+
+            case 0x08U:
+                status = LORAMAC_STATUS_FREQUENCY_INVALID;
+                break;
+
+            default:
+                status = LORAMAC_STATUS_FREQ_AND_DR_INVALID;
+                break;
+        }
 
         if( status != LORAMAC_STATUS_OK )
         {
-            configPRINTF( ( "LoRa MAC start failed, status = %d.\n", status ) );
+            ( void ) LoRaMacMcChannelDelete( ( AddressIdentifier_t ) ( MULTICAST_0_ADDR + pGroup->groupId ) );
         }
     }
 
+    pMulticast->defined = ( status == LORAMAC_STATUS_OK );
+
     return status;
 }
 
+LoRaMacStatus_t LoRaWAN_AddMulticastGroup( const LoRaWANMulticastGroup_t * pGroup )
+{
+    return prvCall( prvExecAddMulticastGroup, ( void * ) pGroup );
+}
 
-LoRaMacStatus_t LoRaWAN_ActivateByPersonalization( void )
+static LoRaMacStatus_t prvExecRemoveMulticastGroup( LoRaWANCommand_t * pCommand )
 {
-    MibRequestConfirm_t mibReq;
-    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    uint8_t groupId = *( uint8_t * ) pCommand->pArgs;
 
-    status = prvSetABPCredentials();
+    if( ( groupId >= LORAWAN_MAX_MULTICAST_GROUPS ) || ( xMulticast[ groupId ].defined == false ) )
+    {
+        return LORAMAC_STATUS_MC_GROUP_UNDEFINED;
+    }
 
-    if( status == LORAMAC_STATUS_OK )
+    memset( &xMulticast[ groupId ], 0, sizeof( LoRaWANMulticast_t ) );
+    xMulticast[ groupId ].sessionClass = CLASS_A;
+    prvOnMacNotify();
+
+    return LoRaMacMcChannelDelete( ( AddressIdentifier_t ) ( MULTICAST_0_ADDR + groupId ) );
+}
+
+LoRaMacStatus_t LoRaWAN_RemoveMulticastGroup( uint8_t groupId )
+{
+    return prvCall( prvExecRemoveMulticastGroup, &groupId );
+}
+
+static LoRaMacStatus_t prvExecSetDataBlockStorage( LoRaWANCommand_t * pCommand )
+{
+    pxDataBlockStorage = ( const FragDecoderStorage_t * ) pCommand->pArgs;
+
+    return LORAMAC_STATUS_OK;
+}
+
+void LoRaWAN_SetDataBlockStorage( const FragDecoderStorage_t * pStorage )
+{
+    /* Runs right away when called before LoRaWAN_Init(), as the boards do. */
+    ( void ) prvCall( prvExecSetDataBlockStorage, ( void * ) pStorage );
+}
+
+static LoRaMacStatus_t prvExecActivateDataBlock( LoRaWANCommand_t * pCommand )
+{
+    uint32_t blockSize = ( ( uint32_t ) xFragDecoder.nbFrag * xFragDecoder.fragSize ) - xFragSession.padding;
+
+    ( void ) pCommand;
+
+    if( ( xFragSession.verified == false ) || ( pxDataBlockStorage == NULL ) || ( pxDataBlockStorage->activate == NULL ) ||
+        ( pxDataBlockStorage->activate( blockSize - 4 ) == false ) )
     {
-        mibReq.Type = MIB_NETWORK_ACTIVATION;
-        mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
-        status = LoRaMacMibSetRequestConfirm( &mibReq );
+        return LORAMAC_STATUS_ERROR;
     }
 
-    return status;
+    return LORAMAC_STATUS_OK;
 }
 
-/**
- * @brief Join to a LORAWAN network using OTAA join mechanism..
- * Blocks until the configured number of tries are reached or join is successful.
- */
+LoRaMacStatus_t LoRaWAN_ActivateDataBlock( void )
+{
+    return prvCall( prvExecActivateDataBlock, NULL );
+}
 
-LoRaMacStatus_t LoRaWAN_Join( void )
+/* Returns the transmissions needed for a message to get through with the given reliability, in percent. */
+static uint8_t prvGetTransmissions( float errorRate,
+                                    uint8_t reliability,
+                                    uint8_t maxTransmissions )
 {
-    LoRaMacStatus_t status;
+    float lossTarget = 1.0f - ( ( float ) reliability / 100.0f );
+    float loss = errorRate;
+    uint8_t transmissions = 1;
+
+    while( ( loss > lossTarget ) && ( transmissions < maxTransmissions ) )
+    {
+        loss *= errorRate;
+        transmissions++;
+    }
+
+    return transmissions;
+}
+
+/*
+ * Sets up the uplink in pArgs, its data rate and repetitions, and requests it, whose confirm goes to the command. Both are
+ * done in one step so that the uplink of another task cannot change the settings in between. The repetitions raised are
+ * restored by the confirm, or here if the request is refused. The rate adaptation counts the uplink once, at its first
+ * attempt.
+ */
+static LoRaMacStatus_t prvExecRequestSend( LoRaWANCommand_t * pCommand )
+{
+    LoRaWANSend_t * pSend = ( LoRaWANSend_t * ) pCommand->pArgs;
+    LoRaWANMessage_t * pMessage = pSend->pMessage;
+    LoRaWANPackage_t * pPackage = NULL;
+    McpsReq_t * pMcpsReq = &pSend->mcpsReq;
+    bool confirmed = pSend->confirmed;
     MlmeReq_t mlmeReq = { 0 };
     MibRequestConfirm_t mibReq = { 0 };
-    uint32_t ulDutyCycleTimeMS = 0U;
-    LoRaMacEventInfoStatus_t responseStatus;
-    size_t xNumTries;
+    LoRaMacTxInfo_t txInfo;
+    LoRaMacStatus_t status;
+    uint8_t reliability = ( pMessage->reliability == 0U ) ? lorawanConfigDEFAULT_RELIABILITY : pMessage->reliability;
+    uint8_t nbTrials = lorawanConfigMAX_SEND_RETRIES;
+    uint16_t samples;
+    float errorRate;
+    uint8_t i;
+
+    /* The uplink of another task is in flight, its settings must be left alone. */
+    if( pxMcpsWaiter != NULL )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
 
-    /* Configure the credentials before each join operation. */
-    status = prvSetOTAACredentials();
+    /* So is the frame of the LoRaMAC task, whose repetitions and data rate are read by LoRaMAC until it is over. */
+    pSend->frameInFlight = xPiggyback.frameInFlight;
 
-    if( status == LORAMAC_STATUS_OK )
+    if( pSend->frameInFlight == true )
     {
-        /* Query default data rate for join. */
-        mibReq.Type = MIB_CHANNELS_DEFAULT_DATARATE;
-        status = LoRaMacMibGetRequestConfirm( &mibReq );
+        return LORAMAC_STATUS_BUSY;
     }
 
-    if( status == LORAMAC_STATUS_OK )
+    if( pSend->answers == true )
     {
-        mlmeReq.Type = MLME_JOIN;
-        mlmeReq.Req.Join.Datarate = mibReq.Param.ChannelsDefaultDatarate;
+        pPackage = prvTakeAnyPackageAnswer( pMessage, &pSend->answersLeft );
 
-        for( xNumTries = 0; xNumTries < lorawanConfigMAX_JOIN_ATTEMPTS; xNumTries++ )
+        if( pPackage == NULL )
         {
-            /**
-             * Initiates the join procedure. If the stack returns a duty cycle restricted error,
-             * then retry after the duty cycle period. Duty cycle errors are not counted
-             * as a failed try.
-             */
-            do
+            /* None left, or a frame of the LoRaMAC task took them meanwhile. */
+            return LORAMAC_STATUS_OK;
+        }
+
+        confirmed = confirmed && ( pSend->answersLeft == false );
+    }
+
+    if( pSend->attempted == false )
+    {
+        pSend->attempted = true;
+        pSend->dataRate = ( int8_t ) pMessage->dataRate;
+
+        if( xRateAdaptEnabled == true )
+        {
+            taskENTER_CRITICAL();
+            pSend->linkCheck = RateAdapt_OnUplink( &xRateAdapt );
+            pSend->dataRate = ( int8_t ) xRateAdapt.dataRate;
+            pSend->txPower = xRateAdapt.txPower;
+            taskEXIT_CRITICAL();
+
+            /* The LinkCheckReq rides on this uplink, its answer measures the margin at these settings. */
+            if( pSend->linkCheck == true )
             {
-                status = LoRaMacMlmeRequest( &mlmeReq );
+                mlmeReq.Type = MLME_LINK_CHECK;
 
-                if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+                if( LoRaMacMlmeRequest( &mlmeReq ) != LORAMAC_STATUS_OK )
                 {
-                    ulDutyCycleTimeMS = mlmeReq.ReqReturn.DutyCycleWaitTime;
-                    configPRINTF( ( "Duty cycle restriction. Next Join in : ~%lu second(s)\n", ( ulDutyCycleTimeMS / 1000 ) ) );
-                    vTaskDelay( pdMS_TO_TICKS( ulDutyCycleTimeMS ) );
+                    taskENTER_CRITICAL();
+                    xRateAdapt.probePending = false;
+                    taskEXIT_CRITICAL();
                 }
-            } while( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED );
+            }
+        }
+    }
 
-            if( status == LORAMAC_STATUS_OK )
+    if( xRateAdaptEnabled == true )
+    {
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        mibReq.Param.ChannelsDatarate = pSend->dataRate;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+        mibReq.Type = MIB_CHANNELS_TX_POWER;
+        mibReq.Param.ChannelsTxPower = ( int8_t ) pSend->txPower;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    /* The repetitions set by the network are only ever raised, and restored once the uplink is sent. */
+    taskENTER_CRITICAL();
+    errorRate = LinkQuality_GetErrorRate( &xLinkQuality, &samples );
+    taskEXIT_CRITICAL();
+
+    mibReq.Type = MIB_CHANNELS_NB_TRANS;
+    pSend->networkNbTrans = ( LoRaMacMibGetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK ) ? mibReq.Param.ChannelsNbTrans : 1U;
+    pSend->networkNbTrans = ( pSend->networkNbTrans == 0U ) ? 1U : pSend->networkNbTrans;
+    pSend->nbTrans = pSend->networkNbTrans;
+
+    if( ( lorawanConfigADAPTIVE_RETRANSMISSION != 0 ) && ( samples >= lorawanConfigRETRANSMIT_MIN_SAMPLES ) )
+    {
+        if( confirmed == true )
+        {
+            nbTrials = prvGetTransmissions( errorRate, reliability, lorawanConfigMAX_SEND_RETRIES );
+        }
+        else
+        {
+            pSend->nbTrans = prvGetTransmissions( errorRate, reliability, lorawanConfigMAX_NB_TRANS );
+            pSend->nbTrans = ( pSend->nbTrans < pSend->networkNbTrans ) ? pSend->networkNbTrans : pSend->nbTrans;
+
+            if( pSend->nbTrans != pSend->networkNbTrans )
             {
-                xQueueReceive( xResponseQueue, &responseStatus, portMAX_DELAY );
+                mibReq.Param.ChannelsNbTrans = pSend->nbTrans;
+                LoRaMacMibSetRequestConfirm( &mibReq );
+            }
+        }
+    }
 
-                if( responseStatus == LORAMAC_EVENT_INFO_STATUS_OK )
-                {
-                    configPRINTF( ( "Successfully joined a LoRaWAN network.\n" ) );
+    pSend->loss = 1.0f;
+
+    for( i = 0; i < pSend->nbTrans; i++ )
+    {
+        pSend->loss *= errorRate;
+    }
 
-                    mibReq.Type = MIB_DEV_ADDR;
-                    LoRaMacMibGetRequestConfirm( &mibReq );
-                    configPRINTF( ( "Device address : %08lX\n", mibReq.Param.DevAddr ) );
+    status = LoRaMacQueryTxPossible( pMessage->length, &txInfo );
 
-                    mibReq.Type = MIB_CHANNELS_DATARATE;
-                    LoRaMacMibGetRequestConfirm( &mibReq );
-                    configPRINTF( ( "Data rate : DR_%d\n", mibReq.Param.ChannelsDatarate ) );
+    if( status == LORAMAC_STATUS_OK )
+    {
+        if( confirmed == false )
+        {
+            pMcpsReq->Type = MCPS_UNCONFIRMED;
+            pMcpsReq->Req.Unconfirmed.fPort = pMessage->port;
+            pMcpsReq->Req.Unconfirmed.fBuffer = pMessage->data;
+            pMcpsReq->Req.Unconfirmed.fBufferSize = pMessage->length;
+            pMcpsReq->Req.Unconfirmed.Datarate = pSend->dataRate;
+        }
+        else
+        {
+            pMcpsReq->Type = MCPS_CONFIRMED;
+            pMcpsReq->Req.Confirmed.fPort = pMessage->port;
+            pMcpsReq->Req.Confirmed.fBuffer = pMessage->data;
+            pMcpsReq->Req.Confirmed.fBufferSize = pMessage->length;
+            pMcpsReq->Req.Confirmed.NbTrials = nbTrials;
+            pMcpsReq->Req.Confirmed.Datarate = pSend->dataRate;
+        }
 
-                    break;
-                }
-                else
-                {
-                    configPRINTF( ( "Failed to join loRaWAN network with status %d.\n", responseStatus ) );
-                    status = LORAMAC_STATUS_ERROR;
-                }
-            }
-            else
-            {
-                configPRINTF( ( "Failed to initiate a LoRaWAN JOIN request with status %d.\n", status ) );
-                break;
-            }
+        prvStartRxWindows();
+        status = LoRaMacMcpsRequest( pMcpsReq );
+        pCommand->dutyCycleWaitMs = pMcpsReq->ReqReturn.DutyCycleWaitTime;
+    }
 
-            if( xNumTries < ( lorawanConfigMAX_JOIN_ATTEMPTS - 1 ) )
-            {
-                ulDutyCycleTimeMS = ( lorawanConfigJOIN_RETRY_INTERVAL_MS ) +
-                                    randr( -lorawanConfigMAX_JITTER_MS, lorawanConfigMAX_JITTER_MS );
-                configPRINTF( ( "Retrying join attempt after %lu seconds.\n", ( ulDutyCycleTimeMS / 1000 ) ) );
-                vTaskDelay( pdMS_TO_TICKS( ulDutyCycleTimeMS ) );
-            }
+    if( status == LORAMAC_STATUS_OK )
+    {
+        pxMcpsWaiter = pCommand;
+        xRetransmit.nbTrans = pSend->nbTrans;
+
+        /* Counted for the periodic Rejoin-Requests of type 0. */
+        xRejoin.uplinks++;
+
+        /* LoRaMAC added the MAC answers waiting for an uplink to this one. */
+        taskENTER_CRITICAL();
+        pSend->piggybacked = xPiggyback.pending;
+        xPiggyback.pending = false;
+        xPiggyback.pendingSinceMs = 0;
+        taskEXIT_CRITICAL();
+    }
+    else
+    {
+        prvRestoreNbTrans( pSend );
+
+        /* Put back, for the next attempt or the next uplink. */
+        if( pPackage != NULL )
+        {
+            prvSetPackageAnswer( pPackage, pMessage->data, pMessage->length );
+            pMessage->length = 0;
         }
     }
 
     return status;
 }
 
-LoRaMacStatus_t LoRaWAN_GetNetworkParams( LoRaWANNetworkParams_t * pNetworkParams )
+/*
+ * Sends a message, or with pAnswersLeft the answers of a package into pMessage, confirmed if no other package has answers
+ * left. pMessage->length is then 0 if there were none.
+ */
+static LoRaMacStatus_t prvSend( LoRaWANMessage_t * pMessage,
+                                bool confirmed,
+                                bool * pAnswersLeft )
 {
-    MibRequestConfirm_t mibReq = { 0 };
+    LoRaWANCommand_t command;
+    LoRaWANSend_t send = { 0 };
     LoRaMacStatus_t status;
-    size_t x;
+    LoRaMacEventInfoStatus_t responseStatus;
 
-    configASSERT( pNetworkParams != NULL );
+    send.pMessage = pMessage;
+    send.confirmed = confirmed;
+    send.answers = ( pAnswersLeft != NULL );
 
-    for( x = 0; x < LORAWAN_NUM_PARAMS; x++ )
+    prvCommandInit( &command );
+
+    do
     {
-        memset( &mibReq, 0x00, sizeof( MibRequestConfirm_t ) );
-        mibReq.Type = paramTypes[ x ];
-        status = LoRaMacMibGetRequestConfirm( &mibReq );
+        status = prvCommandRun( &command, prvExecRequestSend, &send );
 
-        if( status == LORAMAC_STATUS_OK )
+        if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
         {
-            switch( paramTypes[ x ] )
-            {
-                case MIB_CHANNELS_DEFAULT_TX_POWER:
-                    pNetworkParams->txPower = mibReq.Param.ChannelsTxPower;
-                    break;
+            configPRINTF( ( "Duty cycle restriction. Wait ~%lu second(s) before sending uplink.\n", ( command.dutyCycleWaitMs / 1000 ) ) );
+            vTaskDelay( pdMS_TO_TICKS( command.dutyCycleWaitMs ) );
+        }
+        else if( ( status == LORAMAC_STATUS_BUSY ) && ( send.frameInFlight == true ) )
+        {
+            /* The LoRaMAC task is sending a frame for the network, it is over after its receive windows. */
+            vTaskDelay( pdMS_TO_TICKS( LORAWAN_PIGGYBACK_BUSY_RETRY_MS ) );
+            status = LORAMAC_STATUS_DUTYCYCLE_RESTRICTED;
+        }
+    } while( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED );
 
-                case MIB_CHANNELS_DEFAULT_DATARATE:
-                    pNetworkParams->dataRate = mibReq.Param.ChannelsDatarate;
-                    break;
+    if( pAnswersLeft != NULL )
+    {
+        *pAnswersLeft = send.answersLeft;
+        confirmed = confirmed && ( send.answersLeft == false );
+    }
 
-                case MIB_RX2_DEFAULT_CHANNEL:
-                    pNetworkParams->rx2Channel = mibReq.Param.Rx2Channel;
-                    break;
+    if( ( status == LORAMAC_STATUS_OK ) && ( ( send.answers == false ) || ( pMessage->length > 0 ) ) )
+    {
+        responseStatus = prvCommandWaitConfirm( &command );
 
-                default:
-                    break;
-            }
+        taskENTER_CRITICAL();
+
+        if( send.piggybacked == true )
+        {
+            /* Until an empty frame was measured at this data rate, this uplink is the estimate, a few symbols longer. */
+            xPiggyback.stats.piggybacked++;
+            xPiggyback.stats.airtimeSavedMs +=
+                ( ( xPiggyback.lastDatarate < LORAWAN_DATARATE_COUNT ) && ( xPiggyback.emptyAirtimeMs[ xPiggyback.lastDatarate ] != 0 ) ) ?
+                xPiggyback.emptyAirtimeMs[ xPiggyback.lastDatarate ] : xPiggyback.lastAirtimeMs;
+        }
+
+        xRetransmit.stats.transmissions += xRetransmit.lastTransmissions;
+        xRetransmit.stats.airtimeMs += xPiggyback.lastAirtimeMs * xRetransmit.lastTransmissions;
+
+        if( confirmed == true )
+        {
+            xRetransmit.stats.confirmed++;
+            xRetransmit.stats.confirmedAcked += ( responseStatus == LORAMAC_EVENT_INFO_STATUS_OK ) ? 1U : 0U;
         }
         else
         {
-            break;
+            xRetransmit.stats.unconfirmed++;
+            xRetransmit.stats.unconfirmedDelivered += 1.0f - send.loss;
+        }
+
+        taskEXIT_CRITICAL();
+
+        if( responseStatus != LORAMAC_EVENT_INFO_STATUS_OK )
+        {
+            status = LORAMAC_STATUS_ERROR;
         }
     }
 
+    prvCommandDeinit( &command );
+
     return status;
 }
 
-LoRaMacStatus_t LoRaWAN_SetNetworkParams( LoRaWANNetworkParams_t * pNetworkParams )
+/* Starts an uplink cycle of the application. */
+static LoRaMacStatus_t prvExecStartSend( LoRaWANCommand_t * pCommand )
 {
-    MibRequestConfirm_t mibReq = { 0 };
-    LoRaMacStatus_t status;
-    size_t x;
+    uint64_t nowMs = prvGetLocalTimeMs();
 
-    configASSERT( pNetworkParams != NULL );
+    ( void ) pCommand;
 
-    for( x = 0; x < LORAWAN_NUM_PARAMS; x++ )
-    {
-        memset( &mibReq, 0x00, sizeof( MibRequestConfirm_t ) );
-        mibReq.Type = paramTypes[ x ];
+    prvScheduleTimeSync();
 
-        switch( paramTypes[ x ] )
-        {
-            case MIB_CHANNELS_DEFAULT_TX_POWER:
-                mibReq.Param.ChannelsTxPower = pNetworkParams->txPower;
-                break;
+    /* The application period predicts the next uplink the MAC answers can wait for. */
+    taskENTER_CRITICAL();
+    xPiggyback.periodMs = ( xPiggyback.lastUplinkMs != 0 ) ? ( uint32_t ) ( nowMs - xPiggyback.lastUplinkMs ) : 0;
+    xPiggyback.lastUplinkMs = nowMs;
+    xPiggyback.nextUplinkMs = 0;
+    taskEXIT_CRITICAL();
 
-            case MIB_CHANNELS_DEFAULT_DATARATE:
-                mibReq.Param.ChannelsDatarate = pNetworkParams->dataRate;
-                break;
+    return LORAMAC_STATUS_OK;
+}
 
-            case MIB_RX2_DEFAULT_CHANNEL:
-                mibReq.Param.Rx2Channel = pNetworkParams->rx2Channel;
-                break;
+LoRaMacStatus_t LoRaWAN_Send( LoRaWANMessage_t * pMessage,
+                              bool confirmed )
+{
+    LoRaWANMessage_t answer = { 0 };
+    LoRaMacStatus_t status;
+    bool answersLeft = true;
 
-            default:
-                break;
-        }
+    /* The energy drawn is reported per uplink cycle of the application. */
+    EnergyMonitor_StartCycle();
 
-        status = LoRaMacMibSetRequestConfirm( &mibReq );
+    ( void ) prvCall( prvExecStartSend, NULL );
+
+    /* The answers are taken in the LoRaMAC task, which puts them back if they cannot be sent. An empty message of the
+     * application is not sent, the last answers are confirmed instead if it asked to. */
+    while( answersLeft == true )
+    {
+        answer.dataRate = pMessage->dataRate;
+        status = prvSend( &answer, ( pMessage->length == 0 ) ? confirmed : false, &answersLeft );
 
         if( status != LORAMAC_STATUS_OK )
         {
-            break;
+            configPRINTF( ( "Failed to send the answers on port %d, status = %d.\r\n", answer.port, status ) );
+            answersLeft = false;
+        }
+
+        if( ( pMessage->length == 0 ) && ( ( status != LORAMAC_STATUS_OK ) || ( ( answer.length > 0 ) && ( answersLeft == false ) ) ) )
+        {
+            return status;
         }
     }
 
-    return status;
+    return prvSend( pMessage, confirmed, NULL );
 }
 
+static LoRaMacStatus_t prvExecSetNextUplinkDelay( LoRaWANCommand_t * pCommand )
+{
+    uint64_t nowMs = prvGetLocalTimeMs();
+
+    /* An empty frame waiting for the predicted uplink may be due sooner or later, see prvProcessPiggyback(). */
+    taskENTER_CRITICAL();
+    xPiggyback.nextUplinkMs = nowMs + *( uint32_t * ) pCommand->pArgs;
+    taskEXIT_CRITICAL();
 
-LoRaMacStatus_t LoRaWAN_SetAdaptiveDataRate( bool enable )
+    return LORAMAC_STATUS_OK;
+}
+
+void LoRaWAN_SetNextUplinkDelay( uint32_t delayMs )
 {
-    MibRequestConfirm_t mibReq = { 0 };
+    ( void ) prvCall( prvExecSetNextUplinkDelay, &delayMs );
+}
 
-    mibReq.Type = MIB_ADR;
-    mibReq.Param.AdrEnable = enable;
-    return LoRaMacMibSetRequestConfirm( &mibReq );
+void LoRaWAN_GetPiggybackStats( LoRaWANPiggybackStats_t * pStats )
+{
+    taskENTER_CRITICAL();
+    *pStats = xPiggyback.stats;
+    taskEXIT_CRITICAL();
 }
 
+void LoRaWAN_GetRetransmitStats( LoRaWANRetransmitStats_t * pStats )
+{
+    taskENTER_CRITICAL();
+    *pStats = xRetransmit.stats;
+    taskEXIT_CRITICAL();
+}
 
-LoRaMacStatus_t LoRaWAN_RequestDeviceTimeSync( void )
+void LoRaWAN_GetRxTimingStats( RxTimingStats_t * pStats )
 {
-    MlmeReq_t mlmeReq = { 0 };
-    mlmeReq.Type = MLME_DEVICE_TIME;
-    return LoRaMacMlmeRequest( &mlmeReq );
+    taskENTER_CRITICAL();
+    RxTiming_GetStats( &xRxWindows.timing, pStats );
+    taskEXIT_CRITICAL();
 }
 
+void LoRaWAN_GetTempCompStats( TempCompStats_t * pStats )
+{
+    uint64_t crystalMs = prvGetCrystalTimeMs();
 
-LoRaMacStatus_t LoRaWAN_RequestLinkCheck( void )
+    taskENTER_CRITICAL();
+    TempComp_GetStats( &xTempComp, crystalMs, pStats );
+    taskEXIT_CRITICAL();
+}
+
+void LoRaWAN_GetEnergyReport( EnergyReport_t * pReport )
 {
-    MlmeReq_t mlmeReq = { 0 };
-    mlmeReq.Type = MLME_LINK_CHECK;
-    return LoRaMacMlmeRequest( &mlmeReq );
+    EnergyMonitor_GetReport( pReport );
 }
 
-LoRaMacStatus_t LoRaWAN_Send( LoRaWANMessage_t * pMessage,
-                              bool confirmed )
+void LoRaWAN_GetMonitorReport( TaskMonitorReport_t * pReport )
 {
-    McpsReq_t mcpsReq;
-    LoRaMacTxInfo_t txInfo;
-    LoRaMacStatus_t status;
-    uint32_t ulDutyCycleTimeMS = 0;
-    LoRaMacEventInfoStatus_t responseStatus;
+    TaskMonitor_GetReport( pReport );
+}
 
-    status = LoRaMacQueryTxPossible( pMessage->length, &txInfo );
+void LoRaWAN_GetRamBudget( LoRaWANRamBudget_t * pBudget )
+{
+    pBudget->stackBytes = lorawanConfigLORAMAC_TASK_STACK_SIZE * sizeof( StackType_t );
+    pBudget->queueBytes = ( lorawanConfigEVENT_QUEUE_SIZE * sizeof( LoRaWANEventInfo_t ) ) +
+                          ( lorawanConfigCOMMAND_QUEUE_SIZE * sizeof( LoRaWANCommand_t * ) ) +
+                          ( lorawanConfigDOWNLINK_QUEUE_SIZE * sizeof( LoRaWANMessage_t ) );
+
+    #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+        pBudget->kernelObjectBytes = sizeof( StaticTask_t ) + ( 3U * sizeof( StaticQueue_t ) );
+        pBudget->timerBytes = lorawanConfigMAX_TIMERS * sizeof( StaticTimer_t );
+    #else
+        pBudget->kernelObjectBytes = 0;
+        pBudget->timerBytes = 0;
+    #endif
 
-    if( status == LORAMAC_STATUS_OK )
+    #if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+        pBudget->staticBytes = pBudget->stackBytes + pBudget->queueBytes + pBudget->kernelObjectBytes +
+                               pBudget->timerBytes;
+    #else
+        pBudget->staticBytes = 0;
+    #endif
+
+    pBudget->initHeapBytes = xInitHeapBytes;
+}
+
+static LoRaMacStatus_t prvExecSubscribePort( LoRaWANCommand_t * pCommand )
+{
+    const LoRaWANSubscription_t * pRequest = ( const LoRaWANSubscription_t * ) pCommand->pArgs;
+    LoRaWANSubscription_t * pSubscription = prvFindSubscription( pRequest->port );
+    size_t i;
+
+    /* The downlinks of the packages are processed by this layer. */
+    for( i = 0; i < LORAWAN_PACKAGE_COUNT; i++ )
     {
-        if( confirmed == false )
+        if( ( xPackages[ i ].port != 0 ) && ( xPackages[ i ].port == pRequest->port ) )
         {
-            mcpsReq.Type = MCPS_UNCONFIRMED;
-            mcpsReq.Req.Unconfirmed.fPort = pMessage->port;
-            mcpsReq.Req.Unconfirmed.fBuffer = pMessage->data;
-            mcpsReq.Req.Unconfirmed.fBufferSize = pMessage->length;
-            mcpsReq.Req.Unconfirmed.Datarate = pMessage->dataRate;
+            return LORAMAC_STATUS_PARAMETER_INVALID;
         }
-        else
+    }
+
+    for( i = 0; ( i < lorawanConfigMAX_PORT_SUBSCRIPTIONS ) && ( pSubscription == NULL ); i++ )
+    {
+        if( xSubscriptions[ i ].used == false )
         {
-            mcpsReq.Type = MCPS_CONFIRMED;
-            mcpsReq.Req.Confirmed.fPort = pMessage->port;
-            mcpsReq.Req.Confirmed.fBuffer = pMessage->data;
-            mcpsReq.Req.Confirmed.fBufferSize = pMessage->length;
-            mcpsReq.Req.Confirmed.NbTrials = lorawanConfigMAX_SEND_RETRIES;
-            mcpsReq.Req.Confirmed.Datarate = pMessage->dataRate;
+            pSubscription = &xSubscriptions[ i ];
+            memset( pSubscription, 0, sizeof( LoRaWANSubscription_t ) );
+            pSubscription->used = true;
+            pSubscription->port = pRequest->port;
         }
+    }
 
-        do
-        {
-            status = LoRaMacMcpsRequest( &mcpsReq );
-            ulDutyCycleTimeMS = mcpsReq.ReqReturn.DutyCycleWaitTime;
+    if( pSubscription == NULL )
+    {
+        return LORAMAC_STATUS_ERROR;
+    }
 
-            if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
-            {
-                configPRINTF( ( "Duty cycle restriction. Wait ~%lu second(s) before sending uplink.\n", ( ulDutyCycleTimeMS / 1000 ) ) );
-                vTaskDelay( pdMS_TO_TICKS( ulDutyCycleTimeMS ) );
-            }
-        } while( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED );
+    pSubscription->queue = pRequest->queue;
+    pSubscription->callback = pRequest->callback;
+    pSubscription->pContext = pRequest->pContext;
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaWAN_SubscribePort( uint8_t port,
+                                       QueueHandle_t queue,
+                                       LoRaWANDownlinkCallback_t callback,
+                                       void * pContext )
+{
+    LoRaWANSubscription_t request = { 0 };
+
+    if( ( queue == NULL ) == ( callback == NULL ) )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
     }
 
-    if( status == LORAMAC_STATUS_OK )
+    request.port = port;
+    request.queue = queue;
+    request.callback = callback;
+    request.pContext = pContext;
+
+    return prvCall( prvExecSubscribePort, &request );
+}
+
+static LoRaMacStatus_t prvExecUnsubscribePort( LoRaWANCommand_t * pCommand )
+{
+    uint8_t port = *( uint8_t * ) pCommand->pArgs;
+    LoRaWANSubscription_t * pSubscription = prvFindSubscription( port );
+
+    if( pSubscription == NULL )
     {
-        xQueueReceive( xResponseQueue, &responseStatus, portMAX_DELAY );
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
 
-        if( responseStatus != LORAMAC_EVENT_INFO_STATUS_OK )
-        {
-            status = LORAMAC_STATUS_ERROR;
-        }
+    if( port == LORAWAN_PORT_ANY )
+    {
+        pSubscription->queue = xDownlinkQueue;
+        pSubscription->callback = NULL;
+        pSubscription->pContext = NULL;
+    }
+    else
+    {
+        pSubscription->used = false;
+    }
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaWAN_UnsubscribePort( uint8_t port )
+{
+    return prvCall( prvExecUnsubscribePort, &port );
+}
+
+static LoRaMacStatus_t prvExecGetPortStats( LoRaWANCommand_t * pCommand )
+{
+    LoRaWANSubscription_t * pRequest = ( LoRaWANSubscription_t * ) pCommand->pArgs;
+    const LoRaWANSubscription_t * pSubscription = prvFindSubscription( pRequest->port );
+
+    if( pSubscription == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
     }
 
+    pRequest->stats = pSubscription->stats;
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaWAN_GetPortStats( uint8_t port,
+                                      LoRaWANPortStats_t * pStats )
+{
+    LoRaWANSubscription_t request = { 0 };
+    LoRaMacStatus_t status;
+
+    configASSERT( pStats != NULL );
+
+    request.port = port;
+    status = prvCall( prvExecGetPortStats, &request );
+    *pStats = request.stats;
+
     return status;
 }
 
@@ -844,30 +4389,107 @@ BaseType_t LoRaWAN_Receive( LoRaWANMessage_t * pMessage,
     return xQueueReceive( xDownlinkQueue, pMessage, ticksToWait );
 }
 
+static LoRaMacStatus_t prvExecSetEventCallback( LoRaWANCommand_t * pCommand )
+{
+    const LoRaWANEventCallbackArgs_t * pArgs = ( const LoRaWANEventCallbackArgs_t * ) pCommand->pArgs;
+
+    xEventCallback = pArgs->callback;
+    pvEventCallbackContext = pArgs->pContext;
+    ulEventMask = pArgs->eventMask;
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaWAN_SetEventCallback( uint32_t eventMask,
+                                          LoRaWANEventCallback_t callback,
+                                          void * pContext )
+{
+    LoRaWANEventCallbackArgs_t args;
+
+    if( ( eventMask & ~LORAWAN_EVENT_ALL ) != 0U )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    args.eventMask = ( callback != NULL ) ? eventMask : 0U;
+    args.callback = callback;
+    args.pContext = pContext;
+
+    return prvCall( prvExecSetEventCallback, &args );
+}
+
+static LoRaMacStatus_t prvExecSetEventGroup( LoRaWANCommand_t * pCommand )
+{
+    xEventGroup = *( EventGroupHandle_t * ) pCommand->pArgs;
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaWAN_SetEventGroup( EventGroupHandle_t eventGroup )
+{
+    return prvCall( prvExecSetEventGroup, &eventGroup );
+}
+
 BaseType_t LoRaWAN_PollEvent( LoRaWANEventInfo_t * pEventInfo,
                               uint32_t timeoutMS )
 {
-    TickType_t ticksToWait;
+    /* A timeout of 0 does not block, for the applications woken by the event group. */
+    return xQueueReceive( xEventQueue, pEventInfo, pdMS_TO_TICKS( timeoutMS ) );
+}
 
-    if( timeoutMS > 0 )
+/* Wakes the commands the LoRaMAC task will never run nor confirm, with an error. */
+static void prvFailCommands( void )
+{
+    LoRaWANCommand_t * pCommand;
+
+    if( pxMcpsWaiter != NULL )
     {
-        ticksToWait = pdMS_TO_TICKS( timeoutMS );
+        prvCompleteConfirm( &pxMcpsWaiter, LORAMAC_EVENT_INFO_STATUS_ERROR );
     }
-    else
+
+    if( pxMlmeWaiter != NULL )
     {
-        ticksToWait = 1;
+        prvCompleteConfirm( &pxMlmeWaiter, LORAMAC_EVENT_INFO_STATUS_ERROR );
     }
 
-    return xQueueReceive( xEventQueue, pEventInfo, ticksToWait );
+    while( xQueueReceive( xCommandQueue, &pCommand, 0 ) == pdTRUE )
+    {
+        pCommand->status = LORAMAC_STATUS_ERROR;
+        ( void ) xSemaphoreGive( pCommand->token );
+    }
 }
 
-void LoRaWAN_Cleanup( void )
+static LoRaMacStatus_t prvExecCleanup( LoRaWANCommand_t * pCommand )
 {
+    ( void ) pCommand;
+
+    TimerStop( &xMulticastTimer );
+    TimerStop( &xFragStatusTimer );
+    TimerStop( &xRejoinTimer );
+    TimerStop( &xPiggybackTimer );
+    TimerStop( &xTemperatureTimer );
     LoRaMacStop();
-    ( void ) LoRaMacDeInitialization();
+    prvFailCommands();
+
+    return LoRaMacDeInitialization();
+}
+
+void LoRaWAN_Cleanup( void )
+{
+    ( void ) prvCall( prvExecCleanup, NULL );
     vTaskDelete( xLoRaMacTask );
+    xLoRaMacTask = NULL;
+
+    /* Commands may have been sent after the cleanup step ran. */
+    prvFailCommands();
+
+    /* The samples of the monitor keep running, they must not read the deleted queues. */
+    TaskMonitor_RemoveQueue( xEventQueue );
+    TaskMonitor_RemoveQueue( xCommandQueue );
+    TaskMonitor_RemoveQueue( xDownlinkQueue );
     vQueueDelete( xEventQueue );
-    vQueueDelete( xResponseQueue );
+    vQueueDelete( xCommandQueue );
+    vQueueDelete( xDownlinkQueue );
 }
 
 /* Unique ID for the board used by LoRaMAC APIs. */
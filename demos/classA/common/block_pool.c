@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include "block_pool.h"
+
+/**
+ * @brief Index of the end of the free blocks.
+ */
+#define BLOCK_POOL_NONE           ( 0xFFFFU )
+
+/**
+ * @brief Halves of the top of the free blocks.
+ */
+#define BLOCK_POOL_INDEX_MASK     ( 0x0000FFFFUL )
+#define BLOCK_POOL_CHANGE_MASK    ( 0xFFFF0000UL )
+#define BLOCK_POOL_CHANGE_ONE     ( 0x00010000UL )
+
+/**
+ * @brief Pools initialized, in order.
+ */
+static BlockPool_t * pFirstPool = NULL;
+static BlockPool_t * pLastPool = NULL;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMakeTop( uint32_t previousTop,
+                            uint16_t index )
+{
+    return ( ( previousTop + BLOCK_POOL_CHANGE_ONE ) & BLOCK_POOL_CHANGE_MASK ) | index;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRaiseHighWater( BlockPool_t * pPool,
+                               uint32_t used )
+{
+    uint32_t highWater = __atomic_load_n( &pPool->highWater, __ATOMIC_RELAXED );
+
+    while( ( used > highWater ) &&
+           !__atomic_compare_exchange_n( &pPool->highWater, &highWater, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+    {
+    }
+}
+/*-----------------------------------------------------------*/
+
+static bool prvIsListed( const BlockPool_t * pPool )
+{
+    const BlockPool_t * pListed;
+
+    for( pListed = pFirstPool; pListed != NULL; pListed = pListed->pNext )
+    {
+        if( pListed == pPool )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+bool BlockPool_Init( BlockPool_t * pPool,
+                     const char * pName,
+                     void * pStorage,
+                     size_t blockSize,
+                     uint16_t blockCount,
+                     uint16_t * pLinks )
+{
+    uint16_t i;
+
+    if( ( pStorage == NULL ) || ( pLinks == NULL ) || ( blockSize == 0U ) || ( blockCount == 0U ) ||
+        ( blockCount > BLOCK_POOL_MAX_BLOCKS ) )
+    {
+        return false;
+    }
+
+    pPool->pName = pName;
+    pPool->pStorage = ( uint8_t * ) pStorage;
+    pPool->pLinks = pLinks;
+    pPool->blockSize = blockSize;
+    pPool->blockCount = blockCount;
+    pPool->used = 0;
+    pPool->highWater = 0;
+    pPool->allocations = 0;
+    pPool->failures = 0;
+
+    for( i = 0; i < ( blockCount - 1U ); i++ )
+    {
+        pLinks[ i ] = ( uint16_t ) ( i + 1U );
+    }
+
+    pLinks[ blockCount - 1U ] = BLOCK_POOL_NONE;
+    pPool->top = 0;
+
+    /* A pool initialized again stays at its place in the reports. */
+    if( !prvIsListed( pPool ) )
+    {
+        pPool->pNext = NULL;
+
+        if( pLastPool == NULL )
+        {
+            pFirstPool = pPool;
+        }
+        else
+        {
+            pLastPool->pNext = pPool;
+        }
+
+        pLastPool = pPool;
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+void * BlockPool_Alloc( BlockPool_t * pPool )
+{
+    uint32_t top = __atomic_load_n( &pPool->top, __ATOMIC_ACQUIRE );
+    uint32_t newTop;
+    uint16_t index;
+
+    do
+    {
+        index = ( uint16_t ) ( top & BLOCK_POOL_INDEX_MASK );
+
+        if( index == BLOCK_POOL_NONE )
+        {
+            ( void ) __atomic_fetch_add( &pPool->failures, 1U, __ATOMIC_RELAXED );
+
+            return NULL;
+        }
+
+        /* The link read is stale if the block was taken meanwhile, but then the top changed and the swap fails. */
+        newTop = prvMakeTop( top, pPool->pLinks[ index ] );
+    } while( !__atomic_compare_exchange_n( &pPool->top, &top, newTop, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ) );
+
+    prvRaiseHighWater( pPool, __atomic_add_fetch( &pPool->used, 1U, __ATOMIC_RELAXED ) );
+    ( void ) __atomic_fetch_add( &pPool->allocations, 1U, __ATOMIC_RELAXED );
+
+    return pPool->pStorage + ( ( size_t ) index * pPool->blockSize );
+}
+/*-----------------------------------------------------------*/
+
+bool BlockPool_Free( BlockPool_t * pPool,
+                     void * pBlock )
+{
+    uint32_t top;
+    uint16_t index;
+
+    if( !BlockPool_Owns( pPool, pBlock ) )
+    {
+        return false;
+    }
+
+    index = ( uint16_t ) ( ( size_t ) ( ( uint8_t * ) pBlock - pPool->pStorage ) / pPool->blockSize );
+
+    /* Counted out before the block can be taken again, so that the count never exceeds the blocks. */
+    ( void ) __atomic_fetch_sub( &pPool->used, 1U, __ATOMIC_RELAXED );
+
+    top = __atomic_load_n( &pPool->top, __ATOMIC_RELAXED );
+
+    do
+    {
+        pPool->pLinks[ index ] = ( uint16_t ) ( top & BLOCK_POOL_INDEX_MASK );
+    } while( !__atomic_compare_exchange_n( &pPool->top, &top, prvMakeTop( top, index ), true, __ATOMIC_RELEASE,
+                                           __ATOMIC_RELAXED ) );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+bool BlockPool_Owns( const BlockPool_t * pPool,
+                     const void * pBlock )
+{
+    const uint8_t * pByte = ( const uint8_t * ) pBlock;
+    size_t offset;
+
+    if( ( pByte < pPool->pStorage ) || ( pByte >= ( pPool->pStorage + ( ( size_t ) pPool->blockCount * pPool->blockSize ) ) ) )
+    {
+        return false;
+    }
+
+    offset = ( size_t ) ( pByte - pPool->pStorage );
+
+    return ( ( offset % pPool->blockSize ) == 0U );
+}
+/*-----------------------------------------------------------*/
+
+void BlockPool_GetStats( const BlockPool_t * pPool,
+                         BlockPoolStats_t * pStats )
+{
+    pStats->pName = pPool->pName;
+    pStats->blockSize = pPool->blockSize;
+    pStats->blockCount = pPool->blockCount;
+    pStats->used = pPool->used;
+    pStats->highWater = pPool->highWater;
+    pStats->allocations = pPool->allocations;
+    pStats->failures = pPool->failures;
+}
+/*-----------------------------------------------------------*/
+
+const BlockPool_t * BlockPool_GetFirst( void )
+{
+    return pFirstPool;
+}
+/*-----------------------------------------------------------*/
+
+const BlockPool_t * BlockPool_GetNext( const BlockPool_t * pPool )
+{
+    return pPool->pNext;
+}
+/*-----------------------------------------------------------*/
@@ -27,6 +27,7 @@
 
 
 #include "LoRaWAN.h"
+#include "block_pool.h"
 #include "utilities.h"
 
 
@@ -59,8 +60,11 @@
  * using a default data rate of DR_0 (SF = 10, BW=125Khz) for US915, so airtime for each uplink ~289ms, hence setting the interval
  * to 700 seconds to achieve maximum air time of 36sec per day.
  *
+ * Can be overridden from the build, e.g. to evaluate the scheduling of a large fleet with the host simulator.
  */
-#define LORAWAN_APPLICATION_TX_INTERVAL_SEC    ( 700U )
+#ifndef LORAWAN_APPLICATION_TX_INTERVAL_SEC
+    #define LORAWAN_APPLICATION_TX_INTERVAL_SEC    ( 700U )
+#endif
 
 /**
  * @brief Defines a random jitter bound in milliseconds for application data transmission duty cycle.
@@ -68,8 +72,88 @@
  * This allows devices to space their transmissions slighltly between each other in cases like all devices reboots and tries to
  * join server at same time.
  */
-#define LORAWAN_APPLICATION_JITTER_MS          ( 500 )
+#ifndef LORAWAN_APPLICATION_JITTER_MS
+    #define LORAWAN_APPLICATION_JITTER_MS          ( 500 )
+#endif
 
+/**
+ * @brief Set to 1 to send application data in the uplink slot of the device rather than after a random jitter.
+ *
+ * Devices which boot together, for instance after a power outage, keep colliding when they only rely on a short random jitter.
+ * In slotted mode each device transmits in its own slot of the period, derived from its device address and aligned on the
+ * network synchronized time, see LoRaWAN_GetUplinkSlotDelay(). The random jitter is used until the time is synchronized.
+ */
+#ifndef LORAWAN_APPLICATION_SLOTTED_UPLINK
+    #define LORAWAN_APPLICATION_SLOTTED_UPLINK     ( 0 )
+#endif
+
+/**
+ * @brief Device class requested after the join.
+ *
+ * A class B device opens ping slots between the uplinks, so the network server can send downlinks without waiting for the
+ * next uplink. Requires the LoRaMAC stack to be built with LORAMAC_CLASSB_ENABLED. A class C device keeps its receiver on
+ * between the uplinks, for the lowest downlink latency at the highest energy cost.
+ */
+#ifndef LORAWAN_APPLICATION_DEVICE_CLASS
+    #define LORAWAN_APPLICATION_DEVICE_CLASS       ( CLASS_A )
+#endif
+
+/**
+ * @brief Set to 1 for a device which moves, and uses the device side rate adaptation rather than the network ADR.
+ *
+ * The network ADR settles on the data rate of the past positions of the device and only falls back after many
+ * unacknowledged uplinks, see LoRaWAN_SetRateAdaptation().
+ */
+#ifndef LORAWAN_APPLICATION_MOBILE
+    #define LORAWAN_APPLICATION_MOBILE             ( 0 )
+#endif
+
+/**
+ * @brief Port of the energy reports, see Energy_EncodeReport().
+ */
+#define LORAWAN_ENERGY_REPORT_PORT             ( 3 )
+
+/**
+ * @brief Number of uplinks between two energy reports, 0 to send none.
+ *
+ * The report takes the place of the application data in that uplink, so it costs no extra transmission. With the
+ * default interval, one report a day.
+ */
+#ifndef LORAWAN_APPLICATION_ENERGY_REPORT_PERIOD
+    #define LORAWAN_APPLICATION_ENERGY_REPORT_PERIOD    ( 120U )
+#endif
+
+/**
+ * @brief Port of the diagnostic reports, see TaskMonitor_EncodeReport().
+ */
+#define LORAWAN_DIAGNOSTICS_REPORT_PORT        ( 4 )
+
+/**
+ * @brief Number of uplinks between two diagnostic reports, 0 to send none. They are sent half way between the energy
+ * reports, in place of the application data as well.
+ */
+#ifndef LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_PERIOD
+    #define LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_PERIOD    ( 120U )
+#endif
+
+/**
+ * @brief Size of the diagnostic reports, the payload of the slowest data rate of US915 so that the report fits
+ * whatever the data rate of the uplink. It holds the heap, the queues and the task with the least free stack.
+ */
+#ifndef LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_SIZE
+    #define LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_SIZE    ( 11U )
+#endif
+
+/**
+ * @brief Set to 1 to print the statistics of the layer after each uplink: link, uplinks, receive timing, crystal, energy,
+ * pools, tasks, queues and heap.
+ *
+ * Off by default, the dozen lines per cycle keep the UART awake and are charged to the energy of the cycle. The
+ * diagnostic and energy reports carry the figures which matter in the field.
+ */
+#ifndef LORAWAN_APPLICATION_PRINT_STATS
+    #define LORAWAN_APPLICATION_PRINT_STATS        ( 0 )
+#endif
 
 /**
  * @brief Maximum time to wait to receive a downlink packet or event after sending an uplink packet.
@@ -116,19 +200,19 @@ static LoRaMacStatus_t prvFetchDownlinkPacket( void )
     LoRaWANMessage_t uplink = { 0 };
     LoRaWANMessage_t downlink = { 0 };
 
-    /* Send an empty uplink message in confirmed mode. */
+    /* Send an empty uplink message, unconfirmed as the network asks again if it is lost. */
     uplink.length = 0;
     uplink.port = LORAWAN_APP_PORT;
 
-    status = LoRaWAN_Send( &uplink, true );
+    status = LoRaWAN_Send( &uplink, false );
 
     if( status == LORAMAC_STATUS_OK )
     {
-        configPRINTF( ( "Successfully sent an uplink packet, confirmed = true.\r\n" ) );
+        configPRINTF( ( "Successfully sent an uplink packet, confirmed = false.\r\n" ) );
 
         if( LoRaWAN_Receive( &downlink, CLASSA_RECEIVE_WINDOW_DURATION_MS ) == pdTRUE )
         {
-            configPRINTF( ( "Received downlink data on port %d:\r\n", downlink.port ) );
+            configPRINTF( ( "Received downlink data on port %d, RSSI %d dBm, SNR %d dB:\r\n", downlink.port, downlink.rssi, downlink.snr ) );
             prvPrintHexBuffer( downlink.data, downlink.length );
         }
     }
@@ -136,16 +220,189 @@ static LoRaMacStatus_t prvFetchDownlinkPacket( void )
     return status;
 }
 
+/* Reports the events which need no action from the task, as soon as the LoRaMAC task sends them. */
+static void prvOnEvent( const LoRaWANEventInfo_t * pEvent,
+                        void * pContext )
+{
+    ( void ) pContext;
+
+    switch( pEvent->type )
+    {
+        case LORAWAN_EVENT_BEACON_LOCKED:
+            configPRINTF( ( "Beacon locked, RSSI %d dBm, SNR %d dB.\r\n", pEvent->info.beacon.rssi, pEvent->info.beacon.snr ) );
+            break;
+
+        case LORAWAN_EVENT_BEACON_LOST:
+            configPRINTF( ( "Beacon lost after %lu missed beacons. Reacquiring.\r\n", ( unsigned long ) pEvent->info.beacon.missedBeacons ) );
+            break;
+
+        case LORAWAN_EVENT_CLASS_CHANGED:
+            configPRINTF( ( "Device class changed to %d.\r\n", pEvent->info.deviceClass ) );
+            break;
+
+        case LORAWAN_EVENT_REJOINED:
+            configPRINTF( ( "Periodic Rejoin-Request of type %d %s.\r\n", pEvent->info.rejoinType,
+                            ( pEvent->status == LORAMAC_EVENT_INFO_STATUS_OK ) ? "answered" : "not answered" ) );
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Too large for the stack of the task. */
+static TaskMonitorReport_t xMonitorReport;
+
+#if ( LORAWAN_APPLICATION_PRINT_STATS == 1 )
+    static void prvPrintPoolStats( void )
+    {
+        const BlockPool_t * pPool;
+        BlockPoolStats_t stats;
+
+        for( pPool = BlockPool_GetFirst(); pPool != NULL; pPool = BlockPool_GetNext( pPool ) )
+        {
+            BlockPool_GetStats( pPool, &stats );
+            configPRINTF( ( "Pool %s: %lu/%lu blocks of %lu bytes in use, high water %lu, %lu allocations, %lu failed.\r\n",
+                            stats.pName, ( unsigned long ) stats.used, ( unsigned long ) stats.blockCount,
+                            ( unsigned long ) stats.blockSize, ( unsigned long ) stats.highWater,
+                            ( unsigned long ) stats.allocations, ( unsigned long ) stats.failures ) );
+        }
+    }
+
+    static void prvPrintMonitorReport( void )
+    {
+        uint32_t i;
+
+        LoRaWAN_GetMonitorReport( &xMonitorReport );
+
+        for( i = 0; i < xMonitorReport.taskCount; i++ )
+        {
+            configPRINTF( ( "Task %s: CPU %u.%u %%, peak %u.%u %%, %lu bytes of stack free.\r\n",
+                            xMonitorReport.tasks[ i ].name,
+                            xMonitorReport.tasks[ i ].averageCpuPermille / 10U, xMonitorReport.tasks[ i ].averageCpuPermille % 10U,
+                            xMonitorReport.tasks[ i ].peakCpuPermille / 10U, xMonitorReport.tasks[ i ].peakCpuPermille % 10U,
+                            ( unsigned long ) xMonitorReport.tasks[ i ].stackFreeBytes ) );
+        }
+
+        for( i = 0; i < xMonitorReport.queueCount; i++ )
+        {
+            configPRINTF( ( "Queue %s: %u/%u messages at most.\r\n", xMonitorReport.queues[ i ].pName,
+                            xMonitorReport.queues[ i ].highWater, xMonitorReport.queues[ i ].length ) );
+        }
+
+        configPRINTF( ( "Heap: %lu bytes free, %lu at least.\r\n", ( unsigned long ) xMonitorReport.freeHeapBytes,
+                        ( unsigned long ) xMonitorReport.minFreeHeapBytes ) );
+    }
+
+    static void prvPrintStats( void )
+    {
+        LoRaWANPiggybackStats_t piggybackStats;
+        LoRaWANRetransmitStats_t retransmitStats;
+        RxTimingStats_t rxTimingStats;
+        TempCompStats_t tempCompStats;
+        LinkQualityStats_t linkStats;
+        EnergyReport_t energyReport;
+        LoRaWANPortStats_t portStats;
+
+        LoRaWAN_GetPiggybackStats( &piggybackStats );
+        configPRINTF( ( "MAC answers piggybacked: %lu, frames sent for the network: %lu, air time saved: %lu ms.\r\n",
+                        ( unsigned long ) piggybackStats.piggybacked, ( unsigned long ) piggybackStats.fetchFrames,
+                        ( unsigned long ) piggybackStats.airtimeSavedMs ) );
+
+        LoRaWAN_GetLinkStats( &linkStats );
+        configPRINTF( ( "Link: average RSSI %d dBm, average SNR %d dB over %u downlinks, packet error rate %d %%.\r\n",
+                        ( int ) linkStats.rssiAverage, ( int ) linkStats.snrAverage, linkStats.downlinks,
+                        ( int ) ( linkStats.packetErrorRate * 100.0f ) ) );
+
+        LoRaWAN_GetRetransmitStats( &retransmitStats );
+        configPRINTF( ( "Uplinks: %lu/%lu confirmed acknowledged, %lu unconfirmed, %lu transmissions, %lu ms of air time.\r\n",
+                        ( unsigned long ) retransmitStats.confirmedAcked, ( unsigned long ) retransmitStats.confirmed,
+                        ( unsigned long ) retransmitStats.unconfirmed, ( unsigned long ) retransmitStats.transmissions,
+                        ( unsigned long ) retransmitStats.airtimeMs ) );
+
+        LoRaWAN_GetRxTimingStats( &rxTimingStats );
+        configPRINTF( ( "RX timing: bias %d ms, jitter %d ms over %u downlinks, error %lu ms, %u symbols, %lu fallbacks.\r\n",
+                        ( int ) rxTimingStats.biasMs, ( int ) rxTimingStats.jitterMs, rxTimingStats.window,
+                        ( unsigned long ) rxTimingStats.maxRxErrorMs, rxTimingStats.minRxSymbols,
+                        ( unsigned long ) rxTimingStats.fallbacks ) );
+
+        LoRaWAN_GetTempCompStats( &tempCompStats );
+        configPRINTF( ( "Crystal: %d C, frequency error %d ppb, time base corrected by %d ms over %lu samples.\r\n",
+                        ( int ) tempCompStats.temperature, ( int ) ( tempCompStats.ppm * 1000.0f ),
+                        ( int ) tempCompStats.correctionMs, ( unsigned long ) tempCompStats.samples ) );
+
+        LoRaWAN_GetEnergyReport( &energyReport );
+        configPRINTF( ( "Energy: %lu.%03lu uAh last cycle, average %lu.%02lu uA, battery life %lu days.\r\n",
+                        ( unsigned long ) energyReport.cycleTotalUah,
+                        ( unsigned long ) ( ( energyReport.cycleTotalUah - ( float ) ( uint32_t ) energyReport.cycleTotalUah ) * 1000.0f ),
+                        ( unsigned long ) energyReport.averageUa,
+                        ( unsigned long ) ( ( energyReport.averageUa - ( float ) ( uint32_t ) energyReport.averageUa ) * 100.0f ),
+                        ( unsigned long ) energyReport.batteryDays ) );
+
+        prvPrintPoolStats();
+        prvPrintMonitorReport();
+
+        if( LoRaWAN_GetPortStats( LORAWAN_PORT_ANY, &portStats ) == LORAMAC_STATUS_OK )
+        {
+            configPRINTF( ( "Downlinks: %lu delivered, %lu dropped.\r\n",
+                            ( unsigned long ) portStats.delivered, ( unsigned long ) portStats.dropped ) );
+        }
+    }
+#endif /* if ( LORAWAN_APPLICATION_PRINT_STATS == 1 ) */
+
+static void prvWaitForNextCycle( uint32_t ulWaitTimeMs )
+{
+    TickType_t xStartTick = xTaskGetTickCount();
+    TickType_t xWaitTicks = pdMS_TO_TICKS( ulWaitTimeMs );
+    TickType_t xElapsedTicks;
+    LoRaWANMessage_t downlink;
+
+    if( LORAWAN_APPLICATION_DEVICE_CLASS == CLASS_A )
+    {
+        vTaskDelay( xWaitTicks );
+    }
+    else
+    {
+        /* Downlinks received in the ping slots are queued at any time, so keep listening until the next uplink. */
+        for( ; ; )
+        {
+            xElapsedTicks = xTaskGetTickCount() - xStartTick;
+
+            if( xElapsedTicks >= xWaitTicks )
+            {
+                break;
+            }
+
+            if( LoRaWAN_Receive( &downlink, ( ( xWaitTicks - xElapsedTicks ) * portTICK_PERIOD_MS ) ) == pdTRUE )
+            {
+                if( downlink.multicastGroup != LORAWAN_UNICAST )
+                {
+                    configPRINTF( ( "Received multicast downlink data of group %u on port %d:\r\n", downlink.multicastGroup, downlink.port ) );
+                }
+                else
+                {
+                    configPRINTF( ( "Received downlink data on port %d between uplinks, RSSI %d dBm, SNR %d dB:\r\n", downlink.port, downlink.rssi, downlink.snr ) );
+                }
+
+                prvPrintHexBuffer( downlink.data, downlink.length );
+            }
+        }
+    }
+}
 
 void vLorawanClassATask( void * params )
 {
     LoRaMacStatus_t status;
-    uint32_t ulDutyCycleWaitTimeMs;
     uint32_t ulTxIntervalMs;
     LoRaWANMessage_t uplink;
     LoRaWANMessage_t downlink;
     LoRaWANEventInfo_t event;
+    LoRaWANGpsTime_t gpsTime;
+    EnergyReport_t energyReport;
+    LoRaWANRamBudget_t ramBudget;
+    uint32_t ulUplinks = 0;
 
+    ( void ) params;
 
     configPRINTF( ( "###### ===== Class A LoRaWAN application ==== ######\n\n" ) );
 
@@ -155,6 +412,24 @@ void vLorawanClassATask( void * params )
     {
         configPRINTF( ( "Failed to initialize lorawan error = %d\r\n", status ) );
     }
+    else
+    {
+        LoRaWAN_GetRamBudget( &ramBudget );
+        configPRINTF( ( "RAM: LoRaMAC stack %lu, queues %lu, kernel objects %lu, timers %lu, log buffers %lu bytes, "
+                        "%lu static, %lu bytes of heap taken by the initialization, %lu free.\r\n",
+                        ( unsigned long ) ramBudget.stackBytes, ( unsigned long ) ramBudget.queueBytes,
+                        ( unsigned long ) ramBudget.kernelObjectBytes, ( unsigned long ) ramBudget.timerBytes,
+                        ( unsigned long ) ( configLOGGING_STATIC_BUFFERS * configLOGGING_MAX_MESSAGE_LENGTH ),
+                        ( unsigned long ) ramBudget.staticBytes, ( unsigned long ) ramBudget.initHeapBytes,
+                        ( unsigned long ) xPortGetFreeHeapSize() ) );
+
+        /* The events which need the task to wait for the network, such as a rejoin, stay in the event queue. */
+        ( void ) LoRaWAN_SetEventCallback( LORAWAN_EVENT_BIT( LORAWAN_EVENT_BEACON_LOCKED ) |
+                                           LORAWAN_EVENT_BIT( LORAWAN_EVENT_BEACON_LOST ) |
+                                           LORAWAN_EVENT_BIT( LORAWAN_EVENT_CLASS_CHANGED ) |
+                                           LORAWAN_EVENT_BIT( LORAWAN_EVENT_REJOINED ),
+                                           prvOnEvent, NULL );
+    }
 
     if( status == LORAMAC_STATUS_OK )
     {
@@ -170,11 +445,28 @@ void vLorawanClassATask( void * params )
     else
     {
         /*
-         * Adaptive data rate is set to ON by default but this can be changed runtime if needed
-         * for mobiled devices with no fixed locations.
+         * Adaptive data rate is set to ON by default. Mobile devices with no fixed locations adapt their data rate
+         * and transmit power themselves instead, from periodic link checks.
          */
+        if( LORAWAN_APPLICATION_MOBILE == 1 )
+        {
+            LoRaWAN_SetRateAdaptation( true );
+        }
+        else
+        {
+            LoRaWAN_SetAdaptiveDataRate( true );
+        }
+
+        if( LORAWAN_APPLICATION_DEVICE_CLASS != CLASS_A )
+        {
+            status = LoRaWAN_SetDeviceClass( LORAWAN_APPLICATION_DEVICE_CLASS );
 
-        LoRaWAN_SetAdaptiveDataRate( true );
+            if( status != LORAMAC_STATUS_OK )
+            {
+                configPRINTF( ( "Failed to request device class %d, error = %d. Staying in class A.\r\n", LORAWAN_APPLICATION_DEVICE_CLASS, status ) );
+                status = LORAMAC_STATUS_OK;
+            }
+        }
 
         /**
          * Successfully joined a LoRaWAN network. Now the  task runs in an infinite loop,
@@ -186,13 +478,38 @@ void vLorawanClassATask( void * params )
 
         configPRINTF( ( "Successfully joined a LoRaWAN network. Sending data in loop.\r\n" ) );
 
-        uplink.port = LORAWAN_APP_PORT;
-        uplink.length = 1;
-        uplink.data[ 0 ] = 0xFF;
         uplink.dataRate = 0;
 
+        /* Sent with the retransmissions needed for lorawanConfigDEFAULT_RELIABILITY. */
+        uplink.reliability = 0;
+
         for( ; ; )
         {
+            ulUplinks++;
+
+            if( ( LORAWAN_APPLICATION_ENERGY_REPORT_PERIOD > 0U ) &&
+                ( ( ulUplinks % LORAWAN_APPLICATION_ENERGY_REPORT_PERIOD ) == 0U ) )
+            {
+                LoRaWAN_GetEnergyReport( &energyReport );
+                uplink.port = LORAWAN_ENERGY_REPORT_PORT;
+                uplink.length = Energy_EncodeReport( &energyReport, uplink.data, sizeof( uplink.data ) );
+            }
+            else if( ( LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_PERIOD > 0U ) &&
+                     ( ( ulUplinks % LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_PERIOD ) ==
+                       ( LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_PERIOD / 2U ) ) )
+            {
+                LoRaWAN_GetMonitorReport( &xMonitorReport );
+                uplink.port = LORAWAN_DIAGNOSTICS_REPORT_PORT;
+                uplink.length = TaskMonitor_EncodeReport( &xMonitorReport, uplink.data,
+                                                          LORAWAN_APPLICATION_DIAGNOSTICS_REPORT_SIZE );
+            }
+            else
+            {
+                uplink.port = LORAWAN_APP_PORT;
+                uplink.length = 1;
+                uplink.data[ 0 ] = 0xFF;
+            }
+
             status = LoRaWAN_Send( &uplink, LORAWAN_CONFIRMED_SEND );
 
             if( status == LORAMAC_STATUS_OK )
@@ -204,7 +521,7 @@ void vLorawanClassATask( void * params )
 
                 if( LoRaWAN_Receive( &downlink, CLASSA_RECEIVE_WINDOW_DURATION_MS ) == pdTRUE )
                 {
-                    configPRINTF( ( "Received downlink data on port %d:\r\n", downlink.port ) );
+                    configPRINTF( ( "Received downlink data on port %d, RSSI %d dBm, SNR %d dB:\r\n", downlink.port, downlink.rssi, downlink.snr ) );
                     prvPrintHexBuffer( downlink.data, downlink.length );
                 }
                 else
@@ -226,6 +543,8 @@ void vLorawanClassATask( void * params )
                                 /**
                                  * MAC layer indicated there are pending acknowledgments to be sent
                                  * uplink as soon as possible. Wait for duty cycle time and send an uplink.
+                                 * Only received with lorawanConfigUPLINK_PIGGYBACK set to 0, the LoRaWAN layer
+                                 * sends it otherwise.
                                  */
                                 configPRINTF( ( "Received a downlink pending event. Send an empty uplink to fetch downlink packets.\r\n" ) );
                                 status = prvFetchDownlinkPacket();
@@ -235,11 +554,18 @@ void vLorawanClassATask( void * params )
 
                                 /**
                                  *  If LoRaMAC stack reports a too many frame loss event, it indicates that gateway and device frame counter
-                                 *  values are not in sync. The only way to recover from this is to initiate a rejoin procedure to reset
-                                 *  the frame counter at both sides.
+                                 *  values are not in sync. A Rejoin-Request of type 0 resets the frame counters at both sides on the
+                                 *  current data rate, keeping the device known to the network. A LoRaWAN 1.0 network does not answer
+                                 *  it, so a full join follows if it fails.
                                  */
                                 configPRINTF( ( "Too many frame loss detected. Rejoining to LoRaWAN network.\r\n" ) );
-                                status = LoRaWAN_Join();
+                                status = LoRaWAN_Rejoin( LORAWAN_REJOIN_TYPE_0 );
+
+                                if( status != LORAMAC_STATUS_OK )
+                                {
+                                    configPRINTF( ( "Rejoin-Request not answered, joining again.\r\n" ) );
+                                    status = LoRaWAN_Join();
+                                }
 
                                 if( status != LORAMAC_STATUS_OK )
                                 {
@@ -249,9 +575,47 @@ void vLorawanClassATask( void * params )
                                 break;
 
                             case LORAWAN_EVENT_DEVICE_TIME_UPDATED:
-                                configPRINTF( ( "Device time synchronized. \r\n" ) );
+
+                                if( ( event.status == LORAMAC_EVENT_INFO_STATUS_OK ) &&
+                                    ( LoRaWAN_GetGpsTime( &gpsTime ) == LORAMAC_STATUS_OK ) )
+                                {
+                                    configPRINTF( ( "Device time synchronized, GPS time %lu.%03lu s +/- %lu ms, drift %ld ppb.\r\n",
+                                                    ( unsigned long ) ( gpsTime.gpsTimeMs / 1000U ),
+                                                    ( unsigned long ) ( gpsTime.gpsTimeMs % 1000U ),
+                                                    ( unsigned long ) gpsTime.errorBoundMs,
+                                                    ( long ) ( gpsTime.driftPpm * 1000.0f ) ) );
+                                }
+                                else
+                                {
+                                    configPRINTF( ( "Device time synchronization failed.\r\n" ) );
+                                }
+
                                 break;
 
+                            case LORAWAN_EVENT_DATA_BLOCK_RECEIVED:
+
+                                /**
+                                 * The block decoded in the storage matched its CRC-32. Activating it boots the firmware it
+                                 * holds, or the firmware rebuilt from it when it is a delta patch, on boards with a storage
+                                 * which supports it, and does nothing otherwise.
+                                 */
+                                if( event.status == LORAMAC_EVENT_INFO_STATUS_OK )
+                                {
+                                    configPRINTF( ( "Data block of %lu bytes received in %u fragments out of %u. Activating it.\r\n",
+                                                    ( unsigned long ) event.info.dataBlock.size, event.info.dataBlock.nbReceived,
+                                                    event.info.dataBlock.nbFrag ) );
+
+                                    if( LoRaWAN_ActivateDataBlock() != LORAMAC_STATUS_OK )
+                                    {
+                                        configPRINTF( ( "Data block activation failed.\r\n" ) );
+                                    }
+                                }
+                                else
+                                {
+                                    configPRINTF( ( "Data block reception failed.\r\n" ) );
+                                }
+
+                                break;
 
                             default:
                                 configPRINTF( ( "Unhandled event type %d received.\r\n", event.type ) );
@@ -272,11 +636,23 @@ void vLorawanClassATask( void * params )
                      * access policy.
                      */
 
-                    ulTxIntervalMs = ( LORAWAN_APPLICATION_TX_INTERVAL_SEC * 1000 ) + randr( -LORAWAN_APPLICATION_JITTER_MS, LORAWAN_APPLICATION_JITTER_MS );
+                    #if ( LORAWAN_APPLICATION_SLOTTED_UPLINK == 1 )
+                        if( LoRaWAN_GetUplinkSlotDelay( LORAWAN_APPLICATION_TX_INTERVAL_SEC * 1000, &ulTxIntervalMs ) != LORAMAC_STATUS_OK )
+                    #endif
+                    {
+                        ulTxIntervalMs = ( LORAWAN_APPLICATION_TX_INTERVAL_SEC * 1000 ) + randr( -LORAWAN_APPLICATION_JITTER_MS, LORAWAN_APPLICATION_JITTER_MS );
+                    }
 
                     configPRINTF( ( "TX-RX cycle complete. Waiting for %u seconds, before starting next cycle.\r\n", ( ulTxIntervalMs / 1000 ) ) );
 
-                    vTaskDelay( pdMS_TO_TICKS( ulTxIntervalMs ) );
+                    /* MAC answers asked for in the meantime wait for the next uplink rather than taking a frame. */
+                    LoRaWAN_SetNextUplinkDelay( ulTxIntervalMs );
+
+                    #if ( LORAWAN_APPLICATION_PRINT_STATS == 1 )
+                        prvPrintStats();
+                    #endif
+
+                    prvWaitForNextCycle( ulTxIntervalMs );
                 }
                 else
                 {
@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "delta_patch.h"
+
+/* States of the patch parser. */
+#define deltaSTATE_HEADER          ( 0U )
+#define deltaSTATE_OP              ( 1U )
+#define deltaSTATE_ADD_LENGTH      ( 2U )
+#define deltaSTATE_ADD_OFFSET      ( 3U )
+#define deltaSTATE_ADD_ZEROS       ( 4U )
+#define deltaSTATE_ADD_LITERALS    ( 5U )
+#define deltaSTATE_ADD_BYTES       ( 6U )
+#define deltaSTATE_INSERT_LENGTH   ( 7U )
+#define deltaSTATE_INSERT_BYTES    ( 8U )
+#define deltaSTATE_END             ( 9U )
+
+/* States of the LZSS decompression. */
+#define deltaLZ_FLAG               ( 0U )
+#define deltaLZ_LITERAL            ( 1U )
+#define deltaLZ_REFERENCE          ( 2U )
+
+#define deltaWINDOW_MASK           ( ( 1U << DELTA_PATCH_WINDOW_BITS ) - 1U )
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadLittleEndian( const uint8_t * pData )
+{
+    return ( uint32_t ) pData[ 0 ] | ( ( uint32_t ) pData[ 1 ] << 8 ) | ( ( uint32_t ) pData[ 2 ] << 16 ) | ( ( uint32_t ) pData[ 3 ] << 24 );
+}
+/*-----------------------------------------------------------*/
+
+/* Returns the byte of the old image at the current position, through the cache. */
+static bool prvReadOld( DeltaPatch_t * pPatch,
+                        uint8_t * pByte )
+{
+    uint32_t length;
+
+    if( pPatch->oldPosition >= pPatch->oldSize )
+    {
+        pPatch->status = DELTA_PATCH_CORRUPTED;
+        return false;
+    }
+
+    if( ( pPatch->oldPosition < pPatch->cacheOffset ) ||
+        ( pPatch->oldPosition >= ( pPatch->cacheOffset + pPatch->cacheLength ) ) )
+    {
+        length = pPatch->oldSize - pPatch->oldPosition;
+
+        if( length > sizeof( pPatch->cache ) )
+        {
+            length = sizeof( pPatch->cache );
+        }
+
+        if( !pPatch->pOld->read( pPatch->oldPosition, pPatch->cache, length ) )
+        {
+            pPatch->status = DELTA_PATCH_STORAGE_ERROR;
+            return false;
+        }
+
+        pPatch->cacheOffset = pPatch->oldPosition;
+        pPatch->cacheLength = length;
+    }
+
+    *pByte = pPatch->cache[ pPatch->oldPosition - pPatch->cacheOffset ];
+    pPatch->oldPosition++;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvFlush( DeltaPatch_t * pPatch )
+{
+    if( pPatch->pageLength > 0U )
+    {
+        pPatch->crc = FragDecoder_Crc32( pPatch->crc, pPatch->page, pPatch->pageLength );
+
+        if( !pPatch->pNew->write( pPatch->newPosition - pPatch->pageLength, pPatch->page, pPatch->pageLength ) )
+        {
+            pPatch->status = DELTA_PATCH_STORAGE_ERROR;
+            return false;
+        }
+
+        pPatch->pageLength = 0;
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvOutput( DeltaPatch_t * pPatch,
+                       uint8_t byte )
+{
+    if( pPatch->newPosition >= pPatch->newSize )
+    {
+        pPatch->status = DELTA_PATCH_CORRUPTED;
+        return false;
+    }
+
+    pPatch->page[ pPatch->pageLength++ ] = byte;
+    pPatch->newPosition++;
+
+    if( pPatch->pageLength == sizeof( pPatch->page ) )
+    {
+        return prvFlush( pPatch );
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/* Decodes a varint byte by byte, returns true once the value is complete. */
+static bool prvParseVarint( DeltaPatch_t * pPatch,
+                            uint8_t byte )
+{
+    if( pPatch->varintShift > 28U )
+    {
+        pPatch->status = DELTA_PATCH_CORRUPTED;
+        return false;
+    }
+
+    pPatch->varint |= ( uint32_t ) ( byte & 0x7FU ) << pPatch->varintShift;
+    pPatch->varintShift += 7U;
+
+    if( ( byte & 0x80U ) != 0U )
+    {
+        return false;
+    }
+
+    pPatch->varintShift = 0;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/* Checks the header, and that the old image is the one the patch was made from. */
+static void prvProcessHeader( DeltaPatch_t * pPatch )
+{
+    uint32_t crc = 0;
+    uint32_t offset;
+    uint32_t length;
+
+    pPatch->oldSize = prvReadLittleEndian( &pPatch->header[ 4 ] );
+    pPatch->newSize = prvReadLittleEndian( &pPatch->header[ 12 ] );
+    pPatch->newCrc = prvReadLittleEndian( &pPatch->header[ 16 ] );
+
+    if( !DeltaPatch_IsPatch( pPatch->header, DELTA_PATCH_HEADER_SIZE ) ||
+        ( pPatch->newSize > pPatch->pNew->size ) )
+    {
+        pPatch->status = DELTA_PATCH_CORRUPTED;
+        return;
+    }
+
+    if( pPatch->oldSize > pPatch->pOld->size )
+    {
+        pPatch->status = DELTA_PATCH_WRONG_BASE;
+        return;
+    }
+
+    for( offset = 0; offset < pPatch->oldSize; offset += length )
+    {
+        length = pPatch->oldSize - offset;
+
+        if( length > sizeof( pPatch->cache ) )
+        {
+            length = sizeof( pPatch->cache );
+        }
+
+        if( !pPatch->pOld->read( offset, pPatch->cache, length ) )
+        {
+            pPatch->status = DELTA_PATCH_STORAGE_ERROR;
+            return;
+        }
+
+        crc = FragDecoder_Crc32( crc, pPatch->cache, length );
+    }
+
+    pPatch->cacheLength = 0;
+
+    if( crc != prvReadLittleEndian( &pPatch->header[ 8 ] ) )
+    {
+        pPatch->status = DELTA_PATCH_WRONG_BASE;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvProcessOp( DeltaPatch_t * pPatch,
+                          uint8_t op )
+{
+    switch( op )
+    {
+        case DELTA_PATCH_OP_END:
+
+            if( prvFlush( pPatch ) )
+            {
+                if( ( pPatch->newPosition == pPatch->newSize ) && ( pPatch->crc == pPatch->newCrc ) )
+                {
+                    pPatch->status = DELTA_PATCH_DONE;
+                }
+                else
+                {
+                    pPatch->status = DELTA_PATCH_CORRUPTED;
+                }
+            }
+
+            pPatch->state = deltaSTATE_END;
+            break;
+
+        case DELTA_PATCH_OP_ADD:
+            pPatch->state = deltaSTATE_ADD_LENGTH;
+            break;
+
+        case DELTA_PATCH_OP_INSERT:
+            pPatch->state = deltaSTATE_INSERT_LENGTH;
+            break;
+
+        default:
+            pPatch->status = DELTA_PATCH_CORRUPTED;
+            break;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Starts a run of unchanged bytes of an ADD, and copies them from the old image. */
+static void prvProcessZeros( DeltaPatch_t * pPatch,
+                             uint32_t run )
+{
+    uint8_t byte;
+
+    if( run > pPatch->opLength )
+    {
+        pPatch->status = DELTA_PATCH_CORRUPTED;
+        return;
+    }
+
+    pPatch->opLength -= run;
+
+    while( run > 0U )
+    {
+        if( !prvReadOld( pPatch, &byte ) || !prvOutput( pPatch, byte ) )
+        {
+            return;
+        }
+
+        run--;
+    }
+
+    pPatch->state = ( pPatch->opLength == 0U ) ? deltaSTATE_OP : deltaSTATE_ADD_LITERALS;
+}
+/*-----------------------------------------------------------*/
+
+static void prvProcessByte( DeltaPatch_t * pPatch,
+                            uint8_t byte )
+{
+    uint32_t value;
+    uint8_t old;
+
+    switch( pPatch->state )
+    {
+        case deltaSTATE_HEADER:
+            pPatch->header[ pPatch->headerLength++ ] = byte;
+
+            if( pPatch->headerLength == DELTA_PATCH_HEADER_SIZE )
+            {
+                prvProcessHeader( pPatch );
+                pPatch->state = deltaSTATE_OP;
+            }
+
+            break;
+
+        case deltaSTATE_OP:
+            prvProcessOp( pPatch, byte );
+            break;
+
+        case deltaSTATE_END:
+            break;
+
+        case deltaSTATE_ADD_BYTES:
+
+            if( prvReadOld( pPatch, &old ) && prvOutput( pPatch, ( uint8_t ) ( old + byte ) ) )
+            {
+                pPatch->opLength--;
+                pPatch->runLength--;
+
+                if( pPatch->runLength == 0U )
+                {
+                    pPatch->state = ( pPatch->opLength == 0U ) ? deltaSTATE_OP : deltaSTATE_ADD_ZEROS;
+                }
+            }
+
+            break;
+
+        case deltaSTATE_INSERT_BYTES:
+
+            if( prvOutput( pPatch, byte ) )
+            {
+                pPatch->opLength--;
+
+                if( pPatch->opLength == 0U )
+                {
+                    pPatch->state = deltaSTATE_OP;
+                }
+            }
+
+            break;
+
+        default:
+
+            /* All the other states decode a varint. */
+            if( !prvParseVarint( pPatch, byte ) )
+            {
+                break;
+            }
+
+            value = pPatch->varint;
+            pPatch->varint = 0;
+
+            if( pPatch->state == deltaSTATE_ADD_LENGTH )
+            {
+                pPatch->opLength = value;
+                pPatch->state = deltaSTATE_ADD_OFFSET;
+            }
+            else if( pPatch->state == deltaSTATE_ADD_OFFSET )
+            {
+                /* Zigzag encoding: the sign is in the lowest bit. */
+                pPatch->oldPosition += ( ( value & 1U ) != 0U ) ? ~( value >> 1 ) : ( value >> 1 );
+
+                if( ( pPatch->oldPosition > pPatch->oldSize ) ||
+                    ( pPatch->opLength > ( pPatch->oldSize - pPatch->oldPosition ) ) )
+                {
+                    pPatch->status = DELTA_PATCH_CORRUPTED;
+                }
+
+                pPatch->state = ( pPatch->opLength == 0U ) ? deltaSTATE_OP : deltaSTATE_ADD_ZEROS;
+            }
+            else if( pPatch->state == deltaSTATE_ADD_ZEROS )
+            {
+                prvProcessZeros( pPatch, value );
+            }
+            else if( pPatch->state == deltaSTATE_ADD_LITERALS )
+            {
+                if( ( value == 0U ) || ( value > pPatch->opLength ) )
+                {
+                    pPatch->status = DELTA_PATCH_CORRUPTED;
+                }
+
+                pPatch->runLength = value;
+                pPatch->state = deltaSTATE_ADD_BYTES;
+            }
+            else
+            {
+                pPatch->opLength = value;
+                pPatch->state = ( value == 0U ) ? deltaSTATE_OP : deltaSTATE_INSERT_BYTES;
+            }
+
+            break;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvUnpack( DeltaPatch_t * pPatch,
+                       uint8_t byte )
+{
+    pPatch->window[ pPatch->windowPosition ] = byte;
+    pPatch->windowPosition = ( pPatch->windowPosition + 1U ) & deltaWINDOW_MASK;
+    prvProcessByte( pPatch, byte );
+}
+/*-----------------------------------------------------------*/
+
+/* Decompresses the operations, with the bits of a new byte of the patch. */
+static void prvDecompress( DeltaPatch_t * pPatch,
+                           uint8_t byte )
+{
+    uint32_t need;
+    uint32_t value;
+    uint32_t distance;
+    uint32_t length;
+
+    pPatch->bits = ( pPatch->bits << 8 ) | byte;
+    pPatch->bitCount += 8U;
+
+    while( pPatch->status == DELTA_PATCH_ONGOING )
+    {
+        need = ( pPatch->lzState == deltaLZ_FLAG ) ? 1U :
+               ( pPatch->lzState == deltaLZ_LITERAL ) ? 8U : ( DELTA_PATCH_WINDOW_BITS + DELTA_PATCH_LENGTH_BITS );
+
+        if( pPatch->bitCount < need )
+        {
+            break;
+        }
+
+        pPatch->bitCount -= ( uint8_t ) need;
+        value = ( pPatch->bits >> pPatch->bitCount ) & ( ( 1U << need ) - 1U );
+
+        if( pPatch->lzState == deltaLZ_FLAG )
+        {
+            pPatch->lzState = ( value != 0U ) ? deltaLZ_LITERAL : deltaLZ_REFERENCE;
+        }
+        else if( pPatch->lzState == deltaLZ_LITERAL )
+        {
+            prvUnpack( pPatch, ( uint8_t ) value );
+            pPatch->lzState = deltaLZ_FLAG;
+        }
+        else
+        {
+            distance = ( value >> DELTA_PATCH_LENGTH_BITS ) + 1U;
+            length = ( value & ( ( 1U << DELTA_PATCH_LENGTH_BITS ) - 1U ) ) + DELTA_PATCH_MIN_MATCH;
+
+            while( ( length > 0U ) && ( pPatch->status == DELTA_PATCH_ONGOING ) )
+            {
+                prvUnpack( pPatch, pPatch->window[ ( pPatch->windowPosition - distance ) & deltaWINDOW_MASK ] );
+                length--;
+            }
+
+            pPatch->lzState = deltaLZ_FLAG;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+bool DeltaPatch_IsPatch( const uint8_t * pData,
+                         size_t length )
+{
+    return ( length >= 4U ) && ( memcmp( pData, DELTA_PATCH_MAGIC, 4 ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+void DeltaPatch_Init( DeltaPatch_t * pPatch,
+                      const FragDecoderStorage_t * pOld,
+                      const FragDecoderStorage_t * pNew )
+{
+    memset( pPatch, 0, sizeof( DeltaPatch_t ) );
+
+    pPatch->pOld = pOld;
+    pPatch->pNew = pNew;
+    pPatch->status = DELTA_PATCH_ONGOING;
+    pPatch->state = deltaSTATE_HEADER;
+}
+/*-----------------------------------------------------------*/
+
+DeltaPatchStatus_t DeltaPatch_Process( DeltaPatch_t * pPatch,
+                                       const uint8_t * pData,
+                                       size_t length )
+{
+    size_t i;
+
+    for( i = 0; ( i < length ) && ( pPatch->status == DELTA_PATCH_ONGOING ); i++ )
+    {
+        /* Only the operations are compressed. */
+        if( pPatch->state == deltaSTATE_HEADER )
+        {
+            prvProcessByte( pPatch, pData[ i ] );
+        }
+        else
+        {
+            prvDecompress( pPatch, pData[ i ] );
+        }
+    }
+
+    return pPatch->status;
+}
+/*-----------------------------------------------------------*/
+
+DeltaPatchStatus_t DeltaPatch_Apply( DeltaPatch_t * pPatch,
+                                     const FragDecoderStorage_t * pStorage,
+                                     uint32_t offset,
+                                     uint32_t size )
+{
+    uint8_t chunk[ 64 ];
+    uint32_t length;
+
+    while( ( size > 0U ) && ( pPatch->status == DELTA_PATCH_ONGOING ) )
+    {
+        length = ( size > sizeof( chunk ) ) ? sizeof( chunk ) : size;
+
+        if( !pStorage->read( offset, chunk, length ) )
+        {
+            pPatch->status = DELTA_PATCH_STORAGE_ERROR;
+            break;
+        }
+
+        ( void ) DeltaPatch_Process( pPatch, chunk, length );
+        offset += length;
+        size -= length;
+    }
+
+    if( pPatch->status == DELTA_PATCH_ONGOING )
+    {
+        /* The patch ended before its END operation. */
+        pPatch->status = DELTA_PATCH_CORRUPTED;
+    }
+
+    return pPatch->status;
+}
+/*-----------------------------------------------------------*/
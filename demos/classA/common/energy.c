@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "energy.h"
+
+/**
+ * @brief Charge of 1 uAh in nA ms.
+ */
+#define ENERGY_NAMS_PER_UAH    ( 3.6e9f )
+
+/**
+ * @brief Point of the transmit current curve.
+ */
+typedef struct EnergyTxPoint
+{
+    int8_t power;       /**< @brief Output power in dBm. */
+    float currentUa;    /**< @brief Current drawn in uA. */
+} EnergyTxPoint_t;
+
+static const EnergyTxPoint_t xTxPoints[] = lorawanConfigENERGY_TX_POWER_POINTS;
+
+static const char * const pCategoryNames[ ENERGY_CATEGORIES ] =
+{
+    "MCU run",
+    "MCU sleep",
+    "radio sleep",
+    "radio standby",
+    "radio TX",
+    "radio RX",
+    "SPI",
+    "log"
+};
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvToNa( float currentUa )
+{
+    return ( uint64_t ) ( currentUa * 1000.0f );
+}
+/*-----------------------------------------------------------*/
+
+static float prvGetStateCurrent( const Energy_t * pEnergy )
+{
+    float currentUa;
+
+    switch( pEnergy->radioState )
+    {
+        case ENERGY_RADIO_STANDBY:
+            currentUa = lorawanConfigENERGY_RADIO_STANDBY_UA;
+            break;
+
+        case ENERGY_RADIO_TX:
+            currentUa = Energy_GetTxCurrent( pEnergy->txPower );
+            break;
+
+        case ENERGY_RADIO_RX:
+            currentUa = lorawanConfigENERGY_RADIO_RX_UA;
+            break;
+
+        default:
+            currentUa = lorawanConfigENERGY_RADIO_SLEEP_UA;
+            break;
+    }
+
+    return currentUa;
+}
+/*-----------------------------------------------------------*/
+
+/* Charges the state of the radio up to nowMs. */
+static void prvUpdate( Energy_t * pEnergy,
+                       uint32_t nowMs )
+{
+    uint32_t deltaMs = nowMs - pEnergy->lastMs;
+
+    pEnergy->radioNaMs[ pEnergy->radioState ] += ( uint64_t ) deltaMs * prvToNa( prvGetStateCurrent( pEnergy ) );
+    pEnergy->elapsedMs += deltaMs;
+    pEnergy->lastMs = nowMs;
+}
+/*-----------------------------------------------------------*/
+
+/* Charges of the categories in nA ms up to nowMs, without updating the accounting. */
+static void prvGetCharges( const Energy_t * pEnergy,
+                           uint32_t nowMs,
+                           uint64_t * pCharges,
+                           uint64_t * pElapsedMs )
+{
+    Energy_t energy = *pEnergy;
+    uint64_t runUs;
+    uint32_t state;
+
+    prvUpdate( &energy, nowMs );
+
+    /* The sleep is reported when it ends, the tick may have been stepped a little before. */
+    runUs = energy.elapsedMs * 1000U;
+    runUs = ( ( runUs > energy.mcuSleepUs ) ? ( runUs - energy.mcuSleepUs ) : 0U ) + energy.mcuActiveUs;
+
+    pCharges[ ENERGY_CATEGORY_MCU_RUN ] = ( runUs * prvToNa( lorawanConfigENERGY_MCU_RUN_UA ) ) / 1000U;
+    pCharges[ ENERGY_CATEGORY_MCU_SLEEP ] = ( energy.mcuSleepUs * prvToNa( lorawanConfigENERGY_MCU_SLEEP_UA ) ) / 1000U;
+
+    for( state = 0; state < ( uint32_t ) ENERGY_RADIO_STATES; state++ )
+    {
+        pCharges[ ENERGY_CATEGORY_RADIO_SLEEP + state ] = energy.radioNaMs[ state ];
+    }
+
+    pCharges[ ENERGY_CATEGORY_SPI ] = ( uint64_t ) ( ( float ) energy.spiBytes * lorawanConfigENERGY_SPI_US_PER_BYTE *
+                                                     lorawanConfigENERGY_SPI_UA );
+    pCharges[ ENERGY_CATEGORY_LOG ] = ( uint64_t ) ( ( float ) energy.logBytes * lorawanConfigENERGY_LOG_US_PER_BYTE *
+                                                     lorawanConfigENERGY_LOG_UA );
+    *pElapsedMs = energy.elapsedMs;
+}
+/*-----------------------------------------------------------*/
+
+static uint16_t prvSaturate( float value )
+{
+    return ( value >= 65535.0f ) ? 0xFFFFU : ( uint16_t ) ( value + 0.5f );
+}
+/*-----------------------------------------------------------*/
+
+float Energy_GetTxCurrent( int8_t power )
+{
+    size_t count = sizeof( xTxPoints ) / sizeof( xTxPoints[ 0 ] );
+    size_t i;
+    float currentUa = xTxPoints[ count - 1U ].currentUa;
+
+    if( power <= xTxPoints[ 0 ].power )
+    {
+        currentUa = xTxPoints[ 0 ].currentUa;
+    }
+    else
+    {
+        for( i = 1; i < count; i++ )
+        {
+            if( power <= xTxPoints[ i ].power )
+            {
+                currentUa = xTxPoints[ i - 1U ].currentUa +
+                            ( ( xTxPoints[ i ].currentUa - xTxPoints[ i - 1U ].currentUa ) *
+                              ( float ) ( power - xTxPoints[ i - 1U ].power ) /
+                              ( float ) ( xTxPoints[ i ].power - xTxPoints[ i - 1U ].power ) );
+                break;
+            }
+        }
+    }
+
+    return currentUa;
+}
+/*-----------------------------------------------------------*/
+
+const char * Energy_GetCategoryName( EnergyCategory_t category )
+{
+    return ( category < ENERGY_CATEGORIES ) ? pCategoryNames[ category ] : "";
+}
+/*-----------------------------------------------------------*/
+
+void Energy_Init( Energy_t * pEnergy,
+                  uint32_t nowMs )
+{
+    memset( pEnergy, 0, sizeof( Energy_t ) );
+    pEnergy->lastMs = nowMs;
+    pEnergy->radioState = ENERGY_RADIO_SLEEP;
+    pEnergy->txPower = xTxPoints[ 0 ].power;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_SetRadioState( Energy_t * pEnergy,
+                           EnergyRadioState_t state,
+                           uint32_t nowMs )
+{
+    prvUpdate( pEnergy, nowMs );
+    pEnergy->radioState = state;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_SetTxPower( Energy_t * pEnergy,
+                        int8_t power,
+                        uint32_t nowMs )
+{
+    prvUpdate( pEnergy, nowMs );
+    pEnergy->txPower = power;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_AddMcuSleep( Energy_t * pEnergy,
+                         uint32_t sleepUs )
+{
+    pEnergy->mcuSleepUs += sleepUs;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_AddMcuActive( Energy_t * pEnergy,
+                          uint32_t activeUs )
+{
+    pEnergy->mcuActiveUs += activeUs;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_AddSpiBytes( Energy_t * pEnergy,
+                         uint32_t bytes )
+{
+    pEnergy->spiBytes += bytes;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_AddLogBytes( Energy_t * pEnergy,
+                         uint32_t bytes )
+{
+    pEnergy->logBytes += bytes;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_StartCycle( Energy_t * pEnergy,
+                        uint32_t nowMs )
+{
+    uint64_t charges[ ENERGY_CATEGORIES ];
+    uint64_t elapsedMs;
+    uint32_t i;
+
+    prvUpdate( pEnergy, nowMs );
+    prvGetCharges( pEnergy, nowMs, charges, &elapsedMs );
+
+    for( i = 0; i < ( uint32_t ) ENERGY_CATEGORIES; i++ )
+    {
+        pEnergy->cycleNaMs[ i ] = ( charges[ i ] > pEnergy->cycleStartNaMs[ i ] ) ?
+                                  ( charges[ i ] - pEnergy->cycleStartNaMs[ i ] ) : 0U;
+        pEnergy->cycleStartNaMs[ i ] = charges[ i ];
+    }
+
+    pEnergy->cycleMs = ( uint32_t ) ( elapsedMs - pEnergy->cycleStartMs );
+    pEnergy->cycleStartMs = elapsedMs;
+    pEnergy->cycles++;
+}
+/*-----------------------------------------------------------*/
+
+void Energy_GetReport( const Energy_t * pEnergy,
+                       uint32_t nowMs,
+                       EnergyReport_t * pReport )
+{
+    uint64_t charges[ ENERGY_CATEGORIES ];
+    uint64_t elapsedMs;
+    uint32_t i;
+
+    memset( pReport, 0, sizeof( EnergyReport_t ) );
+    prvGetCharges( pEnergy, nowMs, charges, &elapsedMs );
+
+    for( i = 0; i < ( uint32_t ) ENERGY_CATEGORIES; i++ )
+    {
+        pReport->chargeUah[ i ] = ( float ) charges[ i ] / ENERGY_NAMS_PER_UAH;
+        pReport->totalUah += pReport->chargeUah[ i ];
+        pReport->cycleUah[ i ] = ( float ) pEnergy->cycleNaMs[ i ] / ENERGY_NAMS_PER_UAH;
+        pReport->cycleTotalUah += pReport->cycleUah[ i ];
+    }
+
+    if( elapsedMs > 0U )
+    {
+        pReport->averageUa = pReport->totalUah * 3.6e6f / ( float ) elapsedMs;
+    }
+
+    if( pReport->averageUa > 0.0f )
+    {
+        pReport->batteryDays = ( lorawanConfigENERGY_BATTERY_MAH * 1000.0f ) / pReport->averageUa / 24.0f;
+    }
+
+    pReport->elapsedMs = ( uint32_t ) elapsedMs;
+    pReport->cycleMs = pEnergy->cycleMs;
+    pReport->cycles = pEnergy->cycles;
+}
+/*-----------------------------------------------------------*/
+
+size_t Energy_EncodeReport( const EnergyReport_t * pReport,
+                            uint8_t * pBuffer,
+                            size_t length )
+{
+    uint16_t value;
+    float share;
+    uint32_t i;
+
+    if( length < ENERGY_REPORT_SIZE )
+    {
+        return 0;
+    }
+
+    value = prvSaturate( pReport->averageUa * 10.0f );
+    pBuffer[ 0 ] = ( uint8_t ) value;
+    pBuffer[ 1 ] = ( uint8_t ) ( value >> 8 );
+    value = prvSaturate( pReport->cycleTotalUah * 10.0f );
+    pBuffer[ 2 ] = ( uint8_t ) value;
+    pBuffer[ 3 ] = ( uint8_t ) ( value >> 8 );
+
+    for( i = 0; i < ( uint32_t ) ENERGY_CATEGORY_LOG; i++ )
+    {
+        share = ( pReport->cycleTotalUah > 0.0f ) ? ( ( pReport->cycleUah[ i ] * 200.0f ) / pReport->cycleTotalUah ) : 0.0f;
+        pBuffer[ 4U + i ] = ( uint8_t ) ( ( share >= 200.0f ) ? 200U : ( uint32_t ) ( share + 0.5f ) );
+    }
+
+    return ENERGY_REPORT_SIZE;
+}
+/*-----------------------------------------------------------*/
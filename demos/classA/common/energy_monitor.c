@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "energy_monitor.h"
+
+/**
+ * @brief Accounting of the device, valid zeroed: the radio asleep at tick 0.
+ */
+static Energy_t xEnergy;
+
+/**
+ * @brief SPI bytes counted without a critical section, as the SPI driver reports each byte, and those already added to
+ * the accounting. The transfers with the radio are serialized by its driver.
+ */
+static volatile uint32_t ulSpiBytes = 0;
+static uint32_t ulSpiBytesAdded = 0;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNowMs( void )
+{
+    TickType_t xTicks = ( xPortIsInsideInterrupt() == pdTRUE ) ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+
+    return ( uint32_t ) ( xTicks * portTICK_PERIOD_MS );
+}
+/*-----------------------------------------------------------*/
+
+/* The radio drivers change state from tasks and interrupts, the tickless idle with interrupts disabled. */
+static UBaseType_t prvEnterCritical( void )
+{
+    UBaseType_t uxSavedInterruptStatus = 0;
+
+    if( xPortIsInsideInterrupt() == pdTRUE )
+    {
+        uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+    }
+
+    return uxSavedInterruptStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvExitCritical( UBaseType_t uxSavedInterruptStatus )
+{
+    if( xPortIsInsideInterrupt() == pdTRUE )
+    {
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Adds the SPI bytes counted since the last call, in a critical section. */
+static void prvAddSpiBytes( void )
+{
+    uint32_t ulBytes = ulSpiBytes;
+
+    Energy_AddSpiBytes( &xEnergy, ulBytes - ulSpiBytesAdded );
+    ulSpiBytesAdded = ulBytes;
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_SetRadioState( EnergyRadioState_t state )
+{
+    UBaseType_t uxSavedInterruptStatus = prvEnterCritical();
+
+    if( state != xEnergy.radioState )
+    {
+        Energy_SetRadioState( &xEnergy, state, prvNowMs() );
+    }
+
+    prvExitCritical( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_SetTxPower( int8_t power )
+{
+    UBaseType_t uxSavedInterruptStatus = prvEnterCritical();
+
+    Energy_SetTxPower( &xEnergy, power, prvNowMs() );
+
+    prvExitCritical( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_AddMcuSleep( uint32_t sleepUs )
+{
+    UBaseType_t uxSavedInterruptStatus = prvEnterCritical();
+
+    Energy_AddMcuSleep( &xEnergy, sleepUs );
+
+    prvExitCritical( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_AddMcuActive( uint32_t activeUs )
+{
+    UBaseType_t uxSavedInterruptStatus = prvEnterCritical();
+
+    Energy_AddMcuActive( &xEnergy, activeUs );
+
+    prvExitCritical( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_AddSpiBytes( uint32_t bytes )
+{
+    ulSpiBytes += bytes;
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_AddLogBytes( uint32_t bytes )
+{
+    UBaseType_t uxSavedInterruptStatus = prvEnterCritical();
+
+    Energy_AddLogBytes( &xEnergy, bytes );
+
+    prvExitCritical( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_StartCycle( void )
+{
+    UBaseType_t uxSavedInterruptStatus = prvEnterCritical();
+
+    prvAddSpiBytes();
+    Energy_StartCycle( &xEnergy, prvNowMs() );
+
+    prvExitCritical( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void EnergyMonitor_GetReport( EnergyReport_t * pReport )
+{
+    Energy_t energy;
+    UBaseType_t uxSavedInterruptStatus = prvEnterCritical();
+
+    prvAddSpiBytes();
+    energy = xEnergy;
+
+    prvExitCritical( uxSavedInterruptStatus );
+
+    Energy_GetReport( &energy, prvNowMs(), pReport );
+}
+/*-----------------------------------------------------------*/
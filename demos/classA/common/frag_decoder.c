@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "frag_decoder.h"
+
+#define fragBIT_GET( array, bit )    ( ( ( array )[ ( bit ) >> 3 ] >> ( ( bit ) & 7U ) ) & 1U )
+#define fragBIT_SET( array, bit )    ( ( array )[ ( bit ) >> 3 ] |= ( uint8_t ) ( 1U << ( ( bit ) & 7U ) ) )
+
+/*-----------------------------------------------------------*/
+
+/* Pseudo random binary sequence of the TS004 parity matrix. */
+static uint32_t prvPrbs23( uint32_t x )
+{
+    uint32_t b0 = x & 1U;
+    uint32_t b1 = ( x & 32U ) >> 5;
+
+    return ( x >> 1 ) + ( ( b0 ^ b1 ) << 22 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvXor( uint8_t * pDst,
+                    const uint8_t * pSrc,
+                    size_t length )
+{
+    size_t i;
+
+    for( i = 0; i < length; i++ )
+    {
+        pDst[ i ] ^= pSrc[ i ];
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Returns the uncoded fragment, from 0, of lost fragment lostIndex. */
+static uint16_t prvGetLostFragment( const FragDecoder_t * pDecoder,
+                                    uint16_t lostIndex )
+{
+    uint16_t i;
+
+    for( i = 0; i < pDecoder->nbFrag; i++ )
+    {
+        if( fragBIT_GET( pDecoder->received, i ) == 0U )
+        {
+            if( lostIndex == 0U )
+            {
+                break;
+            }
+
+            lostIndex--;
+        }
+    }
+
+    return i;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvRead( FragDecoder_t * pDecoder,
+                     uint16_t fragment,
+                     uint8_t * pData )
+{
+    return pDecoder->pStorage->read( ( uint32_t ) fragment * pDecoder->fragSize, pData, pDecoder->fragSize );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvWrite( FragDecoder_t * pDecoder,
+                      uint16_t fragment,
+                      const uint8_t * pData )
+{
+    return pDecoder->pStorage->write( ( uint32_t ) fragment * pDecoder->fragSize, pData, pDecoder->fragSize );
+}
+/*-----------------------------------------------------------*/
+
+/* Starts the coded phase: the uncoded fragments not received by now are the lost ones, the columns of the matrix. */
+static void prvStartCoded( FragDecoder_t * pDecoder )
+{
+    uint16_t i;
+
+    pDecoder->coded = true;
+    pDecoder->nbLost = 0;
+
+    for( i = 0; i < pDecoder->nbFrag; i++ )
+    {
+        if( fragBIT_GET( pDecoder->received, i ) == 0U )
+        {
+            pDecoder->nbLost++;
+        }
+    }
+
+    if( pDecoder->nbLost > lorawanConfigFRAG_MAX_REDUNDANCY )
+    {
+        pDecoder->status = FRAG_DECODER_TOO_MANY_LOST;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Builds the vector of lost fragments the fragment in data depends on, and removes the received fragments from data.
+ * parity holds the uncoded fragments the fragment combines.
+ */
+static bool prvReduceReceived( FragDecoder_t * pDecoder )
+{
+    uint16_t lostIndex = 0;
+    uint16_t i;
+
+    memset( pDecoder->vector, 0, sizeof( pDecoder->vector ) );
+
+    for( i = 0; i < pDecoder->nbFrag; i++ )
+    {
+        if( fragBIT_GET( pDecoder->received, i ) != 0U )
+        {
+            if( fragBIT_GET( pDecoder->parity, i ) != 0U )
+            {
+                if( prvRead( pDecoder, i, pDecoder->scratch ) == false )
+                {
+                    return false;
+                }
+
+                prvXor( pDecoder->data, pDecoder->scratch, pDecoder->fragSize );
+            }
+        }
+        else
+        {
+            if( fragBIT_GET( pDecoder->parity, i ) != 0U )
+            {
+                fragBIT_SET( pDecoder->vector, lostIndex );
+            }
+
+            lostIndex++;
+        }
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Eliminates the lost fragments which already have a row from the vector. The vector then either is empty, and the
+ * fragment brings nothing new, or becomes the row of its first lost fragment, whose place stores the reduced data.
+ */
+static bool prvEliminate( FragDecoder_t * pDecoder )
+{
+    uint16_t col;
+
+    for( col = 0; col < pDecoder->nbLost; col++ )
+    {
+        if( fragBIT_GET( pDecoder->vector, col ) == 0U )
+        {
+            continue;
+        }
+
+        if( fragBIT_GET( pDecoder->rowDefined, col ) == 0U )
+        {
+            memcpy( pDecoder->matrix[ col ], pDecoder->vector, sizeof( pDecoder->vector ) );
+            fragBIT_SET( pDecoder->rowDefined, col );
+            pDecoder->rank++;
+
+            return prvWrite( pDecoder, prvGetLostFragment( pDecoder, col ), pDecoder->data );
+        }
+
+        prvXor( pDecoder->vector, pDecoder->matrix[ col ], sizeof( pDecoder->vector ) );
+
+        if( prvRead( pDecoder, prvGetLostFragment( pDecoder, col ), pDecoder->scratch ) == false )
+        {
+            return false;
+        }
+
+        prvXor( pDecoder->data, pDecoder->scratch, pDecoder->fragSize );
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/* Once the matrix is full, recovers the lost fragments from the last one, which depends on no other, to the first. */
+static bool prvSubstitute( FragDecoder_t * pDecoder )
+{
+    uint16_t col = pDecoder->nbLost;
+    uint16_t other;
+
+    while( col > 0U )
+    {
+        col--;
+
+        if( prvRead( pDecoder, prvGetLostFragment( pDecoder, col ), pDecoder->data ) == false )
+        {
+            return false;
+        }
+
+        for( other = col + 1U; other < pDecoder->nbLost; other++ )
+        {
+            if( fragBIT_GET( pDecoder->matrix[ col ], other ) != 0U )
+            {
+                if( prvRead( pDecoder, prvGetLostFragment( pDecoder, other ), pDecoder->scratch ) == false )
+                {
+                    return false;
+                }
+
+                prvXor( pDecoder->data, pDecoder->scratch, pDecoder->fragSize );
+            }
+        }
+
+        if( prvWrite( pDecoder, prvGetLostFragment( pDecoder, col ), pDecoder->data ) == false )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+bool FragDecoder_Init( FragDecoder_t * pDecoder,
+                       uint16_t nbFrag,
+                       uint8_t fragSize,
+                       const FragDecoderStorage_t * pStorage )
+{
+    memset( pDecoder, 0, sizeof( FragDecoder_t ) );
+
+    if( ( nbFrag == 0U ) || ( nbFrag > lorawanConfigFRAG_MAX_NB ) || ( fragSize == 0U ) ||
+        ( fragSize > lorawanConfigFRAG_MAX_SIZE ) || ( pStorage == NULL ) ||
+        ( pStorage->size < ( ( uint32_t ) nbFrag * fragSize ) ) )
+    {
+        return false;
+    }
+
+    pDecoder->pStorage = pStorage;
+    pDecoder->nbFrag = nbFrag;
+    pDecoder->fragSize = fragSize;
+    pDecoder->status = FRAG_DECODER_ONGOING;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+FragDecoderStatus_t FragDecoder_Process( FragDecoder_t * pDecoder,
+                                         uint16_t counter,
+                                         const uint8_t * pData )
+{
+    bool ok = true;
+
+    if( ( pDecoder->status != FRAG_DECODER_ONGOING ) || ( counter == 0U ) )
+    {
+        return pDecoder->status;
+    }
+
+    if( ( counter <= pDecoder->nbFrag ) && ( pDecoder->coded == false ) )
+    {
+        /* Uncoded fragment, written in place. */
+        if( fragBIT_GET( pDecoder->received, counter - 1U ) == 0U )
+        {
+            ok = prvWrite( pDecoder, counter - 1U, pData );
+            fragBIT_SET( pDecoder->received, counter - 1U );
+            pDecoder->nbReceived++;
+
+            if( pDecoder->nbReceived == pDecoder->nbFrag )
+            {
+                pDecoder->status = FRAG_DECODER_DONE;
+            }
+        }
+    }
+    else if( ( counter > pDecoder->lastCounter ) || ( counter <= pDecoder->nbFrag ) )
+    {
+        if( pDecoder->coded == false )
+        {
+            prvStartCoded( pDecoder );
+        }
+
+        pDecoder->nbReceived++;
+
+        if( pDecoder->status != FRAG_DECODER_ONGOING )
+        {
+            return pDecoder->status;
+        }
+
+        /* An uncoded fragment received late depends on itself only, and brings nothing if it was received already. */
+        if( counter <= pDecoder->nbFrag )
+        {
+            memset( pDecoder->parity, 0, sizeof( pDecoder->parity ) );
+            fragBIT_SET( pDecoder->parity, counter - 1U );
+        }
+        else
+        {
+            FragDecoder_GetParityRow( counter - pDecoder->nbFrag, pDecoder->nbFrag, pDecoder->parity );
+        }
+
+        memcpy( pDecoder->data, pData, pDecoder->fragSize );
+        ok = prvReduceReceived( pDecoder ) && prvEliminate( pDecoder );
+
+        if( ( ok == true ) && ( pDecoder->rank == pDecoder->nbLost ) )
+        {
+            ok = prvSubstitute( pDecoder );
+            pDecoder->status = FRAG_DECODER_DONE;
+        }
+    }
+    else
+    {
+        /* Repeated fragment. */
+    }
+
+    if( counter > pDecoder->lastCounter )
+    {
+        pDecoder->lastCounter = counter;
+    }
+
+    if( ok == false )
+    {
+        pDecoder->status = FRAG_DECODER_STORAGE_ERROR;
+    }
+
+    return pDecoder->status;
+}
+/*-----------------------------------------------------------*/
+
+uint16_t FragDecoder_GetMissing( const FragDecoder_t * pDecoder )
+{
+    uint16_t missing;
+
+    if( pDecoder->status == FRAG_DECODER_DONE )
+    {
+        missing = 0;
+    }
+    else if( pDecoder->coded == true )
+    {
+        missing = pDecoder->nbLost - pDecoder->rank;
+    }
+    else
+    {
+        missing = pDecoder->nbFrag - pDecoder->nbReceived;
+    }
+
+    return missing;
+}
+/*-----------------------------------------------------------*/
+
+void FragDecoder_GetParityRow( uint32_t n,
+                               uint16_t nbFrag,
+                               uint8_t * pRow )
+{
+    uint32_t m = nbFrag;
+    uint32_t mTemp = ( ( m & ( m - 1U ) ) == 0U ) ? 1U : 0U;
+    uint32_t x = 1U + ( 1001U * n );
+    uint32_t nbCoeff = 0;
+    uint32_t r;
+
+    memset( pRow, 0, ( m + 7U ) / 8U );
+
+    /* About half of the fragments, the same one may be drawn twice. */
+    while( nbCoeff < ( m >> 1 ) )
+    {
+        r = 1UL << 16;
+
+        while( r >= m )
+        {
+            x = prvPrbs23( x );
+            r = x % ( m + mTemp );
+        }
+
+        fragBIT_SET( pRow, r );
+        nbCoeff++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t FragDecoder_GetAnswerDelayMs( uint8_t blockAckDelay,
+                                       uint32_t random )
+{
+    uint32_t windowMs = 1000UL << ( ( blockAckDelay & 0x07U ) + 4U );
+
+    return windowMs + ( random % windowMs );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t FragDecoder_Crc32( uint32_t crc,
+                            const uint8_t * pData,
+                            size_t length )
+{
+    size_t i;
+    uint8_t bit;
+
+    crc = ~crc;
+
+    for( i = 0; i < length; i++ )
+    {
+        crc ^= pData[ i ];
+
+        for( bit = 0; bit < 8U; bit++ )
+        {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320UL & ( 0U - ( crc & 1U ) ) );
+        }
+    }
+
+    return ~crc;
+}
@@ -25,9 +25,27 @@
 #define LORAWAN_H
 
 #include "FreeRTOS.h"
+#include "queue.h"
+#include "event_groups.h"
 
 #include "LoRaWANConfig.h"
 #include "LoRaMac.h"
+#include "energy.h"
+#include "frag_decoder.h"
+#include "link_quality.h"
+#include "rx_timing.h"
+#include "task_monitor.h"
+#include "temp_comp.h"
+
+/**
+ * @brief Number of multicast groups, identified from 0 to LORAWAN_MAX_MULTICAST_GROUPS - 1.
+ */
+#define LORAWAN_MAX_MULTICAST_GROUPS    ( 4 )
+
+/**
+ * @brief Value of LoRaWANMessage_t.multicastGroup for a unicast downlink.
+ */
+#define LORAWAN_UNICAST                 ( 0xFFU )
 
 /**
  * @brief Structure which holds the LoRaWAN payload information.
@@ -39,8 +57,39 @@ typedef struct LoRaWANMessage
     uint8_t data[ lorawanConfigMAX_MESSAGE_SIZE ]; /**< @brief The buffer of fixed maximum size used to hold the payload. */
     size_t length;                                 /**< @brief Length of the payload. */
     uint8_t dataRate;                              /**< @brief the data rate used to transfer the payload. */
+    uint8_t multicastGroup;                        /**< @brief Multicast group a downlink was received on, LORAWAN_UNICAST if none. Unused for uplinks. */
+    int16_t rssi;                                  /**< @brief RSSI of a downlink in dBm. Unused for uplinks. */
+    int8_t snr;                                    /**< @brief SNR of a downlink in dB. Unused for uplinks. */
+    uint8_t reliability;                           /**< @brief Probability in percent an uplink is to get through, 0 for lorawanConfigDEFAULT_RELIABILITY. Unused for downlinks. */
 } LoRaWANMessage_t;
 
+/**
+ * @brief Port of the subscription which receives the downlinks of the ports without one, see LoRaWAN_SubscribePort().
+ * Port 0 only carries MAC commands, which never reach the application.
+ */
+#define LORAWAN_PORT_ANY    ( 0U )
+
+/**
+ * @brief Receives the downlinks of a port, see LoRaWAN_SubscribePort().
+ *
+ * Called by the LoRaMAC task, it must return quickly and must not call the functions of the API which use LoRaMAC, as
+ * they wait for the LoRaMAC task.
+ *
+ * @param[in] pMessage Downlink, valid during the call.
+ * @param[in] pContext Context given with the subscription.
+ */
+typedef void ( * LoRaWANDownlinkCallback_t )( const LoRaWANMessage_t * pMessage,
+                                              void * pContext );
+
+/**
+ * @brief Downlinks of a subscription.
+ */
+typedef struct LoRaWANPortStats
+{
+    uint32_t delivered;
+    uint32_t dropped;             /**< @brief Downlinks lost as the queue of the subscription was full. */
+} LoRaWANPortStats_t;
+
 
 /**
  * @brief Network parameters for LoRaWAN.
@@ -61,18 +110,120 @@ typedef struct LoRaWANLinkCheckInfo
     uint8_t NbGateways;  /**< @brief Number of gateways which received the last LinkCheckReq. */
 } LoRaWANLinkCheckInfo_t;
 
+/**
+ * @brief Network synchronized time, see LoRaWAN_GetGpsTime().
+ */
+typedef struct LoRaWANGpsTime
+{
+    uint64_t gpsTimeMs;    /**< @brief Milliseconds elapsed since the GPS epoch, 1980-01-06 00:00:00 UTC. */
+    uint32_t errorBoundMs; /**< @brief Maximum error of gpsTimeMs, given the synchronization error and the drift uncertainty. */
+    float driftPpm;        /**< @brief Estimated drift of the local clock, positive if it runs fast. 0 until two synchronizations. */
+    uint32_t syncCount;    /**< @brief Number of successful synchronizations with the network server. */
+} LoRaWANGpsTime_t;
+
+/**
+ * @brief Multicast group set up by the application, see LoRaWAN_AddMulticastGroup().
+ */
+typedef struct LoRaWANMulticastGroup
+{
+    uint8_t groupId;             /**< @brief Group identifier, below LORAWAN_MAX_MULTICAST_GROUPS. */
+    uint32_t address;            /**< @brief Multicast address shared by the devices of the group. */
+    uint8_t appSessionKey[ 16 ]; /**< @brief McAppSKey of the group. */
+    uint8_t nwkSessionKey[ 16 ]; /**< @brief McNwkSKey of the group. */
+    uint32_t minFCnt;            /**< @brief First multicast frame counter accepted. */
+    uint32_t maxFCnt;            /**< @brief Last multicast frame counter accepted. */
+    DeviceClass_t deviceClass;   /**< @brief CLASS_B to receive in multicast ping slots, CLASS_C to receive continuously. */
+    uint32_t frequency;          /**< @brief Downlink frequency of the group in Hz. */
+    int8_t dataRate;             /**< @brief Downlink data rate of the group. */
+    uint16_t periodicity;        /**< @brief Ping slot periodicity of the group, class B only. */
+} LoRaWANMulticastGroup_t;
+
+/**
+ * @brief Uplinks sent by the LoRaWAN layer for the network, see lorawanConfigUPLINK_PIGGYBACK.
+ */
+typedef struct LoRaWANPiggybackStats
+{
+    uint32_t piggybacked;     /**< @brief MAC answers sent along with an uplink of the application. */
+    uint32_t fetchFrames;     /**< @brief Unconfirmed frames sent by the layer, empty or carrying package answers. */
+    uint32_t airtimeSavedMs;  /**< @brief Air time of the empty frames the piggybacked answers did not need. */
+    uint32_t answersDropped;  /**< @brief Package answers dropped to make room for newer ones, before they could be sent. */
+} LoRaWANPiggybackStats_t;
+
+/**
+ * @brief Delivery and air time of the uplinks sent with LoRaWAN_Send(), see lorawanConfigADAPTIVE_RETRANSMISSION.
+ */
+typedef struct LoRaWANRetransmitStats
+{
+    uint32_t confirmed;             /**< @brief Confirmed uplinks sent. */
+    uint32_t confirmedAcked;        /**< @brief Confirmed uplinks acknowledged. */
+    uint32_t unconfirmed;           /**< @brief Unconfirmed uplinks sent. */
+    float unconfirmedDelivered;     /**< @brief Unconfirmed uplinks expected to be received, from the packet error rate when they were sent. */
+    uint32_t transmissions;         /**< @brief Transmissions of the uplinks, retries and repetitions included. */
+    uint32_t airtimeMs;             /**< @brief Air time of the transmissions. */
+} LoRaWANRetransmitStats_t;
+
+/**
+ * @brief RAM of the kernel objects of the LoRaWAN layer and of the LoRaMAC timers, see lorawanConfigSTATIC_ALLOCATION.
+ * The sizes are those of this build, from the heap unless allocated statically.
+ */
+typedef struct LoRaWANRamBudget
+{
+    size_t stackBytes;          /**< @brief Stack of the LoRaMAC task. */
+    size_t queueBytes;          /**< @brief Storage of the event, command and downlink queues. */
+    size_t kernelObjectBytes;   /**< @brief Control blocks of the task and of the queues. */
+    size_t timerBytes;          /**< @brief Control blocks of lorawanConfigMAX_TIMERS timers. */
+    size_t staticBytes;         /**< @brief Part of the above allocated statically. */
+    size_t initHeapBytes;       /**< @brief Heap taken during the last LoRaWAN_Init(), 0 when statically allocated. */
+} LoRaWANRamBudget_t;
+
 /**
  * @brief Event types received from LoRaWAN network.
  */
 typedef enum LoRaWANEventType
 {
     LORAWAN_EVENT_UNKNOWN = 0,         /**< @brief Type to denote an unexpected event type. */
-    LORAWAN_EVENT_DOWNLINK_PENDING,    /**< @brief Indicates that server has to send more downlink data or waiting for a mac command uplink. */
+    LORAWAN_EVENT_DOWNLINK_PENDING,    /**< @brief Indicates that server has to send more downlink data or waiting for a mac command uplink. Only sent with lorawanConfigUPLINK_PIGGYBACK set to 0. */
     LORAWAN_EVENT_TOO_MANY_FRAME_LOSS, /**< @brief Indicates too many frames are missed between end device and LoRa network server. */
     LORAWAN_EVENT_DEVICE_TIME_UPDATED, /**< @brief Indicates the device time has been synchronized with LoRa network server. */
-    LORAWAN_EVENT_LINK_CHECK_REPLY     /**< @brief Reply for a link check request from end device. */
+    LORAWAN_EVENT_LINK_CHECK_REPLY,    /**< @brief Reply for a link check request from end device. */
+    LORAWAN_EVENT_BEACON_LOCKED,       /**< @brief Class B beacon acquired, after a switch to class B or after it was lost. */
+    LORAWAN_EVENT_BEACON_LOST,         /**< @brief No class B beacon received for too long, the device fell back to class A. */
+    LORAWAN_EVENT_CLASS_CHANGED,       /**< @brief The device completed a switch of class, see LoRaWAN_SetDeviceClass(). */
+    LORAWAN_EVENT_DATA_BLOCK_RECEIVED, /**< @brief A fragmented data block was decoded, or cannot be, see LoRaWAN_SetDataBlockStorage(). */
+    LORAWAN_EVENT_REJOINED             /**< @brief A periodic Rejoin-Request was answered, or not, see LoRaWAN_SetRejoinParams(). */
 } LoRaWANEventType_t;
 
+/**
+ * @brief Types of LoRaWAN 1.1 Rejoin-Request.
+ */
+typedef enum LoRaWANRejoinType
+{
+    LORAWAN_REJOIN_TYPE_0 = 0, /**< @brief Resets the session and the radio parameters, the device address may change. */
+    LORAWAN_REJOIN_TYPE_1 = 1, /**< @brief Restores a lost session context through the join server, like a join. */
+    LORAWAN_REJOIN_TYPE_2 = 2  /**< @brief Rekeys the session and resets the frame counters, the radio parameters are kept. */
+} LoRaWANRejoinType_t;
+
+/**
+ * @brief Information sent along with a beacon locked event.
+ */
+typedef struct LoRaWANBeaconInfo
+{
+    int16_t rssi;            /**< @brief RSSI of the beacon in dBm. */
+    int8_t snr;              /**< @brief SNR of the beacon in dB. */
+    uint32_t missedBeacons;  /**< @brief Beacons missed since the switch to class B. */
+} LoRaWANBeaconInfo_t;
+
+/**
+ * @brief Information sent along with a data block received event.
+ */
+typedef struct LoRaWANDataBlockInfo
+{
+    uint32_t size;           /**< @brief Size of the data, without the CRC-32 which ends the block. */
+    uint32_t descriptor;     /**< @brief Descriptor of the block given by the fragmentation session setup. */
+    uint16_t nbFrag;         /**< @brief Number of uncoded fragments of the block. */
+    uint16_t nbReceived;     /**< @brief Fragments received, coded or not. */
+} LoRaWANDataBlockInfo_t;
+
 /**
  * @brief Structure to hold event information.
  */
@@ -85,12 +236,34 @@ typedef struct LoRaWANEventInfo
     {
         LoRaWANLinkCheckInfo_t linkCheck; /**< @brief Link check information associated with LORAWAN_EVENT_LINK_CHECK_REPLY. */
         bool ackReceived;                 /**< @brief Acknoweldgement flag for a confirmed uplink. */
+        LoRaWANBeaconInfo_t beacon;       /**< @brief Beacon information associated with LORAWAN_EVENT_BEACON_LOCKED. */
+        DeviceClass_t deviceClass;        /**< @brief New class of the device, associated with LORAWAN_EVENT_CLASS_CHANGED. */
+        LoRaWANDataBlockInfo_t dataBlock; /**< @brief Data block information associated with LORAWAN_EVENT_DATA_BLOCK_RECEIVED. */
+        LoRaWANRejoinType_t rejoinType;   /**< @brief Type of the Rejoin-Request associated with LORAWAN_EVENT_REJOINED. */
     } info;
 } LoRaWANEventInfo_t;
 
+/**
+ * @brief Bit of an event type in an event mask or in the event group bound with LoRaWAN_SetEventGroup().
+ */
+#define LORAWAN_EVENT_BIT( type )    ( ( uint32_t ) 1U << ( uint32_t ) ( type ) )
+
+/**
+ * @brief Mask of all the event types.
+ */
+#define LORAWAN_EVENT_ALL            ( LORAWAN_EVENT_BIT( LORAWAN_EVENT_REJOINED + 1 ) - LORAWAN_EVENT_BIT( LORAWAN_EVENT_DOWNLINK_PENDING ) )
+
+/**
+ * @brief Callback receiving events, run in the LoRaMAC task.
+ */
+typedef void ( * LoRaWANEventCallback_t )( const LoRaWANEventInfo_t * pEvent,
+                                           void * pContext );
+
 /**
  * @brief Initializes LoRaWAN stack for the specified region.
  * Configures and starts the underlying LoRaMAC stack. Creates a high priority task to process LoRaMAC events from Radio.
+ * Once initialized, the functions of this API which use LoRaMAC can be called from any task, they are run by the
+ * LoRaMAC task and wait for it, see lorawanConfigCOMMAND_QUEUE_SIZE.
  *
  * @param[in] region The region for the LoRaWAN network.
  * @return LORAMAC_STATUS_OK if the initialization was successful. Appropriate error code otherwise.
@@ -124,6 +297,32 @@ LoRaMacStatus_t LoRaWAN_SetNetworkParams( LoRaWANNetworkParams_t * pNetworkParam
  */
 LoRaMacStatus_t LoRaWAN_Join( void );
 
+/**
+ * @brief Sends a LoRaWAN 1.1 Rejoin-Request, on the current data rate, and waits for the Join-Accept.
+ * A rejoin renews the session with a single exchange instead of a full join. Networks before LoRaWAN 1.1 do not answer
+ * Rejoin-Requests, so a failed rejoin should be followed by LoRaWAN_Join(). The request is tried
+ * lorawanConfigMAX_REJOIN_ATTEMPTS times.
+ *
+ * @param[in] type Type of Rejoin-Request.
+ * @return LORAMAC_STATUS_OK if the network accepted the rejoin, LORAMAC_STATUS_BUSY if a periodic rejoin is ongoing.
+ */
+LoRaMacStatus_t LoRaWAN_Rejoin( LoRaWANRejoinType_t type );
+
+/**
+ * @brief Sets the periodic Rejoin-Requests of type 0 with the parameters of a RejoinParamSetupReq: one is sent every
+ * 2^( maxTimeN + 10 ) seconds or every 2^( maxCountN + 4 ) uplinks, whichever comes first. LORAWAN_EVENT_REJOINED is sent
+ * with the outcome of each of them. The defaults are lorawanConfigREJOIN_MAX_TIME_N and lorawanConfigREJOIN_MAX_COUNT_N,
+ * enabled by lorawanConfigREJOIN_PERIODIC.
+ *
+ * @param[in] enable Enables the periodic Rejoin-Requests.
+ * @param[in] maxTimeN MaxTimeN, from 0 to 15.
+ * @param[in] maxCountN MaxCountN, from 0 to 15.
+ * @return LORAMAC_STATUS_PARAMETER_INVALID if a parameter is out of range.
+ */
+LoRaMacStatus_t LoRaWAN_SetRejoinParams( bool enable,
+                                         uint8_t maxTimeN,
+                                         uint8_t maxCountN );
+
 /**
  * @brief Activates the device by personalization without doing a JOIN handshake.
  * For ABP join, end-device does not exchange any message with LoRa Network Server.
@@ -143,15 +342,123 @@ LoRaMacStatus_t LoRaWAN_ActivateByPersonalization( void );
  */
 LoRaMacStatus_t LoRaWAN_SetAdaptiveDataRate( bool enable );
 
+/**
+ * @brief Enables or disables the device side rate adaptation, for devices on which the network ADR cannot keep up, such as
+ * moving ones. Enabling it disables the network ADR. The data rate and transmit power of each uplink are then chosen from
+ * the margins of periodic link checks, the gateway count and the losses, see rate_adapt.h. The data rate of the messages
+ * passed to LoRaWAN_Send() is ignored while it is enabled.
+ *
+ * @param[in] enable Enable or disable flag
+ * @return LORAMAC_STATUS_OK if the operation was successful. Appropriate error code otherwise.
+ */
+LoRaMacStatus_t LoRaWAN_SetRateAdaptation( bool enable );
+
+/**
+ * @brief Switches the device class.
+ * The switch runs in the background and LORAWAN_EVENT_CLASS_CHANGED is sent once it is done. To switch to class B the device
+ * synchronizes its time if needed, acquires the beacon, then sends a PingSlotInfoReq with lorawanConfigCLASS_B_PING_SLOT_PERIODICITY
+ * on the next uplinks. Once the network server answered, ping slot downlinks are received through LoRaWAN_Receive() at any time.
+ * If the beacon is lost the device falls back to class A and acquires it again. In class C the receiver stays on the RX2
+ * channel between the uplinks, and downlinks are received through LoRaWAN_Receive() at any time. The class can be changed at
+ * any time, e.g. to class C for the duration of a firmware update session only, as long as the application server knows the
+ * class of the device. It can be set before the join, and is restored after each join. Class B requires the LoRaMAC layer to be
+ * built with LORAMAC_CLASSB_ENABLED.
+ *
+ * @param[in] deviceClass CLASS_A, CLASS_B or CLASS_C.
+ * @return LORAMAC_STATUS_OK if the switch was started. Appropriate error code otherwise.
+ */
+LoRaMacStatus_t LoRaWAN_SetDeviceClass( DeviceClass_t deviceClass );
+
 /**
  * @brief Request for device time synchronization with LoRa Network Server.
  * Piggy backs a MAC command along with the next uplink payload to request for time sync from LoRa network server. LoRaWAN stack gets the response from
  * LoRa network server to correct the clock drift for the device. An event is generated for a successful device time update.
+ * Resynchronizations are also requested automatically by LoRaWAN_Send(), see lorawanConfigGPS_TIME_TARGET_ERROR_MS.
  *
  * @return LORAMAC_STATUS_OK if the request operation was successful. Appropirate error code otherwise.
  */
 LoRaMacStatus_t LoRaWAN_RequestDeviceTimeSync( void );
 
+/**
+ * @brief Gets the network synchronized time.
+ * The time is kept from the local RTC, corrected continuously for the drift estimated across successive device time
+ * synchronizations. After a synchronization the remaining offset is slewed rather than stepped, so the time never goes
+ * backwards, unless the offset is too large to be absorbed before the next synchronization.
+ *
+ * @param[out] pGpsTime Current GPS time along with its error bound.
+ * @return LORAMAC_STATUS_OK if the time is available, LORAMAC_STATUS_ERROR if it was never synchronized.
+ */
+LoRaMacStatus_t LoRaWAN_GetGpsTime( LoRaWANGpsTime_t * pGpsTime );
+
+/**
+ * @brief Value for LoRaWAN_SetUplinkSlot() to derive the uplink slot from the device address.
+ */
+#define LORAWAN_UPLINK_SLOT_FROM_DEV_ADDR    ( UINT32_MAX )
+
+/**
+ * @brief Assigns the uplink slot used by LoRaWAN_GetUplinkSlotDelay(), for instance as received from the application server.
+ * The assignment lasts until the next join, after which the slot is derived from the new device address again.
+ *
+ * @param[in] slot Slot index, wrapped to the number of slots of the period, or LORAWAN_UPLINK_SLOT_FROM_DEV_ADDR.
+ */
+void LoRaWAN_SetUplinkSlot( uint32_t slot );
+
+/**
+ * @brief Gets the delay until the next uplink slot of the device.
+ * The reporting period is divided in slots of lorawanConfigUPLINK_SLOT_MS aligned on the GPS time, so all devices of the network
+ * agree on them whatever their boot time. The device uses its device address modulo the number of slots, so devices which were
+ * given consecutive addresses by the network server never transmit in the same slot. The returned delay points after the start of
+ * the slot by the current error bound of the GPS time.
+ *
+ * @param[in] periodMs Reporting period in milliseconds.
+ * @param[out] pDelayMs Delay from now to the next slot, in milliseconds, at most periodMs.
+ * @return LORAMAC_STATUS_OK if the delay was computed, LORAMAC_STATUS_ERROR if the GPS time was never synchronized, in which
+ * case the application should fall back to a random jitter.
+ */
+LoRaMacStatus_t LoRaWAN_GetUplinkSlotDelay( uint32_t periodMs,
+                                            uint32_t * pDelayMs );
+
+/**
+ * @brief Sets up a multicast group with session keys known to the application.
+ * The downlinks of the group are received in the multicast ping slots while the device is in class B, or continuously while it is
+ * in class C, see LoRaWAN_SetDeviceClass(), and queued for LoRaWAN_Receive() with the group in multicastGroup. Groups can also be
+ * set up by the application server through the remote multicast setup package on port lorawanConfigREMOTE_MULTICAST_SETUP_PORT,
+ * which also schedules the class B or C sessions of the groups, switching the class of the device for their duration.
+ *
+ * @param[in] pGroup Parameters of the group. The keys are copied.
+ * @return LORAMAC_STATUS_OK if the group was set up. Appropriate error code otherwise.
+ */
+LoRaMacStatus_t LoRaWAN_AddMulticastGroup( const LoRaWANMulticastGroup_t * pGroup );
+
+/**
+ * @brief Removes a multicast group, set up by the application or remotely.
+ *
+ * @param[in] groupId Group identifier.
+ * @return LORAMAC_STATUS_OK if the group was removed, LORAMAC_STATUS_MC_GROUP_UNDEFINED if it was not set up.
+ */
+LoRaMacStatus_t LoRaWAN_RemoveMulticastGroup( uint8_t groupId );
+
+/**
+ * @brief Sets the storage the data blocks of the fragmented data block transport package are decoded into.
+ * The fragmentation sessions are set up by the application server on port lorawanConfigFRAGMENTATION_PORT. The fragments,
+ * in unicast or from the multicast groups of the session, are written to the storage as they arrive, and the lost ones are
+ * recovered from the coded fragments which follow, without retransmissions. Once decoded, the block is verified against the
+ * CRC-32 which ends it, and LORAWAN_EVENT_DATA_BLOCK_RECEIVED is sent with status LORAMAC_EVENT_INFO_STATUS_OK if it matches.
+ * Sessions are refused while no storage is set.
+ *
+ * @param[in] pStorage Storage, which must remain valid. NULL to refuse the sessions.
+ */
+void LoRaWAN_SetDataBlockStorage( const FragDecoderStorage_t * pStorage );
+
+/**
+ * @brief Makes use of the last data block received, through the activate function of its storage, for instance to boot
+ * the firmware it holds.
+ *
+ * @return LORAMAC_STATUS_OK if the block was activated, LORAMAC_STATUS_ERROR if there is no verified block or the storage
+ * failed to activate it.
+ */
+LoRaMacStatus_t LoRaWAN_ActivateDataBlock( void );
+
 /**
  * @brief Request for link check with LoRa Network Server.
  * Piggy backs a MAC command along with next uplink  payload to perform link connectivity check with LoRa Network Server. Gets back the response from LoRa Network
@@ -161,12 +468,26 @@ LoRaMacStatus_t LoRaWAN_RequestDeviceTimeSync( void );
  */
 LoRaMacStatus_t LoRaWAN_RequestLinkCheck( void );
 
+/**
+ * @brief Gets the link quality measured on the last frames: RSSI and SNR of the downlinks, demodulation margin of the
+ * link checks and packet error rate of the confirmed uplinks, see link_quality.h.
+ *
+ * @param[out] pStats Link statistics.
+ */
+void LoRaWAN_GetLinkStats( LinkQualityStats_t * pStats );
+
 /**
  * @brief Sends a payload to LoRa Network server.
  * This is blocking call untill the payload is send out of radio for an unconfirmed message, or an acknoweledgement is received or the retries
  * are exhausted for a confirmed payload. Number of retries for a confirmed payload is configurable. The retries uses different
  * frequencies uplink so as to find the right overlapping frequency with the gateway.
  *
+ * The answers of the remote multicast setup package waiting for an uplink are sent first, or in place of an empty payload.
+ *
+ * With lorawanConfigADAPTIVE_RETRANSMISSION, the trials of a confirmed payload, or the repetitions of an unconfirmed one,
+ * are as many as needed to get it through with the probability given by its reliability, at the packet error rate
+ * measured on the recent confirmed payloads.
+ *
  * @param[in] pMessage Pointer to the payload along with other information.
  * @param[in] confirmed Should send a confirmed payload or not.
  * @return LORAMAC_STATUS_OK if the request operation was successful. Appropirate error code otherwise.
@@ -175,7 +496,68 @@ LoRaMacStatus_t LoRaWAN_Send( LoRaWANMessage_t * pMessage,
                               bool confirmed );
 
 /**
- * @brief Receives a downlink message from LoRa Network server.
+ * @brief Tells when the application sends its next uplink, so the MAC answers wait for it rather than taking an empty
+ * frame. Without it the time is predicted from the interval between the last two calls to LoRaWAN_Send().
+ *
+ * @param[in] delayMs Delay until the next call to LoRaWAN_Send().
+ */
+void LoRaWAN_SetNextUplinkDelay( uint32_t delayMs );
+
+/**
+ * @brief Gets the counts of the uplinks sent for the network, see lorawanConfigUPLINK_PIGGYBACK.
+ *
+ * @param[out] pStats Counts since LoRaWAN_Init().
+ */
+void LoRaWAN_GetPiggybackStats( LoRaWANPiggybackStats_t * pStats );
+
+/**
+ * @brief Gets the delivery ratio achieved by the uplinks and the air time spent on them.
+ *
+ * @param[out] pStats Counts since LoRaWAN_Init().
+ */
+void LoRaWAN_GetRetransmitStats( LoRaWANRetransmitStats_t * pStats );
+
+/**
+ * @brief Gets the timing measured on the receive windows and the timing error given to LoRaMAC, see
+ * lorawanConfigRX_TIMING_CALIBRATION.
+ *
+ * @param[out] pStats Statistics.
+ */
+void LoRaWAN_GetRxTimingStats( RxTimingStats_t * pStats );
+
+/**
+ * @brief Gets the temperature of the crystal and the correction applied to the local time base, see
+ * lorawanConfigTEMP_COMPENSATION.
+ *
+ * @param[out] pStats Statistics.
+ */
+void LoRaWAN_GetTempCompStats( TempCompStats_t * pStats );
+
+/**
+ * @brief Gets the charge drawn by the device, per category, since the boot and during the last uplink cycle, an uplink
+ * cycle starting at each call to LoRaWAN_Send().
+ *
+ * @param[out] pReport Report, with the battery life projected at the average current.
+ */
+void LoRaWAN_GetEnergyReport( EnergyReport_t * pReport );
+
+/**
+ * @brief Gets the CPU share and the least free stack of the tasks, the least free heap and the fill of the queues of
+ * the layer, sampled every lorawanConfigMONITOR_PERIOD_SEC.
+ *
+ * @param[out] pReport Report.
+ */
+void LoRaWAN_GetMonitorReport( TaskMonitorReport_t * pReport );
+
+/**
+ * @brief Gets the RAM taken by the LoRaWAN layer for its task, its queues and the LoRaMAC timers.
+ *
+ * @param[out] pBudget Sizes in this build.
+ */
+void LoRaWAN_GetRamBudget( LoRaWANRamBudget_t * pBudget );
+
+/**
+ * @brief Receives a downlink message from LoRa Network server, of the ports without a subscription of their own.
  * Blocks for the specified timeout provided.
  *
  * @param[out] pEventInfo Pointer to structure containing event type and other information.
@@ -185,10 +567,75 @@ LoRaMacStatus_t LoRaWAN_Send( LoRaWANMessage_t * pMessage,
 BaseType_t LoRaWAN_Receive( LoRaWANMessage_t * pMessage,
                             uint32_t timeoutMS );
 
+/**
+ * @brief Delivers the downlinks of a port to a queue or a callback of its own, so that independent modules of the
+ * application receive their downlinks without a task dispatching them.
+ *
+ * The LoRaMAC task hands each downlink to the subscription of its port as it is received, or to the subscription of
+ * LORAWAN_PORT_ANY, by default the queue of LoRaWAN_Receive(). A downlink which does not fit in the queue is dropped
+ * right away and counted, the LoRaMAC task never waits for a subscriber. A port subscribed again gets the new queue or
+ * callback, the counters are kept. The ports of the application layer packages handled by this layer cannot be subscribed.
+ * LoRaWAN_Init() clears the subscriptions.
+ *
+ * @param[in] port Port, from 1 to 255, or LORAWAN_PORT_ANY.
+ * @param[in] queue Queue of LoRaWANMessage_t receiving the downlinks, or NULL to use the callback.
+ * @param[in] callback Callback receiving the downlinks, used if the queue is NULL.
+ * @param[in] pContext Passed to the callback.
+ * @return LORAMAC_STATUS_PARAMETER_INVALID if neither or both of queue and callback are given, or for the port of a
+ * package, LORAMAC_STATUS_ERROR if lorawanConfigMAX_PORT_SUBSCRIPTIONS ports are already subscribed.
+ */
+LoRaMacStatus_t LoRaWAN_SubscribePort( uint8_t port,
+                                       QueueHandle_t queue,
+                                       LoRaWANDownlinkCallback_t callback,
+                                       void * pContext );
+
+/**
+ * @brief Ends the subscription of a port, its downlinks go to the subscription of LORAWAN_PORT_ANY. Ending the one of
+ * LORAWAN_PORT_ANY gives its downlinks back to LoRaWAN_Receive().
+ *
+ * @param[in] port Port.
+ * @return LORAMAC_STATUS_PARAMETER_INVALID if the port was not subscribed.
+ */
+LoRaMacStatus_t LoRaWAN_UnsubscribePort( uint8_t port );
+
+/**
+ * @brief Gets the downlinks delivered to and dropped for the subscription of a port.
+ *
+ * @param[in] port Port, or LORAWAN_PORT_ANY.
+ * @param[out] pStats Counters.
+ * @return LORAMAC_STATUS_PARAMETER_INVALID if the port is not subscribed.
+ */
+LoRaMacStatus_t LoRaWAN_GetPortStats( uint8_t port,
+                                      LoRaWANPortStats_t * pStats );
+
+/**
+ * @brief Hands the events of some types to a callback instead of the event queue, as soon as the MAC reports them.
+ * The callback runs in the LoRaMAC task: it must return quickly and not call the functions of this API which wait for the
+ * network, such as LoRaWAN_Send() or LoRaWAN_Join(). LoRaWAN_Init() clears the callback.
+ *
+ * @param[in] eventMask LORAWAN_EVENT_BIT() of the types handed to the callback, the others go to the event queue.
+ * @param[in] callback Callback, NULL to send all the events to the event queue again.
+ * @param[in] pContext Passed to the callback.
+ * @return LORAMAC_STATUS_PARAMETER_INVALID if the mask has bits out of LORAWAN_EVENT_ALL.
+ */
+LoRaMacStatus_t LoRaWAN_SetEventCallback( uint32_t eventMask,
+                                          LoRaWANEventCallback_t callback,
+                                          void * pContext );
+
+/**
+ * @brief Binds an event group in which each event sets LORAWAN_EVENT_BIT() of its type, whether it goes to the callback
+ * or to the event queue. A task can then wait on the event group for the events it cares about, and fetch them with
+ * LoRaWAN_PollEvent() without blocking. The bits are only set, clearing them is up to the application. The event group
+ * needs configUSE_16_BIT_TICKS set to 0, for more than 8 bits. LoRaWAN_Init() unbinds it.
+ *
+ * @param[in] eventGroup Event group, NULL to unbind it.
+ * @return LORAMAC_STATUS_OK.
+ */
+LoRaMacStatus_t LoRaWAN_SetEventGroup( EventGroupHandle_t eventGroup );
 
 /**
  * @brief Poll for a downlink event from LoRa Network server.
- * Blocks for the specified timeout provided.
+ * Blocks for the specified timeout provided. Events handed to the callback of LoRaWAN_SetEventCallback() are not queued.
  *
  * @param[out] pEventInfo Pointer to structure containing event type and other information.
  * @param[in] timeoutMS Timeout in milliseconds to block for an event. Set to 0 to not block for an event.
@@ -199,7 +646,8 @@ BaseType_t LoRaWAN_PollEvent( LoRaWANEventInfo_t * pEventInfo,
 
 /**
  * @brief Cleans up LoRaWAN stack.
- * Stops and deinits the LoRaMAC stack. Deletes the LoRaMAC task and associated resources.
+ * Stops and deinits the LoRaMAC stack. Deletes the LoRaMAC task and associated resources. The calls of other tasks still
+ * waiting for the LoRaMAC task return LORAMAC_STATUS_ERROR, or a confirm with LORAMAC_EVENT_INFO_STATUS_ERROR.
  */
 void LoRaWAN_Cleanup( void );
 
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file block_pool.h
+ * @brief Pools of fixed size blocks, for the objects allocated and freed often.
+ *
+ * The free blocks form a stack linked by their index. Taking and giving back a block is a compare-and-swap on the top of
+ * the stack, so it takes constant time, never blocks, does not disable interrupts and can be used from interrupts. The
+ * top carries a count of the changes next to the index, so that a block taken and given back between the read and the
+ * compare-and-swap of another caller is noticed. The blocks all have the same size, so a pool never fragments.
+ *
+ * Each pool counts the blocks in use, their high water mark and the allocations which failed, and the pools are chained
+ * when initialized so that all of them can be reported with BlockPool_GetFirst() and BlockPool_GetNext().
+ */
+
+/**
+ * @brief Rounds a block size up so that consecutive blocks keep the alignment of any object.
+ */
+#define BLOCK_POOL_BLOCK_SIZE( size )    ( ( ( size ) + sizeof( uint64_t ) - 1U ) & ~( sizeof( uint64_t ) - 1U ) )
+
+/**
+ * @brief Maximum number of blocks of a pool.
+ */
+#define BLOCK_POOL_MAX_BLOCKS            ( 0xFFFEU )
+
+/**
+ * @brief Pool of fixed size blocks.
+ */
+typedef struct BlockPool
+{
+    const char * pName;
+    uint8_t * pStorage;                 /**< @brief blockCount blocks of blockSize bytes. */
+    uint16_t * pLinks;                  /**< @brief Index of the next free block, per block. */
+    size_t blockSize;
+    uint16_t blockCount;
+    volatile uint32_t top;              /**< @brief Index of the first free block in the low half, count of changes in the high half. */
+    volatile uint32_t used;
+    volatile uint32_t highWater;
+    volatile uint32_t allocations;
+    volatile uint32_t failures;         /**< @brief Allocations which found the pool empty. */
+    struct BlockPool * pNext;           /**< @brief Next pool initialized. */
+} BlockPool_t;
+
+/**
+ * @brief Counters of a pool.
+ */
+typedef struct BlockPoolStats
+{
+    const char * pName;
+    size_t blockSize;
+    uint32_t blockCount;
+    uint32_t used;
+    uint32_t highWater;                 /**< @brief Most blocks in use at once. */
+    uint32_t allocations;
+    uint32_t failures;
+} BlockPoolStats_t;
+
+/**
+ * @brief Initializes a pool and adds it to the pools reported. Not thread safe, call it before the pool is shared.
+ *
+ * @param[out] pPool Pool.
+ * @param[in] pName Name of the pool in the reports, kept by reference.
+ * @param[in] pStorage Storage of blockCount * blockSize bytes, aligned as the objects of the blocks.
+ * @param[in] blockSize Size of a block, a multiple of the alignment of the objects, see BLOCK_POOL_BLOCK_SIZE().
+ * @param[in] blockCount Number of blocks, at most BLOCK_POOL_MAX_BLOCKS.
+ * @param[in] pLinks Array of blockCount indexes used to chain the free blocks.
+ * @return false if the pool cannot have blocks.
+ */
+bool BlockPool_Init( BlockPool_t * pPool,
+                     const char * pName,
+                     void * pStorage,
+                     size_t blockSize,
+                     uint16_t blockCount,
+                     uint16_t * pLinks );
+
+/**
+ * @brief Takes a block from a pool.
+ *
+ * @param[in] pPool Pool.
+ * @return The block, NULL if all of them are in use.
+ */
+void * BlockPool_Alloc( BlockPool_t * pPool );
+
+/**
+ * @brief Gives a block back to its pool.
+ *
+ * @param[in] pPool Pool.
+ * @param[in] pBlock Block taken from the pool.
+ * @return false if pBlock is not a block of the pool, which is left unchanged.
+ */
+bool BlockPool_Free( BlockPool_t * pPool,
+                     void * pBlock );
+
+/**
+ * @brief Tells whether a pointer is a block of a pool, to free objects which may come from the pool or from the heap.
+ */
+bool BlockPool_Owns( const BlockPool_t * pPool,
+                     const void * pBlock );
+
+/**
+ * @brief Reads the counters of a pool.
+ *
+ * @param[in] pPool Pool.
+ * @param[out] pStats Counters.
+ */
+void BlockPool_GetStats( const BlockPool_t * pPool,
+                         BlockPoolStats_t * pStats );
+
+/**
+ * @brief Returns the first pool initialized, NULL if there is none.
+ */
+const BlockPool_t * BlockPool_GetFirst( void );
+
+/**
+ * @brief Returns the pool initialized after pPool, NULL if pPool is the last one.
+ */
+const BlockPool_t * BlockPool_GetNext( const BlockPool_t * pPool );
+
+#endif /* BLOCK_POOL_H */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LoRaWANConfig.h"
+#include "frag_decoder.h"
+
+/**
+ * @brief First bytes of a patch, to tell it from a full image.
+ */
+#define DELTA_PATCH_MAGIC          "DPT1"
+
+/**
+ * @brief Size of the header of a patch: magic, size and CRC-32 of the old image, size and CRC-32 of the new image.
+ */
+#define DELTA_PATCH_HEADER_SIZE    ( 20U )
+
+/**
+ * @brief The operations following the header are compressed with LZSS: a 1 bit is followed by a literal byte, a 0 bit
+ * by the distance minus one, on DELTA_PATCH_WINDOW_BITS bits, and the length minus DELTA_PATCH_MIN_MATCH, on
+ * DELTA_PATCH_LENGTH_BITS bits, of a copy of the operations already decompressed. Bits are read MSB first.
+ */
+#define DELTA_PATCH_WINDOW_BITS    ( 11U )
+#define DELTA_PATCH_LENGTH_BITS    ( 4U )
+#define DELTA_PATCH_MIN_MATCH      ( 3U )
+
+/**
+ * @brief Operations of a patch, after the header.
+ *
+ * DELTA_PATCH_OP_ADD <length> <old offset delta> adds a diff to the old image, from the end of the previous operation
+ * moved by the signed delta. The diff is a sequence of <zeros> <literals> <literal bytes>, until length bytes are covered,
+ * so that the unchanged bytes cost nothing and a byte changed by a moved address costs one. DELTA_PATCH_OP_INSERT
+ * <length> <bytes> inserts new bytes. Lengths are LEB128 varints, the offset delta is zigzag encoded.
+ */
+#define DELTA_PATCH_OP_END       ( 0x00U )
+#define DELTA_PATCH_OP_ADD       ( 0x01U )
+#define DELTA_PATCH_OP_INSERT    ( 0x02U )
+
+/**
+ * @brief State of a patch application.
+ */
+typedef enum DeltaPatchStatus
+{
+    DELTA_PATCH_ONGOING = 0,        /**< @brief More patch bytes are needed. */
+    DELTA_PATCH_DONE,               /**< @brief The new image was written and matches its CRC-32. */
+    DELTA_PATCH_WRONG_BASE,         /**< @brief The old image is not the one the patch was made from. */
+    DELTA_PATCH_CORRUPTED,          /**< @brief The patch is malformed, or the new image does not match its CRC-32. */
+    DELTA_PATCH_STORAGE_ERROR       /**< @brief Reading the old image or writing the new one failed. */
+} DeltaPatchStatus_t;
+
+/**
+ * @brief Streaming patch application.
+ *
+ * The patch is parsed byte by byte, so it can be fed in chunks of any size, and the new image is written page by page
+ * in order. The RAM used is the page buffer of lorawanConfigDELTA_PAGE_SIZE bytes, the LZSS window and a small cache of
+ * the old image, whatever the size of the images.
+ */
+typedef struct DeltaPatch
+{
+    const FragDecoderStorage_t * pOld;  /**< @brief Storage the old image is read from. */
+    const FragDecoderStorage_t * pNew;  /**< @brief Storage the new image is written to, in order. */
+    DeltaPatchStatus_t status;
+    uint8_t state;
+    uint8_t header[ DELTA_PATCH_HEADER_SIZE ];
+    uint32_t headerLength;
+    uint32_t oldSize;
+    uint32_t newSize;
+    uint32_t newCrc;
+    uint8_t lzState;
+    uint8_t bitCount;                   /**< @brief Bits of the compressed patch not decoded yet. */
+    uint32_t bits;
+    uint32_t windowPosition;            /**< @brief Operations decompressed, modulo the window size. */
+    uint8_t window[ 1U << DELTA_PATCH_WINDOW_BITS ];
+    uint32_t varint;                    /**< @brief Varint being decoded. */
+    uint8_t varintShift;
+    uint32_t opLength;                  /**< @brief Bytes left in the current operation. */
+    uint32_t runLength;                 /**< @brief Bytes left in the current run of zeros or literals of an ADD. */
+    uint32_t oldPosition;               /**< @brief Position in the old image. */
+    uint32_t newPosition;               /**< @brief Bytes of the new image produced. */
+    uint32_t crc;                       /**< @brief CRC-32 of the new image produced. */
+    uint32_t cacheOffset;               /**< @brief Offset of the old image in the cache. */
+    uint32_t cacheLength;
+    uint8_t cache[ 64 ];
+    uint32_t pageLength;
+    uint8_t page[ lorawanConfigDELTA_PAGE_SIZE ];
+} DeltaPatch_t;
+
+/**
+ * @brief Tells whether a data block is a patch, from its first bytes.
+ *
+ * @param[in] pData First bytes of the block.
+ * @param[in] length Number of bytes, at least 4 for a patch.
+ * @return true if the block starts with the magic of a patch.
+ */
+bool DeltaPatch_IsPatch( const uint8_t * pData,
+                         size_t length );
+
+/**
+ * @brief Starts the application of a patch.
+ *
+ * @param[out] pPatch Patch application state.
+ * @param[in] pOld Storage of the old image.
+ * @param[in] pNew Storage of the new image. Written from offset 0 in lorawanConfigDELTA_PAGE_SIZE chunks, the last one shorter.
+ */
+void DeltaPatch_Init( DeltaPatch_t * pPatch,
+                      const FragDecoderStorage_t * pOld,
+                      const FragDecoderStorage_t * pNew );
+
+/**
+ * @brief Processes the next bytes of a patch.
+ *
+ * @param[in] pPatch Patch application state.
+ * @param[in] pData Patch bytes.
+ * @param[in] length Number of bytes.
+ * @return State of the application. The bytes following the end of the patch are ignored.
+ */
+DeltaPatchStatus_t DeltaPatch_Process( DeltaPatch_t * pPatch,
+                                       const uint8_t * pData,
+                                       size_t length );
+
+/**
+ * @brief Applies a patch read from a storage, in small chunks.
+ *
+ * @param[in] pPatch Patch application state, initialized with DeltaPatch_Init().
+ * @param[in] pStorage Storage holding the patch.
+ * @param[in] offset Offset of the patch in the storage.
+ * @param[in] size Size of the patch.
+ * @return DELTA_PATCH_DONE if the new image was written and verified.
+ */
+DeltaPatchStatus_t DeltaPatch_Apply( DeltaPatch_t * pPatch,
+                                     const FragDecoderStorage_t * pStorage,
+                                     uint32_t offset,
+                                     uint32_t size );
+
+#endif /* DELTA_PATCH_H */
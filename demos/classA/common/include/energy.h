@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LoRaWANConfig.h"
+
+/**
+ * @brief States of the radio, in which it draws a constant current.
+ */
+typedef enum EnergyRadioState
+{
+    ENERGY_RADIO_SLEEP = 0,     /**< @brief Sleep, configuration retained. */
+    ENERGY_RADIO_STANDBY,       /**< @brief Standby, and frequency synthesis before a transmission or a reception. */
+    ENERGY_RADIO_TX,            /**< @brief Transmitting, at the power set with Energy_SetTxPower(). */
+    ENERGY_RADIO_RX,            /**< @brief Receiving or detecting a preamble. */
+    ENERGY_RADIO_STATES
+} EnergyRadioState_t;
+
+/**
+ * @brief Categories the charge is accounted in.
+ */
+typedef enum EnergyCategory
+{
+    ENERGY_CATEGORY_MCU_RUN = 0,        /**< @brief MCU running, the time it did not sleep. */
+    ENERGY_CATEGORY_MCU_SLEEP,          /**< @brief MCU in its low power mode. */
+    ENERGY_CATEGORY_RADIO_SLEEP,        /**< @brief Radio in ENERGY_RADIO_SLEEP, the radio categories follow the states. */
+    ENERGY_CATEGORY_RADIO_STANDBY,
+    ENERGY_CATEGORY_RADIO_TX,
+    ENERGY_CATEGORY_RADIO_RX,
+    ENERGY_CATEGORY_SPI,                /**< @brief SPI transfers with the radio, on top of the MCU. */
+    ENERGY_CATEGORY_LOG,                /**< @brief Console output of the logs, on top of the MCU. */
+    ENERGY_CATEGORIES
+} EnergyCategory_t;
+
+/**
+ * @brief Size of a report encoded by Energy_EncodeReport(), which fits the smallest payload of the regions, 11 bytes at
+ * DR0 in US915.
+ */
+#define ENERGY_REPORT_SIZE    ( 11U )
+
+/**
+ * @brief Charge drawn, in uAh, since the initialization and during the last uplink cycle.
+ */
+typedef struct EnergyReport
+{
+    float chargeUah[ ENERGY_CATEGORIES ];   /**< @brief Charge of each category since the initialization. */
+    float totalUah;                         /**< @brief Sum of the categories since the initialization. */
+    float cycleUah[ ENERGY_CATEGORIES ];    /**< @brief Charge of each category during the last complete uplink cycle. */
+    float cycleTotalUah;                    /**< @brief Sum of the categories during the last complete uplink cycle. */
+    float averageUa;                        /**< @brief Average current since the initialization. */
+    float batteryDays;                      /**< @brief Life of a battery of lorawanConfigENERGY_BATTERY_MAH at this current. */
+    uint32_t elapsedMs;                     /**< @brief Time accounted since the initialization. */
+    uint32_t cycleMs;                       /**< @brief Duration of the last complete uplink cycle. */
+    uint32_t cycles;                        /**< @brief Uplink cycles started since the initialization. */
+} EnergyReport_t;
+
+/**
+ * @brief Energy accounting.
+ *
+ * The radio is modelled as a state machine: the time spent in each state is charged at the current of the state when the
+ * state is left, the transmissions at the current of their output power, interpolated in
+ * lorawanConfigENERGY_TX_POWER_POINTS. The MCU is charged at lorawanConfigENERGY_MCU_SLEEP_UA for the time it slept, and
+ * at lorawanConfigENERGY_MCU_RUN_UA for the rest, plus the active time added by Energy_AddMcuActive() where time does
+ * not pass while it runs. SPI and log bytes are charged for their transfer time at the current of the peripheral.
+ *
+ * Charges are kept in nA ms, which hold years of transmissions. Times are in ms of a 32 bit clock, intervals between two
+ * updates must stay below its wrap.
+ */
+typedef struct Energy
+{
+    uint32_t lastMs;                        /**< @brief Time of the last update. */
+    uint64_t elapsedMs;                     /**< @brief Time accounted up to lastMs. */
+    EnergyRadioState_t radioState;
+    int8_t txPower;                         /**< @brief Output power in dBm of the transmissions. */
+    uint64_t radioNaMs[ ENERGY_RADIO_STATES ];
+    uint64_t mcuSleepUs;
+    uint64_t mcuActiveUs;                   /**< @brief Active time added on top of the time that did not pass in sleep. */
+    uint64_t spiBytes;
+    uint64_t logBytes;
+    uint64_t cycleStartNaMs[ ENERGY_CATEGORIES ];
+    uint64_t cycleNaMs[ ENERGY_CATEGORIES ];
+    uint64_t cycleStartMs;                  /**< @brief Time accounted when the current cycle started. */
+    uint32_t cycleMs;
+    uint32_t cycles;
+} Energy_t;
+
+/**
+ * @brief Returns the current drawn by the radio while transmitting.
+ *
+ * @param[in] power Output power in dBm.
+ * @return Current in uA, from lorawanConfigENERGY_TX_POWER_POINTS, held at the first and last points.
+ */
+float Energy_GetTxCurrent( int8_t power );
+
+/**
+ * @brief Returns a short name of a category, for the logs.
+ */
+const char * Energy_GetCategoryName( EnergyCategory_t category );
+
+/**
+ * @brief Starts an accounting with the radio asleep.
+ *
+ * @param[out] pEnergy Accounting.
+ * @param[in] nowMs Current time.
+ */
+void Energy_Init( Energy_t * pEnergy,
+                  uint32_t nowMs );
+
+/**
+ * @brief Records a transition of the radio. The time spent in the previous state is charged.
+ *
+ * @param[in] pEnergy Accounting.
+ * @param[in] state New state.
+ * @param[in] nowMs Time of the transition.
+ */
+void Energy_SetRadioState( Energy_t * pEnergy,
+                           EnergyRadioState_t state,
+                           uint32_t nowMs );
+
+/**
+ * @brief Sets the output power of the next transmissions.
+ *
+ * @param[in] pEnergy Accounting.
+ * @param[in] power Output power in dBm.
+ * @param[in] nowMs Current time.
+ */
+void Energy_SetTxPower( Energy_t * pEnergy,
+                        int8_t power,
+                        uint32_t nowMs );
+
+/**
+ * @brief Records a time the MCU spent in its low power mode.
+ *
+ * @param[in] pEnergy Accounting.
+ * @param[in] sleepUs Time asleep in us.
+ */
+void Energy_AddMcuSleep( Energy_t * pEnergy,
+                         uint32_t sleepUs );
+
+/**
+ * @brief Records a time the MCU ran which is not in the elapsed time, such as on the host simulator.
+ *
+ * @param[in] pEnergy Accounting.
+ * @param[in] activeUs Active time in us.
+ */
+void Energy_AddMcuActive( Energy_t * pEnergy,
+                          uint32_t activeUs );
+
+/**
+ * @brief Records bytes transferred with the radio over SPI.
+ */
+void Energy_AddSpiBytes( Energy_t * pEnergy,
+                         uint32_t bytes );
+
+/**
+ * @brief Records bytes written to the console.
+ */
+void Energy_AddLogBytes( Energy_t * pEnergy,
+                         uint32_t bytes );
+
+/**
+ * @brief Ends the current uplink cycle and starts the next one, at the start of an uplink.
+ *
+ * @param[in] pEnergy Accounting.
+ * @param[in] nowMs Current time.
+ */
+void Energy_StartCycle( Energy_t * pEnergy,
+                        uint32_t nowMs );
+
+/**
+ * @brief Computes the charges.
+ *
+ * @param[in] pEnergy Accounting.
+ * @param[in] nowMs Current time, the state of the radio is charged up to it.
+ * @param[out] pReport Report.
+ */
+void Energy_GetReport( const Energy_t * pEnergy,
+                       uint32_t nowMs,
+                       EnergyReport_t * pReport );
+
+/**
+ * @brief Encodes a report for a diagnostic uplink, little endian:
+ * - bytes 0-1: average current since the initialization, in 0.1 uA,
+ * - bytes 2-3: charge of the last uplink cycle, in 0.1 uAh,
+ * - bytes 4-10: share of the last uplink cycle of each category but ENERGY_CATEGORY_LOG, in 0.5 %, the log has the rest.
+ * Values too large for their field are saturated.
+ *
+ * @param[in] pReport Report.
+ * @param[out] pBuffer Payload.
+ * @param[in] length Size of the payload buffer.
+ * @return Size of the payload, ENERGY_REPORT_SIZE, or 0 if the buffer is too small.
+ */
+size_t Energy_EncodeReport( const EnergyReport_t * pReport,
+                            uint8_t * pBuffer,
+                            size_t length );
+
+#endif /* ENERGY_H */
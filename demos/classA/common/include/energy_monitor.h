@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef ENERGY_MONITOR_H
+#define ENERGY_MONITOR_H
+
+#include <stdint.h>
+
+#include "energy.h"
+
+/**
+ * @file energy_monitor.h
+ * @brief Energy accounting of the device, fed by the board.
+ *
+ * The radio boards report the transitions of the radio and the output power, the SPI driver the bytes transferred, the
+ * tickless idle the time the MCU slept, and the console the bytes printed. The transitions are timestamped with the
+ * RTOS tick, so they can be reported from tasks and interrupts. LoRaWAN_Send() starts the uplink cycles, and the charges
+ * are read with LoRaWAN_GetEnergyReport().
+ */
+
+/**
+ * @brief Records a transition of the radio.
+ */
+void EnergyMonitor_SetRadioState( EnergyRadioState_t state );
+
+/**
+ * @brief Records the output power in dBm of the next transmissions.
+ */
+void EnergyMonitor_SetTxPower( int8_t power );
+
+/**
+ * @brief Records a time the MCU spent in its low power mode, in us.
+ */
+void EnergyMonitor_AddMcuSleep( uint32_t sleepUs );
+
+/**
+ * @brief Records a time in us the MCU ran without the tick advancing, see Energy_AddMcuActive().
+ */
+void EnergyMonitor_AddMcuActive( uint32_t activeUs );
+
+/**
+ * @brief Records bytes transferred with the radio over SPI.
+ */
+void EnergyMonitor_AddSpiBytes( uint32_t bytes );
+
+/**
+ * @brief Records bytes written to the console.
+ */
+void EnergyMonitor_AddLogBytes( uint32_t bytes );
+
+/**
+ * @brief Ends the current uplink cycle and starts the next one.
+ */
+void EnergyMonitor_StartCycle( void );
+
+/**
+ * @brief Computes the charges up to now.
+ *
+ * @param[out] pReport Report.
+ */
+void EnergyMonitor_GetReport( EnergyReport_t * pReport );
+
+#endif /* ENERGY_MONITOR_H */
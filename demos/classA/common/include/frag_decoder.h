@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef FRAG_DECODER_H
+#define FRAG_DECODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LoRaWANConfig.h"
+
+/**
+ * @brief Storage the data block is decoded into, typically a flash area as large as the block.
+ *
+ * The fragments are written at their place in the block as they are received. The place of a lost fragment holds
+ * intermediate decoding results until the fragment is recovered, so the storage must allow a place to be written again.
+ */
+typedef struct FragDecoderStorage
+{
+    uint32_t size;                                          /**< @brief Size of the storage in bytes. */
+    bool ( * write )( uint32_t offset,
+                      const uint8_t * pData,
+                      uint32_t length );                    /**< @brief Writes length bytes at offset, returns false on failure. */
+    bool ( * read )( uint32_t offset,
+                     uint8_t * pData,
+                     uint32_t length );                     /**< @brief Reads length bytes at offset, returns false on failure. */
+    bool ( * activate )( uint32_t blockSize );              /**< @brief Makes use of a verified data block, for instance boots it. Optional. */
+} FragDecoderStorage_t;
+
+/**
+ * @brief State of a decoding.
+ */
+typedef enum FragDecoderStatus
+{
+    FRAG_DECODER_ONGOING = 0,   /**< @brief More fragments are needed. */
+    FRAG_DECODER_DONE,          /**< @brief All the fragments are in the storage. */
+    FRAG_DECODER_TOO_MANY_LOST, /**< @brief More fragments were lost than lorawanConfigFRAG_MAX_REDUNDANCY, the block cannot be recovered. */
+    FRAG_DECODER_STORAGE_ERROR  /**< @brief The storage failed, the block cannot be recovered. */
+} FragDecoderStatus_t;
+
+/**
+ * @brief Decoder of a data block sent with the forward error correction code of the LoRaWAN fragmented data block
+ * transport (TS004).
+ *
+ * The uncoded fragments go straight to the storage. Each coded fragment is the XOR of about half of the fragments, chosen
+ * by a pseudo random parity matrix, and is reduced against the fragments already received so that only the lost ones
+ * remain. The relation between the lost fragments is kept as a row of a bit matrix, and the reduced payload is stored at
+ * the place of a lost fragment until it is recovered. The RAM used is therefore bounded by the maximum number of
+ * fragments and of lost fragments, whatever the size of the block.
+ */
+typedef struct FragDecoder
+{
+    const FragDecoderStorage_t * pStorage;
+    uint16_t nbFrag;                                                    /**< @brief Number of uncoded fragments of the block. */
+    uint8_t fragSize;                                                   /**< @brief Size of a fragment in bytes. */
+    FragDecoderStatus_t status;
+    uint16_t nbReceived;                                                /**< @brief Fragments received, coded or not. */
+    uint16_t lastCounter;                                               /**< @brief Highest fragment counter received. */
+    uint16_t nbLost;                                                    /**< @brief Uncoded fragments lost when the coded ones started. */
+    uint16_t rank;                                                      /**< @brief Lost fragments for which the matrix has a row. */
+    bool coded;                                                         /**< @brief Set once a coded fragment was received. */
+    uint8_t received[ ( lorawanConfigFRAG_MAX_NB + 7 ) / 8 ];           /**< @brief Uncoded fragments received before the coded ones. */
+    uint8_t parity[ ( lorawanConfigFRAG_MAX_NB + 7 ) / 8 ];             /**< @brief Parity matrix row of the fragment processed. */
+    uint8_t rowDefined[ ( lorawanConfigFRAG_MAX_REDUNDANCY + 7 ) / 8 ]; /**< @brief Lost fragments which have a row in the matrix. */
+    uint8_t vector[ ( lorawanConfigFRAG_MAX_REDUNDANCY + 7 ) / 8 ];     /**< @brief Lost fragments the fragment processed depends on. */
+    uint8_t data[ lorawanConfigFRAG_MAX_SIZE ];
+    uint8_t scratch[ lorawanConfigFRAG_MAX_SIZE ];
+
+    /** @brief Row i relates lost fragment i to the following ones, the columns are the lost fragments. */
+    uint8_t matrix[ lorawanConfigFRAG_MAX_REDUNDANCY ][ ( lorawanConfigFRAG_MAX_REDUNDANCY + 7 ) / 8 ];
+} FragDecoder_t;
+
+/**
+ * @brief Starts the decoding of a data block.
+ *
+ * @param[out] pDecoder Decoder.
+ * @param[in] nbFrag Number of uncoded fragments of the block.
+ * @param[in] fragSize Size of the fragments.
+ * @param[in] pStorage Storage of the block, at least nbFrag * fragSize bytes.
+ * @return false if the block exceeds the limits of the decoder or the storage.
+ */
+bool FragDecoder_Init( FragDecoder_t * pDecoder,
+                       uint16_t nbFrag,
+                       uint8_t fragSize,
+                       const FragDecoderStorage_t * pStorage );
+
+/**
+ * @brief Processes a fragment.
+ *
+ * @param[in] pDecoder Decoder.
+ * @param[in] counter Fragment counter, from 1 to nbFrag for the uncoded fragments, above for the coded ones.
+ * @param[in] pData Payload of the fragment, fragSize bytes.
+ * @return State of the decoding. Fragments received once the decoding is over are ignored.
+ */
+FragDecoderStatus_t FragDecoder_Process( FragDecoder_t * pDecoder,
+                                         uint16_t counter,
+                                         const uint8_t * pData );
+
+/**
+ * @brief Returns the number of fragments still missing to recover the block.
+ */
+uint16_t FragDecoder_GetMissing( const FragDecoder_t * pDecoder );
+
+/**
+ * @brief Computes a row of the TS004 parity matrix: the uncoded fragments combined in the coded fragment nbFrag + n.
+ *
+ * @param[in] n Index of the coded fragment, from 1.
+ * @param[in] nbFrag Number of uncoded fragments.
+ * @param[out] pRow Bit i set if fragment i + 1 is combined, (nbFrag + 7) / 8 bytes.
+ */
+void FragDecoder_GetParityRow( uint32_t n,
+                               uint16_t nbFrag,
+                               uint8_t * pRow );
+
+/**
+ * @brief Delay of the answer of a device to a FragSessionStatusReq received over multicast, so that the devices of the
+ * group do not all answer at once: 2^( BlockAckDelay + 4 ) to 2^( BlockAckDelay + 5 ) seconds, as TS004 defines it.
+ *
+ * @param[in] blockAckDelay BlockAckDelay of the FragSessionSetupReq of the session, from 0 to 7.
+ * @param[in] random Random number, spread over the window.
+ * @return Delay in milliseconds.
+ */
+uint32_t FragDecoder_GetAnswerDelayMs( uint8_t blockAckDelay,
+                                       uint32_t random );
+
+/**
+ * @brief Updates a CRC-32 (IEEE 802.3) with a buffer. Start with 0.
+ * The data blocks of the demo end with the CRC-32 of the rest of the block, little endian, to verify them once decoded.
+ */
+uint32_t FragDecoder_Crc32( uint32_t crc,
+                            const uint8_t * pData,
+                            size_t length );
+
+#endif /* FRAG_DECODER_H */
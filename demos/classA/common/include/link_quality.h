@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LoRaWANConfig.h"
+
+/**
+ * @brief Kinds of frame records, combined in LinkQualityRecord_t::flags.
+ */
+#define LINK_QUALITY_DOWNLINK    ( 0x01U ) /**< @brief A downlink was received, rssi and snr are valid. */
+#define LINK_QUALITY_MARGIN      ( 0x02U ) /**< @brief A link check was answered, margin is valid. */
+#define LINK_QUALITY_TX          ( 0x04U ) /**< @brief A transmission of a confirmed uplink. */
+#define LINK_QUALITY_LOST        ( 0x08U ) /**< @brief The transmission was not acknowledged. */
+
+/**
+ * @brief Record of a frame in the rolling window.
+ */
+typedef struct LinkQualityRecord
+{
+    int16_t rssi;   /**< @brief RSSI of the downlink in dBm. */
+    int8_t snr;     /**< @brief SNR of the downlink in dB. */
+    uint8_t margin; /**< @brief Demodulation margin in dB of the uplink, as reported by a LinkCheckAns. */
+    uint8_t flags;
+} LinkQualityRecord_t;
+
+/**
+ * @brief Link statistics, over the rolling window for the counts, the extremes and the packet error rate.
+ */
+typedef struct LinkQualityStats
+{
+    int16_t lastRssi;        /**< @brief RSSI of the last downlink in dBm. */
+    int8_t lastSnr;          /**< @brief SNR of the last downlink in dB. */
+    float rssiAverage;       /**< @brief Exponentially weighted average of the downlink RSSI in dBm. */
+    float snrAverage;        /**< @brief Exponentially weighted average of the downlink SNR in dB. */
+    float marginAverage;     /**< @brief Exponentially weighted average of the uplink demodulation margin in dB. */
+    int8_t snrMin;           /**< @brief Lowest downlink SNR in the window, the worst case a data rate must cope with. */
+    uint8_t gateways;        /**< @brief Gateways which received the last link check. */
+    uint16_t downlinks;      /**< @brief Downlinks in the window. */
+    uint16_t transmissions;  /**< @brief Transmissions of confirmed uplinks in the window. */
+    float packetErrorRate;   /**< @brief Unacknowledged transmissions over transmissions in the window, 0 if there were none. */
+    uint32_t records;        /**< @brief Frames recorded since the initialization. */
+} LinkQualityStats_t;
+
+/**
+ * @brief Link quality estimator.
+ *
+ * Every frame with link information is recorded in a rolling window of lorawanConfigLINK_QUALITY_WINDOW records: the RSSI
+ * and SNR of the downlinks, the demodulation margin of the link checks, and the outcome of every transmission of the
+ * confirmed uplinks. The averages are weighted by lorawanConfigLINK_QUALITY_EWMA_WEIGHT, so they follow a change of the
+ * link within a few frames whatever the window size.
+ */
+typedef struct LinkQuality
+{
+    LinkQualityRecord_t window[ lorawanConfigLINK_QUALITY_WINDOW ];
+    uint16_t next;           /**< @brief Record written next. */
+    uint16_t count;          /**< @brief Records in the window. */
+    uint32_t records;
+    int16_t lastRssi;
+    int8_t lastSnr;
+    uint8_t gateways;
+    bool downlinkSeen;       /**< @brief Set once the averages of the downlinks were started. */
+    bool marginSeen;         /**< @brief Set once the average of the margin was started. */
+    float rssiAverage;
+    float snrAverage;
+    float marginAverage;
+} LinkQuality_t;
+
+/**
+ * @brief Starts an estimation with an empty window.
+ *
+ * @param[out] pLink Estimator.
+ */
+void LinkQuality_Init( LinkQuality_t * pLink );
+
+/**
+ * @brief Records a received downlink.
+ *
+ * @param[in] pLink Estimator.
+ * @param[in] rssi RSSI of the downlink in dBm.
+ * @param[in] snr SNR of the downlink in dB.
+ */
+void LinkQuality_AddDownlink( LinkQuality_t * pLink,
+                              int16_t rssi,
+                              int8_t snr );
+
+/**
+ * @brief Records the answer to a link check.
+ *
+ * @param[in] pLink Estimator.
+ * @param[in] margin Demodulation margin of the uplink in dB.
+ * @param[in] gateways Number of gateways which received the uplink.
+ */
+void LinkQuality_AddLinkCheck( LinkQuality_t * pLink,
+                               uint8_t margin,
+                               uint8_t gateways );
+
+/**
+ * @brief Records the transmissions of a confirmed uplink, all lost but the last one if it was acknowledged.
+ *
+ * @param[in] pLink Estimator.
+ * @param[in] transmissions Number of transmissions, at least 1.
+ * @param[in] acked true if the last transmission was acknowledged.
+ */
+void LinkQuality_AddUplink( LinkQuality_t * pLink,
+                            uint8_t transmissions,
+                            bool acked );
+
+/**
+ * @brief Computes the statistics of the link.
+ *
+ * @param[in] pLink Estimator.
+ * @param[out] pStats Statistics. The averages are 0 until a frame of their kind was recorded.
+ */
+void LinkQuality_GetStats( const LinkQuality_t * pLink,
+                           LinkQualityStats_t * pStats );
+
+/**
+ * @brief Estimates the probability that a transmission is not acknowledged, from the confirmed uplinks in the window.
+ *
+ * The estimate is (lost + 1) / (transmissions + 2), which stays away from 0 and 1 on a few transmissions, so that a short
+ * run of acknowledged frames does not make retransmissions look useless.
+ *
+ * @param[in] pLink Estimator.
+ * @param[out] pTransmissions Transmissions the estimate is made from. Optional.
+ * @return Packet error rate, 0.5 when there was no transmission.
+ */
+float LinkQuality_GetErrorRate( const LinkQuality_t * pLink,
+                                uint16_t * pTransmissions );
+
+#endif /* LINK_QUALITY_H */
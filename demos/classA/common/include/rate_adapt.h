@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef RATE_ADAPT_H
+#define RATE_ADAPT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LoRaWANConfig.h"
+
+/**
+ * @brief Link budget of a data rate step, from the sensitivity of successive spreading factors, and of a transmit
+ * power step, as defined by LoRaWAN.
+ */
+#define RATE_ADAPT_DATARATE_STEP_DB    ( 2.5f )
+#define RATE_ADAPT_TX_POWER_STEP_DB    ( 2.0f )
+
+/**
+ * @brief Weight of a new margin in the margin estimate. High, as the margin of a moving device changes quickly.
+ */
+#define RATE_ADAPT_MARGIN_WEIGHT       ( 0.5f )
+
+/**
+ * @brief Device side rate adaptation, for devices with the network ADR disabled, such as moving ones.
+ *
+ * Every lorawanConfigRATE_LINK_CHECK_PERIOD uplinks a LinkCheckReq measures the demodulation margin of the uplink at the
+ * gateways. The margin is kept in an estimate at the current data rate and transmit power, and compared with
+ * lorawanConfigRATE_MARGIN_DB, lowered by lorawanConfigRATE_GATEWAY_DIVERSITY_DB when several gateways received the
+ * uplink. A lack of margin is made up at once, by raising the transmit power, then lowering the data rate. An excess is
+ * used one step per link check and only beyond lorawanConfigRATE_HYSTERESIS_DB, by raising the data rate, then lowering
+ * the transmit power. After lorawanConfigRATE_FALLBACK_LOSSES lost frames in a row, unacknowledged transmissions or
+ * unanswered link checks, the device goes to full power and one data rate lower at each further loss, and measures the
+ * margin again.
+ */
+typedef struct RateAdapt
+{
+    uint8_t dataRate;           /**< @brief Data rate of the next uplink. */
+    uint8_t txPower;            /**< @brief Transmit power index of the next uplink, 0 is the highest power. */
+    float margin;               /**< @brief Estimated margin at the current data rate and transmit power, in dB. */
+    bool marginValid;
+    uint8_t gateways;           /**< @brief Gateways which received the last link check. */
+    uint8_t losses;             /**< @brief Frames lost in a row. */
+    uint16_t uplinks;           /**< @brief Uplinks since the last link check. */
+    bool probePending;          /**< @brief Set while a link check waits for its answer. */
+    uint8_t probeDataRate;      /**< @brief Data rate the pending link check was sent at. */
+    uint8_t probeTxPower;       /**< @brief Transmit power index the pending link check was sent at. */
+    uint32_t changes;           /**< @brief Changes of data rate or transmit power. */
+    uint32_t fallbacks;         /**< @brief Changes caused by losses. */
+} RateAdapt_t;
+
+/**
+ * @brief Starts the rate adaptation.
+ *
+ * @param[out] pRate Rate adaptation state.
+ * @param[in] dataRate Data rate to start from, clamped to the configured range.
+ * @param[in] txPower Transmit power index to start from.
+ */
+void RateAdapt_Init( RateAdapt_t * pRate,
+                     uint8_t dataRate,
+                     uint8_t txPower );
+
+/**
+ * @brief Counts an uplink about to be sent and tells whether it should carry a LinkCheckReq.
+ *
+ * @param[in] pRate Rate adaptation state.
+ * @return true if a link check is due, it is then expected to be answered or reported lost.
+ */
+bool RateAdapt_OnUplink( RateAdapt_t * pRate );
+
+/**
+ * @brief Processes the answer to a link check.
+ *
+ * @param[in] pRate Rate adaptation state.
+ * @param[in] margin Demodulation margin of the uplink in dB.
+ * @param[in] gateways Number of gateways which received the uplink.
+ */
+void RateAdapt_OnLinkCheck( RateAdapt_t * pRate,
+                            uint8_t margin,
+                            uint8_t gateways );
+
+/**
+ * @brief Processes a link check left unanswered.
+ *
+ * @param[in] pRate Rate adaptation state.
+ */
+void RateAdapt_OnLinkCheckLost( RateAdapt_t * pRate );
+
+/**
+ * @brief Processes the outcome of a confirmed uplink.
+ *
+ * @param[in] pRate Rate adaptation state.
+ * @param[in] transmissions Number of transmissions, at least 1.
+ * @param[in] acked true if the last transmission was acknowledged.
+ */
+void RateAdapt_OnConfirmed( RateAdapt_t * pRate,
+                            uint8_t transmissions,
+                            bool acked );
+
+#endif /* RATE_ADAPT_H */
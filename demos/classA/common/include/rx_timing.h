@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef RX_TIMING_H
+#define RX_TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LoRaWANConfig.h"
+
+/**
+ * @brief Timing statistics of the receive windows.
+ */
+typedef struct RxTimingStats
+{
+    float biasMs;           /**< @brief Mean offset of the downlinks from their expected time, positive when late. */
+    float driftPpm;         /**< @brief Offset growing with the receive delay, the crystal drift against the network. */
+    float jitterMs;         /**< @brief Standard deviation of the offsets around the bias and the drift. */
+    uint16_t window;        /**< @brief Downlinks in the window. */
+    uint16_t missed;        /**< @brief Receive windows missed in a row since the last downlink. */
+    uint32_t maxRxErrorMs;  /**< @brief Timing error given to LoRaMAC for the receive windows. */
+    uint8_t minRxSymbols;   /**< @brief Preamble symbols the receive windows must cover. */
+    uint32_t samples;       /**< @brief Downlinks measured since the initialization. */
+    uint32_t fallbacks;     /**< @brief Returns to lorawanConfigRX_MAX_TIMING_ERROR after too many missed windows. */
+} RxTimingStats_t;
+
+/**
+ * @brief Calibration of the timing error of the receive windows.
+ *
+ * LoRaMAC opens each receive window early and keeps it open long enough to catch the preamble despite the timing error it
+ * is given. A fixed worst case wastes most of this time once the actual error is known, so the offset between the expected
+ * and the measured end of each downlink is kept in a window of lorawanConfigRX_CALIBRATION_WINDOW samples, along with the
+ * receive delay it was measured after. A least squares fit splits the offsets into a bias and a drift proportional to the
+ * delay, and the timing error is the worst offset they predict plus three standard deviations of the rest, or the largest
+ * residual if more, plus lorawanConfigRX_CALIBRATION_GUARD_MS.
+ *
+ * Each missed window doubles the error and adds a preamble symbol, and lorawanConfigRX_CALIBRATION_MAX_MISSED in a row
+ * throw the samples away and return to lorawanConfigRX_MAX_TIMING_ERROR.
+ */
+typedef struct RxTiming
+{
+    float offsetMs[ lorawanConfigRX_CALIBRATION_WINDOW ];
+    uint32_t delayMs[ lorawanConfigRX_CALIBRATION_WINDOW ];
+    uint16_t next;           /**< @brief Sample written next. */
+    uint16_t count;          /**< @brief Samples in the window. */
+    uint16_t missed;
+    float biasMs;
+    float driftPpm;
+    float jitterMs;
+    uint32_t maxRxErrorMs;
+    uint8_t minRxSymbols;
+    uint32_t samples;
+    uint32_t fallbacks;
+} RxTiming_t;
+
+/**
+ * @brief Starts a calibration with lorawanConfigRX_MAX_TIMING_ERROR and lorawanConfigRX_MIN_SYMBOLS.
+ *
+ * @param[out] pTiming Calibration.
+ */
+void RxTiming_Init( RxTiming_t * pTiming );
+
+/**
+ * @brief Records the timing of a received downlink.
+ *
+ * @param[in] pTiming Calibration.
+ * @param[in] offsetMs Measured minus expected end of the downlink in ms, positive when late.
+ * @param[in] delayMs Delay of the receive window after the end of the uplink in ms.
+ * @return true if the timing error or the preamble symbols changed.
+ */
+bool RxTiming_AddDownlink( RxTiming_t * pTiming,
+                           float offsetMs,
+                           uint32_t delayMs );
+
+/**
+ * @brief Records receive windows where an expected downlink, such as an acknowledgement, was not received.
+ *
+ * @param[in] pTiming Calibration.
+ * @return true if the timing error or the preamble symbols changed.
+ */
+bool RxTiming_OnMissed( RxTiming_t * pTiming );
+
+/**
+ * @brief Gets the timing statistics and the settings to give to LoRaMAC.
+ *
+ * @param[in] pTiming Calibration.
+ * @param[out] pStats Statistics.
+ */
+void RxTiming_GetStats( const RxTiming_t * pTiming,
+                        RxTimingStats_t * pStats );
+
+#endif /* RX_TIMING_H */
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "LoRaWANConfig.h"
+
+/**
+ * @file task_monitor.h
+ * @brief Headroom of the tasks, the heap and the queues, sampled while the device runs.
+ *
+ * Every lorawanConfigMONITOR_PERIOD_SEC, a software timer reads the state of all the tasks: the share of the run time
+ * counter each one used since the previous sample, from the low power timer of the board so that the time asleep is
+ * counted for the idle task, and the least free stack it ever had. The minimum free heap since the boot and the most
+ * messages each queue registered with TaskMonitor_AddQueue() held are recorded alongside. The results stay in RAM, read
+ * with LoRaWAN_GetMonitorReport(), and TaskMonitor_EncodeReport() packs them for a diagnostic uplink.
+ */
+
+/**
+ * @brief Size of the start of an encoded report: the minimum free heap and the number of queues and tasks.
+ */
+#define TASK_MONITOR_REPORT_HEADER_SIZE    ( 3U )
+
+/**
+ * @brief Size of an encoded task.
+ */
+#define TASK_MONITOR_REPORT_TASK_SIZE      ( 5U )
+
+/**
+ * @brief A task seen by the monitor.
+ */
+typedef struct TaskMonitorTask
+{
+    char name[ configMAX_TASK_NAME_LEN ];
+    UBaseType_t number;             /**< @brief Number of the task, in the order of creation, the same at each boot. */
+    uint16_t cpuPermille;           /**< @brief Share of the run time used in the last period, in 0.1 %. */
+    uint16_t averageCpuPermille;    /**< @brief Share of the run time used since the first sample. */
+    uint16_t peakCpuPermille;       /**< @brief Highest share of a period. */
+    uint32_t stackFreeBytes;        /**< @brief Least free stack the task ever had. */
+    uint64_t runTime;               /**< @brief Run time counted since the first sample. */
+    uint32_t lastRunTime;           /**< @brief Run time counter of the task at the last sample. */
+} TaskMonitorTask_t;
+
+/**
+ * @brief A queue followed by the monitor.
+ */
+typedef struct TaskMonitorQueue
+{
+    const char * pName;
+    QueueHandle_t queue;
+    uint16_t length;
+    uint16_t highWater;             /**< @brief Most messages waiting in the queue at once. */
+} TaskMonitorQueue_t;
+
+/**
+ * @brief Results of the monitor.
+ */
+typedef struct TaskMonitorReport
+{
+    uint32_t samples;
+    uint32_t skippedSamples;        /**< @brief Samples skipped as there were more than lorawanConfigMONITOR_MAX_TASKS tasks. */
+    uint32_t taskCount;
+    TaskMonitorTask_t tasks[ lorawanConfigMONITOR_MAX_TASKS ];
+    uint32_t queueCount;
+    TaskMonitorQueue_t queues[ lorawanConfigMONITOR_MAX_QUEUES ];
+    size_t freeHeapBytes;
+    size_t minFreeHeapBytes;        /**< @brief Least free heap since the boot. */
+} TaskMonitorReport_t;
+
+/**
+ * @brief Starts the periodic samples, does nothing if they are already running or disabled.
+ *
+ * @return false if the timer of the samples cannot be created.
+ */
+bool TaskMonitor_Init( void );
+
+/**
+ * @brief Follows the fill of a queue, up to lorawanConfigMONITOR_MAX_QUEUES. A queue added again is ignored.
+ *
+ * @param[in] queue Queue.
+ * @param[in] pName Name of the queue in the reports, kept by reference.
+ */
+void TaskMonitor_AddQueue( QueueHandle_t queue,
+                           const char * pName );
+
+/**
+ * @brief Stops following a queue, before it is deleted. A queue which is not followed is ignored.
+ *
+ * @param[in] queue Queue.
+ */
+void TaskMonitor_RemoveQueue( QueueHandle_t queue );
+
+/**
+ * @brief Records the fill of a queue after a message was sent to it, so that the high water mark does not depend on
+ * the samples. Can be called from interrupts.
+ */
+void TaskMonitor_OnQueueSend( QueueHandle_t queue );
+
+/**
+ * @brief Takes a sample now, as the timer does.
+ */
+void TaskMonitor_Sample( void );
+
+/**
+ * @brief Copies the results of the monitor.
+ *
+ * @param[out] pReport Results.
+ */
+void TaskMonitor_GetReport( TaskMonitorReport_t * pReport );
+
+/**
+ * @brief Encodes a report for a diagnostic uplink, little endian:
+ * - bytes 0-1: least free heap since the boot, in 16 bytes,
+ * - byte 2: number of queues in the high nibble, of tasks encoded in the low nibble,
+ * - one byte per queue: most messages it held,
+ * - per task, the task with the least free stack first, as many as fit: its number, its average and peak CPU share in
+ *   0.5 %, and its least free stack in bytes, on 2 bytes.
+ * Values too large for their field are saturated.
+ *
+ * @param[in] pReport Report.
+ * @param[out] pBuffer Payload.
+ * @param[in] length Size of the payload buffer, the tasks which do not fit are left out.
+ * @return Size of the payload, or 0 if the buffer cannot hold the header and the queues.
+ */
+size_t TaskMonitor_EncodeReport( const TaskMonitorReport_t * pReport,
+                                 uint8_t * pBuffer,
+                                 size_t length );
+
+#endif /* TASK_MONITOR_H */
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef TEMP_COMP_H
+#define TEMP_COMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LoRaWANConfig.h"
+
+/**
+ * @brief Temperature compensation statistics.
+ */
+typedef struct TempCompStats
+{
+    float temperature;      /**< @brief Filtered temperature in degrees Celsius. */
+    float ppm;              /**< @brief Frequency error of the crystal at this temperature, positive if it runs fast. */
+    float correctionMs;     /**< @brief Correction added to the local time base since the initialization. */
+    uint32_t samples;       /**< @brief Temperature samples since the initialization. */
+} TempCompStats_t;
+
+/**
+ * @brief Temperature compensation of the 32 kHz crystal.
+ *
+ * A tuning fork crystal runs slower on both sides of its turnover temperature, by lorawanConfigTEMP_COMP_COEFFICIENT
+ * ppm per square degree, plus the offset of the unit at the turnover, lorawanConfigTEMP_COMP_OFFSET_PPM. The frequency
+ * error at the last sampled temperature is integrated over the local time, so that the corrected time base advances at
+ * the rate of real time, and the timer periods are converted to the ticks the crystal counts at this temperature.
+ */
+typedef struct TempComp
+{
+    bool started;           /**< @brief Set once a temperature was sampled. */
+    float temperature;
+    float ppm;
+    uint64_t lastMs;        /**< @brief Local time the correction was integrated to. */
+    int64_t correctionUs;   /**< @brief Correction integrated up to lastMs, in us. */
+    uint32_t samples;
+} TempComp_t;
+
+/**
+ * @brief Computes the frequency error of the crystal with the parabolic model.
+ *
+ * @param[in] temperature Temperature in degrees Celsius.
+ * @return Frequency error in ppm, positive if the crystal runs fast.
+ */
+float TempComp_GetPpm( float temperature );
+
+/**
+ * @brief Converts a period of real time to the period the timers must count with a crystal off by ppm.
+ *
+ * @param[in] periodMs Period in ms of real time.
+ * @param[in] ppm Frequency error of the crystal, positive if it runs fast.
+ * @return Period in ms of the crystal.
+ */
+uint32_t TempComp_CompensatePeriod( uint32_t periodMs,
+                                    float ppm );
+
+/**
+ * @brief Starts a compensation with no correction, until the first temperature sample.
+ *
+ * @param[out] pComp Compensation.
+ * @param[in] localMs Local time, from the crystal.
+ */
+void TempComp_Init( TempComp_t * pComp,
+                    uint64_t localMs );
+
+/**
+ * @brief Records a temperature sample. The correction is integrated up to localMs at the previous temperature.
+ *
+ * @param[in] pComp Compensation.
+ * @param[in] temperature Temperature in degrees Celsius.
+ * @param[in] localMs Local time, from the crystal.
+ */
+void TempComp_AddSample( TempComp_t * pComp,
+                         float temperature,
+                         uint64_t localMs );
+
+/**
+ * @brief Corrects a local time for the frequency error of the crystal since the initialization.
+ *
+ * @param[in] pComp Compensation.
+ * @param[in] localMs Local time, from the crystal, not before the last sample.
+ * @return Corrected time in ms.
+ */
+uint64_t TempComp_GetTimeMs( const TempComp_t * pComp,
+                             uint64_t localMs );
+
+/**
+ * @brief Gets the temperature and the correction applied.
+ *
+ * @param[in] pComp Compensation.
+ * @param[in] localMs Local time, from the crystal, the correction is given at.
+ * @param[out] pStats Statistics.
+ */
+void TempComp_GetStats( const TempComp_t * pComp,
+                        uint64_t localMs,
+                        TempCompStats_t * pStats );
+
+#endif /* TEMP_COMP_H */
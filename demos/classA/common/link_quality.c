@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "link_quality.h"
+
+/*-----------------------------------------------------------*/
+
+static float prvAverage( float average,
+                         float sample )
+{
+    return average + ( lorawanConfigLINK_QUALITY_EWMA_WEIGHT * ( sample - average ) );
+}
+/*-----------------------------------------------------------*/
+
+/* Writes a record over the oldest one once the window is full. */
+static void prvAddRecord( LinkQuality_t * pLink,
+                          const LinkQualityRecord_t * pRecord )
+{
+    pLink->window[ pLink->next ] = *pRecord;
+    pLink->next = ( uint16_t ) ( ( pLink->next + 1U ) % lorawanConfigLINK_QUALITY_WINDOW );
+
+    if( pLink->count < lorawanConfigLINK_QUALITY_WINDOW )
+    {
+        pLink->count++;
+    }
+
+    pLink->records++;
+}
+/*-----------------------------------------------------------*/
+
+void LinkQuality_Init( LinkQuality_t * pLink )
+{
+    memset( pLink, 0, sizeof( LinkQuality_t ) );
+}
+/*-----------------------------------------------------------*/
+
+void LinkQuality_AddDownlink( LinkQuality_t * pLink,
+                              int16_t rssi,
+                              int8_t snr )
+{
+    LinkQualityRecord_t record = { 0 };
+
+    record.rssi = rssi;
+    record.snr = snr;
+    record.flags = LINK_QUALITY_DOWNLINK;
+    prvAddRecord( pLink, &record );
+
+    /* The averages start from the first sample rather than from 0 dB. */
+    if( pLink->downlinkSeen == false )
+    {
+        pLink->downlinkSeen = true;
+        pLink->rssiAverage = rssi;
+        pLink->snrAverage = snr;
+    }
+    else
+    {
+        pLink->rssiAverage = prvAverage( pLink->rssiAverage, rssi );
+        pLink->snrAverage = prvAverage( pLink->snrAverage, snr );
+    }
+
+    pLink->lastRssi = rssi;
+    pLink->lastSnr = snr;
+}
+/*-----------------------------------------------------------*/
+
+void LinkQuality_AddLinkCheck( LinkQuality_t * pLink,
+                               uint8_t margin,
+                               uint8_t gateways )
+{
+    LinkQualityRecord_t record = { 0 };
+
+    record.margin = margin;
+    record.flags = LINK_QUALITY_MARGIN;
+    prvAddRecord( pLink, &record );
+
+    if( pLink->marginSeen == false )
+    {
+        pLink->marginSeen = true;
+        pLink->marginAverage = margin;
+    }
+    else
+    {
+        pLink->marginAverage = prvAverage( pLink->marginAverage, margin );
+    }
+
+    pLink->gateways = gateways;
+}
+/*-----------------------------------------------------------*/
+
+void LinkQuality_AddUplink( LinkQuality_t * pLink,
+                            uint8_t transmissions,
+                            bool acked )
+{
+    LinkQualityRecord_t record = { 0 };
+    uint8_t i;
+
+    for( i = 1; i <= transmissions; i++ )
+    {
+        record.flags = LINK_QUALITY_TX;
+
+        if( ( i < transmissions ) || ( acked == false ) )
+        {
+            record.flags |= LINK_QUALITY_LOST;
+        }
+
+        prvAddRecord( pLink, &record );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void LinkQuality_GetStats( const LinkQuality_t * pLink,
+                           LinkQualityStats_t * pStats )
+{
+    const LinkQualityRecord_t * pRecord;
+    uint16_t lost = 0;
+    uint16_t i;
+
+    memset( pStats, 0, sizeof( LinkQualityStats_t ) );
+    pStats->lastRssi = pLink->lastRssi;
+    pStats->lastSnr = pLink->lastSnr;
+    pStats->rssiAverage = pLink->rssiAverage;
+    pStats->snrAverage = pLink->snrAverage;
+    pStats->marginAverage = pLink->marginAverage;
+    pStats->gateways = pLink->gateways;
+    pStats->records = pLink->records;
+    pStats->snrMin = INT8_MAX;
+
+    for( i = 0; i < pLink->count; i++ )
+    {
+        pRecord = &pLink->window[ i ];
+
+        if( ( pRecord->flags & LINK_QUALITY_DOWNLINK ) != 0U )
+        {
+            pStats->downlinks++;
+            pStats->snrMin = ( pRecord->snr < pStats->snrMin ) ? pRecord->snr : pStats->snrMin;
+        }
+
+        if( ( pRecord->flags & LINK_QUALITY_TX ) != 0U )
+        {
+            pStats->transmissions++;
+            lost += ( ( pRecord->flags & LINK_QUALITY_LOST ) != 0U ) ? 1U : 0U;
+        }
+    }
+
+    if( pStats->downlinks == 0 )
+    {
+        pStats->snrMin = 0;
+    }
+
+    if( pStats->transmissions > 0 )
+    {
+        pStats->packetErrorRate = ( float ) lost / ( float ) pStats->transmissions;
+    }
+}
+/*-----------------------------------------------------------*/
+
+float LinkQuality_GetErrorRate( const LinkQuality_t * pLink,
+                                uint16_t * pTransmissions )
+{
+    uint16_t transmissions = 0;
+    uint16_t lost = 0;
+    uint16_t i;
+
+    for( i = 0; i < pLink->count; i++ )
+    {
+        if( ( pLink->window[ i ].flags & LINK_QUALITY_TX ) != 0U )
+        {
+            transmissions++;
+            lost += ( ( pLink->window[ i ].flags & LINK_QUALITY_LOST ) != 0U ) ? 1U : 0U;
+        }
+    }
+
+    if( pTransmissions != NULL )
+    {
+        *pTransmissions = transmissions;
+    }
+
+    return ( ( float ) lost + 1.0f ) / ( ( float ) transmissions + 2.0f );
+}
+/*-----------------------------------------------------------*/
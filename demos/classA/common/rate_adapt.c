@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "rate_adapt.h"
+
+/*-----------------------------------------------------------*/
+
+/* Uses the margin estimate: the lack of margin at once, the excess one step at a time. */
+static void prvAdapt( RateAdapt_t * pRate )
+{
+    float target = ( float ) lorawanConfigRATE_MARGIN_DB;
+    float excess;
+
+    if( pRate->gateways > 1U )
+    {
+        target -= ( float ) lorawanConfigRATE_GATEWAY_DIVERSITY_DB;
+    }
+
+    excess = pRate->margin - target;
+
+    if( excess < 0.0f )
+    {
+        while( ( excess < 0.0f ) && ( pRate->txPower > 0U ) )
+        {
+            pRate->txPower--;
+            pRate->margin += RATE_ADAPT_TX_POWER_STEP_DB;
+            excess += RATE_ADAPT_TX_POWER_STEP_DB;
+            pRate->changes++;
+        }
+
+        while( ( excess < 0.0f ) && ( pRate->dataRate > lorawanConfigRATE_MIN_DATARATE ) )
+        {
+            pRate->dataRate--;
+            pRate->margin += RATE_ADAPT_DATARATE_STEP_DB;
+            excess += RATE_ADAPT_DATARATE_STEP_DB;
+            pRate->changes++;
+        }
+    }
+    else if( ( excess >= ( RATE_ADAPT_DATARATE_STEP_DB + ( float ) lorawanConfigRATE_HYSTERESIS_DB ) ) &&
+             ( pRate->dataRate < lorawanConfigRATE_MAX_DATARATE ) )
+    {
+        pRate->dataRate++;
+        pRate->margin -= RATE_ADAPT_DATARATE_STEP_DB;
+        pRate->changes++;
+    }
+    else if( ( excess >= ( RATE_ADAPT_TX_POWER_STEP_DB + ( float ) lorawanConfigRATE_HYSTERESIS_DB ) ) &&
+             ( pRate->dataRate >= lorawanConfigRATE_MAX_DATARATE ) && ( pRate->txPower < lorawanConfigRATE_MAX_TX_POWER ) )
+    {
+        pRate->txPower++;
+        pRate->margin -= RATE_ADAPT_TX_POWER_STEP_DB;
+        pRate->changes++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvOnLoss( RateAdapt_t * pRate )
+{
+    if( pRate->losses < UINT8_MAX )
+    {
+        pRate->losses++;
+    }
+
+    if( pRate->losses < lorawanConfigRATE_FALLBACK_LOSSES )
+    {
+        return;
+    }
+
+    /* The margin estimate is stale, fall back without it and measure again on the next uplink. */
+    if( ( pRate->txPower > 0U ) || ( pRate->dataRate > lorawanConfigRATE_MIN_DATARATE ) )
+    {
+        pRate->txPower = 0;
+
+        if( pRate->dataRate > lorawanConfigRATE_MIN_DATARATE )
+        {
+            pRate->dataRate--;
+        }
+
+        pRate->changes++;
+        pRate->fallbacks++;
+    }
+
+    pRate->marginValid = false;
+    pRate->uplinks = lorawanConfigRATE_LINK_CHECK_PERIOD;
+}
+/*-----------------------------------------------------------*/
+
+void RateAdapt_Init( RateAdapt_t * pRate,
+                     uint8_t dataRate,
+                     uint8_t txPower )
+{
+    memset( pRate, 0, sizeof( RateAdapt_t ) );
+
+    dataRate = ( dataRate <= lorawanConfigRATE_MIN_DATARATE ) ? lorawanConfigRATE_MIN_DATARATE : dataRate;
+    pRate->dataRate = ( dataRate > lorawanConfigRATE_MAX_DATARATE ) ? lorawanConfigRATE_MAX_DATARATE : dataRate;
+    pRate->txPower = ( txPower > lorawanConfigRATE_MAX_TX_POWER ) ? lorawanConfigRATE_MAX_TX_POWER : txPower;
+
+    /* The first uplink measures the margin. */
+    pRate->uplinks = lorawanConfigRATE_LINK_CHECK_PERIOD;
+}
+/*-----------------------------------------------------------*/
+
+bool RateAdapt_OnUplink( RateAdapt_t * pRate )
+{
+    if( pRate->uplinks < UINT16_MAX )
+    {
+        pRate->uplinks++;
+    }
+
+    if( ( pRate->probePending == true ) || ( pRate->uplinks < lorawanConfigRATE_LINK_CHECK_PERIOD ) )
+    {
+        return false;
+    }
+
+    pRate->uplinks = 0;
+    pRate->probePending = true;
+    pRate->probeDataRate = pRate->dataRate;
+    pRate->probeTxPower = pRate->txPower;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+void RateAdapt_OnLinkCheck( RateAdapt_t * pRate,
+                            uint8_t margin,
+                            uint8_t gateways )
+{
+    float sample = ( float ) margin;
+
+    /* Brings the margin measured at the settings of the link check to the current ones. */
+    if( pRate->probePending == true )
+    {
+        sample -= ( ( float ) pRate->dataRate - ( float ) pRate->probeDataRate ) * RATE_ADAPT_DATARATE_STEP_DB;
+        sample -= ( ( float ) pRate->txPower - ( float ) pRate->probeTxPower ) * RATE_ADAPT_TX_POWER_STEP_DB;
+    }
+
+    pRate->margin = ( pRate->marginValid == true ) ? ( pRate->margin + ( RATE_ADAPT_MARGIN_WEIGHT * ( sample - pRate->margin ) ) ) : sample;
+    pRate->marginValid = true;
+    pRate->gateways = gateways;
+    pRate->losses = 0;
+    pRate->probePending = false;
+
+    prvAdapt( pRate );
+}
+/*-----------------------------------------------------------*/
+
+void RateAdapt_OnLinkCheckLost( RateAdapt_t * pRate )
+{
+    pRate->probePending = false;
+    prvOnLoss( pRate );
+}
+/*-----------------------------------------------------------*/
+
+void RateAdapt_OnConfirmed( RateAdapt_t * pRate,
+                            uint8_t transmissions,
+                            bool acked )
+{
+    uint8_t i;
+
+    for( i = 1; i < transmissions; i++ )
+    {
+        prvOnLoss( pRate );
+    }
+
+    if( acked == true )
+    {
+        pRate->losses = 0;
+    }
+    else
+    {
+        prvOnLoss( pRate );
+    }
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "rx_timing.h"
+
+/**
+ * @brief Spread of the receive delays needed before the drift is told from the bias.
+ */
+#define RX_TIMING_MIN_DELAY_SPREAD_MS    ( 500U )
+
+/*-----------------------------------------------------------*/
+
+static float prvOffsetAt( const RxTiming_t * pTiming,
+                          uint32_t delayMs )
+{
+    return pTiming->biasMs + ( pTiming->driftPpm * 1e-6f * ( float ) delayMs );
+}
+/*-----------------------------------------------------------*/
+
+/* Fits the samples and derives the settings, returns true if they changed. */
+static bool prvUpdate( RxTiming_t * pTiming )
+{
+    uint32_t previousError = pTiming->maxRxErrorMs;
+    uint8_t previousSymbols = pTiming->minRxSymbols;
+    uint32_t minDelay = UINT32_MAX;
+    uint32_t maxDelay = 0;
+    float meanDelay = 0.0f;
+    float meanOffset = 0.0f;
+    float covariance = 0.0f;
+    float variance = 0.0f;
+    float squares = 0.0f;
+    float worstResidual = 0.0f;
+    float residual;
+    float spread;
+    float errorMs;
+    uint16_t i;
+
+    pTiming->minRxSymbols = ( uint8_t ) ( lorawanConfigRX_MIN_SYMBOLS +
+                                          ( ( pTiming->missed < lorawanConfigRX_MIN_SYMBOLS ) ?
+                                            pTiming->missed : lorawanConfigRX_MIN_SYMBOLS ) );
+
+    if( pTiming->count < lorawanConfigRX_CALIBRATION_MIN_SAMPLES )
+    {
+        pTiming->maxRxErrorMs = lorawanConfigRX_MAX_TIMING_ERROR;
+    }
+    else
+    {
+        for( i = 0; i < pTiming->count; i++ )
+        {
+            meanDelay += ( float ) pTiming->delayMs[ i ];
+            meanOffset += pTiming->offsetMs[ i ];
+            minDelay = ( pTiming->delayMs[ i ] < minDelay ) ? pTiming->delayMs[ i ] : minDelay;
+            maxDelay = ( pTiming->delayMs[ i ] > maxDelay ) ? pTiming->delayMs[ i ] : maxDelay;
+        }
+
+        meanDelay /= pTiming->count;
+        meanOffset /= pTiming->count;
+
+        for( i = 0; i < pTiming->count; i++ )
+        {
+            covariance += ( ( float ) pTiming->delayMs[ i ] - meanDelay ) * ( pTiming->offsetMs[ i ] - meanOffset );
+            variance += ( ( float ) pTiming->delayMs[ i ] - meanDelay ) * ( ( float ) pTiming->delayMs[ i ] - meanDelay );
+        }
+
+        /* Most downlinks come in the same window, the drift is only told from the bias with both delays. */
+        pTiming->driftPpm = 0.0f;
+
+        if( ( ( maxDelay - minDelay ) >= RX_TIMING_MIN_DELAY_SPREAD_MS ) && ( variance > 0.0f ) )
+        {
+            pTiming->driftPpm = ( covariance / variance ) * 1e6f;
+
+            if( pTiming->driftPpm > lorawanConfigRX_MAX_DRIFT_PPM )
+            {
+                pTiming->driftPpm = lorawanConfigRX_MAX_DRIFT_PPM;
+            }
+            else if( pTiming->driftPpm < -lorawanConfigRX_MAX_DRIFT_PPM )
+            {
+                pTiming->driftPpm = -lorawanConfigRX_MAX_DRIFT_PPM;
+            }
+        }
+
+        pTiming->biasMs = meanOffset - ( pTiming->driftPpm * 1e-6f * meanDelay );
+
+        for( i = 0; i < pTiming->count; i++ )
+        {
+            residual = fabsf( pTiming->offsetMs[ i ] - prvOffsetAt( pTiming, pTiming->delayMs[ i ] ) );
+            squares += residual * residual;
+            worstResidual = ( residual > worstResidual ) ? residual : worstResidual;
+        }
+
+        pTiming->jitterMs = sqrtf( squares / pTiming->count );
+        spread = ( ( 3.0f * pTiming->jitterMs ) > worstResidual ) ? ( 3.0f * pTiming->jitterMs ) : worstResidual;
+
+        /* The offset is linear in the delay, so the worst one is at an end of the delays seen. */
+        errorMs = fabsf( prvOffsetAt( pTiming, minDelay ) );
+        errorMs = ( fabsf( prvOffsetAt( pTiming, maxDelay ) ) > errorMs ) ? fabsf( prvOffsetAt( pTiming, maxDelay ) ) : errorMs;
+        errorMs = ceilf( errorMs + spread + lorawanConfigRX_CALIBRATION_GUARD_MS );
+
+        if( errorMs > lorawanConfigRX_MAX_TIMING_ERROR )
+        {
+            errorMs = lorawanConfigRX_MAX_TIMING_ERROR;
+        }
+
+        pTiming->maxRxErrorMs = ( errorMs <= lorawanConfigRX_MIN_TIMING_ERROR ) ?
+                                lorawanConfigRX_MIN_TIMING_ERROR : ( uint32_t ) errorMs;
+
+        /* A window still missed gets twice the error for each miss, until the fallback. */
+        for( i = 0; ( i < pTiming->missed ) && ( pTiming->maxRxErrorMs < lorawanConfigRX_MAX_TIMING_ERROR ); i++ )
+        {
+            pTiming->maxRxErrorMs *= 2U;
+        }
+
+        if( pTiming->maxRxErrorMs > lorawanConfigRX_MAX_TIMING_ERROR )
+        {
+            pTiming->maxRxErrorMs = lorawanConfigRX_MAX_TIMING_ERROR;
+        }
+    }
+
+    return ( pTiming->maxRxErrorMs != previousError ) || ( pTiming->minRxSymbols != previousSymbols );
+}
+/*-----------------------------------------------------------*/
+
+void RxTiming_Init( RxTiming_t * pTiming )
+{
+    memset( pTiming, 0, sizeof( RxTiming_t ) );
+    pTiming->maxRxErrorMs = lorawanConfigRX_MAX_TIMING_ERROR;
+    pTiming->minRxSymbols = lorawanConfigRX_MIN_SYMBOLS;
+}
+/*-----------------------------------------------------------*/
+
+bool RxTiming_AddDownlink( RxTiming_t * pTiming,
+                           float offsetMs,
+                           uint32_t delayMs )
+{
+    pTiming->offsetMs[ pTiming->next ] = offsetMs;
+    pTiming->delayMs[ pTiming->next ] = delayMs;
+    pTiming->next = ( uint16_t ) ( ( pTiming->next + 1U ) % lorawanConfigRX_CALIBRATION_WINDOW );
+
+    if( pTiming->count < lorawanConfigRX_CALIBRATION_WINDOW )
+    {
+        pTiming->count++;
+    }
+
+    pTiming->samples++;
+    pTiming->missed = 0;
+
+    return prvUpdate( pTiming );
+}
+/*-----------------------------------------------------------*/
+
+bool RxTiming_OnMissed( RxTiming_t * pTiming )
+{
+    pTiming->missed++;
+
+    /* The samples no longer describe the link, for instance after a temperature step or a reset of the gateway clock. */
+    if( pTiming->missed >= lorawanConfigRX_CALIBRATION_MAX_MISSED )
+    {
+        if( pTiming->count > 0U )
+        {
+            pTiming->fallbacks++;
+        }
+
+        pTiming->count = 0;
+        pTiming->next = 0;
+        pTiming->missed = 0;
+        pTiming->biasMs = 0.0f;
+        pTiming->driftPpm = 0.0f;
+        pTiming->jitterMs = 0.0f;
+    }
+
+    return prvUpdate( pTiming );
+}
+/*-----------------------------------------------------------*/
+
+void RxTiming_GetStats( const RxTiming_t * pTiming,
+                        RxTimingStats_t * pStats )
+{
+    pStats->biasMs = pTiming->biasMs;
+    pStats->driftPpm = pTiming->driftPpm;
+    pStats->jitterMs = pTiming->jitterMs;
+    pStats->window = pTiming->count;
+    pStats->missed = pTiming->missed;
+    pStats->maxRxErrorMs = pTiming->maxRxErrorMs;
+    pStats->minRxSymbols = pTiming->minRxSymbols;
+    pStats->samples = pTiming->samples;
+    pStats->fallbacks = pTiming->fallbacks;
+}
+/*-----------------------------------------------------------*/
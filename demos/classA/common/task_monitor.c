@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+#include "task_monitor.h"
+
+#if ( lorawanConfigMONITOR_PERIOD_SEC > 0 ) && ( configUSE_TRACE_FACILITY != 1 )
+    #error "The task monitor requires configUSE_TRACE_FACILITY to be set to 1."
+#endif
+
+/**
+ * @brief Results, updated in critical sections as the queues are followed from tasks and interrupts.
+ */
+static TaskMonitorReport_t xReport;
+
+/**
+ * @brief State of the tasks read at each sample, too large for the stack of the timer task.
+ */
+static TaskStatus_t xTaskStatus[ lorawanConfigMONITOR_MAX_TASKS ];
+
+/**
+ * @brief Run time counter at the last sample, and run time counted since the first one.
+ */
+static uint32_t ulLastTotalRunTime = 0;
+static uint64_t ullTotalRunTime = 0;
+
+#if ( lorawanConfigMONITOR_PERIOD_SEC > 0 )
+    static TimerHandle_t xSampleTimer = NULL;
+
+    #if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+        static StaticTimer_t xSampleTimerBuffer;
+    #endif
+#endif
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvEnterCritical( void )
+{
+    UBaseType_t uxSavedInterruptStatus = 0;
+
+    if( xPortIsInsideInterrupt() == pdTRUE )
+    {
+        uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+    }
+
+    return uxSavedInterruptStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvExitCritical( UBaseType_t uxSavedInterruptStatus )
+{
+    if( xPortIsInsideInterrupt() == pdTRUE )
+    {
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint16_t prvPermille( uint64_t part,
+                             uint64_t total )
+{
+    return ( total > 0U ) ? ( uint16_t ) ( ( part * 1000U ) / total ) : 0U;
+}
+/*-----------------------------------------------------------*/
+
+static TaskMonitorTask_t * prvFindTask( const TaskStatus_t * pStatus )
+{
+    TaskMonitorTask_t * pTask;
+    uint32_t i;
+
+    for( i = 0; i < xReport.taskCount; i++ )
+    {
+        if( xReport.tasks[ i ].number == pStatus->xTaskNumber )
+        {
+            return &xReport.tasks[ i ];
+        }
+    }
+
+    /* The tasks deleted keep their entry, a sample is skipped before more tasks than entries are seen. */
+    if( xReport.taskCount == lorawanConfigMONITOR_MAX_TASKS )
+    {
+        return NULL;
+    }
+
+    pTask = &xReport.tasks[ xReport.taskCount++ ];
+    memset( pTask, 0x00, sizeof( TaskMonitorTask_t ) );
+    strncpy( pTask->name, pStatus->pcTaskName, sizeof( pTask->name ) - 1U );
+    pTask->number = pStatus->xTaskNumber;
+
+    return pTask;
+}
+/*-----------------------------------------------------------*/
+
+static void prvUpdateTask( TaskMonitorTask_t * pTask,
+                           const TaskStatus_t * pStatus,
+                           uint32_t periodRunTime )
+{
+    uint32_t runTime = 0;
+
+    #if ( configGENERATE_RUN_TIME_STATS == 1 )
+        /* The counters are 32 bit and wrap, a period is much shorter than a wrap. */
+        runTime = pStatus->ulRunTimeCounter - pTask->lastRunTime;
+        pTask->lastRunTime = pStatus->ulRunTimeCounter;
+    #endif
+
+    if( xReport.samples > 0U )
+    {
+        pTask->runTime += runTime;
+        pTask->cpuPermille = prvPermille( runTime, periodRunTime );
+        pTask->averageCpuPermille = prvPermille( pTask->runTime, ullTotalRunTime );
+        pTask->peakCpuPermille = ( pTask->cpuPermille > pTask->peakCpuPermille ) ? pTask->cpuPermille :
+                                 pTask->peakCpuPermille;
+    }
+
+    pTask->stackFreeBytes = ( uint32_t ) pStatus->usStackHighWaterMark * sizeof( StackType_t );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUpdateQueue( TaskMonitorQueue_t * pQueue,
+                            UBaseType_t waiting )
+{
+    if( waiting > pQueue->highWater )
+    {
+        pQueue->highWater = ( uint16_t ) waiting;
+    }
+}
+/*-----------------------------------------------------------*/
+
+#if ( lorawanConfigMONITOR_PERIOD_SEC > 0 )
+    static void prvSampleTimerCallback( TimerHandle_t xTimer )
+    {
+        ( void ) xTimer;
+
+        TaskMonitor_Sample();
+    }
+#endif
+/*-----------------------------------------------------------*/
+
+bool TaskMonitor_Init( void )
+{
+    #if ( lorawanConfigMONITOR_PERIOD_SEC > 0 )
+        if( xSampleTimer == NULL )
+        {
+            #if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+                xSampleTimer = xTimerCreateStatic( "Monitor", pdMS_TO_TICKS( lorawanConfigMONITOR_PERIOD_SEC * 1000UL ),
+                                                   pdTRUE, NULL, prvSampleTimerCallback, &xSampleTimerBuffer );
+            #else
+                xSampleTimer = xTimerCreate( "Monitor", pdMS_TO_TICKS( lorawanConfigMONITOR_PERIOD_SEC * 1000UL ),
+                                             pdTRUE, NULL, prvSampleTimerCallback );
+            #endif
+
+            if( ( xSampleTimer == NULL ) || ( xTimerStart( xSampleTimer, portMAX_DELAY ) != pdPASS ) )
+            {
+                return false;
+            }
+
+            /* The first sample sets the counters the shares of the next one are taken from. */
+            TaskMonitor_Sample();
+        }
+    #endif
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+void TaskMonitor_AddQueue( QueueHandle_t queue,
+                           const char * pName )
+{
+    TaskMonitorQueue_t * pQueue;
+    uint32_t i;
+
+    taskENTER_CRITICAL();
+
+    for( i = 0; i < xReport.queueCount; i++ )
+    {
+        if( xReport.queues[ i ].queue == queue )
+        {
+            break;
+        }
+    }
+
+    if( ( i == xReport.queueCount ) && ( xReport.queueCount < lorawanConfigMONITOR_MAX_QUEUES ) )
+    {
+        pQueue = &xReport.queues[ xReport.queueCount++ ];
+        pQueue->pName = pName;
+        pQueue->queue = queue;
+        pQueue->length = ( uint16_t ) ( uxQueueMessagesWaiting( queue ) + uxQueueSpacesAvailable( queue ) );
+        pQueue->highWater = 0;
+    }
+
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void TaskMonitor_RemoveQueue( QueueHandle_t queue )
+{
+    uint32_t i;
+
+    taskENTER_CRITICAL();
+
+    for( i = 0; i < xReport.queueCount; i++ )
+    {
+        if( xReport.queues[ i ].queue == queue )
+        {
+            /* Keeps the queues in the order they were added, the order of the encoded reports. */
+            xReport.queueCount--;
+            memmove( &xReport.queues[ i ], &xReport.queues[ i + 1U ],
+                     ( xReport.queueCount - i ) * sizeof( TaskMonitorQueue_t ) );
+            memset( &xReport.queues[ xReport.queueCount ], 0, sizeof( TaskMonitorQueue_t ) );
+            break;
+        }
+    }
+
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void TaskMonitor_OnQueueSend( QueueHandle_t queue )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    UBaseType_t waiting;
+    uint32_t i;
+
+    waiting = ( xPortIsInsideInterrupt() == pdTRUE ) ? uxQueueMessagesWaitingFromISR( queue ) :
+              uxQueueMessagesWaiting( queue );
+    uxSavedInterruptStatus = prvEnterCritical();
+
+    for( i = 0; i < xReport.queueCount; i++ )
+    {
+        if( xReport.queues[ i ].queue == queue )
+        {
+            prvUpdateQueue( &xReport.queues[ i ], waiting );
+            break;
+        }
+    }
+
+    prvExitCritical( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void TaskMonitor_Sample( void )
+{
+    TaskMonitorTask_t * pTask;
+    UBaseType_t taskCount;
+    uint32_t totalRunTime = 0;
+    uint32_t periodRunTime;
+    uint32_t i;
+
+    /* Suspends the scheduler while it reads the tasks. */
+    taskCount = uxTaskGetSystemState( xTaskStatus, lorawanConfigMONITOR_MAX_TASKS, &totalRunTime );
+
+    taskENTER_CRITICAL();
+
+    if( taskCount == 0U )
+    {
+        /* There are more tasks than entries. */
+        xReport.skippedSamples++;
+    }
+    else
+    {
+        periodRunTime = totalRunTime - ulLastTotalRunTime;
+        ulLastTotalRunTime = totalRunTime;
+
+        if( xReport.samples > 0U )
+        {
+            ullTotalRunTime += periodRunTime;
+        }
+
+        for( i = 0; i < taskCount; i++ )
+        {
+            pTask = prvFindTask( &xTaskStatus[ i ] );
+
+            if( pTask != NULL )
+            {
+                prvUpdateTask( pTask, &xTaskStatus[ i ], periodRunTime );
+            }
+        }
+
+        for( i = 0; i < xReport.queueCount; i++ )
+        {
+            prvUpdateQueue( &xReport.queues[ i ], uxQueueMessagesWaiting( xReport.queues[ i ].queue ) );
+        }
+
+        xReport.samples++;
+    }
+
+    xReport.freeHeapBytes = xPortGetFreeHeapSize();
+    xReport.minFreeHeapBytes = xPortGetMinimumEverFreeHeapSize();
+
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void TaskMonitor_GetReport( TaskMonitorReport_t * pReport )
+{
+    taskENTER_CRITICAL();
+    *pReport = xReport;
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+size_t TaskMonitor_EncodeReport( const TaskMonitorReport_t * pReport,
+                                 uint8_t * pBuffer,
+                                 size_t length )
+{
+    uint32_t queueCount = ( pReport->queueCount > 15U ) ? 15U : pReport->queueCount;
+    uint32_t taskCount = ( pReport->taskCount > 32U ) ? 32U : pReport->taskCount;
+    uint32_t encoded = 0;
+    uint32_t taken = 0;
+    uint32_t value;
+    size_t offset;
+    uint32_t best;
+    uint32_t i;
+
+    if( length < ( TASK_MONITOR_REPORT_HEADER_SIZE + queueCount ) )
+    {
+        return 0;
+    }
+
+    value = ( uint32_t ) ( pReport->minFreeHeapBytes / 16U );
+    value = ( value > 0xFFFFU ) ? 0xFFFFU : value;
+    pBuffer[ 0 ] = ( uint8_t ) value;
+    pBuffer[ 1 ] = ( uint8_t ) ( value >> 8 );
+    offset = TASK_MONITOR_REPORT_HEADER_SIZE;
+
+    for( i = 0; i < queueCount; i++ )
+    {
+        pBuffer[ offset++ ] = ( uint8_t ) ( ( pReport->queues[ i ].highWater > 0xFFU ) ? 0xFFU :
+                                            pReport->queues[ i ].highWater );
+    }
+
+    /* The tasks closest to overflowing their stack first, as they matter most when the payload is short. */
+    while( ( encoded < taskCount ) && ( encoded < 15U ) &&
+           ( ( offset + TASK_MONITOR_REPORT_TASK_SIZE ) <= length ) )
+    {
+        best = taskCount;
+
+        for( i = 0; i < taskCount; i++ )
+        {
+            if( ( ( taken & ( 1UL << i ) ) == 0U ) &&
+                ( ( best == taskCount ) ||
+                  ( pReport->tasks[ i ].stackFreeBytes < pReport->tasks[ best ].stackFreeBytes ) ) )
+            {
+                best = i;
+            }
+        }
+
+        taken |= 1UL << best;
+        value = ( pReport->tasks[ best ].stackFreeBytes > 0xFFFFU ) ? 0xFFFFU : pReport->tasks[ best ].stackFreeBytes;
+        pBuffer[ offset++ ] = ( uint8_t ) pReport->tasks[ best ].number;
+        pBuffer[ offset++ ] = ( uint8_t ) ( ( pReport->tasks[ best ].averageCpuPermille + 2U ) / 5U );
+        pBuffer[ offset++ ] = ( uint8_t ) ( ( pReport->tasks[ best ].peakCpuPermille + 2U ) / 5U );
+        pBuffer[ offset++ ] = ( uint8_t ) value;
+        pBuffer[ offset++ ] = ( uint8_t ) ( value >> 8 );
+        encoded++;
+    }
+
+    pBuffer[ 2 ] = ( uint8_t ) ( ( queueCount << 4 ) | encoded );
+
+    return offset;
+}
+/*-----------------------------------------------------------*/
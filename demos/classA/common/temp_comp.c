@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <string.h>
+
+#include "temp_comp.h"
+
+/**
+ * @brief Weight of a new sample in the filtered temperature. The on-die sensors have steps of 0.25 degree, the die
+ * follows the crystal within minutes.
+ */
+#define TEMP_COMP_FILTER_WEIGHT    ( 0.5f )
+
+/*-----------------------------------------------------------*/
+
+/* Correction in us accumulated from lastMs to localMs at the current frequency error. */
+static int64_t prvGetCorrectionUs( const TempComp_t * pComp,
+                                   uint64_t localMs )
+{
+    float elapsedMs = ( localMs > pComp->lastMs ) ? ( float ) ( localMs - pComp->lastMs ) : 0.0f;
+
+    /* A crystal running fast counts more ms than elapsed, so they are taken back. */
+    return pComp->correctionUs - ( int64_t ) ( elapsedMs * pComp->ppm * 1e-3f );
+}
+/*-----------------------------------------------------------*/
+
+float TempComp_GetPpm( float temperature )
+{
+    float delta = temperature - lorawanConfigTEMP_COMP_TURNOVER;
+
+    return lorawanConfigTEMP_COMP_OFFSET_PPM + ( lorawanConfigTEMP_COMP_COEFFICIENT * delta * delta );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t TempComp_CompensatePeriod( uint32_t periodMs,
+                                    float ppm )
+{
+    float compensated = ( float ) periodMs * ( 1.0f + ( ppm * 1e-6f ) );
+
+    return ( compensated < 1.0f ) ? 1U : ( uint32_t ) ( compensated + 0.5f );
+}
+/*-----------------------------------------------------------*/
+
+void TempComp_Init( TempComp_t * pComp,
+                    uint64_t localMs )
+{
+    memset( pComp, 0, sizeof( TempComp_t ) );
+    pComp->lastMs = localMs;
+}
+/*-----------------------------------------------------------*/
+
+void TempComp_AddSample( TempComp_t * pComp,
+                         float temperature,
+                         uint64_t localMs )
+{
+    pComp->correctionUs = prvGetCorrectionUs( pComp, localMs );
+    pComp->lastMs = ( localMs > pComp->lastMs ) ? localMs : pComp->lastMs;
+
+    if( pComp->started == false )
+    {
+        pComp->started = true;
+        pComp->temperature = temperature;
+    }
+    else
+    {
+        pComp->temperature += TEMP_COMP_FILTER_WEIGHT * ( temperature - pComp->temperature );
+    }
+
+    pComp->ppm = TempComp_GetPpm( pComp->temperature );
+    pComp->samples++;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t TempComp_GetTimeMs( const TempComp_t * pComp,
+                             uint64_t localMs )
+{
+    return ( uint64_t ) ( ( int64_t ) localMs + ( prvGetCorrectionUs( pComp, localMs ) / 1000 ) );
+}
+/*-----------------------------------------------------------*/
+
+void TempComp_GetStats( const TempComp_t * pComp,
+                        uint64_t localMs,
+                        TempCompStats_t * pStats )
+{
+    pStats->temperature = pComp->temperature;
+    pStats->ppm = pComp->ppm;
+    pStats->correctionMs = ( float ) prvGetCorrectionUs( pComp, localMs ) / 1000.0f;
+    pStats->samples = pComp->samples;
+}
+/*-----------------------------------------------------------*/
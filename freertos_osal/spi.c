@@ -28,6 +28,7 @@
 #include "spi.h"
 #include "iot_spi.h"
 #include "board-config.h"
+#include "energy_monitor.h"
 
 static IotSPIHandle_t SpiHandle[2];
 
@@ -151,6 +152,8 @@ uint16_t SpiInOut( Spi_t *obj, uint16_t outData )
     } while( ret == IOT_SPI_BUS_BUSY );
     configASSERT( IOT_SPI_SUCCESS == ret );
 
+    EnergyMonitor_AddSpiBytes( 1 );
+
     #ifdef _PROTECT_BOARD_SPI_TRANSACTIONS
     if( xPortIsInsideInterrupt() == pdTRUE )
     {
@@ -28,19 +28,77 @@
 #include "timers.h"
 #include "task.h"
 #include "timer.h"
+#include "LoRaWANConfig.h"
+#include "block_pool.h"
 
 #if configUSE_16_BIT_TICKS == 1
 #error "16 bit ticks is not supported for LoRaWAN timer implementation."
 #endif
 
+#if ( lorawanConfigSTATIC_ALLOCATION == 1 ) && ( configSUPPORT_STATIC_ALLOCATION != 1 )
+#error "lorawanConfigSTATIC_ALLOCATION requires configSUPPORT_STATIC_ALLOCATION to be set to 1."
+#endif
+
 
 struct TimerEvent_s {
     TimerHandle_t handle;
     void ( *callback )( void *context );
     void *context;
     TickType_t timerTicks;
+    TimerEvent_t *owner;
+#if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+    StaticTimer_t timerBuffer;
+#endif
 };
 
+/*
+ * Timer events are taken from a pool, and an object initialized again keeps its event, as LoRaMAC and the radio drivers
+ * initialize their timers again at each LoRaMacInitialization().
+ */
+static struct TimerEvent_s xTimerEvents[ lorawanConfigMAX_TIMERS ];
+static uint16_t usTimerEventLinks[ lorawanConfigMAX_TIMERS ];
+static BlockPool_t xTimerEventPool;
+
+static struct TimerEvent_s * prvTakeEvent( TimerEvent_t * obj )
+{
+    struct TimerEvent_s * pEvent;
+    uint32_t i;
+
+    if( xTimerEventPool.pStorage == NULL )
+    {
+        ( void ) BlockPool_Init( &xTimerEventPool, "timer events", xTimerEvents, sizeof( struct TimerEvent_s ),
+                                 lorawanConfigMAX_TIMERS, usTimerEventLinks );
+    }
+
+    for( i = 0; i < lorawanConfigMAX_TIMERS; i++ )
+    {
+        if( xTimerEvents[ i ].owner == obj )
+        {
+            xTimerStop( xTimerEvents[ i ].handle, portMAX_DELAY );
+            return &xTimerEvents[ i ];
+        }
+    }
+
+    pEvent = BlockPool_Alloc( &xTimerEventPool );
+
+#if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+    /* Raise lorawanConfigMAX_TIMERS. */
+    configASSERT( pEvent != NULL );
+#else
+    if( pEvent == NULL )
+    {
+        /* Counted as a failure of the pool, raise lorawanConfigMAX_TIMERS. */
+        pEvent = pvPortMalloc( sizeof( struct TimerEvent_s ) );
+        configASSERT( pEvent != NULL );
+        pEvent->handle = NULL;
+    }
+#endif
+
+    pEvent->owner = obj;
+
+    return pEvent;
+}
+
 
 static void prvCallbackExecutor( TimerHandle_t xTimer  )
 {
@@ -56,16 +114,30 @@ void TimerInit( TimerEvent_t * obj, void ( *callback )( void *context ) )
 {
     TickType_t initialPeriod = ( TickType_t )( 1UL );
     TimerHandle_t timerHandle;
-    struct TimerEvent_s * pEvent = pvPortMalloc( sizeof( struct TimerEvent_s ) );
+    struct TimerEvent_s * pEvent = prvTakeEvent( obj );
 
-    configASSERT( pEvent != NULL );
-    memset( pEvent, 0x00, sizeof( struct TimerEvent_s ) );
+    timerHandle = pEvent->handle;
     pEvent->callback = callback;
-    timerHandle = xTimerCreate( "LoraWANTimer",
-            initialPeriod,
-            pdFALSE,
-            pEvent,
-            prvCallbackExecutor );
+    pEvent->context = NULL;
+    pEvent->timerTicks = 0;
+
+    if( timerHandle == NULL )
+    {
+#if ( lorawanConfigSTATIC_ALLOCATION == 1 )
+        timerHandle = xTimerCreateStatic( "LoraWANTimer",
+                initialPeriod,
+                pdFALSE,
+                pEvent,
+                prvCallbackExecutor,
+                &pEvent->timerBuffer );
+#else
+        timerHandle = xTimerCreate( "LoraWANTimer",
+                initialPeriod,
+                pdFALSE,
+                pEvent,
+                prvCallbackExecutor );
+#endif
+    }
 
     configASSERT( timerHandle != NULL );
     pEvent->handle = timerHandle;
@@ -31,6 +31,10 @@
 /* Logging includes. */
 #include "iot_logging_task.h"
 
+#if ( configLOGGING_STATIC_BUFFERS > 0 )
+    #include "block_pool.h"
+#endif
+
 /* Standard includes. */
 #include <stdio.h>
 #include <stdarg.h>
@@ -49,6 +53,23 @@
     #error configLOGGING_INCLUDE_TIME_AND_TASK_NAME must be defined in FreeRTOSConfig.h to use this logging file.  Set configLOGGING_INCLUDE_TIME_AND_TASK_NAME to 1 to prepend a time stamp, message number and the name of the calling task to each logged message.  Otherwise set to 0.
 #endif
 
+/* Set configLOGGING_STATIC_BUFFERS to a number of messages to take the message
+ * buffers, the queues and the task from static storage rather than from the
+ * heap. The messages are formatted into a block pool of that many buffers of
+ * configLOGGING_MAX_MESSAGE_LENGTH bytes, and dropped while all of them wait to
+ * be output. The task stack is configLOGGING_STATIC_STACK_SIZE words. */
+#ifndef configLOGGING_STATIC_BUFFERS
+    #define configLOGGING_STATIC_BUFFERS    0
+#endif
+
+#ifndef configLOGGING_STATIC_STACK_SIZE
+    #define configLOGGING_STATIC_STACK_SIZE    ( configMINIMAL_STACK_SIZE * 5 )
+#endif
+
+#if ( configLOGGING_STATIC_BUFFERS > 0 ) && ( configSUPPORT_STATIC_ALLOCATION != 1 )
+    #error configLOGGING_STATIC_BUFFERS requires configSUPPORT_STATIC_ALLOCATION to be set to 1.
+#endif
+
 /* A block time of 0 just means don't block. */
 #define loggingDONT_BLOCK    0
 
@@ -76,6 +97,59 @@ static void prvLoggingTask( void * pvParameters );
  */
 static QueueHandle_t xQueue = NULL;
 
+#if ( configLOGGING_STATIC_BUFFERS > 0 )
+
+    /*
+     * The pool of the message buffers, passed around by pointer as the
+     * messages, and the static storage of the queue and of the task.
+     */
+    static BlockPool_t xMessagePool;
+    static char cMessageBuffers[ configLOGGING_STATIC_BUFFERS ][ configLOGGING_MAX_MESSAGE_LENGTH ];
+    static uint16_t usMessageLinks[ configLOGGING_STATIC_BUFFERS ];
+    static StaticQueue_t xQueueBuffer;
+    static uint8_t ucQueueStorage[ configLOGGING_STATIC_BUFFERS * sizeof( char * ) ];
+    static StaticTask_t xTaskBuffer;
+    static StackType_t xTaskStack[ configLOGGING_STATIC_STACK_SIZE ];
+#endif
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Takes a buffer for a message of xLength bytes, NULL if none is available.
+ */
+static char * prvTakeBuffer( size_t xLength )
+{
+    char * pcBuffer = NULL;
+
+    #if ( configLOGGING_STATIC_BUFFERS > 0 )
+        {
+            if( xLength <= configLOGGING_MAX_MESSAGE_LENGTH )
+            {
+                pcBuffer = BlockPool_Alloc( &xMessagePool );
+            }
+        }
+    #else
+        {
+            pcBuffer = pvPortMalloc( xLength );
+        }
+    #endif
+
+    return pcBuffer;
+}
+/*-----------------------------------------------------------*/
+
+static void prvGiveBuffer( char * pcBuffer )
+{
+    #if ( configLOGGING_STATIC_BUFFERS > 0 )
+        {
+            ( void ) BlockPool_Free( &xMessagePool, pcBuffer );
+        }
+    #else
+        {
+            vPortFree( ( void * ) pcBuffer );
+        }
+    #endif
+}
 /*-----------------------------------------------------------*/
 
 BaseType_t xLoggingTaskInitialize( uint16_t usStackSize,
@@ -85,6 +159,25 @@ BaseType_t xLoggingTaskInitialize( uint16_t usStackSize,
     BaseType_t xReturn = pdFAIL;
 
     /* Ensure the logging task has not been created already. */
+    #if ( configLOGGING_STATIC_BUFFERS > 0 )
+        if( xQueue == NULL )
+        {
+            /* The sizes are set at build time. */
+            configASSERT( usStackSize <= configLOGGING_STATIC_STACK_SIZE );
+            ( void ) usStackSize;
+            ( void ) uxQueueLength;
+
+            ( void ) BlockPool_Init( &xMessagePool, "log records", cMessageBuffers, configLOGGING_MAX_MESSAGE_LENGTH,
+                                     configLOGGING_STATIC_BUFFERS, usMessageLinks );
+            xQueue = xQueueCreateStatic( configLOGGING_STATIC_BUFFERS, sizeof( char * ), ucQueueStorage, &xQueueBuffer );
+
+            if( xTaskCreateStatic( prvLoggingTask, "Logging", configLOGGING_STATIC_STACK_SIZE, NULL, uxPriority,
+                                   xTaskStack, &xTaskBuffer ) != NULL )
+            {
+                xReturn = pdPASS;
+            }
+        }
+    #else /* if ( configLOGGING_STATIC_BUFFERS > 0 ) */
     if( xQueue == NULL )
     {
         /* Create the queue used to pass pointers to strings to the logging task. */
@@ -103,6 +196,7 @@ BaseType_t xLoggingTaskInitialize( uint16_t usStackSize,
             }
         }
     }
+    #endif /* if ( configLOGGING_STATIC_BUFFERS > 0 ) */
 
     return xReturn;
 }
@@ -121,7 +215,7 @@ static void prvLoggingTask( void * pvParameters )
         if( xQueueReceive( xQueue, &pcReceivedString, portMAX_DELAY ) == pdPASS )
         {
             configPRINT_STRING( pcReceivedString );
-            vPortFree( ( void * ) pcReceivedString );
+            prvGiveBuffer( pcReceivedString );
         }
     }
 }
@@ -149,7 +243,7 @@ void vLoggingPrintf( const char * pcFormat,
     configASSERT( xQueue );
 
     /* Allocate a buffer to hold the log message. */
-    pcPrintString = pvPortMalloc( configLOGGING_MAX_MESSAGE_LENGTH );
+    pcPrintString = prvTakeBuffer( configLOGGING_MAX_MESSAGE_LENGTH );
 
     if( pcPrintString != NULL )
     {
@@ -214,14 +308,14 @@ void vLoggingPrintf( const char * pcFormat,
             if( xQueueSend( xQueue, &pcPrintString, loggingDONT_BLOCK ) != pdPASS )
             {
                 /* The buffer was not sent so must be freed again. */
-                vPortFree( ( void * ) pcPrintString );
+                prvGiveBuffer( pcPrintString );
             }
         }
         else
         {
             /* The buffer was not sent, so it must be
              * freed. */
-            vPortFree( ( void * ) pcPrintString );
+            prvGiveBuffer( pcPrintString );
         }
     }
 }
@@ -237,17 +331,29 @@ void vLoggingPrint( const char * pcMessage )
     configASSERT( xQueue );
 
     xLength = strlen( pcMessage ) + 1;
-    pcPrintString = pvPortMalloc( xLength );
+
+    #if ( configLOGGING_STATIC_BUFFERS > 0 )
+        {
+            /* Longer messages are truncated to a buffer. */
+            if( xLength > configLOGGING_MAX_MESSAGE_LENGTH )
+            {
+                xLength = configLOGGING_MAX_MESSAGE_LENGTH;
+            }
+        }
+    #endif
+
+    pcPrintString = prvTakeBuffer( xLength );
 
     if( pcPrintString != NULL )
     {
         strncpy( pcPrintString, pcMessage, xLength );
+        pcPrintString[ xLength - 1 ] = '\0';
 
         /* Send the string to the logging task for IO. */
         if( xQueueSend( xQueue, &pcPrintString, loggingDONT_BLOCK ) != pdPASS )
         {
             /* The buffer was not sent so must be freed again. */
-            vPortFree( ( void * ) pcPrintString );
+            prvGiveBuffer( pcPrintString );
         }
     }
 }